@@ -0,0 +1,135 @@
+/**
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <array>
+#include <functional>
+
+#include "../Assert.h"
+
+namespace Ponca {
+
+//!
+//! \brief Same as limited_priority_queue, with a fixed-size storage of N elements
+//!
+//! The queue never allocates: the elements are stored in a std::array, and the capacity given at
+//! construction must not exceed N. Elements are inserted by shifting the elements of lower priority
+//! from the bottom of the queue, which is faster than a binary search for small capacities (N <= 32).
+//!
+//! \see limited_priority_queue
+//! \ingroup common
+template<class T,
+         int N,
+         class CompareT = std::less<T>>
+class static_limited_priority_queue
+{
+public:
+    using value_type      = T;
+    using container_type  = std::array<T, N>;
+    using compare         = CompareT;
+    using iterator        = typename container_type::iterator;
+    using const_iterator  = typename container_type::const_iterator;
+    using this_type       = static_limited_priority_queue<T,N,CompareT>;
+
+    // static_limited_priority_queue -------------------------------------------
+public:
+    inline explicit static_limited_priority_queue(int capacity = N);
+
+    // Iterator ----------------------------------------------------------------
+public:
+    inline iterator       begin()        { return m_c.begin(); }
+    inline const_iterator begin()  const { return m_c.begin(); }
+    inline const_iterator cbegin() const { return m_c.cbegin(); }
+
+    inline iterator       end()        { return m_c.begin() + m_size; }
+    inline const_iterator end()  const { return m_c.begin() + m_size; }
+    inline const_iterator cend() const { return m_c.cbegin() + m_size; }
+
+    // Element access ----------------------------------------------------------
+public:
+    inline const T& top()    const { return m_c[0]; }
+    inline const T& bottom() const { return m_c[m_size-1]; }
+
+    inline T& top()    { return m_c[0]; }
+    inline T& bottom() { return m_c[m_size-1]; }
+
+    // Capacity ----------------------------------------------------------------
+public:
+    inline bool   empty()    const { return m_size == 0; }
+    inline bool   full()     const { return m_size == m_capacity; }
+    inline size_t size()     const { return m_size; }
+    inline size_t capacity() const { return m_capacity; }
+
+    // Modifiers ---------------------------------------------------------------
+public:
+    inline bool push(const T& value);
+
+    inline void pop() { --m_size; }
+
+    /// \brief Change the capacity, which must not exceed N
+    inline void reserve(int capacity);
+
+    inline void clear() { m_size = 0; }
+
+    // Data --------------------------------------------------------------------
+public:
+    inline const container_type& container() const { return m_c; }
+
+protected:
+    container_type  m_c;
+    compare         m_comp;
+    size_t          m_size {0};
+    size_t          m_capacity {0};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+template<class T, int N, class Cmp>
+static_limited_priority_queue<T,N,Cmp>::static_limited_priority_queue(int capacity) :
+    m_c(),
+    m_comp(),
+    m_size(0),
+    m_capacity(0)
+{
+    reserve(capacity);
+}
+
+template<class T, int N, class Cmp>
+bool static_limited_priority_queue<T,N,Cmp>::push(const T& value)
+{
+    size_t i;
+    if(full())
+    {
+        // same as limited_priority_queue: equal priorities are kept in insertion order
+        if(m_capacity == 0 || !m_comp(value, bottom()))
+            return false;
+        i = m_size-1;
+    }
+    else
+    {
+        i = m_size++;
+    }
+
+    for(; i > 0 && m_comp(value, m_c[i-1]); --i)
+        m_c[i] = m_c[i-1];
+    m_c[i] = value;
+    return true;
+}
+
+template<class T, int N, class Cmp>
+void static_limited_priority_queue<T,N,Cmp>::reserve(int capacity)
+{
+    PONCA_DEBUG_ASSERT_MSG(capacity >= 0 && capacity <= N, "static_limited_priority_queue capacity exceeds its storage");
+    m_capacity = size_t(capacity < 0 ? 0 : (capacity > N ? N : capacity));
+    if(m_size > m_capacity)
+        m_size = m_capacity;
+}
+
+} // namespace Ponca
@@ -0,0 +1,191 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PONCA_HAS_MMAP
+#endif
+
+namespace Ponca {
+
+/// \brief Formats read by PointCloudFile
+enum POINT_CLOUD_FORMAT
+{
+    POINT_CLOUD_NONE = 0, /*!< \brief No file opened */
+    POINT_CLOUD_PLY  = 1, /*!< \brief Binary PLY, little or big endian, the points being the `vertex` element */
+    POINT_CLOUD_LAS  = 2, /*!< \brief Uncompressed LAS 1.0 to 1.4 */
+    POINT_CLOUD_RAW  = 3  /*!< \brief Fixed-size records, described by PointCloudFile::open_raw */
+};
+
+/// \brief Type of a property of the records of a point cloud file
+enum POINT_CLOUD_PROPERTY_TYPE
+{
+    PROPERTY_INT8,
+    PROPERTY_UINT8,
+    PROPERTY_INT16,
+    PROPERTY_UINT16,
+    PROPERTY_INT32,
+    PROPERTY_UINT32,
+    PROPERTY_FLOAT32,
+    PROPERTY_FLOAT64
+};
+
+/// \brief Scalar property of the records of a point cloud file: its offset in the record, its type, and the
+/// transform `value * scale + shift` applied when it is read, e.g. by the integer coordinates of LAS files
+struct PointCloudProperty
+{
+    int offset {-1};
+    POINT_CLOUD_PROPERTY_TYPE type {PROPERTY_FLOAT32};
+    double scale {1.};
+    double shift {0.};
+
+    inline bool valid() const { return offset >= 0; }
+    /// \brief Size of the property in bytes
+    inline static int size(POINT_CLOUD_PROPERTY_TYPE type);
+    /// \brief Value of the property in `record`, whose bytes are reversed when `swap` is true
+    inline double read(const char* record, bool swap) const;
+};
+
+/// \brief Read-only file mapped in memory, or read in a buffer when mmap is not available
+/// \ingroup common
+class MappedFile
+{
+public:
+    inline MappedFile() = default;
+    inline ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// \return false when the file cannot be opened or mapped
+    inline bool open(const std::string& filename);
+    inline void close();
+
+    inline const char* data() const { return m_data; }
+    inline std::size_t size() const { return m_size; }
+
+private:
+    const char* m_data {nullptr};
+    std::size_t m_size {0};
+    std::vector<char> m_buffer; // content of the file when it is not mapped
+};
+
+/// \brief Reader of point clouds stored in binary files, in parallel and without intermediate containers
+///
+/// The file is mapped in memory, its header parsed by open(), and the points are decoded by the OpenMP threads,
+/// straight into a buffer of DataPoint or flat buffers of coordinates:
+/// \code
+/// PointCloudFile file;
+/// if (file.open("cloud.ply"))
+/// {
+///     std::vector<MyPoint> points(file.point_count());
+///     file.read(points.data());
+///     KdTree<MyPoint> tree;
+///     tree.build_view(points.data(), int(points.size()));
+/// }
+/// \endcode
+/// Raw files storing DataPoint records, as written by KdTree::save with points, can be used by the tree without
+/// any copy through view().
+///
+/// LAZ files are compressed and not supported: open() returns false.
+/// \ingroup common
+class PointCloudFile
+{
+public:
+    inline PointCloudFile() = default;
+
+    /// \brief Open a binary PLY or a LAS file, detected from its content
+    /// \return false when the file cannot be read or its format is not supported, the file is then closed
+    inline bool open(const std::string& filename);
+
+    /// \brief Open a file of `count` fixed-size records of `stride` bytes, following a header of `header_size`
+    /// bytes, or filling the file when `count` is negative
+    ///
+    /// `position` describes the first coordinate of the positions, the others following it in the record, and
+    /// `normal` those of the normals, if any.
+    inline bool open_raw(const std::string& filename, std::size_t stride, const PointCloudProperty& position,
+                         const PointCloudProperty& normal = PointCloudProperty(), std::size_t header_size = 0,
+                         std::int64_t count = -1);
+
+    inline void close();
+
+    // Accessors ---------------------------------------------------------------
+public:
+    inline POINT_CLOUD_FORMAT format() const { return m_format; }
+    inline std::size_t point_count() const { return m_count; }
+    inline bool has_normals() const { return m_normal[0].valid(); }
+    /// \brief Size in bytes of the records of the points
+    inline std::size_t stride() const { return m_stride; }
+    /// \brief Record of the point `i`
+    inline const char* record(std::size_t i) const { return m_file.data() + m_data_offset + i * m_stride; }
+
+    /// \brief Properties of the coordinates of the positions and normals
+    inline const PointCloudProperty& position_property(int d) const { return m_position[d]; }
+    inline const PointCloudProperty& normal_property(int d) const { return m_normal[d]; }
+
+    // Reading -----------------------------------------------------------------
+public:
+    /// \brief Write the `3 * point_count()` coordinates of the positions to `xyz`
+    template<typename Scalar>
+    inline void read_positions(Scalar* xyz) const;
+
+    /// \brief Write the `3 * point_count()` coordinates of the normals to `xyz`, or zeros when the file has none
+    template<typename Scalar>
+    inline void read_normals(Scalar* xyz) const;
+
+    /// \brief Construct the `point_count()` points of `points`, by `DataPoint(pos, normal)` when the file has
+    /// normals and DataPoint has this constructor, by `DataPoint(pos)` otherwise
+    template<class DataPoint>
+    inline void read(DataPoint* points) const;
+
+    /// \brief Points of a raw file whose records are DataPoint, read in place, or null when the records do not
+    /// match DataPoint
+    ///
+    /// The records match DataPoint when their size is `sizeof(DataPoint)` and they start at an offset aligned
+    /// for DataPoint. The pointer is valid until the file is closed.
+    template<class DataPoint>
+    inline const DataPoint* view() const;
+
+protected:
+    inline bool parse_ply();
+    inline bool parse_las();
+    /// \brief Check that the records of the points are inside the file, and close it otherwise
+    inline bool check_size();
+
+    template<typename VectorType>
+    inline VectorType read_vector(const PointCloudProperty* properties, std::size_t i) const;
+
+    // Data --------------------------------------------------------------------
+protected:
+    MappedFile m_file;
+    POINT_CLOUD_FORMAT m_format {POINT_CLOUD_NONE};
+    std::size_t m_count {0};
+    std::size_t m_data_offset {0};
+    std::size_t m_stride {0};
+    bool m_swap {false}; // byte order of the file different from the host
+    PointCloudProperty m_position[3];
+    PointCloudProperty m_normal[3];
+};
+
+#include "./pointCloudFile.hpp"
+
+} // namespace Ponca
@@ -0,0 +1,418 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+namespace internal
+{
+/// \brief Value of type T stored at `data`, possibly unaligned, whose bytes are reversed when `swap` is true
+template<typename T>
+inline T load_unaligned(const char* data, bool swap)
+{
+	char bytes[sizeof(T)];
+	std::memcpy(bytes, data, sizeof(T));
+	if(swap)
+	    std::reverse(bytes, bytes + sizeof(T));
+	T value;
+	std::memcpy(&value, bytes, sizeof(T));
+	return value;
+}
+
+inline bool host_is_big_endian()
+{
+	const std::uint16_t value = 1;
+	char byte;
+	std::memcpy(&byte, &value, 1);
+	return byte == 0;
+}
+} // namespace internal
+
+// PointCloudProperty ----------------------------------------------------------
+
+int PointCloudProperty::size(POINT_CLOUD_PROPERTY_TYPE type)
+{
+	switch(type)
+	{
+	case PROPERTY_INT8:
+	case PROPERTY_UINT8:   return 1;
+	case PROPERTY_INT16:
+	case PROPERTY_UINT16:  return 2;
+	case PROPERTY_INT32:
+	case PROPERTY_UINT32:
+	case PROPERTY_FLOAT32: return 4;
+	case PROPERTY_FLOAT64: return 8;
+	}
+	return 0;
+}
+
+double PointCloudProperty::read(const char* record, bool swap) const
+{
+	const char* data = record + offset;
+	double value = 0;
+	switch(type)
+	{
+	case PROPERTY_INT8:    value = internal::load_unaligned<std::int8_t>(data, swap); break;
+	case PROPERTY_UINT8:   value = internal::load_unaligned<std::uint8_t>(data, swap); break;
+	case PROPERTY_INT16:   value = internal::load_unaligned<std::int16_t>(data, swap); break;
+	case PROPERTY_UINT16:  value = internal::load_unaligned<std::uint16_t>(data, swap); break;
+	case PROPERTY_INT32:   value = internal::load_unaligned<std::int32_t>(data, swap); break;
+	case PROPERTY_UINT32:  value = internal::load_unaligned<std::uint32_t>(data, swap); break;
+	case PROPERTY_FLOAT32: value = internal::load_unaligned<float>(data, swap); break;
+	case PROPERTY_FLOAT64: value = internal::load_unaligned<double>(data, swap); break;
+	}
+	return value * scale + shift;
+}
+
+// MappedFile ------------------------------------------------------------------
+
+bool MappedFile::open(const std::string& filename)
+{
+	close();
+#ifdef PONCA_HAS_MMAP
+	const int fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+	    return false;
+	struct stat status;
+	if(::fstat(fd, &status) != 0 || status.st_size <= 0)
+	{
+	    ::close(fd);
+	    return false;
+	}
+	void* data = ::mmap(nullptr, std::size_t(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // the mapping keeps the file open
+	if(data == MAP_FAILED)
+	    return false;
+	m_data = static_cast<const char*>(data);
+	m_size = std::size_t(status.st_size);
+#else
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if(!file)
+	    return false;
+	m_buffer.resize(std::size_t(file.tellg()));
+	file.seekg(0);
+	if(m_buffer.empty() || !file.read(m_buffer.data(), std::streamsize(m_buffer.size())))
+	{
+	    m_buffer.clear();
+	    return false;
+	}
+	m_data = m_buffer.data();
+	m_size = m_buffer.size();
+#endif
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef PONCA_HAS_MMAP
+	if(m_data != nullptr)
+	    ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+	m_buffer.clear();
+	m_buffer.shrink_to_fit();
+	m_data = nullptr;
+	m_size = 0;
+}
+
+// PointCloudFile --------------------------------------------------------------
+
+bool PointCloudFile::open(const std::string& filename)
+{
+	close();
+	if(!m_file.open(filename))
+	    return false;
+
+	const auto starts_with = [this](const char* magic)
+	{
+	    const std::size_t n = std::strlen(magic);
+	    return m_file.size() >= n && std::memcmp(m_file.data(), magic, n) == 0;
+	};
+	bool ok = false;
+	if(starts_with("ply"))
+	    ok = parse_ply();
+	else if(starts_with("LASF"))
+	    ok = parse_las();
+
+	if(!ok)
+	{
+	    close();
+	    return false;
+	}
+	return check_size();
+}
+
+bool PointCloudFile::open_raw(const std::string& filename, std::size_t stride, const PointCloudProperty& position,
+                              const PointCloudProperty& normal, std::size_t header_size, std::int64_t count)
+{
+	close();
+	if(!m_file.open(filename) || stride == 0 || !position.valid() || header_size > m_file.size())
+	{
+	    close();
+	    return false;
+	}
+
+	m_format = POINT_CLOUD_RAW;
+	m_stride = stride;
+	m_data_offset = header_size;
+	m_count = count < 0 ? (m_file.size() - header_size) / stride : std::size_t(count);
+	for(int d=0; d<3; ++d)
+	{
+	    m_position[d] = position;
+	    m_position[d].offset += d * PointCloudProperty::size(position.type);
+	    if(normal.valid())
+	    {
+	        m_normal[d] = normal;
+	        m_normal[d].offset += d * PointCloudProperty::size(normal.type);
+	    }
+	}
+	return check_size();
+}
+
+void PointCloudFile::close()
+{
+	m_file.close();
+	m_format = POINT_CLOUD_NONE;
+	m_count = 0;
+	m_data_offset = 0;
+	m_stride = 0;
+	m_swap = false;
+	for(int d=0; d<3; ++d)
+	{
+	    m_position[d] = PointCloudProperty();
+	    m_normal[d] = PointCloudProperty();
+	}
+}
+
+bool PointCloudFile::parse_ply()
+{
+	const char* begin = m_file.data();
+	const char* end = begin + m_file.size();
+	const char* line = begin;
+
+	// elements preceding the vertices, skipped by the data offset
+	std::size_t skipped = 0;
+	std::size_t element_count = 0, element_size = 0;
+	bool in_vertex = false, vertex_found = false, binary = false, has_list = false;
+
+	while(true)
+	{
+	    const char* eol = std::find(line, end, '\n');
+	    if(eol == end)
+	        return false;
+	    std::string text(line, eol);
+	    if(!text.empty() && text.back() == '\r')
+	        text.pop_back();
+	    line = eol + 1;
+
+	    std::vector<std::string> words;
+	    for(std::size_t start=0; start<text.size(); )
+	    {
+	        const std::size_t stop = std::min(text.find(' ', start), text.size());
+	        if(stop > start)
+	            words.push_back(text.substr(start, stop - start));
+	        start = stop + 1;
+	    }
+	    if(words.empty())
+	        continue;
+
+	    const bool end_of_element = words[0] == "element" || words[0] == "end_header";
+	    if(end_of_element && !vertex_found && !in_vertex && element_count > 0)
+	    {
+	        if(has_list)
+	            return false; // elements of variable size before the vertices
+	        skipped += element_count * element_size;
+	    }
+	    if(end_of_element && in_vertex)
+	    {
+	        if(has_list)
+	            return false;
+	        m_count = element_count;
+	        m_stride = element_size;
+	        in_vertex = false;
+	        vertex_found = true;
+	    }
+
+	    if(words[0] == "format" && words.size() > 1)
+	    {
+	        binary = words[1] != "ascii";
+	        m_swap = (words[1] == "binary_big_endian") != internal::host_is_big_endian();
+	    }
+	    else if(words[0] == "element" && words.size() > 2)
+	    {
+	        in_vertex = !vertex_found && words[1] == "vertex";
+	        element_count = std::size_t(std::strtoull(words[2].c_str(), nullptr, 10));
+	        element_size = 0;
+	        has_list = false;
+	    }
+	    else if(words[0] == "property" && words.size() > 2)
+	    {
+	        if(words[1] == "list")
+	        {
+	            has_list = true;
+	            continue;
+	        }
+
+	        static const std::pair<const char*, POINT_CLOUD_PROPERTY_TYPE> types[] = {
+	            {"char", PROPERTY_INT8},     {"int8", PROPERTY_INT8},
+	            {"uchar", PROPERTY_UINT8},   {"uint8", PROPERTY_UINT8},
+	            {"short", PROPERTY_INT16},   {"int16", PROPERTY_INT16},
+	            {"ushort", PROPERTY_UINT16}, {"uint16", PROPERTY_UINT16},
+	            {"int", PROPERTY_INT32},     {"int32", PROPERTY_INT32},
+	            {"uint", PROPERTY_UINT32},   {"uint32", PROPERTY_UINT32},
+	            {"float", PROPERTY_FLOAT32}, {"float32", PROPERTY_FLOAT32},
+	            {"double", PROPERTY_FLOAT64}, {"float64", PROPERTY_FLOAT64}
+	        };
+	        const auto type = std::find_if(std::begin(types), std::end(types),
+	                                       [&](const auto& t) { return words[1] == t.first; });
+	        if(type == std::end(types))
+	            return false;
+
+	        if(in_vertex)
+	        {
+	            static const char* names[] = {"x", "y", "z", "nx", "ny", "nz"};
+	            for(int k=0; k<6; ++k)
+	            {
+	                if(words[2] == names[k])
+	                {
+	                    PointCloudProperty& property = k < 3 ? m_position[k] : m_normal[k - 3];
+	                    property.offset = int(element_size);
+	                    property.type = type->second;
+	                }
+	            }
+	        }
+	        element_size += std::size_t(PointCloudProperty::size(type->second));
+	    }
+	    else if(words[0] == "end_header")
+	        break;
+	}
+
+	m_format = POINT_CLOUD_PLY;
+	m_data_offset = std::size_t(line - begin) + skipped;
+	if(!(m_normal[0].valid() && m_normal[1].valid() && m_normal[2].valid()))
+	{
+	    for(int d=0; d<3; ++d)
+	        m_normal[d] = PointCloudProperty();
+	}
+	return binary && vertex_found && m_position[0].valid() && m_position[1].valid() && m_position[2].valid();
+}
+
+bool PointCloudFile::parse_las()
+{
+	// LAS 1.0 to 1.4 public header block
+	const char* header = m_file.data();
+	if(m_file.size() < 227)
+	    return false;
+	const bool swap = internal::host_is_big_endian(); // LAS files are little endian
+
+	const int version_minor = int(std::uint8_t(header[25]));
+	const std::uint32_t data_offset = internal::load_unaligned<std::uint32_t>(header + 96, swap);
+	const std::uint8_t point_format = internal::load_unaligned<std::uint8_t>(header + 104, swap);
+	const std::uint16_t record_length = internal::load_unaligned<std::uint16_t>(header + 105, swap);
+	std::uint64_t count = internal::load_unaligned<std::uint32_t>(header + 107, swap);
+	if(version_minor >= 4 && m_file.size() >= 255)
+	{
+	    const std::uint64_t count64 = internal::load_unaligned<std::uint64_t>(header + 247, swap);
+	    if(count64 != 0)
+	        count = count64;
+	}
+
+	// the high bits of the point format flag the LAZ compression
+	if((point_format & 0xC0) != 0 || record_length < 12)
+	    return false;
+
+	m_format = POINT_CLOUD_LAS;
+	m_swap = swap;
+	m_count = std::size_t(count);
+	m_stride = record_length;
+	m_data_offset = data_offset;
+	for(int d=0; d<3; ++d)
+	{
+	    m_position[d].offset = 4 * d;
+	    m_position[d].type = PROPERTY_INT32;
+	    m_position[d].scale = internal::load_unaligned<double>(header + 131 + 8 * d, swap);
+	    m_position[d].shift = internal::load_unaligned<double>(header + 155 + 8 * d, swap);
+	}
+	return true;
+}
+
+bool PointCloudFile::check_size()
+{
+	const auto inside = [this](const PointCloudProperty& p)
+	{
+	    return !p.valid() || std::size_t(p.offset + PointCloudProperty::size(p.type)) <= m_stride;
+	};
+	bool ok = m_stride > 0 && m_data_offset <= m_file.size() && m_count <= (m_file.size() - m_data_offset) / m_stride;
+	for(int d=0; d<3; ++d)
+	    ok = ok && inside(m_position[d]) && inside(m_normal[d]);
+	if(!ok)
+	    close();
+	return ok;
+}
+
+template<typename VectorType>
+VectorType PointCloudFile::read_vector(const PointCloudProperty* properties, std::size_t i) const
+{
+	typedef typename VectorType::Scalar Scalar;
+	const char* r = record(i);
+	return VectorType(Scalar(properties[0].read(r, m_swap)),
+	                  Scalar(properties[1].read(r, m_swap)),
+	                  Scalar(properties[2].read(r, m_swap)));
+}
+
+template<typename Scalar>
+void PointCloudFile::read_positions(Scalar* xyz) const
+{
+	typedef Eigen::Matrix<Scalar, 3, 1> VectorType;
+	const std::ptrdiff_t count = std::ptrdiff_t(m_count);
+#pragma omp parallel for
+	for(std::ptrdiff_t i=0; i<count; ++i)
+	    Eigen::Map<VectorType>(xyz + 3 * i) = read_vector<VectorType>(m_position, std::size_t(i));
+}
+
+template<typename Scalar>
+void PointCloudFile::read_normals(Scalar* xyz) const
+{
+	typedef Eigen::Matrix<Scalar, 3, 1> VectorType;
+	if(!has_normals())
+	{
+	    std::fill(xyz, xyz + 3 * m_count, Scalar(0));
+	    return;
+	}
+	const std::ptrdiff_t count = std::ptrdiff_t(m_count);
+#pragma omp parallel for
+	for(std::ptrdiff_t i=0; i<count; ++i)
+	    Eigen::Map<VectorType>(xyz + 3 * i) = read_vector<VectorType>(m_normal, std::size_t(i));
+}
+
+template<class DataPoint>
+void PointCloudFile::read(DataPoint* points) const
+{
+	typedef typename DataPoint::VectorType VectorType;
+	static_assert(int(DataPoint::Dim) == 3, "Point cloud files store 3D points");
+
+	const std::ptrdiff_t count = std::ptrdiff_t(m_count);
+	const bool normals = has_normals();
+#pragma omp parallel for
+	for(std::ptrdiff_t i=0; i<count; ++i)
+	{
+	    const VectorType pos = read_vector<VectorType>(m_position, std::size_t(i));
+	    if constexpr (std::is_constructible<DataPoint, VectorType, VectorType>::value)
+	    {
+	        if(normals)
+	        {
+	            points[i] = DataPoint(pos, read_vector<VectorType>(m_normal, std::size_t(i)));
+	            continue;
+	        }
+	    }
+	    points[i] = DataPoint(pos);
+	}
+}
+
+template<class DataPoint>
+const DataPoint* PointCloudFile::view() const
+{
+	if(m_format != POINT_CLOUD_RAW || m_stride != sizeof(DataPoint) || m_file.data() == nullptr ||
+	   reinterpret_cast<std::uintptr_t>(record(0)) % alignof(DataPoint) != 0)
+	    return nullptr;
+	return reinterpret_cast<const DataPoint*>(record(0));
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+// Opt-in tracing of the batch pipelines: KdTree build phases, batch queries, batch fits, out-of-core tiles and
+// GPU transfers. The markers compile to nothing unless one of the backends is selected before including Ponca:
+//  - PONCA_TRACING_TRACY: Tracy zones, the application linking the Tracy client (TRACY_ENABLE defined);
+//  - PONCA_TRACING_PERFETTO: Perfetto track events in the "ponca" category, which the application declares in
+//    its PERFETTO_DEFINE_CATEGORIES list, defines the storage of (PERFETTO_TRACK_EVENT_STATIC_STORAGE) and
+//    registers after perfetto::Tracing::Initialize.
+//
+// Zone names are string literals. A zone lasts until the end of the enclosing scope; in a parallel region, each
+// thread records its own zone, i.e. its chunk of the work.
+// Host code only: the markers must not appear in PONCA_MULTIARCH functions.
+
+#if defined(PONCA_TRACING_TRACY) && defined(PONCA_TRACING_PERFETTO)
+#  error "Select a single tracing backend: PONCA_TRACING_TRACY or PONCA_TRACING_PERFETTO"
+#endif
+
+#if defined(PONCA_TRACING_TRACY)
+
+#include <tracy/Tracy.hpp>
+
+#define PONCA_TRACE_ZONE(NAME)           ZoneScopedN(NAME)
+#define PONCA_TRACE_ZONE_VALUE(VALUE)    ZoneValue(static_cast<uint64_t>(VALUE))
+#define PONCA_TRACE_COUNTER(NAME, VALUE) TracyPlot(NAME, static_cast<int64_t>(VALUE))
+#define PONCA_TRACE_FRAME(NAME)          FrameMarkNamed(NAME)
+
+#elif defined(PONCA_TRACING_PERFETTO)
+
+#include <perfetto.h>
+
+#define PONCA_TRACE_ZONE(NAME)           TRACE_EVENT("ponca", NAME)
+#define PONCA_TRACE_ZONE_VALUE(VALUE)    TRACE_EVENT_INSTANT("ponca", "value", "value", static_cast<uint64_t>(VALUE))
+#define PONCA_TRACE_COUNTER(NAME, VALUE) TRACE_COUNTER("ponca", NAME, static_cast<int64_t>(VALUE))
+#define PONCA_TRACE_FRAME(NAME)          TRACE_EVENT_INSTANT("ponca", NAME)
+
+#else
+
+// default: no tracing, the arguments are not evaluated
+#define PONCA_TRACE_ZONE(NAME)
+#define PONCA_TRACE_ZONE_VALUE(VALUE)
+#define PONCA_TRACE_COUNTER(NAME, VALUE)
+#define PONCA_TRACE_FRAME(NAME)
+
+#endif
@@ -17,9 +17,20 @@
 ////////////////////////////////////////////////////////////////////////////////
 // Compatibility types, macros, functions
 //
-#ifdef __CUDACC__
+// GPU compilers, whose translation units take the device compatible code paths:
+//  - CUDA (nvcc, __CUDACC__) and HIP (hipcc, __HIPCC__): the functions called on the device are qualified by
+//    PONCA_MULTIARCH,
+//  - SYCL (SYCL_LANGUAGE_VERSION): the functions called by the kernels need no qualifier.
+#if defined(__CUDACC__) || defined(__HIPCC__) || defined(SYCL_LANGUAGE_VERSION)
+# define PONCA_GPU_COMPILER
+#endif
+
+#if defined(__CUDACC__)
 # include <cuda.h>
 # define PONCA_MULTIARCH __host__ __device__
+#elif defined(__HIPCC__)
+# include <hip/hip_runtime.h>
+# define PONCA_MULTIARCH __host__ __device__
 #else
 # define PONCA_MULTIARCH
 
@@ -30,12 +41,24 @@
 #   endif
 # endif
 
-#endif // ifdef __CUDACC__
+#endif // GPU compilers
 
-#ifdef __CUDA_ARCH__
+// Device compilation passes: the math functions are the global overloads of CUDA and HIP, and the standard ones
+// of SYCL
+#if defined(__CUDA_ARCH__) || defined(__HIP_DEVICE_COMPILE__)
   #define PONCA_MULTIARCH_INCLUDE_STD(FILENAME) "defines.h"
   #define PONCA_MULTIARCH_STD_MATH(FUNC)
+  #define PONCA_GPU_ARCH
+# ifdef __CUDA_ARCH__
   #define PONCA_CUDA_ARCH
+# else
+  #define PONCA_HIP_ARCH
+# endif
+#elif defined(__SYCL_DEVICE_ONLY__)
+  #define PONCA_MULTIARCH_INCLUDE_STD(FILENAME) <FILENAME>
+  #define PONCA_MULTIARCH_STD_MATH(FUNC) using std::FUNC;
+  #define PONCA_GPU_ARCH
+  #define PONCA_SYCL_ARCH
 #else
   #define PONCA_MULTIARCH_INCLUDE_STD(FILENAME) <FILENAME>
   #define PONCA_MULTIARCH_STD_MATH(FUNC) using std::FUNC;
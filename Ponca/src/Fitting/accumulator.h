@@ -0,0 +1,113 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+
+#include <type_traits>
+
+namespace Ponca
+{
+namespace internal
+{
+
+/*!
+    \brief Scalar type of the sums accumulated by the fitting procedures over the neighbors
+
+    Defaults to `DataPoint::Scalar`. A DataPoint defining the optional type `AccumulatorScalar` has its neighbors
+    accumulated in this type, for instance to store the points in float and sum them in double: the weights and
+    relative positions are still computed in `DataPoint::Scalar`, and the primitive is computed from the sums in
+    `AccumulatorScalar` before being converted to `DataPoint::Scalar`.
+
+    Supported by OrientedSphereFit and CovariancePlaneFit.
+
+    \ingroup fitting
+*/
+template < class DataPoint, typename = void >
+struct AccumulatorScalar
+{
+    typedef typename DataPoint::Scalar type;
+};
+
+template < class DataPoint >
+struct AccumulatorScalar<DataPoint, std::void_t<typename DataPoint::AccumulatorScalar> >
+{
+    typedef typename DataPoint::AccumulatorScalar type;
+};
+
+/*!
+    \brief Tells if the fitting procedures use compensated sums over the neighbors
+
+    False by default. A DataPoint defining the optional enum value `CompensatedSum` to a non-zero value has its neighbors
+    accumulated by Kahan summation (see SumCompensation): a cheaper alternative to AccumulatorScalar when the wider type
+    is slow, typically double on GPU.
+
+    Supported by OrientedSphereFit and CovariancePlaneFit.
+    \warning Compensated sums are optimized out by value-unsafe compiler optimizations (`-ffast-math`,
+    `-fassociative-math`). They are kept by `nvcc --use_fast_math`, which does not reassociate additions.
+
+    \ingroup fitting
+*/
+template < class DataPoint, typename = void >
+struct CompensatedSum : public std::false_type {};
+
+template < class DataPoint >
+struct CompensatedSum<DataPoint, std::void_t<decltype(DataPoint::CompensatedSum)> >
+    : public std::integral_constant<bool, bool(DataPoint::CompensatedSum)> {};
+
+/*!
+    \brief Compensation term of a sum of values of type `T`, a scalar or a fixed-size Eigen matrix
+
+    The sum itself is stored by the caller, which remains a valid approximation of the sum between the additions.
+    When `Enabled`, add() performs a Kahan summation, keeping the rounding error of the sum, otherwise it adds the value.
+
+    \ingroup fitting
+*/
+template < typename T, bool Enabled >
+class SumCompensation
+{
+public:
+    /*! \brief Reset the compensation term, when the sum is set to zero */
+    PONCA_MULTIARCH inline void reset()
+    {
+        if constexpr (std::is_arithmetic<T>::value)
+            m_c = T(0);
+        else
+            m_c.setZero();
+    }
+
+    /*! \brief Add `_v` to `_sum` */
+    PONCA_MULTIARCH inline void add(T& _sum, const T& _v)
+    {
+        const T y = _v - m_c;
+        const T t = _sum + y;
+        m_c = (t - _sum) - y;
+        _sum = t;
+    }
+
+    /*! \brief Add `_otherSum`, compensated by `_other`, to `_sum` */
+    PONCA_MULTIARCH inline void merge(T& _sum, const T& _otherSum, const SumCompensation& _other)
+    {
+        add(_sum, _otherSum);
+        add(_sum, T(-_other.m_c));
+    }
+
+private:
+    T m_c; /*!< \brief Rounding error of the sum, to subtract from the next value */
+};
+
+template < typename T >
+class SumCompensation<T, false>
+{
+public:
+    PONCA_MULTIARCH inline void reset() {}
+    PONCA_MULTIARCH inline void add(T& _sum, const T& _v) { _sum += _v; }
+    PONCA_MULTIARCH inline void merge(T& _sum, const T& _otherSum, const SumCompensation&) { _sum += _otherSum; }
+};
+
+} //namespace internal
+} //namespace Ponca
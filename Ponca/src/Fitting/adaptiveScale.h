@@ -0,0 +1,152 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+#include "computeAll.h"
+#include "scaleSweep.h"
+#include "../Common/Tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace Ponca
+{
+
+/*!
+    \brief Estimate the scale of each point from the distance to its `k`-th nearest neighbor
+
+    `scales[i]` is set to `factor` times the distance of the point `i` to its `k`-th nearest neighbor, the point
+    itself excluded, for all the `tree.point_count()` points: the scales follow the local density of the points,
+    small in dense regions and large in sparse ones. The neighbors are computed by the batched query
+    `tree.k_nearest_neighbors_batch(k, indices, squared_distances)`, in parallel.
+
+    \code
+    std::vector<Scalar> scales;
+    computeKnnScales(tree, 16, Scalar(1.5), scales);
+    computeAllAdaptive<Fit>(tree, scales, [&](int i, const Fit& fit, FIT_RESULT res) { ... });
+    \endcode
+
+    \param k Number of neighbors, clamped to the number of other points indexed by the tree
+    \param factor Ratio between the scale and the distance to the `k`-th neighbor
+    \ingroup fitting
+*/
+template <typename TreeT, typename Scalar>
+inline void computeKnnScales(const TreeT& tree, int k, Scalar factor, std::vector<Scalar>& scales)
+{
+    PONCA_TRACE_ZONE("ponca::computeKnnScales");
+    const int count = tree.point_count();
+    k = std::min(k, tree.index_count() - 1);
+    scales.assign(count, Scalar(0));
+    if (k <= 0)
+        return;
+
+    std::vector<int> indices(std::size_t(count) * k);
+    std::vector<typename TreeT::Scalar> squaredDistances(std::size_t(count) * k);
+    tree.k_nearest_neighbors_batch(k, indices.data(), squaredDistances.data());
+
+#pragma omp parallel for
+    for (int i = 0; i < count; ++i)
+        scales[i] = factor * Scalar(std::sqrt(squaredDistances[std::size_t(i) * k + k - 1]));
+}
+
+/*! \brief Score of the scale selection: the fitness of GLSParam, the highest being selected */
+struct ScaleSelectionFitness
+{
+    template <typename Fit>
+    inline typename Fit::Scalar operator()(const Fit& _fit) const { return _fit.fitness(); }
+};
+
+/*! \brief Score of the scale selection: the geometric variation of GLSGeomVar, the lowest being selected */
+struct ScaleSelectionGeomVar
+{
+    template <typename Fit>
+    inline typename Fit::Scalar operator()(const Fit& _fit) const { return -_fit.geomVar(); }
+};
+
+/*!
+    \brief Fit each point indexed by `tree` at a sweep of scales around its own scale, and keep the best fit
+
+    The point `i` is fitted at the scales `scales[i] * multipliers[m]` over the neighbors within the largest scale
+    collected by a single range query and sorted by distance once: by computeScaleSweep when it supports
+    `Fit`, e.g. OrientedSphereFit with a constant or SmoothWeightKernel, and from scratch at each scale otherwise. The stable fit of highest `score(fit)` is given
+    to `output(i, fit, res, scale)`, along with its scale; when no fit is stable, the fit of the largest scale is
+    given. `output` is called concurrently from several threads, for distinct `i`.
+
+    \code
+    typedef Basket<Point, WeightFunc, OrientedSphereFit, GLSParam> Fit;
+    computeScaleSelection<Fit>(tree, scales, std::vector<Scalar>{0.5, 1, 2}, ScaleSelectionFitness(),
+        [&](int i, const Fit& fit, FIT_RESULT res, Scalar t) { selected[i] = t; });
+    \endcode
+
+    \tparam Fit Fitting procedure, e.g. a Basket, whose weight function has a compact support (DistWeightFunc)
+    \param scales Random access container of the `tree.point_count()` base scales, e.g. from computeKnnScales
+    \param multipliers Random access container of increasing positive factors applied to the base scales
+    \param score Functor returning the score of a fit, e.g. ScaleSelectionFitness or ScaleSelectionGeomVar
+    \ingroup fitting
+*/
+template <typename Fit, typename TreeT, typename ScaleContainer, typename MultiplierContainer,
+          typename ScoreFunctor, typename OutputFunctor>
+inline void computeScaleSelection(const TreeT& tree, const ScaleContainer& scales,
+                                  const MultiplierContainer& multipliers, ScoreFunctor score, OutputFunctor output)
+{
+    using Scalar    = typename Fit::Scalar;
+    using DataPoint = typename Fit::DataPoint;
+
+    PONCA_TRACE_ZONE("ponca::computeScaleSelection");
+    const int count      = tree.index_count();
+    const int* indices   = tree.index_buffer();
+    const int sweepCount = int(multipliers.size());
+    if (count == 0 || sweepCount == 0)
+        return;
+    const Scalar largest = Scalar(multipliers[sweepCount - 1]);
+
+#pragma omp parallel
+    {
+        auto query = tree.range_neighbors(tree.point(indices[0]).pos(), Scalar(scales[indices[0]]) * largest);
+        std::vector<DataPoint> neighbors;
+        std::vector<Scalar> sweep(sweepCount);
+
+#pragma omp for schedule(dynamic, 16)
+        for (int k = 0; k < count; ++k)
+        {
+            const int i = indices[k];
+            const auto& pos = tree.point(i).pos();
+            for (int m = 0; m < sweepCount; ++m)
+                sweep[m] = Scalar(scales[i]) * Scalar(multipliers[m]);
+
+            neighbors.clear();
+            for (int j : query(pos, sweep[sweepCount - 1]))
+                neighbors.push_back(tree.point(j));
+
+            Fit best;
+            FIT_RESULT bestRes = UNDEFINED;
+            Scalar bestScale = sweep[sweepCount - 1], bestScore = -std::numeric_limits<Scalar>::infinity();
+            internal::computeScales<Fit>(pos, neighbors.cbegin(), neighbors.cend(), sweep,
+                [&](int m, const Fit& fit, FIT_RESULT res)
+                {
+                    const bool stable = res == STABLE;
+                    const Scalar s = stable ? Scalar(score(fit)) : -std::numeric_limits<Scalar>::infinity();
+                    // the last scale is kept when no fit is stable
+                    if ((stable && (bestRes != STABLE || s > bestScore)) || (bestRes != STABLE && m == sweepCount - 1))
+                    {
+                        best = fit;
+                        bestRes = res;
+                        bestScale = sweep[m];
+                        bestScore = s;
+                    }
+                });
+
+            output(i, best, bestRes, bestScale);
+        }
+    }
+}
+
+} // namespace Ponca
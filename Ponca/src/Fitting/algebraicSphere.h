@@ -66,6 +66,8 @@ public:
     typedef typename DataPoint::VectorType VectorType;
     /*! \brief Weight Function */
     typedef _WFunctor                      WFunctor;
+    /*! \brief Number of queries evaluated at once by the batch methods */
+    enum { BatchSize = 16 };
 
 private:
 
@@ -183,7 +185,7 @@ public:
         if(isPlane())
         {
             //return infinity (non-sense value)
-#ifdef __CUDACC__
+#ifdef PONCA_GPU_COMPILER
             Scalar inf = 0.;
             return Scalar(1.)/inf;
 #else
@@ -246,6 +248,21 @@ public:
     /*! \brief Approximation of the scalar field gradient at the evaluation point */
     PONCA_MULTIARCH inline VectorType primitiveGradient () const { return m_ul.normalized(); }
 
+    /*!
+       \brief Project the `_n` points of `_in` on the algebraic hypersphere, writing the projections in `_out`
+
+        Same as calling #project on each point. On CPU, the points are loaded by blocks of #BatchSize, stored by
+        coordinates (structure of arrays), and projected with vectorized operations. On GPU, each thread
+        projects its points one by one. `_in` and `_out` may be the same array.
+     */
+    PONCA_MULTIARCH inline void projectBatch (const VectorType* _in, VectorType* _out, int _n) const;
+
+    /*! \brief Value of the scalar field at the `_n` points of `_in`, written in `_out` \see projectBatch */
+    PONCA_MULTIARCH inline void potentialBatch (const VectorType* _in, Scalar* _out, int _n) const;
+
+    /*! \brief Scalar field gradient (not normalized) at the `_n` points of `_in`, written in `_out` \see projectBatch */
+    PONCA_MULTIARCH inline void primitiveGradientBatch (const VectorType* _in, VectorType* _out, int _n) const;
+
     /*!
         \brief Used to know if the fitting result to a plane
         \return true if finalize() have been called and the fitting result to a plane
@@ -260,6 +277,23 @@ public:
         return bReady && bPlanar;
     }
 
+#ifndef PONCA_GPU_COMPILER
+private:
+    /*! \brief Block of queries in the centered basis, one coordinate per column */
+    typedef Eigen::Array<Scalar, BatchSize, DataPoint::Dim> QueryBlock;
+    /*! \brief Block of scalar values, one per query */
+    typedef Eigen::Array<Scalar, BatchSize, 1>              ScalarBlock;
+
+    /*! \brief Load #BatchSize queries starting at `_in` in the centered basis */
+    inline void loadQueries (const VectorType* _in, QueryBlock& _lq) const;
+
+    /*! \brief Value of the scalar field at the queries `_lq` */
+    inline ScalarBlock potentialBlock (const QueryBlock& _lq) const;
+
+    /*! \brief Scalar field gradient at the queries `_lq` */
+    inline QueryBlock gradientBlock (const QueryBlock& _lq) const;
+#endif
+
 }; //class AlgebraicSphere
 
 #include "algebraicSphere.hpp"
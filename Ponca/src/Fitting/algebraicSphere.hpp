@@ -76,3 +76,103 @@ AlgebraicSphere<DataPoint, _WFunctor, T>::primitiveGradient( const VectorType &_
         return (m_ul + Scalar(2.f) * m_uq * lq);
 }
 
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+AlgebraicSphere<DataPoint, _WFunctor, T>::projectBatch( const VectorType* _in, VectorType* _out, int _n ) const
+{
+    int i = 0;
+#ifndef PONCA_GPU_COMPILER
+    const bool plane = isPlane();
+    for (; i + BatchSize <= _n; i += BatchSize)
+    {
+        QueryBlock lq;
+        loadQueries(_in + i, lq);
+
+        const ScalarBlock potential = potentialBlock(lq);
+        const QueryBlock  grad      = gradientBlock(lq);
+        const ScalarBlock norm2     = grad.square().rowwise().sum();
+        const ScalarBlock norm      = norm2.sqrt();
+
+        ScalarBlock t;
+        if(plane)
+            t = - potential / norm2;
+        else
+            t = - (norm - (norm2 - Scalar(4) * m_uq * potential).sqrt()) / (Scalar(2) * m_uq * norm);
+
+        const QueryBlock proj = lq + grad.colwise() * t;
+        for (int k = 0; k < BatchSize; ++k)
+            _out[i + k] = m_p + proj.row(k).transpose().matrix();
+    }
+#endif
+    for (; i < _n; ++i)
+        _out[i] = project(_in[i]);
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+AlgebraicSphere<DataPoint, _WFunctor, T>::potentialBatch( const VectorType* _in, Scalar* _out, int _n ) const
+{
+    int i = 0;
+#ifndef PONCA_GPU_COMPILER
+    for (; i + BatchSize <= _n; i += BatchSize)
+    {
+        QueryBlock lq;
+        loadQueries(_in + i, lq);
+        Eigen::Map<ScalarBlock>(_out + i) = potentialBlock(lq);
+    }
+#endif
+    for (; i < _n; ++i)
+        _out[i] = potential(_in[i]);
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+AlgebraicSphere<DataPoint, _WFunctor, T>::primitiveGradientBatch( const VectorType* _in, VectorType* _out, int _n ) const
+{
+    int i = 0;
+#ifndef PONCA_GPU_COMPILER
+    for (; i + BatchSize <= _n; i += BatchSize)
+    {
+        QueryBlock lq;
+        loadQueries(_in + i, lq);
+        const QueryBlock grad = gradientBlock(lq);
+        for (int k = 0; k < BatchSize; ++k)
+            _out[i + k] = grad.row(k).transpose().matrix();
+    }
+#endif
+    for (; i < _n; ++i)
+        _out[i] = primitiveGradient(_in[i]);
+}
+
+#ifndef PONCA_GPU_COMPILER
+template < class DataPoint, class _WFunctor, typename T>
+void
+AlgebraicSphere<DataPoint, _WFunctor, T>::loadQueries( const VectorType* _in, QueryBlock& _lq ) const
+{
+    // turn to centered basis
+    for (int k = 0; k < BatchSize; ++k)
+        _lq.row(k) = (_in[k] - m_p).transpose().array();
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+typename AlgebraicSphere<DataPoint, _WFunctor, T>::ScalarBlock
+AlgebraicSphere<DataPoint, _WFunctor, T>::potentialBlock( const QueryBlock& _lq ) const
+{
+    // lane-wise dot products, avoiding a matrix-vector product
+    ScalarBlock res = ScalarBlock::Constant(m_uc);
+    for (int d = 0; d < DataPoint::Dim; ++d)
+        res += _lq.col(d) * (m_ul(d) + m_uq * _lq.col(d));
+    return res;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+typename AlgebraicSphere<DataPoint, _WFunctor, T>::QueryBlock
+AlgebraicSphere<DataPoint, _WFunctor, T>::gradientBlock( const QueryBlock& _lq ) const
+{
+    QueryBlock res;
+    for (int d = 0; d < DataPoint::Dim; ++d)
+        res.col(d) = m_ul(d) + Scalar(2) * m_uq * _lq.col(d);
+    return res;
+}
+#endif
@@ -10,6 +10,9 @@
 #include "enums.h"
 
 #include PONCA_MULTIARCH_INCLUDE_STD(iterator)
+#include PONCA_MULTIARCH_INCLUDE_STD(vector)
+
+#include <type_traits>
 
 namespace Ponca
 {
@@ -19,6 +22,86 @@ namespace internal
 {
     /*! \brief Internal class used to build the Basket structure */
     template <class, class, typename T> class Forward: public T {};
+
+    /*! \brief Class declaring the member function of type `M` */
+    template <typename M> struct MemberClass;
+
+    template <typename R, class C, typename... Args>
+    struct MemberClass<R (C::*)(Args...)> { typedef C type; };
+
+    /*!
+     * \brief Tells if `Fit` adds the neighbors in `[IteratorBegin, IteratorEnd)` with a block `addNeighbors`
+     *
+     * True when the `addNeighbors` method of `Fit` is declared by the same class as its `addNeighbor` method: the
+     * block method of a fitting procedure or extension calls the `addNeighbor` method of the lower levels of the
+     * Basket only, and would skip the extensions following it.
+     */
+    template <class Fit, typename IteratorBegin, typename IteratorEnd, typename = void>
+    struct HasBlockAddNeighbors : public std::false_type {};
+
+    template <class Fit, typename IteratorBegin, typename IteratorEnd>
+    struct HasBlockAddNeighbors<Fit, IteratorBegin, IteratorEnd,
+            std::void_t<decltype(&Fit::template addNeighbors<IteratorBegin, IteratorEnd>)> >
+        : public std::is_same<typename MemberClass<decltype(&Fit::addNeighbor)>::type,
+                              typename MemberClass<decltype(&Fit::template addNeighbors<IteratorBegin, IteratorEnd>)>::type> {};
+
+    /*! \brief Class declaring the `merge` method of `Fit`, void if there is none */
+    template <class Fit, typename = void>
+    struct MergeClass { typedef void type; };
+
+    template <class Fit>
+    struct MergeClass<Fit, std::void_t<decltype(&Fit::merge)> > { typedef typename MemberClass<decltype(&Fit::merge)>::type type; };
+
+    /*!
+     * \brief Tells if each level of the Basket `Fit` accumulating neighbors merges its own sums
+     *
+     * A fitting procedure or extension `Ext<P, W, T>` accumulates neighbors when it declares an `addNeighbor`
+     * method of its own, i.e. not inherited from `T`. Its `merge` method must then be declared by the same class.
+     */
+    template <class Fit>
+    struct MergesAllLevels : public std::true_type {};
+
+    template <class P, class W, typename T, template <class, class, typename> class Ext>
+    struct MergesAllLevels<Ext<P, W, T> > : public std::integral_constant<bool,
+        (std::is_base_of<typename MemberClass<decltype(&Ext<P, W, T>::addNeighbor)>::type, T>::value ||
+         std::is_same<typename MemberClass<decltype(&Ext<P, W, T>::addNeighbor)>::type,
+                      typename MergeClass<Ext<P, W, T> >::type>::value)
+        && MergesAllLevels<T>::value> {};
+
+    /*!
+     * \brief Tells if the fitting procedure of the Basket `Fit` is the only level accumulating neighbors
+     *
+     * True when no extension `Ext<P, W, T>` declares an `addNeighbor` method of its own, i.e. not inherited from
+     * `T`: the extensions then only read the results of the fitting procedure.
+     */
+    template <class Fit>
+    struct AccumulatesInProcedureOnly : public std::true_type {};
+
+    template <class P, class W, typename T, template <class, class, typename> class Ext>
+    struct AccumulatesInProcedureOnly<Ext<P, W, T> > : public std::integral_constant<bool,
+        std::is_void<T>::value ||
+        (std::is_base_of<typename MemberClass<decltype(&Ext<P, W, T>::addNeighbor)>::type, T>::value &&
+         AccumulatesInProcedureOnly<T>::value)> {};
+
+    /*!
+     * \brief Forward iterator over `get(k)` for consecutive positions `k`, e.g. the points of a list of neighbor
+     * indices, so that the drivers fit their neighborhoods with Basket::compute
+     */
+    template <typename Getter>
+    class IndexedIterator
+    {
+    public:
+        inline IndexedIterator(const Getter& get, std::size_t k) : m_get(get), m_k(k) {}
+
+        inline decltype(auto) operator *() const { return m_get(m_k); }
+        inline IndexedIterator& operator ++() { ++m_k; return *this; }
+        inline bool operator ==(const IndexedIterator& other) const { return m_k == other.m_k; }
+        inline bool operator !=(const IndexedIterator& other) const { return m_k != other.m_k; }
+
+    private:
+        Getter m_get;
+        std::size_t m_k;
+    };
 }
 
 
@@ -49,6 +132,8 @@ namespace internal
     class Basket
         : public Ext11<P,W, Ext10<P,W, Ext9<P,W, Ext8<P,W, Ext7<P,W, Ext6<P,W, Ext5<P,W, Ext4<P,W, Ext3<P,W, Ext2<P,W, Ext1<P,W, Ext0<P,W, Fit<P,W,void> > > > > > > > > > > > >
     {
+        typedef Ext11<P,W, Ext10<P,W, Ext9<P,W, Ext8<P,W, Ext7<P,W, Ext6<P,W, Ext5<P,W, Ext4<P,W, Ext3<P,W, Ext2<P,W, Ext1<P,W, Ext0<P,W, Fit<P,W,void> > > > > > > > > > > > > Base;
+
     public:
         typedef P DataPoint;
         typedef W WeightFunction;
@@ -57,12 +142,21 @@ namespace internal
          *
          * Add neighbors stored in a container using STL-like iterators, and
          * call finalize at the end.
+         *
+         * On CPU, the neighbors are added by the optional `addNeighbors` method of the last fitting procedure or
+         * extension of the Basket when it provides one (see Concept::FittingProcedureConcept::addNeighbors), and
+         * one by one otherwise.
          */
         template <typename IteratorBegin, typename IteratorEnd>
         PONCA_MULTIARCH inline
         FIT_RESULT compute(const IteratorBegin& begin, const IteratorEnd& end){
             FIT_RESULT res = UNDEFINED;
             do {
+#ifdef PONCA_CPU_ARCH
+                if constexpr (internal::HasBlockAddNeighbors<Basket, IteratorBegin, IteratorEnd>::value)
+                    this->addNeighbors(begin, end);
+                else
+#endif
                 for (auto it = begin; it != end; ++it){
                     this->addNeighbor(*it);
                 }
@@ -71,6 +165,146 @@ namespace internal
             return res;
         }
 
+#ifdef PONCA_CPU_ARCH
+        /*!
+         * \brief Same as #compute, replaying the neighbors used by the first pass in the following passes
+         *
+         * The neighbors used by the first pass (within the support of the weight function) are copied, along with
+         * their squared distance and weight, into a buffer local to the calling thread. The following passes, e.g.
+         * of MongePatch or ProjectedNormalCovarianceCurvature, replay this buffer instead of iterating again over
+         * `[begin, end)`, which saves a new traversal of a KdTree range query and the evaluations of the weight
+         * function. The buffer keeps its capacity from one call to the next.
+         *
+         * Gives the same fit as #compute as long as the passes keep the basis center and the weight function, as
+         * all the fitting procedures of Ponca.
+         *
+         * \warning Requires a weight function providing `setWeight` and `clearSquaredNorm`, as DistWeightFunc.
+         * CPU only.
+         */
+        template <typename IteratorBegin, typename IteratorEnd>
+        inline FIT_RESULT computeWithCache(const IteratorBegin& begin, const IteratorEnd& end){
+            typedef typename DataPoint::Scalar Scalar;
+            struct CachedNeighbor { DataPoint point; Scalar squaredDistance; Scalar weight; };
+            static thread_local std::vector<CachedNeighbor> cache;
+            cache.clear();
+
+            for (auto it = begin; it != end; ++it){
+                const DataPoint& nei = *it;
+                const typename DataPoint::VectorType q = nei.pos() - this->basisCenter();
+                const Scalar squaredDistance = q.squaredNorm();
+                this->m_w.setSquaredNorm(squaredDistance);
+                const Scalar w = this->m_w.w(q, nei);
+                if (addNeighborWithWeight(nei, squaredDistance, w))
+                    cache.push_back({nei, squaredDistance, w});
+            }
+            FIT_RESULT res = this->finalize();
+            while ( res == NEED_OTHER_PASS ){
+                for (const CachedNeighbor& c : cache)
+                    addNeighborWithWeight(c.point, c.squaredDistance, c.weight);
+                res = this->finalize();
+            }
+            return res;
+        }
+#endif
+
+        /*!
+         * \brief Add a neighbor whose squared distance to the evaluation position is already known
+         *
+         * The weight function uses `squaredDistance` instead of computing the norm of the neighbor coordinates,
+         * e.g. with the squared distances exposed by the KdTree range iterators. The distance must be measured
+         * from the current basis center, which is not true anymore for the passes following a re-centering.
+         *
+         * \warning Requires a weight function providing `setSquaredNorm` and `clearSquaredNorm`, as DistWeightFunc.
+         */
+        PONCA_MULTIARCH inline
+        bool addNeighborWithSquaredDistance(const DataPoint& nei, const typename DataPoint::Scalar& squaredDistance){
+            this->m_w.setSquaredNorm(squaredDistance);
+            const bool res = this->addNeighbor(nei);
+            this->m_w.clearSquaredNorm();
+            return res;
+        }
+
+        /*!
+         * \brief Add a neighbor whose squared distance and weight are already known
+         *
+         * Same as #addNeighborWithSquaredDistance, the weight function returning `weight` instead of evaluating
+         * its kernel, e.g. when the weight is shared by several fits (see BasketTuple).
+         *
+         * \warning Requires a weight function providing `setWeight` and `clearSquaredNorm`, as DistWeightFunc.
+         */
+        PONCA_MULTIARCH inline
+        bool addNeighborWithWeight(const DataPoint& nei, const typename DataPoint::Scalar& squaredDistance,
+                                   const typename DataPoint::Scalar& weight){
+            this->m_w.setWeight(squaredDistance, weight);
+            const bool res = this->addNeighbor(nei);
+            this->m_w.clearSquaredNorm();
+            return res;
+        }
+
+        /*!
+         * \brief Add the neighbors accumulated by `other`, as if they were added to this fit
+         *
+         * Allows to accumulate a large neighborhood in parallel: each thread adds a part of the neighbors to its
+         * own fit, initialized with the same weight function and evaluation position, and the partial fits are
+         * merged before finalize:
+         * \code
+         * Fit fit;
+         * fit.setWeightFunc(w);
+         * fit.init(p);
+         * #pragma omp parallel
+         * {
+         *     Fit partial = fit;
+         *     #pragma omp for nowait
+         *     for(int i = 0; i < n; ++i)
+         *         partial.addNeighbor(points[i]);
+         *     #pragma omp critical
+         *     fit.merge(partial);
+         * }
+         * fit.finalize();
+         * \endcode
+         * The sums being accumulated in a different order, the result may differ from the serial fit by rounding.
+         *
+         * \warning Provided by MeanPlaneFit, CovariancePlaneFit, OrientedSphereFit, UnorientedSphereFit, SphereFit
+         * and CovarianceLineFit, and by the extensions accumulating sums of their own in a single pass:
+         * OrientedSphereDer, CovariancePlaneDer, MlsSphereFitDer, NormalCovarianceCurvature and
+         * MongePatchSinglePass. The other extensions accumulating neighbors, e.g. the multi-pass MongePatch and
+         * ProjectedNormalCovarianceCurvature, IrlsReweighting or FitProfiling, are rejected at compile time.
+         */
+        PONCA_MULTIARCH inline void merge(const Basket& other){
+            static_assert(internal::MergesAllLevels<Base>::value,
+                          "Each fitting procedure or extension accumulating neighbors must merge its own sums");
+            Base::merge(other);
+        }
+
+        /*!
+         * \brief Remove a neighbor previously added with the same evaluation position, returns true if it was used
+         *
+         * \warning Provided by MeanPlaneFit, CovariancePlaneFit and OrientedSphereFit, which update their own sums
+         * only: Baskets with extensions accumulating neighbors, e.g. the derivatives, are rejected at compile time.
+         * A template, so that it is instantiated only when called, e.g. not for the fitting procedures lacking
+         * it when the Basket is explicitly instantiated.
+         * \see OrientedSphereFit::removeNeighbor
+         */
+        template <typename B = Base>
+        PONCA_MULTIARCH inline bool removeNeighbor(const DataPoint& nei){
+            static_assert(internal::AccumulatesInProcedureOnly<B>::value,
+                          "removeNeighbor does not update the sums accumulated by the extensions");
+            return B::removeNeighbor(nei);
+        }
+
+        /*!
+         * \brief Move the evaluation position, expressing the accumulated sums relatively to `evalPos`
+         *
+         * \warning Same restrictions as #removeNeighbor.
+         * \see OrientedSphereFit::moveEvalPos
+         */
+        template <typename B = Base>
+        PONCA_MULTIARCH inline void moveEvalPos(const typename DataPoint::VectorType& evalPos){
+            static_assert(internal::AccumulatesInProcedureOnly<B>::value,
+                          "moveEvalPos does not update the sums accumulated by the extensions");
+            B::moveEvalPos(evalPos);
+        }
+
 #ifndef PONCA_CPU_ARCH
         /*!
          * \brief Convenience function for STL-like containers
@@ -0,0 +1,221 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+#include "basket.h"
+#include "covariancePlaneFit.h"
+#include "../Common/Tracing.h"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+/// Number of fits accumulated at once by computeBatch and computeLineFitBatch
+#ifndef PONCA_FIT_BATCH_WIDTH
+#define PONCA_FIT_BATCH_WIDTH 8
+#endif
+
+namespace Ponca
+{
+
+namespace internal
+{
+    /*!
+     * \brief Tells if computeBatch accumulates the fits of type `FitT` by lanes
+     *
+     * True for the Baskets whose only level accumulating neighbors is CovariancePlaneFit, e.g. with GLSParam or
+     * without extension, and whose sums are not compensated (see internal::CompensatedSum).
+     */
+    template <class FitT, typename = void>
+    struct IsCovariancePlaneBatch : public std::false_type {};
+
+    template <class FitT>
+    struct IsCovariancePlaneBatch<FitT, std::void_t<decltype(&FitT::addNeighbor), typename FitT::DataPoint,
+                                                    typename FitT::WFunctor> >
+        : public std::integral_constant<bool,
+            std::is_same<typename MemberClass<decltype(&FitT::addNeighbor)>::type,
+                         CovariancePlaneFit<typename FitT::DataPoint, typename FitT::WFunctor, void> >::value &&
+            !CompensatedSum<typename FitT::DataPoint>::value> {};
+
+    /*!
+     * \brief Path of computeBatch for the CovariancePlaneFit Baskets, see IsCovariancePlaneBatch
+     *
+     * The fits are processed by groups of `Width`: the k-th neighbors of the fits of a group are gathered by
+     * coordinates (structure of arrays), one lane per fit, and the sums \f$ \sum w \f$, \f$ \sum w q \f$ and
+     * \f$ \sum w q q^T \f$ are accumulated for all the lanes at once with vectorized products, as in
+     * computeLineFitBatch. Each fit then gets the sums of its lane by CovariancePlaneFit::addSums before finalize.
+     */
+    template <typename FitT, int Width, typename PointContainer, typename OffsetContainer, typename IndexContainer,
+              typename InitFunctor, typename ResultFunctor>
+    inline void computeCovariancePlaneBatch(int count, const PointContainer& points, const OffsetContainer& offsets,
+                                            const IndexContainer& neighbors, InitFunctor& init, ResultFunctor& result)
+    {
+        typedef typename FitT::DataPoint     DataPoint;
+        typedef typename DataPoint::Scalar   Scalar;
+        typedef typename DataPoint::VectorType VectorType;
+        typedef typename FitT::AccScalar     AccScalar;
+        typedef typename FitT::AccVectorType AccVectorType;
+        typedef typename FitT::AccMatrixType AccMatrixType;
+        constexpr int Dim = DataPoint::Dim;
+        // sums of the lanes by column: weight, weighted positions, then the upper triangle of the covariance
+        typedef Eigen::Array<AccScalar, Width, 1 + Dim + Dim * (Dim + 1) / 2> LaneSums;
+        typedef Eigen::Array<AccScalar, Width, Dim> LaneBlock;
+        typedef Eigen::Array<AccScalar, Width, 1> LaneWeights;
+        static_assert(Width > 0, "At least one fit must be processed at once");
+
+        const int groupCount = (count + Width - 1) / Width;
+
+#pragma omp parallel for schedule(dynamic)
+        for (int g = 0; g < groupCount; ++g)
+        {
+            const int first = g * Width;
+            const int size  = std::min(Width, count - first);
+
+            FitT fits[Width];
+            int added[Width] = {};
+            std::size_t longest = 0;
+            for (int l = 0; l < size; ++l)
+            {
+                init(first + l, fits[l]);
+                longest = std::max(longest, std::size_t(offsets[first + l + 1] - offsets[first + l]));
+            }
+
+            // the lanes without k-th neighbor, or whose neighbor is out of the support, add zeros
+            LaneSums sums = LaneSums::Zero();
+            LaneBlock block;
+            LaneWeights weights;
+            for (std::size_t k = 0; k < longest; ++k)
+            {
+                for (int l = 0; l < Width; ++l)
+                {
+                    const std::size_t j = l < size ? std::size_t(offsets[first + l]) + k : 0;
+                    Scalar w = Scalar(0);
+                    if (l < size && j < std::size_t(offsets[first + l + 1]))
+                    {
+                        const DataPoint& nei = points[neighbors[j]];
+                        const VectorType q = nei.pos() - fits[l].basisCenter();
+                        w = fits[l].getWeightFunc().w(q, nei);
+                        if (w > Scalar(0))
+                        {
+                            block.row(l) = q.transpose().template cast<AccScalar>();
+                            ++added[l];
+                        }
+                    }
+                    if (!(w > Scalar(0)))
+                    {
+                        w = Scalar(0);
+                        block.row(l).setZero();
+                    }
+                    weights(l) = AccScalar(w);
+                }
+                sums.col(0) += weights;
+                for (int i = 0, c = 1 + Dim; i < Dim; ++i)
+                {
+                    const LaneWeights wq = weights * block.col(i);
+                    sums.col(1 + i) += wq;
+                    for (int j = i; j < Dim; ++j, ++c)
+                        sums.col(c) += wq * block.col(j);
+                }
+            }
+
+            for (int l = 0; l < size; ++l)
+            {
+                const int i = first + l;
+                AccVectorType sumWq = sums.row(l).template segment<Dim>(1).transpose();
+                AccMatrixType sumWqq;
+                for (int a = 0, c = 1 + Dim; a < Dim; ++a)
+                    for (int b = a; b < Dim; ++b, ++c)
+                        sumWqq(a, b) = sumWqq(b, a) = sums(l, c);
+                fits[l].addSums(sums(l, 0), sumWq, sumWqq, added[l]);
+
+                FIT_RESULT res = fits[l].finalize();
+                // the following passes, if any, are run by Basket::compute
+                if (res == NEED_OTHER_PASS)
+                {
+                    const auto point = [&points, &neighbors](std::size_t j) -> decltype(auto) {
+                        return points[neighbors[j]];
+                    };
+                    res = fits[l].compute(IndexedIterator(point, std::size_t(offsets[i])),
+                                          IndexedIterator(point, std::size_t(offsets[i + 1])));
+                }
+                result(i, fits[l], res);
+            }
+        }
+    }
+}
+
+/*!
+    \brief Fit `count` neighborhoods given in compressed sparse row (CSR) format
+
+    The neighbors of the fit `i` are `points[neighbors[j]]` for `j` in `[offsets[i], offsets[i+1])`, e.g. the
+    output of KdTree::range_neighbors_batch. Each fit is set up by `init(i, fit)`, which must at least call
+    `setWeightFunc` and `init`, and its result is given to `result(i, fit, res)`.
+
+    The fits are distributed over the OpenMP threads by small chunks, so that consecutive fits, whose
+    neighborhoods overlap when the points are sorted as in the tree, run on the same thread. Each fit runs its
+    passes with Basket::compute over its neighbors, adding them by blocks when the fit provides `addNeighbors`:
+    the results are identical to fitting the neighborhoods one after the other.
+
+    The Baskets whose only level accumulating neighbors is CovariancePlaneFit (see
+    internal::IsCovariancePlaneBatch) are instead processed by groups of #PONCA_FIT_BATCH_WIDTH fits, their sums
+    being accumulated lane by lane with vectorized products (see internal::computeCovariancePlaneBatch). The
+    results then differ from the ones of Basket::compute by rounding only.
+
+    \code
+    std::vector<std::size_t> offsets;
+    std::vector<int> neighbors;
+    kdtree.range_neighbors_batch(scale, offsets, neighbors);
+    computeBatch<Fit>(kdtree.point_count(), points, offsets, neighbors,
+        [&](int i, Fit& fit) { fit.setWeightFunc(WeightFunc(scale)); fit.init(points[i].pos()); },
+        [&](int i, const Fit& fit, FIT_RESULT res) { if(res == STABLE) normals[i] = fit.primitiveGradient(); });
+    \endcode
+
+    \tparam FitT Fitting procedure, e.g. a Basket
+    \see computeLineFitBatch for line fits accumulated by groups with vectorized products
+    \ingroup fitting
+*/
+template <typename FitT, typename PointContainer, typename OffsetContainer, typename IndexContainer,
+          typename InitFunctor, typename ResultFunctor>
+inline void computeBatch(int count, const PointContainer& points, const OffsetContainer& offsets,
+                         const IndexContainer& neighbors, InitFunctor init, ResultFunctor result)
+{
+    PONCA_TRACE_ZONE("ponca::computeBatch");
+
+    if constexpr (internal::IsCovariancePlaneBatch<FitT>::value)
+    {
+        internal::computeCovariancePlaneBatch<FitT, PONCA_FIT_BATCH_WIDTH>(count, points, offsets, neighbors,
+                                                                           init, result);
+    }
+    else
+    {
+        // number of fits taken at once by a thread: small enough to balance uneven neighborhoods
+        constexpr int chunk = 16;
+#pragma omp parallel
+        {
+            PONCA_TRACE_ZONE("ponca::computeBatch chunk");
+
+#pragma omp for schedule(dynamic, chunk)
+            for (int i = 0; i < count; ++i)
+            {
+                FitT fit;
+                init(i, fit);
+                const auto point = [&points, &neighbors](std::size_t j) -> decltype(auto) {
+                    return points[neighbors[j]];
+                };
+                const FIT_RESULT res = fit.compute(internal::IndexedIterator(point, std::size_t(offsets[i])),
+                                                   internal::IndexedIterator(point, std::size_t(offsets[i + 1])));
+                result(i, fit, res);
+            }
+        }
+    }
+}
+
+} // namespace Ponca
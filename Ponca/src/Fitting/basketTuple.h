@@ -0,0 +1,312 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+#include "basket.h"
+
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+
+namespace Ponca
+{
+
+namespace internal
+{
+    /*! \brief Internal class applying a functor to each fit of a BasketTuple, from the `I`-th one */
+    template <int I, int N>
+    struct BasketTupleLoop
+    {
+        template <typename Tuple, typename Functor>
+        static inline void run(Tuple& fits, Functor& f)
+        {
+            f(std::get<I>(fits), I);
+            BasketTupleLoop<I + 1, N>::run(fits, f);
+        }
+    };
+
+    template <int N>
+    struct BasketTupleLoop<N, N>
+    {
+        template <typename Tuple, typename Functor>
+        static inline void run(Tuple&, Functor&) {}
+    };
+} // namespace internal
+
+/*!
+    \brief Several fits computed at once over the same neighborhood
+
+    Each neighbor added to the tuple is given to all its fits, in a single traversal of the neighborhood. During
+    the first pass, the weight of the neighbor is evaluated once by the tuple and shared by the fits through
+    Basket::addNeighborWithWeight, instead of being evaluated by each fit. The neighbors of null weight are not
+    given to the fits. The following passes only feed the fits needing them, which evaluate their own weights
+    since they may have moved their basis center.
+
+    In compute, the fits providing a block `addNeighbors` (see Basket::compute) add the whole neighborhood with
+    it instead, evaluating their own weights: each fit gives the same result as its own Basket::compute.
+
+    \code
+        typedef BasketTuple<Basket<Point, WeightFunc, CovariancePlaneFit>,
+                            Basket<Point, WeightFunc, OrientedSphereFit>,
+                            Basket<Point, WeightFunc, CovariancePlaneFit, NormalCovarianceCurvature> > Fits;
+        Fits fits;
+        fits.setWeightFunc(WeightFunc(scale));
+        fits.init(p);
+        fits.compute(neighbors);
+        if(fits.result<1>() == STABLE) sphere = fits.get<1>();
+    \endcode
+
+    \tparam Fits Baskets sharing the same DataPoint and weight function type, which must provide `setWeight`
+    and `clearSquaredNorm` as DistWeightFunc
+    \warning The fits results are given by result(): the result of finalize() is the least reliable of them.
+    \ingroup fitting
+*/
+template <typename... Fits>
+class BasketTuple
+{
+    static_assert(sizeof...(Fits) > 0, "A BasketTuple holds at least one fit");
+
+public:
+    /*! \brief Type of the `I`-th fit */
+    template <int I>
+    using FitType = typename std::tuple_element<I, std::tuple<Fits...> >::type;
+
+    typedef typename FitType<0>::DataPoint DataPoint;  /*!< \brief Point type shared by the fits */
+    typedef typename FitType<0>::WFunctor  WFunctor;   /*!< \brief Weight function type shared by the fits */
+    typedef typename DataPoint::Scalar     Scalar;     /*!< \brief Scalar type inherited from DataPoint */
+    typedef typename DataPoint::VectorType VectorType; /*!< \brief Vector type inherited from DataPoint */
+
+    /*! \brief Number of fits */
+    static constexpr int Size = int(sizeof...(Fits));
+
+private:
+    template <typename F>
+    struct SameTypes
+    {
+        static constexpr bool value = std::is_same<typename F::DataPoint, DataPoint>::value
+                                   && std::is_same<typename F::WFunctor, WFunctor>::value;
+    };
+
+    struct SetWeightFunc
+    {
+        const WFunctor& w;
+        template <typename F> inline void operator()(F& fit, int) const
+        {
+            static_assert(SameTypes<F>::value, "The fits of a BasketTuple must share DataPoint and WFunctor");
+            fit.setWeightFunc(w);
+        }
+    };
+
+    struct Init
+    {
+        const VectorType& evalPos;
+        template <typename F> inline void operator()(F& fit, int) const { fit.init(evalPos); }
+    };
+
+    /*! \brief Tells if the fit `F` adds the neighbors of `[IteratorBegin, IteratorEnd)` by blocks */
+    template <typename IteratorBegin, typename IteratorEnd>
+    struct ByBlocks
+    {
+        template <typename F>
+        static constexpr bool value = internal::HasBlockAddNeighbors<F, IteratorBegin, IteratorEnd>::value;
+    };
+
+    /*! \brief All the fits add the neighbors one by one */
+    struct OneByOne
+    {
+        template <typename F>
+        static constexpr bool value = false;
+    };
+
+    /*! \brief Add a neighbor to the fits not adding their neighbors by blocks, according to `Blocks` */
+    template <typename Blocks>
+    struct AddShared
+    {
+        const DataPoint& nei;
+        Scalar squaredDistance, weight;
+        bool added;
+        template <typename F> inline void operator()(F& fit, int)
+        {
+            if constexpr (!Blocks::template value<F>)
+                added = fit.addNeighborWithWeight(nei, squaredDistance, weight) || added;
+        }
+    };
+
+    template <typename Blocks>
+    struct AddPending
+    {
+        const DataPoint& nei;
+        const FIT_RESULT* results;
+        bool added;
+        template <typename F> inline void operator()(F& fit, int i)
+        {
+            if constexpr (!Blocks::template value<F>)
+                if (results[i] == NEED_OTHER_PASS)
+                    added = fit.addNeighbor(nei) || added;
+        }
+    };
+
+    /*! \brief Add `[begin, end)` to the fits running a pass and adding their neighbors by blocks */
+    template <typename IteratorBegin, typename IteratorEnd>
+    struct AddBlocks
+    {
+        const IteratorBegin& begin;
+        const IteratorEnd& end;
+        const FIT_RESULT* results;
+        bool pendingOneByOne;         /*!< \brief Tells if a fit adding its neighbors one by one runs a pass */
+        template <typename F> inline void operator()(F& fit, int i)
+        {
+            if (results[i] != NEED_OTHER_PASS)
+                return;
+            if constexpr (ByBlocks<IteratorBegin, IteratorEnd>::template value<F>)
+                fit.addNeighbors(begin, end);
+            else
+                pendingOneByOne = true;
+        }
+    };
+
+    struct Finalize
+    {
+        FIT_RESULT* results;
+        template <typename F> inline void operator()(F& fit, int i) const
+        {
+            if (results[i] == NEED_OTHER_PASS)
+                results[i] = fit.finalize();
+        }
+    };
+
+    template <typename Functor>
+    inline void forEach(Functor& f)
+    {
+        internal::BasketTupleLoop<0, Size>::run(m_fits, f);
+    }
+
+    /*! \brief Add a neighbor to the fits running a pass and not adding their neighbors by blocks */
+    template <typename Blocks>
+    inline bool addNeighborTo(const DataPoint& _nei)
+    {
+        if (m_firstPass)
+        {
+            // the fits are all centered on the evaluation position: one weight evaluation for all of them
+            const VectorType q = _nei.pos() - m_evalPos;
+            const Scalar squaredDistance = q.squaredNorm();
+            m_w.setSquaredNorm(squaredDistance);
+            const Scalar w = m_w.w(q, _nei);
+            m_w.clearSquaredNorm();
+            if (w <= Scalar(0.))
+                return false;
+
+            AddShared<Blocks> f {_nei, squaredDistance, w, false};
+            forEach(f);
+            return f.added;
+        }
+
+        AddPending<Blocks> f {_nei, m_results, false};
+        forEach(f);
+        return f.added;
+    }
+
+public:
+    /**************************************************************************/
+    /* Initialization                                                         */
+    /**************************************************************************/
+    /*! \brief Set the weight function of the tuple and of all its fits */
+    inline void setWeightFunc(const WFunctor& _w)
+    {
+        m_w = _w;
+        SetWeightFunc f {_w};
+        forEach(f);
+    }
+
+    /*! \brief Initialize all the fits at the evaluation position `_evalPos` */
+    inline void init(const VectorType& _evalPos)
+    {
+        m_evalPos   = _evalPos;
+        m_firstPass = true;
+        std::fill(m_results, m_results + Size, NEED_OTHER_PASS);
+        Init f {_evalPos};
+        forEach(f);
+    }
+
+    /**************************************************************************/
+    /* Processing                                                             */
+    /**************************************************************************/
+    /*! \brief Add a neighbor to the fits running a pass, returns true if at least one fit used it */
+    inline bool addNeighbor(const DataPoint& _nei)
+    {
+        return addNeighborTo<OneByOne>(_nei);
+    }
+
+    /*!
+        \brief Finalize the fits running a pass
+
+        \return #NEED_OTHER_PASS while at least one fit needs another pass, then the least reliable result of the
+        fits (see #FIT_RESULT)
+    */
+    inline FIT_RESULT finalize()
+    {
+        m_firstPass = false;
+        Finalize f {m_results};
+        forEach(f);
+
+        FIT_RESULT res = STABLE;
+        for (int i = 0; i < Size; ++i)
+            res = std::max(res, m_results[i]);
+        return res;
+    }
+
+    /*!
+        \brief Add the neighbors of `[begin, end)` to all the fits, until none of them needs another pass
+        \see Basket::compute
+    */
+    template <typename IteratorBegin, typename IteratorEnd>
+    inline FIT_RESULT compute(const IteratorBegin& begin, const IteratorEnd& end)
+    {
+        using Blocks = ByBlocks<IteratorBegin, IteratorEnd>;
+        FIT_RESULT res = UNDEFINED;
+        do {
+            AddBlocks<IteratorBegin, IteratorEnd> f {begin, end, m_results, false};
+            forEach(f);
+            if (f.pendingOneByOne)
+                for (auto it = begin; it != end; ++it)
+                    addNeighborTo<Blocks>(*it);
+            res = finalize();
+        } while (res == NEED_OTHER_PASS);
+        return res;
+    }
+
+    /*! \brief Convenience function for STL-like containers */
+    template <typename Container>
+    inline FIT_RESULT compute(const Container& c)
+    {
+        return compute(std::begin(c), std::end(c));
+    }
+
+    /**************************************************************************/
+    /* Use results                                                            */
+    /**************************************************************************/
+    /*! \brief Access to the `I`-th fit */
+    template <int I> inline FitType<I>& get() { return std::get<I>(m_fits); }
+
+    /*! \brief Access to the `I`-th fit */
+    template <int I> inline const FitType<I>& get() const { return std::get<I>(m_fits); }
+
+    /*! \brief State of the `I`-th fit, as returned by its last call to finalize */
+    template <int I> inline FIT_RESULT result() const { return m_results[I]; }
+
+private:
+    std::tuple<Fits...> m_fits;
+    WFunctor   m_w;                  /*!< \brief Weight function evaluated once per neighbor for all the fits */
+    VectorType m_evalPos;            /*!< \brief Evaluation position given to init */
+    FIT_RESULT m_results[Size];      /*!< \brief State of each fit, NEED_OTHER_PASS while it runs a pass */
+    bool       m_firstPass {true};   /*!< \brief Tell if the fits are running their first pass */
+};
+
+} // namespace Ponca
@@ -0,0 +1,120 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+#include "basket.h"
+#include "../Common/Tracing.h"
+
+#include <vector>
+
+namespace Ponca
+{
+
+namespace internal
+{
+    /*! \brief computeAll with the scale of the point `i` given by `scaleOf(i)` */
+    template <typename Fit, typename TreeT, typename ScaleFunctor, typename OutputFunctor>
+    inline void computeAllScaled(const TreeT& tree, ScaleFunctor scaleOf, OutputFunctor output)
+    {
+        using WeightFunc = typename Fit::WFunctor;
+
+        // number of points taken at once by a thread: small enough to balance uneven neighborhoods
+        constexpr int chunk = 16;
+
+        PONCA_TRACE_ZONE("ponca::computeAll");
+        const int count   = tree.index_count();
+        const int* indices = tree.index_buffer();
+        if (count == 0)
+            return;
+
+#pragma omp parallel
+        {
+            PONCA_TRACE_ZONE("ponca::computeAll chunk");
+            auto query = tree.range_neighbors(tree.point(indices[0]).pos(), scaleOf(indices[0]));
+            std::vector<int> neighbors;
+
+#pragma omp for schedule(dynamic, chunk)
+            for (int k = 0; k < count; ++k)
+            {
+                const int i = indices[k];
+                const auto& pos = tree.point(i).pos();
+                const auto scale = scaleOf(i);
+
+                Fit fit;
+                fit.setWeightFunc(WeightFunc(scale));
+                fit.init(pos);
+
+                // the tree is traversed once, the passes run over the stored neighbors
+                neighbors.clear();
+                for (int j : query(pos, scale))
+                    neighbors.push_back(j);
+                const auto point = [&tree, &neighbors](std::size_t n) -> decltype(auto) {
+                    return tree.point(neighbors[n]);
+                };
+                const FIT_RESULT res = fit.compute(internal::IndexedIterator(point, 0),
+                                                   internal::IndexedIterator(point, neighbors.size()));
+
+                output(i, fit, res);
+            }
+        }
+    }
+} // namespace internal
+
+/*!
+    \brief Fit the neighborhood of radius `scale` of each point indexed by `tree`, in parallel
+
+    For each point `i` indexed by the tree, the fit is initialized at the position of the point with the weight
+    function `Fit::WFunctor(scale)`, computed over the points returned by `tree.range_neighbors(pos, scale)`
+    (the point itself included), and given to `output(i, fit, res)`. `output` is called concurrently from
+    several threads, for distinct `i`.
+
+    The points are processed in the order of the tree indices, so that consecutive fits share most of their
+    neighbors in cache. Each OpenMP thread owns a range query, rebound from one point to the next, and a buffer
+    storing the neighbors, over which the fit runs its passes with Basket::compute (adding them by blocks when the
+    fit provides `addNeighbors`): the results are identical to Basket::compute over the range neighbors, and the
+    steady-state loop does not allocate.
+    The points are handed out by small chunks (`schedule(dynamic)`): a thread running dense neighborhoods does
+    not hold back the others, which keep taking the remaining chunks.
+
+    \code
+    computeAll<Fit>(kdtree, scale, [&](int i, const Fit& fit, FIT_RESULT res) {
+        if(res == STABLE) normals[i] = fit.primitiveGradient();
+    });
+    \endcode
+
+    \tparam Fit Fitting procedure, e.g. a Basket, whose weight function is constructible from `scale`
+    \tparam TreeT Spatial structure providing `index_count()`, `index_buffer()`, `point(i)` and
+    `range_neighbors(point, radius)` returning a query rebindable with `operator()(point, radius)`, e.g. KdTree
+    \see computeBatch to fit precomputed neighborhoods
+    \ingroup fitting
+*/
+template <typename Fit, typename TreeT, typename OutputFunctor>
+inline void computeAll(const TreeT& tree, typename Fit::Scalar scale, OutputFunctor output)
+{
+    internal::computeAllScaled<Fit>(tree, [scale](int) { return scale; }, output);
+}
+
+/*!
+    \brief Fit the neighborhood of each point indexed by `tree` with its own scale `scales[i]`, in parallel
+
+    Same as computeAll, the weight function and the range query of the point `i` using the scale `scales[i]`,
+    e.g. estimated from the density of the points by computeKnnScales.
+
+    \tparam ScaleContainer Random access container of `tree.point_count()` scales
+    \see computeScaleSelection to select the scale of each point among several ones
+    \ingroup fitting
+*/
+template <typename Fit, typename TreeT, typename ScaleContainer, typename OutputFunctor>
+inline void computeAllAdaptive(const TreeT& tree, const ScaleContainer& scales, OutputFunctor output)
+{
+    using Scalar = typename Fit::Scalar;
+    internal::computeAllScaled<Fit>(tree, [&scales](int i) { return Scalar(scales[i]); }, output);
+}
+
+} // namespace Ponca
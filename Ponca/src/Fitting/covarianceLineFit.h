@@ -8,12 +8,54 @@
 
 #pragma once
 #include "./defines.h"
+#include "./enums.h"
 
 #include <Eigen/Dense>
 
 namespace Ponca
 {
 
+namespace internal
+{
+    /*!
+        \brief Unit eigenvector of the largest eigenvalue of the symmetric positive semi-definite matrix `_m` in `_v`,
+        returns false when `_m` is null
+
+        The matrix is squared `_squarings` times, normalized at each step, and its column of largest diagonal
+        coefficient is multiplied by `_m`: the result is the power \f$ 2^{squarings}+1 \f$ of the matrix applied to
+        this column, whose error decreases as the ratio of the two largest eigenvalues to that power. A fixed number
+        of products of small matrices, cheaper than a complete decomposition when only the largest eigenvector is
+        needed, e.g. the direction of a line.
+    */
+    template <typename MatrixType, typename VectorType>
+    PONCA_MULTIARCH inline bool largestEigenvector(const MatrixType& _m, VectorType& _v, int _squarings = 6)
+    {
+        typedef typename MatrixType::Scalar Scalar;
+        typedef typename MatrixType::Index Index;
+
+        // the largest coefficient of a positive semi-definite matrix is on its diagonal
+        MatrixType p = _m;
+        for (int i = 0; i < _squarings; ++i)
+        {
+            const Scalar norm = p.diagonal().maxCoeff();
+            if (!(norm > Scalar(0)))
+                return false;
+            p /= norm;
+            p = (p * p).eval();
+        }
+
+        Index axis = 0;
+        if (!(p.diagonal().maxCoeff(&axis) > Scalar(0)))
+            return false;
+        _v = _m * p.col(axis);
+        const Scalar norm = _v.norm();
+        if (!(norm > Scalar(0)))
+            return false;
+        _v /= norm;
+        return true;
+    }
+} // namespace internal
+
 /*!
    \brief Line fitting procedure that minimize the orthogonal distance between the samples and the fitted primitive.
 
@@ -50,6 +92,11 @@ protected:
     MatrixType m_cov;     /*!< \brief Covariance matrix */
 
     Solver m_solver;  /*!<\brief Solver used to analyse the covariance matrix */
+#ifdef PONCA_GPU_COMPILER
+    COVARIANCE_SOLVER m_solverType {DIRECT_SOLVER};    /*!< \brief Decomposition of the covariance matrix */
+#else
+    COVARIANCE_SOLVER m_solverType {ITERATIVE_SOLVER}; /*!< \brief Decomposition of the covariance matrix */
+#endif
     WFunctor m_w;     /*!< \brief Weight function (must inherits BaseWeightFunc) */
 
 public:
@@ -68,17 +115,34 @@ public:
     /*! \copydoc Concept::FittingProcedureConcept::init() */
     PONCA_MULTIARCH inline void init (const VectorType& _evalPos);
 
+    /*!
+        \brief Set the decomposition of the covariance matrix used by finalize
+
+        Defaults to #ITERATIVE_SOLVER on CPU and #DIRECT_SOLVER on GPU, #SMALLEST_EIGENVECTOR_SOLVER is not supported.
+        #LARGEST_EIGENVECTOR_SOLVER computes only the direction of the line. Kept by init.
+    */
+    PONCA_MULTIARCH inline void setSolver(COVARIANCE_SOLVER _solver) { m_solverType = _solver; }
+
+    /*! \brief Decomposition of the covariance matrix used by finalize */
+    PONCA_MULTIARCH inline COVARIANCE_SOLVER solverType() const { return m_solverType; }
+
     /**************************************************************************/
     /* Processing                                                             */
     /**************************************************************************/
     /*! \copydoc Concept::FittingProcedureConcept::addNeighbor() */
     PONCA_MULTIARCH inline bool addNeighbor(const DataPoint &_nei);
 
+    /*!
+        \brief Add the neighbors accumulated by `_other`, as if they were added to this fit
+        \see Basket::merge
+    */
+    PONCA_MULTIARCH inline void merge(const CovarianceLineFit& _other);
+
     /*! \copydoc Concept::FittingProcedureConcept::finalize() */
     PONCA_MULTIARCH inline FIT_RESULT finalize();
 
     /*! \brief Reading access to the Solver used to analyse the covariance
-      matrix */
+      matrix, not computed by #LARGEST_EIGENVECTOR_SOLVER */
     PONCA_MULTIARCH inline const Solver& solver() const { return m_solver; }
   
 
@@ -35,6 +35,16 @@ CovarianceLineFit<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
     return true;  
 }
 
+template < class DataPoint, class _WFunctor, typename T>
+void
+CovarianceLineFit<DataPoint, _WFunctor, T>::merge(const CovarianceLineFit& _other)
+{
+    Base::merge(_other);
+    m_sum += _other.m_sum;
+    m_cog += _other.m_cog;
+    m_cov += _other.m_cov;
+}
+
 template < class DataPoint, class _WFunctor, typename T>
 FIT_RESULT
 CovarianceLineFit<DataPoint, _WFunctor, T>::finalize ()
@@ -54,9 +64,20 @@ CovarianceLineFit<DataPoint, _WFunctor, T>::finalize ()
     // Center the covariance on the centroid
     m_cov = m_cov/m_sum - m_cog * m_cog.transpose();
   
-    #ifdef __CUDACC__
+    if (m_solverType == LARGEST_EIGENVECTOR_SOLVER)
+    {
+        VectorType direction = VectorType::Zero();
+        Base::m_eCurrentState = ( internal::largestEigenvector(m_cov, direction) ? STABLE : UNDEFINED );
+        Base::setLine(m_cog, direction);
+        return Base::m_eCurrentState;
+    }
+
+    #ifdef PONCA_GPU_COMPILER
         m_solver.computeDirect(m_cov);
     #else
+    if (m_solverType == DIRECT_SOLVER)
+        m_solver.computeDirect(m_cov);
+    else
         m_solver.compute(m_cov);
     #endif
 
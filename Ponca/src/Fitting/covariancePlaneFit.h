@@ -10,8 +10,10 @@
 #pragma once
 
 #include "./plane.h"
+#include "./accumulator.h"
 
 #include <Eigen/Eigenvalues>
+#include <Eigen/Cholesky>
 
 namespace Ponca
 {
@@ -59,15 +61,38 @@ public:
     typedef _WFunctor                 WFunctor;
     /*! \brief Solver used to analyse the covariance matrix*/
     typedef Eigen::SelfAdjointEigenSolver<MatrixType> Solver;
+    /*! \brief Scalar type of the sums, see internal::AccumulatorScalar */
+    typedef typename internal::AccumulatorScalar<DataPoint>::type       AccScalar;
+    /*! \brief Vector type of the sums */
+    typedef Eigen::Matrix<AccScalar, DataPoint::Dim, 1>                 AccVectorType;
+    /*! \brief Matrix type of the sums */
+    typedef Eigen::Matrix<AccScalar, DataPoint::Dim, DataPoint::Dim>    AccMatrixType;
+    /*! \brief Number of neighbors accumulated at once by addNeighbors */
+    enum { BlockSize = 16 };
+    /*! \brief Block of neighbors stored by coordinates, one neighbor per row: relative position, then weight */
+    typedef Eigen::Matrix<AccScalar, BlockSize, DataPoint::Dim + 1>     NeighborBlock;
+    /*! \brief Sums of the blocks per row: weight, weighted positions, upper triangle of the covariance */
+    typedef Eigen::Array<AccScalar, BlockSize, 1 + DataPoint::Dim + DataPoint::Dim * (DataPoint::Dim + 1) / 2> BlockSums;
 
  protected:
 
     // computation data
-    Scalar  m_sumW;       /*!< \brief Sum of queries weight.*/
-    VectorType m_cog;     /*!< \brief Gravity center of the neighborhood */
-    MatrixType m_cov;     /*!< \brief Covariance matrix */
+    AccScalar  m_sumW;       /*!< \brief Sum of queries weight.*/
+    AccVectorType m_cog;     /*!< \brief Gravity center of the neighborhood */
+    AccMatrixType m_cov;     /*!< \brief Covariance matrix */
+
+    // compensation of the sums, see internal::CompensatedSum
+    static constexpr bool Compensated = internal::CompensatedSum<DataPoint>::value;
+    internal::SumCompensation<AccScalar, Compensated>     m_cSumW;
+    internal::SumCompensation<AccVectorType, Compensated> m_cCog;
+    internal::SumCompensation<AccMatrixType, Compensated> m_cCov;
 
     Solver m_solver;  /*!<\brief Solver used to analyse the covariance matrix */
+#ifdef PONCA_GPU_COMPILER
+    COVARIANCE_SOLVER m_solverType {DIRECT_SOLVER};    /*!< \brief Decomposition of the covariance matrix */
+#else
+    COVARIANCE_SOLVER m_solverType {ITERATIVE_SOLVER}; /*!< \brief Decomposition of the covariance matrix */
+#endif
 
     WFunctor m_w;     /*!< \brief Weight function (must inherits BaseWeightFunc) */
 
@@ -87,15 +112,89 @@ public:
     /*! \copydoc Concept::FittingProcedureConcept::setWeightFunc() */
     PONCA_MULTIARCH inline void setWeightFunc (const WFunctor& _w) { m_w  = _w; }
 
+    /*! \brief Weight function used to add the neighbors */
+    PONCA_MULTIARCH inline const WFunctor& getWeightFunc () const { return m_w; }
+
     /*! \copydoc Concept::FittingProcedureConcept::init() */
     PONCA_MULTIARCH inline void init (const VectorType& _evalPos);
 
+    /*!
+        \brief Set the decomposition of the covariance matrix used by finalize, see #COVARIANCE_SOLVER
+
+        Defaults to #ITERATIVE_SOLVER on CPU and #DIRECT_SOLVER on GPU. Kept by init.
+    */
+    PONCA_MULTIARCH inline void setSolver(COVARIANCE_SOLVER _solver) { m_solverType = _solver; }
+
+    /*! \brief Decomposition of the covariance matrix used by finalize */
+    PONCA_MULTIARCH inline COVARIANCE_SOLVER solverType() const { return m_solverType; }
+
     /**************************************************************************/
     /* Processing                                                             */
     /**************************************************************************/
     /*! \copydoc Concept::FittingProcedureConcept::addNeighbor() */
     PONCA_MULTIARCH inline bool addNeighbor(const DataPoint &_nei);
 
+    /*!
+        \brief Add the neighbors in `[_begin, _end)`, returns the number of neighbors used
+
+        Same as calling #addNeighbor on each neighbor, the neighbors used being gathered in a #NeighborBlock and
+        accumulated #BlockSize at a time with vectorized products. The sums are accumulated in a different order,
+        and may differ from the ones of #addNeighbor by rounding. With compensated sums (see
+        internal::CompensatedSum), the neighbors are added one by one.
+        \see Concept::FittingProcedureConcept::addNeighbors
+    */
+    template <typename IteratorBegin, typename IteratorEnd>
+    PONCA_MULTIARCH inline int addNeighbors(const IteratorBegin& _begin, const IteratorEnd& _end);
+
+    /*!
+        \brief Add the neighbors accumulated by `_other`, as if they were added to this fit
+        \see Basket::merge
+    */
+    PONCA_MULTIARCH inline void merge(const CovariancePlaneFit& _other);
+
+    /*!
+        \brief Add a group of neighbors at once from the sums of their positions and outer products, returns true
+        if they were used
+
+        `_moments` provides `count`, `centroid()`, `sum_positions_around(c)` and `sum_outer_products_around(c)`, as
+        OctreeCovarianceMoments. All the neighbors of the group get the weight of their centroid, computed with the
+        attributes of `_attributes`, e.g. one of the neighbors: the error on the sums is bounded by the variation of
+        the weight kernel over the extent of the group. The sums of the extensions of the Basket are not updated.
+        \see computeWithLod
+    */
+    template <typename Moments>
+    PONCA_MULTIARCH inline bool addMoments(const Moments& _moments, const DataPoint& _attributes);
+
+    /*!
+        \brief Add `_count` neighbors accumulated outside of the fit, from the sums of their weights \f$ w_i \f$,
+        weighted positions \f$ w_i q_i \f$ and weighted outer products \f$ w_i q_i q_i^T \f$
+
+        The positions \f$ q_i \f$ are relative to the basis center, and the weights given by the weight function of
+        the fit, e.g. by the lanes of computeBatch. The sums of the extensions of the Basket are not updated.
+    */
+    PONCA_MULTIARCH inline void addSums(AccScalar _sumW, const AccVectorType& _sumWq, const AccMatrixType& _sumWqq,
+                                        int _count);
+
+    /*!
+        \brief Remove a neighbor previously added with the same evaluation position, returns true if it was used
+
+        The weight of the neighbor is computed again: call it before #moveEvalPos, to remove the neighbors leaving
+        the neighborhood.
+    */
+    PONCA_MULTIARCH inline bool removeNeighbor(const DataPoint &_nei);
+
+    /*!
+        \brief Move the evaluation position, expressing the accumulated sums relatively to `_evalPos`
+
+        Together with #addNeighbor and #removeNeighbor, allows to update the fit incrementally when the
+        evaluation position slides over overlapping neighborhoods. The weights of the neighbors already added are
+        not updated: the fit is exact with a constant weight kernel only. Only the sums of this fitting procedure
+        are updated: Baskets with extensions accumulating neighbors, e.g. the derivatives, are rejected at compile
+        time by Basket::moveEvalPos and Basket::removeNeighbor.
+        \warning finalize consumes the sums: finalize a copy of the fit to keep updating it.
+    */
+    PONCA_MULTIARCH inline void moveEvalPos(const VectorType& _evalPos);
+
     /*! \copydoc Concept::FittingProcedureConcept::finalize() */
     PONCA_MULTIARCH inline FIT_RESULT finalize();
 
@@ -106,7 +205,8 @@ public:
     using Base::potential;
 
     /*! \brief Reading access to the Solver used to analyse the covariance
-      matrix */
+      matrix
+      \warning Not computed by #SMALLEST_EIGENVECTOR_SOLVER */
     PONCA_MULTIARCH inline const Solver& solver() const { return m_solver; }
 
     /*! \brief Implements \cite Pauly:2002:PSSimplification surface variation.
@@ -132,6 +232,15 @@ public:
      */
     template <bool ignoreTranslation = false>
     PONCA_MULTIARCH inline VectorType tangentPlaneToWorld(const VectorType &_q) const;
+
+protected:
+    /*! \brief Accumulate a block of neighbors in `_sums`, the unused rows being set to zero */
+    PONCA_MULTIARCH inline void accumulateNeighbors(const NeighborBlock& _block, BlockSums& _sums) const;
+
+private:
+    /*! \brief Compute the eigenvector of the smallest eigenvalue of m_cov by inverse power iterations
+        \return false when the iterations fail, `_v` being then set to zero */
+    inline bool smallestEigenvector(VectorType& _v) const;
 }; //class CovariancePlaneFit
 
 namespace internal {
@@ -193,8 +302,13 @@ private:
     MatrixType  m_dCov[NbDerivatives];
 
     VectorArray m_dCog;       /*!< \brief Derivatives of the centroid */
-    VectorArray m_dNormal;    /*!< \brief Derivatives of the hyper-plane normal */
-    ScalarArray m_dDist;      /*!< \brief Derivatives of the MLS scalar field */
+
+    // results, computed by computeDerivatives()
+    mutable VectorArray m_dNormal;    /*!< \brief Derivatives of the hyper-plane normal */
+    mutable ScalarArray m_dDist;      /*!< \brief Derivatives of the MLS scalar field */
+
+    bool m_lazyDerivatives {false};            /*!< \brief Compute the derivatives on first access */
+    mutable bool m_derivativesPending {false}; /*!< \brief The derivatives of the last fit are not computed yet */
 
 public:
 
@@ -209,6 +323,11 @@ public:
     /************************************************************************/
     /*! \see Concept::FittingProcedureConcept::addNeighbor() */
     PONCA_MULTIARCH bool addNeighbor(const DataPoint  &nei);
+    /*!
+        \brief Add the neighbors accumulated by `_other`, as if they were added to this fit
+        \see Basket::merge
+    */
+    PONCA_MULTIARCH inline void merge(const CovariancePlaneDer& _other);
     /*! \see Concept::FittingProcedureConcept::finalize() */
     PONCA_MULTIARCH FIT_RESULT finalize();
 
@@ -218,10 +337,22 @@ public:
     /**************************************************************************/
 
     /*! \brief Returns the derivatives of the scalar field at the evaluation point */
-    PONCA_MULTIARCH inline ScalarArray dPotential() const { return m_dDist; }
+    PONCA_MULTIARCH inline ScalarArray dPotential() const
+    { if (m_derivativesPending) computeDerivatives(); return m_dDist; }
 
     /*! \brief Returns the derivatives of the primitive normal */
-    PONCA_MULTIARCH inline VectorArray dNormal() const { return m_dNormal; }
+    PONCA_MULTIARCH inline VectorArray dNormal() const
+    { if (m_derivativesPending) computeDerivatives(); return m_dNormal; }
+
+    /*!
+        \brief Compute the derivatives on the first call to dNormal() or dPotential() instead of in finalize()
+
+        The fits whose derivatives are not read, e.g. in a pipeline reading only the normals, skip their
+        computation. The first access is not thread-safe: a fit shared between threads must be read once before.
+    */
+    PONCA_MULTIARCH inline void setLazyDerivatives(bool _lazy) { m_lazyDerivatives = _lazy; }
+    /*! \brief Tell if the derivatives are computed on first access, see setLazyDerivatives() */
+    PONCA_MULTIARCH inline bool isLazyDerivatives() const { return m_lazyDerivatives; }
 
     /*! \brief State specified at compilation time to differenciate the fit in scale */
     PONCA_MULTIARCH inline bool isScaleDer() const {return bool(Type & FitScaleDer);}
@@ -230,6 +361,10 @@ public:
     /*! \brief Number of dimensions used for the differentiation */
     PONCA_MULTIARCH inline unsigned int derDimension() const { return NbDerivatives;}
 
+private:
+    /*! \brief Compute m_dNormal and m_dDist from the sums and the decomposition of the covariance matrix */
+    PONCA_MULTIARCH inline void computeDerivatives() const;
+
 }; //class CovariancePlaneDer
 
 }// namespace internal
@@ -17,9 +17,12 @@ CovariancePlaneFit<DataPoint, _WFunctor, T>::init(const VectorType& _evalPos)
     Base::basisCenter() = _evalPos;
 
     // Setup fitting internal values
-    m_sumW        = Scalar(0.0);
-    m_cog         = VectorType::Zero();
-    m_cov         = MatrixType::Zero();
+    m_sumW        = AccScalar(0.0);
+    m_cog         = AccVectorType::Zero();
+    m_cov         = AccMatrixType::Zero();
+    m_cSumW.reset();
+    m_cCog.reset();
+    m_cCov.reset();
 }
 
 template < class DataPoint, class _WFunctor, typename T>
@@ -32,9 +35,12 @@ CovariancePlaneFit<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
 
     if (w > Scalar(0.))
     {
-      m_cog  += w * q;
-      m_sumW += w;
-      m_cov  += w * q * q.transpose();
+      const AccVectorType aq = q.template cast<AccScalar>();
+      const AccScalar     aw = AccScalar(w);
+
+      m_cCog.add(m_cog, aw * aq);
+      m_cSumW.add(m_sumW, aw);
+      m_cCov.add(m_cov, aw * aq * aq.transpose());
 
       ++(Base::m_nbNeighbors);
       return true;
@@ -42,6 +48,159 @@ CovariancePlaneFit<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
     return false;
 }
 
+template < class DataPoint, class _WFunctor, typename T>
+template <typename IteratorBegin, typename IteratorEnd>
+int
+CovariancePlaneFit<DataPoint, _WFunctor, T>::addNeighbors(const IteratorBegin& _begin, const IteratorEnd& _end)
+{
+    constexpr int Dim = DataPoint::Dim;
+    int nbAdded = 0;
+
+    // the lanes of the blocks would not be compensated
+    if constexpr (Compensated)
+    {
+        for (auto it = _begin; it != _end; ++it)
+            if(addNeighbor(*it))
+                ++nbAdded;
+        return nbAdded;
+    }
+
+    NeighborBlock block;
+    BlockSums sums = BlockSums::Zero();
+    int count = 0;
+    for (auto it = _begin; it != _end; ++it)
+    {
+        const DataPoint& nei = *it;
+        const VectorType q = nei.pos() - Base::basisCenter();
+        const Scalar w = m_w.w(q, nei);
+        if (w > Scalar(0.))
+        {
+            block.row(count).template head<Dim>() = q.transpose().template cast<AccScalar>();
+            block(count, Dim) = AccScalar(w);
+            ++nbAdded;
+            if(++count == BlockSize)
+            {
+                accumulateNeighbors(block, sums);
+                count = 0;
+            }
+        }
+    }
+    if(count > 0)
+    {
+        block.bottomRows(BlockSize - count).setZero();
+        accumulateNeighbors(block, sums);
+    }
+
+    // reduce the lanes: weight, weighted positions, then the upper triangle of the covariance
+    const Eigen::Matrix<AccScalar, 1, BlockSums::ColsAtCompileTime> s = sums.colwise().sum();
+    m_sumW += s(0);
+    m_cog  += s.template segment<Dim>(1).transpose();
+    for (int i = 0, k = 1 + Dim; i < Dim; ++i)
+        for (int j = i; j < Dim; ++j, ++k)
+        {
+            m_cov(i,j) += s(k);
+            if (j != i) m_cov(j,i) = m_cov(i,j);
+        }
+
+    Base::m_nbNeighbors += nbAdded;
+    return nbAdded;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+CovariancePlaneFit<DataPoint, _WFunctor, T>::accumulateNeighbors(const NeighborBlock& _block, BlockSums& _sums) const
+{
+    constexpr int Dim = DataPoint::Dim;
+    const auto b = _block.array();
+    const auto w = b.col(Dim);
+    _sums.col(0) += w;
+    for (int i = 0, k = 1 + Dim; i < Dim; ++i)
+    {
+        const Eigen::Array<AccScalar, BlockSize, 1> wq = w * b.col(i);
+        _sums.col(1 + i) += wq;
+        for (int j = i; j < Dim; ++j, ++k)
+            _sums.col(k) += wq * b.col(j);
+    }
+}
+
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+CovariancePlaneFit<DataPoint, _WFunctor, T>::merge(const CovariancePlaneFit& _other)
+{
+    Base::merge(_other);
+    m_cSumW.merge(m_sumW, _other.m_sumW, _other.m_cSumW);
+    m_cCog.merge(m_cog, _other.m_cog, _other.m_cCog);
+    m_cCov.merge(m_cov, _other.m_cov, _other.m_cCov);
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+CovariancePlaneFit<DataPoint, _WFunctor, T>::addSums(AccScalar _sumW, const AccVectorType& _sumWq,
+                                                     const AccMatrixType& _sumWqq, int _count)
+{
+    m_cSumW.add(m_sumW, _sumW);
+    m_cCog.add(m_cog, _sumWq);
+    m_cCov.add(m_cov, _sumWqq);
+    Base::m_nbNeighbors += _count;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+template <typename Moments>
+bool
+CovariancePlaneFit<DataPoint, _WFunctor, T>::addMoments(const Moments& _moments, const DataPoint& _attributes)
+{
+    const VectorType c = Base::basisCenter();
+    // weight of the centroid, shared by the neighbors of the group
+    Scalar w = m_w.w(_moments.centroid() - c, _attributes);
+
+    if (w > Scalar(0.))
+    {
+      const AccScalar aw = AccScalar(w);
+
+      m_cCog.add(m_cog, aw * _moments.sum_positions_around(c).template cast<AccScalar>());
+      m_cSumW.add(m_sumW, aw * AccScalar(_moments.count));
+      m_cCov.add(m_cov, aw * _moments.sum_outer_products_around(c).template cast<AccScalar>());
+
+      Base::m_nbNeighbors += int(_moments.count);
+      return true;
+    }
+    return false;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+bool
+CovariancePlaneFit<DataPoint, _WFunctor, T>::removeNeighbor(const DataPoint& _nei)
+{
+    VectorType q = _nei.pos() - Base::basisCenter();
+    // compute weight
+    Scalar w = m_w.w(q, _nei);
+
+    if (w > Scalar(0.))
+    {
+      const AccVectorType aq = q.template cast<AccScalar>();
+      const AccScalar     aw = AccScalar(w);
+
+      m_cCog.add(m_cog, -aw * aq);
+      m_cSumW.add(m_sumW, -aw);
+      m_cCov.add(m_cov, -aw * aq * aq.transpose());
+
+      --(Base::m_nbNeighbors);
+      return true;
+    }
+    return false;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+CovariancePlaneFit<DataPoint, _WFunctor, T>::moveEvalPos(const VectorType& _evalPos)
+{
+    const AccVectorType delta = (_evalPos - Base::basisCenter()).template cast<AccScalar>();
+    // sum of w (q-delta)(q-delta)^T, m_cog being the sum of w q
+    m_cCov.add(m_cov, m_sumW * delta * delta.transpose() - m_cog * delta.transpose() - delta * m_cog.transpose());
+    m_cCog.add(m_cog, -m_sumW * delta);
+    Base::basisCenter() = _evalPos;
+}
 
 template < class DataPoint, class _WFunctor, typename T>
 FIT_RESULT
@@ -49,7 +208,7 @@ CovariancePlaneFit<DataPoint, _WFunctor, T>::finalize ()
 {
     // handle specific configurations
     // With less than 3 neighbors the fitting is undefined
-    if(m_sumW == Scalar(0.) || Base::m_nbNeighbors < 3)
+    if(m_sumW == AccScalar(0.) || Base::m_nbNeighbors < 3)
     {
       Base::resetPrimitive();
       Base::m_eCurrentState = UNDEFINED;
@@ -59,26 +218,92 @@ CovariancePlaneFit<DataPoint, _WFunctor, T>::finalize ()
     // Finalize the centroid (still expressed in local basis)
     m_cog = m_cog/m_sumW;
 
-    // Center the covariance on the centroid
+    // Center the covariance on the centroid, before converting it to Scalar for the decomposition
     m_cov = m_cov/m_sumW - m_cog * m_cog.transpose();
+    const VectorType cog = m_cog.template cast<Scalar>();
 
-#ifdef __CUDACC__
-    m_solver.computeDirect(m_cov);
-#else
-    m_solver.compute(m_cov);
+#ifndef PONCA_GPU_COMPILER
+    if (m_solverType == SMALLEST_EIGENVECTOR_SOLVER)
+    {
+        // on failure the normal is zero, and so are the coefficients of the UNDEFINED plane
+        VectorType normal = VectorType::Zero();
+        Base::m_eCurrentState = ( smallestEigenvector(normal) ? STABLE : UNDEFINED );
+        Base::setPlane(normal, cog);
+        return Base::m_eCurrentState;
+    }
+    // in 2D the closed form of the direct solver is exact, and the iterative one does not compile on the
+    // unaligned 2x2 matrices
+    if constexpr (DataPoint::Dim != 2)
+    {
+        if (m_solverType == ITERATIVE_SOLVER)
+        {
+            m_solver.compute(m_cov.template cast<Scalar>());
+            Base::m_eCurrentState = ( m_solver.info() == Eigen::Success ? STABLE : UNDEFINED );
+            Base::setPlane(m_solver.eigenvectors().col(0), cog);
+            return Base::m_eCurrentState;
+        }
+    }
 #endif
+    m_solver.computeDirect(m_cov.template cast<Scalar>());
     Base::m_eCurrentState = ( m_solver.info() == Eigen::Success ? STABLE : UNDEFINED );
 
-    Base::setPlane(m_solver.eigenvectors().col(0), m_cog);
+    Base::setPlane(m_solver.eigenvectors().col(0), cog);
 
     return Base::m_eCurrentState;
 }
 
+template < class DataPoint, class _WFunctor, typename T>
+bool
+CovariancePlaneFit<DataPoint, _WFunctor, T>::smallestEigenvector(VectorType& _v) const
+{
+    typedef typename VectorType::Index Index;
+    const int maxIterations = 16;
+    const Scalar epsilon = Eigen::NumTraits<Scalar>::epsilon();
+    const MatrixType cov = m_cov.template cast<Scalar>();
+
+    // the shift keeps the eigenvectors and the matrix definite when the neighborhood is flat, despite the
+    // rounding errors of the covariance, while slowing the convergence only by sqrt(epsilon)
+    Eigen::LDLT<MatrixType> ldlt(cov + MatrixType::Identity() * (Eigen::numext::sqrt(epsilon) * cov.trace()));
+    if (ldlt.info() != Eigen::Success)
+    {
+        _v = VectorType::Zero();
+        return false;
+    }
+
+    // start from the axis of least variance, each iteration divides the error by the ratio of the two
+    // smallest eigenvalues
+    Index axis = 0;
+    cov.diagonal().minCoeff(&axis);
+    _v = VectorType::Unit(axis);
+    for (int i = 0; i < maxIterations; ++i)
+    {
+        VectorType next = ldlt.solve(_v);
+        const Scalar norm = next.norm();
+        if (!(norm > Scalar(0.)))
+        {
+            _v = VectorType::Zero();
+            return false;
+        }
+        next /= norm;
+        const Scalar dot = next.dot(_v);
+        _v = next;
+        if (Scalar(1.) - std::abs(dot) <= epsilon)
+            break;
+    }
+    return true;
+}
+
 
 template < class DataPoint, class _WFunctor, typename T>
 typename CovariancePlaneFit<DataPoint, _WFunctor, T>::Scalar
 CovariancePlaneFit<DataPoint, _WFunctor, T>::surfaceVariation () const
 {
+    // the mean of the eigenvalues is the mean of the diagonal of the covariance matrix
+    if (m_solverType == SMALLEST_EIGENVECTOR_SOLVER)
+    {
+        const MatrixType cov = m_cov.template cast<Scalar>();
+        return Base::primitiveGradient().dot(cov * Base::primitiveGradient()) / cov.diagonal().mean();
+    }
     return m_solver.eigenvalues()(0) / m_solver.eigenvalues().mean();
 }
 
@@ -158,60 +383,83 @@ CovariancePlaneDer<DataPoint, _WFunctor, T, Type>::addNeighbor(const DataPoint
     return false;
 }
 
+template < class DataPoint, class _WFunctor, typename T, int Type>
+void
+CovariancePlaneDer<DataPoint, _WFunctor, T, Type>::merge(const CovariancePlaneDer& _other)
+{
+    Base::merge(_other);
+    m_dSumW += _other.m_dSumW;
+    m_dCog  += _other.m_dCog;
+    for(int k=0; k<NbDerivatives; ++k)
+      m_dCov[k] += _other.m_dCov[k];
+}
+
 
 template < class DataPoint, class _WFunctor, typename T, int Type>
 FIT_RESULT
 CovariancePlaneDer<DataPoint, _WFunctor, T, Type>::finalize()
 {
-    PONCA_MULTIARCH_STD_MATH(sqrt);
-
     Base::finalize();
     // Test if base finalize end on a viable case (stable / unstable)
-    if (this->isReady())
-    {
-      // pre-compute shifted eigenvalues to apply the pseudo inverse of C - lambda_0 I
-      Scalar epsilon          = Scalar(2) * Eigen::NumTraits<Scalar>::epsilon();
-      Scalar consider_as_zero = Scalar(2) * std::numeric_limits<Scalar>::denorm_min();
-      Eigen::Matrix<Scalar,2,1> shifted_eivals = Base::m_solver.eigenvalues().template tail<2>().array() - Base::m_solver.eigenvalues()(0);
-      if(shifted_eivals(0) < consider_as_zero || shifted_eivals(0) < epsilon * shifted_eivals(1)) shifted_eivals(0) = 0;
-      if(shifted_eivals(1) < consider_as_zero) shifted_eivals(1) = 0;
-
-      for(int k=0; k<NbDerivatives; ++k)
-      {
-        // Finalize the computation of dCov.
-        m_dCov[k] = m_dCov[k]
-                  - Base::m_cog * m_dCog.col(k).transpose()
-                  - m_dCog.col(k) * Base::m_cog.transpose()
-                  + m_dSumW[k] * Base::m_cog * Base::m_cog.transpose();
-
-        // apply normalization by sumW:
-        m_dCog.col(k) = (m_dCog.col(k) - m_dSumW(k) * Base::m_cog) / Base::m_sumW;
-
-        VectorType normal = Base::primitiveGradient();
-        // The derivative of 'normal' is the derivative of the smallest eigenvector.
-        // Since the covariance matrix is real and symmetric, it is equal to:
-        //    n' = - (C - lambda_0 I)^+ C' n
-        // Where ^+ denotes the pseudo-inverse.
-        // Since we already performed the eigenvalue decomposition of the matrix C,
-        // we can directly apply the pseudo inverse by observing that:
-        //    (C - lambda_0 I) = V (L - lambda_0 I) V^T
-        // where V is the eigenvector matrix, and L the eigenvalue diagonal matrix.
-        Eigen::Matrix<Scalar,2,1> z = - Base::m_solver.eigenvectors().template rightCols<2>().transpose() * (m_dCov[k] * normal);
-        if(shifted_eivals(0)>0) z(0) /= shifted_eivals(0);
-        if(shifted_eivals(1)>0) z(1) /= shifted_eivals(1);
-        m_dNormal.col(k) = Base::m_solver.eigenvectors().template rightCols<2>() * z;
-
-        VectorType dDiff = -m_dCog.col(k);
-        if(k>0 || !isScaleDer())
-          dDiff(isScaleDer() ? k-1 : k) += 1;
-        m_dDist(k) = m_dNormal.col(k).dot(Base::m_cog) + normal.dot(dDiff);
-
-        // \fixme we shouldn't need this normalization, however currently the derivatives are overestimated by a factor 2
-        m_dNormal /= Scalar(2.);
-      }
-    }
+    m_derivativesPending = this->isReady();
+    if (m_derivativesPending && !m_lazyDerivatives)
+        computeDerivatives();
 
     return Base::m_eCurrentState;
 }
 
+template < class DataPoint, class _WFunctor, typename T, int Type>
+void
+CovariancePlaneDer<DataPoint, _WFunctor, T, Type>::computeDerivatives() const
+{
+    PONCA_MULTIARCH_STD_MATH(sqrt);
+
+    m_derivativesPending = false;
+
+    // pre-compute shifted eigenvalues to apply the pseudo inverse of C - lambda_0 I
+    Scalar epsilon          = Scalar(2) * Eigen::NumTraits<Scalar>::epsilon();
+    Scalar consider_as_zero = Scalar(2) * std::numeric_limits<Scalar>::denorm_min();
+    Eigen::Matrix<Scalar,2,1> shifted_eivals = Base::m_solver.eigenvalues().template tail<2>().array() - Base::m_solver.eigenvalues()(0);
+    if(shifted_eivals(0) < consider_as_zero || shifted_eivals(0) < epsilon * shifted_eivals(1)) shifted_eivals(0) = 0;
+    if(shifted_eivals(1) < consider_as_zero) shifted_eivals(1) = 0;
+
+    // sums converted from the accumulator type
+    const VectorType cog  = Base::m_cog.template cast<Scalar>();
+    const Scalar     sumW = Scalar(Base::m_sumW);
+
+    for(int k=0; k<NbDerivatives; ++k)
+    {
+      // Finalize the computation of dCov.
+      const MatrixType dCov = m_dCov[k]
+                            - cog * m_dCog.col(k).transpose()
+                            - m_dCog.col(k) * cog.transpose()
+                            + m_dSumW[k] * cog * cog.transpose();
+
+      // apply normalization by sumW:
+      const VectorType dCog = (m_dCog.col(k) - m_dSumW(k) * cog) / sumW;
+
+      VectorType normal = Base::primitiveGradient();
+      // The derivative of 'normal' is the derivative of the smallest eigenvector.
+      // Since the covariance matrix is real and symmetric, it is equal to:
+      //    n' = - (C - lambda_0 I)^+ C' n
+      // Where ^+ denotes the pseudo-inverse.
+      // Since we already performed the eigenvalue decomposition of the matrix C,
+      // we can directly apply the pseudo inverse by observing that:
+      //    (C - lambda_0 I) = V (L - lambda_0 I) V^T
+      // where V is the eigenvector matrix, and L the eigenvalue diagonal matrix.
+      Eigen::Matrix<Scalar,2,1> z = - Base::m_solver.eigenvectors().template rightCols<2>().transpose() * (dCov * normal);
+      if(shifted_eivals(0)>0) z(0) /= shifted_eivals(0);
+      if(shifted_eivals(1)>0) z(1) /= shifted_eivals(1);
+      m_dNormal.col(k) = Base::m_solver.eigenvectors().template rightCols<2>() * z;
+
+      VectorType dDiff = -dCog;
+      if(k>0 || !isScaleDer())
+        dDiff(isScaleDer() ? k-1 : k) += 1;
+      m_dDist(k) = m_dNormal.col(k).dot(cog) + normal.dot(dDiff);
+
+      // \fixme we shouldn't need this normalization, however currently the derivatives are overestimated by a factor 2
+      m_dNormal /= Scalar(2.);
+    }
+}
+
 }// namespace internal
@@ -0,0 +1,356 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./csrNeighborhoods.h"
+#include "../Common/Tracing.h"
+
+#include <cstddef>
+#include <cstring>
+#include <cuda_runtime.h>
+
+namespace Ponca
+{
+
+/*!
+    \brief Parallelization of the fits of csrBatchFitKernel and csrBatchFitWarpKernel
+    \ingroup fitting
+*/
+enum CSR_BATCH_MODE
+{
+    /*! \brief One thread per evaluation point, for small neighborhoods */
+    THREAD_PER_POINT,
+    /*! \brief One warp per evaluation point, whose lanes accumulate parts of the neighborhood reduced by shuffles
+      before finalize, for large neighborhoods. Requires a Basket providing merge, e.g. OrientedSphereFit or
+      CovariancePlaneFit */
+    WARP_PER_POINT,
+    /*! \brief #WARP_PER_POINT when the neighborhoods hold on average at least #CsrWarpSize neighbors,
+      #THREAD_PER_POINT otherwise */
+    AUTO_PER_POINT
+};
+
+/*! \brief Number of lanes of the warps of csrBatchFitWarpKernel */
+constexpr int CsrWarpSize = 32;
+
+/*! \brief Parallelization of the fits of `_count` neighborhoods holding `_neighbors` neighbors, see #AUTO_PER_POINT */
+inline CSR_BATCH_MODE csrBatchMode(CSR_BATCH_MODE _mode, int _count, std::size_t _neighbors)
+{
+    if (_mode != AUTO_PER_POINT)
+        return _mode;
+    return _neighbors >= std::size_t(CsrWarpSize) * std::size_t(_count) ? WARP_PER_POINT : THREAD_PER_POINT;
+}
+
+/*!
+    \brief Fit the neighborhood of each evaluation point of `_nei` with the weight function `_w`, and write
+    `_output(fit, state)` in `_result`
+
+    One thread per evaluation point, see fitCsrNeighborhood. The buffers of `_nei` and `_result` are stored on the
+    device.
+    \tparam Output Functor evaluated on the device, e.g. returning the curvature of a Basket with GLSParam
+    \see CsrBatchFitter, launchCsrBatchFit
+    \ingroup fitting
+*/
+template <typename Fit, typename Output, typename Storage>
+__global__ void csrBatchFitKernel(CsrNeighborhoods<Storage> _nei, typename Fit::WFunctor _w,
+                                  Output _output, typename Fit::Scalar* _result)
+{
+    const int i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i >= _nei.count)
+        return;
+
+    Fit fit;
+    const FIT_RESULT res = fitCsrNeighborhood(fit, i, _w, _nei);
+    _result[i] = _output(fit, res);
+}
+
+/*!
+    \brief Value of `_v` in the lane `_delta` lanes above the calling lane, or `_v` itself beyond the warp
+
+    `T` is copied by 32-bit words through `__shfl_down_sync`, so that any trivially copyable fit goes through the
+    registers of the warp. Called by all the lanes of the warp.
+    \ingroup fitting
+*/
+template <typename T>
+__device__ inline T warpShuffleDown(const T& _v, int _delta)
+{
+    T res;
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(&_v);
+    unsigned char* out = reinterpret_cast<unsigned char*>(&res);
+    for (std::size_t k = 0; k < sizeof(T); k += sizeof(int))
+    {
+        const std::size_t bytes = sizeof(T) - k < sizeof(int) ? sizeof(T) - k : sizeof(int);
+        int word = 0;
+        std::memcpy(&word, in + k, bytes);
+        word = __shfl_down_sync(0xffffffffu, word, _delta);
+        std::memcpy(out + k, &word, bytes);
+    }
+    return res;
+}
+
+/*!
+    \brief Merge the fits of the lanes of the warp into the fit of the first lane, by a butterfly of shuffles
+
+    Each step merges the partial sums of the lane `lane + s` into the lane `lane`, for `s` = 16, 8, ... 1 (see
+    Basket::merge), without shared memory nor synchronization. The fits of the other lanes are left partially merged.
+    Called by all the lanes of the warp.
+    \ingroup fitting
+*/
+template <typename Fit>
+__device__ inline void warpMergeFits(Fit& _fit)
+{
+    for (int s = CsrWarpSize / 2; s > 0; s /= 2)
+    {
+        const Fit other = warpShuffleDown(_fit, s);
+        _fit.merge(other);
+    }
+}
+
+/*!
+    \brief Fit the neighborhood of each evaluation point as csrBatchFitKernel, with a warp per evaluation point
+
+    Each lane adds one neighbor out of #CsrWarpSize to its own fit (see addCsrNeighbors), so that the lanes of a
+    warp load consecutive neighbors and run the same instructions whatever the size of the neighborhood. The partial
+    sums are reduced in registers by warpMergeFits. The first lane finalizes the fit, and runs alone the following
+    passes of the fits needing them. The kernel is launched with blocks of a multiple of #CsrWarpSize threads.
+    \ingroup fitting
+*/
+template <typename Fit, typename Output, typename Storage>
+__global__ void csrBatchFitWarpKernel(CsrNeighborhoods<Storage> _nei, typename Fit::WFunctor _w,
+                                      Output _output, typename Fit::Scalar* _result)
+{
+    const int lane = threadIdx.x % CsrWarpSize;
+
+    // uniform over the warp, whose lanes return together
+    const int i = (blockIdx.x * blockDim.x + threadIdx.x) / CsrWarpSize;
+    if (i >= _nei.count)
+        return;
+
+    Fit fit;
+    initCsrFit(fit, i, _w, _nei);
+    addCsrNeighbors(fit, i, _nei, lane, CsrWarpSize);
+    warpMergeFits(fit);
+
+    if (lane == 0)
+    {
+        FIT_RESULT res = fit.finalize();
+        while (res == NEED_OTHER_PASS)
+        {
+            addCsrNeighbors(fit, i, _nei);
+            res = fit.finalize();
+        }
+        _result[i] = _output(fit, res);
+    }
+}
+
+/*!
+    \brief Enqueue on `_stream` the fits of the evaluation points of `_nei`, with csrBatchFitWarpKernel when `_mode`
+    is #WARP_PER_POINT and csrBatchFitKernel otherwise (#AUTO_PER_POINT is resolved by the caller, see csrBatchMode)
+
+    Blocks of `_blockSize` threads, a multiple of #CsrWarpSize.
+    \ingroup fitting
+*/
+template <typename Fit, typename Output, typename Storage>
+inline void launchCsrBatchFit(cudaStream_t _stream, CSR_BATCH_MODE _mode, int _blockSize,
+                              const CsrNeighborhoods<Storage>& _nei,
+                              const typename Fit::WFunctor& _w, Output _output, typename Fit::Scalar* _result)
+{
+    if (_nei.count == 0)
+        return;
+    if (_mode == WARP_PER_POINT)
+    {
+        const int pointsPerBlock = _blockSize / CsrWarpSize;
+        const int grid = (_nei.count + pointsPerBlock - 1) / pointsPerBlock;
+        csrBatchFitWarpKernel<Fit><<<grid, _blockSize, 0, _stream>>>(_nei, _w, _output, _result);
+    }
+    else
+    {
+        const int grid = (_nei.count + _blockSize - 1) / _blockSize;
+        csrBatchFitKernel<Fit><<<grid, _blockSize, 0, _stream>>>(_nei, _w, _output, _result);
+    }
+}
+
+/*!
+    \brief Fits of unstructured point clouds on the GPU, from neighborhoods computed on the CPU in CSR format
+
+    The fitter owns a CUDA stream and the device buffers of the points, the neighborhoods and the results. They are
+    reallocated only when they grow, so that successive batches are processed without allocation. #upload and
+    #launch enqueue the copies and the kernel on the stream and return immediately, #download waits for the results.
+
+    \code
+    std::vector<std::size_t> offsets;
+    std::vector<int> neighbors;
+    tree.range_neighbors_batch(r, offsets, neighbors);
+
+    CsrBatchFitter<Fit> fitter;
+    fitter.upload(positions, normals, pointCount, nullptr, offsets.data(), neighbors.data(), pointCount);
+    fitter.launch(WeightFunc(r), Curvature()); // a warp per point for the large neighborhoods
+    fitter.download(curvatures);
+    \endcode
+
+    The errors are reported by the CUDA status codes.
+
+    \tparam Fit Basket whose data points are constructed from their position and normal, see addCsrNeighbors
+    \tparam Storage Scalar type of the positions and normals, e.g. `Eigen::half` to halve the uploads and the reads
+    of the kernels of float fits, see CsrNeighborhoods
+    \ingroup fitting
+*/
+template <typename Fit, typename Storage = typename Fit::Scalar>
+class CsrBatchFitter
+{
+public:
+    typedef typename Fit::Scalar Scalar;   /*!< \brief Scalar type of the fits and the results */
+    typedef typename Fit::WFunctor WFunctor; /*!< \brief Weight function of the fits */
+    enum {Dim = Fit::DataPoint::Dim};      /*!< \brief Number of scalars per position or normal */
+
+    /*! \brief Number of threads of the blocks */
+    enum {BlockSize = 128};
+
+    inline CsrBatchFitter() { cudaStreamCreate(&m_stream); }
+    inline ~CsrBatchFitter() { release(); cudaStreamDestroy(m_stream); }
+
+    CsrBatchFitter(const CsrBatchFitter&) = delete;
+    CsrBatchFitter& operator=(const CsrBatchFitter&) = delete;
+
+    /*!
+        \brief Copy to the device the `_pointCount` points and the neighborhoods of `_count` evaluation points
+
+        `_positions` and `_normals` store `Dim` scalars per point, `_queries` the positions of the evaluation points,
+        or is null when the evaluation point `i` is the point `i`. `_offsets` stores `_count + 1` offsets in
+        `_indices`, see CsrNeighborhoods. The host buffers must be kept until the next synchronization.
+    */
+    inline cudaError_t upload(const Storage* _positions, const Storage* _normals, int _pointCount,
+                              const Storage* _queries, const std::size_t* _offsets, const int* _indices, int _count)
+    {
+        const std::size_t points = std::size_t(Dim) * std::size_t(_pointCount);
+        const std::size_t indices = _offsets[_count];
+        cudaError_t err;
+        if ((err = reserve(m_positions, m_pointCapacity, points, m_normals)) != cudaSuccess ||
+            (err = reserve(m_queries, m_queryCapacity, _queries ? std::size_t(Dim) * _count : 0)) != cudaSuccess ||
+            (err = reserve(m_offsets, m_offsetCapacity, std::size_t(_count) + 1)) != cudaSuccess ||
+            (err = reserve(m_indices, m_indexCapacity, indices)) != cudaSuccess ||
+            (err = reserve(m_results, m_resultCapacity, std::size_t(_count))) != cudaSuccess)
+            return err;
+
+        PONCA_TRACE_ZONE("ponca::CsrBatchFitter::upload");
+        PONCA_TRACE_ZONE_VALUE(indices);
+        cudaMemcpyAsync(m_positions, _positions, points * sizeof(Storage), cudaMemcpyHostToDevice, m_stream);
+        cudaMemcpyAsync(m_normals,   _normals,   points * sizeof(Storage), cudaMemcpyHostToDevice, m_stream);
+        if (_queries)
+            cudaMemcpyAsync(m_queries, _queries, std::size_t(Dim) * _count * sizeof(Storage), cudaMemcpyHostToDevice, m_stream);
+        cudaMemcpyAsync(m_offsets, _offsets, (std::size_t(_count) + 1) * sizeof(std::size_t), cudaMemcpyHostToDevice, m_stream);
+        cudaMemcpyAsync(m_indices, _indices, indices * sizeof(int), cudaMemcpyHostToDevice, m_stream);
+
+        m_neighborhoods = {m_positions, m_normals, _queries ? m_queries : nullptr, m_offsets, m_indices, _count};
+        m_neighborCount = indices;
+        return cudaGetLastError();
+    }
+
+    /*! \brief Neighborhoods stored on the device by the last #upload */
+    inline const CsrNeighborhoods<Storage>& neighborhoods() const { return m_neighborhoods; }
+
+    /*! \brief Device buffer of the results of the last #launch, one scalar per evaluation point */
+    inline const Scalar* deviceResults() const { return m_results; }
+
+    /*! \brief Stream of the copies and launches, to order other work with them */
+    inline cudaStream_t stream() const { return m_stream; }
+
+    /*!
+        \brief Enqueue the fits of the uploaded neighborhoods with the weight function `_w`, writing `_output` of
+        each fit in the results (see csrBatchFitKernel and csrBatchFitWarpKernel)
+    */
+    template <typename Output>
+    inline cudaError_t launch(const WFunctor& _w, Output _output, CSR_BATCH_MODE _mode = AUTO_PER_POINT)
+    {
+        PONCA_TRACE_ZONE("ponca::CsrBatchFitter::launch");
+        launchCsrBatchFit<Fit>(m_stream, csrBatchMode(_mode, m_neighborhoods.count, m_neighborCount), BlockSize,
+                               m_neighborhoods, _w, _output, m_results);
+        return cudaGetLastError();
+    }
+
+    /*! \brief Copy the results of the last #launch to `_results`, one scalar per evaluation point, and wait for it */
+    inline cudaError_t download(Scalar* _results)
+    {
+        PONCA_TRACE_ZONE("ponca::CsrBatchFitter::download");
+        cudaMemcpyAsync(_results, m_results, std::size_t(m_neighborhoods.count) * sizeof(Scalar),
+                        cudaMemcpyDeviceToHost, m_stream);
+        return synchronize();
+    }
+
+    /*! \brief Wait for the enqueued copies and launches */
+    inline cudaError_t synchronize() { return cudaStreamSynchronize(m_stream); }
+
+private:
+    /*! \brief Reallocate `_buffer` (and `_other`, of the same size) when its capacity is below `_size` elements */
+    template <typename T>
+    inline cudaError_t reserve(T*& _buffer, std::size_t& _capacity, std::size_t _size, T*& _other)
+    {
+        if (_size <= _capacity)
+            return cudaSuccess;
+        cudaStreamSynchronize(m_stream);
+        cudaFree(_buffer);
+        cudaFree(_other);
+        _buffer = _other = nullptr;
+        _capacity = 0;
+        cudaError_t err;
+        if ((err = cudaMalloc(&_buffer, _size * sizeof(T))) != cudaSuccess ||
+            (err = cudaMalloc(&_other, _size * sizeof(T))) != cudaSuccess)
+            return err;
+        _capacity = _size;
+        return cudaSuccess;
+    }
+
+    /*! \brief Reallocate `_buffer` when its capacity is below `_size` elements */
+    template <typename T>
+    inline cudaError_t reserve(T*& _buffer, std::size_t& _capacity, std::size_t _size)
+    {
+        if (_size <= _capacity)
+            return cudaSuccess;
+        cudaStreamSynchronize(m_stream);
+        cudaFree(_buffer);
+        _buffer = nullptr;
+        _capacity = 0;
+        const cudaError_t err = cudaMalloc(&_buffer, _size * sizeof(T));
+        if (err == cudaSuccess)
+            _capacity = _size;
+        return err;
+    }
+
+    inline void release()
+    {
+        cudaStreamSynchronize(m_stream);
+        cudaFree(m_positions);
+        cudaFree(m_normals);
+        cudaFree(m_queries);
+        cudaFree(m_offsets);
+        cudaFree(m_indices);
+        cudaFree(m_results);
+        m_positions = m_normals = m_queries = nullptr;
+        m_results = nullptr;
+        m_offsets = nullptr;
+        m_indices = nullptr;
+        m_pointCapacity = m_queryCapacity = m_offsetCapacity = m_indexCapacity = m_resultCapacity = 0;
+    }
+
+    cudaStream_t m_stream;                        /*!< \brief Stream of the copies and launches */
+    CsrNeighborhoods<Storage> m_neighborhoods {nullptr, nullptr, nullptr, nullptr, nullptr, 0}; /*!< \brief Uploaded neighborhoods */
+    std::size_t m_neighborCount {0};              /*!< \brief Number of neighbors of the uploaded neighborhoods */
+
+    Storage* m_positions {nullptr};    /*!< \brief Device positions, `Dim` scalars per point */
+    Storage* m_normals {nullptr};      /*!< \brief Device normals, `Dim` scalars per point */
+    Storage* m_queries {nullptr};      /*!< \brief Device evaluation positions */
+    std::size_t* m_offsets {nullptr};  /*!< \brief Device offsets of the neighborhoods */
+    int* m_indices {nullptr};          /*!< \brief Device indices of the neighbors */
+    Scalar* m_results {nullptr};       /*!< \brief Device results, one scalar per evaluation point */
+
+    std::size_t m_pointCapacity {0};   /*!< \brief Capacity of the positions and normals, in scalars */
+    std::size_t m_queryCapacity {0};   /*!< \brief Capacity of the evaluation positions, in scalars */
+    std::size_t m_offsetCapacity {0};  /*!< \brief Capacity of the offsets */
+    std::size_t m_indexCapacity {0};   /*!< \brief Capacity of the indices */
+    std::size_t m_resultCapacity {0};  /*!< \brief Capacity of the results */
+};
+
+} // namespace Ponca
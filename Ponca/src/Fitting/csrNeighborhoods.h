@@ -0,0 +1,119 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./enums.h"
+
+#include <cstddef>
+#include <Eigen/Core>
+
+namespace Ponca
+{
+
+/*!
+    \brief Neighborhoods of evaluation points in a point cloud, in CSR format: the neighbors of the evaluation point
+    `i` are the points `indices[offsets[i], offsets[i+1])`
+
+    The buffers are not owned, and can be stored on the host or on the device. They are computed e.g. on the CPU by
+    KdTree::range_neighbors_batch, whose `offsets` and `neighbors` are used as is:
+    \code
+    std::vector<std::size_t> offsets;
+    std::vector<int> neighbors;
+    tree.range_neighbors_batch(r, offsets, neighbors);
+    \endcode
+
+    \tparam Storage Scalar type of the positions and normals, converted to the scalar type of the fits when the
+    points are read. `Eigen::half` or `Eigen::bfloat16` halve the memory traffic of float fits, which still
+    accumulate in float.
+    \see fitCsrNeighborhood
+    \ingroup fitting
+*/
+template <typename Storage>
+struct CsrNeighborhoods
+{
+    const Storage* positions;   /*!< \brief Positions of the points, `Dim` scalars per point */
+    const Storage* normals;     /*!< \brief Normals of the points, `Dim` scalars per point */
+    const Storage* queries;     /*!< \brief Evaluation positions, `Dim` scalars per evaluation point, or null when
+                                            the evaluation point `i` is the point `i` */
+    const std::size_t* offsets; /*!< \brief First neighbor of each evaluation point, `count + 1` offsets */
+    const int* indices;         /*!< \brief Indices of the neighbors in the points */
+    int count;                  /*!< \brief Number of evaluation points */
+
+    /*! \brief Number of neighbors of the evaluation point `_i` */
+    PONCA_MULTIARCH inline int size(int _i) const { return int(offsets[_i + 1] - offsets[_i]); }
+};
+
+/*!
+    \brief Set the weight function `_w` of `_fit` and initialize it at the evaluation point `_i` of `_nei`
+
+    \see addCsrNeighbors
+    \ingroup fitting
+*/
+template <typename Fit, typename Storage>
+PONCA_MULTIARCH inline void initCsrFit(Fit& _fit, int _i, const typename Fit::WFunctor& _w,
+                                       const CsrNeighborhoods<Storage>& _nei)
+{
+    typedef typename Fit::DataPoint DataPoint;
+    typedef Eigen::Map<const Eigen::Matrix<Storage, DataPoint::Dim, 1> > VectorMap;
+
+    _fit.setWeightFunc(_w);
+    _fit.init(VectorMap((_nei.queries ? _nei.queries : _nei.positions) + DataPoint::Dim * _i)
+              .template cast<typename Fit::Scalar>());
+}
+
+/*!
+    \brief Add to `_fit` the neighbors `_first`, `_first + _stride`, `_first + 2 * _stride`... of the evaluation
+    point `_i` of `_nei`
+
+    The neighbors are built from their position and normal, converted to `Fit::Scalar`, by the constructor
+    `DataPoint(pos, normal)`. With a stride, several fits initialized the same way accumulate disjoint parts of the
+    neighborhood, and are merged before finalize (see Basket::merge), as done by the lanes of a warp in
+    csrBatchFitWarpKernel.
+    \ingroup fitting
+*/
+template <typename Fit, typename Storage>
+PONCA_MULTIARCH inline void addCsrNeighbors(Fit& _fit, int _i, const CsrNeighborhoods<Storage>& _nei,
+                                            int _first = 0, int _stride = 1)
+{
+    typedef typename Fit::DataPoint DataPoint;
+    typedef typename Fit::Scalar Scalar;
+    typedef Eigen::Map<const Eigen::Matrix<Storage, DataPoint::Dim, 1> > VectorMap;
+
+    const std::size_t end = _nei.offsets[_i + 1];
+    for (std::size_t k = _nei.offsets[_i] + std::size_t(_first); k < end; k += std::size_t(_stride))
+    {
+        const int j = _nei.indices[k];
+        _fit.addNeighbor(DataPoint(VectorMap(_nei.positions + DataPoint::Dim * j).template cast<Scalar>(),
+                                   VectorMap(_nei.normals + DataPoint::Dim * j).template cast<Scalar>()));
+    }
+}
+
+/*!
+    \brief Fit the neighborhood of the evaluation point `_i` of `_nei`, with the weight function `_w`
+
+    Same as Basket::compute over the neighbors, passes included. Compiled for the host and the device:
+    csrBatchFitKernel calls it from a CUDA thread per evaluation point, and CPU code can call it on the same
+    buffers.
+
+    \return The state of the fit
+    \ingroup fitting
+*/
+template <typename Fit, typename Storage>
+PONCA_MULTIARCH inline FIT_RESULT fitCsrNeighborhood(Fit& _fit, int _i, const typename Fit::WFunctor& _w,
+                                                     const CsrNeighborhoods<Storage>& _nei)
+{
+    initCsrFit(_fit, _i, _w, _nei);
+    FIT_RESULT res;
+    do {
+        addCsrNeighbors(_fit, _i, _nei);
+        res = _fit.finalize();
+    } while (res == NEED_OTHER_PASS);
+    return res;
+}
+
+} // namespace Ponca
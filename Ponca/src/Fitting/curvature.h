@@ -54,8 +54,12 @@ private:
     typedef Eigen::Matrix<Scalar,2,2> Mat22; /*!< \brief Matrix type for shape operator */
 
 private:
-    Scalar m_k1, m_k2;
-    VectorType m_v1, m_v2;
+    // results, computed by computeCurvature()
+    mutable Scalar m_k1, m_k2;
+    mutable VectorType m_v1, m_v2;
+
+    bool m_lazy {false};                     /*!< \brief Compute the curvatures on first access */
+    mutable bool m_curvaturePending {false}; /*!< \brief The curvatures of the last fit are not computed yet */
 
     static_assert ( DataPoint::Dim == 3, "BaseCurvatureEstimator is only valid in 3D");
 
@@ -75,28 +79,28 @@ public:
     //! \brief Returns an estimate of the first principal curvature value
     //!
     //! It is the greatest curvature in <b>absolute value</b>.
-    PONCA_MULTIARCH inline Scalar k1() const { return m_k1; }
+    PONCA_MULTIARCH inline Scalar k1() const { update(); return m_k1; }
 
     //! \brief Returns an estimate of the second principal curvature value
     //!
     //! It is the smallest curvature in <b>absolute value</b>.
-    PONCA_MULTIARCH inline Scalar k2() const { return m_k2; }
+    PONCA_MULTIARCH inline Scalar k2() const { update(); return m_k2; }
 
     //! \brief Returns an estimate of the first principal curvature direction
     //!
     //! It is the greatest curvature in <b>absolute value</b>.
-    PONCA_MULTIARCH inline VectorType k1Direction() const { return m_v1; }
+    PONCA_MULTIARCH inline VectorType k1Direction() const { update(); return m_v1; }
 
     //! \brief Returns an estimate of the second principal curvature direction
     //!
     //! It is the smallest curvature in <b>absolute value</b>.
-    PONCA_MULTIARCH inline VectorType k2Direction() const { return m_v2; }
+    PONCA_MULTIARCH inline VectorType k2Direction() const { update(); return m_v2; }
 
     //! \brief Returns an estimate of the mean curvature
-    PONCA_MULTIARCH inline Scalar kMean() const { return (m_k1 + m_k2)/2.;}
+    PONCA_MULTIARCH inline Scalar kMean() const { update(); return (m_k1 + m_k2)/2.;}
 
     //! \brief Returns an estimate of the Gaussian curvature
-    PONCA_MULTIARCH inline Scalar GaussianCurvature() const { return m_k1 * m_k2;}
+    PONCA_MULTIARCH inline Scalar GaussianCurvature() const { update(); return m_k1 * m_k2;}
 
     //! \brief Compute principal curvature directions
     //!
@@ -104,11 +108,25 @@ public:
     //! derivatives, depending of the useNormal parameter
     //!
     //! The finalize() method calls this function with useNormal=false by
-    //! default.
+    //! default, or the first access to the curvatures in lazy mode.
+    //!
+    PONCA_MULTIARCH inline FIT_RESULT computeCurvature(bool useNormal = false) const;
+
+    //! \brief Compute the curvatures on their first access instead of in finalize()
     //!
-    PONCA_MULTIARCH inline FIT_RESULT computeCurvature(bool useNormal = false);
+    //! The fits whose curvatures are not read, e.g. in a pipeline reading only the normals, skip the tangent
+    //! plane construction and the eigen decomposition of the shape operator, and the \c dNormal() of the previous
+    //! basket elements when they are also lazy. finalize() then cannot report the failure of the eigen
+    //! decomposition: the curvatures are left unchanged instead.
+    //! The first access is not thread-safe: a fit shared between threads must be read once before.
+    PONCA_MULTIARCH inline void setLazyCurvature(bool lazy) { m_lazy = lazy; }
+    //! \brief Tell if the curvatures are computed on first access, see setLazyCurvature()
+    PONCA_MULTIARCH inline bool isLazyCurvature() const { return m_lazy; }
 
 protected:
+    //! \brief Compute the curvatures of the last fit if still pending
+    PONCA_MULTIARCH inline void update() const { if (m_curvaturePending) computeCurvature(false); }
+
     //! \brief Compute a tangent plane basis
     PONCA_MULTIARCH inline Mat32 tangentPlane(bool useNormal = false) const;
 };
@@ -12,7 +12,8 @@ CurvatureEstimator<DataPoint, _WFunctor, T>::finalize()
 {
     FIT_RESULT bResult = Base::finalize();
 
-    if(bResult != UNDEFINED)
+    m_curvaturePending = bResult != UNDEFINED;
+    if(m_curvaturePending && !m_lazy)
     {
         return computeCurvature(false);
     }
@@ -21,10 +22,12 @@ CurvatureEstimator<DataPoint, _WFunctor, T>::finalize()
 }
 
 template < class DataPoint, class _WFunctor, typename T>
-FIT_RESULT CurvatureEstimator<DataPoint, _WFunctor, T>::computeCurvature(bool useNormal)
+FIT_RESULT CurvatureEstimator<DataPoint, _WFunctor, T>::computeCurvature(bool useNormal) const
 {
     PONCA_MULTIARCH_STD_MATH(abs);
 
+    m_curvaturePending = false;
+
     // Get the object space Weingarten map dN
     MatrixType dN = Base::dNormal().template middleCols<DataPoint::Dim>(Base::isScaleDer() ? 1: 0);
 
@@ -64,7 +67,7 @@ FIT_RESULT CurvatureEstimator<DataPoint, _WFunctor, T>::computeCurvature(bool us
 
     if(abs(m_k1)<abs(m_k2))
     {
-#ifdef __CUDACC__
+#ifdef PONCA_GPU_COMPILER
       Scalar tmpk = m_k1;
       m_k1 = m_k2;
       m_k2 = tmpk;
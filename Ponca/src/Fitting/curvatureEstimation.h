@@ -116,6 +116,12 @@ public:
     typedef typename DataPoint::MatrixType MatrixType;  /*!< \brief Matrix type inherited from DataPoint*/
     /*! \brief Solver used to analyse the covariance matrix*/
     typedef Eigen::SelfAdjointEigenSolver<MatrixType> Solver;
+    /*! \brief Number of normals accumulated at once by addNeighbors */
+    enum { BlockSize = 16 };
+    /*! \brief Block of normals stored by coordinates (structure of arrays), one normal per row */
+    typedef Eigen::Matrix<Scalar, BlockSize, 3> NormalBlock;
+    /*! \brief Sums of the blocks per row: upper triangle of the covariance, and normals */
+    typedef Eigen::Array<Scalar, BlockSize, 9> BlockSums;
 
 protected:
     MatrixType m_cov;   /*!< \brief Covariance matrix */
@@ -139,8 +145,30 @@ public:
     /*! \copydoc Concept::FittingProcedureConcept::addNeighbor() */
     PONCA_MULTIARCH inline bool addNeighbor(const DataPoint &_nei);
 
+    /*!
+        \brief Add the neighbors in `[_begin, _end)`, returns the number of neighbors used
+
+        Same as calling #addNeighbor on each neighbor, the normals of the neighbors used being gathered in a
+        #NormalBlock and accumulated #BlockSize at a time with vectorized products.
+        \warning Calls the addNeighbor method of the lower levels of the Basket only, skipping the extensions that
+        follow this one.
+        \see Concept::FittingProcedureConcept::addNeighbors
+    */
+    template <typename IteratorBegin, typename IteratorEnd>
+    PONCA_MULTIARCH inline int addNeighbors(const IteratorBegin& _begin, const IteratorEnd& _end);
+
+    /*!
+        \brief Add the neighbors accumulated by `_other`, as if they were added to this fit
+        \see Basket::merge
+    */
+    PONCA_MULTIARCH inline void merge(const NormalCovarianceCurvature& _other);
+
     /*! \copydoc Concept::FittingProcedureConcept::finalize() */
     PONCA_MULTIARCH inline FIT_RESULT finalize();
+
+protected:
+    /*! \brief Accumulate a block of normals in `_sums`, the unused rows being set to zero */
+    PONCA_MULTIARCH inline void accumulateNormals(const NormalBlock& _normals, BlockSums& _sums);
 };
 
 
@@ -191,6 +219,12 @@ public:
     typedef typename VectorType::Index Index;
     /*! \brief Solver used to analyse the covariance matrix*/
     typedef Eigen::SelfAdjointEigenSolver<Mat22> Solver;
+    /*! \brief Number of normals accumulated at once by addNeighbors */
+    enum { BlockSize = 16 };
+    /*! \brief Block of normals stored by coordinates (structure of arrays), one normal per row */
+    typedef Eigen::Matrix<Scalar, BlockSize, 3> NormalBlock;
+    /*! \brief Sums of the projected blocks per row: upper triangle of the covariance, and projected normals */
+    typedef Eigen::Array<Scalar, BlockSize, 5> BlockSums;
 
 protected:
     Vector2 m_cog;      /*!< \brief Gravity center */
@@ -212,9 +246,24 @@ public:
     /*! \copydoc Concept::FittingProcedureConcept::addNeighbor() */
     PONCA_MULTIARCH inline bool addNeighbor(const DataPoint &_nei);
 
+    /*!
+        \brief Add the neighbors in `[_begin, _end)`, returns the number of neighbors used
+
+        Same as calling #addNeighbor on each neighbor. In the second pass, the normals of the neighbors used are
+        gathered in a #NormalBlock, projected and accumulated #BlockSize at a time with vectorized products.
+        \warning Calls the addNeighbor method of the lower levels of the Basket only, skipping the extensions that
+        follow this one.
+        \see Concept::FittingProcedureConcept::addNeighbors
+    */
+    template <typename IteratorBegin, typename IteratorEnd>
+    PONCA_MULTIARCH inline int addNeighbors(const IteratorBegin& _begin, const IteratorEnd& _end);
+
     /*! \copydoc Concept::FittingProcedureConcept::finalize() */
     PONCA_MULTIARCH inline FIT_RESULT finalize();
 
+protected:
+    /*! \brief Accumulate a block of normals projected on the tangent plane in `_sums`, the unused rows being set to zero */
+    PONCA_MULTIARCH inline void accumulateNormals(const NormalBlock& _normals, BlockSums& _sums);
 };
 
 #include "curvatureEstimation.hpp"
@@ -36,6 +36,66 @@ NormalCovarianceCurvature<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint&
     return bResult;
 }
 
+template < class DataPoint, class _WFunctor, typename T>
+void
+NormalCovarianceCurvature<DataPoint, _WFunctor, T>::merge(const NormalCovarianceCurvature& _other)
+{
+    Base::merge(_other);
+    m_cov += _other.m_cov;
+    m_cog += _other.m_cog;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+template <typename IteratorBegin, typename IteratorEnd>
+int
+NormalCovarianceCurvature<DataPoint, _WFunctor, T>::addNeighbors(const IteratorBegin& _begin, const IteratorEnd& _end)
+{
+    NormalBlock normals;
+    BlockSums sums = BlockSums::Zero();
+    int count = 0, nbAdded = 0;
+    for (auto it = _begin; it != _end; ++it)
+    {
+        const DataPoint& nei = *it;
+        if(Base::addNeighbor(nei))
+        {
+            normals.row(count) = nei.normal().transpose();
+            ++nbAdded;
+            if(++count == BlockSize)
+            {
+                accumulateNormals(normals, sums);
+                count = 0;
+            }
+        }
+    }
+    if(count > 0)
+    {
+        normals.bottomRows(BlockSize - count).setZero();
+        accumulateNormals(normals, sums);
+    }
+
+    // reduce the lanes: upper triangle of the covariance, then the sum of the normals
+    const Eigen::Matrix<Scalar, 1, 9> s = sums.colwise().sum();
+    m_cov(0,0) += s(0); m_cov(0,1) += s(1); m_cov(0,2) += s(2);
+    m_cov(1,1) += s(3); m_cov(1,2) += s(4); m_cov(2,2) += s(5);
+    m_cov(1,0) = m_cov(0,1); m_cov(2,0) = m_cov(0,2); m_cov(2,1) = m_cov(1,2);
+    m_cog += s.template tail<3>().transpose();
+    return nbAdded;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+NormalCovarianceCurvature<DataPoint, _WFunctor, T>::accumulateNormals(const NormalBlock& _normals, BlockSums& _sums)
+{
+    const auto n = _normals.array();
+    _sums.col(0) += n.col(0) * n.col(0);
+    _sums.col(1) += n.col(0) * n.col(1);
+    _sums.col(2) += n.col(0) * n.col(2);
+    _sums.col(3) += n.col(1) * n.col(1);
+    _sums.col(4) += n.col(1) * n.col(2);
+    _sums.col(5) += n.col(2) * n.col(2);
+    _sums.template rightCols<3>() += n;
+}
+
 template < class DataPoint, class _WFunctor, typename T>
 FIT_RESULT
 NormalCovarianceCurvature<DataPoint, _WFunctor, T>::finalize ()
@@ -110,7 +170,7 @@ ProjectedNormalCovarianceCurvature<DataPoint, _WFunctor, T>::addNeighbor(const D
     }
     else if(m_pass == SECOND_PASS)
     {
-        VectorType q = _nei.pos() - Base::m_evalPos;
+        VectorType q = _nei.pos() - Base::basisCenter();
         if(Base::m_w.w(q, _nei)>0)
         {
             // project normal on plane
@@ -125,6 +185,66 @@ ProjectedNormalCovarianceCurvature<DataPoint, _WFunctor, T>::addNeighbor(const D
     return false;
 }
 
+template < class DataPoint, class _WFunctor, typename T>
+template <typename IteratorBegin, typename IteratorEnd>
+int
+ProjectedNormalCovarianceCurvature<DataPoint, _WFunctor, T>::addNeighbors(const IteratorBegin& _begin, const IteratorEnd& _end)
+{
+    int nbAdded = 0;
+    if(m_pass == FIRST_PASS)
+    {
+        for (auto it = _begin; it != _end; ++it)
+            if(Base::addNeighbor(*it))
+                ++nbAdded;
+    }
+    else if(m_pass == SECOND_PASS)
+    {
+        NormalBlock normals;
+        BlockSums sums = BlockSums::Zero();
+        int count = 0;
+        for (auto it = _begin; it != _end; ++it)
+        {
+            const DataPoint& nei = *it;
+            VectorType q = nei.pos() - Base::basisCenter();
+            if(Base::m_w.w(q, nei)>0)
+            {
+                normals.row(count) = nei.normal().transpose();
+                ++nbAdded;
+                if(++count == BlockSize)
+                {
+                    accumulateNormals(normals, sums);
+                    count = 0;
+                }
+            }
+        }
+        if(count > 0)
+        {
+            normals.bottomRows(BlockSize - count).setZero();
+            accumulateNormals(normals, sums);
+        }
+
+        // reduce the lanes: upper triangle of the covariance, then the sum of the projections
+        const Eigen::Matrix<Scalar, 1, 5> s = sums.colwise().sum();
+        m_cov(0,0) += s(0); m_cov(0,1) += s(1); m_cov(1,1) += s(2);
+        m_cov(1,0) = m_cov(0,1);
+        m_cog += s.template tail<2>().transpose();
+    }
+    return nbAdded;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+ProjectedNormalCovarianceCurvature<DataPoint, _WFunctor, T>::accumulateNormals(const NormalBlock& _normals, BlockSums& _sums)
+{
+    // project normals on plane
+    const Eigen::Array<Scalar, BlockSize, 2> proj = _normals.lazyProduct(m_tframe).array();
+
+    _sums.col(0) += proj.col(0) * proj.col(0);
+    _sums.col(1) += proj.col(0) * proj.col(1);
+    _sums.col(2) += proj.col(1) * proj.col(1);
+    _sums.template rightCols<2>() += proj;
+}
+
 template < class DataPoint, class _WFunctor, typename T>
 FIT_RESULT
 ProjectedNormalCovarianceCurvature<DataPoint, _WFunctor, T>::finalize ()
@@ -30,6 +30,84 @@ namespace Ponca
         NBMAX /*!< \brief Nb enums */
     };
 
+   /*!
+      Eigen decomposition of the covariance matrix used by CovariancePlaneFit and CovarianceLineFit, see
+      CovariancePlaneFit::setSolver and CovarianceLineFit::setSolver, and of the eigenproblem of SphereFit, see
+      SphereFit::setSolver
+
+      \ingroup fitting
+    */
+    enum COVARIANCE_SOLVER : unsigned char
+    {
+        /*! \brief Iterative QL decomposition (Eigen::SelfAdjointEigenSolver::compute): the most accurate, and the
+          slowest. 2D fits use #DIRECT_SOLVER instead, whose closed form is exact for 2x2 matrices */
+        ITERATIVE_SOLVER = 0,
+        /*! \brief Closed-form decomposition of 2x2 and 3x3 matrices (Eigen::SelfAdjointEigenSolver::computeDirect),
+          several times faster. The eigenvectors of close eigenvalues are less accurate, e.g. the normal of nearly
+          isotropic neighborhoods. Same as #ITERATIVE_SOLVER in other dimensions. For SphereFit, one-sided Jacobi
+          sweeps, more accurate than #ITERATIVE_SOLVER */
+        DIRECT_SOLVER,
+        /*! \brief Inverse power iterations computing only the eigenvector of the smallest eigenvalue, i.e. the normal.
+          Converges quickly for flat neighborhoods, as the ratio of the two smallest eigenvalues, but stops after a
+          fixed number of iterations otherwise. The full decomposition is not computed: solver() and the tangent plane
+          basis (used by the derivatives and MongePatch) are not available. CPU only, #DIRECT_SOLVER on GPU */
+        SMALLEST_EIGENVECTOR_SOLVER,
+        /*! \brief Repeated squaring of the matrix computing only the eigenvector of the largest eigenvalue, i.e. the
+          direction of CovarianceLineFit, see internal::largestEigenvector. A fixed number of matrix products, without
+          branches: the error decreases as a power of the ratio of the two largest eigenvalues, quickly for elongated
+          neighborhoods. solver() is not available. Same as #DIRECT_SOLVER for CovariancePlaneFit */
+        LARGEST_EIGENVECTOR_SOLVER
+    };
+
+   /*!
+      Solver of the generalized eigenproblem of UnorientedSphereFit, see UnorientedSphereFit::setSolver
+
+      \ingroup fitting
+    */
+    enum UNORIENTED_SPHERE_SOLVER : unsigned char
+    {
+        /*! \brief General eigen decomposition (Eigen::EigenSolver) of the non-symmetric product of the inverse of the
+          normalization matrix with the covariance matrix: the reference, and the slowest */
+        GENERAL_EIGEN_SOLVER = 0,
+        /*! \brief Generalized symmetric decomposition (Eigen::GeneralizedSelfAdjointEigenSolver), from a Cholesky
+          factorization of the normalization matrix: same accuracy, faster */
+        GENERALIZED_SELFADJOINT_SOLVER,
+        /*! \brief Power iterations computing only the eigenvector of the largest eigenvalue, starting from the
+          solution of the previous fit when the same fit is reused for nearby evaluation positions. Converges as the
+          ratio of the two largest eigenvalues, and stops after a fixed number of iterations. The only solver
+          available on GPU */
+        POWER_ITERATION_SOLVER
+    };
+
+   /*!
+      Robust weight of the residuals used by IrlsReweighting, see IrlsReweighting::setRobustWeight
+      \ingroup fitting
+    */
+    enum ROBUST_WEIGHT : unsigned char
+    {
+        /*! \brief Tukey biweight \f$ (1 - (r/c)^2)^2 \f$ for \f$ |r| < c \f$, 0 otherwise: the neighbors beyond the
+          threshold are rejected */
+        TUKEY_WEIGHT = 0,
+        /*! \brief Huber weight \f$ \min(1, c/|r|) \f$: the neighbors beyond the threshold are down-weighted but
+          never rejected, converging more reliably from a poor initial fit */
+        HUBER_WEIGHT
+    };
+
+   /*!
+      Fits of the grid vertices evaluated by PotentialGrid, see PotentialGrid::setFitMode
+      \ingroup fitting
+    */
+    enum GRID_FIT : unsigned char
+    {
+        /*! \brief A fit per vertex, over the neighbors gathered once per block of vertices: the values of a fresh
+          fit at each vertex */
+        GRID_FIT_PER_VERTEX = 0,
+        /*! \brief A single fit per block of vertices, at the center of the block, evaluated at all its vertices:
+          the fastest, but the values are only continuous within the blocks. The blocks whose center has no stable
+          fit fall back to #GRID_FIT_PER_VERTEX */
+        GRID_FIT_PER_BLOCK
+    };
+
 namespace internal
 {
   /// \internal
@@ -0,0 +1,238 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+#include "basket.h"
+#include "computeAll.h"
+#include "covariancePlaneFit.h"
+#include "gls.h"
+#include "meanPlaneFit.h"
+#include "orientedSphereFit.h"
+#include "sphereFit.h"
+#include "unorientedSphereFit.h"
+#include "weightFunc.h"
+#include "weightKernel.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Ponca
+{
+
+namespace internal
+{
+    /*! \brief Tell if a point provides a `normal()` */
+    template <class DataPoint, typename = void>
+    struct HasNormal : std::false_type {};
+
+    template <class DataPoint>
+    struct HasNormal<DataPoint, decltype(void(std::declval<const DataPoint&>().normal()))> : std::true_type {};
+
+    /*! \brief Tell if a fit provides a GLS curvature `kappa()` */
+    template <class Fit, typename = void>
+    struct HasKappa : std::false_type {};
+
+    template <class Fit>
+    struct HasKappa<Fit, decltype(void(std::declval<const Fit&>().kappa()))> : std::true_type {};
+} // namespace internal
+
+/*!
+    \brief Results of a batch of fits computed by a FitEngine, one entry per point of the tree
+
+    The entries of the points that are not fitted, or whose fit is not stable, are left to zero.
+    \ingroup fitting
+*/
+template <class DataPoint>
+struct FitEngineOutput
+{
+    typedef typename DataPoint::Scalar     Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    std::vector<FIT_RESULT> states;       /*!< \brief State of the fit of each point */
+    std::vector<Scalar>     potentials;   /*!< \brief Potential of the fitted primitive at the point */
+    std::vector<VectorType> normals;      /*!< \brief Unit gradient of the fitted primitive at the point */
+    std::vector<VectorType> projections;  /*!< \brief Projection of the point on the fitted primitive */
+    std::vector<Scalar>     curvatures;   /*!< \brief GLS curvature, empty when the fit does not provide it */
+
+    /*! \brief Size the outputs for `count` points, without curvatures unless `curvature` */
+    inline void reset(int count, bool curvature)
+    {
+        states.assign(count, UNDEFINED);
+        potentials.assign(count, Scalar(0));
+        normals.assign(count, VectorType::Zero());
+        projections.assign(count, VectorType::Zero());
+        curvatures.assign(curvature ? count : 0, Scalar(0));
+    }
+};
+
+/*!
+    \brief Fitting procedure selected at runtime, fitting whole batches behind a virtual interface
+
+    A FitEngine hides the Basket type of a fit: pipelines configured at runtime pick an engine by its name in a
+    FitEngineRegistry, instead of switching over the Basket types. The virtual calls are made once per batch,
+    the fits of the batch running the code of the Basket, as computeAll.
+
+    \code
+    auto registry = FitEngineRegistry<Point, KdTree<Point>>::withDefaults();
+    std::unique_ptr<FitEngine<Point, KdTree<Point>>> engine = registry.create(config.fit); // e.g. "oriented_sphere"
+    FitEngineOutput<Point> output;
+    engine->computeAll(kdtree, scale, output);
+    \endcode
+
+    \tparam TreeT Spatial structure of the points, as for computeAll
+    \see FitEngineImpl, FitEngineRegistry
+    \ingroup fitting
+*/
+template <class DataPoint, class TreeT>
+class FitEngine
+{
+public:
+    typedef typename DataPoint::Scalar Scalar;
+    typedef FitEngineOutput<DataPoint> Output;
+
+    virtual ~FitEngine() = default;
+
+    /*! \brief Tell if the fits provide FitEngineOutput::curvatures */
+    virtual bool providesCurvature() const = 0;
+
+    /*! \brief Fit the neighborhood of radius `scale` of each point of `tree`, see computeAll */
+    virtual void computeAll(const TreeT& tree, Scalar scale, Output& output) const = 0;
+
+    /*! \brief Fit the neighborhood of each point of `tree` at its own scale `scales[i]`, see computeAllAdaptive */
+    virtual void computeAllAdaptive(const TreeT& tree, const std::vector<Scalar>& scales, Output& output) const = 0;
+};
+
+/*!
+    \brief FitEngine running the Basket `Fit`
+
+    \tparam Fit Fitting procedure, e.g. a Basket, whose weight function is constructible from a scale
+    \ingroup fitting
+*/
+template <class Fit, class TreeT>
+class FitEngineImpl : public FitEngine<typename Fit::DataPoint, TreeT>
+{
+public:
+    typedef FitEngine<typename Fit::DataPoint, TreeT> Base;
+    typedef typename Base::Scalar Scalar;
+    typedef typename Base::Output Output;
+
+    bool providesCurvature() const override { return internal::HasKappa<Fit>::value; }
+
+    void computeAll(const TreeT& tree, Scalar scale, Output& output) const override
+    {
+        output.reset(tree.point_count(), providesCurvature());
+        Ponca::computeAll<Fit>(tree, scale,
+                               [&](int i, const Fit& fit, FIT_RESULT res) { store(tree, i, fit, res, output); });
+    }
+
+    void computeAllAdaptive(const TreeT& tree, const std::vector<Scalar>& scales, Output& output) const override
+    {
+        output.reset(tree.point_count(), providesCurvature());
+        Ponca::computeAllAdaptive<Fit>(tree, scales,
+                                       [&](int i, const Fit& fit, FIT_RESULT res) { store(tree, i, fit, res, output); });
+    }
+
+private:
+    static inline void store(const TreeT& tree, int i, const Fit& fit, FIT_RESULT res, Output& output)
+    {
+        output.states[i] = res;
+        if (res != STABLE)
+            return;
+        const auto& p = tree.point(i).pos();
+        output.potentials[i]  = fit.potential(p);
+        output.normals[i]     = fit.primitiveGradient(p).normalized();
+        output.projections[i] = fit.project(p);
+        if constexpr (internal::HasKappa<Fit>::value)
+            output.curvatures[i] = fit.kappa();
+    }
+};
+
+/*!
+    \brief Factories of FitEngine by name, for the pipelines selecting their fit at runtime
+
+    withDefaults() registers the common Baskets, with a DistWeightFunc of SmoothWeightKernel:
+     - `"plane"`: CovariancePlaneFit,
+     - `"sphere"`: SphereFit with GLSParam,
+     and, when DataPoint provides normals:
+     - `"mean_plane"`: MeanPlaneFit,
+     - `"oriented_sphere"`: OrientedSphereFit with GLSParam,
+     - `"unoriented_sphere"`: UnorientedSphereFit with GLSParam.
+
+    Other Baskets are registered by add().
+    \ingroup fitting
+*/
+template <class DataPoint, class TreeT>
+class FitEngineRegistry
+{
+public:
+    typedef FitEngine<DataPoint, TreeT> Engine;
+    typedef std::function<std::unique_ptr<Engine>()> Factory;
+
+    /*! \brief Registry of the common Baskets described above */
+    static inline FitEngineRegistry withDefaults()
+    {
+        typedef typename DataPoint::Scalar Scalar;
+        typedef DistWeightFunc<DataPoint, SmoothWeightKernel<Scalar>> WeightFunc;
+
+        FitEngineRegistry registry;
+        registry.template add<Basket<DataPoint, WeightFunc, CovariancePlaneFit>>("plane");
+        registry.template add<Basket<DataPoint, WeightFunc, SphereFit, GLSParam>>("sphere");
+        if constexpr (internal::HasNormal<DataPoint>::value)
+        {
+            registry.template add<Basket<DataPoint, WeightFunc, MeanPlaneFit>>("mean_plane");
+            registry.template add<Basket<DataPoint, WeightFunc, OrientedSphereFit, GLSParam>>("oriented_sphere");
+            registry.template add<Basket<DataPoint, WeightFunc, UnorientedSphereFit, GLSParam>>("unoriented_sphere");
+        }
+        return registry;
+    }
+
+    /*! \brief Register the Basket `Fit` under `name`, replacing the engine of the same name */
+    template <class Fit>
+    inline void add(const std::string& name)
+    {
+        add(name, []() -> std::unique_ptr<Engine> { return std::make_unique<FitEngineImpl<Fit, TreeT>>(); });
+    }
+
+    /*! \brief Register `factory` under `name`, replacing the engine of the same name */
+    inline void add(const std::string& name, Factory factory) { m_factories[name] = std::move(factory); }
+
+    inline bool contains(const std::string& name) const { return m_factories.count(name) != 0; }
+
+    /*! \brief Names of the registered engines, sorted */
+    inline std::vector<std::string> names() const
+    {
+        std::vector<std::string> result;
+        for (const auto& f : m_factories)
+            result.push_back(f.first);
+        return result;
+    }
+
+    /*!
+        \brief New engine registered under `name`
+        \throw std::invalid_argument when no engine is registered under `name`
+    */
+    inline std::unique_ptr<Engine> create(const std::string& name) const
+    {
+        const auto it = m_factories.find(name);
+        if (it == m_factories.end())
+            throw std::invalid_argument("FitEngineRegistry: unknown fit \"" + name + "\"");
+        return it->second();
+    }
+
+private:
+    std::map<std::string, Factory> m_factories;
+};
+
+} // namespace Ponca
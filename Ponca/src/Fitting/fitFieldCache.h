@@ -0,0 +1,342 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+#include "computeAll.h"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace Ponca
+{
+
+/*!
+    \brief Algebraic spheres fitted once at the points of a tree, blended to answer the queries at other positions
+
+    Rendering a point set surface evaluates `potential`, `primitiveGradient` or `project` at many positions, e.g.
+    the samples of the rays, most of them close to positions already fitted. The cache fits the neighborhood of
+    radius `scale` of each point of the tree once, with computeAll, and stores the parameters of its
+    AlgebraicSphere (\f$ u_c \f$, \f$ \mathbf{u_l} \f$, \f$ u_q \f$, basis center), normalized with the Pratt norm.
+
+    A query \f$ \mathbf{q} \f$ blends the spheres cached at the points within `blendRadius * scale`: they are
+    expressed in the basis centered at \f$ \mathbf{q} \f$, normalized, and averaged with the weights
+    \f$ (1 - d^2/r^2)^2 \f$ of their distance \f$ d \f$ to the query. Their potentials at \f$ \mathbf{q} \f$
+    approximate the distance to the surface: when one of them differs from the blended potential by more than
+    `tolerance * scale`, the spheres do not agree and the query is fitted again over the points, as a fit
+    initialized at \f$ \mathbf{q} \f$ would do. The queries without cached sphere around them are fitted as well.
+
+    The cached spheres of the unoriented fits are flipped to agree with the closest one.
+
+    \code
+    FitFieldCache<Fit, KdTree<Point> > cache(kdtree, scale);
+    cache.setTolerance(Scalar(1e-3)); // closer to the fits, fitting more queries again
+    FitFieldCache<Fit, KdTree<Point> >::Context context(cache);
+    FitFieldCache<Fit, KdTree<Point> >::Sphere sphere;
+    if (cache.sphereAt(q, sphere, context) == STABLE)
+        proj = sphere.project(q);
+    \endcode
+
+    \tparam Fit Fitting procedure of an AlgebraicSphere, e.g. a Basket of OrientedSphereFit, whose weight function
+    is constructible from `scale`
+    \tparam TreeT Spatial structure providing `index_count()`, `index_buffer()`, `point_count()`, `point(i)` and
+    `range_neighbors(point, radius)` returning a query rebindable with `operator()(point, radius)`, e.g. KdTree
+    \see MlsProjection to project on the surface by fitting at each iteration
+    \ingroup fitting
+*/
+template <typename Fit, typename TreeT>
+class FitFieldCache
+{
+public:
+    typedef typename Fit::DataPoint  DataPoint;  /*!< \brief Point type of the fit */
+    typedef typename Fit::Scalar     Scalar;     /*!< \brief Scalar type of the fit */
+    typedef typename Fit::VectorType VectorType; /*!< \brief Vector type of the fit */
+    typedef typename Fit::WFunctor   WeightFunc; /*!< \brief Weight function of the fit */
+
+    /*! \brief Parameters of an algebraic sphere in the basis centered at #basis, see AlgebraicSphere */
+    struct Sphere
+    {
+        VectorType basis {VectorType::Zero()}; /*!< \brief Basis center */
+        Scalar uc {0};                         /*!< \brief Constant parameter */
+        VectorType ul {VectorType::Zero()};    /*!< \brief Linear parameter */
+        Scalar uq {0};                         /*!< \brief Quadratic parameter */
+
+        /*! \brief Value of the scalar field at `_q` */
+        inline Scalar potential(const VectorType& _q) const
+        {
+            const VectorType lq = _q - basis;
+            return uc + lq.dot(ul) + uq * lq.squaredNorm();
+        }
+
+        /*! \brief Gradient of the scalar field at `_q`, not normalized */
+        inline VectorType primitiveGradient(const VectorType& _q) const
+        {
+            return ul + Scalar(2) * uq * (_q - basis);
+        }
+
+        /*! \brief Projection of `_q` on the sphere, as AlgebraicSphere::project */
+        inline VectorType project(const VectorType& _q) const
+        {
+            const VectorType lq = _q - basis;
+            const Scalar potential = uc + lq.dot(ul) + uq * lq.squaredNorm();
+            const VectorType grad = ul + Scalar(2) * uq * lq;
+            const Scalar norm = grad.norm();
+
+            Scalar t;
+            if (Eigen::internal::isMuchSmallerThan(std::abs(uq), Scalar(1), Eigen::NumTraits<Scalar>::dummy_precision()))
+                t = -potential / (norm * norm);
+            else
+                t = -(norm - std::sqrt(norm * norm - Scalar(4) * uq * potential)) / (Scalar(2) * uq * norm);
+            return basis + lq + t * grad;
+        }
+
+        /*! \brief Express the sphere in the basis centered at `_basis`, normalized, as AlgebraicSphere::changeBasis */
+        inline void changeBasis(const VectorType& _basis)
+        {
+            const VectorType diff = basis - _basis;
+            uc = uc - ul.dot(diff) + uq * diff.squaredNorm();
+            ul = ul - Scalar(2) * uq * diff;
+            basis = _basis;
+            normalize();
+        }
+
+        /*! \brief Apply the Pratt norm, see AlgebraicSphere::applyPrattNorm */
+        inline void normalize()
+        {
+            const Scalar prattNorm2 = ul.squaredNorm() - Scalar(4) * uc * uq;
+            if (prattNorm2 > Scalar(0))
+            {
+                const Scalar prattNorm = std::sqrt(prattNorm2);
+                uc /= prattNorm;
+                ul /= prattNorm;
+                uq /= prattNorm;
+            }
+        }
+    };
+
+    /*!
+        \brief Range query and buffers used by the queries of a thread
+
+        A context is not thread-safe, each thread must own its context. It keeps its buffer capacity from one
+        query to the next, and counts the queries answered by the cache.
+    */
+    class Context
+    {
+    public:
+        /*! \brief Context of the queries of `_cache`, which must outlive it */
+        explicit inline Context(const FitFieldCache& _cache)
+            : m_query(_cache.m_tree->range_neighbors(VectorType::Zero(), Scalar(0))) {}
+
+        /*! \brief Number of queries answered by blending the cached spheres */
+        inline int cachedCount() const { return m_cachedCount; }
+        /*! \brief Number of queries fitted again over the points */
+        inline int refitCount() const { return m_refitCount; }
+
+    private:
+        friend class FitFieldCache;
+        typedef decltype(std::declval<const TreeT&>().range_neighbors(std::declval<VectorType>(), Scalar())) Query;
+
+        Query m_query;                                  /*!< \brief Range query, rebound to the new positions */
+        std::vector<std::pair<Scalar, Sphere>> m_blend; /*!< \brief Weighted spheres blended by the last query */
+        std::vector<DataPoint> m_neighbors;             /*!< \brief Neighbors of the last fit */
+        int m_cachedCount {0};                          /*!< \brief Queries answered by the cache */
+        int m_refitCount {0};                           /*!< \brief Queries fitted again */
+    };
+
+    /*!
+        \brief Fit and cache the neighborhood of radius `_scale` of each point indexed by `_tree`
+        \param _tree Spatial structure, which must outlive the cache
+    */
+    inline FitFieldCache(const TreeT& _tree, Scalar _scale)
+        : m_tree(&_tree), m_scale(_scale), m_spheres(_tree.point_count()), m_cached(_tree.point_count(), 0)
+    {
+        computeAll<Fit>(_tree, _scale, [this](int i, const Fit& fit, FIT_RESULT res) {
+            if (res != STABLE)
+                return;
+            Sphere& s = m_spheres[i];
+            s.basis = fit.basisCenter();
+            s.uc = fit.m_uc;
+            s.ul = fit.m_ul;
+            s.uq = fit.m_uq;
+            s.normalize();
+            m_cached[i] = 1;
+        });
+    }
+
+    /*!
+        \brief Set the largest difference, relative to the scale, between the potentials of the blended spheres
+        at a query (default: 1e-2)
+
+        0 fits all the queries again over the points.
+    */
+    inline void setTolerance(Scalar _tolerance) { m_tolerance = _tolerance; }
+    inline Scalar tolerance() const { return m_tolerance; }
+
+    /*! \brief Set the radius, relative to the scale, of the cached spheres blended by a query (default: 0.5) */
+    inline void setBlendRadius(Scalar _blendRadius) { m_blendRadius = _blendRadius; }
+    inline Scalar blendRadius() const { return m_blendRadius; }
+
+    /*! \brief Scale of the fits */
+    inline Scalar scale() const { return m_scale; }
+
+    /*! \brief Tell if a stable sphere is cached at the point `_i` of the tree */
+    inline bool isCached(int _i) const { return m_cached[_i] != 0; }
+
+    /*! \brief Sphere cached at the point `_i` of the tree, when isCached(_i) */
+    inline const Sphere& cachedSphere(int _i) const { return m_spheres[_i]; }
+
+    /*!
+        \brief Sphere around `_q`, in the basis centered at `_q`, using the query and buffers of `_context`
+
+        \return #STABLE when the sphere is blended from the cache, and the state of the fit otherwise. `_sphere` is
+        not written when the fit is #UNDEFINED.
+    */
+    inline FIT_RESULT sphereAt(const VectorType& _q, Sphere& _sphere, Context& _context) const
+    {
+        if (m_tolerance > Scalar(0) && blend(_q, _sphere, _context))
+        {
+            ++_context.m_cachedCount;
+            return STABLE;
+        }
+        ++_context.m_refitCount;
+        return fit(_q, _sphere, _context);
+    }
+
+    /*! \brief Sphere around `_q` with a new context \see sphereAt(const VectorType&, Sphere&, Context&) */
+    inline FIT_RESULT sphereAt(const VectorType& _q, Sphere& _sphere) const
+    {
+        Context context(*this);
+        return sphereAt(_q, _sphere, context);
+    }
+
+    /*!
+        \brief Evaluate the `_n` queries of `_in`, in parallel
+
+        Each OpenMP thread owns a Context. When not null, `_potentials` receives the potential at each query,
+        `_gradients` the gradient (not normalized), `_projections` the projection of the query on its sphere, and
+        `_res` the state returned by sphereAt(). The outputs of the #UNDEFINED queries are not written.
+    */
+    inline void evaluateBatch(const VectorType* _in, int _n, Scalar* _potentials, VectorType* _gradients = nullptr,
+                              VectorType* _projections = nullptr, FIT_RESULT* _res = nullptr) const
+    {
+        // number of queries taken at once by a thread: small enough to balance uneven neighborhoods
+        constexpr int chunk = 16;
+
+#pragma omp parallel
+        {
+            Context context(*this);
+            Sphere sphere;
+
+#pragma omp for schedule(dynamic, chunk)
+            for (int i = 0; i < _n; ++i)
+            {
+                const FIT_RESULT res = sphereAt(_in[i], sphere, context);
+                if (_res)
+                    _res[i] = res;
+                if (res == UNDEFINED)
+                    continue;
+                if (_potentials)
+                    _potentials[i] = sphere.potential(_in[i]);
+                if (_gradients)
+                    _gradients[i] = sphere.primitiveGradient(_in[i]);
+                if (_projections)
+                    _projections[i] = sphere.project(_in[i]);
+            }
+        }
+    }
+
+private:
+    /*! \brief Blend the cached spheres around `_q`, return false when there are none or they do not agree */
+    inline bool blend(const VectorType& _q, Sphere& _sphere, Context& _context) const
+    {
+        const Scalar radius = m_blendRadius * m_scale;
+        _context.m_blend.clear();
+        int closest = -1;
+        for (int j : _context.m_query(_q, radius))
+        {
+            if (!m_cached[j])
+                continue;
+            const Scalar d2 = (m_tree->point(j).pos() - _q).squaredNorm() / (radius * radius);
+            const Scalar w = (Scalar(1) - d2) * (Scalar(1) - d2);
+            if (w <= Scalar(0))
+                continue;
+            if (closest < 0 || w > _context.m_blend[closest].first)
+                closest = int(_context.m_blend.size());
+            Sphere s = m_spheres[j];
+            s.changeBasis(_q);
+            _context.m_blend.emplace_back(w, s);
+        }
+        if (closest < 0)
+            return false;
+
+        // orient the spheres as the closest one, and average them
+        const VectorType& reference = _context.m_blend[closest].second.ul;
+        Scalar sumW(0), uc(0), uq(0);
+        VectorType ul = VectorType::Zero();
+        for (auto& b : _context.m_blend)
+        {
+            if (b.second.ul.dot(reference) < Scalar(0))
+            {
+                b.second.uc = -b.second.uc;
+                b.second.ul = -b.second.ul;
+                b.second.uq = -b.second.uq;
+            }
+            sumW += b.first;
+            uc   += b.first * b.second.uc;
+            ul   += b.first * b.second.ul;
+            uq   += b.first * b.second.uq;
+        }
+        Sphere blended;
+        blended.basis = _q;
+        blended.uc = uc / sumW;
+        blended.ul = ul / sumW;
+        blended.uq = uq / sumW;
+        blended.normalize();
+
+        const Scalar maxDiff = m_tolerance * m_scale;
+        for (const auto& b : _context.m_blend)
+            if (std::abs(b.second.uc - blended.uc) > maxDiff)
+                return false;
+        _sphere = blended;
+        return true;
+    }
+
+    /*! \brief Fit the neighborhood of radius `scale` of `_q` */
+    inline FIT_RESULT fit(const VectorType& _q, Sphere& _sphere, Context& _context) const
+    {
+        _context.m_neighbors.clear();
+        for (int j : _context.m_query(_q, m_scale))
+            _context.m_neighbors.push_back(m_tree->point(j));
+
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(m_scale));
+        fit.init(_q);
+        const FIT_RESULT res = fit.compute(_context.m_neighbors.cbegin(), _context.m_neighbors.cend());
+        if (res == UNDEFINED)
+            return res;
+        _sphere.basis = fit.basisCenter();
+        _sphere.uc = fit.m_uc;
+        _sphere.ul = fit.m_ul;
+        _sphere.uq = fit.m_uq;
+        _sphere.normalize();
+        return res;
+    }
+
+    const TreeT* m_tree;                /*!< \brief Spatial structure indexing the points */
+    Scalar m_scale;                     /*!< \brief Scale of the fits */
+    Scalar m_tolerance {Scalar(1e-2)};  /*!< \brief Largest difference of the blended potentials, relative to the scale */
+    Scalar m_blendRadius {Scalar(0.5)}; /*!< \brief Radius of the blended spheres, relative to the scale */
+    std::vector<Sphere> m_spheres;      /*!< \brief Sphere cached at each point of the tree */
+    std::vector<char> m_cached;         /*!< \brief Tells if a stable sphere is cached at each point, written concurrently */
+};
+
+} // namespace Ponca
@@ -0,0 +1,56 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+namespace Ponca
+{
+
+/*!
+    \brief Compile-time memory footprint of a fitting procedure, e.g. a Basket
+
+    A fit holds all its state in the object: its size is the memory of a fit in flight, per thread on CPU and per
+    thread (registers and local memory) on GPU. The size grows with the extensions of the Basket, the derivatives
+    being the largest ones: MlsSphereFitDer stores several `MatrixArray` of `DerDim x Dim*DerDim` scalars.
+    \code
+    typedef Basket<Point, WeightFunc, OrientedSphereFit, OrientedSphereSpaceDer, MlsSphereFitDer> Fit;
+    static_assert(FitFootprint<Fit>::size <= 4096, "fit too large for the worker stacks");
+    std::cout << FitFootprint<Fit>::to_string("MlsSphereFitDer");
+    \endcode
+
+    \tparam Fit Fitting procedure
+    \ingroup fitting
+*/
+template <typename Fit>
+struct FitFootprint
+{
+    /*! \brief Bytes of a fit */
+    static constexpr std::size_t size = sizeof(Fit);
+    /*! \brief Alignment of a fit */
+    static constexpr std::size_t alignment = alignof(Fit);
+
+    /*! \brief Bytes of `_count` fits alive at once, e.g. one per thread in computeBatch */
+    static constexpr std::size_t batchSize(int _count) { return std::size_t(_count) * size; }
+
+    /*! \brief Number of fits held by `_bytes` of memory */
+    static constexpr std::size_t fitsIn(std::size_t _bytes) { return _bytes / size; }
+
+    /*! \brief Human readable report, the fit being called `_name` */
+    static inline std::string to_string(const std::string& _name)
+    {
+        std::stringstream str;
+        str << _name << ": " << size << " bytes (alignment " << alignment << ")\n";
+        return str.str();
+    }
+};
+
+} //namespace Ponca
@@ -17,7 +17,7 @@ typename GLSDer <DataPoint, _WFunctor, T>::ScalarArray
     ScalarArray dfield = Base::m_dUc;
     // Recall that tau is the field function at the evaluation point, we thus must take care about
     // its variation when differentiating in space:
-    if(this->isScaleDer())
+    if constexpr (Base::isSpaceDer())
       dfield.template tail<DataPoint::Dim>() += Base::m_ul;
 
     return (dfield * prattNorm - Base::m_uc * cfactor * Base::dprattNorm2()) / prattNorm2;
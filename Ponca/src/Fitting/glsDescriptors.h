@@ -0,0 +1,106 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+#include "scaleSweep.h"
+#include "../Common/Tracing.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace Ponca
+{
+
+/*!
+    \brief Number of values of the GLS descriptors of `scaleCount` scales written by computeGlsDescriptors
+    \ingroup fitting
+*/
+inline int glsDescriptorSize(int scaleCount, bool useFitness = true)
+{
+    return scaleCount * (useFitness ? 3 : 2);
+}
+
+/*!
+    \brief Compute the multi-scale GLS descriptor of each point indexed by `tree`, in parallel
+
+    The descriptor of the point `i` is written at `descriptors + i * glsDescriptorSize(scales.size(), useFitness)`:
+    for each scale \f$ t \f$ of `scales`, the values \f$ \frac{\tau}{t} \f$, \f$ t\kappa \f$ and, with `useFitness`,
+    the fitness of the fit of the neighborhood of radius \f$ t \f$ of the point (see GLSParam). The squared
+    euclidean distance between two descriptors is the sum over the scales of GLSParam::compareTo: the descriptors
+    are compared by arrays of floats, e.g. in a KdTreeDescriptorIndex, instead of pairs of fits.
+
+    The neighbors of a point are gathered once at the largest scale and sorted by distance, and the scales are
+    fitted by computeScaleSweep when it supports `Fit`, e.g. OrientedSphereFit with a constant or
+    SmoothWeightKernel, and from scratch at each scale otherwise.
+    The values of the scales whose fit is #UNDEFINED are zeros. When `states` is not null, the state of the fit
+    of the scale `k` of the point `i` is written at `states[i * scales.size() + k]`. The points that are not
+    indexed by the tree are not written.
+
+    \code
+    typedef Basket<Point, DistWeightFunc<Point, SmoothWeightKernel<Scalar> >, OrientedSphereFit, GLSParam> Fit;
+    std::vector<float> descriptors(kdtree.point_count() * glsDescriptorSize(int(scales.size())));
+    computeGlsDescriptors<Fit>(kdtree, scales, descriptors.data());
+    \endcode
+
+    \tparam Fit Fitting procedure providing GLSParam, e.g. a Basket, whose weight function has a compact support
+    (DistWeightFunc)
+    \tparam TreeT Spatial structure, as for computeAll
+    \param scales Random access container of increasing scales
+    \ingroup fitting
+*/
+template <typename Fit, typename TreeT, typename ScaleContainer, typename OutputScalar>
+inline void computeGlsDescriptors(const TreeT& tree, const ScaleContainer& scales, OutputScalar* descriptors,
+                                  bool useFitness = true, FIT_RESULT* states = nullptr)
+{
+    typedef typename Fit::DataPoint DataPoint;
+    typedef typename Fit::Scalar Scalar;
+
+    // number of points taken at once by a thread: small enough to balance uneven neighborhoods
+    constexpr int chunk = 16;
+
+    PONCA_TRACE_ZONE("ponca::computeGlsDescriptors");
+    const int count    = tree.index_count();
+    const int* indices = tree.index_buffer();
+    const int scaleCount = int(scales.size());
+    if (count == 0 || scaleCount == 0)
+        return;
+    const std::size_t size = std::size_t(glsDescriptorSize(scaleCount, useFitness));
+    const Scalar maxScale = Scalar(scales[scaleCount - 1]);
+
+#pragma omp parallel
+    {
+        auto query = tree.range_neighbors(tree.point(indices[0]).pos(), maxScale);
+        std::vector<DataPoint> neighbors;
+
+#pragma omp for schedule(dynamic, chunk)
+        for (int k = 0; k < count; ++k)
+        {
+            const int i = indices[k];
+            const auto& pos = tree.point(i).pos();
+            neighbors.clear();
+            for (int j : query(pos, maxScale))
+                neighbors.push_back(tree.point(j));
+
+            OutputScalar* descriptor = descriptors + std::size_t(i) * size;
+            internal::computeScales<Fit>(pos, neighbors.cbegin(), neighbors.cend(), scales,
+                                         [&](int s, const Fit& fit, FIT_RESULT res) {
+                OutputScalar* values = descriptor + (useFitness ? 3 : 2) * s;
+                const bool defined = res != UNDEFINED;
+                values[0] = defined ? OutputScalar(fit.tau_normalized()) : OutputScalar(0);
+                values[1] = defined ? OutputScalar(fit.kappa_normalized()) : OutputScalar(0);
+                if (useFitness)
+                    values[2] = defined ? OutputScalar(fit.fitness()) : OutputScalar(0);
+                if (states)
+                    states[std::size_t(i) * std::size_t(scaleCount) + std::size_t(s)] = res;
+            });
+        }
+    }
+}
+
+} // namespace Ponca
@@ -0,0 +1,132 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./enums.h"
+
+namespace Ponca
+{
+
+/*!
+    \brief Iteratively reweighted least squares: robust fit down-weighting the neighbors far from the primitive
+    \inherit Concept::FittingExtensionConcept
+
+    The first pass fits the primitive as the fitting procedure alone. Each following pass fits it again, the weight
+    of each neighbor being multiplied by a robust weight (see #ROBUST_WEIGHT) of its residual: its distance to the
+    primitive of the previous pass, approximated by \f$ |f(\mathbf{q})| / |\nabla f(\mathbf{q})| \f$ for the scalar
+    field \f$ f \f$ of the primitive. finalize returns #NEED_OTHER_PASS until the sum of the weights changes by less
+    than a relative tolerance, or after a maximal number of passes.
+
+    The passes replay the same neighbors: use Basket::computeWithCache, so that each pass iterates over the buffer
+    of the neighbors used by the first one instead of traversing the spatial structure again.
+    \code
+    typedef Basket<Point, DistWeightFunc<Point, SmoothWeightKernel<Scalar> >, CovariancePlaneFit, IrlsReweighting> Fit;
+    Fit fit;
+    fit.setWeightFunc(WeightFunc(scale));
+    fit.setRobustWeight(TUKEY_WEIGHT, Scalar(0.05)); // reject the neighbors beyond 5% of the scale
+    fit.init(p);
+    fit.computeWithCache(neighbors.cbegin(), neighbors.cend());
+    \endcode
+
+    Requirements: a primitive providing `potential(q)` and `primitiveGradient(q)`, e.g. Plane or
+    AlgebraicSphere, and a weight function providing `evalScale`, `setWeight` and `clearSquaredNorm`, as
+    DistWeightFunc.
+    \warning Must be the last extension of the Basket: the passes restart the lower levels of the Basket only.
+
+    \ingroup fitting
+*/
+template < class DataPoint, class _WFunctor, typename T>
+class IrlsReweighting : public T
+{
+private:
+    typedef T Base;
+
+public:
+    typedef typename Base::Scalar     Scalar;     /*!< \brief Inherited scalar type*/
+    typedef typename Base::VectorType VectorType; /*!< \brief Inherited vector type*/
+    typedef typename Base::WFunctor   WFunctor;   /*!< \brief Weight Function*/
+
+protected:
+    Base m_previous;                 /*!< \brief Fit of the previous pass, giving the residuals */
+    bool m_hasPrevious {false};      /*!< \brief Tells if the current pass reweights the neighbors */
+    VectorType m_evalPos;            /*!< \brief Evaluation position, restored at each pass */
+    Scalar m_evalScale {0};          /*!< \brief Evaluation scale */
+    Scalar m_sumRobustW {0};         /*!< \brief Sum of the robust weights of the current pass */
+    Scalar m_previousSumRobustW {0}; /*!< \brief Sum of the robust weights of the previous pass */
+    int m_pass {0};                  /*!< \brief Number of completed passes */
+
+    ROBUST_WEIGHT m_robustWeight {TUKEY_WEIGHT}; /*!< \brief Robust weight of the residuals */
+    Scalar m_threshold {Scalar(0.1)};   /*!< \brief Threshold of the residuals, relative to the scale */
+    int m_maxPasses {8};                /*!< \brief Maximal number of passes */
+    Scalar m_tolerance {Scalar(1e-3)};  /*!< \brief Relative change of the weights stopping the passes */
+
+public:
+    /*! \brief Default constructor */
+    PONCA_MULTIARCH inline IrlsReweighting() : Base() {}
+
+    /**************************************************************************/
+    /* Initialization                                                         */
+    /**************************************************************************/
+    /*! \copydoc Concept::FittingProcedureConcept::setWeightFunc() */
+    PONCA_MULTIARCH inline void setWeightFunc(const WFunctor& _w)
+    {
+        Base::setWeightFunc(_w);
+        m_evalScale = _w.evalScale();
+    }
+
+    /*! \copydoc Concept::FittingProcedureConcept::init() */
+    PONCA_MULTIARCH inline void init(const VectorType& _evalPos);
+
+    /*!
+        \brief Set the robust weight and its threshold, relative to the evaluation scale (default: Tukey, 0.1)
+
+        Kept by init.
+    */
+    PONCA_MULTIARCH inline void setRobustWeight(ROBUST_WEIGHT _weight, Scalar _threshold)
+    {
+        m_robustWeight = _weight;
+        m_threshold    = _threshold;
+    }
+
+    /*!
+        \brief Set the maximal number of passes, and the relative change of the sum of the weights under which the
+        passes stop (default: 8, 1e-3)
+
+        Kept by init.
+    */
+    PONCA_MULTIARCH inline void setIterations(int _maxPasses, Scalar _tolerance)
+    {
+        m_maxPasses = _maxPasses;
+        m_tolerance = _tolerance;
+    }
+
+    /**************************************************************************/
+    /* Processing                                                             */
+    /**************************************************************************/
+    /*! \copydoc Concept::FittingProcedureConcept::addNeighbor() */
+    PONCA_MULTIARCH inline bool addNeighbor(const DataPoint &_nei);
+
+    /*! \copydoc Concept::FittingProcedureConcept::finalize() */
+    PONCA_MULTIARCH inline FIT_RESULT finalize();
+
+    /**************************************************************************/
+    /* Results                                                                */
+    /**************************************************************************/
+    /*! \brief Number of passes of the last fit, the first one included */
+    PONCA_MULTIARCH inline int passCount() const { return m_pass; }
+
+    /*! \brief Robust weight of a residual `_r`, in the range [0, 1] */
+    PONCA_MULTIARCH inline Scalar robustWeight(Scalar _r) const;
+
+    /*! \brief Distance of `_q` to the primitive of the previous pass, used as residual */
+    PONCA_MULTIARCH inline Scalar residual(const VectorType& _q) const;
+};
+
+#include "irls.hpp"
+
+} //namespace Ponca
@@ -0,0 +1,102 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+IrlsReweighting<DataPoint, _WFunctor, T>::init(const VectorType& _evalPos)
+{
+    Base::init(_evalPos);
+    m_evalPos            = _evalPos;
+    m_hasPrevious        = false;
+    m_sumRobustW         = Scalar(0);
+    m_previousSumRobustW = Scalar(0);
+    m_pass               = 0;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+bool
+IrlsReweighting<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
+{
+    const VectorType q = _nei.pos() - Base::basisCenter();
+    // weight of the kernel, or the one given by the caller (see Basket::addNeighborWithWeight)
+    const Scalar w = Base::m_w.w(q, _nei);
+    if (w <= Scalar(0))
+        return false;
+
+    if (! m_hasPrevious)
+    {
+        if (! Base::addNeighbor(_nei))
+            return false;
+        m_sumRobustW += w;
+        return true;
+    }
+
+    const Scalar rw = w * robustWeight(residual(_nei.pos()));
+    if (rw <= Scalar(0))
+        return false;
+
+    Base::m_w.setWeight(q.squaredNorm(), rw);
+    const bool res = Base::addNeighbor(_nei);
+    Base::m_w.clearSquaredNorm();
+    if (res)
+        m_sumRobustW += rw;
+    return res;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+FIT_RESULT
+IrlsReweighting<DataPoint, _WFunctor, T>::finalize()
+{
+    PONCA_MULTIARCH_STD_MATH(abs);
+
+    const FIT_RESULT res = Base::finalize();
+    // passes of the fitting procedure itself, e.g. MongePatch
+    if (res == NEED_OTHER_PASS)
+        return res;
+
+    ++m_pass;
+    const bool converged = m_hasPrevious && abs(m_sumRobustW - m_previousSumRobustW) <= m_tolerance * m_sumRobustW;
+    if (res == UNDEFINED || converged || m_pass >= m_maxPasses)
+        return res;
+
+    // keep the primitive giving the residuals, and restart the sums
+    m_previous           = *this;
+    m_hasPrevious        = true;
+    m_previousSumRobustW = m_sumRobustW;
+    m_sumRobustW         = Scalar(0);
+    Base::init(m_evalPos);
+    Base::m_eCurrentState = NEED_OTHER_PASS;
+    return Base::m_eCurrentState;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+typename IrlsReweighting<DataPoint, _WFunctor, T>::Scalar
+IrlsReweighting<DataPoint, _WFunctor, T>::robustWeight(Scalar _r) const
+{
+    PONCA_MULTIARCH_STD_MATH(abs);
+
+    const Scalar c = m_threshold * m_evalScale;
+    const Scalar r = abs(_r);
+    if (m_robustWeight == HUBER_WEIGHT)
+        return r <= c ? Scalar(1) : c / r;
+
+    if (r >= c)
+        return Scalar(0);
+    const Scalar u = Scalar(1) - (r / c) * (r / c);
+    return u * u;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+typename IrlsReweighting<DataPoint, _WFunctor, T>::Scalar
+IrlsReweighting<DataPoint, _WFunctor, T>::residual(const VectorType& _q) const
+{
+    PONCA_MULTIARCH_STD_MATH(abs);
+
+    const Scalar potential = m_previous.potential(_q);
+    const Scalar norm      = m_previous.primitiveGradient(_q).norm();
+    return norm > Scalar(0) ? abs(potential) / norm : abs(potential);
+}
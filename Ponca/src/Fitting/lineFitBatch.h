@@ -0,0 +1,152 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+#include "basketBatch.h"
+#include "covarianceLineFit.h"
+#include "../Common/Tracing.h"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+namespace Ponca
+{
+
+/*!
+    \brief Caller-provided output buffers of computeLineFitBatch, in structure of arrays layout
+
+    Each buffer holds one entry per fit, `Dim` consecutive scalars for the vectors. The null buffers are not
+    written. The entries of the fits that are not STABLE are set to NaN.
+    \ingroup fitting
+*/
+template <typename Scalar>
+struct LineFitBuffers
+{
+    Scalar* origins    {nullptr}; ///< Centroid of the neighbors, the origin of the line
+    Scalar* directions {nullptr}; ///< Unit direction of the line
+    Scalar* residuals  {nullptr}; ///< Mean squared distance of the neighbors to the line
+    FIT_RESULT* status {nullptr}; ///< Result of the fit
+};
+
+/*!
+    \brief Fit a line to each of the `centers.size()` neighborhoods given in compressed sparse row (CSR) format
+
+    Batched version of CovarianceLineFit with #LARGEST_EIGENVECTOR_SOLVER, for millions of fits, e.g. along
+    edges: the neighbors of the fit `i` are `points[neighbors[j]]` for `j` in `[offsets[i], offsets[i+1])`, e.g.
+    the output of KdTree::range_neighbors_batch on `centers`, and are expressed relatively to `centers[i]`.
+    As in CovarianceLineFit, the neighbors are not weighted, and the fits of less than 2 neighbors are
+    #UNDEFINED.
+
+    The fits are processed by groups of `Width`, without fit objects, unlike computeBatch: the k-th neighbors
+    of the fits of a group are gathered by coordinates (structure of arrays), one lane per fit, and their sums
+    are accumulated for all the lanes at once with vectorized products. The direction of each line is then
+    computed by internal::largestEigenvector, without decomposing the covariance matrix. The groups are
+    distributed over the OpenMP threads.
+
+    \code
+    std::vector<std::size_t> offsets;
+    std::vector<int> neighbors;
+    kdtree.range_neighbors_batch(samples, scale, offsets, neighbors);
+    std::vector<Scalar> origins(3 * samples.size()), directions(3 * samples.size());
+    LineFitBuffers<Scalar> buffers;
+    buffers.origins = origins.data(); buffers.directions = directions.data();
+    computeLineFitBatch<Point>(samples, kdtree.point_buffer(), offsets, neighbors, buffers);
+    \endcode
+
+    \tparam Width Number of fits accumulated at once
+    \param squarings Number of squarings of the covariance matrices, see internal::largestEigenvector
+    \ingroup fitting
+*/
+template <typename DataPoint, int Width = PONCA_FIT_BATCH_WIDTH,
+          typename VectorContainer, typename PointContainer, typename OffsetContainer, typename IndexContainer>
+inline void computeLineFitBatch(const VectorContainer& centers, const PointContainer& points,
+                                const OffsetContainer& offsets, const IndexContainer& neighbors,
+                                const LineFitBuffers<typename DataPoint::Scalar>& buffers, int squarings = 6)
+{
+    typedef typename DataPoint::Scalar     Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename DataPoint::MatrixType MatrixType;
+    constexpr int Dim = DataPoint::Dim;
+    // sums of the lanes by column: number of neighbors, positions, then the upper triangle of the covariance
+    typedef Eigen::Array<Scalar, Width, 1 + Dim + Dim * (Dim + 1) / 2> LaneSums;
+    typedef Eigen::Array<Scalar, Width, Dim> LaneBlock;
+    static_assert(Width > 0, "At least one fit must be processed at once");
+
+    PONCA_TRACE_ZONE("ponca::computeLineFitBatch");
+    const int count = int(centers.size());
+    const int groupCount = (count + Width - 1) / Width;
+    const Scalar nan = std::numeric_limits<Scalar>::quiet_NaN();
+    const VectorType nanVector = VectorType::Constant(nan);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int g = 0; g < groupCount; ++g)
+    {
+        const int first = g * Width;
+        const int size  = std::min(Width, count - first);
+
+        std::size_t longest = 0;
+        for (int l = 0; l < size; ++l)
+            longest = std::max(longest, std::size_t(offsets[first + l + 1] - offsets[first + l]));
+
+        // the lanes without k-th neighbor add zeros
+        LaneSums sums = LaneSums::Zero();
+        LaneBlock block;
+        for (std::size_t k = 0; k < longest; ++k)
+        {
+            for (int l = 0; l < Width; ++l)
+            {
+                const std::size_t j = l < size ? std::size_t(offsets[first + l]) + k : 0;
+                const bool used = l < size && j < std::size_t(offsets[first + l + 1]);
+                block.row(l) = used ? (points[neighbors[j]].pos() - centers[first + l]).transpose().eval()
+                                    : Eigen::Matrix<Scalar, 1, Dim>::Zero().eval();
+                sums(l, 0) += used ? Scalar(1) : Scalar(0);
+            }
+            for (int i = 0, c = 1 + Dim; i < Dim; ++i)
+            {
+                sums.col(1 + i) += block.col(i);
+                for (int j = i; j < Dim; ++j, ++c)
+                    sums.col(c) += block.col(i) * block.col(j);
+            }
+        }
+
+        for (int l = 0; l < size; ++l)
+        {
+            const int i = first + l;
+            const Scalar n = sums(l, 0);
+            VectorType cog = VectorType::Zero(), direction = VectorType::Zero();
+            MatrixType cov = MatrixType::Zero();
+            bool stable = n >= Scalar(2);
+            if (stable)
+            {
+                cog = sums.row(l).template segment<Dim>(1).transpose() / n;
+                for (int a = 0, c = 1 + Dim; a < Dim; ++a)
+                    for (int b = a; b < Dim; ++b, ++c)
+                        cov(a, b) = cov(b, a) = sums(l, c) / n;
+                cov -= cog * cog.transpose();
+                stable = internal::largestEigenvector(cov, direction, squarings);
+            }
+
+            const std::ptrdiff_t v = std::ptrdiff_t(i) * Dim;
+            if (buffers.origins != nullptr)
+                Eigen::Map<VectorType>(buffers.origins + v) = stable ? VectorType(centers[i] + cog) : nanVector;
+            if (buffers.directions != nullptr)
+                Eigen::Map<VectorType>(buffers.directions + v) = stable ? direction : nanVector;
+            // the variance along the line is the largest eigenvalue, the others are the distances to the line
+            if (buffers.residuals != nullptr)
+                buffers.residuals[i] = stable ? std::max(cov.trace() - direction.dot(cov * direction), Scalar(0)) : nan;
+            if (buffers.status != nullptr)
+                buffers.status[i] = stable ? STABLE : UNDEFINED;
+        }
+    }
+}
+
+} // namespace Ponca
@@ -0,0 +1,70 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+
+namespace Ponca
+{
+
+/*!
+    \brief Fit the neighborhood of `evalPos` in an Octree, adding the small nodes enclosed in the neighborhood at
+    once from their aggregate
+
+    The neighborhood is the ball of radius `w.evalScale()` queried with `tree.lod_neighbors(evalPos, t, tolerance)`:
+    the points of the nodes contained in the ball whose diagonal is lower than `tolerance * t` are added at once
+    by `fit.addMoments(node.aggregate, point)`, with the weight of the centroid of the node, and the other points
+    one by one by `fit.addNeighbor`. With a weight kernel of Lipschitz constant \f$ L \f$ (relatively to the
+    normalized distance), the weight of each point is approximated up to \f$ L \times tolerance \f$. At large
+    scales, the ball is mostly covered by a few large nodes: the cost depends on the number of nodes of the
+    boundary of the ball instead of the number of neighbors. A null tolerance gives the same fit as Basket::compute
+    over the range neighbors.
+
+    The aggregate of the tree must provide the sums used by the fitting procedure, e.g. OctreeOrientedMoments for
+    OrientedSphereFit and OctreeCovarianceMoments for CovariancePlaneFit:
+    \code
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightFunc;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit, GLSParam> Fit;
+    Octree<Point, OctreeOrientedMoments<Point> > tree(points);
+    Fit fit;
+    if (computeWithLod(fit, tree, WeightFunc(t), p, Scalar(0.1)) == STABLE)
+        tau = fit.tau_normalized();
+    \endcode
+
+    \warning The sums of the extensions of the Basket, e.g. the derivatives, are not accumulated for the nodes:
+    use it with fitting procedures without such extensions. CPU only.
+    \return the state of the fit after the last pass
+    \see OrientedSphereFit::addMoments, CovariancePlaneFit::addMoments
+    \ingroup fitting
+*/
+template <typename Fit, typename Tree>
+inline FIT_RESULT computeWithLod(Fit& fit, const Tree& tree, const typename Fit::WFunctor& w,
+                                 const typename Fit::VectorType& evalPos, typename Fit::Scalar tolerance)
+{
+    fit.setWeightFunc(w);
+    fit.init(evalPos);
+
+    auto query = tree.lod_neighbors(evalPos, w.evalScale(), tolerance);
+    FIT_RESULT res = UNDEFINED;
+    do {
+        for (auto it = query.begin(); it != query.end(); ++it)
+        {
+            if (it.is_node())
+            {
+                const auto& node = tree.node(*it);
+                fit.addMoments(node.aggregate, tree.point(tree.index_data()[node.start]));
+            }
+            else
+                fit.addNeighbor(tree.point(*it));
+        }
+        res = fit.finalize();
+    } while (res == NEED_OTHER_PASS);
+    return res;
+}
+
+} // namespace Ponca
@@ -0,0 +1,136 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./weightFunc.h"
+
+#include <Eigen/Cholesky>
+
+namespace Ponca
+{
+/*!
+    \brief Anisotropic weighting function based on the Mahalanobis distance between a query and a reference position
+
+    The query \f$\mathbf{q}\f$, expressed in centered coordinates, is weighted by the kernel applied to
+    \f$ \frac{d(\mathbf{q})}{t} \f$ with \f$ d(\mathbf{q})^2 = \mathbf{q}^T M \mathbf{q} \f$, where \f$ M \f$ is a
+    symmetric positive definite metric, e.g. the inverse covariance of the neighborhood of the evaluation point.
+    The support of the weight is the ellipsoid \f$ d(\mathbf{q}) \leq t \f$, whose axes are the eigenvectors of
+    \f$ M \f$ and whose half lengths are \f$ t / \sqrt{\lambda_i} \f$: the identity metric gives DistWeightFunc.
+
+    The metric is stored as its upper triangular Cholesky factor \f$ U \f$, \f$ M = U^T U \f$, computed once by the
+    constructor: each weight costs a triangular transform \f$ U \mathbf{q} \f$ and a squared norm. The derivatives
+    follow DistWeightFunc, the query being replaced by \f$ M \mathbf{q} = U^T U \mathbf{q} \f$ in the gradients.
+
+    As DistWeightFunc, the weight and its derivatives are multiplied by the weight of the weighted points (see
+    Concept::WeightedPointConcept).
+
+    The neighborhood in the support is collected by KdTree::ellipsoid_neighbors with the same metric and scale.
+
+    \note The squared distances of the spatial partitioning queries being euclidean, #setSquaredNorm is ignored and
+    #setWeight only keeps the weight: the Mahalanobis norm is always computed from the query.
+
+    \inherit Concept::WeightFuncConcept
+
+    \warning it assumes that the evaluation scale t is strictly positive
+    \ingroup fitting
+*/
+template <class DataPoint, class WeightKernel>
+class MahalanobisWeightFunc
+{
+public:
+    /*! \brief Scalar type from DataPoint */
+    typedef typename DataPoint::Scalar Scalar;
+    /*! \brief Vector type from DataPoint */
+    typedef typename DataPoint::VectorType VectorType;
+    /*! \brief Matrix type from DataPoint */
+    typedef typename DataPoint::MatrixType MatrixType;
+
+    /*!
+        \brief Constructor that defines the current evaluation scale, with the identity metric
+        \warning t > 0
+    */
+    PONCA_MULTIARCH inline MahalanobisWeightFunc(const Scalar& _t = Scalar(1.))
+        : m_t(_t), m_factor(MatrixType::Identity()) {}
+
+    /*!
+        \brief Constructor that defines the current evaluation scale and the metric, factorized by a Cholesky
+        decomposition
+        \warning t > 0, and `_metric` is symmetric positive definite
+    */
+    inline MahalanobisWeightFunc(const Scalar& _t, const MatrixType& _metric)
+        : m_t(_t), m_factor(_metric.llt().matrixU()) {}
+
+    /*! \brief Set the metric from its upper triangular Cholesky factor \f$ U \f$, \f$ M = U^T U \f$ */
+    PONCA_MULTIARCH inline void setFactor(const MatrixType& _factor) { m_factor = _factor; }
+
+    /*! \brief Upper triangular Cholesky factor \f$ U \f$ of the metric */
+    PONCA_MULTIARCH inline const MatrixType& factor() const { return m_factor; }
+
+    /*! \brief Metric \f$ M = U^T U \f$ */
+    PONCA_MULTIARCH inline MatrixType metric() const { return m_factor.transpose() * m_factor; }
+
+    /*! \brief Squared Mahalanobis norm \f$ \mathbf{q}^T M \mathbf{q} \f$ of the query */
+    PONCA_MULTIARCH inline Scalar squaredNorm(const VectorType& _q) const
+    {
+        return (m_factor.template triangularView<Eigen::Upper>() * _q).squaredNorm();
+    }
+
+    /*! \brief Weight of the query: \f$ w(\frac{d(\mathbf{q})}{t}) \f$ */
+    PONCA_MULTIARCH inline Scalar w(const VectorType& _q, const DataPoint& /*attributes*/) const;
+
+    /*! \brief First order derivative in space: \f$ \frac{M\mathbf{q}}{t\,d(\mathbf{q})} \nabla w(\frac{d(\mathbf{q})}{t}) \f$ */
+    PONCA_MULTIARCH inline VectorType spacedw(const VectorType& _q, const DataPoint& /*attributes*/) const;
+
+    /*! \brief Second order derivative in space, see DistWeightFunc::spaced2w with \f$ M\mathbf{q} \f$ replacing
+        \f$ \mathbf{q} \f$ and \f$ M \f$ replacing \f$ I_d \f$ */
+    PONCA_MULTIARCH inline MatrixType spaced2w(const VectorType& _q, const DataPoint& /*attributes*/) const;
+
+    /*! \brief First order derivative in scale \f$t\f$, see DistWeightFunc::scaledw */
+    PONCA_MULTIARCH inline Scalar scaledw(const VectorType& _q, const DataPoint& /*attributes*/) const;
+
+    /*! \brief Second order derivative in scale \f$t\f$, see DistWeightFunc::scaled2w */
+    PONCA_MULTIARCH inline Scalar scaled2w(const VectorType& _q, const DataPoint& /*attributes*/) const;
+
+    /*! \brief Cross derivative in scale \f$t\f$ and in space, see DistWeightFunc::scaleSpaced2w with
+        \f$ M\mathbf{q} \f$ replacing \f$ \mathbf{q} \f$ */
+    PONCA_MULTIARCH inline VectorType scaleSpaced2w(const VectorType& _q, const DataPoint& /*attributes*/) const;
+
+    /*! \brief Access to the evaluation scale set during the initialization */
+    PONCA_MULTIARCH inline Scalar evalScale() const { return m_t; }
+
+    /*! \brief Ignored: the euclidean squared distances of the queries do not give the Mahalanobis norm */
+    PONCA_MULTIARCH inline void setSquaredNorm(const Scalar& /*_squaredNorm*/) {}
+
+    /*! \brief Use a precomputed weight, see DistWeightFunc::setWeight. The squared norm is ignored. */
+    PONCA_MULTIARCH inline void setWeight(const Scalar& /*_squaredNorm*/, const Scalar& _weight) { m_weight = _weight; }
+
+    /*! \brief Compute the weight of the next queries from their coordinates again */
+    PONCA_MULTIARCH inline void clearSquaredNorm() { m_weight = Scalar(-1); }
+
+protected:
+    /*! \brief Tag selecting the kernel functions of the squared variable, when the kernel supports them */
+    typedef std::integral_constant<bool, internal::HasSquaredKernel<WeightKernel>::value> SquaredKernel;
+
+    // Kernel functions of the squared variable y = d^2/t^2, computed from the functions of x when not provided
+    PONCA_MULTIARCH inline Scalar f2  (const Scalar& _y, std::true_type) const { return m_wk.f2(_y); }
+    PONCA_MULTIARCH inline Scalar df2 (const Scalar& _y, std::true_type) const { return m_wk.df2(_y); }
+    PONCA_MULTIARCH inline Scalar ddf2(const Scalar& _y, std::true_type) const { return m_wk.ddf2(_y); }
+    PONCA_MULTIARCH inline Scalar f2  (const Scalar& _y, std::false_type) const { PONCA_MULTIARCH_STD_MATH(sqrt); return m_wk.f(sqrt(_y)); }
+    PONCA_MULTIARCH inline Scalar df2 (const Scalar& _y, std::false_type) const { PONCA_MULTIARCH_STD_MATH(sqrt); Scalar x = sqrt(_y); return m_wk.df(x)/x; }
+    PONCA_MULTIARCH inline Scalar ddf2(const Scalar& _y, std::false_type) const { PONCA_MULTIARCH_STD_MATH(sqrt); return m_wk.ddf(sqrt(_y)); }
+
+    Scalar       m_t;             /*!< \brief Evaluation scale */
+    MatrixType   m_factor;        /*!< \brief Upper triangular Cholesky factor of the metric */
+    WeightKernel m_wk;            /*!< \brief 1D function applied to weight queries */
+    Scalar       m_weight {-1};   /*!< \brief Precomputed weight of the queries, negative when unset */
+
+};// class MahalanobisWeightFunc
+
+#include "mahalanobisWeightFunc.hpp"
+
+}// namespace Ponca
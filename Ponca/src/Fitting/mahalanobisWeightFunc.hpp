@@ -0,0 +1,83 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+template <class DataPoint, class WeightKernel>
+typename MahalanobisWeightFunc<DataPoint, WeightKernel>::Scalar
+MahalanobisWeightFunc<DataPoint, WeightKernel>::w(const VectorType& _q, const DataPoint& _attributes) const
+{
+    if (m_weight >= Scalar(0.)) return m_weight;
+    Scalar d2 = squaredNorm(_q);
+    Scalar t2 = m_t*m_t;
+    if (d2 > t2) return Scalar(0.);
+    return internal::pointWeighted(_attributes, f2(d2/t2, SquaredKernel()));
+}
+
+template <class DataPoint, class WeightKernel>
+typename MahalanobisWeightFunc<DataPoint, WeightKernel>::VectorType
+MahalanobisWeightFunc<DataPoint, WeightKernel>::spacedw(const VectorType& _q, const DataPoint& _attributes) const
+{
+    VectorType result = VectorType::Zero();
+    VectorType u = m_factor.template triangularView<Eigen::Upper>() * _q;
+    Scalar d2 = u.squaredNorm();
+    Scalar t2 = m_t*m_t;
+    if (d2 <= t2 && d2 != Scalar(0.))
+        result = m_factor.transpose().template triangularView<Eigen::Lower>() * u * (df2(d2/t2, SquaredKernel()) / t2);
+    return internal::pointWeighted(_attributes, result);
+}
+
+template <class DataPoint, class WeightKernel>
+typename MahalanobisWeightFunc<DataPoint, WeightKernel>::MatrixType
+MahalanobisWeightFunc<DataPoint, WeightKernel>::spaced2w(const VectorType& _q, const DataPoint& _attributes) const
+{
+    MatrixType result = MatrixType::Zero();
+    VectorType u = m_factor.template triangularView<Eigen::Upper>() * _q;
+    Scalar d2 = u.squaredNorm();
+    Scalar t2 = m_t*m_t;
+    if (d2 <= t2 && d2 != Scalar(0.))
+    {
+        VectorType mq = m_factor.transpose().template triangularView<Eigen::Lower>() * u;
+        Scalar der = df2(d2/t2, SquaredKernel());
+        result = mq*mq.transpose()*((ddf2(d2/t2, SquaredKernel()) - der)/d2) + metric()*der;
+        result *= Scalar(1.)/t2;
+    }
+    return internal::pointWeighted(_attributes, result);
+}
+
+template <class DataPoint, class WeightKernel>
+typename MahalanobisWeightFunc<DataPoint, WeightKernel>::Scalar
+MahalanobisWeightFunc<DataPoint, WeightKernel>::scaledw(const VectorType& _q, const DataPoint& _attributes) const
+{
+    Scalar d2 = squaredNorm(_q);
+    Scalar t2 = m_t*m_t;
+    if (d2 > t2 || d2 == Scalar(0.)) return Scalar(0.);
+    return internal::pointWeighted(_attributes, Scalar( - d2*df2(d2/t2, SquaredKernel())/(t2*m_t) ));
+}
+
+template <class DataPoint, class WeightKernel>
+typename MahalanobisWeightFunc<DataPoint, WeightKernel>::Scalar
+MahalanobisWeightFunc<DataPoint, WeightKernel>::scaled2w(const VectorType& _q, const DataPoint& _attributes) const
+{
+    Scalar d2 = squaredNorm(_q);
+    Scalar t2 = m_t*m_t;
+    if (d2 > t2 || d2 == Scalar(0.)) return Scalar(0.);
+    return internal::pointWeighted(_attributes,
+                                   Scalar(d2/(t2*t2)*(Scalar(2.)*df2(d2/t2, SquaredKernel()) + ddf2(d2/t2, SquaredKernel()))));
+}
+
+template <class DataPoint, class WeightKernel>
+typename MahalanobisWeightFunc<DataPoint, WeightKernel>::VectorType
+MahalanobisWeightFunc<DataPoint, WeightKernel>::scaleSpaced2w(const VectorType& _q, const DataPoint& _attributes) const
+{
+    VectorType result = VectorType::Zero();
+    VectorType u = m_factor.template triangularView<Eigen::Upper>() * _q;
+    Scalar d2 = u.squaredNorm();
+    Scalar t2 = m_t*m_t;
+    if (d2 <= t2 && d2 != Scalar(0.))
+        result = -(m_factor.transpose().template triangularView<Eigen::Lower>() * u) / (t2*m_t) *
+                 (df2(d2/t2, SquaredKernel()) + ddf2(d2/t2, SquaredKernel()));
+    return internal::pointWeighted(_attributes, result);
+}
@@ -76,6 +76,32 @@ public:
     /*! \copydoc Concept::FittingProcedureConcept::addNeighbor() */
     PONCA_MULTIARCH inline bool addNeighbor(const DataPoint &_nei);
 
+    /*!
+        \brief Add the neighbors accumulated by `_other`, as if they were added to this fit
+        \see Basket::merge
+    */
+    PONCA_MULTIARCH inline void merge(const MeanPlaneFit& _other);
+
+    /*!
+        \brief Remove a neighbor previously added with the same evaluation position, returns true if it was used
+
+        The weight of the neighbor is computed again: call it before #moveEvalPos, to remove the neighbors leaving
+        the neighborhood.
+    */
+    PONCA_MULTIARCH inline bool removeNeighbor(const DataPoint &_nei);
+
+    /*!
+        \brief Move the evaluation position, expressing the accumulated sums relatively to `_evalPos`
+
+        Together with #addNeighbor and #removeNeighbor, allows to update the fit incrementally when the
+        evaluation position slides over overlapping neighborhoods. The weights of the neighbors already added are
+        not updated: the fit is exact with a constant weight kernel only. Only the sums of this fitting procedure
+        are updated: Baskets with extensions accumulating neighbors, e.g. the derivatives, are rejected at compile
+        time by Basket::moveEvalPos and Basket::removeNeighbor.
+        \warning finalize consumes the sums: finalize a copy of the fit to keep updating it.
+    */
+    PONCA_MULTIARCH inline void moveEvalPos(const VectorType& _evalPos);
+
     /*! \copydoc Concept::FittingProcedureConcept::finalize() */
     PONCA_MULTIARCH inline FIT_RESULT finalize();
 }; //class MeanPlaneFit
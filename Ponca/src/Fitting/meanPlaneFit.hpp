@@ -42,6 +42,45 @@ MeanPlaneFit<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
 }
 
 
+template < class DataPoint, class _WFunctor, typename T>
+void
+MeanPlaneFit<DataPoint, _WFunctor, T>::merge(const MeanPlaneFit& _other)
+{
+    Base::merge(_other);
+    m_sumW += _other.m_sumW;
+    m_sumN += _other.m_sumN;
+    m_sumP += _other.m_sumP;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+bool
+MeanPlaneFit<DataPoint, _WFunctor, T>::removeNeighbor(const DataPoint& _nei)
+{
+    VectorType q = _nei.pos() - Base::basisCenter();
+    // compute weight
+    Scalar w = m_w.w(q, _nei);
+
+    if (w > Scalar(0.))
+    {
+      m_sumP -= q * w;
+      m_sumN -= _nei.normal() * w;
+      m_sumW -= w;
+
+      --(Base::m_nbNeighbors);
+      return true;
+    }
+    return false;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+MeanPlaneFit<DataPoint, _WFunctor, T>::moveEvalPos(const VectorType& _evalPos)
+{
+    const VectorType delta = _evalPos - Base::basisCenter();
+    m_sumP -= m_sumW * delta;
+    Base::basisCenter() = _evalPos;
+}
+
 template < class DataPoint, class _WFunctor, typename T>
 FIT_RESULT
 MeanPlaneFit<DataPoint, _WFunctor, T>::finalize ()
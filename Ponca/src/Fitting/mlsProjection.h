@@ -0,0 +1,189 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+
+#include <utility>
+#include <vector>
+
+namespace Ponca
+{
+
+/*!
+    \brief Moving least squares projection of points on the surface defined by the fits of their neighborhoods
+
+    A point is projected by iterations: the neighborhood of radius `scale` of the current position is fitted, and
+    the position is projected on the fitted primitive, until it moves less than `tolerance * scale`. With a Basket
+    of OrientedSphereFit, this is the APSS projection \cite Guennebaud:2007:APSS.
+
+    The neighbors are gathered by a range query of radius `(1 + reuse) * scale`, and copied in a Context owned
+    by the calling thread: while the position stays within `reuse * scale` of the position of the query, they
+    contain its neighborhood of radius `scale`, and are fitted again without querying the tree. The neighbors
+    beyond `scale` get a null weight from the weight functions of compact support, such as DistWeightFunc. The
+    context keeps the neighbors from one point to the next: close points, e.g. sorted along the tree, share
+    their queries.
+
+    \code
+    MlsProjection<Fit, KdTree<Point> > mls(kdtree, scale);
+    mls.projectBatch(queries.data(), projections.data(), int(queries.size()));
+    \endcode
+
+    \tparam Fit Fitting procedure providing `project`, e.g. a Basket, whose weight function is constructible
+    from `scale` and null beyond it
+    \tparam TreeT Spatial structure providing `point(i)` and `range_neighbors(point, radius)` returning a query
+    rebindable with `operator()(point, radius)`, e.g. KdTree
+    \see computeAll to fit the neighborhoods of the indexed points
+    \ingroup fitting
+*/
+template <typename Fit, typename TreeT>
+class MlsProjection
+{
+public:
+    typedef typename Fit::DataPoint  DataPoint;  /*!< \brief Point type of the fit */
+    typedef typename Fit::Scalar     Scalar;     /*!< \brief Scalar type of the fit */
+    typedef typename Fit::VectorType VectorType; /*!< \brief Vector type of the fit */
+    typedef typename Fit::WFunctor   WeightFunc; /*!< \brief Weight function of the fit */
+
+    /*!
+        \brief Range query and neighbors reused by the projections of a thread
+
+        A context is not thread-safe, each thread must own its context. It keeps its buffer capacity from one
+        projection to the next.
+    */
+    class Context
+    {
+    public:
+        /*! \brief Context of the projections of `_mls`, which must outlive it */
+        explicit inline Context(const MlsProjection& _mls)
+            : m_query(_mls.m_tree->range_neighbors(VectorType::Zero(), Scalar(0))) {}
+
+        /*! \brief Number of range queries performed with this context */
+        inline int queryCount() const { return m_queryCount; }
+
+    private:
+        friend class MlsProjection;
+        typedef decltype(std::declval<const TreeT&>().range_neighbors(std::declval<VectorType>(), Scalar())) Query;
+
+        Query m_query;                       /*!< \brief Range query, rebound to the new positions */
+        std::vector<DataPoint> m_neighbors;  /*!< \brief Neighbors returned by the last query */
+        VectorType m_center;                 /*!< \brief Position of the last query */
+        bool m_valid {false};                /*!< \brief Tells if a query has been performed */
+        int m_queryCount {0};                /*!< \brief Number of range queries */
+    };
+
+    /*!
+        \brief Projection on the surface fitted at scale `_scale` over the points of `_tree`
+        \param _tree Spatial structure, which must outlive the projection
+    */
+    inline MlsProjection(const TreeT& _tree, Scalar _scale) : m_tree(&_tree), m_scale(_scale) {}
+
+    /*! \brief Set the maximal number of fits per projection (default: 16) */
+    inline void setMaxIterations(int _maxIterations) { m_maxIterations = _maxIterations; }
+
+    /*! \brief Set the distance, relative to the scale, under which a projection stops (default: 1e-4) */
+    inline void setTolerance(Scalar _tolerance) { m_tolerance = _tolerance; }
+
+    /*!
+        \brief Set the distance, relative to the scale, within which the neighbors of a query are reused
+        (default: 0.5)
+
+        The queries are enlarged accordingly: 0 queries the tree at each iteration.
+    */
+    inline void setReuse(Scalar _reuse) { m_reuse = _reuse; }
+
+    /*! \brief Scale of the fits */
+    inline Scalar scale() const { return m_scale; }
+
+    /*!
+        \brief Project `_q` in `_proj`, using the query and neighbors of `_context`
+
+        \return the state of the last fit: #UNSTABLE when the projection did not converge within the maximal
+        number of iterations, and #UNDEFINED when a fit failed, `_proj` being the last position reached.
+        `_q` and `_proj` may be the same vector.
+    */
+    inline FIT_RESULT project(const VectorType& _q, VectorType& _proj, Context& _context) const
+    {
+        FIT_RESULT res = UNDEFINED;
+        VectorType pos = _q;
+        bool converged = false;
+        for (int i = 0; i < m_maxIterations && !converged; ++i)
+        {
+            if (!_context.m_valid || (pos - _context.m_center).norm() > m_reuse * m_scale)
+                gatherNeighbors(pos, _context);
+
+            Fit fit;
+            fit.setWeightFunc(WeightFunc(m_scale));
+            fit.init(pos);
+            res = fit.compute(_context.m_neighbors.cbegin(), _context.m_neighbors.cend());
+            if (res != STABLE && res != UNSTABLE)
+                break;
+
+            const VectorType next = fit.project(pos);
+            converged = (next - pos).norm() <= m_tolerance * m_scale;
+            pos = next;
+        }
+        if (res == STABLE && !converged)
+            res = UNSTABLE;
+        _proj = pos;
+        return res;
+    }
+
+    /*! \brief Project `_q` in `_proj` with a new context \see project(const VectorType&, VectorType&, Context&) */
+    inline FIT_RESULT project(const VectorType& _q, VectorType& _proj) const
+    {
+        Context context(*this);
+        return project(_q, _proj, context);
+    }
+
+    /*!
+        \brief Project the `_n` points of `_in` in `_out`, in parallel
+
+        Each OpenMP thread owns a Context, and takes the points by small chunks (`schedule(dynamic)`) to keep
+        close points together. The states of the projections are written in `_res` when not null. `_in` and
+        `_out` may be the same array.
+    */
+    inline void projectBatch(const VectorType* _in, VectorType* _out, int _n, FIT_RESULT* _res = nullptr) const
+    {
+        // number of points taken at once by a thread: small enough to balance uneven neighborhoods
+        constexpr int chunk = 16;
+
+#pragma omp parallel
+        {
+            Context context(*this);
+
+#pragma omp for schedule(dynamic, chunk)
+            for (int i = 0; i < _n; ++i)
+            {
+                const FIT_RESULT res = project(_in[i], _out[i], context);
+                if (_res)
+                    _res[i] = res;
+            }
+        }
+    }
+
+private:
+    /*! \brief Query the neighbors of `_pos` within the enlarged radius, and copy them in `_context` */
+    inline void gatherNeighbors(const VectorType& _pos, Context& _context) const
+    {
+        _context.m_neighbors.clear();
+        for (int j : _context.m_query(_pos, (Scalar(1) + m_reuse) * m_scale))
+            _context.m_neighbors.push_back(m_tree->point(j));
+        _context.m_center = _pos;
+        _context.m_valid  = true;
+        ++_context.m_queryCount;
+    }
+
+    const TreeT* m_tree;                 /*!< \brief Spatial structure indexing the points */
+    Scalar m_scale;                      /*!< \brief Scale of the fits */
+    int    m_maxIterations {16};         /*!< \brief Maximal number of fits per projection */
+    Scalar m_tolerance {Scalar(1e-4)};   /*!< \brief Convergence distance, relative to the scale */
+    Scalar m_reuse {Scalar(0.5)};        /*!< \brief Reuse distance of the neighbors, relative to the scale */
+};
+
+} // namespace Ponca
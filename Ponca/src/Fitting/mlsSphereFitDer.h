@@ -106,6 +106,11 @@ public:
     /************************************************************************/
     /*! \see Concept::FittingProcedureConcept::addNeighbor() */
     PONCA_MULTIARCH bool addNeighbor(const DataPoint &nei);
+    /*!
+        \brief Add the neighbors accumulated by `_other`, as if they were added to this fit
+        \see Basket::merge
+    */
+    PONCA_MULTIARCH inline void merge(const MlsSphereFitDer& _other);
 
     /*! \see Concept::FittingProcedureConcept::finalize() */
     PONCA_MULTIARCH FIT_RESULT finalize();
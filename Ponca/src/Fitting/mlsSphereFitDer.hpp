@@ -37,13 +37,13 @@ MlsSphereFitDer<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
         // compute weight derivatives
         Matrix d2w = Matrix::Zero();
 
-        if (Base::isScaleDer())
+        if constexpr (Base::isScaleDer())
             d2w(0,0) = Base::m_w.scaled2w(q, _nei);
 
-        if (Base::isSpaceDer())
+        if constexpr (Base::isSpaceDer())
             d2w.template bottomRightCorner<Dim,Dim>() = Base::m_w.spaced2w(q, _nei);
 
-        if (Base::isScaleDer() && Base::isSpaceDer())
+        if constexpr (Base::isScaleDer() && Base::isSpaceDer())
         {
             d2w.template bottomLeftCorner<Dim,1>() = Base::m_w.scaleSpaced2w(q,_nei);
             d2w.template topRightCorner<1,Dim>() = d2w.template bottomLeftCorner<Dim,1>().transpose();
@@ -62,6 +62,18 @@ MlsSphereFitDer<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
     return bResult;
 }
 
+template < class DataPoint, class _WFunctor, typename T>
+void
+MlsSphereFitDer<DataPoint, _WFunctor, T>::merge(const MlsSphereFitDer& _other)
+{
+    Base::merge(_other);
+    m_d2SumDotPN += _other.m_d2SumDotPN;
+    m_d2SumDotPP += _other.m_d2SumDotPP;
+    m_d2SumW     += _other.m_d2SumW;
+    m_d2SumP     += _other.m_d2SumP;
+    m_d2SumN     += _other.m_d2SumN;
+}
+
 template < class DataPoint, class _WFunctor, typename T>
 FIT_RESULT
 MlsSphereFitDer<DataPoint, _WFunctor, T>::finalize()
@@ -70,6 +82,12 @@ MlsSphereFitDer<DataPoint, _WFunctor, T>::finalize()
 
     if (this->isReady())
     {
+        // sums converted from the accumulator type
+        const Scalar     sumW     = Scalar(Base::m_sumW);
+        const Scalar     sumDotPP = Scalar(Base::m_sumDotPP);
+        const VectorType sumP     = Base::m_sumP.template cast<Scalar>();
+        const VectorType sumN     = Base::m_sumN.template cast<Scalar>();
+
         Matrix sumdSumPdSumN  = Matrix::Zero();
         Matrix sumd2SumPdSumN = Matrix::Zero();
         Matrix sumd2SumNdSumP = Matrix::Zero();
@@ -79,31 +97,31 @@ MlsSphereFitDer<DataPoint, _WFunctor, T>::finalize()
         for(int i=0; i<Dim; ++i)
         {
             sumdSumPdSumN  += Base::m_dSumN.row(i).transpose()*Base::m_dSumP.row(i);
-            sumd2SumPdSumN += m_d2SumP.template block<DerDim,DerDim>(0,i*DerDim)*Base::m_sumN(i);
-            sumd2SumNdSumP += m_d2SumN.template block<DerDim,DerDim>(0,i*DerDim)*Base::m_sumP(i);
+            sumd2SumPdSumN += m_d2SumP.template block<DerDim,DerDim>(0,i*DerDim)*sumN(i);
+            sumd2SumNdSumP += m_d2SumN.template block<DerDim,DerDim>(0,i*DerDim)*sumP(i);
             sumdSumPdSumP  += Base::m_dSumP.row(i).transpose()*Base::m_dSumP.row(i);
-            sumd2SumPdSumP += m_d2SumP.template block<DerDim,DerDim>(0,i*DerDim)*Base::m_sumP(i);
+            sumd2SumPdSumP += m_d2SumP.template block<DerDim,DerDim>(0,i*DerDim)*sumP(i);
         }
 
-        Scalar invSumW = Scalar(1.)/Base::m_sumW;
+        Scalar invSumW = Scalar(1.)/sumW;
 
         Matrix d2Nume = m_d2SumDotPN
             - invSumW*invSumW*invSumW*invSumW*(
-                    Base::m_sumW*Base::m_sumW*(  Base::m_sumW*(sumdSumPdSumN+sumdSumPdSumN.transpose()+sumd2SumPdSumN+sumd2SumNdSumP)
-                                               + Base::m_dSumW.transpose()*(Base::m_sumN.transpose()*Base::m_dSumP + Base::m_sumP.transpose()*Base::m_dSumN)
-                                               - (Base::m_sumP.transpose()*Base::m_sumN)*m_d2SumW.transpose()
-                                               - (Base::m_dSumN.transpose()*Base::m_sumP + Base::m_dSumP.transpose()*Base::m_sumN)*Base::m_dSumW)
-                    - Scalar(2.)*Base::m_sumW*Base::m_dSumW.transpose()*(Base::m_sumW*(Base::m_sumN.transpose()*Base::m_dSumP + Base::m_sumP.transpose()*Base::m_dSumN)
-                                                                         - (Base::m_sumP.transpose()*Base::m_sumN)*Base::m_dSumW));
+                    sumW*sumW*(  sumW*(sumdSumPdSumN+sumdSumPdSumN.transpose()+sumd2SumPdSumN+sumd2SumNdSumP)
+                               + Base::m_dSumW.transpose()*(sumN.transpose()*Base::m_dSumP + sumP.transpose()*Base::m_dSumN)
+                               - (sumP.transpose()*sumN)*m_d2SumW.transpose()
+                               - (Base::m_dSumN.transpose()*sumP + Base::m_dSumP.transpose()*sumN)*Base::m_dSumW)
+                    - Scalar(2.)*sumW*Base::m_dSumW.transpose()*(sumW*(sumN.transpose()*Base::m_dSumP + sumP.transpose()*Base::m_dSumN)
+                                                                 - (sumP.transpose()*sumN)*Base::m_dSumW));
 
         Matrix d2Deno = m_d2SumDotPP
             - invSumW*invSumW*invSumW*invSumW*(
-                Base::m_sumW*Base::m_sumW*(  Scalar(2.)*Base::m_sumW*(sumdSumPdSumP+sumd2SumPdSumP)
-                                           + Scalar(2.)*Base::m_dSumW.transpose()*(Base::m_sumP.transpose()*Base::m_dSumP)
-                                           - (Base::m_sumP.transpose()*Base::m_sumP)*m_d2SumW.transpose()
-                                           - Scalar(2.)*(Base::m_dSumP.transpose()*Base::m_sumP)*Base::m_dSumW)
-                - Scalar(2.)*Base::m_sumW*Base::m_dSumW.transpose()*(Scalar(2.)*Base::m_sumW*Base::m_sumP.transpose()*Base::m_dSumP
-                                                                     - (Base::m_sumP.transpose()*Base::m_sumP)*Base::m_dSumW));
+                sumW*sumW*(  Scalar(2.)*sumW*(sumdSumPdSumP+sumd2SumPdSumP)
+                           + Scalar(2.)*Base::m_dSumW.transpose()*(sumP.transpose()*Base::m_dSumP)
+                           - (sumP.transpose()*sumP)*m_d2SumW.transpose()
+                           - Scalar(2.)*(Base::m_dSumP.transpose()*sumP)*Base::m_dSumW)
+                - Scalar(2.)*sumW*Base::m_dSumW.transpose()*(Scalar(2.)*sumW*sumP.transpose()*Base::m_dSumP
+                                                             - (sumP.transpose()*sumP)*Base::m_dSumW));
 
         Scalar deno2 = Base::m_deno*Base::m_deno;
 
@@ -117,7 +135,7 @@ MlsSphereFitDer<DataPoint, _WFunctor, T>::finalize()
         {
             m_d2Ul.template block<DerDim,DerDim>(0,i*DerDim) = invSumW*(
                   m_d2SumN.template block<DerDim,DerDim>(0,i*DerDim)
-                - Scalar(2.)*(  m_d2Uq*Base::m_sumP[i]
+                - Scalar(2.)*(  m_d2Uq*sumP[i]
                               + Base::m_dSumP.row(i).transpose()*Base::m_dUq
                               + Base::m_uq*m_d2SumP.template block<DerDim,DerDim>(0,i*DerDim)
                               + Base::m_dUq.transpose()*Base::m_dSumP.row(i))
@@ -135,7 +153,7 @@ MlsSphereFitDer<DataPoint, _WFunctor, T>::finalize()
         {
             sumdUldSumP += Base::m_dUl.row(i).transpose()*Base::m_dSumP.row(i);
             sumUld2SumP += Base::m_ul[i]*m_d2SumP.template block<DerDim,DerDim>(0,i*DerDim);
-            sumd2UlsumP += m_d2Ul.template block<DerDim,DerDim>(0,i*DerDim)*Base::m_sumP[i];
+            sumd2UlsumP += m_d2Ul.template block<DerDim,DerDim>(0,i*DerDim)*sumP[i];
             sumdSumPdUl += Base::m_dSumP.row(i).transpose()*Base::m_dUl.row(i);
         }
 
@@ -147,7 +165,7 @@ MlsSphereFitDer<DataPoint, _WFunctor, T>::finalize()
             + Base::m_dUq.transpose()*Base::m_dSumDotPP
             + Base::m_uq*m_d2SumDotPP
             + Base::m_dSumDotPP.transpose()*Base::m_dUq
-            + m_d2Uq*Base::m_sumDotPP
+            + m_d2Uq*sumDotPP
             + Base::m_uc*m_d2SumW
             + Base::m_dUc.transpose()*Base::m_dSumW
             + Base::m_dSumW.transpose()*Base::m_dUc);
@@ -166,7 +184,7 @@ MlsSphereFitDer<DataPoint, _WFunctor, T>::dPotential() const
     //   the spatial derivative: d_x(s)(t,0) = d_x(uc)(t,0) + ul(t,0)
     ScalarArray result = Base::m_dUc;
 
-    if(Base::isSpaceDer())
+    if constexpr (Base::isSpaceDer())
         result.template tail<Dim>() += Base::m_ul;
 
     return result;
@@ -197,10 +215,10 @@ MlsSphereFitDer<DataPoint, _WFunctor, T>::dNormal() const
     VectorType grad = Base::m_dUc.template tail<Dim>().transpose() + Base::m_ul;
     Scalar gradNorm = grad.norm();
 
-    if(Base::isScaleDer())
+    if constexpr (Base::isScaleDer())
         result.col(0) = m_d2Uc.template topRightCorner<1,Dim>().transpose() + Base::m_dUl.col(0);
 
-    if(Base::isSpaceDer())
+    if constexpr (Base::isSpaceDer())
     {
         result.template rightCols<Dim>() = m_d2Uc.template bottomRightCorner<Dim,Dim>().transpose()
                                            + Base::m_dUl.template rightCols<Dim>().transpose()
@@ -41,16 +41,18 @@ public:
     typedef _WFunctor                       WFunctor;   /*!< \brief Weight Function */
 
     typedef Eigen::Matrix<Scalar,2,1> Vector2;
-    typedef Eigen::Matrix<Scalar,Eigen::Dynamic,1> VectorX;
-    typedef Eigen::Matrix<Scalar,Eigen::Dynamic,Eigen::Dynamic> MatrixX;
+    typedef Eigen::Matrix<Scalar,6,1> Vector6;  /*!< \brief Quadric parameters and observations */
+    typedef Eigen::Matrix<Scalar,6,6> Matrix6;  /*!< \brief Normal equations of the quadric */
 
 protected:
-    MatrixX m_A; /*!< \brief Quadric input samples */
-    MatrixX m_x; /*!< \brief Quadric parameters */
-    VectorX m_b;         /*!< \brief Obervations */
+    Matrix6 m_A; /*!< \brief Quadric input samples */
+    Vector6 m_x; /*!< \brief Quadric parameters */
+    Vector6 m_b;         /*!< \brief Obervations */
 
     int  m_neiIdx;       /*!< \brief Counter of observations, used in addNeighhor() */
     bool m_planeIsReady;
+
+    static_assert ( DataPoint::Dim == 3, "MongePatch is only valid in 3D");
 public:
 
     /*! \brief Explicit conversion to MongePatch, to access methods potentially hidden by inheritage */
@@ -104,6 +106,70 @@ public:
     PONCA_MULTIARCH inline const Scalar & h_v  () const { return *(m_x.data()+4); }
     PONCA_MULTIARCH inline const Scalar & h_c  () const { return *(m_x.data()+5); }
 
+protected:
+    /*! \brief Solve the normal equations #m_A #m_x = #m_b, and set the state of the fit */
+    PONCA_MULTIARCH inline FIT_RESULT solveQuadric();
+
+};
+
+/*!
+ * \brief Single pass variant of MongePatch
+ *
+ * MongePatch fits the plane in a first pass, and the quadric in a second pass expressed in the tangent plane basis.
+ * This extension accumulates in the first pass the weighted moments of the neighbor coordinates relative to the
+ * basis center, i.e. the sums of the 35 monomials of degree 4 or less, and rotates them into the tangent plane basis
+ * in finalize. Both extensions give the same quadric, but the neighborhood is traversed once.
+ *
+ * \note The tangent plane basis must only rotate the coordinates around the basis center, as with
+ * CovariancePlaneFit.
+ * \warning This class is valid only in 3D.
+ *
+ * \ingroup fitting
+ */
+template < class DataPoint, class _WFunctor, typename T>
+class MongePatchSinglePass : public MongePatch<DataPoint, _WFunctor, T>
+{
+private:
+    using Base = MongePatch<DataPoint, _WFunctor, T>;
+
+public:
+    typedef typename Base::Scalar     Scalar;     /*!< \brief Inherited scalar type*/
+    typedef typename Base::VectorType VectorType; /*!< \brief Inherited vector type*/
+    typedef _WFunctor                 WFunctor;   /*!< \brief Weight Function */
+
+    /*! \brief Monomials of degree 4 or less of the neighbor coordinates, by increasing degree */
+    typedef Eigen::Matrix<Scalar,35,1> MomentVector;
+
+protected:
+    MomentVector m_moments; /*!< \brief Weighted sum of the monomials of the neighbor coordinates */
+
+    /*! \brief Index of the monomial \f$x^a y^b z^c\f$ in MomentVector */
+    static constexpr PONCA_MULTIARCH inline int momentIndex(int a, int b, int c)
+    {
+        // monomials of lower degree, then by increasing b+c and c
+        return (a+b+c)*(a+b+c+1)*(a+b+c+2)/6 + (b+c)*(b+c+1)/2 + c;
+    }
+
+public:
+    /*! \brief Explicit conversion to MongePatchSinglePass, to access methods potentially hidden by inheritage */
+    PONCA_MULTIARCH inline
+    MongePatchSinglePass<DataPoint, WFunctor, T>& mongePatchSinglePass()
+    { return * static_cast<MongePatchSinglePass<DataPoint, WFunctor, T>*>(this); }
+
+    /*! \copydoc Concept::FittingProcedureConcept::init() */
+    PONCA_MULTIARCH inline void init (const VectorType& _evalPos);
+
+    /*! \copydoc Concept::FittingProcedureConcept::addNeighbor() */
+    PONCA_MULTIARCH inline bool addNeighbor(const DataPoint &_nei);
+
+    /*!
+        \brief Add the neighbors accumulated by `_other`, as if they were added to this fit
+        \see Basket::merge
+    */
+    PONCA_MULTIARCH inline void merge(const MongePatchSinglePass& _other);
+
+    /*! \copydoc Concept::FittingProcedureConcept::finalize() */
+    PONCA_MULTIARCH inline FIT_RESULT finalize();
 };
 
 #include "mongePatch.hpp"
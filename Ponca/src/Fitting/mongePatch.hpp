@@ -1,4 +1,5 @@
 ﻿
+#include <Eigen/Cholesky>
 #include <Eigen/SVD>
 #include <Eigen/Geometry>
 
@@ -54,9 +55,7 @@ MongePatch<DataPoint, _WFunctor, T>::finalize ()
 
         if(res == STABLE) {  // plane is ready
             m_planeIsReady = true;
-            m_A = MatrixX(6,6/*5*/);
             m_A.setZero();
-            m_b = VectorX(6);
             m_b.setZero();
             m_neiIdx = 0;
 
@@ -66,11 +65,30 @@ MongePatch<DataPoint, _WFunctor, T>::finalize ()
     }
     // end of the monge patch fitting process
     else {
-        // we use BDCSVD as the matrix size is 36
-        // http://eigen.tuxfamily.org/dox/classEigen_1_1BDCSVD.html
-        m_x = m_A.bdcSvd(Eigen::ComputeThinU | Eigen::ComputeThinV).solve(m_b);
+        return solveQuadric();
+    }
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+FIT_RESULT
+MongePatch<DataPoint, _WFunctor, T>::solveQuadric ()
+{
+    // the normal equations are symmetric positive semi-definite: LDLT is enough unless the neighbors do not
+    // span the quadric (e.g. they lie on a line or a conic of the tangent plane)
+    const Eigen::LDLT<Matrix6> ldlt(m_A);
+    if (ldlt.info() == Eigen::Success && ldlt.rcond() > Eigen::NumTraits<Scalar>::dummy_precision())
+    {
+        m_x = ldlt.solve(m_b);
         return Base::m_eCurrentState = STABLE;
     }
+#ifndef PONCA_GPU_COMPILER
+    // least-squares solution of minimal norm
+    m_x = Eigen::JacobiSVD<Matrix6>(m_A, Eigen::ComputeFullU | Eigen::ComputeFullV).solve(m_b);
+    return Base::m_eCurrentState = STABLE;
+#else
+    m_x = ldlt.solve(m_b);
+    return Base::m_eCurrentState = UNSTABLE;
+#endif
 }
 
 template < class DataPoint, class _WFunctor, typename T>
@@ -93,3 +111,87 @@ MongePatch<DataPoint, _WFunctor, T>::GaussianCurvature() const {
     return (h_uu()*h_vv() - pow(h_uv(),two)) /
         pow((one + pow(h_u(),two) + pow(h_v(),two) ), two);
 }
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+MongePatchSinglePass<DataPoint, _WFunctor, T>::init(const VectorType& _evalPos)
+{
+    Base::init(_evalPos);
+    m_moments.setZero();
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+bool
+MongePatchSinglePass<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
+{
+    if (Base::addNeighbor(_nei))
+    {
+        VectorType q = _nei.pos() - Base::basisCenter();
+        Scalar w = Base::m_w.w(q, _nei);
+
+        // monomials by increasing degree, see momentIndex
+        const Scalar x = q(0), y = q(1), z = q(2);
+        const Scalar xx = x*x, xy = x*y, xz = x*z, yy = y*y, yz = y*z, zz = z*z;
+        MomentVector m;
+        m << Scalar(1), x, y, z,
+             xx, xy, xz, yy, yz, zz,
+             x*xx, x*xy, x*xz, x*yy, x*yz, x*zz, y*yy, y*yz, y*zz, z*zz,
+             xx*xx, xx*xy, xx*xz, xx*yy, xx*yz, xx*zz, xy*yy, xy*yz, xy*zz, xz*zz, yy*yy, yy*yz, yy*zz, yz*zz, zz*zz;
+        m_moments += w * m;
+        return true;
+    }
+    return false;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+MongePatchSinglePass<DataPoint, _WFunctor, T>::merge(const MongePatchSinglePass& _other)
+{
+    Base::merge(_other);
+    m_moments += _other.m_moments;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+FIT_RESULT
+MongePatchSinglePass<DataPoint, _WFunctor, T>::finalize ()
+{
+    FIT_RESULT res = T::finalize();
+    if (res != STABLE)
+        return res;
+
+    // sums of the products of the monomials (1, x, y, z, x^2, xy, xz, y^2, yz, z^2)
+    const int e[10][3] = {{0,0,0}, {1,0,0}, {0,1,0}, {0,0,1}, {2,0,0}, {1,1,0}, {1,0,1}, {0,2,0}, {0,1,1}, {0,0,2}};
+    Eigen::Matrix<Scalar, 10, 10> S;
+    for (int i = 0; i < 10; ++i)
+        for (int j = 0; j < 10; ++j)
+            S(i, j) = m_moments(momentIndex(e[i][0] + e[j][0], e[i][1] + e[j][1], e[i][2] + e[j][2]));
+
+    // rows of the rotation to the tangent plane basis: [h, u, v]^T = R q
+    Eigen::Matrix<Scalar, 3, 3> R;
+    for (int i = 0; i < 3; ++i)
+        R.col(i) = Base::template worldToTangentPlane<true>(VectorType::Unit(i));
+    const VectorType u = R.row(1).transpose(), v = R.row(2).transpose();
+
+    // monomials (u^2, v^2, uv, u, v, 1), expressed over the monomials of the neighbor coordinates
+    const auto product = [](const VectorType& a, const VectorType& b) {
+        Eigen::Matrix<Scalar, 1, 6> c;
+        c << a(0)*b(0), a(0)*b(1) + a(1)*b(0), a(0)*b(2) + a(2)*b(0),
+             a(1)*b(1), a(1)*b(2) + a(2)*b(1), a(2)*b(2);
+        return c;
+    };
+    Eigen::Matrix<Scalar, 6, 10> L = Eigen::Matrix<Scalar, 6, 10>::Zero();
+    L.template block<1,6>(0, 4) = product(u, u);
+    L.template block<1,6>(1, 4) = product(v, v);
+    L.template block<1,6>(2, 4) = product(u, v);
+    L.template block<1,3>(3, 1) = u.transpose();
+    L.template block<1,3>(4, 1) = v.transpose();
+    L(5, 0) = Scalar(1);
+    Eigen::Matrix<Scalar, 10, 1> h = Eigen::Matrix<Scalar, 10, 1>::Zero();
+    h.template segment<3>(1) = R.row(0).transpose();
+
+    Base::m_A = L * S * L.transpose();
+    Base::m_b = L * (S * h);
+    Base::m_planeIsReady = true;
+
+    return Base::solveQuadric();
+}
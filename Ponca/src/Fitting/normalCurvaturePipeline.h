@@ -0,0 +1,234 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+#include "basket.h"
+#include "basketBatch.h"
+#include "covariancePlaneFit.h"
+#include "curvature.h"
+#include "weightFunc.h"
+#include "weightKernel.h"
+#include "../Common/Tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Ponca
+{
+
+/*!
+    \brief Fitting procedure of computeNormalsCurvatures: covariance plane fit and its principal curvatures
+
+    \tparam WeightKernel Kernel of the distance weight function, SmoothWeightKernel by default
+    \ingroup fitting
+*/
+template <typename DataPoint, typename WeightKernel = SmoothWeightKernel<typename DataPoint::Scalar>>
+using NormalCurvatureFit = Basket<DataPoint, DistWeightFunc<DataPoint, WeightKernel>,
+                                  CovariancePlaneFit, CovariancePlaneSpaceDer, CurvatureEstimator>;
+
+/*!
+    \brief Caller-provided output buffers of computeNormalsCurvatures, in structure of arrays layout
+
+    Each buffer holds one entry per point of the tree, `Dim` consecutive scalars for the vectors. The null
+    buffers are not written. The entries of the points whose fit is not STABLE are set to NaN.
+    \ingroup fitting
+*/
+template <typename Scalar>
+struct NormalCurvatureBuffers
+{
+    Scalar* normals         {nullptr}; ///< Unit normal, given by `fit.primitiveGradient()`
+    Scalar* k1              {nullptr}; ///< Principal curvature of greatest absolute value
+    Scalar* k2              {nullptr}; ///< Principal curvature of smallest absolute value
+    Scalar* k1Directions    {nullptr}; ///< Principal direction of `k1`
+    Scalar* k2Directions    {nullptr}; ///< Principal direction of `k2`
+    FIT_RESULT* status      {nullptr}; ///< Result of the fit
+};
+
+namespace internal
+{
+    /*! \brief Tell if a fit provides `setLazyCurvature()`, see CurvatureEstimator */
+    template <class Fit, typename = void>
+    struct HasLazyCurvature : std::false_type {};
+
+    template <class Fit>
+    struct HasLazyCurvature<Fit, decltype(void(std::declval<Fit&>().setLazyCurvature(true)))> : std::true_type {};
+
+    /*! \brief Tell if a fit provides `setLazyDerivatives()`, see CovariancePlaneDer */
+    template <class Fit, typename = void>
+    struct HasLazyDerivatives : std::false_type {};
+
+    template <class Fit>
+    struct HasLazyDerivatives<Fit, decltype(void(std::declval<Fit&>().setLazyDerivatives(true)))> : std::true_type {};
+
+    /*! \brief Defer the curvatures and the derivatives of `_fit` to their first access, when it provides lazy modes */
+    template <typename Fit>
+    inline void setLazyOutputs(Fit& _fit)
+    {
+        if constexpr (HasLazyCurvature<Fit>::value)
+            _fit.setLazyCurvature(true);
+        if constexpr (HasLazyDerivatives<Fit>::value)
+            _fit.setLazyDerivatives(true);
+    }
+
+    /*! \brief Write the results of a fit to the entry `i` of the buffers */
+    template <typename Fit>
+    inline void writeNormalCurvature(const NormalCurvatureBuffers<typename Fit::Scalar>& _buffers, int _i,
+                                     const Fit& _fit, FIT_RESULT _res)
+    {
+        using Scalar     = typename Fit::Scalar;
+        using VectorType = typename Fit::VectorType;
+        constexpr int Dim = Fit::DataPoint::Dim;
+        const std::ptrdiff_t v = std::ptrdiff_t(_i) * Dim;
+        const Scalar nan = std::numeric_limits<Scalar>::quiet_NaN();
+        const bool stable = _res == STABLE;
+        const VectorType nanVector = VectorType::Constant(nan);
+
+        if (_buffers.normals != nullptr)
+            Eigen::Map<VectorType>(_buffers.normals + v) =
+                stable ? VectorType(_fit.primitiveGradient().normalized()) : nanVector;
+        if (_buffers.k1 != nullptr)
+            _buffers.k1[_i] = stable ? _fit.k1() : nan;
+        if (_buffers.k2 != nullptr)
+            _buffers.k2[_i] = stable ? _fit.k2() : nan;
+        if (_buffers.k1Directions != nullptr)
+            Eigen::Map<VectorType>(_buffers.k1Directions + v) = stable ? _fit.k1Direction() : nanVector;
+        if (_buffers.k2Directions != nullptr)
+            Eigen::Map<VectorType>(_buffers.k2Directions + v) = stable ? _fit.k2Direction() : nanVector;
+        if (_buffers.status != nullptr)
+            _buffers.status[_i] = _res;
+    }
+
+    /*!
+        \brief Fit the points indexed by `tree` by blocks of `blockSize` points, the neighborhoods of a block being
+        collected by `neighborhoods(positions, offsets, neighbors)` and the fit of its point `b` set up by
+        `setup(b, fit)`
+     */
+    template <typename Fit, typename TreeT, typename NeighborhoodFunctor, typename SetupFunctor>
+    inline void computeNormalsCurvaturesBlocks(const TreeT& tree, const NormalCurvatureBuffers<typename Fit::Scalar>& buffers,
+                                               int blockSize, NeighborhoodFunctor neighborhoods, SetupFunctor setup)
+    {
+        using VectorType = typename Fit::VectorType;
+
+        const int count    = tree.index_count();
+        const int* indices = tree.index_buffer();
+        blockSize = std::max(blockSize, 1);
+
+        // without curvature buffers, the fits skip the derivatives and the curvatures
+        const bool lazy = buffers.k1 == nullptr && buffers.k2 == nullptr &&
+                          buffers.k1Directions == nullptr && buffers.k2Directions == nullptr;
+
+        // the tree indices are in leaf order: consecutive fits share most of their neighbors in cache
+        std::vector<VectorType> positions;
+        std::vector<std::size_t> offsets;
+        std::vector<int> neighbors;
+        for (int first = 0; first < count; first += blockSize)
+        {
+            PONCA_TRACE_ZONE("ponca::computeNormalsCurvatures block");
+            const int size = std::min(blockSize, count - first);
+            positions.resize(size);
+            for (int b = 0; b < size; ++b)
+                positions[b] = tree.point(indices[first + b]).pos();
+
+            neighborhoods(positions, offsets, neighbors);
+            computeBatch<Fit>(size, tree.point_buffer(), offsets, neighbors,
+                [&](int b, Fit& fit) {
+                    setup(b, fit);
+                    if (lazy) setLazyOutputs(fit);
+                    fit.init(positions[b]);
+                },
+                [&](int b, const Fit& fit, FIT_RESULT res) {
+                    writeNormalCurvature(buffers, indices[first + b], fit, res);
+                });
+        }
+    }
+} // namespace internal
+
+/*!
+    \brief Estimate the normal and the principal curvatures of each point indexed by `tree` at the scale `scale`,
+    and write them to the caller-provided buffers
+
+    End-to-end pipeline replacing the usual glue code: the points indexed by the tree, e.g. a zero-copy tree
+    built by KdTree::build_view(), are processed by blocks of `blockSize` points in the leaf order of the tree.
+    The neighbors of the points of a block are collected by KdTree::range_neighbors_batch, then fitted by
+    computeBatch, both in parallel: no object is created per point, and the fits write their results directly
+    to the buffers. The entries of the points not indexed by the tree (see KdTree::build() sampling) are left
+    untouched.
+
+    \code
+    KdTree<Point> tree;
+    tree.build_view(points, count);
+    std::vector<Scalar> normals(3 * count), k1(count), k2(count);
+    NormalCurvatureBuffers<Scalar> buffers;
+    buffers.normals = normals.data(); buffers.k1 = k1.data(); buffers.k2 = k2.data();
+    computeNormalsCurvatures<NormalCurvatureFit<Point>>(tree, scale, buffers);
+    \endcode
+
+    \tparam Fit Fitting procedure, whose weight function is constructible from the scale and which provides
+    `primitiveGradient()`, `k1()`, `k2()`, `k1Direction()` and `k2Direction()`, e.g. NormalCurvatureFit
+    \param blockSize Number of points whose neighborhoods are stored at once
+    \see computeNormalsCurvaturesKnn to use the k-nearest neighbors
+    \ingroup fitting
+*/
+template <typename Fit, typename TreeT>
+inline void computeNormalsCurvatures(const TreeT& tree, typename Fit::Scalar scale,
+                                     const NormalCurvatureBuffers<typename Fit::Scalar>& buffers,
+                                     int blockSize = 65536)
+{
+    using WeightFunc = typename Fit::WFunctor;
+    PONCA_TRACE_ZONE("ponca::computeNormalsCurvatures");
+
+    internal::computeNormalsCurvaturesBlocks<Fit>(tree, buffers, blockSize,
+        [&](const auto& positions, std::vector<std::size_t>& offsets, std::vector<int>& neighbors) {
+            tree.range_neighbors_batch(positions, scale, offsets, neighbors);
+        },
+        [&](int, Fit& fit) { fit.setWeightFunc(WeightFunc(scale)); });
+}
+
+/*!
+    \brief Same as computeNormalsCurvatures, over the `k` nearest neighbors of each point, the point itself
+    included, at the scale of the distance to the farthest one
+
+    The neighbors are collected by KdTree::k_nearest_neighbors_batch. `k` is clamped to the number of points
+    indexed by the tree.
+    \ingroup fitting
+*/
+template <typename Fit, typename TreeT>
+inline void computeNormalsCurvaturesKnn(const TreeT& tree, int k,
+                                        const NormalCurvatureBuffers<typename Fit::Scalar>& buffers,
+                                        int blockSize = 65536)
+{
+    using Scalar     = typename Fit::Scalar;
+    using WeightFunc = typename Fit::WFunctor;
+    PONCA_TRACE_ZONE("ponca::computeNormalsCurvaturesKnn");
+
+    k = std::max(std::min(k, tree.index_count()), 1);
+    std::vector<typename TreeT::Scalar> squaredDistances;
+    internal::computeNormalsCurvaturesBlocks<Fit>(tree, buffers, blockSize,
+        [&](const auto& positions, std::vector<std::size_t>& offsets, std::vector<int>& neighbors) {
+            const std::size_t size = positions.size();
+            neighbors.resize(size * k);
+            squaredDistances.resize(size * k);
+            tree.k_nearest_neighbors_batch(positions, k, neighbors.data(), squaredDistances.data());
+            offsets.resize(size + 1);
+            for (std::size_t b = 0; b <= size; ++b)
+                offsets[b] = b * k;
+        },
+        [&](int b, Fit& fit) {
+            using std::sqrt;
+            const Scalar scale = Scalar(sqrt(squaredDistances[std::size_t(b + 1) * k - 1]));
+            fit.setWeightFunc(WeightFunc(std::max(scale, Eigen::NumTraits<Scalar>::dummy_precision())));
+        });
+}
+
+} // namespace Ponca
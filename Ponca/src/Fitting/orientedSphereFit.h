@@ -7,6 +7,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #pragma once
 
 #include "./algebraicSphere.h"
+#include "./accumulator.h"
 
 namespace Ponca
 {
@@ -37,18 +38,33 @@ public:
     typedef typename Base::VectorType VectorType;
     /*! \brief Weight Function*/
     typedef _WFunctor                 WFunctor;
+    /*! \brief Scalar type of the sums, see internal::AccumulatorScalar */
+    typedef typename internal::AccumulatorScalar<DataPoint>::type AccScalar;
+    /*! \brief Vector type of the sums */
+    typedef Eigen::Matrix<AccScalar, DataPoint::Dim, 1>          AccVectorType;
+    /*! \brief Number of neighbors accumulated at once by addNeighbors */
+    enum { BlockSize = 16 };
+    /*! \brief Block of neighbors stored by coordinates, one neighbor per row: relative position, normal, then weight */
+    typedef Eigen::Matrix<AccScalar, BlockSize, 2 * DataPoint::Dim + 1> NeighborBlock;
+    /*! \brief Sums of the blocks per row: weighted positions, weighted normals, dot products, then weight */
+    typedef Eigen::Array<AccScalar, BlockSize, 2 * DataPoint::Dim + 3>  BlockSums;
 
  protected:
 
     // computation data
-    VectorType  m_sumN, /*!< \brief Sum of the normal vectors */
-                m_sumP; /*!< \brief Sum of the relative positions */
-    Scalar  m_sumDotPN, /*!< \brief Sum of the dot product betwen relative positions and normals */
-            m_sumDotPP, /*!< \brief Sum of the squared relative positions */
-            m_sumW,     /*!< \brief Sum of queries weight */
-            m_nume,     /*!< \brief Numerator of the quadratic parameter (excluding the 0.5 coefficient)   */
+    AccVectorType  m_sumN, /*!< \brief Sum of the normal vectors */
+                   m_sumP; /*!< \brief Sum of the relative positions */
+    AccScalar  m_sumDotPN, /*!< \brief Sum of the dot product betwen relative positions and normals */
+               m_sumDotPP, /*!< \brief Sum of the squared relative positions */
+               m_sumW;     /*!< \brief Sum of queries weight */
+    Scalar  m_nume,     /*!< \brief Numerator of the quadratic parameter (excluding the 0.5 coefficient)   */
             m_deno;     /*!< \brief Denominator of the quadratic parameter (excluding the 0.5 coefficient) */
 
+    // compensation of the sums, see internal::CompensatedSum
+    static constexpr bool Compensated = internal::CompensatedSum<DataPoint>::value;
+    internal::SumCompensation<AccVectorType, Compensated> m_cSumN, m_cSumP;
+    internal::SumCompensation<AccScalar, Compensated>     m_cSumDotPN, m_cSumDotPP, m_cSumW;
+
     WFunctor m_w;      /*!< \brief Weight function (must inherits BaseWeightFunc) */
 
 public:
@@ -73,9 +89,74 @@ public:
     /*! \copydoc Concept::FittingProcedureConcept::addNeighbor() */
     PONCA_MULTIARCH inline bool addNeighbor(const DataPoint &_nei);
 
+    /*!
+        \brief Add the neighbors in `[_begin, _end)`, returns the number of neighbors used
+
+        Same as calling #addNeighbor on each neighbor, the neighbors used being gathered in a #NeighborBlock and
+        accumulated #BlockSize at a time with vectorized products. The sums are accumulated in a different order,
+        and may differ from the ones of #addNeighbor by rounding. With compensated sums (see
+        internal::CompensatedSum), the neighbors are added one by one.
+        \see Concept::FittingProcedureConcept::addNeighbors
+    */
+    template <typename IteratorBegin, typename IteratorEnd>
+    PONCA_MULTIARCH inline int addNeighbors(const IteratorBegin& _begin, const IteratorEnd& _end);
+
+    /*!
+        \brief Add the neighbors accumulated by `_other`, as if they were added to this fit
+        \see Basket::merge
+    */
+    PONCA_MULTIARCH inline void merge(const OrientedSphereFit& _other);
+
+    /*!
+        \brief Add the sums accumulated by `_other` multiplied by `_factor`, without counting its neighbors
+
+        Combines sums accumulated with different weights, e.g. the moments of computeScaleSweep, in which the
+        weights of a polynomial kernel are expanded over the powers of the squared distances.
+        \see computeScaleSweep
+    */
+    PONCA_MULTIARCH inline void addScaledSums(const OrientedSphereFit& _other, Scalar _factor);
+
+    /*!
+        \brief Add a group of neighbors at once from the sums of their positions and normals, returns true if they
+        were used
+
+        `_moments` provides `count`, `centroid()`, `sum_positions_around(c)`, `sum_normals`,
+        `sum_squared_norms_around(c)` and `sum_dots_around(c)`, as OctreeOrientedMoments. All the neighbors of the
+        group get the weight of their centroid, computed with the attributes of `_attributes`, e.g. one of the
+        neighbors: the error on the sums is bounded by the variation of the weight kernel over the extent of the
+        group. The sums of the extensions of the Basket, e.g. the derivatives, are not updated.
+        \see computeWithLod
+    */
+    template <typename Moments>
+    PONCA_MULTIARCH inline bool addMoments(const Moments& _moments, const DataPoint& _attributes);
+
+    /*!
+        \brief Remove a neighbor previously added with the same evaluation position, returns true if it was used
+
+        The weight of the neighbor is computed again: call it before #moveEvalPos, to remove the neighbors leaving
+        the neighborhood.
+    */
+    PONCA_MULTIARCH inline bool removeNeighbor(const DataPoint &_nei);
+
+    /*!
+        \brief Move the evaluation position, expressing the accumulated sums relatively to `_evalPos`
+
+        Together with #addNeighbor and #removeNeighbor, allows to update the fit incrementally when the
+        evaluation position slides over overlapping neighborhoods. The weights of the neighbors already added are
+        not updated: the fit is exact with a constant weight kernel only. Only the sums of this fitting procedure
+        are updated: Baskets with extensions accumulating neighbors, e.g. the derivatives, are rejected at compile
+        time by Basket::moveEvalPos and Basket::removeNeighbor.
+        \warning finalize consumes the sums: finalize a copy of the fit to keep updating it.
+    */
+    PONCA_MULTIARCH inline void moveEvalPos(const VectorType& _evalPos);
+
     /*! \copydoc Concept::FittingProcedureConcept::finalize() */
     PONCA_MULTIARCH inline FIT_RESULT finalize();
 
+protected:
+    /*! \brief Accumulate a block of neighbors in `_sums`, the unused rows being set to zero */
+    PONCA_MULTIARCH inline void accumulateNeighbors(const NeighborBlock& _block, BlockSums& _sums) const;
+
 }; //class OrientedSphereFit
 
 
@@ -159,6 +240,11 @@ public:
     /************************************************************************/
     /*! \see Concept::FittingProcedureConcept::addNeighbor() */
     PONCA_MULTIARCH bool addNeighbor(const DataPoint  &nei);
+    /*!
+        \brief Add the neighbors accumulated by `_other`, as if they were added to this fit
+        \see Basket::merge
+    */
+    PONCA_MULTIARCH inline void merge(const OrientedSphereDer& _other);
     /*! \see Concept::FittingProcedureConcept::finalize() */
     PONCA_MULTIARCH FIT_RESULT finalize   ();
 
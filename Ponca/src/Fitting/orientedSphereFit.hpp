@@ -14,11 +14,16 @@ OrientedSphereFit<DataPoint, _WFunctor, T>::init(const VectorType& _evalPos)
     Base::basisCenter() = _evalPos;
 
     // Setup fitting internal values
-    m_sumP     = VectorType::Zero();
-    m_sumN     = VectorType::Zero();
-    m_sumDotPN = Scalar(0.0);
-    m_sumDotPP = Scalar(0.0);
-    m_sumW     = Scalar(0.0);
+    m_sumP     = AccVectorType::Zero();
+    m_sumN     = AccVectorType::Zero();
+    m_sumDotPN = AccScalar(0.0);
+    m_sumDotPP = AccScalar(0.0);
+    m_sumW     = AccScalar(0.0);
+    m_cSumP.reset();
+    m_cSumN.reset();
+    m_cSumDotPN.reset();
+    m_cSumDotPP.reset();
+    m_cSumW.reset();
     m_nume     = Scalar(0.0);
     m_deno     = Scalar(0.0);
 }
@@ -35,14 +40,18 @@ OrientedSphereFit<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
 
     if (w > Scalar(0.))
     {
+        const AccVectorType aq = q.template cast<AccScalar>();
+        const AccVectorType an = _nei.normal().template cast<AccScalar>();
+        const AccScalar     aw = AccScalar(w);
+
         // increment matrix
-        m_sumP     += q * w;
-        m_sumN     += _nei.normal() * w;
-        m_sumDotPN += w * _nei.normal().dot(q);
-        m_sumDotPP += w * q.squaredNorm();
-        m_sumW     += w;
+        m_cSumP.add(m_sumP, aq * aw);
+        m_cSumN.add(m_sumN, an * aw);
+        m_cSumDotPN.add(m_sumDotPN, aw * an.dot(aq));
+        m_cSumDotPP.add(m_sumDotPP, aw * aq.squaredNorm());
+        m_cSumW.add(m_sumW, aw);
 
-        /*! \todo Handle add of multiple similar neighbors (maybe user side)*/
+        // similar neighbors are merged user side by collapseDuplicates, their number being the weight of the point
         ++(Base::m_nbNeighbors);
         return true;
     }
@@ -50,6 +59,171 @@ OrientedSphereFit<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
     return false;
 }
 
+template < class DataPoint, class _WFunctor, typename T>
+template <typename IteratorBegin, typename IteratorEnd>
+int
+OrientedSphereFit<DataPoint, _WFunctor, T>::addNeighbors(const IteratorBegin& _begin, const IteratorEnd& _end)
+{
+    constexpr int Dim = DataPoint::Dim;
+    int nbAdded = 0;
+
+    // the lanes of the blocks would not be compensated
+    if constexpr (Compensated)
+    {
+        for (auto it = _begin; it != _end; ++it)
+            if(addNeighbor(*it))
+                ++nbAdded;
+        return nbAdded;
+    }
+
+    NeighborBlock block;
+    BlockSums sums = BlockSums::Zero();
+    int count = 0;
+    for (auto it = _begin; it != _end; ++it)
+    {
+        const DataPoint& nei = *it;
+        // centered basis
+        const VectorType q = nei.pos() - Base::basisCenter();
+        const Scalar w = m_w.w(q, nei);
+        if (w > Scalar(0.))
+        {
+            block.row(count).template head<Dim>() = q.transpose().template cast<AccScalar>();
+            block.row(count).template segment<Dim>(Dim) = nei.normal().transpose().template cast<AccScalar>();
+            block(count, 2 * Dim) = AccScalar(w);
+            ++nbAdded;
+            if(++count == BlockSize)
+            {
+                accumulateNeighbors(block, sums);
+                count = 0;
+            }
+        }
+    }
+    if(count > 0)
+    {
+        block.bottomRows(BlockSize - count).setZero();
+        accumulateNeighbors(block, sums);
+    }
+
+    // reduce the lanes
+    const Eigen::Matrix<AccScalar, 1, BlockSums::ColsAtCompileTime> s = sums.colwise().sum();
+    m_sumP     += s.template segment<Dim>(0).transpose();
+    m_sumN     += s.template segment<Dim>(Dim).transpose();
+    m_sumDotPN += s(2 * Dim);
+    m_sumDotPP += s(2 * Dim + 1);
+    m_sumW     += s(2 * Dim + 2);
+
+    Base::m_nbNeighbors += nbAdded;
+    return nbAdded;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+OrientedSphereFit<DataPoint, _WFunctor, T>::accumulateNeighbors(const NeighborBlock& _block, BlockSums& _sums) const
+{
+    constexpr int Dim = DataPoint::Dim;
+    const auto b = _block.array();
+    const auto w = b.col(2 * Dim);
+    Eigen::Array<AccScalar, BlockSize, 1> dotPN = Eigen::Array<AccScalar, BlockSize, 1>::Zero(),
+                                          dotPP = Eigen::Array<AccScalar, BlockSize, 1>::Zero();
+    for (int i = 0; i < Dim; ++i)
+    {
+        _sums.col(i)       += w * b.col(i);
+        _sums.col(Dim + i) += w * b.col(Dim + i);
+        dotPN += b.col(i) * b.col(Dim + i);
+        dotPP += b.col(i) * b.col(i);
+    }
+    _sums.col(2 * Dim)     += w * dotPN;
+    _sums.col(2 * Dim + 1) += w * dotPP;
+    _sums.col(2 * Dim + 2) += w;
+}
+
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+OrientedSphereFit<DataPoint, _WFunctor, T>::merge(const OrientedSphereFit& _other)
+{
+    Base::merge(_other);
+    m_cSumN.merge(m_sumN, _other.m_sumN, _other.m_cSumN);
+    m_cSumP.merge(m_sumP, _other.m_sumP, _other.m_cSumP);
+    m_cSumDotPN.merge(m_sumDotPN, _other.m_sumDotPN, _other.m_cSumDotPN);
+    m_cSumDotPP.merge(m_sumDotPP, _other.m_sumDotPP, _other.m_cSumDotPP);
+    m_cSumW.merge(m_sumW, _other.m_sumW, _other.m_cSumW);
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+OrientedSphereFit<DataPoint, _WFunctor, T>::addScaledSums(const OrientedSphereFit& _other, Scalar _factor)
+{
+    const AccScalar f = AccScalar(_factor);
+    m_cSumN.add(m_sumN, f * _other.m_sumN);
+    m_cSumP.add(m_sumP, f * _other.m_sumP);
+    m_cSumDotPN.add(m_sumDotPN, f * _other.m_sumDotPN);
+    m_cSumDotPP.add(m_sumDotPP, f * _other.m_sumDotPP);
+    m_cSumW.add(m_sumW, f * _other.m_sumW);
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+template <typename Moments>
+bool
+OrientedSphereFit<DataPoint, _WFunctor, T>::addMoments(const Moments& _moments, const DataPoint& _attributes)
+{
+    const VectorType c = Base::basisCenter();
+    // weight of the centroid, shared by the neighbors of the group
+    Scalar w = m_w.w(_moments.centroid() - c, _attributes);
+
+    if (w > Scalar(0.))
+    {
+        const AccScalar aw = AccScalar(w);
+
+        m_cSumP.add(m_sumP, aw * _moments.sum_positions_around(c).template cast<AccScalar>());
+        m_cSumN.add(m_sumN, aw * _moments.sum_normals.template cast<AccScalar>());
+        m_cSumDotPN.add(m_sumDotPN, aw * AccScalar(_moments.sum_dots_around(c)));
+        m_cSumDotPP.add(m_sumDotPP, aw * AccScalar(_moments.sum_squared_norms_around(c)));
+        m_cSumW.add(m_sumW, aw * AccScalar(_moments.count));
+
+        Base::m_nbNeighbors += int(_moments.count);
+        return true;
+    }
+
+    return false;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+bool
+OrientedSphereFit<DataPoint, _WFunctor, T>::removeNeighbor(const DataPoint& _nei)
+{
+    VectorType q = _nei.pos() - Base::basisCenter();
+    // compute weight
+    Scalar w = m_w.w(q, _nei);
+
+    if (w > Scalar(0.))
+    {
+        const AccVectorType aq = q.template cast<AccScalar>();
+        const AccVectorType an = _nei.normal().template cast<AccScalar>();
+        const AccScalar     aw = AccScalar(w);
+
+        m_cSumP.add(m_sumP, -aq * aw);
+        m_cSumN.add(m_sumN, -an * aw);
+        m_cSumDotPN.add(m_sumDotPN, -aw * an.dot(aq));
+        m_cSumDotPP.add(m_sumDotPP, -aw * aq.squaredNorm());
+        m_cSumW.add(m_sumW, -aw);
+
+        --(Base::m_nbNeighbors);
+        return true;
+    }
+    return false;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+OrientedSphereFit<DataPoint, _WFunctor, T>::moveEvalPos(const VectorType& _evalPos)
+{
+    const AccVectorType delta = (_evalPos - Base::basisCenter()).template cast<AccScalar>();
+    m_cSumDotPP.add(m_sumDotPP, m_sumW * delta.squaredNorm() - AccScalar(2.) * delta.dot(m_sumP));
+    m_cSumDotPN.add(m_sumDotPN, -delta.dot(m_sumN));
+    m_cSumP.add(m_sumP, -m_sumW * delta);
+    Base::basisCenter() = _evalPos;
+}
 
 template < class DataPoint, class _WFunctor, typename T>
 FIT_RESULT
@@ -60,11 +234,12 @@ OrientedSphereFit<DataPoint, _WFunctor, T>::finalize ()
     PONCA_MULTIARCH_STD_MATH(abs);
 
     // 1. finalize sphere fitting
-    Scalar epsilon = Eigen::NumTraits<Scalar>::dummy_precision();
+    // the neighbors are known with the precision of Scalar, even when accumulated in a wider type
+    AccScalar epsilon = Eigen::NumTraits<Scalar>::dummy_precision();
 
     // handle specific configurations
     // With less than 3 neighbors the fitting is undefined
-    if(m_sumW == Scalar(0.) || Base::m_nbNeighbors < 3)
+    if(m_sumW == AccScalar(0.) || Base::m_nbNeighbors < 3)
     {
         Base::m_ul.setZero();
         Base::m_uc = Scalar(0.);
@@ -74,14 +249,17 @@ OrientedSphereFit<DataPoint, _WFunctor, T>::finalize ()
         return Base::m_eCurrentState;
     }
 
-    Scalar invSumW = Scalar(1.)/m_sumW;
+    // the parameters are computed from the sums in AccScalar, and converted to Scalar
+    AccScalar invSumW = AccScalar(1.)/m_sumW;
 
-    m_nume = (m_sumDotPN - invSumW * m_sumP.dot(m_sumN));
-    Scalar den1 = invSumW * m_sumP.dot(m_sumP);
-    m_deno = m_sumDotPP - den1;
+    AccScalar nume = (m_sumDotPN - invSumW * m_sumP.dot(m_sumN));
+    AccScalar den1 = invSumW * m_sumP.dot(m_sumP);
+    AccScalar deno = m_sumDotPP - den1;
+    m_nume = Scalar(nume);
+    m_deno = Scalar(deno);
 
     // Deal with degenerate cases
-    if(abs(m_deno) < epsilon * max(m_sumDotPP, den1))
+    if(abs(deno) < epsilon * max(m_sumDotPP, den1))
     {
         //plane
         Scalar s = Scalar(1.) / Base::m_ul.norm();
@@ -92,9 +270,11 @@ OrientedSphereFit<DataPoint, _WFunctor, T>::finalize ()
     else
     {
         //Generic case
-        Base::m_uq = Scalar(.5) * m_nume / m_deno;
-        Base::m_ul = (m_sumN - m_sumP * (Scalar(2.) * Base::m_uq)) * invSumW;
-        Base::m_uc = -invSumW * (Base::m_ul.dot(m_sumP) + m_sumDotPP * Base::m_uq);
+        AccScalar     uq = AccScalar(.5) * nume / deno;
+        AccVectorType ul = (m_sumN - m_sumP * (AccScalar(2.) * uq)) * invSumW;
+        Base::m_uq = Scalar(uq);
+        Base::m_ul = ul.template cast<Scalar>();
+        Base::m_uc = Scalar(-invSumW * (ul.dot(m_sumP) + m_sumDotPP * uq));
     }
 
     Base::m_isNormalized = false;
@@ -150,10 +330,10 @@ OrientedSphereDer<DataPoint, _WFunctor, T, Type>::addNeighbor(const DataPoint  &
         VectorType q = _nei.pos() - Base::basisCenter();
 
         // compute weight derivatives
-        if (Type & FitScaleDer)
+        if constexpr (isScaleDer())
             dw[0] = Base::m_w.scaledw(q, _nei);
 
-        if (Type & FitSpaceDer)
+        if constexpr (isSpaceDer())
             dw.template tail<int(DataPoint::Dim)>() = -Base::m_w.spacedw(q, _nei).transpose();
 
         // increment
@@ -169,6 +349,18 @@ OrientedSphereDer<DataPoint, _WFunctor, T, Type>::addNeighbor(const DataPoint  &
     return false;
 }
 
+template < class DataPoint, class _WFunctor, typename T, int Type>
+void
+OrientedSphereDer<DataPoint, _WFunctor, T, Type>::merge(const OrientedSphereDer& _other)
+{
+    Base::merge(_other);
+    m_dSumW     += _other.m_dSumW;
+    m_dSumP     += _other.m_dSumP;
+    m_dSumN     += _other.m_dSumN;
+    m_dSumDotPN += _other.m_dSumDotPN;
+    m_dSumDotPP += _other.m_dSumDotPP;
+}
+
 
 template < class DataPoint, class _WFunctor, typename T, int Type>
 FIT_RESULT
@@ -180,29 +372,36 @@ OrientedSphereDer<DataPoint, _WFunctor, T, Type>::finalize()
     // Test if base finalize end on a viable case (stable / unstable)
     if (this->isReady())
     {
-        Scalar invSumW = Scalar(1.)/Base::m_sumW;
+        // sums converted from the accumulator type
+        const Scalar     sumW     = Scalar(Base::m_sumW);
+        const Scalar     sumDotPN = Scalar(Base::m_sumDotPN);
+        const Scalar     sumDotPP = Scalar(Base::m_sumDotPP);
+        const VectorType sumP     = Base::m_sumP.template cast<Scalar>();
+        const VectorType sumN     = Base::m_sumN.template cast<Scalar>();
+
+        Scalar invSumW = Scalar(1.)/sumW;
 
-        Scalar nume  = Base::m_sumDotPN - invSumW*Base::m_sumP.dot(Base::m_sumN);
-        Scalar deno  = Base::m_sumDotPP - invSumW*Base::m_sumP.dot(Base::m_sumP);
+        Scalar nume  = sumDotPN - invSumW*sumP.dot(sumN);
+        Scalar deno  = sumDotPP - invSumW*sumP.dot(sumP);
 
-        // FIXME, the following product "Base::m_sumN.transpose() * m_dSumP" is prone to numerical cancellation
+        // FIXME, the following product "sumN.transpose() * m_dSumP" is prone to numerical cancellation
         // issues for spacial derivatives because, (d sum w_i P_i)/(d x) is supposed to be tangent to the surface whereas
         // "sum w_i N_i" is normal to the surface...
         m_dNume = m_dSumDotPN
-            - invSumW*invSumW * ( Base::m_sumW * ( Base::m_sumN.transpose() * m_dSumP + Base::m_sumP.transpose() * m_dSumN )
-            - m_dSumW*Base::m_sumP.dot(Base::m_sumN) );
+            - invSumW*invSumW * ( sumW * ( sumN.transpose() * m_dSumP + sumP.transpose() * m_dSumN )
+            - m_dSumW*sumP.dot(sumN) );
 
         m_dDeno = m_dSumDotPP
-            - invSumW*invSumW*(   Scalar(2.) * Base::m_sumW * Base::m_sumP.transpose() * m_dSumP
-            - m_dSumW*Base::m_sumP.dot(Base::m_sumP) );
+            - invSumW*invSumW*(   Scalar(2.) * sumW * sumP.transpose() * m_dSumP
+            - m_dSumW*sumP.dot(sumP) );
 
         m_dUq =  Scalar(.5) * (deno * m_dNume - m_dDeno * nume)/(deno*deno);
 
         // FIXME: this line is prone to numerical cancellation issues because dSumN and u_l*dSumW are close to each other.
         // If using two passes, one could directly compute sum( dw_i + (n_i - ul) ) to avoid this issue.
-        m_dUl =  invSumW * ( m_dSumN - Base::m_ul*m_dSumW - Scalar(2.)*(m_dSumP*Base::m_uq + Base::m_sumP*m_dUq) );
-        m_dUc = -invSumW*( Base::m_sumP.transpose() * m_dUl
-            + Base::m_sumDotPP * m_dUq
+        m_dUl =  invSumW * ( m_dSumN - Base::m_ul*m_dSumW - Scalar(2.)*(m_dSumP*Base::m_uq + sumP*m_dUq) );
+        m_dUc = -invSumW*( sumP.transpose() * m_dUl
+            + sumDotPP * m_dUq
             + Base::m_ul.transpose() * m_dSumP
             + Base::m_uq * m_dSumDotPP
             + m_dSumW * Base::m_uc);
@@ -219,7 +418,7 @@ OrientedSphereDer<DataPoint, _WFunctor, T, Type>::dNormal() const
   // Therefore, we must take into account the variation of the evaluation point when differentiating wrt space
   // i.e., normal(x) = grad / |grad|, with grad(x) = ul + 2 uq * x, and diff_x(grad) = dul + 2 uq I
   VectorArray dgrad = m_dUl;
-  if(isSpaceDer())
+  if constexpr (isSpaceDer())
     dgrad.template rightCols<DataPoint::Dim>().diagonal().array() += Scalar(2)*Base::m_uq;
   Scalar norm  = Base::m_ul.norm();
   Scalar norm3 = norm*norm*norm;
@@ -231,7 +430,7 @@ typename OrientedSphereDer <DataPoint, _WFunctor, T, Type>::ScalarArray
 OrientedSphereDer<DataPoint, _WFunctor, T, Type>::dPotential() const
 {
   ScalarArray dfield = m_dUc;
-  if(isSpaceDer())
+  if constexpr (isSpaceDer())
     dfield.template tail<DataPoint::Dim>() += Base::m_ul;
   return dfield;
 }
@@ -92,8 +92,8 @@ public:
     PONCA_MULTIARCH inline void resetPrimitive()
     {
         Base::resetPrimitive();
-        EigenBase* cc = static_cast<EigenBase*>(this);
-        *cc = EigenBase();
+        // the default Eigen::Hyperplane is not initialized
+        EigenBase::coeffs().setZero();
     }
 
     PONCA_MULTIARCH inline bool operator==(const Plane<DataPoint, WFunctor, T>& other) const{
@@ -0,0 +1,161 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+#include "../Common/Tracing.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace Ponca
+{
+
+/*!
+    \brief Parameters of tracePolyline, the distances being relative to the scale of the fits
+    \ingroup fitting
+*/
+template <typename Scalar>
+struct PolylineTraceParams
+{
+    Scalar step {Scalar(0.5)};          /*!< \brief Distance between consecutive samples */
+    Scalar margin {Scalar(0.5)};        /*!< \brief Extra radius of the neighborhoods reused by the next samples */
+    Scalar maxResidual {Scalar(0.05)};  /*!< \brief Largest mean squared distance of the neighbors to the line,
+                                             relative to the squared scale, beyond which the polyline stops */
+    Scalar maxCentroidOffset {Scalar(0.5)}; /*!< \brief Largest distance between a sample and the centroid of its
+                                             neighbors, beyond which the polyline stops: reached at the ends of the
+                                             curves, where the neighbors lie on one side */
+    int maxSamples {1000};              /*!< \brief Largest number of samples on each side of the seed */
+    COVARIANCE_SOLVER solver {LARGEST_EIGENVECTOR_SOLVER}; /*!< \brief Solver of the line fits */
+};
+
+/*!
+    \brief Trace the polyline following the line-like points of `tree` from `seed`, e.g. a crease of a surface
+    given by edge samples, and write its samples in order in `polyline`
+
+    At each sample, the neighbors within `scale` are fitted by a line, the sample is projected on the line, and the
+    next sample is taken `step * scale` further along its direction, oriented as the previous step. The polyline
+    is traced on both sides of the seed, and each side stops when the fit is not #STABLE, when the mean squared
+    distance of its neighbors to the line exceeds `maxResidual * scale^2` (e.g. at a corner), when the sample is
+    farther than `maxCentroidOffset * scale` from the centroid of its neighbors (at the end of the curve), or after
+    `maxSamples` samples.
+
+    Consecutive samples share most of their neighbors: the neighbors of radius `(1 + margin) * scale` of a sample
+    are gathered once, and reused by the next samples as long as they are closer than `margin * scale` to it,
+    filtering the gathered neighbors by distance instead of querying the tree again.
+
+    \code
+    typedef Basket<Point, DistWeightFunc<Point, ConstantWeightKernel<Scalar> >, CovarianceLineFit> Fit;
+    std::vector<Point::VectorType> polyline;
+    const bool closed = tracePolyline<Fit>(kdtree, seed, scale, PolylineTraceParams<Scalar>(), polyline);
+    \endcode
+
+    \tparam Fit Line fitting procedure providing `setSolver`, e.g. a Basket of CovarianceLineFit, whose weight
+    function is constructible from `scale`
+    \tparam TreeT Spatial structure providing `range_neighbors(point, radius)` and `point(index)`, e.g. KdTree
+    \return true when the polyline closes on the seed, `polyline` then starting and ending at the same sample
+    \ingroup fitting
+*/
+template <typename Fit, typename TreeT>
+inline bool tracePolyline(const TreeT& tree, const typename Fit::VectorType& seed, typename Fit::Scalar scale,
+                          const PolylineTraceParams<typename Fit::Scalar>& params,
+                          std::vector<typename Fit::VectorType>& polyline)
+{
+    typedef typename Fit::DataPoint  DataPoint;
+    typedef typename Fit::Scalar     Scalar;
+    typedef typename Fit::VectorType VectorType;
+    typedef typename Fit::WFunctor   WeightFunc;
+
+    PONCA_TRACE_ZONE("ponca::tracePolyline");
+    polyline.clear();
+
+    const Scalar outer = (Scalar(1) + params.margin) * scale, reuse2 = params.margin * params.margin * scale * scale;
+    const Scalar scale2 = scale * scale, step = params.step * scale, maxResidual = params.maxResidual * scale2;
+    const Scalar maxOffset2 = params.maxCentroidOffset * params.maxCentroidOffset * scale2;
+
+    auto query = tree.range_neighbors(seed, outer);
+    std::vector<int> candidates;
+    std::vector<DataPoint> neighbors;
+    VectorType anchor = seed;
+    bool cached = false;
+
+    // fit the neighborhood of `_x`, returns false when the polyline stops
+    const auto fitAt = [&](const VectorType& _x, VectorType& _sample, VectorType& _direction) {
+        if (!cached || (_x - anchor).squaredNorm() > reuse2)
+        {
+            candidates.clear();
+            for (int j : query(_x, outer))
+                candidates.push_back(j);
+            anchor = _x;
+            cached = true;
+        }
+        neighbors.clear();
+        for (int j : candidates)
+            if ((tree.point(j).pos() - _x).squaredNorm() < scale2)
+                neighbors.push_back(tree.point(j));
+
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(scale));
+        fit.setSolver(params.solver);
+        fit.init(_x);
+        if (fit.compute(neighbors.cbegin(), neighbors.cend()) != STABLE)
+            return false;
+
+        Scalar residual = Scalar(0);
+        for (const DataPoint& p : neighbors)
+            residual += fit.potential(p.pos());
+        if (residual > maxResidual * Scalar(neighbors.size()))
+            return false;
+
+        _sample = fit.project(_x);
+        if ((_sample - fit.basisCenter() - fit.origin()).squaredNorm() > maxOffset2)
+            return false;
+        _direction = fit.direction();
+        return true;
+    };
+
+    VectorType start, startDirection;
+    if (!fitAt(seed, start, startDirection))
+        return false;
+    polyline.push_back(start);
+
+    // the forward side, then the backward one, prepended in reverse order
+    std::vector<VectorType> backward;
+    for (int side = 0; side < 2; ++side)
+    {
+        std::vector<VectorType>& samples = side == 0 ? polyline : backward;
+        VectorType sample = start, direction = side == 0 ? startDirection : VectorType(-startDirection);
+        for (int s = 0; s < params.maxSamples; ++s)
+        {
+            VectorType next, nextDirection;
+            if (!fitAt(sample + step * direction, next, nextDirection))
+                break;
+            if (nextDirection.dot(direction) < Scalar(0))
+                nextDirection = -nextDirection;
+
+            // back to the seed: the polyline is closed, without a sample closer than half a step to the seed
+            const Scalar toStart = (next - start).squaredNorm();
+            if (side == 0 && polyline.size() > 3 && toStart < step * step)
+            {
+                if (toStart > Scalar(0.25) * step * step)
+                    polyline.push_back(next);
+                polyline.push_back(start);
+                return true;
+            }
+            samples.push_back(next);
+            sample = next;
+            direction = nextDirection;
+        }
+    }
+
+    std::reverse(backward.begin(), backward.end());
+    polyline.insert(polyline.begin(), backward.begin(), backward.end());
+    return false;
+}
+
+} // namespace Ponca
@@ -0,0 +1,252 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Ponca
+{
+
+namespace internal
+{
+    /*! \brief Tell if a fit provides `potentialBatch` and `primitiveGradientBatch`, see AlgebraicSphere */
+    template <class Fit, typename = void>
+    struct HasPotentialBatch : std::false_type {};
+
+    template <class Fit>
+    struct HasPotentialBatch<Fit, decltype(void(std::declval<const Fit&>().potentialBatch(
+        std::declval<const typename Fit::VectorType*>(), std::declval<typename Fit::Scalar*>(), 0)))>
+        : std::true_type {};
+} // namespace internal
+
+/*!
+    \brief Scalar field and gradient of the surface fitted over a tree, evaluated at the vertices of a regular
+    3D grid, e.g. for marching cubes
+
+    The grid is processed by cubic blocks of blockSize() vertices per side, in parallel:
+     - the neighbors of the whole block are gathered by a single range query of radius `scale` plus the half
+       diagonal of the block, around its center. The blocks without neighbors, far from the points, are skipped:
+       the query is pruned by the bounds of the tree nodes, and no fit is computed,
+     - with #GRID_FIT_PER_VERTEX, each vertex is fitted over these neighbors: the neighbors beyond `scale` get
+       a null weight from the weight functions of compact support, such as DistWeightFunc, so that the values are
+       the ones of a fresh fit at each vertex,
+     - with #GRID_FIT_PER_BLOCK, the block is fitted once at its center.
+
+    The fits are evaluated at the vertices of a block at once, with the vectorized `potentialBatch` and
+    `primitiveGradientBatch` of the fits providing them, e.g. AlgebraicSphere.
+
+    \code
+    PotentialGrid<Fit, KdTree<Point> > grid(kdtree, scale);
+    std::vector<Scalar> potentials(nx * ny * nz);
+    grid.evaluate(origin, spacing, nx, ny, nz, potentials.data());
+    \endcode
+
+    \tparam Fit Fitting procedure providing `potential` and `primitiveGradient`, e.g. a Basket, whose weight
+    function is constructible from `scale` and null beyond it
+    \tparam TreeT Spatial structure providing `point(i)` and `range_neighbors(point, radius)` returning a query
+    rebindable with `operator()(point, radius)`, e.g. KdTree
+    \see MlsProjection
+    \ingroup fitting
+*/
+template <typename Fit, typename TreeT>
+class PotentialGrid
+{
+public:
+    typedef typename Fit::DataPoint  DataPoint;  /*!< \brief Point type of the fit */
+    typedef typename Fit::Scalar     Scalar;     /*!< \brief Scalar type of the fit */
+    typedef typename Fit::VectorType VectorType; /*!< \brief Vector type of the fit */
+    typedef typename Fit::WFunctor   WeightFunc; /*!< \brief Weight function of the fit */
+
+    static_assert(DataPoint::Dim == 3, "PotentialGrid evaluates 3D grids");
+
+    /*! \brief Work done by evaluate() */
+    struct Statistics
+    {
+        int blockCount {0};        /*!< \brief Number of blocks of the grid */
+        int skippedBlockCount {0}; /*!< \brief Number of blocks without neighbors, not fitted */
+        long long fitCount {0};    /*!< \brief Number of fits */
+    };
+
+    /*!
+        \brief Evaluation of the surface fitted at scale `_scale` over the points of `_tree`
+        \param _tree Spatial structure, which must outlive the evaluation
+    */
+    inline PotentialGrid(const TreeT& _tree, Scalar _scale) : m_tree(&_tree), m_scale(_scale) {}
+
+    /*! \brief Set the fits of the vertices (default: #GRID_FIT_PER_VERTEX) */
+    inline void setFitMode(GRID_FIT _mode) { m_mode = _mode; }
+    inline GRID_FIT fitMode() const { return m_mode; }
+
+    /*!
+        \brief Set the number of vertices per side of the blocks, 0 (the default) to deduce it from the spacing
+
+        Larger blocks query the tree less often, but gather more neighbors per vertex. By default, the half
+        diagonal of the blocks is at most half the scale: the neighbors of a block are at most
+        \f$ 1.5^2 \f$ times the neighbors of a vertex on a surface.
+    */
+    inline void setBlockSize(int _blockSize) { m_blockSize = std::max(_blockSize, 0); }
+    inline int blockSize() const { return m_blockSize; }
+
+    /*! \brief Number of vertices per side of the blocks used by evaluate() for a grid of spacing `_spacing` */
+    inline int blockSize(Scalar _spacing) const
+    {
+        if (m_blockSize > 0)
+            return m_blockSize;
+        const Scalar size = Scalar(1) + m_scale / (_spacing * std::sqrt(Scalar(3)));
+        return size < Scalar(64) ? int(size) : 64;
+    }
+
+    /*! \brief Scale of the fits */
+    inline Scalar scale() const { return m_scale; }
+
+    /*!
+        \brief Evaluate the `_nx * _ny * _nz` vertices \f$ o + h (i, j, k) \f$, \f$ o \f$ being `_origin` and
+        \f$ h \f$ `_spacing`
+
+        The vertex \f$ (i, j, k) \f$ is written at the index \f$ i + n_x (j + n_y k) \f$ of the output arrays:
+        `_potentials` receives the potential of the fit, `_gradients` its gradient (not normalized), and `_states`
+        the state of the fit. The null arrays are not written. The potential and the gradient of the vertices
+        whose fit is #UNDEFINED, e.g. the vertices without neighbors, are NaN.
+    */
+    inline Statistics evaluate(const VectorType& _origin, Scalar _spacing, int _nx, int _ny, int _nz,
+                               Scalar* _potentials, VectorType* _gradients = nullptr,
+                               FIT_RESULT* _states = nullptr) const
+    {
+        const int bs = blockSize(_spacing);
+        const int bx = (_nx + bs - 1) / bs, by = (_ny + bs - 1) / bs, bz = (_nz + bs - 1) / bs;
+        const int blockCount = bx * by * bz;
+
+        Statistics stats;
+        stats.blockCount = blockCount;
+        int skipped = 0;
+        long long fits = 0;
+
+#pragma omp parallel reduction(+:skipped, fits)
+        {
+            auto query = m_tree->range_neighbors(VectorType::Zero(), Scalar(0));
+            std::vector<DataPoint> neighbors;
+            std::vector<VectorType> positions;
+            std::vector<Scalar> potentials;
+            std::vector<VectorType> gradients;
+            std::vector<FIT_RESULT> states;
+
+#pragma omp for schedule(dynamic, 1)
+            for (int b = 0; b < blockCount; ++b)
+            {
+                // vertices of the block
+                const int i0 = (b % bx) * bs, j0 = ((b / bx) % by) * bs, k0 = (b / (bx * by)) * bs;
+                const int ni = std::min(bs, _nx - i0), nj = std::min(bs, _ny - j0), nk = std::min(bs, _nz - k0);
+                const int n = ni * nj * nk;
+                positions.resize(n);
+                for (int v = 0; v < n; ++v)
+                    positions[v] = _origin + _spacing * VectorType(Scalar(i0 + v % ni), Scalar(j0 + (v / ni) % nj),
+                                                                   Scalar(k0 + v / (ni * nj)));
+
+                const VectorType center = (positions.front() + positions.back()) / Scalar(2);
+                const Scalar halfDiagonal = (positions.back() - positions.front()).norm() / Scalar(2);
+                neighbors.clear();
+                for (int j : query(center, m_scale + halfDiagonal))
+                    neighbors.push_back(m_tree->point(j));
+
+                potentials.resize(n);
+                gradients.resize(n);
+                states.assign(n, UNDEFINED);
+                if (neighbors.empty())
+                    ++skipped;
+                else
+                    fits += fitBlock(center, neighbors, positions, potentials, gradients, states);
+
+                // scatter the block to the grid
+                const Scalar nan = std::numeric_limits<Scalar>::quiet_NaN();
+                for (int v = 0; v < n; ++v)
+                {
+                    const std::size_t g = std::size_t(i0 + v % ni) +
+                        std::size_t(_nx) * (std::size_t(j0 + (v / ni) % nj) + std::size_t(_ny) * std::size_t(k0 + v / (ni * nj)));
+                    const bool defined = states[v] != UNDEFINED;
+                    if (_potentials)
+                        _potentials[g] = defined ? potentials[v] : nan;
+                    if (_gradients)
+                        _gradients[g] = defined ? gradients[v] : VectorType::Constant(nan);
+                    if (_states)
+                        _states[g] = states[v];
+                }
+            }
+        }
+
+        stats.skippedBlockCount = skipped;
+        stats.fitCount = fits;
+        return stats;
+    }
+
+private:
+    /*!
+        \brief Fit the block of vertices `_positions` over `_neighbors`, and evaluate the fits at the vertices
+        \return the number of fits
+    */
+    inline int fitBlock(const VectorType& _center, const std::vector<DataPoint>& _neighbors,
+                        const std::vector<VectorType>& _positions, std::vector<Scalar>& _potentials,
+                        std::vector<VectorType>& _gradients, std::vector<FIT_RESULT>& _states) const
+    {
+        const int n = int(_positions.size());
+        if (m_mode == GRID_FIT_PER_BLOCK)
+        {
+            Fit fit;
+            fit.setWeightFunc(WeightFunc(m_scale));
+            fit.init(_center);
+            const FIT_RESULT res = fit.compute(_neighbors.cbegin(), _neighbors.cend());
+            if (res == STABLE)
+            {
+                if constexpr (internal::HasPotentialBatch<Fit>::value)
+                {
+                    fit.potentialBatch(_positions.data(), _potentials.data(), n);
+                    fit.primitiveGradientBatch(_positions.data(), _gradients.data(), n);
+                }
+                else
+                {
+                    for (int v = 0; v < n; ++v)
+                    {
+                        _potentials[v] = fit.potential(_positions[v]);
+                        _gradients[v]  = fit.primitiveGradient(_positions[v]);
+                    }
+                }
+                std::fill(_states.begin(), _states.end(), res);
+                return 1;
+            }
+        }
+
+        // a fit per vertex, over the neighbors of the block
+        for (int v = 0; v < n; ++v)
+        {
+            Fit fit;
+            fit.setWeightFunc(WeightFunc(m_scale));
+            fit.init(_positions[v]);
+            _states[v] = fit.compute(_neighbors.cbegin(), _neighbors.cend());
+            if (_states[v] != UNDEFINED)
+            {
+                _potentials[v] = fit.potential(_positions[v]);
+                _gradients[v]  = fit.primitiveGradient(_positions[v]);
+            }
+        }
+        return n + (m_mode == GRID_FIT_PER_BLOCK ? 1 : 0);
+    }
+
+    const TreeT* m_tree;                       /*!< \brief Spatial structure indexing the points */
+    Scalar m_scale;                            /*!< \brief Scale of the fits */
+    GRID_FIT m_mode {GRID_FIT_PER_VERTEX};     /*!< \brief Fits of the vertices */
+    int m_blockSize {0};                       /*!< \brief Number of vertices per side of the blocks, 0 for auto */
+};
+
+} // namespace Ponca
@@ -51,6 +51,13 @@ public:
         m_nbNeighbors = 0;
     }
 
+    /*! \brief Add the neighbors counted by `_other`
+        \see Basket::merge */
+    PONCA_MULTIARCH inline void merge(const PrimitiveBase& _other)
+    {
+        m_nbNeighbors += _other.m_nbNeighbors;
+    }
+
     /*! \brief Is the primitive well fitted an ready to use (finalize has been
     called)
     \warning The fit can be unstable (having neighbors between 3 and 6) */
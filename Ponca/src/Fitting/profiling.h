@@ -0,0 +1,272 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./enums.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  else
+#    include <x86intrin.h>
+#  endif
+#  define PONCA_HAS_RDTSC
+#endif
+
+namespace Ponca
+{
+
+/*! \brief Phases of a fit timed by FitProfiling */
+enum FIT_PHASE
+{
+    FIT_PHASE_INIT         = 0, /*!< \brief init() */
+    FIT_PHASE_TRAVERSAL    = 1, /*!< \brief Time spent outside of the fit between init() and the end of the last
+                                             finalize(): the traversal of the neighbors by the caller */
+    FIT_PHASE_ACCUMULATION = 2, /*!< \brief addNeighbor() */
+    FIT_PHASE_FINALIZE     = 3, /*!< \brief finalize(), e.g. the eigen solves */
+    FIT_PHASE_COUNT        = 4
+};
+
+namespace internal
+{
+    /*! \brief Time stamp counter of the CPU, or the time in nanoseconds when it is not available */
+    inline std::uint64_t readCycleCounter()
+    {
+#ifdef PONCA_HAS_RDTSC
+        return __rdtsc();
+#elif defined(__aarch64__)
+        std::uint64_t value;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+        return value;
+#else
+        return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+} // namespace internal
+
+/*! \brief Cycles spent by a fit in each #FIT_PHASE, and its neighbors, recorded by FitProfiling */
+struct FitPhaseProfile
+{
+    std::array<std::uint64_t, FIT_PHASE_COUNT> cycles {}; /*!< \brief Cycles of each #FIT_PHASE */
+    std::uint64_t neighbors {0}; /*!< \brief Calls to addNeighbor(), over all the passes */
+    std::uint64_t accepted  {0}; /*!< \brief Neighbors accepted by the fit, over all the passes */
+    int passes {0};              /*!< \brief Calls to finalize() */
+
+    /*! \brief Cycles of all the phases */
+    inline std::uint64_t total() const
+    {
+        std::uint64_t sum = 0;
+        for (std::uint64_t c : cycles) sum += c;
+        return sum;
+    }
+};
+
+/*!
+    \brief Distribution of the profiles of many fits: total cycles of each #FIT_PHASE, and histograms of the cycles
+    per fit and of the neighbors per fit
+
+    The histograms have power of two bins: bin 0 counts the zero values, and bin \f$ b \f$ the values in
+    \f$ [2^{b-1}, 2^b) \f$. Each thread may record its fits in its own histogram, the histograms being summed
+    afterwards with operator+=.
+
+    \see FitProfiling
+*/
+struct FitProfileHistogram
+{
+    enum { BinCount = 65 };
+    typedef std::array<std::uint64_t, BinCount> Histogram;
+
+    std::uint64_t fits {0};      /*!< \brief Number of recorded fits */
+    std::uint64_t neighbors {0}; /*!< \brief Calls to addNeighbor() of the recorded fits */
+    std::uint64_t passes {0};    /*!< \brief Passes of the recorded fits */
+    std::array<std::uint64_t, FIT_PHASE_COUNT> cycles {}; /*!< \brief Total cycles of each #FIT_PHASE */
+    std::array<Histogram, FIT_PHASE_COUNT> cycleHistograms {}; /*!< \brief Cycles per fit of each #FIT_PHASE */
+    Histogram neighborHistogram {}; /*!< \brief Calls to addNeighbor() per fit */
+
+    /*! \brief Bin of `value` in the histograms */
+    static inline int bin(std::uint64_t value)
+    {
+        int b = 0;
+        for (; value > 0; value >>= 1) ++b;
+        return b;
+    }
+
+    /*! \brief Record the profile of one fit */
+    inline void add(const FitPhaseProfile& profile)
+    {
+        ++fits;
+        neighbors += profile.neighbors;
+        passes    += std::uint64_t(profile.passes);
+        for (int p = 0; p < FIT_PHASE_COUNT; ++p)
+        {
+            cycles[p] += profile.cycles[p];
+            ++cycleHistograms[p][bin(profile.cycles[p])];
+        }
+        ++neighborHistogram[bin(profile.neighbors)];
+    }
+
+    inline FitProfileHistogram& operator+=(const FitProfileHistogram& other)
+    {
+        fits      += other.fits;
+        neighbors += other.neighbors;
+        passes    += other.passes;
+        for (int p = 0; p < FIT_PHASE_COUNT; ++p)
+        {
+            cycles[p] += other.cycles[p];
+            for (int b = 0; b < BinCount; ++b)
+                cycleHistograms[p][b] += other.cycleHistograms[p][b];
+        }
+        for (int b = 0; b < BinCount; ++b)
+            neighborHistogram[b] += other.neighborHistogram[b];
+        return *this;
+    }
+
+    /*! \brief Name of a #FIT_PHASE */
+    static inline const char* phaseName(int phase)
+    {
+        static const char* names[FIT_PHASE_COUNT] = {"init", "traversal", "accumulation", "finalize"};
+        return names[phase];
+    }
+
+    /*! \brief Human readable report: share of each phase and non-empty bins of the histograms */
+    inline std::string to_string() const
+    {
+        std::uint64_t total = 0;
+        for (std::uint64_t c : cycles) total += c;
+
+        std::stringstream str;
+        str << "fits: " << fits << " (" << passes << " passes, " << neighbors << " neighbors)\n";
+        for (int p = 0; p < FIT_PHASE_COUNT; ++p)
+        {
+            str << phaseName(p) << ": " << cycles[p] << " cycles";
+            if (total > 0) str << " (" << 100. * double(cycles[p]) / double(total) << "%)";
+            if (fits > 0) str << ", " << double(cycles[p]) / double(fits) << " per fit";
+            str << "\n";
+            writeBins(str, cycleHistograms[p]);
+        }
+        str << "neighbors per fit:\n";
+        writeBins(str, neighborHistogram);
+        return str.str();
+    }
+
+    /*! \brief Histograms in CSV: one row per bin, with its lower bound, the fits per phase and per neighbor count */
+    inline std::string to_csv() const
+    {
+        std::stringstream str;
+        str << "lower_bound";
+        for (int p = 0; p < FIT_PHASE_COUNT; ++p) str << "," << phaseName(p);
+        str << ",neighbors\n";
+        for (int b = 0; b < BinCount; ++b)
+        {
+            str << lowerBound(b);
+            for (int p = 0; p < FIT_PHASE_COUNT; ++p) str << "," << cycleHistograms[p][b];
+            str << "," << neighborHistogram[b] << "\n";
+        }
+        return str.str();
+    }
+
+private:
+    static inline std::uint64_t lowerBound(int b) { return b == 0 ? 0 : std::uint64_t(1) << (b - 1); }
+
+    static inline void writeBins(std::stringstream& str, const Histogram& histogram)
+    {
+        for (int b = 0; b < BinCount; ++b)
+        {
+            if (histogram[b] == 0) continue;
+            if (b == 0) str << "  0: ";
+            else str << "  [" << lowerBound(b) << "," << (b == 64 ? "inf" : std::to_string(lowerBound(b + 1))) << "): ";
+            str << histogram[b] << "\n";
+        }
+    }
+};
+
+/*!
+    \brief Profiling of the fits: cycles spent in each #FIT_PHASE, and number of neighbors
+    \inherit Concept::FittingExtensionConcept
+
+    Records, for each fit, the cycles of init(), of the addNeighbor() calls, of the finalize() calls, and the cycles
+    elapsed between these calls, spent by the caller to traverse the neighbors (e.g. the KdTree query). The
+    profile of the last fit is given by profile(), and the profiles of many fits are gathered in a
+    FitProfileHistogram:
+    \code
+    typedef Basket<Point, WeightFunc, OrientedSphereFit, GLSParam, FitProfiling> Fit;
+    FitProfileHistogram histogram;
+    for (int i = 0; i < n; ++i)
+    {
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(scale));
+        fit.init(points[i].pos());
+        for (int j : tree.range_neighbors(i, scale))
+            fit.addNeighbor(points[j]);
+        fit.finalize();
+        histogram.add(fit.profile());
+    }
+    std::cout << histogram.to_string();
+    \endcode
+
+    The cycles are read from the time stamp counter of the CPU (`rdtsc` on x86, `cntvct_el0` on ARM64), or are
+    nanoseconds on other architectures. Reading the counter costs a few dozen cycles per neighbor, which are
+    counted in the accumulation: compare the phases of a fit between themselves rather than with an unprofiled
+    fit. Baskets without this extension are unchanged.
+
+    \warning Must be the last extension of the Basket, to time the lower levels of the Basket. The neighbors are
+    added one by one, the block addNeighbors of the lower levels being bypassed. Available on CPU only.
+
+    \ingroup fitting
+*/
+template < class DataPoint, class _WFunctor, typename T>
+class FitProfiling : public T
+{
+private:
+    typedef T Base;
+
+public:
+    typedef typename Base::Scalar     Scalar;     /*!< \brief Inherited scalar type*/
+    typedef typename Base::VectorType VectorType; /*!< \brief Inherited vector type*/
+    typedef typename Base::WFunctor   WFunctor;   /*!< \brief Weight Function*/
+
+protected:
+    FitPhaseProfile m_profile;   /*!< \brief Profile of the current fit */
+    std::uint64_t m_last {0};    /*!< \brief Counter at the end of the last call to the fit */
+
+public:
+    /*! \brief Default constructor */
+    inline FitProfiling() : Base() {}
+
+    /**************************************************************************/
+    /* Initialization                                                         */
+    /**************************************************************************/
+    /*! \copydoc Concept::FittingProcedureConcept::init() */
+    inline void init(const VectorType& _evalPos);
+
+    /**************************************************************************/
+    /* Processing                                                             */
+    /**************************************************************************/
+    /*! \copydoc Concept::FittingProcedureConcept::addNeighbor() */
+    inline bool addNeighbor(const DataPoint &_nei);
+
+    /*! \copydoc Concept::FittingProcedureConcept::finalize() */
+    inline FIT_RESULT finalize();
+
+    /**************************************************************************/
+    /* Results                                                                */
+    /**************************************************************************/
+    /*! \brief Profile of the current fit, since the last call to init() */
+    inline const FitPhaseProfile& profile() const { return m_profile; }
+};
+
+#include "profiling.hpp"
+
+} //namespace Ponca
@@ -0,0 +1,44 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+template < class DataPoint, class _WFunctor, typename T>
+void
+FitProfiling<DataPoint, _WFunctor, T>::init(const VectorType& _evalPos)
+{
+    const std::uint64_t start = internal::readCycleCounter();
+    m_profile = FitPhaseProfile();
+    Base::init(_evalPos);
+    m_last = internal::readCycleCounter();
+    m_profile.cycles[FIT_PHASE_INIT] += m_last - start;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+bool
+FitProfiling<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
+{
+    const std::uint64_t start = internal::readCycleCounter();
+    m_profile.cycles[FIT_PHASE_TRAVERSAL] += start - m_last;
+    const bool accepted = Base::addNeighbor(_nei);
+    m_last = internal::readCycleCounter();
+    m_profile.cycles[FIT_PHASE_ACCUMULATION] += m_last - start;
+    ++m_profile.neighbors;
+    m_profile.accepted += accepted ? 1 : 0;
+    return accepted;
+}
+
+template < class DataPoint, class _WFunctor, typename T>
+FIT_RESULT
+FitProfiling<DataPoint, _WFunctor, T>::finalize()
+{
+    const std::uint64_t start = internal::readCycleCounter();
+    m_profile.cycles[FIT_PHASE_TRAVERSAL] += start - m_last;
+    const FIT_RESULT res = Base::finalize();
+    m_last = internal::readCycleCounter();
+    m_profile.cycles[FIT_PHASE_FINALIZE] += m_last - start;
+    ++m_profile.passes;
+    return res;
+}
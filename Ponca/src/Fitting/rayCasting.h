@@ -0,0 +1,172 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./enums.h"
+
+#include PONCA_MULTIARCH_INCLUDE_STD(cmath)
+
+#include <Eigen/Core>
+
+namespace Ponca
+{
+
+/*!
+    \brief Parameters of sphereTrace, the distances being relative to the scale of the surface
+    \ingroup fitting
+*/
+template <typename Scalar>
+struct SphereTraceParams
+{
+    Scalar epsilon {Scalar(1e-3)}; /*!< \brief Distance to the surface under which a ray hits it */
+    Scalar maxStep {Scalar(0.5)};  /*!< \brief Largest step, the fits being valid around their neighborhood */
+    int    maxSteps {256};         /*!< \brief Largest number of steps along a ray */
+};
+
+/*!
+    \brief Intersection of a ray with a surface, computed by sphereTrace
+    \ingroup fitting
+*/
+template <typename Scalar, typename VectorType>
+struct RayHit
+{
+    Scalar t {Scalar(0)};                 /*!< \brief Parameter of the intersection along the ray */
+    VectorType normal {VectorType::Zero()}; /*!< \brief Unit normal of the surface at the intersection */
+    int steps {0};                        /*!< \brief Number of steps, i.e. evaluations of the distance */
+};
+
+/*!
+    \brief Signed distance to the MLS surface fitted over the points of a tree, estimated by a fit at each position
+
+    The neighborhood of radius `scale` of a position \f$ \mathbf{x} \f$ is fitted by `Fit`, initialized at
+    \f$ \mathbf{x} \f$, and the distance is the distance from \f$ \mathbf{x} \f$ to the fitted AlgebraicSphere
+    along its gradient, signed by its potential: the sphere approximates the surface around \f$ \mathbf{x} \f$, the
+    distance is a bound for the steps of sphereTrace. Beyond the neighborhoods of the points, where the surface is
+    not defined, the distance is the one to the third nearest point minus `scale`, skipping the empty space: the fits
+    are #UNDEFINED with less than 3 neighbors.
+
+    The functor is copied to the CUDA kernels, see raycastKernel.
+
+    \tparam Fit Fitting procedure of an AlgebraicSphere oriented by the normals, e.g. a Basket of OrientedSphereFit,
+    whose weight function is constructible from `scale`: the sign of the distance must not flip from one fit to the
+    next
+    \tparam TreeView Spatial structure providing `points`, `range_neighbors(point, radius, f)` and
+    `k_nearest_neighbors<K>(point, neighbors, squaredDistances)`, e.g. KdTreeDeviceView
+    \ingroup fitting
+*/
+template <typename Fit, typename TreeView>
+struct MlsSurfaceDistance
+{
+    typedef typename Fit::Scalar     Scalar;     /*!< \brief Scalar type of the fit */
+    typedef typename Fit::VectorType VectorType; /*!< \brief Vector type of the fit */
+    typedef typename Fit::WFunctor   WeightFunc; /*!< \brief Weight function of the fit */
+
+    TreeView tree; /*!< \brief Points of the surface, resident on the device running the functor */
+    Scalar scale;  /*!< \brief Scale of the fits */
+
+    /*! \brief Scale of the fits, the unit of the parameters of sphereTrace */
+    PONCA_MULTIARCH inline Scalar getScale() const { return scale; }
+
+    /*!
+        \brief Signed distance from `_x` to the surface in `_distance`, and unit normal of the surface in `_normal`
+
+        \return the state of the fit, `_normal` being written only when it is not #UNDEFINED
+    */
+    PONCA_MULTIARCH inline FIT_RESULT operator()(const VectorType& _x, Scalar& _distance, VectorType& _normal) const
+    {
+        PONCA_MULTIARCH_STD_MATH(sqrt);
+
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(scale));
+        fit.init(_x);
+        FIT_RESULT res;
+        do
+        {
+            tree.range_neighbors(_x, scale, [&](int _j, Scalar) { fit.addNeighbor(tree.points[_j]); });
+            res = fit.finalize();
+        } while (res == NEED_OTHER_PASS);
+
+        if (res == UNDEFINED)
+        {
+            // no surface closer than the third nearest point minus the scale
+            typename TreeView::IndexType neighbors[3];
+            Scalar d2[3];
+            _distance = tree.template k_nearest_neighbors<3>(_x, neighbors, d2) < 3 ? Eigen::NumTraits<Scalar>::highest()
+                                                                                 : sqrt(d2[2]) - scale;
+            return res;
+        }
+
+        const VectorType delta = fit.project(_x) - _x;
+        _distance = fit.potential(_x) < Scalar(0) ? -delta.norm() : delta.norm();
+        _normal = fit.primitiveGradient(_x).normalized();
+        return res;
+    }
+};
+
+/*!
+    \brief Intersection of the ray \f$ \mathbf{o} + t \mathbf{d} \f$, \f$ t \in [t_{min}, t_{max}] \f$, with the
+    zero level set of a signed distance, by sphere tracing
+
+    At each step, the ray advances by the distance to the surface at its current position, as long as the distance
+    is larger than `epsilon * scale`, with steps of at most `maxStep * scale`. The distance being estimated by a fit
+    at each position, e.g. by MlsSurfaceDistance, the surface may move from one step to the next: when the sign of
+    the distance changes, the intersection is interpolated between the last two positions.
+
+    \param _distance Functor providing `getScale()` and `operator()(x, distance, normal)`, see MlsSurfaceDistance
+    \param _origin Origin \f$ \mathbf{o} \f$ of the ray
+    \param _direction Unit direction \f$ \mathbf{d} \f$ of the ray
+    \param _hit Receives the intersection, its normal being the one of the last fit
+    \return true when the ray hits the surface, `_hit.steps` being written in any case
+    \ingroup fitting
+*/
+template <typename DistanceFunctor, typename Scalar, typename VectorType>
+PONCA_MULTIARCH inline bool sphereTrace(const DistanceFunctor& _distance, const VectorType& _origin,
+                                        const VectorType& _direction, Scalar _tMin, Scalar _tMax,
+                                        const SphereTraceParams<Scalar>& _params, RayHit<Scalar, VectorType>& _hit)
+{
+    PONCA_MULTIARCH_STD_MATH(abs);
+
+    const Scalar scale = _distance.getScale();
+    const Scalar epsilon = _params.epsilon * scale, maxStep = _params.maxStep * scale;
+
+    Scalar t = _tMin, previousT = _tMin, previousD = Scalar(0);
+    bool previous = false;
+    VectorType normal = VectorType::Zero();
+    for (_hit.steps = 0; _hit.steps < _params.maxSteps && t <= _tMax; )
+    {
+        Scalar d;
+        ++_hit.steps;
+        const FIT_RESULT res = _distance(_origin + t * _direction, d, normal);
+        if (res == UNDEFINED)
+        {
+            previous = false;
+            t += d > epsilon ? d : epsilon;
+            continue;
+        }
+        if (abs(d) <= epsilon)
+        {
+            _hit.t = t;
+            _hit.normal = normal;
+            return true;
+        }
+        if (previous && (d < Scalar(0)) != (previousD < Scalar(0)))
+        {
+            // the fits moved across the ray: linear interpolation of the distance
+            _hit.t = previousT + (t - previousT) * previousD / (previousD - d);
+            _hit.normal = normal;
+            return _hit.t <= _tMax;
+        }
+        previous = true;
+        previousT = t;
+        previousD = d;
+        t += abs(d) < maxStep ? abs(d) : maxStep;
+    }
+    return false;
+}
+
+} // namespace Ponca
@@ -0,0 +1,68 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./rayCasting.h"
+
+#include <cuda_runtime.h>
+
+namespace Ponca
+{
+
+/*!
+    \brief Intersect the `_count` rays of `_origins` and `_directions` with the surface `_distance`, in `_hits`
+
+    One thread per ray, see sphereTrace. The buffers are stored on the device, as the points of the tree of the
+    functor, e.g. a MlsSurfaceDistance over the KdTreeDeviceView of KdTreeDeviceBuffers. The rays missing the
+    surface get a null normal.
+    \see launchRaycast
+    \ingroup fitting
+*/
+template <typename DistanceFunctor, typename Scalar, typename VectorType>
+__global__ void raycastKernel(DistanceFunctor _distance, const VectorType* _origins, const VectorType* _directions,
+                              int _count, Scalar _tMin, Scalar _tMax, SphereTraceParams<Scalar> _params,
+                              RayHit<Scalar, VectorType>* _hits)
+{
+    const int i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i >= _count)
+        return;
+
+    RayHit<Scalar, VectorType> hit;
+    if (!sphereTrace(_distance, _origins[i], _directions[i], _tMin, _tMax, _params, hit))
+    {
+        hit.t = _tMax;
+        hit.normal = VectorType::Zero();
+    }
+    _hits[i] = hit;
+}
+
+/*!
+    \brief Enqueue raycastKernel on `_stream`, with blocks of `_blockSize` threads
+
+    \code
+    KdTreeDeviceBuffers<Point> tree;
+    tree.upload(kdtree);
+    MlsSurfaceDistance<Fit, KdTreeDeviceView<Point> > surface {tree.view, scale};
+    launchRaycast(stream, 128, surface, origins, directions, width * height, Scalar(0), tMax,
+                  SphereTraceParams<Scalar>(), hits);
+    \endcode
+    \ingroup fitting
+*/
+template <typename DistanceFunctor, typename Scalar, typename VectorType>
+inline void launchRaycast(cudaStream_t _stream, int _blockSize, const DistanceFunctor& _distance,
+                          const VectorType* _origins, const VectorType* _directions, int _count,
+                          Scalar _tMin, Scalar _tMax, const SphereTraceParams<Scalar>& _params,
+                          RayHit<Scalar, VectorType>* _hits)
+{
+    if (_count == 0)
+        return;
+    const int grid = (_count + _blockSize - 1) / _blockSize;
+    raycastKernel<<<grid, _blockSize, 0, _stream>>>(_distance, _origins, _directions, _count, _tMin, _tMax,
+                                                    _params, _hits);
+}
+
+} // namespace Ponca
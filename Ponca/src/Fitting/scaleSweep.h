@@ -0,0 +1,309 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+#include "basket.h"
+#include "weightFunc.h"
+#include "weightKernel.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Ponca
+{
+
+namespace internal
+{
+    /*!
+        \brief Expansion of a weight kernel used by computeScaleSweep
+
+        `degree` is the degree \f$ n \f$ of the kernel as a polynomial of \f$ y = x^2 \f$ within its support,
+        \f$ w(x) = \sum_{m=0}^{n} c_m y^m \f$, with `coefficient(m)` \f$ = c_m \f$, and is negative when the kernel
+        is not such a polynomial. The degree 0 is a kernel constant within its support.
+        Specialize it for other weight kernels.
+    */
+    template <class WeightKernel>
+    struct ScaleSweepKernelTraits
+    {
+        static constexpr int degree = -1;
+    };
+
+    template <typename Scalar>
+    struct ScaleSweepKernelTraits<ConstantWeightKernel<Scalar> >
+    {
+        static constexpr int degree = 0;
+        static constexpr Scalar coefficient(int) { return Scalar(1); }
+    };
+
+    template <typename Scalar, int Degree>
+    struct ScaleSweepKernelTraits<SmoothWeightKernel<Scalar, Degree> >
+    {
+        static constexpr int degree = Degree;
+        /*! \brief \f$ (-1)^m \binom{n}{m} \f$, from \f$ (1-y)^n \f$ */
+        static constexpr Scalar coefficient(int m)
+        {
+            Scalar c = Scalar(1);
+            for (int i = 0; i < m; ++i)
+                c = -c * Scalar(Degree - i) / Scalar(i + 1);
+            return c;
+        }
+    };
+
+    template <typename Scalar>
+    struct ScaleSweepKernelTraits<EpanechnikovWeightKernel<Scalar> >
+    {
+        static constexpr int degree = 1;
+        static constexpr Scalar coefficient(int m) { return m == 0 ? Scalar(1) : Scalar(-1); }
+    };
+
+    /*!
+        \brief Properties of a weight function used by computeScaleSweep
+
+        `compact` tells if the weights are null beyond the evaluation scale, so that the neighborhood of a scale
+        is a prefix of the neighbors sorted by distance. `degree` and `coefficient` expand the weights within the
+        support over the powers of the squared distances (see ScaleSweepKernelTraits), so that the sums of a scale
+        can be completed by the next shell, as required by computeScaleSweep.
+        Specialize it for other weight functions.
+    */
+    template <class WFunctor>
+    struct ScaleSweepTraits
+    {
+        static constexpr bool compact = false;
+        static constexpr int  degree  = -1;
+    };
+
+    template <class DataPoint, class WeightKernel>
+    struct ScaleSweepTraits<DistWeightFunc<DataPoint, WeightKernel> > : public ScaleSweepKernelTraits<WeightKernel>
+    {
+        static constexpr bool compact = true;
+    };
+
+    /*!
+        \brief Tells if `Fit` combines the sums accumulated with different weights with `addScaledSums`
+
+        True when `addScaledSums` is declared by the same class as `addNeighbor`: the sums of the extensions
+        following the fitting procedure, e.g. the derivatives, would not be combined.
+    */
+    template <class Fit, typename = void>
+    struct HasScaledSums : public std::false_type {};
+
+    template <class Fit>
+    struct HasScaledSums<Fit, std::void_t<decltype(&Fit::addScaledSums)> >
+        : public std::is_same<typename MemberClass<decltype(&Fit::addNeighbor)>::type,
+                              typename MemberClass<decltype(&Fit::addScaledSums)>::type> {};
+
+    /*!
+        \brief Tells if computeScaleSweep accepts `Fit`: any fit with a compact kernel constant within its
+        support, and the fits providing addScaledSums with a compact polynomial kernel
+    */
+    template <class Fit>
+    struct ScaleSweepSupported : public std::integral_constant<bool,
+        ScaleSweepTraits<typename Fit::WFunctor>::compact &&
+        (ScaleSweepTraits<typename Fit::WFunctor>::degree == 0 ||
+         (ScaleSweepTraits<typename Fit::WFunctor>::degree > 0 && HasScaledSums<Fit>::value))> {};
+
+    /*! \brief Neighbors of `[begin, end)` within `maxScale` of `evalPos`, sorted by squared distance */
+    template <typename DataPoint, typename IteratorBegin, typename IteratorEnd>
+    inline std::vector<std::pair<typename DataPoint::Scalar, const DataPoint*> >
+    sortScaleSweepNeighbors(const typename DataPoint::VectorType& evalPos, const IteratorBegin& begin,
+                            const IteratorEnd& end, typename DataPoint::Scalar maxScale)
+    {
+        typedef typename DataPoint::Scalar Scalar;
+        std::vector<std::pair<Scalar, const DataPoint*> > sorted;
+        for (auto it = begin; it != end; ++it)
+        {
+            const Scalar d2 = ((*it).pos() - evalPos).squaredNorm();
+            if (d2 <= maxScale * maxScale)
+                sorted.emplace_back(d2, &(*it));
+        }
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const std::pair<Scalar, const DataPoint*>& a, const std::pair<Scalar, const DataPoint*>& b)
+                  { return a.first < b.first; });
+        return sorted;
+    }
+
+    /*! \brief Run the passes following the first one over the `count` first neighbors of `sorted` */
+    template <typename Fit, typename Neighbors>
+    inline FIT_RESULT finishScaleSweepPasses(Fit& fit, FIT_RESULT res, const Neighbors& sorted, std::size_t count)
+    {
+        while (res == NEED_OTHER_PASS)
+        {
+            for (std::size_t j = 0; j < count; ++j)
+                fit.addNeighbor(*sorted[j].second);
+            res = fit.finalize();
+        }
+        return res;
+    }
+
+    /*!
+        \brief Fit the neighborhood of `evalPos` at each scale of `scales`, each one from scratch over the prefix
+        of the neighbors sorted by distance
+
+        Same interface as computeScaleSweep, for any weight function of compact support: the neighbors are sorted
+        once, but each scale re-weights all its neighbors.
+    */
+    template <typename Fit, typename IteratorBegin, typename IteratorEnd, typename ScaleContainer,
+              typename OutputFunctor>
+    inline void computeScalePrefixes(const typename Fit::DataPoint::VectorType& evalPos,
+                                     const IteratorBegin& begin, const IteratorEnd& end,
+                                     const ScaleContainer& scales, OutputFunctor output)
+    {
+        typedef typename Fit::DataPoint DataPoint;
+        typedef typename DataPoint::Scalar Scalar;
+        typedef typename Fit::WFunctor WFunctor;
+        static_assert(ScaleSweepTraits<WFunctor>::compact,
+                      "computeScalePrefixes requires a weight function with a compact support");
+
+        const int scaleCount = int(scales.size());
+        if (scaleCount == 0)
+            return;
+        const auto sorted = sortScaleSweepNeighbors<DataPoint>(evalPos, begin, end, Scalar(scales[scaleCount - 1]));
+
+        std::size_t count = 0;
+        for (int k = 0; k < scaleCount; ++k)
+        {
+            const Scalar t = scales[k];
+            while (count < sorted.size() && sorted[count].first <= t * t)
+                ++count;
+
+            Fit fit;
+            fit.setWeightFunc(WFunctor(t));
+            fit.init(evalPos);
+            for (std::size_t j = 0; j < count; ++j)
+                fit.addNeighborWithSquaredDistance(*sorted[j].second, sorted[j].first);
+
+            const FIT_RESULT res = finishScaleSweepPasses(fit, fit.finalize(), sorted, count);
+            output(k, fit, res);
+        }
+    }
+} // namespace internal
+
+/*!
+    \brief Fit the neighborhood of `evalPos` at each scale of `scales` at the cost of a single fit, accumulating
+    shells of neighbors sorted by distance once
+
+    The neighbors of `[begin, end)` are sorted by their distance to `evalPos`, and the neighborhoods are
+    accumulated incrementally: the sums of a scale are completed by the shell of neighbors between this scale and
+    the next one, and each scale only copies and finalizes the fit. The sweep then costs a single fit at the
+    largest scale, plus one finalize per scale. The fit of the `k`-th scale is given to `output(k, fit, res)`.
+
+    With the ConstantWeightKernel, the weights of the neighbors within the support do not depend on the scale and
+    the sums are accumulated once, for any fit. With a kernel polynomial in the squared distance \f$ d^2 \f$
+    within its support, e.g. SmoothWeightKernel \f$ (1 - d^2/t^2)^n \f$ or EpanechnikovWeightKernel, the weights
+    are expanded as \f$ \sum_m c_m (T^2/t^2)^m (d^2/T^2)^m \f$ with \f$ T \f$ the largest scale: the sums
+    weighted by each power \f$ (d^2/T^2)^m \f$ are accumulated once, and each scale combines them with its own
+    coefficients. The sweep then costs \f$ n + 1 \f$ fits at the largest scale instead of one per scale. This
+    requires the fitting procedure to provide `addScaledSums`, as OrientedSphereFit, and no extension
+    accumulating its own sums, e.g. Basket<Point, WeightFunc, OrientedSphereFit, GLSParam>. Other kernels and fits
+    are fitted from scratch at each scale by internal::computeScales (see internal::ScaleSweepSupported).
+
+    \code
+    typedef Basket<Point, DistWeightFunc<Point, ConstantWeightKernel<Scalar> >, OrientedSphereFit, GLSParam> Fit;
+    computeScaleSweep<Fit>(p, neighbors.begin(), neighbors.end(), scales,
+        [&](int k, const Fit& fit, FIT_RESULT res) { if(res == STABLE) kappa[k] = fit.kappa_normalized(); });
+    \endcode
+
+    The passes following the first one, e.g. of MongePatch, run over the neighbors of the scale.
+
+    \tparam Fit Fitting procedure, e.g. a Basket, whose weight function is a DistWeightFunc constructible from a
+    scale, with a kernel constant or polynomial in the squared distance within its support (see
+    internal::ScaleSweepTraits)
+    \param scales Random access container of increasing scales
+    \ingroup fitting
+*/
+template <typename Fit, typename IteratorBegin, typename IteratorEnd, typename ScaleContainer, typename OutputFunctor>
+inline void computeScaleSweep(const typename Fit::DataPoint::VectorType& evalPos,
+                              const IteratorBegin& begin, const IteratorEnd& end,
+                              const ScaleContainer& scales, OutputFunctor output)
+{
+    typedef typename Fit::DataPoint DataPoint;
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename Fit::WFunctor WFunctor;
+    typedef internal::ScaleSweepTraits<WFunctor> Traits;
+    static_assert(internal::ScaleSweepSupported<Fit>::value,
+                  "computeScaleSweep requires a compact weight function constant within its support, e.g. "
+                  "DistWeightFunc with ConstantWeightKernel, or polynomial in the squared distance with a fit "
+                  "providing addScaledSums, e.g. OrientedSphereFit with SmoothWeightKernel");
+    constexpr int Degree = Traits::degree > 0 ? Traits::degree : 0;
+
+    const int scaleCount = int(scales.size());
+    if (scaleCount == 0)
+        return;
+
+    // the sums are accumulated with the largest scale: with a constant kernel, its weights are the ones of any
+    // scale within its support, and with a polynomial kernel, moments[m] is weighted by (d^2/T^2)^m
+    const Scalar maxScale  = scales[scaleCount - 1];
+    const Scalar maxScale2 = maxScale * maxScale;
+    const auto sorted = internal::sortScaleSweepNeighbors<DataPoint>(evalPos, begin, end, maxScale);
+    Fit moments[Degree + 1];
+    for (Fit& moment : moments)
+    {
+        moment.setWeightFunc(WFunctor(maxScale));
+        moment.init(evalPos);
+    }
+
+    std::size_t count = 0;
+    for (int k = 0; k < scaleCount; ++k)
+    {
+        const Scalar t = scales[k];
+        for (; count < sorted.size() && sorted[count].first <= t * t; ++count)
+        {
+            const DataPoint& nei = *sorted[count].second;
+            const Scalar d2 = sorted[count].first;
+            if constexpr (Degree == 0)
+                moments[0].addNeighborWithSquaredDistance(nei, d2);
+            else
+            {
+                const Scalar y = d2 / maxScale2;
+                Scalar yPower = Scalar(1);
+                for (int m = 0; m <= Degree; ++m, yPower *= y)
+                    moments[m].addNeighborWithWeight(nei, d2, internal::pointWeighted(nei, yPower));
+            }
+        }
+
+        Fit fit = moments[0];
+        if constexpr (Degree > 0)
+        {
+            const Scalar ratio = maxScale2 / (t * t);
+            Scalar ratioPower = Scalar(1);
+            for (int m = 1; m <= Degree; ++m)
+            {
+                ratioPower *= ratio;
+                fit.addScaledSums(moments[m], Traits::coefficient(m) * ratioPower);
+            }
+        }
+        fit.setWeightFunc(WFunctor(t));
+        const FIT_RESULT res = internal::finishScaleSweepPasses(fit, fit.finalize(), sorted, count);
+        output(k, fit, res);
+    }
+}
+
+namespace internal
+{
+    /*!
+        \brief Fit the scales of `evalPos` with computeScaleSweep when it supports `Fit` (see ScaleSweepSupported),
+        and with computeScalePrefixes otherwise
+    */
+    template <typename Fit, typename IteratorBegin, typename IteratorEnd, typename ScaleContainer,
+              typename OutputFunctor>
+    inline void computeScales(const typename Fit::DataPoint::VectorType& evalPos,
+                              const IteratorBegin& begin, const IteratorEnd& end,
+                              const ScaleContainer& scales, OutputFunctor output)
+    {
+        if constexpr (ScaleSweepSupported<Fit>::value)
+            computeScaleSweep<Fit>(evalPos, begin, end, scales, output);
+        else
+            computeScalePrefixes<Fit>(evalPos, begin, end, scales, output);
+    }
+} // namespace internal
+
+} // namespace Ponca
@@ -0,0 +1,193 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./enums.h"
+#include "./weightFunc.h"
+
+#include <Eigen/Core>
+
+namespace Ponca
+{
+
+/*!
+    \brief Point sampled from a pixel of a screen-space buffer: its position and normal in object space, and its
+    offset in pixels to the evaluation pixel
+
+    The sums of the fits are compensated (see internal::CompensatedSum), which keeps the float fits accurate at
+    large scales without double arithmetic on the GPU.
+
+    \see fitScreenSpacePixel
+    \ingroup fitting
+*/
+template <typename _Scalar>
+class ScreenSpacePoint
+{
+public:
+    enum {Dim = 3};
+    enum {CompensatedSum = 1};
+    typedef _Scalar Scalar;
+    typedef Eigen::Matrix<Scalar, Dim, 1>   VectorType;
+    typedef Eigen::Matrix<Scalar, 2,   1>   ScreenVectorType;
+    typedef Eigen::Matrix<Scalar, Dim, Dim> MatrixType;
+
+    PONCA_MULTIARCH inline ScreenSpacePoint(const VectorType       &_pos    = VectorType::Zero(),
+                                            const VectorType       &_normal = VectorType::Zero(),
+                                            const ScreenVectorType &_spos   = ScreenVectorType::Zero())
+        : m_pos(_pos), m_normal(_normal), m_spos(_spos) {}
+
+    PONCA_MULTIARCH inline const VectorType& pos()        const { return m_pos; }
+    PONCA_MULTIARCH inline const VectorType& normal()     const { return m_normal; }
+    PONCA_MULTIARCH inline const ScreenVectorType& spos() const { return m_spos; }
+
+    PONCA_MULTIARCH inline VectorType& pos()        { return m_pos; }
+    PONCA_MULTIARCH inline VectorType& normal()     { return m_normal; }
+    PONCA_MULTIARCH inline ScreenVectorType& spos() { return m_spos; }
+
+private:
+    VectorType m_pos, m_normal;
+    ScreenVectorType m_spos;
+};
+
+/*!
+    \brief Weighting function of the screen-space neighborhoods: the kernel is applied to the distance in pixels,
+    and the neighbors whose depth differs from the evaluation position by more than a threshold are rejected
+
+    \inherit Concept::WeightFuncConcept
+    \tparam DataPoint Point providing `spos()`, its offset in pixels, as ScreenSpacePoint
+    \ingroup fitting
+*/
+template <class DataPoint, class WeightKernel>
+class ProjectedWeightFunc : public DistWeightFunc<DataPoint, WeightKernel>
+{
+private:
+    typedef DistWeightFunc<DataPoint, WeightKernel> Base;
+
+public:
+    typedef typename DataPoint::Scalar Scalar;         /*!< \brief Scalar type from DataPoint */
+    typedef typename DataPoint::VectorType VectorType; /*!< \brief Vector type from DataPoint */
+
+    /*!
+        \brief Weight of the neighborhood of radius `_t` pixels, rejecting the depth differences above `_dz`
+        (none when null)
+    */
+    PONCA_MULTIARCH inline ProjectedWeightFunc(const Scalar& _t = Scalar(1.), const Scalar& _dz = Scalar(0.))
+        : Base(_t), m_dz(_dz) {}
+
+    /*! \brief Weight of the distance in pixels, null beyond the scale or the depth threshold */
+    PONCA_MULTIARCH inline Scalar w(const VectorType& _relativePos, const DataPoint& _attributes) const
+    {
+        PONCA_MULTIARCH_STD_MATH(abs);
+        const Scalar d  = _attributes.spos().norm();
+        const Scalar dz = abs(_relativePos[2]);
+        if (d > Base::m_t || (m_dz != Scalar(0) && dz > m_dz))
+            return Scalar(0.);
+        return internal::pointWeighted(_attributes, Base::m_wk.f(d / Base::m_t));
+    }
+
+private:
+    Scalar m_dz; /*!< \brief Depth threshold, none when null */
+};
+
+/*!
+    \brief Positions and normals of a rectangle of pixels of an image, stored row by row with 3 scalars per pixel
+
+    The whole image, or a copy of the part of the image read by some fits, e.g. in the shared memory of a CUDA block
+    (see screenSpaceFitTiledKernel).
+
+    \tparam Storage Scalar type of the buffers, converted to the scalar type of the fits when the pixels are read.
+    `Eigen::half` or `Eigen::bfloat16` halve the memory traffic of float fits, which still accumulate in float.
+    \ingroup fitting
+*/
+template <typename Storage>
+struct ScreenSpaceTile
+{
+    const Storage* positions; /*!< \brief Positions of the pixels */
+    const Storage* normals;   /*!< \brief Normals of the pixels, null for the undefined pixels */
+    int x;                    /*!< \brief Column of the first pixel in the image */
+    int y;                    /*!< \brief Row of the first pixel in the image */
+    int stride;               /*!< \brief Number of pixels per row */
+
+    /*! \brief Offset in the buffers of the pixel (`_x`, `_y`) of the image */
+    PONCA_MULTIARCH inline int index(int _x, int _y) const { return 3 * ((_x - x) + (_y - y) * stride); }
+};
+
+/*!
+    \brief Fit the screen-space neighborhood of radius `_radius` pixels of the pixel (`_x`, `_y`), read from `_tile`
+
+    The tile must contain the pixel and its neighborhood, clipped to the image of size `_width` by `_height`. The
+    pixels with a null normal are undefined, and are neither fitted nor used as neighbors. The normals are normalized
+    before being added. The weight function of `_fit` is constructed from the radius and `_maxDepthDiff`, as
+    ProjectedWeightFunc.
+
+    Compiled for the host and the device: ScreenSpaceFitter calls it from a CUDA kernel, and CPU code can call it
+    on the same buffers.
+
+    \return #UNDEFINED for an undefined pixel, the state of the fit otherwise
+    \ingroup fitting
+*/
+template <typename Fit, typename Storage>
+PONCA_MULTIARCH inline FIT_RESULT fitScreenSpacePixel(Fit& _fit, int _x, int _y, int _width, int _height,
+                                                      int _radius, typename Fit::Scalar _maxDepthDiff,
+                                                      const ScreenSpaceTile<Storage>& _tile)
+{
+    typedef typename Fit::DataPoint DataPoint;
+    typedef typename Fit::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename DataPoint::ScreenVectorType ScreenVectorType;
+    typedef Eigen::Map<const Eigen::Matrix<Storage, DataPoint::Dim, 1> > PixelMap;
+
+    const int id = _tile.index(_x, _y);
+    if (PixelMap(_tile.normals + id).template cast<Scalar>().squaredNorm() == Scalar(0))
+        return UNDEFINED;
+
+    _fit.setWeightFunc(typename Fit::WFunctor(Scalar(_radius), _maxDepthDiff));
+    _fit.init(PixelMap(_tile.positions + id).template cast<Scalar>());
+
+    const int radius2 = _radius * _radius;
+    for (int dy = -_radius; dy <= _radius; ++dy)
+    {
+        const int ny = _y + dy;
+        if (ny < 0 || ny >= _height)
+            continue;
+        for (int dx = -_radius; dx <= _radius; ++dx)
+        {
+            const int nx = _x + dx;
+            // circular neighborhood, within the image
+            if (dx * dx + dy * dy >= radius2 || nx < 0 || nx >= _width)
+                continue;
+
+            const int nid = _tile.index(nx, ny);
+            const VectorType n = PixelMap(_tile.normals + nid).template cast<Scalar>();
+            if (n.squaredNorm() == Scalar(0))
+                continue;
+
+            _fit.addNeighbor(DataPoint(PixelMap(_tile.positions + nid).template cast<Scalar>(), n.normalized(),
+                                       ScreenVectorType(Scalar(dx), Scalar(dy))));
+        }
+    }
+    return _fit.finalize();
+}
+
+/*!
+    \brief Fit the screen-space neighborhood of radius `_radius` pixels of the pixel (`_x`, `_y`) of an image
+
+    `_positions` and `_normals` store 3 scalars per pixel, row by row.
+    \see fitScreenSpacePixel(Fit&, int, int, int, int, int, typename Fit::Scalar, const ScreenSpaceTile<Storage>&)
+    \ingroup fitting
+*/
+template <typename Fit, typename Storage>
+PONCA_MULTIARCH inline FIT_RESULT fitScreenSpacePixel(Fit& _fit, int _x, int _y, int _width, int _height,
+                                                      int _radius, typename Fit::Scalar _maxDepthDiff,
+                                                      const Storage* _positions, const Storage* _normals)
+{
+    const ScreenSpaceTile<Storage> image {_positions, _normals, 0, 0, _width};
+    return fitScreenSpacePixel(_fit, _x, _y, _width, _height, _radius, _maxDepthDiff, image);
+}
+
+} // namespace Ponca
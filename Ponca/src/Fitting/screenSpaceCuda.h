@@ -0,0 +1,293 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./screenSpace.h"
+#include "../Common/Tracing.h"
+
+#include <cstddef>
+#include <cuda_runtime.h>
+
+namespace Ponca
+{
+
+/*!
+    \brief Fit the screen-space neighborhood of each pixel of the rows [`_firstRow`, `_firstRow + _rowCount`) of an
+    image of size `_width` by `_height`, and write `_output(fit, state)` in `_result`
+
+    One thread per pixel. `_image` holds the rows of the image read by the fits, i.e. the fitted rows and `_radius`
+    rows around them clipped to the image, see fitScreenSpacePixel. `_result` stores one value per fitted pixel,
+    from the first pixel of `_firstRow`.
+    \tparam Output Functor evaluated on the device, e.g. returning the curvature of a Basket with GLSParam
+    \tparam Storage Scalar type of the positions and normals, see ScreenSpaceTile
+    \see ScreenSpaceFitter, launchScreenSpaceFit
+    \ingroup fitting
+*/
+template <typename Fit, typename Output, typename Storage>
+__global__ void screenSpaceFitKernel(int _width, int _height, int _firstRow, int _rowCount, int _radius,
+                                     typename Fit::Scalar _maxDepthDiff, ScreenSpaceTile<Storage> _image,
+                                     Output _output, typename Fit::Scalar* _result)
+{
+    const int x = blockIdx.x * blockDim.x + threadIdx.x;
+    const int row = blockIdx.y * blockDim.y + threadIdx.y;
+    if (x >= _width || row >= _rowCount)
+        return;
+
+    Fit fit;
+    const FIT_RESULT res = fitScreenSpacePixel(fit, x, _firstRow + row, _width, _height, _radius, _maxDepthDiff,
+                                               _image);
+    _result[x + row * _width] = _output(fit, res);
+}
+
+/*!
+    \brief Fit the screen-space neighborhood of each pixel as screenSpaceFitKernel, reading the pixels from a tile of
+    the image copied in shared memory
+
+    The threads of a block load once the pixels of the block and its apron of `_radius` pixels, instead of reading
+    their overlapping neighborhoods from global memory. The kernel is launched with
+    `screenSpaceTileSharedMemory<Storage>(blockDim.x, _radius)` bytes of dynamic shared memory, and square blocks.
+    The tile keeps the scalar type of the image, so that half precision images also halve the shared memory.
+    \ingroup fitting
+*/
+template <typename Fit, typename Output, typename Storage>
+__global__ void screenSpaceFitTiledKernel(int _width, int _height, int _firstRow, int _rowCount, int _radius,
+                                          typename Fit::Scalar _maxDepthDiff, ScreenSpaceTile<Storage> _image,
+                                          Output _output, typename Fit::Scalar* _result)
+{
+    // the shared memory is declared untyped, as its type differs between the instantiations
+    extern __shared__ __align__(16) unsigned char sharedMemory[];
+    const int side  = blockDim.x + 2 * _radius;
+    const int count = side * side;
+    Storage* positions = reinterpret_cast<Storage*>(sharedMemory);
+    Storage* normals   = positions + 3 * count;
+
+    const ScreenSpaceTile<Storage> tile {positions, normals, int(blockIdx.x * blockDim.x) - _radius,
+                                         _firstRow + int(blockIdx.y * blockDim.y) - _radius, side};
+
+    // load the tile, the pixels out of the rows held by `_image` being undefined
+    const int firstRow = max(_firstRow - _radius, 0);
+    const int lastRow  = min(_firstRow + _rowCount + _radius, _height);
+    for (int i = threadIdx.x + threadIdx.y * blockDim.x; i < count; i += blockDim.x * blockDim.y)
+    {
+        const int x = tile.x + i % side;
+        const int y = tile.y + i / side;
+        const bool inside = x >= 0 && x < _width && y >= firstRow && y < lastRow;
+        const int id = inside ? _image.index(x, y) : 0;
+        for (int c = 0; c != 3; ++c)
+        {
+            positions[3 * i + c] = inside ? _image.positions[id + c] : Storage(0);
+            normals[3 * i + c]   = inside ? _image.normals[id + c]   : Storage(0);
+        }
+    }
+    __syncthreads();
+
+    const int x = blockIdx.x * blockDim.x + threadIdx.x;
+    const int row = blockIdx.y * blockDim.y + threadIdx.y;
+    if (x >= _width || row >= _rowCount)
+        return;
+
+    Fit fit;
+    const FIT_RESULT res = fitScreenSpacePixel(fit, x, _firstRow + row, _width, _height, _radius, _maxDepthDiff, tile);
+    _result[x + row * _width] = _output(fit, res);
+}
+
+/*!
+    \brief Bytes of shared memory of the tile of screenSpaceFitTiledKernel, for blocks of `_blockSize` squared threads
+    and images of scalar type `Storage`
+*/
+template <typename Storage>
+inline std::size_t screenSpaceTileSharedMemory(int _blockSize, int _radius)
+{
+    const std::size_t side = std::size_t(_blockSize + 2 * _radius);
+    return 6 * side * side * sizeof(Storage);
+}
+
+/*!
+    \brief Enqueue on `_stream` the fits of the rows [`_firstRow`, `_firstRow + _rowCount`) of an image, with
+    screenSpaceFitTiledKernel when `_tiled` is true and screenSpaceFitKernel otherwise
+
+    Blocks of `_blockSize` squared threads.
+    \ingroup fitting
+*/
+template <typename Fit, typename Output, typename Storage>
+inline void launchScreenSpaceFit(cudaStream_t _stream, bool _tiled, int _blockSize,
+                                 int _width, int _height, int _firstRow, int _rowCount, int _radius,
+                                 typename Fit::Scalar _maxDepthDiff, const ScreenSpaceTile<Storage>& _image,
+                                 Output _output, typename Fit::Scalar* _result)
+{
+    const dim3 block(_blockSize, _blockSize, 1);
+    const dim3 grid((_width + _blockSize - 1) / _blockSize, (_rowCount + _blockSize - 1) / _blockSize, 1);
+    if (_tiled)
+        screenSpaceFitTiledKernel<Fit><<<grid, block, screenSpaceTileSharedMemory<Storage>(_blockSize, _radius),
+                                         _stream>>>(_width, _height, _firstRow, _rowCount, _radius, _maxDepthDiff,
+                                                    _image, _output, _result);
+    else
+        screenSpaceFitKernel<Fit><<<grid, block, 0, _stream>>>(_width, _height, _firstRow, _rowCount, _radius,
+                                                               _maxDepthDiff, _image, _output, _result);
+}
+
+/*!
+    \brief Screen-space fits of images on the GPU, reusing their buffers from one image to the next
+
+    The fitter owns a CUDA stream, the device buffers and pinned host buffers of the positions, normals and results.
+    They are reallocated only when an image is larger than the previous ones, so that the images of a real-time
+    pipeline are processed without allocation. #launch enqueues the uploads, the kernel and the download on the
+    stream and returns immediately: the host prepares the next image, or the caller synchronizes before reading
+    the results. Two fitters process consecutive images concurrently.
+
+    The fits read the image from shared memory (see screenSpaceFitTiledKernel) when the tile of a block fits in the
+    shared memory of the device, and from global memory otherwise, or when the tiling is disabled by #setTiling.
+
+    \code
+    ScreenSpaceFitter<Fit> fitter;
+    fitter.resize(width, height);
+    // for each frame:
+    fill(fitter.positions(), fitter.normals());
+    fitter.launch(radius, maxDepthDiff, Curvature());
+    fitter.synchronize();
+    use(fitter.results());
+    \endcode
+
+    The errors are reported by the CUDA status codes.
+
+    \tparam Fit Basket whose data points and weight function are ScreenSpacePoint and ProjectedWeightFunc, or
+    provide the same interface
+    \tparam Storage Scalar type of the positions and normals, e.g. `Eigen::half` to halve the uploads and the reads
+    of the kernels of float fits, see ScreenSpaceTile
+    \ingroup fitting
+*/
+template <typename Fit, typename Storage = typename Fit::Scalar>
+class ScreenSpaceFitter
+{
+public:
+    typedef typename Fit::Scalar Scalar; /*!< \brief Scalar type of the fits and the results */
+
+    /*! \brief Number of threads of the blocks along each dimension of the image */
+    enum {BlockSize = 16};
+
+    inline ScreenSpaceFitter()
+    {
+        cudaStreamCreate(&m_stream);
+        int device = 0, sharedMemory = 0;
+        cudaGetDevice(&device);
+        cudaDeviceGetAttribute(&sharedMemory, cudaDevAttrMaxSharedMemoryPerBlock, device);
+        m_maxSharedMemory = std::size_t(sharedMemory);
+    }
+    inline ~ScreenSpaceFitter() { release(); cudaStreamDestroy(m_stream); }
+
+    ScreenSpaceFitter(const ScreenSpaceFitter&) = delete;
+    ScreenSpaceFitter& operator=(const ScreenSpaceFitter&) = delete;
+
+    /*!
+        \brief Set the size of the next images, allocating the buffers when they are larger than the previous ones
+
+        Waits for the pending launch.
+    */
+    inline cudaError_t resize(int _width, int _height)
+    {
+        const std::size_t size = std::size_t(_width) * std::size_t(_height);
+        if (size > m_capacity)
+        {
+            release();
+            cudaError_t err;
+            if ((err = cudaMallocHost(&m_hostPositions, 3 * size * sizeof(Storage))) != cudaSuccess ||
+                (err = cudaMallocHost(&m_hostNormals,   3 * size * sizeof(Storage))) != cudaSuccess ||
+                (err = cudaMallocHost(&m_hostResults,       size * sizeof(Scalar))) != cudaSuccess ||
+                (err = cudaMalloc(&m_devicePositions, 3 * size * sizeof(Storage))) != cudaSuccess ||
+                (err = cudaMalloc(&m_deviceNormals,   3 * size * sizeof(Storage))) != cudaSuccess ||
+                (err = cudaMalloc(&m_deviceResults,       size * sizeof(Scalar))) != cudaSuccess)
+            {
+                release();
+                return err;
+            }
+            m_capacity = size;
+        }
+        m_width  = _width;
+        m_height = _height;
+        return cudaSuccess;
+    }
+
+    /*! \brief Pinned host buffer of the positions, filled by the caller before #launch */
+    inline Storage* positions() { return m_hostPositions; }
+    /*! \brief Pinned host buffer of the normals, filled by the caller before #launch */
+    inline Storage* normals() { return m_hostNormals; }
+    /*! \brief Pinned host buffer of the results, valid after #synchronize */
+    inline const Scalar* results() const { return m_hostResults; }
+
+    /*! \brief Stream of the launches, to order other work with them */
+    inline cudaStream_t stream() const { return m_stream; }
+
+    /*! \brief Enable the fits from shared memory tiles when they fit in the shared memory (default: true) */
+    inline void setTiling(bool _tiling) { m_tiling = _tiling; }
+
+    /*! \brief Tells if the launches with the radius `_radius` read the images from shared memory tiles */
+    inline bool isTiled(int _radius) const
+    {
+        return m_tiling && screenSpaceTileSharedMemory<Storage>(BlockSize, _radius) <= m_maxSharedMemory;
+    }
+
+    /*! \brief Width of the images */
+    inline int width() const { return m_width; }
+    /*! \brief Height of the images */
+    inline int height() const { return m_height; }
+
+    /*!
+        \brief Enqueue the fits of the neighborhoods of radius `_radius` pixels of the image, writing `_output` of
+        each fit in the results (see screenSpaceFitKernel and screenSpaceFitTiledKernel)
+
+        Uploads the positions and normals, runs the kernel and downloads the results asynchronously on the stream.
+    */
+    template <typename Output>
+    inline cudaError_t launch(int _radius, Scalar _maxDepthDiff, Output _output)
+    {
+        PONCA_TRACE_ZONE("ponca::ScreenSpaceFitter::launch");
+        const std::size_t size = std::size_t(m_width) * std::size_t(m_height);
+        cudaMemcpyAsync(m_devicePositions, m_hostPositions, 3 * size * sizeof(Storage), cudaMemcpyHostToDevice, m_stream);
+        cudaMemcpyAsync(m_deviceNormals,   m_hostNormals,   3 * size * sizeof(Storage), cudaMemcpyHostToDevice, m_stream);
+
+        const ScreenSpaceTile<Storage> image {m_devicePositions, m_deviceNormals, 0, 0, m_width};
+        launchScreenSpaceFit<Fit>(m_stream, isTiled(_radius), BlockSize, m_width, m_height, 0, m_height, _radius,
+                                  _maxDepthDiff, image, _output, m_deviceResults);
+
+        cudaMemcpyAsync(m_hostResults, m_deviceResults, size * sizeof(Scalar), cudaMemcpyDeviceToHost, m_stream);
+        return cudaGetLastError();
+    }
+
+    /*! \brief Wait for the last launch, after which the results can be read */
+    inline cudaError_t synchronize() { return cudaStreamSynchronize(m_stream); }
+
+private:
+    inline void release()
+    {
+        cudaStreamSynchronize(m_stream);
+        cudaFreeHost(m_hostPositions);
+        cudaFreeHost(m_hostNormals);
+        cudaFreeHost(m_hostResults);
+        cudaFree(m_devicePositions);
+        cudaFree(m_deviceNormals);
+        cudaFree(m_deviceResults);
+        m_hostPositions = m_hostNormals = m_devicePositions = m_deviceNormals = nullptr;
+        m_hostResults = m_deviceResults = nullptr;
+        m_capacity = 0;
+    }
+
+    cudaStream_t m_stream;            /*!< \brief Stream of the launches */
+    int m_width {0};                  /*!< \brief Width of the images */
+    int m_height {0};                 /*!< \brief Height of the images */
+    std::size_t m_capacity {0};       /*!< \brief Number of pixels of the buffers */
+    std::size_t m_maxSharedMemory {0}; /*!< \brief Shared memory per block of the device, in bytes */
+    bool m_tiling {true};             /*!< \brief Tells if the fits may read shared memory tiles */
+
+    Storage* m_hostPositions {nullptr};   /*!< \brief Pinned positions, 3 scalars per pixel */
+    Storage* m_hostNormals {nullptr};     /*!< \brief Pinned normals, 3 scalars per pixel */
+    Scalar* m_hostResults {nullptr};      /*!< \brief Pinned results, 1 scalar per pixel */
+    Storage* m_devicePositions {nullptr}; /*!< \brief Device positions */
+    Storage* m_deviceNormals {nullptr};   /*!< \brief Device normals */
+    Scalar* m_deviceResults {nullptr};   /*!< \brief Device results */
+};
+
+} // namespace Ponca
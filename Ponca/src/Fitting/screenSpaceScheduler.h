@@ -0,0 +1,325 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./screenSpaceCuda.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace Ponca
+{
+
+/*!
+    \brief Screen-space fits of large images, split in chunks of rows spread over several streams and GPUs
+
+    The image is split in chunks of consecutive rows. Each device is driven by a host thread taking the next chunk
+    from a shared counter, so that the faster devices process more chunks. A device owns several streams with their
+    buffers (two by default, for double buffering): while the kernel of a chunk runs on a stream, the uploads of
+    the next chunk proceed on the other one, and the results of the previous one are downloaded. A chunk uploads
+    its rows and the `radius` rows around them, so that its fits read the same neighborhoods as the fits of the
+    whole image, and downloads its rows of results only.
+
+    The host buffers are pinned and portable, shared by all the devices. The device buffers are kept from one
+    #run to the next, and reallocated only when they are too small.
+
+    \code
+    ScreenSpaceScheduler<Fit> scheduler; // all the devices
+    scheduler.resize(width, height);
+    fill(scheduler.positions(), scheduler.normals());
+    scheduler.run(radius, maxDepthDiff, Curvature());
+    use(scheduler.results());
+    for (const auto& s : scheduler.statistics())
+        std::cout << s.device << ": " << s.throughput() << " pixels/s" << std::endl;
+    \endcode
+
+    The errors are reported by the CUDA status codes.
+
+    \tparam Fit Basket whose data points and weight function are ScreenSpacePoint and ProjectedWeightFunc, or
+    provide the same interface
+    \tparam Storage Scalar type of the positions and normals, see ScreenSpaceFitter
+    \see ScreenSpaceFitter to process images of moderate size on a single stream
+    \ingroup fitting
+*/
+template <typename Fit, typename Storage = typename Fit::Scalar>
+class ScreenSpaceScheduler
+{
+public:
+    typedef typename Fit::Scalar Scalar; /*!< \brief Scalar type of the fits and the results */
+
+    /*! \brief Number of threads of the blocks along each dimension of the image */
+    enum {BlockSize = 16};
+
+    /*! \brief Work of a device during the last #run */
+    struct DeviceStatistics
+    {
+        int device {0};            /*!< \brief CUDA device */
+        int chunks {0};            /*!< \brief Number of processed chunks */
+        std::size_t pixels {0};    /*!< \brief Number of fitted pixels */
+        double seconds {0};        /*!< \brief Time from the start of the run to the last result of the device */
+
+        /*! \brief Fitted pixels per second */
+        inline double throughput() const { return seconds > 0 ? double(pixels) / seconds : 0; }
+    };
+
+    /*!
+        \brief Scheduler over `_devices`, all the devices when empty, with `_streams` streams per device and chunks
+        of `_chunkRows` rows
+    */
+    inline explicit ScreenSpaceScheduler(std::vector<int> _devices = std::vector<int>(), int _streams = 2,
+                                         int _chunkRows = 256)
+        : m_chunkRows(std::max(_chunkRows, 1))
+    {
+        if (_devices.empty())
+        {
+            int count = 0;
+            cudaGetDeviceCount(&count);
+            for (int i = 0; i < count; ++i)
+                _devices.push_back(i);
+        }
+
+        m_devices.resize(_devices.size());
+        for (std::size_t d = 0; d < _devices.size(); ++d)
+        {
+            Device& device = m_devices[d];
+            device.id = _devices[d];
+            cudaSetDevice(device.id);
+            int sharedMemory = 0;
+            cudaDeviceGetAttribute(&sharedMemory, cudaDevAttrMaxSharedMemoryPerBlock, device.id);
+            device.maxSharedMemory = std::size_t(sharedMemory);
+            device.slots.resize(std::max(_streams, 1));
+            for (Slot& slot : device.slots)
+                cudaStreamCreate(&slot.stream);
+        }
+    }
+
+    inline ~ScreenSpaceScheduler()
+    {
+        for (Device& device : m_devices)
+        {
+            cudaSetDevice(device.id);
+            for (Slot& slot : device.slots)
+            {
+                releaseSlot(slot);
+                cudaStreamDestroy(slot.stream);
+            }
+        }
+        releaseHost();
+    }
+
+    ScreenSpaceScheduler(const ScreenSpaceScheduler&) = delete;
+    ScreenSpaceScheduler& operator=(const ScreenSpaceScheduler&) = delete;
+
+    /*! \brief Set the size of the next images, allocating the host buffers when they are larger than the previous ones */
+    inline cudaError_t resize(int _width, int _height)
+    {
+        const std::size_t size = std::size_t(_width) * std::size_t(_height);
+        if (size > m_capacity)
+        {
+            releaseHost();
+            cudaError_t err;
+            if ((err = cudaHostAlloc(&m_hostPositions, 3 * size * sizeof(Storage), cudaHostAllocPortable)) != cudaSuccess ||
+                (err = cudaHostAlloc(&m_hostNormals,   3 * size * sizeof(Storage), cudaHostAllocPortable)) != cudaSuccess ||
+                (err = cudaHostAlloc(&m_hostResults,       size * sizeof(Scalar), cudaHostAllocPortable)) != cudaSuccess)
+            {
+                releaseHost();
+                return err;
+            }
+            m_capacity = size;
+        }
+        m_width  = _width;
+        m_height = _height;
+        return cudaSuccess;
+    }
+
+    /*! \brief Pinned host buffer of the positions, 3 scalars per pixel, filled by the caller before #run */
+    inline Storage* positions() { return m_hostPositions; }
+    /*! \brief Pinned host buffer of the normals, 3 scalars per pixel, filled by the caller before #run */
+    inline Storage* normals() { return m_hostNormals; }
+    /*! \brief Pinned host buffer of the results, one scalar per pixel */
+    inline const Scalar* results() const { return m_hostResults; }
+
+    /*! \brief Width of the images */
+    inline int width() const { return m_width; }
+    /*! \brief Height of the images */
+    inline int height() const { return m_height; }
+    /*! \brief Number of devices */
+    inline int deviceCount() const { return int(m_devices.size()); }
+
+    /*! \brief Enable the fits from shared memory tiles when they fit in the shared memory (default: true) */
+    inline void setTiling(bool _tiling) { m_tiling = _tiling; }
+
+    /*! \brief Work of each device during the last #run */
+    inline std::vector<DeviceStatistics> statistics() const
+    {
+        std::vector<DeviceStatistics> res;
+        for (const Device& device : m_devices)
+            res.push_back(device.statistics);
+        return res;
+    }
+
+    /*!
+        \brief Fit the neighborhoods of radius `_radius` pixels of the image, writing `_output` of each fit in the
+        results (see screenSpaceFitKernel), and wait for the results
+
+        \return the first error of the devices
+    */
+    template <typename Output>
+    inline cudaError_t run(int _radius, Scalar _maxDepthDiff, Output _output)
+    {
+        m_nextChunk = 0;
+        const int chunkCount = (m_height + m_chunkRows - 1) / m_chunkRows;
+        const auto start = std::chrono::steady_clock::now();
+
+        std::vector<cudaError_t> errors(m_devices.size(), cudaSuccess);
+        std::vector<std::thread> threads;
+        for (std::size_t d = 0; d < m_devices.size(); ++d)
+            threads.emplace_back([&, d]() {
+                errors[d] = runDevice(m_devices[d], chunkCount, _radius, _maxDepthDiff, _output, start);
+            });
+        for (std::thread& thread : threads)
+            thread.join();
+
+        for (cudaError_t err : errors)
+            if (err != cudaSuccess)
+                return err;
+        return m_devices.empty() ? cudaErrorNoDevice : cudaSuccess;
+    }
+
+private:
+    /*! \brief Stream of a device and the buffers of the chunk it processes */
+    struct Slot
+    {
+        cudaStream_t stream;
+        Storage* positions {nullptr};
+        Storage* normals {nullptr};
+        Scalar* results {nullptr};
+        std::size_t capacity {0}; /*!< \brief Number of pixels of the input buffers */
+    };
+
+    struct Device
+    {
+        int id {0};
+        std::size_t maxSharedMemory {0};
+        std::vector<Slot> slots;
+        DeviceStatistics statistics;
+    };
+
+    /*! \brief Process the chunks taken by the thread of `_device` */
+    template <typename Output>
+    inline cudaError_t runDevice(Device& _device, int _chunkCount, int _radius, Scalar _maxDepthDiff,
+                                 const Output& _output, std::chrono::steady_clock::time_point _start)
+    {
+        cudaSetDevice(_device.id);
+        _device.statistics = DeviceStatistics();
+        _device.statistics.device = _device.id;
+
+        const bool tiled = m_tiling && screenSpaceTileSharedMemory<Storage>(BlockSize, _radius) <= _device.maxSharedMemory;
+        const std::size_t chunkPixels = std::size_t(m_width) * std::size_t(m_chunkRows + 2 * _radius);
+
+        cudaError_t err = cudaSuccess;
+        int chunk;
+        for (int k = 0; err == cudaSuccess && (chunk = m_nextChunk.fetch_add(1)) < _chunkCount; ++k)
+        {
+            Slot& slot = _device.slots[k % _device.slots.size()];
+            // the previous chunk of the slot is done, its buffers can be reused
+            if ((err = cudaStreamSynchronize(slot.stream)) != cudaSuccess ||
+                (err = reserveSlot(slot, chunkPixels)) != cudaSuccess)
+                break;
+
+            const int firstRow  = chunk * m_chunkRows;
+            const int rowCount  = std::min(m_chunkRows, m_height - firstRow);
+            const int firstRead = std::max(firstRow - _radius, 0);
+            const int lastRead  = std::min(firstRow + rowCount + _radius, m_height);
+            const std::size_t read = std::size_t(m_width) * std::size_t(lastRead - firstRead);
+            const std::size_t offset = std::size_t(m_width) * std::size_t(firstRead);
+
+            cudaMemcpyAsync(slot.positions, m_hostPositions + 3 * offset, 3 * read * sizeof(Storage),
+                            cudaMemcpyHostToDevice, slot.stream);
+            cudaMemcpyAsync(slot.normals, m_hostNormals + 3 * offset, 3 * read * sizeof(Storage),
+                            cudaMemcpyHostToDevice, slot.stream);
+
+            const ScreenSpaceTile<Storage> image {slot.positions, slot.normals, 0, firstRead, m_width};
+            launchScreenSpaceFit<Fit>(slot.stream, tiled, BlockSize, m_width, m_height, firstRow, rowCount, _radius,
+                                      _maxDepthDiff, image, _output, slot.results);
+
+            const std::size_t fitted = std::size_t(m_width) * std::size_t(rowCount);
+            cudaMemcpyAsync(m_hostResults + std::size_t(m_width) * std::size_t(firstRow), slot.results,
+                            fitted * sizeof(Scalar), cudaMemcpyDeviceToHost, slot.stream);
+            err = cudaGetLastError();
+
+            ++_device.statistics.chunks;
+            _device.statistics.pixels += fitted;
+        }
+
+        for (Slot& slot : _device.slots)
+        {
+            const cudaError_t syncErr = cudaStreamSynchronize(slot.stream);
+            if (err == cudaSuccess)
+                err = syncErr;
+        }
+        _device.statistics.seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+        return err;
+    }
+
+    /*! \brief Allocate the buffers of `_slot` for chunks reading `_pixels` pixels, on the current device */
+    inline cudaError_t reserveSlot(Slot& _slot, std::size_t _pixels)
+    {
+        if (_pixels <= _slot.capacity)
+            return cudaSuccess;
+        releaseSlot(_slot);
+        cudaError_t err;
+        if ((err = cudaMalloc(&_slot.positions, 3 * _pixels * sizeof(Storage))) != cudaSuccess ||
+            (err = cudaMalloc(&_slot.normals,   3 * _pixels * sizeof(Storage))) != cudaSuccess ||
+            (err = cudaMalloc(&_slot.results,       _pixels * sizeof(Scalar))) != cudaSuccess)
+        {
+            releaseSlot(_slot);
+            return err;
+        }
+        _slot.capacity = _pixels;
+        return cudaSuccess;
+    }
+
+    inline void releaseSlot(Slot& _slot)
+    {
+        cudaFree(_slot.positions);
+        cudaFree(_slot.normals);
+        cudaFree(_slot.results);
+        _slot.positions = _slot.normals = nullptr;
+        _slot.results = nullptr;
+        _slot.capacity = 0;
+    }
+
+    inline void releaseHost()
+    {
+        cudaFreeHost(m_hostPositions);
+        cudaFreeHost(m_hostNormals);
+        cudaFreeHost(m_hostResults);
+        m_hostPositions = m_hostNormals = nullptr;
+        m_hostResults = nullptr;
+        m_capacity = 0;
+    }
+
+    std::vector<Device> m_devices;   /*!< \brief Devices, with their streams and buffers */
+    std::atomic<int> m_nextChunk {0}; /*!< \brief Next chunk to process */
+    int m_chunkRows;                 /*!< \brief Number of rows of the chunks */
+    bool m_tiling {true};            /*!< \brief Tells if the fits may read shared memory tiles */
+    int m_width {0};                 /*!< \brief Width of the images */
+    int m_height {0};                /*!< \brief Height of the images */
+    std::size_t m_capacity {0};      /*!< \brief Number of pixels of the host buffers */
+
+    Storage* m_hostPositions {nullptr}; /*!< \brief Pinned positions, 3 scalars per pixel */
+    Storage* m_hostNormals {nullptr};   /*!< \brief Pinned normals, 3 scalars per pixel */
+    Scalar* m_hostResults {nullptr};    /*!< \brief Pinned results, 1 scalar per pixel */
+};
+
+} // namespace Ponca
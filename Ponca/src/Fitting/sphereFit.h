@@ -7,16 +7,70 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #pragma once
 
 #include "./algebraicSphere.h"
+#include "./enums.h"
 
+#include <Eigen/Eigenvalues>
 
 namespace Ponca
 {
 
+namespace internal
+{
+    /*!
+        \brief Singular value decomposition of the square matrix `_m` by at most `_sweeps` one-sided Jacobi sweeps:
+        on return, the columns of `_m` are orthogonal, their norms being the singular values, and the columns of `_v`
+        are the right singular vectors
+
+        Each sweep orthogonalizes the columns two by two with plane rotations (Eigen::JacobiRotation), which are the
+        Jacobi rotations of \f$ m^T m \f$ computed from the columns instead of the product: the small singular
+        values keep the accuracy of `_m`, unlike an eigen decomposition of \f$ m^T m \f$ which squares its
+        condition number. The convergence is quadratic, a few sweeps being enough for small matrices, and the
+        sweeps stop when all the columns are orthogonal up to the rounding errors. Only rotations of fixed size
+        matrices, available on GPU whatever their size, unlike Eigen::SelfAdjointEigenSolver::computeDirect limited
+        to 2x2 and 3x3 matrices.
+    */
+    template <typename MatrixType>
+    PONCA_MULTIARCH inline void jacobiSingularValueDecomposition(MatrixType& _m, MatrixType& _v, int _sweeps = 8)
+    {
+        typedef typename MatrixType::Scalar Scalar;
+        typedef typename MatrixType::Index Index;
+        PONCA_MULTIARCH_STD_MATH(abs);
+        PONCA_MULTIARCH_STD_MATH(sqrt);
+
+        _v.setIdentity();
+        const Scalar epsilon = Eigen::NumTraits<Scalar>::epsilon();
+        for (int s = 0; s < _sweeps; ++s)
+        {
+            bool rotated = false;
+            for (Index p = 0; p < _m.cols() - 1; ++p)
+                for (Index q = p + 1; q < _m.cols(); ++q)
+                {
+                    const Scalar alpha = _m.col(p).squaredNorm(), beta = _m.col(q).squaredNorm();
+                    const Scalar gamma = _m.col(p).dot(_m.col(q));
+                    if (abs(gamma) <= epsilon * sqrt(alpha * beta))
+                        continue;
+                    Eigen::JacobiRotation<Scalar> j;
+                    j.makeJacobi(alpha, gamma, beta);
+                    _m.applyOnTheRight(p, q, j);
+                    _v.applyOnTheRight(p, q, j);
+                    rotated = true;
+                }
+            if (!rotated)
+                return;
+        }
+    }
+} // namespace internal
+
 /*!
     \brief Algebraic Sphere fitting procedure on point sets without normals
 
     Method published in \cite Guennebaud:2007:APSS.
 
+    The sphere minimizes the algebraic distance to the neighbors under the Pratt normalization, given by an eigen
+    decomposition of the \f$ (Dim+2) \times (Dim+2) \f$ product of the normalization and covariance matrices, see
+    setSolver. Only #ITERATIVE_SOLVER and #DIRECT_SOLVER are distinguished, the other values of #COVARIANCE_SOLVER
+    meaning #DIRECT_SOLVER.
+
     \inherit Concept::FittingProcedureConcept
 
     \see AlgebraicSphere
@@ -47,6 +101,11 @@ public:
     MatrixA  m_matA;  /*!< \brief Covariance matrix of [1, p, p^2] */
     Scalar   m_sumW;  /*!< \brief Sum of queries weight */
     WFunctor m_w;     /*!< \brief Weight function (must inherits BaseWeightFunc) */
+#ifdef PONCA_GPU_COMPILER
+    COVARIANCE_SOLVER m_solverType {DIRECT_SOLVER};    /*!< \brief Decomposition of the eigenproblem */
+#else
+    COVARIANCE_SOLVER m_solverType {ITERATIVE_SOLVER}; /*!< \brief Decomposition of the eigenproblem */
+#endif
 
 public:
 
@@ -54,6 +113,20 @@ public:
     PONCA_MULTIARCH inline SphereFit()
         : Base(){}
 
+    /*!
+        \brief Set the decomposition of the eigenproblem used by finalize (default: #ITERATIVE_SOLVER on CPU,
+        #DIRECT_SOLVER on GPU)
+
+        #ITERATIVE_SOLVER uses Eigen::SelfAdjointEigenSolver::compute, and is not available on GPU. #DIRECT_SOLVER
+        uses at most a fixed number of one-sided Jacobi sweeps, see internal::jacobiSingularValueDecomposition,
+        available on GPU and more accurate: the iterative solver decomposes the product of the matrix by its
+        transpose, which loses half of the digits of the spheres of small neighborhoods, e.g. in single precision.
+    */
+    PONCA_MULTIARCH inline void setSolver(COVARIANCE_SOLVER _solver) { m_solverType = _solver; }
+
+    /*! \brief Decomposition of the eigenproblem used by finalize */
+    PONCA_MULTIARCH inline COVARIANCE_SOLVER solverType() const { return m_solverType; }
+
     /**************************************************************************/
     /* Initialization                                                         */
     /**************************************************************************/
@@ -70,6 +143,12 @@ public:
     /*! \copydoc Concept::FittingProcedureConcept::addNeighbor() */
     PONCA_MULTIARCH inline bool addNeighbor(const DataPoint &_nei);
 
+    /*!
+        \brief Add the neighbors accumulated by `_other`, as if they were added to this fit
+        \see Basket::merge
+    */
+    PONCA_MULTIARCH inline void merge(const SphereFit& _other);
+
     /*! \copydoc Concept::FittingProcedureConcept::finalize() */
     PONCA_MULTIARCH inline FIT_RESULT finalize();
 
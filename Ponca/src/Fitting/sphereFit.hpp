@@ -31,7 +31,7 @@ SphereFit<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
     if (w > Scalar(0.))
     {
         VectorA a;
-#ifdef __CUDACC__
+#ifdef PONCA_GPU_COMPILER
         a(0) = 1;
         a.template segment<DataPoint::Dim>(1) = q;
         a(DataPoint::Dim+1) = q.squaredNorm();
@@ -49,6 +49,15 @@ SphereFit<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
 }
 
 
+template < class DataPoint, class _WFunctor, typename T>
+void
+SphereFit<DataPoint, _WFunctor, T>::merge(const SphereFit& _other)
+{
+    Base::merge(_other);
+    m_matA += _other.m_matA;
+    m_sumW += _other.m_sumW;
+}
+
 template < class DataPoint, class _WFunctor, typename T>
 FIT_RESULT
 SphereFit<DataPoint, _WFunctor, T>::finalize ()
@@ -65,13 +74,6 @@ SphereFit<DataPoint, _WFunctor, T>::finalize ()
         return Base::m_eCurrentState;
     }
 
-    MatrixA matC;
-    matC.setIdentity();
-    matC.template topRightCorner<1,1>()    << -2;
-    matC.template bottomLeftCorner<1,1>()  << -2;
-    matC.template topLeftCorner<1,1>()     << 0;
-    matC.template bottomRightCorner<1,1>() << 0;
-
     MatrixA invCpratt;
     invCpratt.setIdentity();
     invCpratt.template topRightCorner<1,1>()    << -0.5;
@@ -80,26 +82,33 @@ SphereFit<DataPoint, _WFunctor, T>::finalize ()
     invCpratt.template bottomRightCorner<1,1>() << 0;
 
     MatrixA M = invCpratt * m_matA;
-    // go to positive semi-definite matrix to be compatible with
-    // SelfAdjointEigenSolver requirements
-    // Note: This does not affect the eigen vectors order
-    Eigen::SelfAdjointEigenSolver<MatrixA> solver;
-#ifdef __CUDACC__
-    solver.computeDirect(M.transpose() * M);
-#else
-    solver.compute(M.transpose() * M);
+    VectorA eivals;
+    MatrixA eivecs;
+#ifndef PONCA_GPU_COMPILER
+    if (m_solverType == ITERATIVE_SOLVER)
+    {
+        // go to positive semi-definite matrix to be compatible with
+        // SelfAdjointEigenSolver requirements
+        // Note: This does not affect the eigen vectors order
+        Eigen::SelfAdjointEigenSolver<MatrixA> solver;
+        solver.compute(M.transpose() * M);
+        eivals = solver.eigenvalues();
+        eivecs = solver.eigenvectors();
+    }
+    else
 #endif
-    VectorA eivals = solver.eigenvalues().real();
-    int minId = -1;
-    for(int i=0 ; i<DataPoint::Dim+2 ; ++i)
     {
-    Scalar ev = eivals(i);
-    if((ev>0) && (minId==-1 || ev<eivals(minId)))
-    minId = i;
+        // same eigenvectors, from the right singular vectors of M
+        internal::jacobiSingularValueDecomposition(M, eivecs);
+        eivals = M.colwise().squaredNorm().transpose();
     }
 
+    // the eigenvalues are non-negative up to the rounding errors, the one of a perfect fit being 0
+    int minId = 0;
+    eivals.minCoeff(&minId);
+
     //mLambda = eivals(minId);
-    VectorA vecU = solver.eigenvectors().col(minId).real();
+    VectorA vecU = eivecs.col(minId);
     Base::m_uq = vecU[1+DataPoint::Dim];
     Base::m_ul = vecU.template segment<DataPoint::Dim>(1);
     Base::m_uc = vecU[0];
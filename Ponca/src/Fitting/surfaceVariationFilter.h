@@ -0,0 +1,58 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+#include "computeAll.h"
+#include "../Common/Tracing.h"
+
+#include <vector>
+
+namespace Ponca
+{
+
+/*!
+    \brief Residual-based outlier removal: keep the points indexed by `tree` whose neighborhood of radius `scale`
+    is well fitted by a plane
+
+    The neighborhood of each point indexed by the tree is fitted by computeAll, in parallel. The point is kept
+    when the fit is STABLE and its normalized residual, `surfaceVariation()`, is at most `maxVariation`: the
+    isolated points, whose neighborhood is too small to be fitted, and the points off the surface, which spread
+    their neighborhood along the normal, are removed. The kept points are written to `kept` by increasing index,
+    to be given as the sampling of `KdTree::build(points, kept)` without copying the points.
+
+    \code
+    typedef Basket<Point, DistWeightFunc<Point, SmoothWeightKernel<Scalar>>, CovariancePlaneFit> Fit;
+    std::vector<int> kept;
+    computeSurfaceVariationFilter<Fit>(tree, scale, Scalar(0.05), kept);
+    tree.build(points, kept);
+    \endcode
+
+    \tparam Fit Fitting procedure providing `surfaceVariation()`, e.g. a CovariancePlaneFit Basket
+    \param maxVariation Largest surface variation, in [0, 1/3] in 3D
+    \see statistical_outlier_filter and radius_outlier_filter for the density-based filters
+    \ingroup fitting
+*/
+template <typename Fit, typename TreeT>
+inline void computeSurfaceVariationFilter(const TreeT& tree, typename Fit::Scalar scale,
+                                          typename Fit::Scalar maxVariation, std::vector<int>& kept)
+{
+    PONCA_TRACE_ZONE("ponca::computeSurfaceVariationFilter");
+
+    std::vector<char> flags(tree.point_count(), 0);
+    computeAll<Fit>(tree, scale, [&](int i, const Fit& fit, FIT_RESULT res) {
+        flags[i] = res == STABLE && fit.surfaceVariation() <= maxVariation;
+    });
+
+    kept.clear();
+    for (int i = 0; i < int(flags.size()); ++i)
+        if (flags[i])
+            kept.push_back(i);
+}
+
+} // namespace Ponca
@@ -0,0 +1,334 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "defines.h"
+#include "enums.h"
+#include "../Common/Tracing.h"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Ponca
+{
+
+namespace internal
+{
+    /*! \brief Tell if a spatial structure provides `is_removed(id)`, see DynamicKdTree */
+    template <class TreeT, typename = void>
+    struct HasRemovedPoints : std::false_type {};
+
+    template <class TreeT>
+    struct HasRemovedPoints<TreeT, decltype(void(std::declval<const TreeT&>().is_removed(0)))> : std::true_type {};
+
+    /*! \brief Tell if the point `_i` of `_tree` was removed, false for the structures without removal */
+    template <typename TreeT>
+    inline bool isRemoved(const TreeT& _tree, int _i)
+    {
+        if constexpr (HasRemovedPoints<TreeT>::value)
+            return _tree.is_removed(_i);
+        else
+            return false;
+    }
+} // namespace internal
+
+/*!
+    \brief Fits of the points of a tree kept from one frame to the next, for streams of slowly moving points
+
+    Scanner streams move most of their points by a fraction of the scale between two frames, e.g. the points of a
+    DynamicKdTree moved by DynamicKdTree::move, which keeps their ids. Calling update() after each frame keeps,
+    for each point, its fit of the neighborhood of radius `scale` and the list of its neighbors within
+    `(1 + skin) * scale`, and computes again only what the motion of the frame invalidated:
+    - The neighbor lists are revalidated incrementally, as Verlet lists: the motion of a frame is bounded by the
+      largest displacement of a point since the previous frame, and a list stays exact while the displacement of
+      its point since the list was gathered plus the motions of the frames since then remain below
+      `skin * scale`. Otherwise the list is gathered again from the tree. The points moving by more than
+      `skin * scale / 8` in a frame are not counted in its motion: they are handled as insertions, the lists
+      around the new, fast and removed points being gathered again.
+    - A fit is kept while the largest distance of its neighbors to its AlgebraicSphere stays within
+      `tolerance * scale` of the distance it had when fitted. The distances are bounded by the largest
+      displacements of the listed neighbors since they were last computed, and computed again only when the bound
+      exceeds the tolerance: the fits of the static points only read the displacements of their neighbors, and the
+      others are fitted again only when the surface moved away.
+    The fits are fitted again when their neighbor list is gathered again, or when their point moved farther than
+    `skin * scale` from the center of the fit. The neighbors entering the neighborhood between two computations of
+    the distances are not checked.
+
+    The points are identified by their id in the tree: the fit of a point is given by fit(), initialized at its
+    position when it was last fitted. The removed points of a DynamicKdTree are not fitted.
+
+    \code
+    DynamicKdTree<Point> tree(points);
+    TemporalFitCache<Fit, DynamicKdTree<Point> > temporal(tree, scale);
+    temporal.update(); // fits all the points
+    for (const auto& frame : stream)
+    {
+        for (int id = 0; id < tree.point_count(); ++id)
+            tree.move(id, frame[id]);
+        temporal.update(); // fits again the points whose neighborhood moved
+        normal = temporal.fit(id).primitiveGradient();
+    }
+    \endcode
+
+    \tparam Fit Fitting procedure of an AlgebraicSphere providing `project`, e.g. a Basket of OrientedSphereFit,
+    whose weight function is constructible from `scale`
+    \tparam TreeT Spatial structure providing `point_count()`, `point(i)` and `range_neighbors(point, radius)`
+    returning a query rebindable with `operator()(point, radius)`, e.g. DynamicKdTree or a KdTree rebuilt over the
+    same ids, and optionally `is_removed(i)`
+    \see FitFieldCache to reuse the fits at other positions of a static point set
+    \ingroup fitting
+*/
+template <typename Fit, typename TreeT>
+class TemporalFitCache
+{
+public:
+    typedef typename Fit::DataPoint  DataPoint;  /*!< \brief Point type of the fit */
+    typedef typename Fit::Scalar     Scalar;     /*!< \brief Scalar type of the fit */
+    typedef typename Fit::VectorType VectorType; /*!< \brief Vector type of the fit */
+    typedef typename Fit::WFunctor   WeightFunc; /*!< \brief Weight function of the fit */
+
+    /*!
+        \brief Fits of the points of `_tree` at the scale `_scale`, computed by the first call to update()
+        \param _tree Spatial structure, which must outlive the cache
+    */
+    inline TemporalFitCache(const TreeT& _tree, Scalar _scale) : m_tree(&_tree), m_scale(_scale) {}
+
+    /*!
+        \brief Set the largest increase, relative to the scale, of the distance of the neighbors of a fit to its
+        sphere, beyond which the point is fitted again (default: 1e-2)
+
+        0 fits again all the points whose neighbors moved.
+    */
+    inline void setTolerance(Scalar _tolerance) { m_tolerance = _tolerance; }
+    inline Scalar tolerance() const { return m_tolerance; }
+
+    /*!
+        \brief Set the margin, relative to the scale, of the neighbor lists (default: 0.25)
+
+        Larger margins gather the neighbor lists less often, and filter longer lists at each fit.
+    */
+    inline void setSkin(Scalar _skin) { m_skin = _skin; }
+    inline Scalar skin() const { return m_skin; }
+
+    /*! \brief Scale of the fits */
+    inline Scalar scale() const { return m_scale; }
+
+    /*! \brief Fit of the point `_i` of the tree, valid when state(_i) is not #UNDEFINED */
+    inline const Fit& fit(int _i) const { return m_entries[_i].fit; }
+
+    /*! \brief State of the fit of the point `_i` of the tree, #UNDEFINED for the removed points */
+    inline FIT_RESULT state(int _i) const { return m_entries[_i].state; }
+
+    /*! \brief Number of neighbor lists gathered from the tree by the last update() */
+    inline int queriedCount() const { return m_queriedCount; }
+    /*! \brief Number of fits whose distances were computed again, and which were kept, by the last update() */
+    inline int checkedCount() const { return m_checkedCount; }
+    /*! \brief Number of points fitted by the last update() */
+    inline int refitCount() const { return m_refitCount; }
+
+    /*!
+        \brief Update the fits after the points of the tree moved, were inserted or removed, in parallel
+
+        The first call fits all the points. The positions of the points are compared to the ones of the previous
+        call: the ids of the points must be kept, the new points having the ids following the previous ones or the
+        ids of removed points (see DynamicKdTree::insert), handled as moved points.
+    */
+    inline void update()
+    {
+        PONCA_TRACE_ZONE("ponca::TemporalFitCache::update");
+        const TreeT& tree = *m_tree;
+        const int count = tree.point_count();
+        const int previousCount = int(m_previous.size());
+        const Scalar outer = (Scalar(1) + m_skin) * m_scale, fast = m_skin * m_scale / Scalar(8);
+
+        // displacements of the frame: the fast points are handled as insertions, the others bound the motion
+        m_entries.resize(count);
+        m_previous.resize(count);
+        m_displacements.assign(count, Scalar(0));
+        m_moved.clear();
+        Scalar frameMotion = Scalar(0);
+        for (int i = 0; i < count; ++i)
+        {
+            // the neighbors of the removed points lost one
+            if (internal::isRemoved(tree, i))
+            {
+                if (i < previousCount && m_entries[i].fitted)
+                    m_moved.push_back(i);
+                continue;
+            }
+            if (i >= previousCount || !m_entries[i].fitted)
+            {
+                m_moved.push_back(i);
+                continue;
+            }
+            const Scalar d = (tree.point(i).pos() - m_previous[i]).norm();
+            m_displacements[i] = d;
+            if (d > fast)
+                m_moved.push_back(i);
+            else
+                frameMotion = std::max(frameMotion, d);
+        }
+        m_motion += frameMotion;
+
+        // the lists around the new and fast points may miss them, the ones around their previous positions and
+        // around the removed points lost them
+        if (previousCount > 0)
+        {
+            if (m_moved.size() > std::size_t(count / 8))
+                for (Entry& e : m_entries)
+                    e.listed = false;
+            else
+            {
+                auto query = tree.range_neighbors(VectorType::Zero().eval(), Scalar(0));
+                for (int i : m_moved)
+                {
+                    if (i < previousCount && m_entries[i].fitted)
+                        for (int j : query(m_previous[i], outer))
+                            m_entries[j].listed = false;
+                    if (!internal::isRemoved(tree, i))
+                        for (int j : query(tree.point(i).pos(), outer))
+                            m_entries[j].listed = false;
+                }
+            }
+        }
+
+        int queried = 0, checked = 0, refit = 0;
+#pragma omp parallel reduction(+ : queried, checked, refit)
+        {
+            auto query = tree.range_neighbors(VectorType::Zero().eval(), Scalar(0));
+            std::vector<DataPoint> neighbors;
+
+#pragma omp for schedule(dynamic, 64)
+            for (int i = 0; i < count; ++i)
+            {
+                Entry& e = m_entries[i];
+                if (internal::isRemoved(tree, i))
+                {
+                    e.state = UNDEFINED;
+                    e.listed = e.fitted = false;
+                    e.neighbors.clear();
+                    continue;
+                }
+                const VectorType& p = tree.point(i).pos();
+
+                // the neighbors of the fit moved at most by the largest displacement of the list
+                Scalar drift = m_displacements[i];
+                for (int j : e.neighbors)
+                    drift = std::max(drift, m_displacements[j]);
+                e.drift += drift;
+
+                // neighbor list
+                const bool requery = !e.listed ||
+                    (p - e.listCenter).norm() + (m_motion - e.listMotion) > m_skin * m_scale;
+                if (requery)
+                {
+                    e.neighbors.clear();
+                    for (int j : query(p, outer))
+                        e.neighbors.push_back(j);
+                    e.listCenter = p;
+                    e.listMotion = m_motion;
+                    e.listed = true;
+                    ++queried;
+                }
+
+                // fit
+                bool refitNeeded = requery || !e.fitted || (p - e.fit.basisCenter()).norm() > m_skin * m_scale;
+                const Scalar maxDistance = e.fitDistance + m_tolerance * m_scale;
+                if (!refitNeeded && e.checkDistance + e.drift > maxDistance)
+                {
+                    // the fits without sphere have no distance to bound
+                    refitNeeded = e.state == UNDEFINED;
+                    if (!refitNeeded)
+                    {
+                        gather(p, e, neighbors);
+                        e.checkDistance = maxNeighborDistance(e.fit, neighbors);
+                        e.drift = Scalar(0);
+                        refitNeeded = e.checkDistance > maxDistance;
+                        ++checked;
+                    }
+                }
+                if (refitNeeded)
+                {
+                    gather(p, e, neighbors);
+                    e.fit = Fit();
+                    e.fit.setWeightFunc(WeightFunc(m_scale));
+                    e.fit.init(p);
+                    e.state = e.fit.compute(neighbors.cbegin(), neighbors.cend());
+                    e.fitDistance = e.state == UNDEFINED ? Scalar(0) : maxNeighborDistance(e.fit, neighbors);
+                    e.checkDistance = e.fitDistance;
+                    e.drift = Scalar(0);
+                    e.fitted = true;
+                    ++refit;
+                }
+                m_previous[i] = p;
+            }
+        }
+        m_queriedCount = queried;
+        m_checkedCount = checked;
+        m_refitCount = refit;
+    }
+
+private:
+    /*! \brief Fit, neighbor list and distances kept for a point */
+    struct Entry
+    {
+        Fit fit;                                     /*!< \brief Fit of the point */
+        FIT_RESULT state {UNDEFINED};                /*!< \brief State of the fit */
+        bool fitted {false};                         /*!< \brief Is the point fitted */
+        bool listed {false};                         /*!< \brief Is the neighbor list valid */
+        std::vector<int> neighbors;                  /*!< \brief Neighbors within `(1 + skin) * scale` */
+        VectorType listCenter {VectorType::Zero()};  /*!< \brief Position of the point when the list was gathered */
+        Scalar listMotion {0};                       /*!< \brief Motion of the frames when the list was gathered */
+        Scalar fitDistance {0};                      /*!< \brief Largest distance of the neighbors when fitted */
+        Scalar checkDistance {0};                    /*!< \brief Largest distance of the neighbors when last computed */
+        Scalar drift {0};                            /*!< \brief Displacement bound of the neighbors since checkDistance */
+    };
+
+    /*! \brief Neighbors within the scale of `_p`, filtered from the neighbor list of `_e` */
+    inline void gather(const VectorType& _p, const Entry& _e, std::vector<DataPoint>& _neighbors) const
+    {
+        const Scalar scale2 = m_scale * m_scale;
+        _neighbors.clear();
+        for (int j : _e.neighbors)
+        {
+            if (internal::isRemoved(*m_tree, j))
+                continue;
+            const DataPoint& q = m_tree->point(j);
+            if ((q.pos() - _p).squaredNorm() < scale2)
+                _neighbors.push_back(q);
+        }
+    }
+
+    /*! \brief Largest distance of `_neighbors` to the sphere of `_fit` */
+    static inline Scalar maxNeighborDistance(const Fit& _fit, const std::vector<DataPoint>& _neighbors)
+    {
+        Scalar distance2 = Scalar(0);
+        for (const DataPoint& q : _neighbors)
+            distance2 = std::max(distance2, (_fit.project(q.pos()) - q.pos()).squaredNorm());
+        return std::sqrt(distance2);
+    }
+
+    const TreeT* m_tree;                 /*!< \brief Points of the stream */
+    Scalar m_scale;                      /*!< \brief Scale of the fits */
+    Scalar m_tolerance {Scalar(1e-2)};   /*!< \brief Largest increase of the distances, relative to the scale */
+    Scalar m_skin {Scalar(0.25)};        /*!< \brief Margin of the neighbor lists, relative to the scale */
+    Scalar m_motion {0};                 /*!< \brief Sum of the largest displacements of the slow points */
+    std::vector<Entry> m_entries;        /*!< \brief Fits and lists, by point id */
+    std::vector<VectorType> m_previous;  /*!< \brief Positions of the points at the previous update */
+    std::vector<Scalar> m_displacements; /*!< \brief Displacements of the points during the frame */
+    std::vector<int> m_moved;            /*!< \brief New and fast points of the frame */
+    int m_queriedCount {0};              /*!< \brief Lists gathered by the last update */
+    int m_checkedCount {0};              /*!< \brief Distances computed again by the last update */
+    int m_refitCount {0};                /*!< \brief Points fitted by the last update */
+};
+
+} // namespace Ponca
@@ -53,13 +53,20 @@ protected:
     Scalar      m_sumDotPP, /*!< \brief Sum of the squared relative positions */
                 m_sumW;     /*!< \brief Sum of queries weight */
 
+    VectorB     m_eigenvector; /*!< \brief Solution of the last fit, starting point of the power iterations */
+#ifdef PONCA_GPU_COMPILER
+    UNORIENTED_SPHERE_SOLVER m_solverType {POWER_ITERATION_SOLVER}; /*!< \brief Solver of the eigenproblem */
+#else
+    UNORIENTED_SPHERE_SOLVER m_solverType {GENERAL_EIGEN_SOLVER};   /*!< \brief Solver of the eigenproblem */
+#endif
+
     WFunctor m_w;      /*!< \brief Weight function (must inherits BaseWeightFunc) */
 
 
 public:
     /*! \brief Default constructor */
     PONCA_MULTIARCH inline UnorientedSphereFit()
-        : Base(){}
+        : Base(), m_eigenvector(VectorB::Zero()) {}
 
 
     /**************************************************************************/
@@ -71,6 +78,16 @@ public:
     /*! \copydoc Concept::FittingProcedureConcept::init() */
     PONCA_MULTIARCH inline void init(const VectorType& _evalPos);
 
+    /*!
+        \brief Set the solver of the eigenproblem used by finalize, see #UNORIENTED_SPHERE_SOLVER
+
+        Defaults to #GENERAL_EIGEN_SOLVER on CPU and #POWER_ITERATION_SOLVER on GPU. Kept by init.
+    */
+    PONCA_MULTIARCH inline void setSolver(UNORIENTED_SPHERE_SOLVER _solver) { m_solverType = _solver; }
+
+    /*! \brief Solver of the eigenproblem used by finalize */
+    PONCA_MULTIARCH inline UNORIENTED_SPHERE_SOLVER solverType() const { return m_solverType; }
+
 
     /**************************************************************************/
     /* Processing                                                             */
@@ -78,9 +95,19 @@ public:
     /*! \copydoc Concept::FittingProcedureConcept::addNeighbor() */
     PONCA_MULTIARCH inline bool addNeighbor(const DataPoint& _nei);
 
+    /*!
+        \brief Add the neighbors accumulated by `_other`, as if they were added to this fit
+        \see Basket::merge
+    */
+    PONCA_MULTIARCH inline void merge(const UnorientedSphereFit& _other);
+
     /*! \copydoc Concept::FittingProcedureConcept::finalize() */
     PONCA_MULTIARCH inline FIT_RESULT finalize();
 
+private:
+    /*! \brief Compute the eigenvector of the largest eigenvalue of `_m` by power iterations from m_eigenvector */
+    PONCA_MULTIARCH inline bool largestEigenvector(const MatrixBB& _m, VectorB& _v) const;
+
 }; // class UnorientedSphereFit
 
 
@@ -192,11 +219,11 @@ public:
     }
 
     /*! \brief State specified at compilation time to differenciate the fit in scale */
-    PONCA_MULTIARCH inline bool isScaleDer() const {return Type & FitScaleDer;}
+    static constexpr PONCA_MULTIARCH inline bool isScaleDer() {return bool(Type & FitScaleDer);}
     /*! \brief State specified at compilation time to differenciate the fit in space */
-    PONCA_MULTIARCH inline bool isSpaceDer() const {return Type & FitSpaceDer;}
+    static constexpr PONCA_MULTIARCH inline bool isSpaceDer() {return bool(Type & FitSpaceDer);}
     /*! \brief Number of dimensions used for the differentiation */
-    PONCA_MULTIARCH inline unsigned int derDimension() const { return GLS_DER_NB_DERIVATIVES(Type,DataPoint::Dim);}
+    static constexpr PONCA_MULTIARCH inline unsigned int derDimension() { return GLS_DER_NB_DERIVATIVES(Type,DataPoint::Dim);}
 
     /*!
         \brief Normalize the scalar field by the Pratt norm
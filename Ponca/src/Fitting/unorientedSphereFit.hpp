@@ -58,6 +58,9 @@ template < class DataPoint, class _WFunctor, typename T>
 void
 UnorientedSphereFit<DataPoint, _WFunctor, T>::init(const VectorType& _evalPos)
 {
+    // Express the solution of the previous fit in the new basis: ul' = ul + 2 uq (evalPos - basisCenter)
+    m_eigenvector.template head<Dim>() += m_eigenvector(Dim) * (_evalPos - Base::basisCenter());
+
     // Setup primitive
     Base::resetPrimitive();
     Base::basisCenter() = _evalPos;
@@ -90,7 +93,7 @@ UnorientedSphereFit<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
         m_sumDotPP += w * q.squaredNorm();
         m_sumW     += w;
 
-        /*! \todo Handle add of multiple similar neighbors (maybe user side)*/
+        // similar neighbors are merged user side by collapseDuplicates, their number being the weight of the point
         ++(Base::m_nbNeighbors);
         return true;
     }
@@ -98,6 +101,17 @@ UnorientedSphereFit<DataPoint, _WFunctor, T>::addNeighbor(const DataPoint& _nei)
     return false;
 }
 
+template < class DataPoint, class _WFunctor, typename T>
+void
+UnorientedSphereFit<DataPoint, _WFunctor, T>::merge(const UnorientedSphereFit& _other)
+{
+    Base::merge(_other);
+    m_matA     += _other.m_matA;
+    m_sumP     += _other.m_sumP;
+    m_sumDotPP += _other.m_sumDotPP;
+    m_sumW     += _other.m_sumW;
+}
+
 template < class DataPoint, class _WFunctor, typename T>
 FIT_RESULT
 UnorientedSphereFit<DataPoint, _WFunctor, T>::finalize ()
@@ -128,13 +142,38 @@ UnorientedSphereFit<DataPoint, _WFunctor, T>::finalize ()
     Q(Dim,Dim) = m_sumDotPP * invSumW;
     m_matA *= invSumW;
 
-    MatrixBB M = Q.inverse() * m_matA;
-    Eigen::EigenSolver<MatrixBB> eig(M);
-    VectorB eivals = eig.eigenvalues().real();
-    int maxId = 0;
-    eivals.maxCoeff(&maxId);
+    // Eigenvector of the largest eigenvalue of the generalized eigenproblem m_matA u = lambda Q u
+    VectorB eivec;
+    bool solved = true;
+#ifndef PONCA_GPU_COMPILER
+    if (m_solverType == GENERAL_EIGEN_SOLVER)
+    {
+        MatrixBB M = Q.inverse() * m_matA;
+        Eigen::EigenSolver<MatrixBB> eig(M);
+        VectorB eivals = eig.eigenvalues().real();
+        int maxId = 0;
+        eivals.maxCoeff(&maxId);
 
-    VectorB eivec = eig.eigenvectors().col(maxId).real();
+        eivec = eig.eigenvectors().col(maxId).real();
+    }
+    else if (m_solverType == GENERALIZED_SELFADJOINT_SOLVER)
+    {
+        // the eigenvalues are sorted in increasing order, the eigenvectors normalized by Q
+        Eigen::GeneralizedSelfAdjointEigenSolver<MatrixBB> eig(m_matA, Q);
+        solved = eig.info() == Eigen::Success;
+        eivec  = eig.eigenvectors().col(Dim).normalized();
+    }
+    else
+#endif
+        solved = largestEigenvector(Q.inverse() * m_matA, eivec);
+
+    if (!solved)
+    {
+        Base::resetPrimitive();
+        Base::m_eCurrentState = UNDEFINED;
+        return Base::m_eCurrentState;
+    }
+    m_eigenvector = eivec;
 
     // integrate
     Base::m_ul = eivec.template head<Dim>();
@@ -155,6 +194,40 @@ UnorientedSphereFit<DataPoint, _WFunctor, T>::finalize ()
     return Base::m_eCurrentState;
 }
 
+template < class DataPoint, class _WFunctor, typename T>
+bool
+UnorientedSphereFit<DataPoint, _WFunctor, T>::largestEigenvector(const MatrixBB& _m, VectorB& _v) const
+{
+    PONCA_MULTIARCH_STD_MATH(abs);
+    const int maxIterations = 32;
+    const Scalar epsilon = Eigen::NumTraits<Scalar>::epsilon();
+
+    // start from the previous solution, or from the axis of largest variance of the normals for the first fit
+    if (m_eigenvector.isZero())
+    {
+        int axis = 0;
+        m_matA.diagonal().maxCoeff(&axis);
+        _v = VectorB::Unit(axis);
+    }
+    else
+        _v = m_eigenvector.normalized();
+
+    // the eigenvalues are real and positive: the iterations converge to the largest one, keeping the orientation
+    for (int i = 0; i < maxIterations; ++i)
+    {
+        VectorB next = _m * _v;
+        const Scalar norm = next.norm();
+        if (!(norm > Scalar(0.)))
+            return false;
+        next /= norm;
+        const Scalar dot = next.dot(_v);
+        _v = next;
+        if (Scalar(1.) - abs(dot) <= epsilon)
+            break;
+    }
+    return true;
+}
+
 #ifdef TOBEIMPLEMENTED
 
 namespace internal
@@ -194,10 +267,10 @@ OrientedSphereDer<DataPoint, _WFunctor, T, Type>::addNeighbor(const DataPoint  &
         VectorType q = _nei.pos() - Base::basisCenter();
 
         // compute weight
-        if (Type & FitScaleDer)
+        if constexpr (isScaleDer())
             w[0] = Base::m_w.scaledw(q, _nei);
 
-        if (Type & FitSpaceDer){
+        if constexpr (isSpaceDer()){
             VectorType vw = Base::m_w.spacedw(q, _nei);
             for(unsigned int i = 0; i < DataPoint::Dim; i++)
                 w[spaceId+i] = vw[i];
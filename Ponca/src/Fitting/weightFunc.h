@@ -8,8 +8,45 @@
 
 #include "./defines.h"
 
+#include <type_traits>
+#include <utility>
+
 namespace Ponca
 {
+namespace internal
+{
+    /*! \brief Tell if a weight kernel provides the squared variable functions `f2`, `df2` and `ddf2` */
+    template <class WeightKernel, typename = void>
+    struct HasSquaredKernel : std::false_type {};
+
+    template <class WeightKernel>
+    struct HasSquaredKernel<WeightKernel, decltype(void(std::declval<const WeightKernel&>().f2(typename WeightKernel::Scalar())),
+                                                   void(std::declval<const WeightKernel&>().df2(typename WeightKernel::Scalar())),
+                                                   void(std::declval<const WeightKernel&>().ddf2(typename WeightKernel::Scalar())))>
+        : std::true_type {};
+
+    /*! \brief Tell if a point provides a `weight()`, see Concept::WeightedPointConcept */
+    template <class DataPoint, typename = void>
+    struct HasPointWeight : std::false_type {};
+
+    template <class DataPoint>
+    struct HasPointWeight<DataPoint, decltype(void(std::declval<const DataPoint&>().weight()))> : std::true_type {};
+
+    /*!
+        \brief `_value` multiplied by the weight of `_p` when DataPoint is weighted, `_value` otherwise
+
+        Used by the weight functions: the weight of the points with no `weight()` costs nothing.
+    */
+    template <class DataPoint, typename T>
+    PONCA_MULTIARCH inline T pointWeighted(const DataPoint& _p, const T& _value)
+    {
+        if constexpr (HasPointWeight<DataPoint>::value)
+            return T(_value * typename DataPoint::Scalar(_p.weight()));
+        else
+            return _value;
+    }
+} // namespace internal
+
 /*!
     \brief Weighting function based on the euclidean distance between a query and a reference position
 
@@ -21,6 +58,12 @@ namespace Ponca
 
     \inherit Concept::WeightFuncConcept
 
+    When the kernel provides `f2`, `df2` and `ddf2` (see weightKernel.h), as the kernels of the library, the
+    weight and its derivatives are computed from the squared norm of the query, without square root.
+
+    When DataPoint provides a `weight()` (Concept::WeightedPointConcept, e.g. WeightedPoint), the weight and its
+    derivatives are multiplied by the weight of the point.
+
     \warning it assumes that the evaluation scale t is strictly positive
 
     \ingroup fitting
@@ -145,9 +188,57 @@ public:
     /*! \brief Access to the evaluation scale set during the initialization */
     PONCA_MULTIARCH inline Scalar evalScale() const { return m_t; }
 
+    /*!
+        \brief Use a precomputed squared norm of the queries instead of computing it from their coordinates
+
+        The squared norm is used by all the weight queries until #clearSquaredNorm is called, which allows to reuse
+        the squared distances computed by the spatial partitioning queries.
+        \see Basket::addNeighborWithSquaredDistance
+    */
+    PONCA_MULTIARCH inline void setSquaredNorm(const Scalar& _squaredNorm) { m_squaredNorm = _squaredNorm; }
+
+    /*!
+        \brief Use a precomputed weight, along with the squared norm it was computed from
+
+        #w returns `_weight`, which includes the weight of the point, until #clearSquaredNorm is called, which allows to share a single weight evaluation
+        between several fits using the same weight function.
+        \see BasketTuple
+    */
+    PONCA_MULTIARCH inline void setWeight(const Scalar& _squaredNorm, const Scalar& _weight)
+    {
+        m_squaredNorm = _squaredNorm;
+        m_weight      = _weight;
+    }
+
+    /*! \brief Compute the norm and the weight of the next queries from their coordinates again */
+    PONCA_MULTIARCH inline void clearSquaredNorm() { m_squaredNorm = Scalar(-1); m_weight = Scalar(-1); }
+
 protected:
+    /*! \brief Tag selecting the computations from the squared norm, when the kernel supports them */
+    typedef std::integral_constant<bool, internal::HasSquaredKernel<WeightKernel>::value> SquaredKernel;
+
+    /*! \brief Norm of the query, using the precomputed squared norm when available */
+    PONCA_MULTIARCH inline Scalar queryNorm(const VectorType& _q) const;
+    /*! \brief Squared norm of the query, using the precomputed squared norm when available */
+    PONCA_MULTIARCH inline Scalar querySquaredNorm(const VectorType& _q) const;
+
+    PONCA_MULTIARCH inline Scalar     w            (const VectorType& _q, std::true_type) const;
+    PONCA_MULTIARCH inline Scalar     w            (const VectorType& _q, std::false_type) const;
+    PONCA_MULTIARCH inline VectorType spacedw      (const VectorType& _q, std::true_type) const;
+    PONCA_MULTIARCH inline VectorType spacedw      (const VectorType& _q, std::false_type) const;
+    PONCA_MULTIARCH inline MatrixType spaced2w     (const VectorType& _q, std::true_type) const;
+    PONCA_MULTIARCH inline MatrixType spaced2w     (const VectorType& _q, std::false_type) const;
+    PONCA_MULTIARCH inline Scalar     scaledw      (const VectorType& _q, std::true_type) const;
+    PONCA_MULTIARCH inline Scalar     scaledw      (const VectorType& _q, std::false_type) const;
+    PONCA_MULTIARCH inline Scalar     scaled2w     (const VectorType& _q, std::true_type) const;
+    PONCA_MULTIARCH inline Scalar     scaled2w     (const VectorType& _q, std::false_type) const;
+    PONCA_MULTIARCH inline VectorType scaleSpaced2w(const VectorType& _q, std::true_type) const;
+    PONCA_MULTIARCH inline VectorType scaleSpaced2w(const VectorType& _q, std::false_type) const;
+
     Scalar       m_t;  /*!< \brief Evaluation scale */
     WeightKernel m_wk; /*!< \brief 1D function applied to weight queries */
+    Scalar       m_squaredNorm {-1}; /*!< \brief Precomputed squared norm of the queries, negative when unset */
+    Scalar       m_weight {-1};      /*!< \brief Precomputed weight of the queries, negative when unset */
 
 };// class DistWeightFunc
 
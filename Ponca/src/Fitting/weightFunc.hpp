@@ -1,38 +1,170 @@
 /*
  This Source Code Form is subject to the terms of the Mozilla Public
  License, v. 2.0. If a copy of the MPL was not distributed with this
- file, You can obtain one at http://mozilla.org/MPL/2.0/. 
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 
 
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::Scalar
+DistWeightFunc<DataPoint, WeightKernel>::queryNorm(const VectorType& _q) const
+{
+    PONCA_MULTIARCH_STD_MATH(sqrt);
+    return (m_squaredNorm >= Scalar(0.)) ? Scalar(sqrt(m_squaredNorm)) : _q.norm();
+}
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::Scalar
+DistWeightFunc<DataPoint, WeightKernel>::querySquaredNorm(const VectorType& _q) const
+{
+    return (m_squaredNorm >= Scalar(0.)) ? m_squaredNorm : _q.squaredNorm();
+}
 
 template <class DataPoint, class WeightKernel>
 typename DistWeightFunc<DataPoint, WeightKernel>::Scalar
-DistWeightFunc<DataPoint, WeightKernel>::w( const VectorType& _q, 
-					                        const DataPoint&) const
+DistWeightFunc<DataPoint, WeightKernel>::w( const VectorType& _q,
+					                        const DataPoint& _attributes) const
 {
-    Scalar d  = _q.norm();  
+    if (m_weight >= Scalar(0.)) return m_weight;
+    return internal::pointWeighted(_attributes, w(_q, SquaredKernel()));
+}
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::VectorType
+DistWeightFunc<DataPoint, WeightKernel>::spacedw(   const VectorType& _q,
+						                            const DataPoint& _attributes) const
+{
+    return internal::pointWeighted(_attributes, spacedw(_q, SquaredKernel()));
+}
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::MatrixType
+DistWeightFunc<DataPoint, WeightKernel>::spaced2w(   const VectorType& _q,
+                                                     const DataPoint& _attributes) const
+{
+    return internal::pointWeighted(_attributes, spaced2w(_q, SquaredKernel()));
+}
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::Scalar
+DistWeightFunc<DataPoint, WeightKernel>::scaledw(   const VectorType& _q,
+						                            const DataPoint& _attributes) const
+{
+    return internal::pointWeighted(_attributes, scaledw(_q, SquaredKernel()));
+}
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::Scalar
+DistWeightFunc<DataPoint, WeightKernel>::scaled2w(   const VectorType& _q,
+                                                     const DataPoint& _attributes) const
+{
+    return internal::pointWeighted(_attributes, scaled2w(_q, SquaredKernel()));
+}
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::VectorType
+DistWeightFunc<DataPoint, WeightKernel>::scaleSpaced2w(   const VectorType& _q,
+                                                          const DataPoint& _attributes) const
+{
+    return internal::pointWeighted(_attributes, scaleSpaced2w(_q, SquaredKernel()));
+}
+
+// Computations from the squared norm d2 of the query, with y = d2/t^2 the squared kernel variable
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::Scalar
+DistWeightFunc<DataPoint, WeightKernel>::w(const VectorType& _q, std::true_type) const
+{
+    Scalar d2 = querySquaredNorm(_q);
+    Scalar t2 = m_t*m_t;
+    return (d2 <= t2) ? m_wk.f2(d2/t2) : Scalar(0.);
+}
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::VectorType
+DistWeightFunc<DataPoint, WeightKernel>::spacedw(const VectorType& _q, std::true_type) const
+{
+    VectorType result = VectorType::Zero();
+    Scalar d2 = querySquaredNorm(_q);
+    Scalar t2 = m_t*m_t;
+    if (d2 <= t2 && d2 != Scalar(0.)) result = _q * (m_wk.df2(d2/t2) / t2);
+    return result;
+}
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::MatrixType
+DistWeightFunc<DataPoint, WeightKernel>::spaced2w(const VectorType& _q, std::true_type) const
+{
+    MatrixType result = MatrixType::Zero();
+    Scalar d2 = querySquaredNorm(_q);
+    Scalar t2 = m_t*m_t;
+    if (d2 <= t2 && d2 != Scalar(0.))
+    {
+        Scalar der = m_wk.df2(d2/t2);
+        result = _q*_q.transpose()*((m_wk.ddf2(d2/t2) - der)/d2);
+        result.diagonal().array() += der;
+        result *= Scalar(1.)/t2;
+    }
+    return result;
+}
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::Scalar
+DistWeightFunc<DataPoint, WeightKernel>::scaledw(const VectorType& _q, std::true_type) const
+{
+    Scalar d2 = querySquaredNorm(_q);
+    Scalar t2 = m_t*m_t;
+    return (d2 <= t2) ? Scalar( - d2*m_wk.df2(d2/t2)/(t2*m_t) ) : Scalar(0.);
+}
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::Scalar
+DistWeightFunc<DataPoint, WeightKernel>::scaled2w(const VectorType& _q, std::true_type) const
+{
+    Scalar d2 = querySquaredNorm(_q);
+    Scalar t2 = m_t*m_t;
+    return (d2 <= t2) ? Scalar(d2/(t2*t2)*(Scalar(2.)*m_wk.df2(d2/t2) + m_wk.ddf2(d2/t2))) :
+                        Scalar(0.);
+}
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::VectorType
+DistWeightFunc<DataPoint, WeightKernel>::scaleSpaced2w(const VectorType& _q, std::true_type) const
+{
+    VectorType result = VectorType::Zero();
+    Scalar d2 = querySquaredNorm(_q);
+    Scalar t2 = m_t*m_t;
+    if (d2 <= t2 && d2 != Scalar(0.))
+        result = -_q/(t2*m_t)*(m_wk.df2(d2/t2) + m_wk.ddf2(d2/t2));
+    return result;
+}
+
+// Computations from the norm d of the query, for the kernels only defined in x = d/t
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::Scalar
+DistWeightFunc<DataPoint, WeightKernel>::w(const VectorType& _q, std::false_type) const
+{
+    Scalar d  = queryNorm(_q);
     return (d <= m_t) ? m_wk.f(d/m_t) : Scalar(0.);
 }
 
 template <class DataPoint, class WeightKernel>
 typename DistWeightFunc<DataPoint, WeightKernel>::VectorType
-DistWeightFunc<DataPoint, WeightKernel>::spacedw(   const VectorType& _q, 
-						                            const DataPoint&) const
+DistWeightFunc<DataPoint, WeightKernel>::spacedw(const VectorType& _q, std::false_type) const
 {
     VectorType result = VectorType::Zero();
-    Scalar d = _q.norm();
+    Scalar d = queryNorm(_q);
     if (d <= m_t && d != Scalar(0.)) result = (_q / (d * m_t)) * m_wk.df(d/m_t);
     return result;
 }
 
 template <class DataPoint, class WeightKernel>
 typename DistWeightFunc<DataPoint, WeightKernel>::MatrixType
-DistWeightFunc<DataPoint, WeightKernel>::spaced2w(   const VectorType& _q,
-                                                     const DataPoint&) const
+DistWeightFunc<DataPoint, WeightKernel>::spaced2w(const VectorType& _q, std::false_type) const
 {
     MatrixType result = MatrixType::Zero();
-    Scalar d = _q.norm();
+    Scalar d = queryNorm(_q);
     if (d <= m_t && d != Scalar(0.))
     {
         Scalar der = m_wk.df(d/m_t);
@@ -45,19 +177,17 @@ DistWeightFunc<DataPoint, WeightKernel>::spaced2w(   const VectorType& _q,
 
 template <class DataPoint, class WeightKernel>
 typename DistWeightFunc<DataPoint, WeightKernel>::Scalar
-DistWeightFunc<DataPoint, WeightKernel>::scaledw(   const VectorType& _q, 
-						                            const DataPoint&) const
+DistWeightFunc<DataPoint, WeightKernel>::scaledw(const VectorType& _q, std::false_type) const
 {
-    Scalar d  = _q.norm();  
+    Scalar d  = queryNorm(_q);
     return (d <= m_t) ? Scalar( - d*m_wk.df(d/m_t)/(m_t*m_t) ) : Scalar(0.);
 }
 
 template <class DataPoint, class WeightKernel>
 typename DistWeightFunc<DataPoint, WeightKernel>::Scalar
-DistWeightFunc<DataPoint, WeightKernel>::scaled2w(   const VectorType& _q,
-                                                     const DataPoint&) const
+DistWeightFunc<DataPoint, WeightKernel>::scaled2w(const VectorType& _q, std::false_type) const
 {
-    Scalar d  = _q.norm();
+    Scalar d  = queryNorm(_q);
     return (d <= m_t) ? Scalar(Scalar(2.)*d/(m_t*m_t*m_t)*m_wk.df(d/m_t) +
                                d*d/(m_t*m_t*m_t*m_t)*m_wk.ddf(d/m_t)) :
                         Scalar(0.);
@@ -65,14 +195,11 @@ DistWeightFunc<DataPoint, WeightKernel>::scaled2w(   const VectorType& _q,
 
 template <class DataPoint, class WeightKernel>
 typename DistWeightFunc<DataPoint, WeightKernel>::VectorType
-DistWeightFunc<DataPoint, WeightKernel>::scaleSpaced2w(   const VectorType& _q,
-                                                          const DataPoint&) const
+DistWeightFunc<DataPoint, WeightKernel>::scaleSpaced2w(const VectorType& _q, std::false_type) const
 {
     VectorType result = VectorType::Zero();
-    Scalar d = _q.norm();
+    Scalar d = queryNorm(_q);
     if (d <= m_t && d != Scalar(0.))
         result = -_q/(m_t*m_t)*(m_wk.df(d/m_t)/d + m_wk.ddf(d/m_t)/m_t);
     return result;
 }
-
-
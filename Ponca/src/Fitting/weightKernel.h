@@ -8,8 +8,15 @@
 
 #include "./defines.h"
 
+#include <algorithm>
+#include <array>
+
 /*!
     \file weightKernel.h Define 1D weight kernel functors
+
+    A kernel may also provide `f2`, `df2` and `ddf2`, taking the squared variable \f$ y = x^2 \f$ and returning
+    respectively \f$ w(x) \f$, \f$ \frac{\nabla w(x)}{x} \f$ and \f$ \nabla^2 w(x) \f$. DistWeightFunc then
+    works with squared distances, without computing any square root.
 */
 
 
@@ -43,31 +50,260 @@ public:
     //! \brief Return \f$ 0 \f$
     PONCA_MULTIARCH inline Scalar ddf(const Scalar&) const { return Scalar(0.); }
 
+    //! \brief Return the constant value
+    PONCA_MULTIARCH inline Scalar f2  (const Scalar&) const { return m_y; }
+    //! \brief Return \f$ 0 \f$
+    PONCA_MULTIARCH inline Scalar df2 (const Scalar&) const { return Scalar(0.); }
+    //! \brief Return \f$ 0 \f$
+    PONCA_MULTIARCH inline Scalar ddf2(const Scalar&) const { return Scalar(0.); }
+
 private:
     Scalar m_y; /*!< \brief Constant value returned by the kernel */
 };// class ConstantWeightKernel
 
 
+namespace internal
+{
+    /*! \brief \f$ v^N \f$ by squaring, unrolled at compile time */
+    template <int N, typename Scalar>
+    PONCA_MULTIARCH inline Scalar integerPower(const Scalar& _v)
+    {
+        if constexpr (N == 0) return Scalar(1.);
+        else if constexpr (N == 1) return _v;
+        else
+        {
+            const Scalar h = integerPower<N/2, Scalar>(_v);
+            if constexpr (N % 2 == 0) return h*h;
+            else return h*h*_v;
+        }
+    }
+} // namespace internal
+
 /*!
-    \brief Smooth WeightKernel defined in \f$\left[0 : 1\right]\f$
-    \todo Add a degree value as template parameter (in this class or another one), with specialized functions for 2
+    \brief Smooth WeightKernel defined in \f$\left[0 : 1\right]\f$, \f$ w(x) = (1-x^2)^n \f$
+
+    The degree \f$ n \f$ sets the locality of the kernel: the higher the degree, the sharper the kernel and the
+    smoother its boundary, \f$ w \f$ being \f$ C^{n-1} \f$ at \f$ x = 1 \f$. The powers are unrolled at compile time,
+    so the default degree 2 costs a subtraction and a multiplication per weight.
 
+    \tparam _Degree Degree \f$ n \geq 2 \f$ of the kernel
     \inherit Concept::WeightKernelConcept
 */
-template <typename _Scalar>
+template <typename _Scalar, int _Degree = 2>
 class SmoothWeightKernel
 {
+    static_assert(_Degree >= 2, "The smooth kernel needs a degree of at least 2 to be twice differentiable");
+
 public:
     /*! \brief Scalar type defined outside the class*/
     typedef _Scalar Scalar;
+    /*! \brief Degree \f$ n \f$ of the kernel */
+    static constexpr int Degree = _Degree;
 
     // Functor
-    /*! \brief Defines the smooth weighting function \f$ w(x) = (x^2-1)^2 \f$ */
-    PONCA_MULTIARCH inline Scalar f  (const Scalar& _x) const { Scalar v = _x*_x - Scalar(1.); return v*v; }
-    /*! \brief Defines the smooth first order weighting function \f$ \nabla w(x) = 4x(x^2-1) \f$ */
-    PONCA_MULTIARCH inline Scalar df (const Scalar& _x) const { return Scalar(4.)*_x*(_x*_x-Scalar(1.)); }
-    /*! \brief Defines the smooth second order weighting function \f$ \nabla^2 w(x) = 12x^2-4 \f$ */
-    PONCA_MULTIARCH inline Scalar ddf(const Scalar& _x) const { return Scalar(12.)*_x*_x - Scalar(4.); }
+    /*! \brief Defines the smooth weighting function \f$ w(x) = (1-x^2)^n \f$ */
+    PONCA_MULTIARCH inline Scalar f  (const Scalar& _x) const { return f2(_x*_x); }
+    /*! \brief Defines the smooth first order weighting function \f$ \nabla w(x) = -2nx(1-x^2)^{n-1} \f$ */
+    PONCA_MULTIARCH inline Scalar df (const Scalar& _x) const { return _x*df2(_x*_x); }
+    /*! \brief Defines the smooth second order weighting function \f$ \nabla^2 w(x) = (1-x^2)^{n-2}(4n(n-1)x^2 - 2n(1-x^2)) \f$ */
+    PONCA_MULTIARCH inline Scalar ddf(const Scalar& _x) const { return ddf2(_x*_x); }
+
+    /*! \brief Smooth weighting function from \f$ y = x^2 \f$: \f$ w(x) = (1-y)^n \f$ */
+    PONCA_MULTIARCH inline Scalar f2  (const Scalar& _y) const { return internal::integerPower<Degree, Scalar>(Scalar(1.) - _y); }
+    /*! \brief Smooth first order weighting function divided by \f$ x \f$, from \f$ y = x^2 \f$: \f$ \frac{\nabla w(x)}{x} = -2n(1-y)^{n-1} \f$ */
+    PONCA_MULTIARCH inline Scalar df2 (const Scalar& _y) const { return -Scalar(c1)*internal::integerPower<Degree-1, Scalar>(Scalar(1.) - _y); }
+    /*! \brief Smooth second order weighting function from \f$ y = x^2 \f$: \f$ \nabla^2 w(x) = (1-y)^{n-2}(4n(n-1)y - 2n(1-y)) \f$ */
+    PONCA_MULTIARCH inline Scalar ddf2(const Scalar& _y) const
+    {
+        const Scalar v = Scalar(1.) - _y;
+        return internal::integerPower<Degree-2, Scalar>(v) * (Scalar(c2)*_y - Scalar(c1)*v);
+    }
+
+private:
+    static constexpr int c1 = 2*Degree;            /*!< \brief \f$ 2n \f$ */
+    static constexpr int c2 = 4*Degree*(Degree-1); /*!< \brief \f$ 4n(n-1) \f$ */
 };//class SmoothWeightKernel
 
+
+/*!
+    \brief Epanechnikov WeightKernel defined in \f$\left[0 : 1\right]\f$, \f$ w(x) = 1-x^2 \f$
+
+    \inherit Concept::WeightKernelConcept
+*/
+template <typename _Scalar>
+class EpanechnikovWeightKernel
+{
+public:
+    /*! \brief Scalar type defined outside the class*/
+    typedef _Scalar Scalar;
+
+    // Functor
+    /*! \brief Defines the weighting function \f$ w(x) = 1-x^2 \f$ */
+    PONCA_MULTIARCH inline Scalar f  (const Scalar& _x) const { return Scalar(1.) - _x*_x; }
+    /*! \brief Defines the first order weighting function \f$ \nabla w(x) = -2x \f$ */
+    PONCA_MULTIARCH inline Scalar df (const Scalar& _x) const { return Scalar(-2.)*_x; }
+    /*! \brief Defines the second order weighting function \f$ \nabla^2 w(x) = -2 \f$ */
+    PONCA_MULTIARCH inline Scalar ddf(const Scalar&) const { return Scalar(-2.); }
+
+    /*! \brief Weighting function from \f$ y = x^2 \f$: \f$ w(x) = 1-y \f$ */
+    PONCA_MULTIARCH inline Scalar f2  (const Scalar& _y) const { return Scalar(1.) - _y; }
+    /*! \brief First order weighting function divided by \f$ x \f$, from \f$ y = x^2 \f$: \f$ \frac{\nabla w(x)}{x} = -2 \f$ */
+    PONCA_MULTIARCH inline Scalar df2 (const Scalar&) const { return Scalar(-2.); }
+    /*! \brief Second order weighting function from \f$ y = x^2 \f$: \f$ \nabla^2 w(x) = -2 \f$ */
+    PONCA_MULTIARCH inline Scalar ddf2(const Scalar&) const { return Scalar(-2.); }
+};//class EpanechnikovWeightKernel
+
+
+/*!
+    \brief Wendland \f$ C^2 \f$ WeightKernel defined in \f$\left[0 : 1\right]\f$, \f$ w(x) = (1-x)^4(4x+1) \f$
+
+    The kernel and its first two derivatives vanish at \f$ x = 1 \f$. Being odd in \f$ x \f$, it has no squared
+    variable functions: DistWeightFunc computes the norm of the queries.
+
+    \inherit Concept::WeightKernelConcept
+*/
+template <typename _Scalar>
+class WendlandWeightKernel
+{
+public:
+    /*! \brief Scalar type defined outside the class*/
+    typedef _Scalar Scalar;
+
+    // Functor
+    /*! \brief Defines the weighting function \f$ w(x) = (1-x)^4(4x+1) \f$ */
+    PONCA_MULTIARCH inline Scalar f  (const Scalar& _x) const { Scalar v = Scalar(1.) - _x; v = v*v; return v*v*(Scalar(4.)*_x + Scalar(1.)); }
+    /*! \brief Defines the first order weighting function \f$ \nabla w(x) = -20x(1-x)^3 \f$ */
+    PONCA_MULTIARCH inline Scalar df (const Scalar& _x) const { Scalar v = Scalar(1.) - _x; return Scalar(-20.)*_x*v*v*v; }
+    /*! \brief Defines the second order weighting function \f$ \nabla^2 w(x) = 20(1-x)^2(4x-1) \f$ */
+    PONCA_MULTIARCH inline Scalar ddf(const Scalar& _x) const { Scalar v = Scalar(1.) - _x; return Scalar(20.)*v*v*(Scalar(4.)*_x - Scalar(1.)); }
+};//class WendlandWeightKernel
+
+
+/*!
+    \brief Gaussian WeightKernel \f$ w(x) = e^{-\frac{x^2}{2\sigma^2}} \f$, truncated to \f$\left[0 : 1\right]\f$
+
+    The truncation keeps the neighborhoods compact: with the default \f$ \sigma = \frac{1}{3} \f$, the weight at the
+    boundary of the support is \f$ e^{-4.5} \approx 0.011 \f$. Each weight costs an exponential, see
+    TabulatedWeightKernel to trade it for a table lookup.
+
+    \inherit Concept::WeightKernelConcept
+*/
+template <typename _Scalar>
+class GaussianWeightKernel
+{
+public:
+    /*! \brief Scalar type defined outside the class*/
+    typedef _Scalar Scalar;
+
+    // Init
+    //! \brief Default constructor that could be used to set the standard deviation, relative to the support
+    PONCA_MULTIARCH inline GaussianWeightKernel(const Scalar& _sigma = Scalar(1.)/Scalar(3.)) { setSigma(_sigma); }
+    //! \brief Set the standard deviation, relative to the support
+    PONCA_MULTIARCH inline void setSigma(const Scalar& _sigma) { m_a = Scalar(1.) / (_sigma*_sigma); }
+
+    // Functor
+    /*! \brief Defines the weighting function \f$ w(x) = e^{-\frac{x^2}{2\sigma^2}} \f$ */
+    PONCA_MULTIARCH inline Scalar f  (const Scalar& _x) const { return f2(_x*_x); }
+    /*! \brief Defines the first order weighting function \f$ \nabla w(x) = -\frac{x}{\sigma^2} w(x) \f$ */
+    PONCA_MULTIARCH inline Scalar df (const Scalar& _x) const { return _x*df2(_x*_x); }
+    /*! \brief Defines the second order weighting function \f$ \nabla^2 w(x) = \frac{1}{\sigma^2}(\frac{x^2}{\sigma^2}-1) w(x) \f$ */
+    PONCA_MULTIARCH inline Scalar ddf(const Scalar& _x) const { return ddf2(_x*_x); }
+
+    /*! \brief Weighting function from \f$ y = x^2 \f$: \f$ w(x) = e^{-\frac{y}{2\sigma^2}} \f$ */
+    PONCA_MULTIARCH inline Scalar f2  (const Scalar& _y) const { PONCA_MULTIARCH_STD_MATH(exp); return exp(Scalar(-0.5)*m_a*_y); }
+    /*! \brief First order weighting function divided by \f$ x \f$, from \f$ y = x^2 \f$: \f$ \frac{\nabla w(x)}{x} = -\frac{1}{\sigma^2} w(x) \f$ */
+    PONCA_MULTIARCH inline Scalar df2 (const Scalar& _y) const { return -m_a*f2(_y); }
+    /*! \brief Second order weighting function from \f$ y = x^2 \f$: \f$ \nabla^2 w(x) = \frac{1}{\sigma^2}(\frac{y}{\sigma^2}-1) w(x) \f$ */
+    PONCA_MULTIARCH inline Scalar ddf2(const Scalar& _y) const { return m_a*(m_a*_y - Scalar(1.))*f2(_y); }
+
+private:
+    Scalar m_a; /*!< \brief Inverse of the squared standard deviation */
+};//class GaussianWeightKernel
+
+
+/*!
+    \brief WeightKernel tabulating another kernel in \f$\left[0 : 1\right]\f$, to evaluate expensive kernels at the
+    cost of a table lookup
+
+    The table samples `Size` values of the squared variable \f$ y = x^2 \f$ in \f$\left[0 : 1\right]\f$, each one storing
+    \f$ w(x) \f$, \f$ \frac{\nabla w(x)}{x} \f$ and \f$ \nabla^2 w(x) \f$ of a default constructed `Kernel`. They are
+    linearly interpolated between the samples: DistWeightFunc evaluates the weight and its derivatives from the squared
+    distances, without square root nor call to the tabulated kernel. For the kernels that are smooth functions of
+    \f$ x^2 \f$, as the even ones (e.g. GaussianWeightKernel), the interpolation error decreases with the square of
+    `Size`.
+
+    The table is built once per kernel type, at its first use, and shared by all the instances, which only hold a
+    pointer to it.
+    \warning The table being static, this kernel is only available on the host.
+
+    \code
+    typedef DistWeightFunc<Point, TabulatedWeightKernel<GaussianWeightKernel<Scalar> > > WeightFunc;
+    \endcode
+
+    \tparam Kernel Tabulated kernel, providing `f`, `df` and `ddf`
+    \tparam Size Number of samples of the table
+    \inherit Concept::WeightKernelConcept
+*/
+template <typename Kernel, int Size = 1024>
+class TabulatedWeightKernel
+{
+    static_assert(Size >= 2, "At least two samples are needed to interpolate the kernel");
+
+public:
+    /*! \brief Scalar type of the tabulated kernel */
+    typedef typename Kernel::Scalar Scalar;
+
+    //! \brief Default constructor, building the table at the first use of the kernel type
+    inline TabulatedWeightKernel() : m_table(&table()) {}
+
+    // Functor
+    /*! \brief Interpolated weighting function \f$ w(x) \f$ */
+    inline Scalar f  (const Scalar& _x) const { return f2(_x*_x); }
+    /*! \brief Interpolated first order weighting function \f$ \nabla w(x) \f$ */
+    inline Scalar df (const Scalar& _x) const { return _x*df2(_x*_x); }
+    /*! \brief Interpolated second order weighting function \f$ \nabla^2 w(x) \f$ */
+    inline Scalar ddf(const Scalar& _x) const { return ddf2(_x*_x); }
+
+    /*! \brief Interpolated weighting function from \f$ y = x^2 \f$ */
+    inline Scalar f2  (const Scalar& _y) const { return lookup(_y, 0); }
+    /*! \brief Interpolated first order weighting function divided by \f$ x \f$, from \f$ y = x^2 \f$ */
+    inline Scalar df2 (const Scalar& _y) const { return lookup(_y, 1); }
+    /*! \brief Interpolated second order weighting function from \f$ y = x^2 \f$ */
+    inline Scalar ddf2(const Scalar& _y) const { return lookup(_y, 2); }
+
+private:
+    /*! \brief \f$ w(x) \f$, \f$ \frac{\nabla w(x)}{x} \f$ and \f$ \nabla^2 w(x) \f$ of each sample, interleaved */
+    typedef std::array<std::array<Scalar, 3>, Size> Table;
+
+    /*! \brief Table of the kernel type, built at the first call */
+    static inline const Table& table()
+    {
+        static const Table samples = []()
+        {
+            PONCA_MULTIARCH_STD_MATH(sqrt);
+            const Kernel kernel;
+            Table t;
+            for (int i = 0; i < Size; ++i)
+            {
+                const Scalar x = sqrt(Scalar(i) / Scalar(Size - 1));
+                // the limit of df(x)/x at 0 is ddf(0), the kernels being smooth and even
+                t[i] = {kernel.f(x), i == 0 ? kernel.ddf(x) : kernel.df(x) / x, kernel.ddf(x)};
+            }
+            return t;
+        }();
+        return samples;
+    }
+
+    /*! \brief Linear interpolation of the component `_c` of the samples at \f$ y \f$, clamped to \f$\left[0 : 1\right]\f$ */
+    inline Scalar lookup(const Scalar& _y, int _c) const
+    {
+        const Scalar u = std::min(std::max(_y, Scalar(0.)), Scalar(1.)) * Scalar(Size - 1);
+        const int i = std::min(int(u), Size - 2);
+        const Scalar a = u - Scalar(i);
+        return (*m_table)[i][_c] + a * ((*m_table)[i+1][_c] - (*m_table)[i][_c]);
+    }
+
+    const Table* m_table; /*!< \brief Shared table of the kernel type */
+};//class TabulatedWeightKernel
+
 }// namespace Ponca
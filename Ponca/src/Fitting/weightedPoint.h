@@ -0,0 +1,144 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./weightFunc.h"
+
+#include <Eigen/Core>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Ponca
+{
+/*!
+    \brief Point standing for several input points, e.g. duplicated samples, as a weighted DataPoint
+
+    Implements Concept::WeightedPointConcept: the weight functions multiply their weight by #weight, so that adding
+    a WeightedPoint of weight \f$ m \f$ to a fit adds \f$ m \f$ copies of the point to its weighted sums.
+    All the other properties are the ones of DataPoint.
+
+    \note The stability of the fits (see FIT_RESULT) counts the distinct neighbors, not their weights.
+
+    \see collapseDuplicates
+    \ingroup fitting
+*/
+template <class DataPoint>
+class WeightedPoint : public DataPoint
+{
+public:
+    /*! \brief Scalar type from DataPoint */
+    typedef typename DataPoint::Scalar Scalar;
+
+    PONCA_MULTIARCH inline WeightedPoint() : DataPoint(), m_weight(Scalar(1)) {}
+
+    PONCA_MULTIARCH inline WeightedPoint(const DataPoint& _p, const Scalar& _weight = Scalar(1))
+        : DataPoint(_p), m_weight(_weight) {}
+
+    /*! \brief Read access to the weight, the number of input points it stands for when built by collapseDuplicates */
+    PONCA_MULTIARCH inline const Scalar& weight() const { return m_weight; }
+    /*! \brief Write access to the weight */
+    PONCA_MULTIARCH inline       Scalar& weight()       { return m_weight; }
+
+private:
+    Scalar m_weight;
+};
+
+/*!
+    \brief Merge the points closer than `_epsilon` into weighted points
+
+    The points are visited in order: each point is merged into a weighted point closer than `_epsilon`, whose weight
+    is incremented by the weight of the point (1, or its `weight()` when weighted), or starts a new one.
+    The position and the other properties of a weighted point are the ones of the first point merged into it.
+
+    The overlaps of scans or the samples of a mesh shared by several faces give many nearly identical points: the
+    fits over the merged points give the same results as on the input, up to `_epsilon`, for a number of
+    neighbors, and a cost, reduced in proportion of the overlap.
+
+    The candidates are found in a hashed grid of cells of size `_epsilon`, visiting \f$ 3^{Dim} \f$ cells per point.
+
+    \param _points Container of DataPoint
+    \param _epsilon Merging distance, strictly positive
+    \param _representatives When not null, filled with the index of the weighted point of each input point
+    \return The weighted points, in the order of their first point
+
+    \ingroup fitting
+*/
+template <class PointContainer, class DataPoint = typename PointContainer::value_type>
+inline std::vector<WeightedPoint<DataPoint>> collapseDuplicates(const PointContainer& _points,
+                                                                typename DataPoint::Scalar _epsilon,
+                                                                std::vector<int>* _representatives = nullptr)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef Eigen::Matrix<std::int64_t, DataPoint::Dim, 1> CellType;
+    struct CellHash
+    {
+        std::size_t operator()(const CellType& _cell) const
+        {
+            std::size_t h = 0;
+            for (int i = 0; i < DataPoint::Dim; ++i)
+                h = h * std::size_t(0x9E3779B97F4A7C15ull) + std::size_t(_cell(i));
+            return h;
+        }
+    };
+
+    std::vector<WeightedPoint<DataPoint>> result;
+    std::unordered_map<CellType, std::vector<int>, CellHash> grid;
+    if (_representatives != nullptr)
+        _representatives->clear();
+
+    int neighborCells = 1;
+    for (int i = 0; i < DataPoint::Dim; ++i)
+        neighborCells *= 3;
+
+    const Scalar epsilon2 = _epsilon * _epsilon;
+    for (const DataPoint& p : _points)
+    {
+        CellType cell;
+        for (int i = 0; i < DataPoint::Dim; ++i)
+            cell(i) = std::int64_t(std::floor(p.pos()(i) / _epsilon));
+
+        // the weighted points closer than epsilon are in the adjacent cells
+        int merged = -1;
+        for (int c = 0; c < neighborCells && merged < 0; ++c)
+        {
+            CellType neighbor = cell;
+            for (int i = 0, code = c; i < DataPoint::Dim; ++i, code /= 3)
+                neighbor(i) += code % 3 - 1;
+            const auto it = grid.find(neighbor);
+            if (it == grid.end())
+                continue;
+            for (int j : it->second)
+            {
+                if ((result[j].pos() - p.pos()).squaredNorm() <= epsilon2)
+                {
+                    merged = j;
+                    break;
+                }
+            }
+        }
+
+        const Scalar weight = internal::pointWeighted(p, Scalar(1));
+        if (merged >= 0)
+            result[merged].weight() += weight;
+        else
+        {
+            merged = int(result.size());
+            result.push_back(WeightedPoint<DataPoint>(p, weight));
+            grid[cell].push_back(merged);
+        }
+        if (_representatives != nullptr)
+            _representatives->push_back(merged);
+    }
+    return result;
+}
+
+} // namespace Ponca
@@ -0,0 +1,103 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+/**
+  *
+  * \defgroup precompiled Precompiled module
+  * \brief Explicit instantiations of common Basket and KdTree types, compiled once in the Ponca::Precompiled
+  * library. See reference manual below.
+  * @{
+  * @}
+  *
+  */
+
+#include "../Fitting/basket.h"
+#include "../Fitting/covariancePlaneFit.h"
+#include "../Fitting/gls.h"
+#include "../Fitting/orientedSphereFit.h"
+#include "../Fitting/unorientedSphereFit.h"
+#include "../Fitting/weightFunc.h"
+#include "../Fitting/weightKernel.h"
+#include "../SpatialPartitioning/KdTree/kdTree.h"
+
+#include <Eigen/Core>
+
+namespace Ponca {
+namespace Precompiled {
+
+/// \addtogroup precompiled
+/// @{
+
+/// \brief 3D point with a position and a normal, the DataPoint of the precompiled types
+///
+/// Any other point type instantiates the templates in the translation units using them, as usual.
+template<typename _Scalar>
+class PointPositionNormal
+{
+public:
+    enum {Dim = 3};
+    typedef _Scalar Scalar;
+    typedef Eigen::Matrix<Scalar, Dim,   1> VectorType;
+    typedef Eigen::Matrix<Scalar, Dim, Dim> MatrixType;
+
+    PONCA_MULTIARCH inline PointPositionNormal(const VectorType& _pos    = VectorType::Zero(),
+                                               const VectorType& _normal = VectorType::Zero())
+        : m_pos(_pos), m_normal(_normal) {}
+
+    PONCA_MULTIARCH inline const VectorType& pos()    const { return m_pos; }
+    PONCA_MULTIARCH inline const VectorType& normal() const { return m_normal; }
+
+    PONCA_MULTIARCH inline VectorType& pos()    { return m_pos; }
+    PONCA_MULTIARCH inline VectorType& normal() { return m_normal; }
+
+private:
+    VectorType m_pos, m_normal;
+};
+
+template<typename Scalar> using Point      = PointPositionNormal<Scalar>;
+template<typename Scalar> using WeightFunc = DistWeightFunc<Point<Scalar>, SmoothWeightKernel<Scalar>>;
+
+template<typename Scalar> using OrientedSphereFit   = Basket<Point<Scalar>, WeightFunc<Scalar>, ::Ponca::OrientedSphereFit, GLSParam>;
+template<typename Scalar> using UnorientedSphereFit = Basket<Point<Scalar>, WeightFunc<Scalar>, ::Ponca::UnorientedSphereFit, GLSParam>;
+template<typename Scalar> using PlaneFit            = Basket<Point<Scalar>, WeightFunc<Scalar>, CovariancePlaneFit>;
+
+template<typename Scalar> using Tree = KdTree<Point<Scalar>>;
+
+/// @}
+
+} // namespace Precompiled
+
+// The layers of the Baskets are declared one by one: the explicit instantiation of a class does not instantiate its
+// base classes. The Forward layers of the unused extensions are empty.
+#define PONCA_PRECOMPILED_TYPES(PREFIX, S)                                                                           \
+    PREFIX class PrimitiveBase<Precompiled::Point<S>, Precompiled::WeightFunc<S>>;                                   \
+    PREFIX class AlgebraicSphere<Precompiled::Point<S>, Precompiled::WeightFunc<S>>;                                 \
+    PREFIX class OrientedSphereFit<Precompiled::Point<S>, Precompiled::WeightFunc<S>, void>;                         \
+    PREFIX class GLSParam<Precompiled::Point<S>, Precompiled::WeightFunc<S>,                                         \
+                          OrientedSphereFit<Precompiled::Point<S>, Precompiled::WeightFunc<S>, void>>;               \
+    PREFIX class Basket<Precompiled::Point<S>, Precompiled::WeightFunc<S>, OrientedSphereFit, GLSParam>;             \
+    PREFIX class UnorientedSphereFit<Precompiled::Point<S>, Precompiled::WeightFunc<S>, void>;                       \
+    PREFIX class GLSParam<Precompiled::Point<S>, Precompiled::WeightFunc<S>,                                         \
+                          UnorientedSphereFit<Precompiled::Point<S>, Precompiled::WeightFunc<S>, void>>;             \
+    PREFIX class Basket<Precompiled::Point<S>, Precompiled::WeightFunc<S>, UnorientedSphereFit, GLSParam>;           \
+    PREFIX class Plane<Precompiled::Point<S>, Precompiled::WeightFunc<S>>;                                           \
+    PREFIX class CovariancePlaneFit<Precompiled::Point<S>, Precompiled::WeightFunc<S>, void>;                        \
+    PREFIX class Basket<Precompiled::Point<S>, Precompiled::WeightFunc<S>, CovariancePlaneFit>;                      \
+    PREFIX class KdTree<Precompiled::Point<S>>;                                                                      \
+    PREFIX class KdTreeNearestIndexQuery<Precompiled::Point<S>>;                                                     \
+    PREFIX class KdTreeNearestPointQuery<Precompiled::Point<S>>;                                                     \
+    PREFIX class KdTreeKNearestIndexQuery<Precompiled::Point<S>>;                                                    \
+    PREFIX class KdTreeKNearestPointQuery<Precompiled::Point<S>>;                                                    \
+    PREFIX class KdTreeRangeIndexQuery<Precompiled::Point<S>>;                                                       \
+    PREFIX class KdTreeRangePointQuery<Precompiled::Point<S>>;
+
+// Instantiated once in the Ponca::Precompiled library (precompiled*.cpp) instead of in each translation unit
+PONCA_PRECOMPILED_TYPES(extern template, float)
+PONCA_PRECOMPILED_TYPES(extern template, double)
+
+} // namespace Ponca
@@ -0,0 +1,15 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+// Explicit instantiations of the float types declared by precompiled.h
+
+#include "./precompiled.h"
+
+namespace Ponca {
+
+PONCA_PRECOMPILED_TYPES(template, float)
+
+} // namespace Ponca
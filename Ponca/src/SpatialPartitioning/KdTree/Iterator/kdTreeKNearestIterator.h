@@ -9,24 +9,29 @@
 namespace Ponca {
 
 /// \ingroup spatialpartitioning
-template <class DataPoint>
+template <class DataPoint,
+          class QueueType = limited_priority_queue<IndexSquaredDistance<typename DataPoint::Scalar>>>
 class KdTreeKNearestIterator
 {
 public:
-    using Scalar   = typename DataPoint::Scalar;
-    using Iterator = typename limited_priority_queue<IndexSquaredDistance<Scalar>>::iterator;
+    using Scalar    = typename DataPoint::Scalar;
+    using Iterator  = typename QueueType::iterator;
+    using IndexType = typename QueueType::value_type::IndexType;
 
     inline KdTreeKNearestIterator() = default;
     inline KdTreeKNearestIterator(const Iterator& iterator) : m_iterator(iterator) {}
     virtual inline ~KdTreeKNearestIterator() = default;
 
 public:
-    inline bool operator !=(const KdTreeKNearestIterator<DataPoint>& other) const
+    inline bool operator !=(const KdTreeKNearestIterator<DataPoint, QueueType>& other) const
     {return m_iterator != other.m_iterator;}
     inline void operator ++() {++m_iterator;}
-    inline int  operator * () const {return m_iterator->index;}
+    inline IndexType operator * () const {return m_iterator->index;}
     inline void operator +=(int i) {m_iterator += i;}
 
+    /// \brief Squared distance between the current neighbor and the query input, computed by the query
+    inline Scalar squared_distance() const {return m_iterator->squared_distance;}
+
 protected:
     Iterator m_iterator;
 };
@@ -8,8 +8,9 @@
 
 namespace Ponca {
 
+/// \tparam Index Type of the indices of the neighbors, and of their positions in the indices of the tree
 /// \ingroup spatialpartitioning
-template<class DataPoint, class QueryT_>
+template<class DataPoint, class QueryT_, typename Index = int>
 class KdTreeRangeIterator
 {
 protected:
@@ -18,21 +19,26 @@ protected:
 public:
     using Scalar    = typename DataPoint::Scalar;
     using QueryType = QueryT_;
+    using IndexType = Index;
 
     inline KdTreeRangeIterator() = default;
-    inline KdTreeRangeIterator(QueryType* query, int index = -1) :
+    inline KdTreeRangeIterator(QueryType* query, Index index = -1) :
         m_query(query), m_index(index), m_start(0), m_end(0) {}
 
-    inline bool operator !=(const KdTreeRangeIterator<DataPoint,QueryType>& other) const
+    inline bool operator !=(const KdTreeRangeIterator& other) const
     {return m_index != other.m_index;}
     inline void operator ++(int) {m_query->advance(*this);}
-    inline KdTreeRangeIterator<DataPoint,QueryType>& operator++() {m_query->advance(*this); return *this;}
-    inline int operator *() const {return m_index;}
+    inline KdTreeRangeIterator& operator++() {m_query->advance(*this); return *this;}
+    inline Index operator *() const {return m_index;}
+
+    /// \brief Squared distance between the current neighbor and the query input, computed by the query
+    inline Scalar squared_distance() const {return m_squared_distance;}
 
 protected:
     QueryType* m_query {nullptr};
-    int m_index {-1};
-    int m_start {0};
-    int m_end {0};
+    Index m_index {-1};
+    Index m_start {0};
+    Index m_end {0};
+    Scalar m_squared_distance {0};
 };
 } // namespace ponca
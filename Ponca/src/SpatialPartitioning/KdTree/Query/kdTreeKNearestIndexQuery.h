@@ -12,24 +12,42 @@
 
 namespace Ponca {
 
-template<class DataPoint>
-class KdTreeKNearestIndexQuery : public KdTreeQuery<DataPoint>,
-    public KNearestIndexQuery<typename DataPoint::Scalar>
+/// \tparam QueueType Container of the neighbors, see QueryOutputIsKNearest
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>,
+          class QueueType = limited_priority_queue<IndexSquaredDistance<typename DataPoint::Scalar, typename NodeType::IndexType>>>
+class KdTreeKNearestIndexQuery : public KdTreeQuery<DataPoint, NodeType>,
+    public KNearestIndexQuery<typename DataPoint::Scalar, QueueType>
 {
 public:
     using Scalar          = typename DataPoint::Scalar;
     using VectorType      = typename DataPoint::VectorType;
-    using QueryType       = KNearestIndexQuery<typename DataPoint::Scalar>;
-    using QueryAccelType  = KdTreeQuery<DataPoint>;
+    using QueryType       = KNearestIndexQuery<typename DataPoint::Scalar, QueueType>;
+    using QueryAccelType  = KdTreeQuery<DataPoint, NodeType>;
+    using IndexType       = typename QueryType::IndexType;
 
-    KdTreeKNearestIndexQuery(const KdTree<DataPoint>* kdtree, int k, int index) :
-        KdTreeQuery<DataPoint>(kdtree), KNearestIndexQuery<Scalar>(k, index)
+    KdTreeKNearestIndexQuery(const KdTree<DataPoint, NodeType>* kdtree, int k, IndexType index) :
+        KdTreeQuery<DataPoint, NodeType>(kdtree), QueryType(k, index)
     {
     }
 
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline KdTreeKNearestIndexQuery& operator()(IndexType index)
+    {
+        QueryType::set_input(index);
+        return *this;
+    }
+
+    /// \brief Rebind the query to a new input and number of neighbors, and return it to iterate it again
+    inline KdTreeKNearestIndexQuery& operator()(IndexType index, int k)
+    {
+        QueryType::set_k(k);
+        return (*this)(index);
+    }
+
 public:
-    KdTreeKNearestIterator<DataPoint> begin();
-    KdTreeKNearestIterator<DataPoint> end();
+    KdTreeKNearestIterator<DataPoint, QueueType> begin();
+    KdTreeKNearestIterator<DataPoint, QueueType> end();
 
 protected:
     void search();
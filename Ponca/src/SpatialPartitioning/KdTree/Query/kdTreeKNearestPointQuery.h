@@ -12,23 +12,41 @@
 
 namespace Ponca {
 
-template <class DataPoint>
-class KdTreeKNearestPointQuery : public KNearestPointQuery<DataPoint>, public KdTreeQuery<DataPoint>
+/// \tparam QueueType Container of the neighbors, see QueryOutputIsKNearest
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>,
+          class QueueType = limited_priority_queue<IndexSquaredDistance<typename DataPoint::Scalar, typename NodeType::IndexType>>>
+class KdTreeKNearestPointQuery : public KNearestPointQuery<DataPoint, QueueType>, public KdTreeQuery<DataPoint, NodeType>
 {
 public:
     using Scalar          = typename DataPoint::Scalar;
     using VectorType      = typename DataPoint::VectorType;
-    using QueryType       = KNearestPointQuery<DataPoint>;
-    using QueryAccelType  = KdTreeQuery<DataPoint>;
+    using QueryType       = KNearestPointQuery<DataPoint, QueueType>;
+    using QueryAccelType  = KdTreeQuery<DataPoint, NodeType>;
+    using IndexType       = typename QueryType::IndexType;
 
-    KdTreeKNearestPointQuery(const KdTree<DataPoint>* kdtree, int k, const VectorType& point) :
-        KdTreeQuery<DataPoint>(kdtree), KNearestPointQuery<DataPoint>(k, point)
+    KdTreeKNearestPointQuery(const KdTree<DataPoint, NodeType>* kdtree, int k, const VectorType& point) :
+        KdTreeQuery<DataPoint, NodeType>(kdtree), QueryType(k, point)
     {
     }
 
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline KdTreeKNearestPointQuery& operator()(const VectorType& point)
+    {
+        QueryType::set_input(point);
+        return *this;
+    }
+
+    /// \brief Rebind the query to a new input and number of neighbors, and return it to iterate it again
+    inline KdTreeKNearestPointQuery& operator()(const VectorType& point, int k)
+    {
+        QueryType::set_k(k);
+        return (*this)(point);
+    }
+
 public:
-    KdTreeKNearestIterator<DataPoint> begin();
-    KdTreeKNearestIterator<DataPoint> end();
+    KdTreeKNearestIterator<DataPoint, QueueType> begin();
+    KdTreeKNearestIterator<DataPoint, QueueType> end();
 
 protected:
    void search();
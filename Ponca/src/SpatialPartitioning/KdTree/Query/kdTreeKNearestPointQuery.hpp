@@ -4,51 +4,75 @@
  file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 
-template <class DataPoint>
-KdTreeKNearestIterator<DataPoint> KdTreeKNearestPointQuery<DataPoint>::begin()
+template<class DataPoint, class NodeType, class QueueType>
+KdTreeKNearestIterator<DataPoint, QueueType> KdTreeKNearestPointQuery<DataPoint, NodeType, QueueType>::begin()
 {
     QueryAccelType::reset();
     QueryType::reset();
     this->search();
-    return KdTreeKNearestIterator<DataPoint>(QueryType::m_queue.begin());
+    QueryAccelType::count_results(QueryType::m_queue.size());
+    return KdTreeKNearestIterator<DataPoint, QueueType>(QueryType::m_queue.begin());
 }
 
-template <class DataPoint>
-KdTreeKNearestIterator<DataPoint> KdTreeKNearestPointQuery<DataPoint>::end()
+template<class DataPoint, class NodeType, class QueueType>
+KdTreeKNearestIterator<DataPoint, QueueType> KdTreeKNearestPointQuery<DataPoint, NodeType, QueueType>::end()
 {
-    return KdTreeKNearestIterator<DataPoint>(QueryType::m_queue.end());
+    return KdTreeKNearestIterator<DataPoint, QueueType>(QueryType::m_queue.end());
 }
 
-template <class DataPoint>
-void KdTreeKNearestPointQuery<DataPoint>::search()
+template<class DataPoint, class NodeType, class QueueType>
+void KdTreeKNearestPointQuery<DataPoint, NodeType, QueueType>::search()
 {
-    const auto& nodes   = QueryAccelType::m_kdtree->node_data();
-    const auto& points  = QueryAccelType::m_kdtree->point_data();
-    const auto& indices = QueryAccelType::m_kdtree->index_data();
+    const auto* nodes   = QueryAccelType::m_kdtree->node_buffer();
+    const auto* bounds  = QueryAccelType::m_kdtree->node_bounds_buffer();
+    const auto* indices = QueryAccelType::m_kdtree->index_buffer();
     const auto& point   = QueryType::input();
 
+    const auto collect = [this, &indices](IndexType i, Scalar d)
+    {
+        QueryType::m_queue.push({indices[i], d});
+    };
+
+    // squared distance under which the leaf scans look for neighbors
+    const auto bound = [this]() { return QueryType::m_queue.bottom().squared_distance; };
+
+    // descent to the leaf of the point, resumed from the previous path with warm start
+    QueryAccelType::descend(point);
+
+    if(QueryAccelType::m_traversal == KdTreeTraversal::BestFirst)
+    {
+        QueryAccelType::search_best_first(point,
+            [this]() { return QueryType::m_queue.bottom().squared_distance; }, collect);
+        return;
+    }
+
     while(!QueryAccelType::m_stack.empty())
     {
         auto& qnode = QueryAccelType::m_stack.top();
+        QueryAccelType::count_node();
         const auto& node  = nodes[qnode.index];
 
-        if(qnode.squared_distance < QueryType::m_queue.bottom().squared_distance)
+        if(qnode.squared_distance < QueryAccelType::pruning_distance(QueryType::m_queue.bottom().squared_distance))
         {
             if(node.leaf)
             {
+                QueryAccelType::prefetch_leaf(node);
+                // skip the leaf when its bounding box is farther than the current search distance
+                // qnode refers to the stack top, copy its index before popping it
+                const auto index = qnode.index;
+                const Scalar boxDistance = bounds[index].squaredExteriorDistance(point);
                 QueryAccelType::m_stack.pop();
-                int end = node.start + node.size;
-                for(int i=node.start; i<end; ++i)
-                {
-                    int idx = indices[i];
+                QueryAccelType::prefetch_top();
+                if(boxDistance >= QueryAccelType::pruning_distance(QueryType::m_queue.bottom().squared_distance)) continue;
+                QueryAccelType::visit_leaf(node);
 
-                    Scalar d = (point - points[idx].pos()).squaredNorm();
-                    QueryType::m_queue.push({idx, d});
-                }
+                QueryAccelType::m_kdtree->leaf_scan(node, point, collect, bound);
+                if(QueryAccelType::leaf_budget_reached()) return;
             }
             else
             {
                 // replace the stack top by the farthest and push the closest
+                QueryAccelType::prefetch_children(node);
                 Scalar newOff = point[node.dim] - node.splitValue;
                 QueryAccelType::m_stack.push();
                 if(newOff < 0)
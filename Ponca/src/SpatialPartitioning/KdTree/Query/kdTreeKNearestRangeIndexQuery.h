@@ -0,0 +1,61 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../kdTreeQuery.h"
+#include "../../query.h"
+#include "../Iterator/kdTreeKNearestIterator.h"
+
+namespace Ponca {
+
+/// \brief Search of the k nearest neighbors within a radius
+/// \see QueryOutputIsKNearestRange
+/// \tparam QueueType Container of the neighbors, see QueryOutputIsKNearest
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>,
+          class QueueType = limited_priority_queue<IndexSquaredDistance<typename DataPoint::Scalar, typename NodeType::IndexType>>>
+class KdTreeKNearestRangeIndexQuery : public KdTreeQuery<DataPoint, NodeType>,
+    public KNearestRangeIndexQuery<typename DataPoint::Scalar, QueueType>
+{
+public:
+    using Scalar          = typename DataPoint::Scalar;
+    using VectorType      = typename DataPoint::VectorType;
+    using QueryType       = KNearestRangeIndexQuery<typename DataPoint::Scalar, QueueType>;
+    using QueryAccelType  = KdTreeQuery<DataPoint, NodeType>;
+    using IndexType       = typename QueryType::IndexType;
+
+    KdTreeKNearestRangeIndexQuery(const KdTree<DataPoint, NodeType>* kdtree, int k, Scalar radius, IndexType index) :
+        KdTreeQuery<DataPoint, NodeType>(kdtree), QueryType(k, index)
+    {
+        QueryType::set_radius(radius);
+    }
+
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline KdTreeKNearestRangeIndexQuery& operator()(IndexType index)
+    {
+        QueryType::set_input(index);
+        return *this;
+    }
+
+    /// \brief Rebind the query to a new input, number of neighbors and radius, and return it to iterate it again
+    inline KdTreeKNearestRangeIndexQuery& operator()(IndexType index, int k, Scalar radius)
+    {
+        QueryType::set_k(k);
+        QueryType::set_radius(radius);
+        return (*this)(index);
+    }
+
+public:
+    KdTreeKNearestIterator<DataPoint, QueueType> begin();
+    KdTreeKNearestIterator<DataPoint, QueueType> end();
+
+protected:
+    void search();
+};
+
+#include "./kdTreeKNearestRangeIndexQuery.hpp"
+} // namespace ponca
@@ -0,0 +1,100 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+template<class DataPoint, class NodeType, class QueueType>
+KdTreeKNearestIterator<DataPoint, QueueType> KdTreeKNearestRangeIndexQuery<DataPoint, NodeType, QueueType>::begin()
+{
+    QueryAccelType::reset();
+    QueryType::reset();
+    this->search();
+    QueryType::finalize();
+    QueryAccelType::count_results(QueryType::m_queue.size());
+    return KdTreeKNearestIterator<DataPoint, QueueType>(QueryType::m_queue.begin());
+}
+
+template<class DataPoint, class NodeType, class QueueType>
+KdTreeKNearestIterator<DataPoint, QueueType> KdTreeKNearestRangeIndexQuery<DataPoint, NodeType, QueueType>::end()
+{
+    return KdTreeKNearestIterator<DataPoint, QueueType>(QueryType::m_queue.end());
+}
+
+template<class DataPoint, class NodeType, class QueueType>
+void KdTreeKNearestRangeIndexQuery<DataPoint, NodeType, QueueType>::search()
+{
+    const auto* nodes   = QueryAccelType::m_kdtree->node_buffer();
+    const auto* bounds  = QueryAccelType::m_kdtree->node_bounds_buffer();
+    const auto* indices = QueryAccelType::m_kdtree->index_buffer();
+    const auto& point   = QueryAccelType::m_kdtree->point(QueryType::input()).pos();
+
+    const auto collect = [this, &indices](IndexType i, Scalar d)
+    {
+        IndexType idx = indices[i];
+        if(QueryType::input() == idx || d >= QueryType::m_squared_radius) return;
+        QueryType::m_queue.push({idx, d});
+    };
+
+    // squared distance under which the leaf scans look for neighbors
+    const auto bound = [this]() { return std::min(QueryType::m_squared_radius, QueryType::m_queue.bottom().squared_distance); };
+
+    // descent to the leaf of the point, resumed from the previous path with warm start
+    QueryAccelType::descend(point);
+
+    if(QueryAccelType::m_traversal == KdTreeTraversal::BestFirst)
+    {
+        QueryAccelType::search_best_first(point,
+            [this]() { return QueryType::m_queue.bottom().squared_distance; }, collect);
+        return;
+    }
+
+    while(!QueryAccelType::m_stack.empty())
+    {
+        auto& qnode = QueryAccelType::m_stack.top();
+        QueryAccelType::count_node();
+        const auto& node  = nodes[qnode.index];
+
+        if(qnode.squared_distance < QueryAccelType::pruning_distance(QueryType::m_queue.bottom().squared_distance))
+        {
+            if(node.leaf)
+            {
+                QueryAccelType::prefetch_leaf(node);
+                // skip the leaf when its bounding box is farther than the current search distance
+                // qnode refers to the stack top, copy its index before popping it
+                const auto index = qnode.index;
+                const Scalar boxDistance = bounds[index].squaredExteriorDistance(point);
+                QueryAccelType::m_stack.pop();
+                QueryAccelType::prefetch_top();
+                if(boxDistance >= QueryAccelType::pruning_distance(QueryType::m_queue.bottom().squared_distance)) continue;
+                QueryAccelType::visit_leaf(node);
+
+                QueryAccelType::m_kdtree->leaf_scan(node, point, collect, bound);
+                if(QueryAccelType::leaf_budget_reached()) return;
+            }
+            else
+            {
+                // replace the stack top by the farthest and push the closest
+                QueryAccelType::prefetch_children(node);
+                Scalar newOff = point[node.dim] - node.splitValue;
+                QueryAccelType::m_stack.push();
+                if(newOff < 0)
+                {
+                    QueryAccelType::m_stack.top().index = node.firstChildId;
+                    qnode.index         = node.firstChildId+1;
+                }
+                else
+                {
+                    QueryAccelType::m_stack.top().index = node.firstChildId+1;
+                    qnode.index         = node.firstChildId;
+                }
+                QueryAccelType::m_stack.top().squared_distance = qnode.squared_distance;
+                qnode.squared_distance         = newOff*newOff;
+            }
+        }
+        else
+        {
+            QueryAccelType::m_stack.pop();
+        }
+    }
+}
\ No newline at end of file
@@ -12,23 +12,33 @@
 
 namespace Ponca {
 
-template <class DataPoint>
-class KdTreeNearestIndexQuery : public KdTreeQuery<DataPoint>, public NearestIndexQuery<typename DataPoint::Scalar>
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+class KdTreeNearestIndexQuery : public KdTreeQuery<DataPoint, NodeType>, public NearestIndexQuery<typename DataPoint::Scalar, typename NodeType::IndexType>
 {
 public:
     using Scalar          = typename DataPoint::Scalar;
     using VectorType      = typename DataPoint::VectorType;
-    using QueryType       = NearestIndexQuery<typename DataPoint::Scalar>;
-    using QueryAccelType  = KdTreeQuery<DataPoint>;
+    using IndexType       = typename NodeType::IndexType;
+    using QueryType       = NearestIndexQuery<typename DataPoint::Scalar, IndexType>;
+    using QueryAccelType  = KdTreeQuery<DataPoint, NodeType>;
+    using Iterator        = KdTreeNearestIterator<IndexType>;
 
-    KdTreeNearestIndexQuery(const KdTree<DataPoint>* kdtree, int index) :
-        KdTreeQuery<DataPoint>(kdtree), NearestIndexQuery<Scalar>(index)
+    KdTreeNearestIndexQuery(const KdTree<DataPoint, NodeType>* kdtree, IndexType index) :
+        KdTreeQuery<DataPoint, NodeType>(kdtree), QueryType(index)
     {
     }
 
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline KdTreeNearestIndexQuery& operator()(IndexType index)
+    {
+        QueryType::set_input(index);
+        return *this;
+    }
+
 public:
-    KdTreeNearestIterator begin();
-    KdTreeNearestIterator end();
+    Iterator begin();
+    Iterator end();
 
 protected:
     void search();
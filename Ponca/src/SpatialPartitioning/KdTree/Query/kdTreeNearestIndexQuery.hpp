@@ -4,59 +4,78 @@
  file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 
-template <class DataPoint>
-KdTreeNearestIterator KdTreeNearestIndexQuery<DataPoint>::begin()
+template <class DataPoint, class NodeType>
+typename KdTreeNearestIndexQuery<DataPoint, NodeType>::Iterator KdTreeNearestIndexQuery<DataPoint, NodeType>::begin()
 {
     QueryAccelType::reset();
     QueryType::reset();
     this->search();
-    return KdTreeNearestIterator(QueryType::m_nearest);
+    QueryAccelType::count_results(QueryType::m_nearest >= 0 ? 1 : 0);
+    return Iterator(QueryType::m_nearest);
 }
 
-template <class DataPoint>
-KdTreeNearestIterator KdTreeNearestIndexQuery<DataPoint>::end()
+template <class DataPoint, class NodeType>
+typename KdTreeNearestIndexQuery<DataPoint, NodeType>::Iterator KdTreeNearestIndexQuery<DataPoint, NodeType>::end()
 {
-    return KdTreeNearestIterator(QueryType::m_nearest + 1);
+    return Iterator(QueryType::m_nearest + 1);
 }
 
-template <class DataPoint>
-void KdTreeNearestIndexQuery<DataPoint>::search()
+template <class DataPoint, class NodeType>
+void KdTreeNearestIndexQuery<DataPoint, NodeType>::search()
 {
-    const auto& nodes   = QueryAccelType::m_kdtree->node_data();
-    const auto& points  = QueryAccelType::m_kdtree->point_data();
-    const auto& indices = QueryAccelType::m_kdtree->index_data();
-    const auto& point   = points[QueryType::input()].pos();
+    const auto* nodes   = QueryAccelType::m_kdtree->node_buffer();
+    const auto* bounds  = QueryAccelType::m_kdtree->node_bounds_buffer();
+    const auto* indices = QueryAccelType::m_kdtree->index_buffer();
+    const auto& point   = QueryAccelType::m_kdtree->point(QueryType::input()).pos();
 
-    if (nodes.empty() || points.empty() || indices.empty())
+    if (QueryAccelType::m_kdtree->node_count() == 0 || QueryAccelType::m_kdtree->point_count() == 0 ||
+        QueryAccelType::m_kdtree->index_count() == 0)
         throw std::invalid_argument("Empty KdTree");
 
+    const auto collect = [this, &indices](IndexType i, Scalar d)
+    {
+        IndexType idx = indices[i];
+        if(QueryType::input() == idx) return;
+        if(d < QueryType::m_squared_distance)
+        {
+            QueryType::m_nearest = idx;
+            QueryType::m_squared_distance = d;
+        }
+    };
+
+    // squared distance under which the leaf scans look for neighbors
+    const auto bound = [this]() { return QueryType::m_squared_distance; };
+
+    // descent to the leaf of the point, resumed from the previous path with warm start
+    QueryAccelType::descend(point);
+
     while(!QueryAccelType::m_stack.empty())
     {
         auto& qnode = QueryAccelType::m_stack.top();
+        QueryAccelType::count_node();
         const auto& node  = nodes[qnode.index];
 
-        if(qnode.squared_distance < QueryType::m_squared_distance)
+        if(qnode.squared_distance < QueryAccelType::pruning_distance(QueryType::m_squared_distance))
         {
             if(node.leaf)
             {
+                QueryAccelType::prefetch_leaf(node);
+                // skip the leaf when its bounding box is farther than the current search distance
+                // qnode refers to the stack top, copy its index before popping it
+                const auto index = qnode.index;
+                const Scalar boxDistance = bounds[index].squaredExteriorDistance(point);
                 QueryAccelType::m_stack.pop();
-                int end = node.start + node.size;
-                for(int i=node.start; i<end; ++i)
-                {
-                    int idx = indices[i];
-                    if(QueryType::input() == idx) continue;
+                QueryAccelType::prefetch_top();
+                if(boxDistance >= QueryAccelType::pruning_distance(QueryType::m_squared_distance)) continue;
+                QueryAccelType::visit_leaf(node);
 
-                    Scalar d = (point - points[idx].pos()).squaredNorm();
-                    if(d < QueryType::m_squared_distance)
-                    {
-                        QueryType::m_nearest = idx;
-                        QueryType::m_squared_distance = d;
-                    }
-                }
+                QueryAccelType::m_kdtree->leaf_scan(node, point, collect, bound);
+                if(QueryAccelType::leaf_budget_reached()) return;
             }
             else
             {
                 // replace the stack top by the farthest and push the closest
+                QueryAccelType::prefetch_children(node);
                 Scalar newOff = point[node.dim] - node.splitValue;
                 QueryAccelType::m_stack.push();
                 if(newOff < 0)
@@ -12,23 +12,33 @@
 
 namespace Ponca {
 
-template <class DataPoint>
-class KdTreeNearestPointQuery : public NearestPointQuery<DataPoint>, public KdTreeQuery<DataPoint>
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+class KdTreeNearestPointQuery : public NearestPointQuery<DataPoint, typename NodeType::IndexType>, public KdTreeQuery<DataPoint, NodeType>
 {
 public:
     using Scalar          = typename DataPoint::Scalar;
     using VectorType      = typename DataPoint::VectorType;
-    using QueryType       = NearestPointQuery<DataPoint>;
-    using QueryAccelType  = KdTreeQuery<DataPoint>;
+    using IndexType       = typename NodeType::IndexType;
+    using QueryType       = NearestPointQuery<DataPoint, IndexType>;
+    using QueryAccelType  = KdTreeQuery<DataPoint, NodeType>;
+    using Iterator        = KdTreeNearestIterator<IndexType>;
 
-    KdTreeNearestPointQuery(const KdTree<DataPoint>* kdtree, const VectorType& point) :
-        KdTreeQuery<DataPoint>(kdtree), NearestPointQuery<DataPoint>(point)
+    KdTreeNearestPointQuery(const KdTree<DataPoint, NodeType>* kdtree, const VectorType& point) :
+        KdTreeQuery<DataPoint, NodeType>(kdtree), QueryType(point)
     {
     }
 
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline KdTreeNearestPointQuery& operator()(const VectorType& point)
+    {
+        QueryType::set_input(point);
+        return *this;
+    }
+
 public:
-    KdTreeNearestIterator begin();
-    KdTreeNearestIterator end();
+    Iterator begin();
+    Iterator end();
 
 protected:
     void search();
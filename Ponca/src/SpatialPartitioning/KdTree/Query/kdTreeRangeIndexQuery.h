@@ -13,25 +13,41 @@
 namespace Ponca {
 
 
-template <class DataPoint>
-class KdTreeRangeIndexQuery : public KdTreeQuery<DataPoint>, public RangeIndexQuery<typename DataPoint::Scalar>
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+class KdTreeRangeIndexQuery : public KdTreeQuery<DataPoint, NodeType>, public RangeIndexQuery<typename DataPoint::Scalar, typename NodeType::IndexType>
 {
     using Scalar          = typename DataPoint::Scalar;
     using VectorType      = typename DataPoint::VectorType;
-    using QueryType       = RangeIndexQuery<typename DataPoint::Scalar>;
-    using QueryAccelType  = KdTreeQuery<DataPoint>;
-    using Iterator        = KdTreeRangeIterator<DataPoint, KdTreeRangeIndexQuery>;
+    using IndexType       = typename NodeType::IndexType;
+    using QueryType       = RangeIndexQuery<typename DataPoint::Scalar, IndexType>;
+    using QueryAccelType  = KdTreeQuery<DataPoint, NodeType>;
+    using Iterator        = KdTreeRangeIterator<DataPoint, KdTreeRangeIndexQuery, IndexType>;
 
 protected:
 	friend Iterator;
 
 public:
 
-    KdTreeRangeIndexQuery(const KdTree<DataPoint>* kdtree, Scalar radius, int index) :
-        KdTreeQuery<DataPoint>(kdtree), RangeIndexQuery<Scalar>(radius, index)
+    KdTreeRangeIndexQuery(const KdTree<DataPoint, NodeType>* kdtree, Scalar radius, IndexType index) :
+        KdTreeQuery<DataPoint, NodeType>(kdtree), QueryType(radius, index)
     {
     }
 
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline KdTreeRangeIndexQuery& operator()(IndexType index)
+    {
+        QueryType::set_input(index);
+        return *this;
+    }
+
+    /// \brief Rebind the query to a new input and radius, and return it to iterate it again
+    inline KdTreeRangeIndexQuery& operator()(IndexType index, Scalar radius)
+    {
+        QueryType::set_radius(radius);
+        return (*this)(index);
+    }
+
 public:
     inline Iterator begin();
     inline Iterator end();
@@ -12,15 +12,16 @@
 
 namespace Ponca {
 
-template <class DataPoint>
-class KdTreeRangePointQuery : public KdTreeQuery<DataPoint>, public RangePointQuery<DataPoint>
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+class KdTreeRangePointQuery : public KdTreeQuery<DataPoint, NodeType>, public RangePointQuery<DataPoint, typename NodeType::IndexType>
 {
 public:
     using Scalar          = typename DataPoint::Scalar;
     using VectorType      = typename DataPoint::VectorType;
-    using QueryType       = RangePointQuery<DataPoint>;
-    using QueryAccelType  = KdTreeQuery<DataPoint>;
-    using Iterator        = KdTreeRangeIterator<DataPoint, KdTreeRangePointQuery>;
+    using IndexType       = typename NodeType::IndexType;
+    using QueryType       = RangePointQuery<DataPoint, IndexType>;
+    using QueryAccelType  = KdTreeQuery<DataPoint, NodeType>;
+    using Iterator        = KdTreeRangeIterator<DataPoint, KdTreeRangePointQuery, IndexType>;
 
 
 protected:
@@ -28,11 +29,26 @@ protected:
 
 public:
 
-    inline KdTreeRangePointQuery(const KdTree<DataPoint>* kdtree, Scalar radius, const VectorType& point) :
-        KdTreeQuery<DataPoint>(kdtree), RangePointQuery<DataPoint>(radius, point)
+    inline KdTreeRangePointQuery(const KdTree<DataPoint, NodeType>* kdtree, Scalar radius, const VectorType& point) :
+        KdTreeQuery<DataPoint, NodeType>(kdtree), QueryType(radius, point)
     {
     }
 
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline KdTreeRangePointQuery& operator()(const VectorType& point)
+    {
+        QueryType::set_input(point);
+        return *this;
+    }
+
+    /// \brief Rebind the query to a new input and radius, and return it to iterate it again
+    inline KdTreeRangePointQuery& operator()(const VectorType& point, Scalar radius)
+    {
+        QueryType::set_radius(radius);
+        return (*this)(point);
+    }
+
 public:
     inline Iterator begin();
 	inline Iterator end();
@@ -4,8 +4,8 @@
  file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 
-template <class DataPoint>
-typename KdTreeRangePointQuery<DataPoint>::Iterator KdTreeRangePointQuery<DataPoint>::begin()
+template <class DataPoint, class NodeType>
+typename KdTreeRangePointQuery<DataPoint, NodeType>::Iterator KdTreeRangePointQuery<DataPoint, NodeType>::begin()
 {
     QueryAccelType::reset();
     QueryType::reset();
@@ -14,61 +14,66 @@ typename KdTreeRangePointQuery<DataPoint>::Iterator KdTreeRangePointQuery<DataPo
     return it;
 }
 
-template <class DataPoint>
-typename KdTreeRangePointQuery<DataPoint>::Iterator KdTreeRangePointQuery<DataPoint>::end()
+template <class DataPoint, class NodeType>
+typename KdTreeRangePointQuery<DataPoint, NodeType>::Iterator KdTreeRangePointQuery<DataPoint, NodeType>::end()
 {
     return Iterator(this, QueryAccelType::m_kdtree->point_count());
 }
 
-template <class DataPoint>
-void KdTreeRangePointQuery<DataPoint>::advance(Iterator& it)
+template <class DataPoint, class NodeType>
+void KdTreeRangePointQuery<DataPoint, NodeType>::advance(Iterator& it)
 {
-    const auto& nodes   = QueryAccelType::m_kdtree->node_data();
-    const auto& points  = QueryAccelType::m_kdtree->point_data();
-    const auto& indices = QueryAccelType::m_kdtree->index_data();
+    const auto* kdtree  = QueryAccelType::m_kdtree;
+    const auto* nodes   = kdtree->node_buffer();
+    const auto* bounds  = kdtree->node_bounds_buffer();
+    const auto* indices = kdtree->index_buffer();
     const auto& point   = QueryType::input();
 
-    for(int i=it.m_start; i<it.m_end; ++i)
+    IndexType i = kdtree->leaf_find_within(it.m_start, it.m_end, point, QueryType::m_squared_radius, &it.m_squared_distance);
+    if(i < it.m_end)
     {
-        int idx = indices[i];
-
-        Scalar d = (point - points[idx].pos()).squaredNorm();
-        if(d < QueryType::m_squared_radius)
-        {
-            it.m_index = idx;
-            it.m_start = i+1;
-            return;
-        }
+        it.m_index = indices[i];
+        it.m_start = i+1;
+        QueryAccelType::count_results(1);
+        return;
     }
 
     while(!QueryAccelType::m_stack.empty())
     {
         auto& qnode = QueryAccelType::m_stack.top();
+        QueryAccelType::count_node();
         const auto& node = nodes[qnode.index];
 
         if(qnode.squared_distance < QueryType::m_squared_radius)
         {
             if(node.leaf)
             {
+                QueryAccelType::prefetch_leaf(node);
+                // skip the leaf when its bounding box is farther than the current search distance
+                const Scalar boxDistance = bounds[qnode.index].squaredExteriorDistance(point);
                 QueryAccelType::m_stack.pop();
+                QueryAccelType::prefetch_top();
+                // the points of a duplicate leaf are all inside or all outside the ball
+                if(boxDistance >= QueryType::m_squared_radius ||
+                   (node.duplicates && kdtree->leaf_squared_distance(node.start, point) >= QueryType::m_squared_radius))
+                    continue;
+                QueryAccelType::visit_leaf(node);
+
                 it.m_start = node.start;
                 it.m_end   = node.start + node.size;
-                for(int i=it.m_start; i<it.m_end; ++i)
+                IndexType i = kdtree->leaf_find_within(it.m_start, it.m_end, point, QueryType::m_squared_radius, &it.m_squared_distance);
+                if(i < it.m_end)
                 {
-                    int idx = indices[i];
-
-                    Scalar d = (point - points[idx].pos()).squaredNorm();
-                    if(d < QueryType::m_squared_radius)
-                    {
-                        it.m_index = idx;
-                        it.m_start = i+1;
-                        return;
-                    }
+                    it.m_index = indices[i];
+                    it.m_start = i+1;
+                    QueryAccelType::count_results(1);
+                    return;
                 }
             }
             else
             {
                 // replace the stack top by the farthest and push the closest
+                QueryAccelType::prefetch_children(node);
                 Scalar newOff = point[node.dim] - node.splitValue;
                 QueryAccelType::m_stack.push();
                 if(newOff < 0)
@@ -90,5 +95,5 @@ void KdTreeRangePointQuery<DataPoint>::advance(Iterator& it)
             QueryAccelType::m_stack.pop();
         }
     }
-    it.m_index = static_cast<int>(points.size());
+    it.m_index = QueryAccelType::m_kdtree->point_count();
 }
@@ -0,0 +1,88 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../kdTreeQuery.h"
+#include "../../regions.h"
+#include "../Iterator/kdTreeRangeIterator.h"
+
+namespace Ponca {
+
+/// \brief Query collecting the points of the KdTree contained in a region
+///
+/// The traversal follows KdTreeRangePointQuery: the nodes whose bounding box is outside the region are pruned,
+/// and the points of the nodes inside the region are returned without being tested.
+/// \tparam Region Region type providing `contains(point)` and `classify(aabb)`, see BoxRegion, FrustumRegion,
+/// RayRegion and EllipsoidRegion
+/// \note KdTreeRangeIterator::squared_distance() is not defined for the region queries.
+/// \ingroup spatialpartitioning
+template <class DataPoint, class NodeType, class Region>
+class KdTreeRegionQuery : public KdTreeQuery<DataPoint, NodeType>
+{
+public:
+    using Scalar          = typename DataPoint::Scalar;
+    using VectorType      = typename DataPoint::VectorType;
+    using RegionType      = Region;
+    using IndexType       = typename NodeType::IndexType;
+    using QueryAccelType  = KdTreeQuery<DataPoint, NodeType>;
+    using Iterator        = KdTreeRangeIterator<DataPoint, KdTreeRegionQuery, IndexType>;
+
+protected:
+    friend Iterator;
+
+public:
+    inline KdTreeRegionQuery(const KdTree<DataPoint, NodeType>* kdtree, const RegionType& region) :
+        KdTreeQuery<DataPoint, NodeType>(kdtree), m_region(region)
+    {
+    }
+
+    inline const RegionType& region() const { return m_region; }
+
+    /// \brief Rebind the query to a new region, and return it to iterate it again
+    inline KdTreeRegionQuery& operator()(const RegionType& region)
+    {
+        m_region = region;
+        return *this;
+    }
+
+public:
+    inline Iterator begin();
+    inline Iterator end();
+
+protected:
+    inline void advance(Iterator& iterator);
+
+    RegionType m_region;
+    bool m_inside {false}; // the current index range is contained in the region
+};
+
+/// \brief Points of the KdTree contained in an axis-aligned or oriented box
+/// \see KdTree::box_neighbors
+/// \ingroup spatialpartitioning
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+using KdTreeBoxQuery = KdTreeRegionQuery<DataPoint, NodeType, BoxRegion<DataPoint>>;
+
+/// \brief Points of the KdTree contained in a frustum, or any convex intersection of half-spaces
+/// \see KdTree::frustum_neighbors
+/// \ingroup spatialpartitioning
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+using KdTreeFrustumQuery = KdTreeRegionQuery<DataPoint, NodeType, FrustumRegion<DataPoint>>;
+
+/// \brief Points of the KdTree contained in a cylinder around a ray
+/// \see KdTree::ray_neighbors
+/// \ingroup spatialpartitioning
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+using KdTreeRayQuery = KdTreeRegionQuery<DataPoint, NodeType, RayRegion<DataPoint>>;
+
+/// \brief Points of the KdTree contained in an ellipsoid, e.g. the support of an anisotropic weight function
+/// \see KdTree::ellipsoid_neighbors
+/// \ingroup spatialpartitioning
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+using KdTreeEllipsoidQuery = KdTreeRegionQuery<DataPoint, NodeType, EllipsoidRegion<DataPoint>>;
+
+#include "./kdTreeRegionQuery.hpp"
+} // namespace ponca
@@ -0,0 +1,81 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+template <class DataPoint, class NodeType, class Region>
+typename KdTreeRegionQuery<DataPoint, NodeType, Region>::Iterator KdTreeRegionQuery<DataPoint, NodeType, Region>::begin()
+{
+    QueryAccelType::reset();
+    m_inside = false;
+    Iterator it(this);
+    if(QueryAccelType::m_kdtree->node_count() == 0)
+        QueryAccelType::m_stack.clear();
+    this->advance(it);
+    return it;
+}
+
+template <class DataPoint, class NodeType, class Region>
+typename KdTreeRegionQuery<DataPoint, NodeType, Region>::Iterator KdTreeRegionQuery<DataPoint, NodeType, Region>::end()
+{
+    return Iterator(this, QueryAccelType::m_kdtree->point_count());
+}
+
+template <class DataPoint, class NodeType, class Region>
+void KdTreeRegionQuery<DataPoint, NodeType, Region>::advance(Iterator& it)
+{
+    const auto* kdtree  = QueryAccelType::m_kdtree;
+    const auto* nodes   = kdtree->node_buffer();
+    const auto* bounds  = kdtree->node_bounds_buffer();
+    const auto* indices = kdtree->index_buffer();
+
+    while(true)
+    {
+        for(; it.m_start < it.m_end; ++it.m_start)
+        {
+            // the free slots left between the leaves by DynamicKdTree hold -1
+            if(indices[it.m_start] < 0) continue;
+            if(m_inside || m_region.contains(kdtree->leaf_position(it.m_start)))
+            {
+                it.m_index = indices[it.m_start++];
+                QueryAccelType::count_results(1);
+                return;
+            }
+        }
+
+        if(QueryAccelType::m_stack.empty()) break;
+        const int index = QueryAccelType::m_stack.top().index;
+        QueryAccelType::m_stack.pop();
+        QueryAccelType::count_node();
+
+        const REGION_INTERSECTION position = m_region.classify(bounds[index]);
+        if(position == REGION_OUTSIDE) continue;
+
+        const auto& node = nodes[index];
+        if(node.leaf)
+        {
+            QueryAccelType::visit_leaf(node);
+            it.m_start = node.start;
+            it.m_end   = node.start + node.size;
+            m_inside   = position == REGION_INSIDE;
+        }
+        else if(position == REGION_INSIDE)
+        {
+            // the indices of a subtree are contiguous, between its leftmost and rightmost leaves, up to the free
+            // slots of DynamicKdTree skipped by the scan
+            int first = index, last = index;
+            while(!nodes[first].leaf) first = nodes[first].firstChildId;
+            while(!nodes[last].leaf)  last  = nodes[last].firstChildId + 1;
+            it.m_start = nodes[first].start;
+            it.m_end   = nodes[last].start + nodes[last].size;
+            m_inside   = true;
+        }
+        else
+        {
+            QueryAccelType::m_stack.push({int(node.firstChildId) + 1, 0});
+            QueryAccelType::m_stack.push({int(node.firstChildId), 0});
+        }
+    }
+    it.m_index = kdtree->point_count();
+}
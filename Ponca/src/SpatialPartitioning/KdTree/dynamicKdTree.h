@@ -0,0 +1,157 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./kdTree.h"
+
+namespace Ponca {
+
+/// \brief KdTree supporting the insertion and removal of points without rebuilding the whole tree
+///
+/// The tree keeps the layout of KdTree, so that all its queries are available with the same semantics.
+/// - Each leaf reserves free slots in index_data() (see set_slack()): a point is inserted in the free slot of its
+///   leaf, and the bounding boxes of the nodes on its path are extended.
+/// - A removed point is swapped out of its leaf and marked as removed (tombstone): the bounding boxes are not
+///   shrunk until the subtree is rebuilt, and its id is reused by the next insertions, so that the storage of a
+///   stream is bounded by its largest number of live points.
+/// - When the number of points of a subtree drifts from the number it was built with by more than
+///   rebuild_ratio(), or when a leaf runs out of free slots, the subtree is rebuilt in place (scapegoat
+///   style). Rebuilding the root rebuilds the whole tree, with new free slots.
+///
+/// Points are identified by the id returned by insert(), their index in point_data().
+/// \note The free slots of index_data() hold -1: only the ranges of the leaves are valid indices. The queries,
+/// to_string() and statistics() skip them, and valid() is overridden; save() is not available.
+/// \ingroup spatialpartitioning
+template<class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+class DynamicKdTree : public KdTree<DataPoint, NodeType>
+{
+public:
+    using Base           = KdTree<DataPoint, NodeType>;
+    using Scalar         = typename Base::Scalar;
+    using VectorType     = typename Base::VectorType;
+    using Aabb           = typename Base::Aabb;
+    using PointContainer = typename Base::PointContainer;
+    using IndexContainer = typename Base::IndexContainer;
+
+    inline DynamicKdTree() : Base() {}
+
+    template<typename PointUserContainer>
+    inline DynamicKdTree(const PointUserContainer& points) : Base()
+    {
+        this->build(points);
+    }
+
+    inline void clear();
+
+    template<typename PointUserContainer>
+    inline void build(const PointUserContainer& points);
+
+    /// \brief Build the tree over `points`, the points missing from `sampling` being considered as removed
+    template<typename PointUserContainer, typename IndexUserContainer>
+    inline void build(const PointUserContainer& points, const IndexUserContainer& sampling);
+
+    /// \brief Insert `point` in the tree
+    /// \return the id of the point, the id of a removed point when there is one
+    inline int insert(const DataPoint& point);
+
+    /// \brief Remove the point `id` from the tree
+    /// \return false when the point was already removed
+    inline bool remove(int id);
+
+    /// \brief Move the point `id` to `point`, keeping its id
+    ///
+    /// When the point stays in its leaf, e.g. for the small motions of the points of a stream from one frame to the
+    /// next, its position is updated in place and the bounding boxes of its path are extended, without
+    /// allocation. Otherwise it is moved to its new leaf, as a removal followed by an insertion.
+    /// \return false when the point was removed
+    inline bool move(int id, const DataPoint& point);
+
+    /// \brief Tell if the point `id` was removed from the tree
+    inline bool is_removed(int id) const { return m_removed[id]; }
+
+    /// \brief Number of points in the tree, i.e. point_count() minus the removed points
+    inline int live_count() const { return m_live_count; }
+
+    /// \brief Number of subtrees rebuilt since the last call to build(), including the whole tree
+    inline int rebuild_count() const { return m_rebuild_count; }
+
+    /// \brief Check the consistency of the tree: leaf ranges, free slots, point locations and bounds
+    inline bool valid() const;
+
+    // Parameters --------------------------------------------------------------
+public:
+    inline Scalar slack() const { return m_slack; }
+    /// \brief Free slots reserved at each (re)build, as a ratio of the number of points (0.5 by default)
+    ///
+    /// The free slots are distributed over the leaves proportionally to their size.
+    inline void set_slack(Scalar slack) { m_slack = slack; }
+
+    inline Scalar rebuild_ratio() const { return m_rebuild_ratio; }
+    /// \brief Relative drift of the size of a subtree triggering its rebuild (0.5 by default)
+    ///
+    /// A subtree built with `n` points is rebuilt when its size changes by more than
+    /// `rebuild_ratio() * max(n, min_cell_size())`.
+    inline void set_rebuild_ratio(Scalar rebuild_ratio) { m_rebuild_ratio = rebuild_ratio; }
+
+    // Internal ----------------------------------------------------------------
+protected:
+    /// \brief Rebuild the whole tree from the points that are not removed
+    inline void layout();
+    /// \brief Rebuild the subtree `node` in its range of index_data(), adding the point `pending` when not -1
+    inline void rebuild_subtree(int node, int pending = -1);
+    /// \brief Distribute the free slots of [first, first+capacity) over the leaves of the subtree `node`, whose
+    /// indices are stored contiguously from `first`, and update the bookkeeping of its nodes
+    inline void spread(int node, int first, int capacity);
+    /// \brief Update the counts, ranges and parents of the subtree `node` from its leaves
+    inline void update_rec(int node, int parent);
+    /// \brief Is the size of the subtree `node` too far from the size it was built with
+    inline bool drifted(int node) const;
+    /// \brief Rebuild the highest drifted node of `path`, ordered from the root
+    inline void rebalance(const std::vector<int>& path);
+    /// \brief Write the leaf ordered position of the slot `i`
+    inline void update_leaf_position(int i);
+    /// \brief Insert the point `id` of point_data() in its leaf, rebuilding a subtree when the leaf is full
+    inline void attach(int id);
+    /// \brief Remove the point `id` from its leaf, without rebalancing
+    /// \return the nodes from its leaf to the root
+    inline std::vector<int> detach(int id);
+
+    std::vector<bool> m_removed;    // tombstones, by point id
+    std::vector<int>  m_free_ids;   // removed ids, reused by insert()
+    std::vector<int>  m_point_leaf; // leaf containing each point, -1 when removed
+    std::vector<int>  m_point_slot; // position of each point in index_data(), -1 when removed
+
+    // per node bookkeeping, indexed as node_data()
+    std::vector<int> m_parent;
+    std::vector<int> m_live;     // number of points in the subtree
+    std::vector<int> m_built;    // number of points in the subtree when it was built
+    std::vector<int> m_first;    // first slot of the subtree in index_data()
+    std::vector<int> m_capacity; // number of slots of the subtree in index_data()
+
+    int m_live_count {0};
+    int m_garbage {0}; // nodes of the rebuilt subtrees, unreachable from the root
+    int m_rebuild_count {0};
+    Scalar m_slack {Scalar(0.5)};
+    Scalar m_rebuild_ratio {Scalar(0.5)};
+
+private:
+    // the trees are built from the points they own
+    using Base::build_view;
+    using Base::rebuild;
+    using Base::load;
+    using Base::load_view;
+    // the free slots of the indices are not valid in a file
+    using Base::save;
+    // the quantization blocks are not updated by the insertions and removals
+    using Base::set_use_quantized_positions;
+    // the rebuilt subtrees are appended to the nodes
+    using Base::set_node_layout;
+};
+
+#include "./dynamicKdTree.hpp"
+
+} // namespace Ponca
@@ -0,0 +1,517 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+// DynamicKdTree ---------------------------------------------------------------
+
+template<class DataPoint, class NodeType>
+void DynamicKdTree<DataPoint, NodeType>::clear()
+{
+	Base::clear();
+	m_removed.clear();
+	m_free_ids.clear();
+	m_point_leaf.clear();
+	m_point_slot.clear();
+	m_parent.clear();
+	m_live.clear();
+	m_built.clear();
+	m_first.clear();
+	m_capacity.clear();
+	m_live_count = 0;
+	m_garbage = 0;
+	m_rebuild_count = 0;
+}
+
+template<class DataPoint, class NodeType>
+template<typename PointUserContainer>
+void DynamicKdTree<DataPoint, NodeType>::build(const PointUserContainer& points)
+{
+	this->clear();
+
+	this->m_points = PointContainer(points);
+	m_removed.assign(this->m_points.size(), false);
+
+	this->layout();
+}
+
+template<class DataPoint, class NodeType>
+template<typename PointUserContainer, typename IndexUserContainer>
+void DynamicKdTree<DataPoint, NodeType>::build(const PointUserContainer& points, const IndexUserContainer& sampling)
+{
+	this->clear();
+
+	this->m_points = PointContainer(points);
+	m_removed.assign(this->m_points.size(), true);
+	for(int i : sampling)
+	    m_removed[i] = false;
+	// the smallest ids are reused first
+	for(int i=int(m_removed.size())-1; i>=0; --i)
+	{
+	    if(m_removed[i])
+	        m_free_ids.push_back(i);
+	}
+
+	this->layout();
+}
+
+template<class DataPoint, class NodeType>
+int DynamicKdTree<DataPoint, NodeType>::insert(const DataPoint& point)
+{
+	int id;
+	if(m_free_ids.empty())
+	{
+	    id = this->point_count();
+	    this->m_points.push_back(point);
+	    m_removed.push_back(false);
+	    m_point_leaf.push_back(-1);
+	    m_point_slot.push_back(-1);
+	}
+	else
+	{
+	    // the leaf and slot of a removed point are already -1
+	    id = m_free_ids.back();
+	    m_free_ids.pop_back();
+	    this->m_points[id] = point;
+	    m_removed[id] = false;
+	}
+	++m_live_count;
+
+	if(this->m_nodes.empty())
+	{
+	    this->layout();
+	    return id;
+	}
+
+	this->attach(id);
+	return id;
+}
+
+template<class DataPoint, class NodeType>
+bool DynamicKdTree<DataPoint, NodeType>::move(int id, const DataPoint& point)
+{
+	if(id < 0 || id >= this->point_count() || m_removed[id])
+	    return false;
+
+	const VectorType& p = point.pos();
+	int n = 0;
+	while(!this->m_nodes[n].leaf)
+	{
+	    const NodeType& node = this->m_nodes[n];
+	    n = node.firstChildId + (p[node.dim] < node.splitValue ? 0 : 1);
+	}
+	this->m_points[id] = point;
+
+	// the point stays in its leaf: extend the bounds up to the root, without allocation
+	if(n == m_point_leaf[id])
+	{
+	    for(int node = n; node >= 0; node = m_parent[node])
+	        this->m_node_bounds[node].extend(p);
+	    this->m_nodes[n].duplicates = false;
+	    this->update_leaf_position(m_point_slot[id]);
+	    return true;
+	}
+
+	this->detach(id);
+	this->attach(id);
+	return true;
+}
+
+template<class DataPoint, class NodeType>
+void DynamicKdTree<DataPoint, NodeType>::attach(int id)
+{
+	// descend to the leaf, extending the bounds on the way
+	const VectorType& p = this->m_points[id].pos();
+	std::vector<int> path;
+	int n = 0;
+	while(true)
+	{
+	    path.push_back(n);
+	    ++m_live[n];
+	    this->m_node_bounds[n].extend(p);
+	    const NodeType& node = this->m_nodes[n];
+	    if(node.leaf) break;
+	    n = node.firstChildId + (p[node.dim] < node.splitValue ? 0 : 1);
+	}
+
+	NodeType& leaf = this->m_nodes[n];
+	if(int(leaf.size) < m_capacity[n])
+	{
+	    const int slot = leaf.start + leaf.size;
+	    leaf.size = leaf.size + 1;
+	    leaf.duplicates = false;
+	    this->m_indices[slot] = id;
+	    m_point_leaf[id] = n;
+	    m_point_slot[id] = slot;
+	    this->update_leaf_position(slot);
+	    this->rebalance(path);
+	    return;
+	}
+
+	// the leaf is full: rebuild the highest drifted subtree, or the smallest one with a free slot
+	int target = -1;
+	for(int node : path)
+	{
+	    if(this->drifted(node)) { target = node; break; }
+	}
+	if(target < 0)
+	{
+	    target = n;
+	    while(target != 0 && m_capacity[target] < m_live[target])
+	        target = m_parent[target];
+	}
+	this->rebuild_subtree(target, id);
+}
+
+template<class DataPoint, class NodeType>
+bool DynamicKdTree<DataPoint, NodeType>::remove(int id)
+{
+	if(id < 0 || id >= this->point_count() || m_removed[id])
+	    return false;
+
+	m_removed[id] = true;
+	m_free_ids.push_back(id);
+	--m_live_count;
+
+	std::vector<int> path = this->detach(id);
+	std::reverse(path.begin(), path.end());
+	this->rebalance(path);
+	return true;
+}
+
+template<class DataPoint, class NodeType>
+std::vector<int> DynamicKdTree<DataPoint, NodeType>::detach(int id)
+{
+	// swap the point with the last one of its leaf
+	const int n = m_point_leaf[id];
+	NodeType& leaf = this->m_nodes[n];
+	const int slot = m_point_slot[id];
+	const int last = leaf.start + leaf.size - 1;
+	if(slot != last)
+	{
+	    const int moved = this->m_indices[last];
+	    this->m_indices[slot] = moved;
+	    m_point_slot[moved] = slot;
+	    this->update_leaf_position(slot);
+	}
+	this->m_indices[last] = -1;
+	leaf.size = leaf.size - 1;
+	leaf.duplicates = leaf.duplicates && leaf.size >= 2;
+	m_point_leaf[id] = -1;
+	m_point_slot[id] = -1;
+
+	std::vector<int> path;
+	for(int node = n; node >= 0; node = m_parent[node])
+	{
+	    --m_live[node];
+	    path.push_back(node);
+	}
+	return path;
+}
+
+template<class DataPoint, class NodeType>
+bool DynamicKdTree<DataPoint, NodeType>::drifted(int node) const
+{
+	const Scalar reference = Scalar(std::max(m_built[node], this->m_min_cell_size));
+	return Scalar(std::abs(m_live[node] - m_built[node])) > m_rebuild_ratio * reference;
+}
+
+template<class DataPoint, class NodeType>
+void DynamicKdTree<DataPoint, NodeType>::rebalance(const std::vector<int>& path)
+{
+	for(int node : path)
+	{
+	    if(this->drifted(node))
+	    {
+	        int target = node;
+	        while(target != 0 && m_capacity[target] < m_live[target])
+	            target = m_parent[target];
+	        this->rebuild_subtree(target);
+	        return;
+	    }
+	}
+}
+
+template<class DataPoint, class NodeType>
+void DynamicKdTree<DataPoint, NodeType>::layout()
+{
+	IndexContainer ids;
+	ids.reserve(m_live_count);
+	for(int i=0; i<int(m_removed.size()); ++i)
+	{
+	    if(!m_removed[i])
+	        ids.push_back(i);
+	}
+	m_live_count = static_cast<int>(ids.size());
+	m_point_leaf.assign(m_removed.size(), -1);
+	m_point_slot.assign(m_removed.size(), -1);
+	m_garbage = 0;
+	++m_rebuild_count;
+
+	// static build over the compact indices, then spread the free slots
+	this->clear_view();
+	this->m_nodes.clear();
+	this->m_indices = ids;
+	this->m_nodes.reserve(4 * m_live_count / this->m_min_cell_size);
+	this->build_root();
+
+	const int capacity = m_live_count + std::max(1, static_cast<int>(std::ceil(m_slack * Scalar(m_live_count))));
+	this->m_indices.resize(capacity, -1);
+	if(this->m_use_leaf_positions)
+	    this->m_leaf_positions.resize(capacity, DataPoint::Dim);
+	else
+	    this->m_leaf_positions.resize(0, DataPoint::Dim);
+
+	const std::size_t count = this->m_nodes.size();
+	m_parent.assign(count, -1);
+	m_live.assign(count, 0);
+	m_built.assign(count, 0);
+	m_first.assign(count, 0);
+	m_capacity.assign(count, 0);
+	this->spread(0, 0, capacity);
+
+	PONCA_DEBUG_ASSERT(this->valid());
+}
+
+template<class DataPoint, class NodeType>
+void DynamicKdTree<DataPoint, NodeType>::rebuild_subtree(int node, int pending)
+{
+	if(node == 0 || m_capacity[node] < m_live[node])
+	{
+	    this->layout();
+	    return;
+	}
+	++m_rebuild_count;
+
+	// gather the points of the subtree at the beginning of its range
+	IndexContainer ids;
+	ids.reserve(m_live[node]);
+	std::vector<int> stack {node};
+	while(!stack.empty())
+	{
+	    const int n = stack.back();
+	    stack.pop_back();
+	    const NodeType& current = this->m_nodes[n];
+	    if(n != node)
+	        ++m_garbage;
+	    if(current.leaf)
+	        ids.insert(ids.end(), this->m_indices.begin() + current.start, this->m_indices.begin() + current.start + current.size);
+	    else
+	    {
+	        stack.push_back(current.firstChildId + 1);
+	        stack.push_back(current.firstChildId);
+	    }
+	}
+	if(pending >= 0)
+	    ids.push_back(pending);
+
+	const int first = m_first[node], capacity = m_capacity[node], count = static_cast<int>(ids.size());
+	std::copy(ids.begin(), ids.end(), this->m_indices.begin() + first);
+	std::fill(this->m_indices.begin() + first + count, this->m_indices.begin() + first + capacity, -1);
+
+	int level = 1;
+	for(int n = node; n != 0; n = m_parent[n])
+	    ++level;
+
+	NodeType& root = this->m_nodes[node];
+	const Aabb aabb = this->compute_bounds(first, first + count);
+	const bool duplicates = this->is_duplicate_leaf(first, first + count);
+	if(count <= this->m_min_cell_size || level >= this->m_max_depth || duplicates)
+	{
+	    root.leaf  = true;
+	    root.duplicates = duplicates;
+	    root.start = first;
+	    root.size  = count;
+	    this->m_node_bounds[node] = aabb;
+	}
+	else
+	{
+	    root.leaf = false;
+	    root.duplicates = false;
+	    this->sort_morton(first, first + count, aabb);
+	    this->build_rec(this->m_nodes, this->m_node_bounds, node, first, first + count, level, aabb, false);
+	    this->clear_morton();
+	}
+
+	const std::size_t size = this->m_nodes.size();
+	m_parent.resize(size, -1);
+	m_live.resize(size, 0);
+	m_built.resize(size, 0);
+	m_first.resize(size, 0);
+	m_capacity.resize(size, 0);
+	this->spread(node, first, capacity);
+
+	// compact the nodes when the unreachable ones dominate, or overflow the node layout
+	if(m_garbage > int(size) / 2 || size > NodeType::MAX_COUNT)
+	    this->layout();
+}
+
+template<class DataPoint, class NodeType>
+void DynamicKdTree<DataPoint, NodeType>::spread(int node, int first, int capacity)
+{
+	// leaves of the subtree, in the order of their indices
+	std::vector<int> leaves;
+	std::vector<int> stack {node};
+	while(!stack.empty())
+	{
+	    const int n = stack.back();
+	    stack.pop_back();
+	    const NodeType& current = this->m_nodes[n];
+	    if(current.leaf)
+	        leaves.push_back(n);
+	    else
+	    {
+	        stack.push_back(current.firstChildId + 1);
+	        stack.push_back(current.firstChildId);
+	    }
+	}
+
+	// free slots proportional to the size of the leaves, plus one to let the empty leaves grow
+	const int leafCount = static_cast<int>(leaves.size());
+	long long live = 0;
+	for(int n : leaves)
+	    live += this->m_nodes[n].size;
+	const long long free   = capacity - live;
+	const long long weight = live + leafCount;
+	std::vector<int> starts(leafCount), capacities(leafCount);
+	long long start = first, distributed = 0;
+	for(int j=0; j<leafCount; ++j)
+	{
+	    const int size = this->m_nodes[leaves[j]].size;
+	    long long slack = free * (size + 1) / weight;
+	    if(j == leafCount-1)
+	        slack = free - distributed;
+	    distributed += slack;
+	    starts[j] = static_cast<int>(start);
+	    capacities[j] = static_cast<int>(size + slack);
+	    start += size + slack;
+	}
+
+	// move the leaves to their new start, from the last one since they only move forward
+	for(int j=leafCount-1; j>=0; --j)
+	{
+	    NodeType& leaf = this->m_nodes[leaves[j]];
+	    const int size = leaf.size;
+	    auto begin = this->m_indices.begin() + leaf.start;
+	    std::copy_backward(begin, begin + size, this->m_indices.begin() + starts[j] + size);
+	    std::fill(this->m_indices.begin() + starts[j] + size, this->m_indices.begin() + starts[j] + capacities[j], -1);
+	    leaf.start = starts[j];
+	    m_first[leaves[j]] = starts[j];
+	    m_capacity[leaves[j]] = capacities[j];
+	    for(int i=starts[j]; i<starts[j]+size; ++i)
+	    {
+	        const int id = this->m_indices[i];
+	        m_point_leaf[id] = leaves[j];
+	        m_point_slot[id] = i;
+	        this->update_leaf_position(i);
+	    }
+	}
+
+	this->update_rec(node, m_parent[node]);
+}
+
+template<class DataPoint, class NodeType>
+void DynamicKdTree<DataPoint, NodeType>::update_rec(int node, int parent)
+{
+	m_parent[node] = parent;
+	const NodeType& current = this->m_nodes[node];
+	if(current.leaf)
+	{
+	    m_live[node] = current.size;
+	}
+	else
+	{
+	    const int left = current.firstChildId, right = left + 1;
+	    this->update_rec(left, node);
+	    this->update_rec(right, node);
+	    m_live[node]     = m_live[left] + m_live[right];
+	    m_first[node]    = m_first[left];
+	    m_capacity[node] = m_capacity[left] + m_capacity[right];
+	}
+	m_built[node] = m_live[node];
+}
+
+template<class DataPoint, class NodeType>
+void DynamicKdTree<DataPoint, NodeType>::update_leaf_position(int i)
+{
+	if(this->m_leaf_positions.rows() != 0)
+	    this->m_leaf_positions.row(i) = this->point(this->m_indices[i]).pos().transpose();
+}
+
+template<class DataPoint, class NodeType>
+bool DynamicKdTree<DataPoint, NodeType>::valid() const
+{
+	if(this->m_nodes.empty())
+	    return m_live_count == 0;
+
+	const std::size_t count = this->m_nodes.size();
+	if(m_parent.size() != count || m_live.size() != count || m_built.size() != count ||
+	   m_first.size() != count || m_capacity.size() != count)
+	{
+	    PONCA_DEBUG_ERROR_MSG("node bookkeeping does not match the nodes");
+	    return false;
+	}
+
+	// each live point must be in exactly one leaf, at its recorded location
+	std::vector<bool> seen(this->point_count(), false);
+	int total = 0;
+	std::vector<int> stack {0};
+	while(!stack.empty())
+	{
+	    const int n = stack.back();
+	    stack.pop_back();
+	    const NodeType& node = this->m_nodes[n];
+	    if(node.leaf)
+	    {
+	        if(int(node.start) != m_first[n] || int(node.size) > m_capacity[n] || int(node.size) != m_live[n] ||
+	           m_first[n] + m_capacity[n] > int(this->m_indices.size()))
+	        {
+	            PONCA_DEBUG_ERROR_MSG("invalid leaf range");
+	            return false;
+	        }
+	        for(int i=node.start; i<int(node.start+node.size); ++i)
+	        {
+	            const int id = this->m_indices[i];
+	            if(id < 0 || id >= this->point_count() || seen[id] || m_removed[id] ||
+	               m_point_leaf[id] != n || m_point_slot[id] != i)
+	            {
+	                PONCA_DEBUG_ERROR_MSG("invalid, duplicated or misplaced index");
+	                return false;
+	            }
+	            if(!this->m_node_bounds[n].contains(this->point(id).pos()))
+	            {
+	                PONCA_DEBUG_ERROR_MSG("point outside of its leaf bounds");
+	                return false;
+	            }
+	            seen[id] = true;
+	            ++total;
+	        }
+	    }
+	    else
+	    {
+	        const int left = node.firstChildId, right = left + 1;
+	        if(m_parent[left] != n || m_parent[right] != n || m_live[n] != m_live[left] + m_live[right] ||
+	           m_first[right] != m_first[left] + m_capacity[left] || m_first[n] != m_first[left] ||
+	           m_capacity[n] != m_capacity[left] + m_capacity[right])
+	        {
+	            PONCA_DEBUG_ERROR_MSG("inconsistent node bookkeeping");
+	            return false;
+	        }
+	        if(!this->m_node_bounds[n].contains(this->m_node_bounds[left]) ||
+	           !this->m_node_bounds[n].contains(this->m_node_bounds[right]))
+	        {
+	            PONCA_DEBUG_ERROR_MSG("child bounds outside of the parent bounds");
+	            return false;
+	        }
+	        stack.push_back(right);
+	        stack.push_back(left);
+	    }
+	}
+	if(total != m_live_count)
+	{
+	    PONCA_DEBUG_ERROR_MSG("live points missing from the leaves");
+	    return false;
+	}
+	return true;
+}
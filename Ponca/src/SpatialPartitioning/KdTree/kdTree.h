@@ -7,6 +7,11 @@
 #pragma once
 
 #include "./kdTreeNode.h"
+#include "./kdTreeFile.h"
+#include "./kdTreeStatistics.h"
+#include "./kdTreeAutotune.h"
+#include "./kdTreeDeviceView.h"
+#include "../morton.h"
 
 #include <Eigen/Eigen>
 #include <Eigen/Geometry> // aabb
@@ -14,22 +19,94 @@
 #include <memory>
 #include <vector>
 #include <numeric>
+#include <algorithm>
+#include <iterator>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
 
 #include "../../Common/Assert.h"
+#include "../../Common/Tracing.h"
 
 #include "Query/kdTreeNearestPointQuery.h"
 #include "Query/kdTreeNearestIndexQuery.h"
 #include "Query/kdTreeKNearestPointQuery.h"
 #include "Query/kdTreeKNearestIndexQuery.h"
+#include "Query/kdTreeKNearestRangePointQuery.h"
+#include "Query/kdTreeKNearestRangeIndexQuery.h"
 #include "Query/kdTreeRangeIndexQuery.h"
 #include "Query/kdTreeRangePointQuery.h"
-
-#define PCA_KDTREE_MAX_DEPTH 32
+#include "Query/kdTreeRegionQuery.h"
+
+/// Number of leaf positions processed at once by the query kernels
+/// \see KdTree::leaf_squared_distances
+#ifndef PCA_KDTREE_LEAF_CHUNK_SIZE
+#define PCA_KDTREE_LEAF_CHUNK_SIZE 8
+#endif
+
+/// Number of consecutive leaf ordered points sharing a quantization frame
+/// \see KdTree::set_use_quantized_positions
+#ifndef PCA_KDTREE_QUANTIZATION_BLOCK_SIZE
+#define PCA_KDTREE_QUANTIZATION_BLOCK_SIZE 32
+#endif
+
+/// Minimal number of indices a subtree must contain to be built in a separate task
+/// \see KdTree::set_parallel_build
+#ifndef PCA_KDTREE_PARALLEL_MIN_SIZE
+#define PCA_KDTREE_PARALLEL_MIN_SIZE 8192
+#endif
 
 namespace Ponca {
 
+/// \brief Strategies used to split the KdTree nodes during construction
+/// \see KdTree::set_split_strategy
+/// \ingroup spatialpartitioning
+enum KDTREE_SPLIT_STRATEGY : unsigned char
+{
+    /*! \brief Split at the center of the largest extent of the node bounding box (default) */
+    SPLIT_MIDPOINT = 0,
+    /*! \brief Split at the median point along the largest extent, generating balanced trees */
+    SPLIT_MEDIAN = 1,
+    /*! \brief Same as SPLIT_MIDPOINT, but slide the split plane to the closest point when one of the
+      children would be empty */
+    SPLIT_SLIDING_MIDPOINT = 2,
+    /*! \brief Select the split position along the largest extent minimizing the surface area
+      heuristic \f$ n_l A(B_l) + n_r A(B_r) \f$, evaluated over a fixed number of bins */
+    SPLIT_SAH = 3,
+    /*! \brief Sort the points once along the Morton curve of the tree bounding box (parallel radix sort), then
+      split each node at the highest bit differing between the codes of its points. The splits need no
+      partition pass, which makes the build faster than with the other strategies */
+    SPLIT_MORTON = 4
+};
+
+/// \brief Order of the nodes of the KdTree in node_data(), the two children of a node being always adjacent
+/// \see KdTree::set_node_layout
+/// \ingroup spatialpartitioning
+enum KDTREE_NODE_LAYOUT : unsigned char
+{
+    /*! \brief Order in which the builder creates the nodes (default): the children of a node follow the
+      subtree of its previous sibling */
+    NODE_LAYOUT_DEPTH_FIRST = 0,
+    /*! \brief Level by level: the top levels of the tree are contiguous */
+    NODE_LAYOUT_BREADTH_FIRST = 1,
+    /*! \brief Van Emde Boas (cache-oblivious) order: the tree is cut at half its height, the top subtree being
+      stored first, followed by each bottom subtree, recursively. A query reading a path of the tree touches
+      \f$ O(\log_B n) \f$ cache lines of \f$ B \f$ nodes, whatever \f$ B \f$ */
+    NODE_LAYOUT_VAN_EMDE_BOAS = 2
+};
+
+/// \brief Kd-tree over a set of points
+///
+/// \tparam NodeType Layout of the nodes: KdTreeNode (default up to 4D) is compact but limits the size of the trees,
+/// KdTreeWideNode supports large point clouds, and KdTreeLargeNode more than 2^31 points. The node type gives the
+/// type of the indices of the points (IndexType), used by the tree and returned by its queries.
 /// \ingroup spatialpartitioning
-template<class DataPoint>
+template<class DataPoint, class NodeType>
 class KdTree
 {
 public:
@@ -38,24 +115,68 @@ public:
 
 	typedef typename Eigen::AlignedBox<Scalar, DataPoint::Dim> Aabb; // Intersections
 
+    static_assert(int(DataPoint::Dim) <= NodeType::MAX_DIM, "The node layout does not support the dimension of the points");
+
     typedef typename std::vector<DataPoint> PointContainer; // Container for VectorType used inside the KdTree
-    typedef typename std::vector<int> IndexContainer; // Container for indices used inside the KdTree
-    typedef typename std::vector<KdTreeNode<Scalar>> NodeContainer;  // Container for nodes used inside the KdTree
+    typedef typename NodeType::IndexType IndexType; // Type of the indices of the points: int, or std::int64_t for KdTreeLargeNode
+    typedef typename std::vector<IndexType> IndexContainer; // Container for indices used inside the KdTree
+    typedef typename std::vector<NodeType> NodeContainer;  // Container for nodes used inside the KdTree
+    typedef typename std::vector<Aabb, Eigen::aligned_allocator<Aabb>> AabbContainer; // Container for the bounding boxes of the nodes
+    typedef typename Eigen::Matrix<Scalar, Eigen::Dynamic, DataPoint::Dim> PositionContainer; // Positions stored in leaf order, one column per coordinate
+    typedef typename Eigen::Matrix<std::uint16_t, Eigen::Dynamic, DataPoint::Dim> QuantizedPositionContainer; // 16-bit positions stored in leaf order
 
     inline KdTree():
         m_points(PointContainer()),
+        m_point_view(nullptr),
+        m_point_view_count(0),
         m_nodes(NodeContainer()),
+        m_node_bounds(AabbContainer()),
         m_indices(IndexContainer()),
-        m_min_cell_size(64)
+        m_node_view(nullptr),
+        m_node_bounds_view(nullptr),
+        m_index_view(nullptr),
+        m_node_view_count(0),
+        m_index_view_count(0),
+        m_min_cell_size(64),
+        m_max_depth(PCA_KDTREE_MAX_DEPTH),
+        m_parallel_build(false),
+        m_split_strategy(SPLIT_MIDPOINT),
+        m_tight_bounds(true),
+        m_node_layout(NODE_LAYOUT_DEPTH_FIRST),
+        m_leaf_positions(),
+        m_use_leaf_positions(false),
+        m_quantized_positions(),
+        m_quantization_origins(),
+        m_quantization_steps(),
+        m_use_quantized_positions(false)
     {
     };
 
     template<typename PointUserContainer>
     inline KdTree(const PointUserContainer& points): // PointUserContainer => Given by user, transformed to PointContainer
         m_points(PointContainer()),
+        m_point_view(nullptr),
+        m_point_view_count(0),
         m_nodes(NodeContainer()),
+        m_node_bounds(AabbContainer()),
         m_indices(IndexContainer()),
-        m_min_cell_size(64)
+        m_node_view(nullptr),
+        m_node_bounds_view(nullptr),
+        m_index_view(nullptr),
+        m_node_view_count(0),
+        m_index_view_count(0),
+        m_min_cell_size(64),
+        m_max_depth(PCA_KDTREE_MAX_DEPTH),
+        m_parallel_build(false),
+        m_split_strategy(SPLIT_MIDPOINT),
+        m_tight_bounds(true),
+        m_node_layout(NODE_LAYOUT_DEPTH_FIRST),
+        m_leaf_positions(),
+        m_use_leaf_positions(false),
+        m_quantized_positions(),
+        m_quantization_origins(),
+        m_quantization_steps(),
+        m_use_quantized_positions(false)
     {
         this->build(points);
     };
@@ -64,15 +185,51 @@ public:
     inline KdTree(const PointUserContainer& points, const IndexUserContainer& sampling): // PointUserContainer => Given by user, transformed to PointContainer
                                                                                          // IndexUserContainer => Given by user, transformed to IndexContainer
         m_points(),
+        m_point_view(nullptr),
+        m_point_view_count(0),
         m_nodes(),
+        m_node_bounds(),
         m_indices(),
-        m_min_cell_size(64)
+        m_node_view(nullptr),
+        m_node_bounds_view(nullptr),
+        m_index_view(nullptr),
+        m_node_view_count(0),
+        m_index_view_count(0),
+        m_min_cell_size(64),
+        m_max_depth(PCA_KDTREE_MAX_DEPTH),
+        m_parallel_build(false),
+        m_split_strategy(SPLIT_MIDPOINT),
+        m_tight_bounds(true),
+        m_node_layout(NODE_LAYOUT_DEPTH_FIRST),
+        m_leaf_positions(),
+        m_use_leaf_positions(false),
+        m_quantized_positions(),
+        m_quantization_origins(),
+        m_quantization_steps(),
+        m_use_quantized_positions(false)
     {
         this->build(points, sampling);
     };
 
+    /// \brief Build the tree over `points`, adopting the vector instead of copying it
+    inline KdTree(PointContainer&& points): KdTree()
+    {
+        this->build(std::move(points));
+    };
+
+    /// \brief Build the tree over the points of `sampling`, adopting the vector `points` instead of copying it
+    template<typename IndexUserContainer>
+    inline KdTree(PointContainer&& points, const IndexUserContainer& sampling): KdTree()
+    {
+        this->build(std::move(points), sampling);
+    };
+
+    /// \brief Empty the tree, keeping the capacity of its containers (see shrink_to_fit())
     inline void clear();
 
+    /// \brief Release the capacity of the containers exceeding their size, kept by clear(), build() and rebuild()
+    inline void shrink_to_fit();
+
     template<typename PointUserContainer>
     inline void build(const PointUserContainer& points);  // PointUserContainer => Given by user, transformed to PointContainer
 
@@ -81,23 +238,95 @@ public:
     inline void build(const PointUserContainer& points, const IndexUserContainer& sampling); // PointUserContainer => Given by user, transformed to PointContainer
                                                                                              // IndexUserContainer => Given by user, transformed to IndexContainer
 
+    /// \brief Build the tree over `points`, adopting the vector instead of copying it
+    ///
+    /// The previous points of the tree are released. As for the other builds, the nodes and indices keep their
+    /// capacity: rebuilding a tree over a stream of point sets of bounded size does not allocate them again.
+    inline void build(PointContainer&& points);
+
+    template<typename IndexUserContainer>
+    inline void build(PointContainer&& points, const IndexUserContainer& sampling); // IndexUserContainer => Given by user, transformed to IndexContainer
+
+
+    /// \brief Build the tree over the `count` points of a user buffer, without copying them
+    ///
+    /// Only the nodes and indices are stored: the buffer must outlive the tree and remain unchanged while
+    /// it is used (or until the next call to build()). point_data() is empty in this mode, the points are
+    /// accessed by point() and point_buffer().
+    inline void build_view(const DataPoint* points, IndexType count);
+
+    template<typename IndexUserContainer>
+    inline void build_view(const DataPoint* points, IndexType count, const IndexUserContainer& sampling); // IndexUserContainer => Given by user, transformed to IndexContainer
 
     template<typename IndexUserContainer>
     inline void rebuild(const IndexUserContainer& sampling); // IndexUserContainer => Given by user, transformed to IndexContainer
 
 
+    /// \brief Check the consistency of the tree: indices, node children and leaf ranges
     inline bool valid() const;
     inline std::string to_string() const;
 
+    /// \brief Compute statistics on the structure of the tree
+    ///
+    /// When `query_count` is positive, the number of leaves scanned by the queries is measured by running
+    /// `query_count` k-nearest neighbors queries with `k` neighbors, from points evenly spread in the tree.
+    inline KdTreeStatistics statistics(int query_count = 0, int k = 16) const;
+
+    /// \brief Bytes allocated by the tree: points, nodes, indices and leaf scan acceleration data
+    ///
+    /// Used to size the memory of the workers holding trees, or of the device buffers they are uploaded to.
+    inline KdTreeMemoryUsage memory_usage() const;
+
+    // Serialization -----------------------------------------------------------
+public:
+    /// \brief Write the tree to `out`, in the binary format described by KdTreeFileHeader
+    ///
+    /// The points are stored when `with_points` is true, which requires DataPoint to be bitwise copyable.
+    /// \return false when writing fails
+    inline bool save(std::ostream& out, bool with_points = false) const;
+
+    /// \brief Read a tree written by save(), copying it into the containers of this tree
+    ///
+    /// When the file does not store the points, the tree uses the `count` points of the user buffer
+    /// `points` as with build_view().
+    /// \return false when the stream is not a valid file for this KdTree type, or when its nodes or indices are
+    /// out of bounds, the tree is then cleared
+    inline bool load(std::istream& in, const DataPoint* points = nullptr, IndexType count = 0);
+
+    /// \brief Use a tree written by save() directly from memory, without any copy nor deserialization
+    ///
+    /// `data` is typically a memory mapped file, it must be aligned on KdTreeFileHeader::Alignment bytes
+    /// (as are the pages returned by mmap) and outlive the tree. The tree is read-only: the containers
+    /// returned by node_data(), node_bounds() and index_data() are empty, use the `_buffer()` accessors
+    /// instead. Calling build() or rebuild() gives back the ownership of the nodes and indices.
+    /// \see load
+    inline bool load_view(const void* data, std::size_t size, const DataPoint* points = nullptr, IndexType count = 0);
+
+    /// \brief Tell if the nodes and indices are read from the memory given to load_view()
+    inline bool is_mapped() const;
+
     // Accessors ---------------------------------------------------------------
 public:
     inline int node_count() const;
-    inline int index_count() const;
-    inline int point_count() const;
+    inline IndexType index_count() const;
+    inline IndexType point_count() const;
+    /// \brief Tell if the tree was built by build_view() over a user buffer
+    inline bool is_view() const;
+
+    /// \brief Points used by the tree: point_data(), or the user buffer given to build_view()
+    inline const DataPoint* point_buffer() const
+    {
+        return m_point_view != nullptr ? m_point_view : m_points.data();
+    }
+
+    inline const DataPoint& point(IndexType i) const
+    {
+        return point_buffer()[i];
+    }
 
     inline PointContainer& point_data()
     {
-        return *m_points.get();
+        return m_points;
     };
 
     inline const PointContainer& point_data() const
@@ -122,9 +351,128 @@ public:
 
     inline NodeContainer& node_data()
     {
-        return *m_nodes.get();
+        return m_nodes;
+    }
+
+    /// \brief Nodes used by the tree: node_data(), or the memory given to load_view()
+    inline const NodeType* node_buffer() const
+    {
+        return m_node_view != nullptr ? m_node_view : m_nodes.data();
+    }
+
+    /// \brief Bounds used by the tree: node_bounds(), or the memory given to load_view()
+    inline const Aabb* node_bounds_buffer() const
+    {
+        return m_node_bounds_view != nullptr ? m_node_bounds_view : m_node_bounds.data();
+    }
+
+    /// \brief Indices used by the tree: index_data(), or the memory given to load_view()
+    inline const IndexType* index_buffer() const
+    {
+        return m_index_view != nullptr ? m_index_view : m_indices.data();
+    }
+
+    /// \brief Bounding boxes of the nodes, indexed as node_data()
+    /// \see set_tight_bounds
+    inline const AabbContainer& node_bounds() const
+    {
+        return m_node_bounds;
     }
 
+    /// \brief Copy of the positions in the order of index_data(), empty unless set_leaf_positions() is enabled
+    ///
+    /// Row `i` is the position of the point `index_data()[i]`: the points of each leaf are contiguous.
+    inline const PositionContainer& leaf_positions() const
+    {
+        return m_leaf_positions;
+    }
+
+    /// \brief Squared distance between `point` and the position of the point `index_data()[i]`
+    ///
+    /// Reads the leaf ordered copy of the positions when available, avoiding the indirection through the
+    /// indices.
+    inline Scalar leaf_squared_distance(IndexType i, const VectorType& point) const
+    {
+        if(m_leaf_positions.rows() != 0)
+            return (m_leaf_positions.row(i).transpose() - point).squaredNorm();
+        return (this->point(this->index_buffer()[i]).pos() - point).squaredNorm();
+    }
+
+    /// \brief Position of the point `index_data()[i]`, read from leaf_positions() when available
+    inline VectorType leaf_position(IndexType i) const
+    {
+        if(m_leaf_positions.rows() != 0)
+            return m_leaf_positions.row(i).transpose();
+        return this->point(this->index_buffer()[i]).pos();
+    }
+
+    /// \brief 16-bit copy of the positions in the order of index_data(), empty unless set_use_quantized_positions()
+    /// is enabled
+    ///
+    /// Row `i` stores the position of the point `index_data()[i]`, quantized in the bounding box of the block of
+    /// #PCA_KDTREE_QUANTIZATION_BLOCK_SIZE consecutive rows containing `i`.
+    inline const QuantizedPositionContainer& quantized_positions() const
+    {
+        return m_quantized_positions;
+    }
+
+    /// \brief Lower bound of leaf_squared_distance(i, point), read from quantized_positions()
+    inline Scalar quantized_squared_distance_bound(IndexType i, const VectorType& point) const;
+
+    /// \brief Prefetch the index and leaf position of the point `index_data()[i]`, see KdTreeQuery::set_prefetch
+    inline void prefetch_leaf(IndexType i) const
+    {
+#if PCA_KDTREE_PREFETCH
+        __builtin_prefetch(this->index_buffer() + i);
+        for(int d = 0; d < int(m_leaf_positions.cols()) && m_leaf_positions.rows() != 0; ++d)
+            __builtin_prefetch(m_leaf_positions.col(d).data() + i);
+#endif
+    }
+
+    /// \brief Compute the squared distances between `point` and the positions of the points
+    /// `index_data()[start, start+count)`, with `count <= PCA_KDTREE_LEAF_CHUNK_SIZE`
+    ///
+    /// With leaf_positions(), the distances are evaluated coordinate by coordinate on contiguous memory,
+    /// which Eigen vectorizes with the instruction set enabled at compile time (SSE, AVX, AVX512, NEON...).
+    inline void leaf_squared_distances(IndexType start, int count, const VectorType& point, Scalar* distances) const;
+
+    /// \brief Call `f(i, d)` for each `i` in [start,end), `d` being leaf_squared_distance(i, point)
+    ///
+    /// The distances are computed by chunks with leaf_squared_distances().
+    template<typename Functor>
+    inline void leaf_scan(IndexType start, IndexType end, const VectorType& point, Functor f) const;
+
+    /// \brief Same as leaf_scan(), skipping the points that are not closer than `bound()`
+    ///
+    /// With quantized_positions(), the points whose quantized_squared_distance_bound() is not smaller than
+    /// `bound()` are skipped without reading their position. Otherwise, calls `f` for all the points.
+    template<typename Functor, typename BoundFunctor>
+    inline void leaf_scan(IndexType start, IndexType end, const VectorType& point, Functor f, BoundFunctor bound) const;
+
+    /// \brief Same as leaf_scan(IndexType, IndexType, const VectorType&, Functor, BoundFunctor) const on the points of
+    /// `leaf`
+    ///
+    /// The points of a duplicate leaf (see KdTreeNode) share a single distance, computed once: the scan stops as soon
+    /// as `bound()` rejects it, so that the queries do not depend on the number of duplicates.
+    template<typename Functor, typename BoundFunctor>
+    inline void leaf_scan(const NodeType& leaf, const VectorType& point, Functor f, BoundFunctor bound) const;
+
+    /// \brief First `i` in [start,end) such that `leaf_squared_distance(i, point) < squared_radius`, or `end`
+    ///
+    /// When `squared_distance` is not null, it receives the squared distance of the returned index.
+    inline IndexType leaf_find_within(IndexType start, IndexType end, const VectorType& point, Scalar squared_radius,
+                                Scalar* squared_distance = nullptr) const;
+
+    /// \brief Id of the leaf node containing `point`, found by descending the splits from the root
+    inline int find_leaf(const VectorType& point) const;
+
+    /// \brief Order of the positions `points` following the leaves of the tree
+    ///
+    /// Consecutive queries in this order reach the same leaves and nodes, which keeps them in cache, and
+    /// benefits from KdTreeQuery::set_warm_start(). Used by the batched k-nearest neighbors queries.
+    template<typename VectorUserContainer>
+    inline IndexContainer leaf_order(const VectorUserContainer& points) const;
+
     inline const IndexContainer& index_data() const
     {
         return m_indices;
@@ -140,51 +488,412 @@ public:
     inline int min_cell_size() const;
     inline void set_min_cell_size(int min_cell_size);
 
+    /// \brief Select the min_cell_size() giving the fastest queries on the `count` points of `points`
+    ///
+    /// Trial trees are built over a sample of the points with each candidate leaf size, and the other parameters
+    /// of this tree (split strategy, leaf positions...). The query mix of `options` is timed on each tree, from
+    /// points of the sample, the radius of the range queries being scaled so that they find as many neighbors in
+    /// the sample as in the whole input. The best leaf size is set on this tree, to be used by the next build.
+    ///
+    /// The result depends on the machine. The leaf size is stored by save() and restored by load(): tune once,
+    /// and save the tree to reuse the decision.
+    inline KdTreeAutotuneResult autotune_min_cell_size(const DataPoint* points, IndexType count,
+                                                       const KdTreeAutotuneOptions& options = KdTreeAutotuneOptions());
+    /// \brief Same as autotune_min_cell_size(const DataPoint*, IndexType, const KdTreeAutotuneOptions&), for a contiguous
+    /// container of points
+    template<typename PointUserContainer>
+    inline KdTreeAutotuneResult autotune_min_cell_size(const PointUserContainer& points,
+                                                       const KdTreeAutotuneOptions& options = KdTreeAutotuneOptions())
+    {
+        return autotune_min_cell_size(points.data(), static_cast<IndexType>(points.size()), options);
+    }
+
+    inline int max_depth() const;
+    /// \brief Set the maximal depth of the next builds, clamped to [1, #PCA_KDTREE_MAX_DEPTH] (default)
+    ///
+    /// The nodes reaching this depth become leaves, whatever their size. The traversal stacks of the queries being
+    /// sized by #PCA_KDTREE_MAX_DEPTH, deeper trees require to define a larger #PCA_KDTREE_MAX_DEPTH.
+    /// \note The points sharing the same position are gathered in leaves of up to NodeType::MAX_LEAF_SIZE points,
+    /// whatever min_cell_size(): duplicated points do not deepen the trees.
+    inline void set_max_depth(int max_depth);
+
+    inline bool parallel_build() const;
+    /// \brief Build independent subtrees concurrently using OpenMP tasks
+    ///
+    /// The resulting nodes and indices are identical to the ones generated by the serial builder.
+    /// Only subtrees containing at least #PCA_KDTREE_PARALLEL_MIN_SIZE indices are forked.
+    /// \note Has no effect when compiled without OpenMP.
+    inline void set_parallel_build(bool parallel_build);
+
+    inline KDTREE_SPLIT_STRATEGY split_strategy() const;
+    /// \brief Set the strategy used to split the nodes, applied by the next call to build() or rebuild()
+    inline void set_split_strategy(KDTREE_SPLIT_STRATEGY split_strategy);
+
+    inline bool tight_bounds() const;
+    /// \brief Fit the bounding boxes of the leaves to their points (default), and propagate them to the
+    /// inner nodes
+    ///
+    /// The bounds used to split the nodes are always deduced from the parent bounds and split plane. When
+    /// enabled, a single pass over the points of each leaf also computes their tight bounding box, which
+    /// is used by the queries to skip leaves.
+    /// Otherwise node_bounds() stores the (looser) boxes used for the split.
+    inline void set_tight_bounds(bool tight_bounds);
+
+    inline KDTREE_NODE_LAYOUT node_layout() const;
+    /// \brief Set the order of the nodes in node_data() and node_bounds(), applied by the next call to build()
+    /// or rebuild()
+    ///
+    /// The nodes are permuted after the build and their child ids remapped: the queries are unchanged, only their
+    /// memory accesses differ. NODE_LAYOUT_VAN_EMDE_BOAS reduces the cache misses of the queries on large trees.
+    inline void set_node_layout(KDTREE_NODE_LAYOUT node_layout);
+
+    inline bool use_leaf_positions() const;
+    /// \brief Store a copy of the positions in leaf order, used by the queries to scan the leaves
+    ///
+    /// The positions are permuted into a structure of arrays (see leaf_positions()) after build() and
+    /// rebuild(), so that the leaf scans read contiguous memory instead of going through index_data().
+    /// This costs `Dim * index_count()` scalars.
+    /// \warning The copy is not updated when the points are modified through point_data().
+    inline void set_use_leaf_positions(bool use_leaf_positions);
+
+    inline bool use_quantized_positions() const;
+    /// \brief Store a 16-bit quantized copy of the positions in leaf order, used by the queries to skip points
+    ///
+    /// The positions are quantized in the bounding box of each block of #PCA_KDTREE_QUANTIZATION_BLOCK_SIZE
+    /// consecutive points of index_data() (see quantized_positions()) after build() and rebuild(). The leaf scans
+    /// read the quantized positions to bound the distances, and compute the exact distance of the points that may
+    /// be neighbors only. The results are the same as without quantization.
+    /// This costs `Dim * index_count()` 16-bit integers and two positions per block, about 3 times less memory than
+    /// leaf_positions() in double precision and 2 times less in single precision.
+    /// \warning The copy is not updated when the points are modified through point_data().
+    inline void set_use_quantized_positions(bool use_quantized_positions);
+
     // Internal ----------------------------------------------------------------
 public:
-    inline void build_rec(int node_id, int start, int end, int level);
-    inline int partition(int start, int end, int dim, Scalar value);
+    inline void build_rec(int node_id, IndexType start, IndexType end, int level);
+    /// \brief Build the subtree rooted at `nodes[node_id]` covering the indices [start,end) bounded by `aabb`
+    ///
+    /// When `parallel` is true, the right subtree is built in a separate task into its own node block,
+    /// which is then spliced after the left subtree so that the node layout matches the serial builder.
+    inline void build_rec(NodeContainer& nodes, AabbContainer& bounds, int node_id, IndexType start, IndexType end, int level,
+                          const Aabb& aabb, bool parallel);
+    inline IndexType partition(IndexType start, IndexType end, int dim, Scalar value);
+    /// \brief Select the split dimension and value of the indices [start,end) bounded by `aabb`, and
+    /// partition them accordingly
+    ///
+    /// When the midpoint or SAH split of `aabb` leaves all the points on one side, `aabb` is shrunk to the
+    /// bounds of the points and the split computed again.
+    /// \return the index of the first element of the right child
+    inline IndexType split(IndexType start, IndexType end, Aabb& aabb, int& dim, Scalar& value);
+
+protected:
+    inline IndexType split_median(IndexType start, IndexType end, int dim, Scalar& value);
+    inline IndexType split_sliding_midpoint(IndexType start, IndexType end, const Aabb& aabb, int dim, Scalar& value);
+    inline IndexType split_sah(IndexType start, IndexType end, const Aabb& aabb, int dim, Scalar& value);
+    inline IndexType split_morton(IndexType start, IndexType end, int& dim, Scalar& value);
+    /// \brief Sort the indices [start,end) along the Morton curve of `aabb` when using SPLIT_MORTON, before
+    /// building the subtree covering them
+    inline void sort_morton(IndexType start, IndexType end, const Aabb& aabb);
+    /// \brief Empty the Morton codes used by the build, keeping their capacity
+    inline void clear_morton();
+    /// \brief Empty the nodes and views before a build, keeping the capacity of the containers
+    inline void reset();
+
+    /// \brief Clear the tree and throw std::length_error when it does not fit in the node layout
+    inline void check_node_limits();
+    /// \brief Build the nodes and leaf_positions() from the current indices
+    inline void build_indices();
+    /// \brief Build the tree from the current indices, starting from a single root node
+    inline void build_root();
+    /// \brief Permute the nodes following node_layout()
+    inline void layout_nodes();
+    /// \brief Append the nodes of `block` built for the subtree rooted at `nodes[node_id]`
+    inline static void splice(NodeContainer& nodes, AabbContainer& bounds, int node_id,
+                              const NodeContainer& block, const AabbContainer& blockBounds);
+    /// \brief Check if the indices [start,end) hold at least two points, all at the same position
+    inline bool same_positions(IndexType start, IndexType end) const;
+    /// \brief Check if the indices [start,end) can be stored in a duplicate leaf
+    inline bool is_duplicate_leaf(IndexType start, IndexType end) const;
+    /// \brief Tight bounding box of the indices [start,end)
+    inline Aabb compute_bounds(IndexType start, IndexType end) const;
+    /// \brief Fill leaf_positions() and quantized_positions() from the current indices, or clear them when
+    /// disabled
+    inline void build_leaf_positions();
+    /// \brief Check that `header` describes a file readable as this KdTree type, holding `size` bytes
+    inline static bool check_header(const KdTreeFileHeader& header, std::size_t size);
+    /// \brief Check that the nodes and indices read by load() or load_view() can be traversed by the queries
+    ///
+    /// Walks the nodes once from the root: each node is reached once, the child ids and leaf ranges stay in the
+    /// buffers, the depth fits in the traversal stacks, and the indices refer to existing points.
+    inline bool check_nodes() const;
+    /// \brief Release the memory given to load_view()
+    inline void clear_view();
 
 
 	// Query -------------------------------------------------------------------
 public :
-    KdTreeKNearestPointQuery<DataPoint> k_nearest_neighbors(const VectorType& point, int k) const
+    /// \brief Flat view of the buffers of the tree, queried by PONCA_MULTIARCH functions
+    ///
+    /// The view points to the host buffers of the tree: see KdTreeDeviceBuffers to query the tree from CUDA kernels.
+    /// It is invalidated by the next build.
+    inline KdTreeDeviceView<DataPoint, NodeType> device_view() const
+    {
+        KdTreeDeviceView<DataPoint, NodeType> view;
+        view.points      = point_buffer();
+        view.nodes       = node_buffer();
+        view.indices     = index_buffer();
+        view.point_count = point_count();
+        view.node_count  = node_count();
+        return view;
+    }
+
+    KdTreeKNearestPointQuery<DataPoint, NodeType> k_nearest_neighbors(const VectorType& point, int k) const
+    {
+        return KdTreeKNearestPointQuery<DataPoint, NodeType>(this, k, point);
+    }
+
+    KdTreeKNearestIndexQuery<DataPoint, NodeType> k_nearest_neighbors(IndexType index, int k) const
+    {
+        return KdTreeKNearestIndexQuery<DataPoint, NodeType>(this, k, index);
+    }
+
+    /// \brief Approximate k-nearest neighbors of `point`, see KdTreeQuery::set_epsilon and
+    /// KdTreeQuery::set_max_leaf_visits. The number of leaves actually scanned is given by
+    /// KdTreeQuery::leaf_visits() after the iteration.
+    KdTreeKNearestPointQuery<DataPoint, NodeType> k_nearest_neighbors(const VectorType& point, int k, Scalar epsilon,
+                                                                      int max_leaf_visits = std::numeric_limits<int>::max()) const
+    {
+        KdTreeKNearestPointQuery<DataPoint, NodeType> query(this, k, point);
+        query.set_epsilon(epsilon);
+        query.set_max_leaf_visits(max_leaf_visits);
+        return query;
+    }
+
+    /// \brief Approximate k-nearest neighbors of the point `index`
+    /// \see k_nearest_neighbors(const VectorType&, int, Scalar, int)
+    KdTreeKNearestIndexQuery<DataPoint, NodeType> k_nearest_neighbors(IndexType index, int k, Scalar epsilon,
+                                                                      int max_leaf_visits = std::numeric_limits<int>::max()) const
+    {
+        KdTreeKNearestIndexQuery<DataPoint, NodeType> query(this, k, index);
+        query.set_epsilon(epsilon);
+        query.set_max_leaf_visits(max_leaf_visits);
+        return query;
+    }
+
+    /// \brief At most `k` nearest neighbors of `point` within the radius `r`
+    ///
+    /// Faster than filtering k_nearest_neighbors() or truncating range_neighbors(): the search distance
+    /// starts at `r`, so that the traversal skips the nodes farther than `r` from the beginning.
+    KdTreeKNearestRangePointQuery<DataPoint, NodeType> k_nearest_range_neighbors(const VectorType& point, int k, Scalar r) const
+    {
+        return KdTreeKNearestRangePointQuery<DataPoint, NodeType>(this, k, r, point);
+    }
+
+    /// \brief At most `k` nearest neighbors of the point `index` within the radius `r`
+    KdTreeKNearestRangeIndexQuery<DataPoint, NodeType> k_nearest_range_neighbors(IndexType index, int k, Scalar r) const
+    {
+        return KdTreeKNearestRangeIndexQuery<DataPoint, NodeType>(this, k, r, index);
+    }
+
+    /// \brief Fixed-size queue used by the k-nearest neighbors queries with a compile-time `K`
+    template<int K>
+    using StaticKNearestQueue = static_limited_priority_queue<IndexSquaredDistance<Scalar, IndexType>, K>;
+
+    /// \brief Same as k_nearest_neighbors(point, K), storing the neighbors in a fixed-size queue
+    ///
+    /// The query does not allocate, which is faster when a query is created for each point, and its
+    /// insertions are tuned for small `K` (up to 32).
+    template<int K>
+    KdTreeKNearestPointQuery<DataPoint, NodeType, StaticKNearestQueue<K>> k_nearest_neighbors(const VectorType& point) const
     {
-        return KdTreeKNearestPointQuery<DataPoint>(this, k, point);
+        return KdTreeKNearestPointQuery<DataPoint, NodeType, StaticKNearestQueue<K>>(this, K, point);
     }
 
-    KdTreeKNearestIndexQuery<DataPoint> k_nearest_neighbors(int index, int k) const
+    /// \brief Same as k_nearest_neighbors(index, K), storing the neighbors in a fixed-size queue
+    template<int K>
+    KdTreeKNearestIndexQuery<DataPoint, NodeType, StaticKNearestQueue<K>> k_nearest_neighbors(IndexType index) const
     {
-        return KdTreeKNearestIndexQuery<DataPoint>(this, k, index);
+        return KdTreeKNearestIndexQuery<DataPoint, NodeType, StaticKNearestQueue<K>>(this, K, index);
     }
 
-    KdTreeNearestPointQuery<DataPoint> nearest_neighbor(const VectorType& point) const
+    KdTreeNearestPointQuery<DataPoint, NodeType> nearest_neighbor(const VectorType& point) const
     {
-        return KdTreeNearestPointQuery<DataPoint>(this, point);
+        return KdTreeNearestPointQuery<DataPoint, NodeType>(this, point);
     }
 
-    KdTreeNearestIndexQuery<DataPoint> nearest_neighbor(int index) const
+    KdTreeNearestIndexQuery<DataPoint, NodeType> nearest_neighbor(IndexType index) const
     {
-        return KdTreeNearestIndexQuery<DataPoint>(this, index);
+        return KdTreeNearestIndexQuery<DataPoint, NodeType>(this, index);
     }
 
-    KdTreeRangePointQuery<DataPoint> range_neighbors(const VectorType& point, Scalar r) const
+    /// \brief Approximate nearest neighbor of `point`
+    /// \see k_nearest_neighbors(const VectorType&, int, Scalar, int)
+    KdTreeNearestPointQuery<DataPoint, NodeType> nearest_neighbor(const VectorType& point, Scalar epsilon,
+                                                                  int max_leaf_visits = std::numeric_limits<int>::max()) const
     {
-        return KdTreeRangePointQuery<DataPoint>(this, r, point);
+        KdTreeNearestPointQuery<DataPoint, NodeType> query(this, point);
+        query.set_epsilon(epsilon);
+        query.set_max_leaf_visits(max_leaf_visits);
+        return query;
     }
 
-    KdTreeRangeIndexQuery<DataPoint> range_neighbors(int index, Scalar r) const
+    /// \brief Approximate nearest neighbor of the point `index`
+    /// \see k_nearest_neighbors(const VectorType&, int, Scalar, int)
+    KdTreeNearestIndexQuery<DataPoint, NodeType> nearest_neighbor(IndexType index, Scalar epsilon,
+                                                                  int max_leaf_visits = std::numeric_limits<int>::max()) const
     {
-        return KdTreeRangeIndexQuery<DataPoint>(this, r, index);
+        KdTreeNearestIndexQuery<DataPoint, NodeType> query(this, index);
+        query.set_epsilon(epsilon);
+        query.set_max_leaf_visits(max_leaf_visits);
+        return query;
     }
 
+    KdTreeRangePointQuery<DataPoint, NodeType> range_neighbors(const VectorType& point, Scalar r) const
+    {
+        return KdTreeRangePointQuery<DataPoint, NodeType>(this, r, point);
+    }
+
+    KdTreeRangeIndexQuery<DataPoint, NodeType> range_neighbors(IndexType index, Scalar r) const
+    {
+        return KdTreeRangeIndexQuery<DataPoint, NodeType>(this, r, index);
+    }
+
+    /// \brief Points contained in the axis-aligned box `box`
+    KdTreeBoxQuery<DataPoint, NodeType> box_neighbors(const Aabb& box) const
+    {
+        return KdTreeBoxQuery<DataPoint, NodeType>(this, BoxRegion<DataPoint>(box));
+    }
+
+    /// \brief Points contained in the oriented box `box`
+    KdTreeBoxQuery<DataPoint, NodeType> box_neighbors(const BoxRegion<DataPoint>& box) const
+    {
+        return KdTreeBoxQuery<DataPoint, NodeType>(this, box);
+    }
+
+    /// \brief Points contained in the frustum `frustum`, e.g. FrustumRegion::from_view_projection() for culling
+    KdTreeFrustumQuery<DataPoint, NodeType> frustum_neighbors(const FrustumRegion<DataPoint>& frustum) const
+    {
+        return KdTreeFrustumQuery<DataPoint, NodeType>(this, frustum);
+    }
+
+    /// \brief Points at distance less than `radius` of the ray starting at `origin` along `direction`, up to
+    /// `length`
+    KdTreeRayQuery<DataPoint, NodeType> ray_neighbors(const VectorType& origin, const VectorType& direction, Scalar radius,
+                                                      Scalar length = std::numeric_limits<Scalar>::infinity()) const
+    {
+        return KdTreeRayQuery<DataPoint, NodeType>(this, RayRegion<DataPoint>(origin, direction, radius, length));
+    }
+
+    /// \brief Points `p` such that \f$ (\mathbf{p}-\mathbf{c})^T M (\mathbf{p}-\mathbf{c}) \leq r^2 \f$, with
+    /// \f$ \mathbf{c} \f$ = `center`, \f$ M \f$ = `metric` and \f$ r \f$ = `radius`, e.g. the support of a
+    /// MahalanobisWeightFunc
+    KdTreeEllipsoidQuery<DataPoint, NodeType> ellipsoid_neighbors(const VectorType& center,
+                                                                  const typename EllipsoidRegion<DataPoint>::MatrixType& metric,
+                                                                  Scalar radius) const
+    {
+        return KdTreeEllipsoidQuery<DataPoint, NodeType>(this, EllipsoidRegion<DataPoint>(center, metric, radius));
+    }
+
+    /// \brief Points contained in the ellipsoid `ellipsoid`
+    KdTreeEllipsoidQuery<DataPoint, NodeType> ellipsoid_neighbors(const EllipsoidRegion<DataPoint>& ellipsoid) const
+    {
+        return KdTreeEllipsoidQuery<DataPoint, NodeType>(this, ellipsoid);
+    }
+
+    /// \brief Compute the `k` nearest neighbors of each position of `points`, in parallel
+    ///
+    /// The neighbors of `points[i]` are written to `indices[i*k, (i+1)*k)` by increasing distance, and their
+    /// squared distances to `squared_distances` when not null. Both arrays must hold `k * points.size()`
+    /// elements. When the tree has less than `k` points, the missing neighbors are set to -1 with a
+    /// squared distance of `std::numeric_limits<Scalar>::max()`.
+    /// The positions are processed in leaf_order() and distributed over the OpenMP threads, each one reusing a
+    /// single query object.
+    template<typename VectorUserContainer>
+    inline void k_nearest_neighbors_batch(const VectorUserContainer& points, int k, IndexType* indices,
+                                          Scalar* squared_distances = nullptr) const;
+
+    /// \brief Compute the `k` nearest neighbors of every point of the tree, excluding the point itself
+    ///
+    /// Same as the previous function, for the queries k_nearest_neighbors(i, k) with `i` in [0, point_count()).
+    inline void k_nearest_neighbors_batch(int k, IndexType* indices, Scalar* squared_distances = nullptr) const;
+
+    /// \brief Compute the `k` nearest neighbors in this tree of every point indexed by the tree `source`
+    ///
+    /// Dual-tree traversal: the leaves of `source` are distributed over the OpenMP threads, and the points of
+    /// each leaf are searched together in a single traversal of this tree, pruning the nodes whose bounding
+    /// box is farther from the leaf bounding box than the current search distance of all the leaf points.
+    /// The output follows k_nearest_neighbors_batch(): the neighbors of the source point `i` are written to
+    /// `indices[i*k, (i+1)*k)`, both arrays holding `k * source.point_count()` elements. The rows of the
+    /// points that are not indexed by `source` (see build() sampling) are left untouched.
+    template<class SourceNodeType>
+    inline void k_nearest_neighbors_dual(const KdTree<DataPoint, SourceNodeType>& source, int k, IndexType* indices,
+                                         Scalar* squared_distances = nullptr) const;
+
+    /// \brief Compute the neighbors of each position of `points` within the radius `r`, in parallel
+    ///
+    /// The result is stored in compressed sparse row format: the neighbors of `points[i]` are
+    /// `neighbors[offsets[i], offsets[i+1])`, so `offsets` holds `points.size()+1` elements. Their squared
+    /// distances are stored in the same layout in `squared_distances` when not null.
+    /// The positions are distributed over the OpenMP threads, each one reusing a single query object.
+    template<typename VectorUserContainer>
+    inline void range_neighbors_batch(const VectorUserContainer& points, Scalar r, std::vector<std::size_t>& offsets,
+                                      IndexContainer& neighbors, std::vector<Scalar>* squared_distances = nullptr) const;
+
+    /// \brief Compute the neighbors of every point of the tree within the radius `r`, excluding the point itself
+    ///
+    /// Same as the previous function, for the queries range_neighbors(i, r) with `i` in [0, point_count()).
+    inline void range_neighbors_batch(Scalar r, std::vector<std::size_t>& offsets, IndexContainer& neighbors,
+                                      std::vector<Scalar>* squared_distances = nullptr) const;
+
+protected:
+    /// \brief Run the range query `QueryT` on `input(i)` for i in [0,count), writing the neighbors in CSR format
+    /// \see range_neighbors_batch
+    template<typename QueryT, typename InputFunctor>
+    inline void range_neighbors_batch(IndexType count, Scalar r, const InputFunctor& input,
+                                      std::vector<std::size_t>& offsets, IndexContainer& neighbors,
+                                      std::vector<Scalar>* squared_distances) const;
+
+    /// \brief Search together the neighbors of `positions[0, count)`, stored in `queues[0, count)`
+    /// \see k_nearest_neighbors_dual
+    inline void k_nearest_neighbors_dual_leaf(const VectorType* positions, int count,
+                                              std::vector<limited_priority_queue<IndexSquaredDistance<Scalar, IndexType>>>& queues) const;
+
+    /// \brief Copy the content of a k-nearest neighbors queue to the `k` entries of a batch output
+    inline static void write_k_nearest(const limited_priority_queue<IndexSquaredDistance<Scalar, IndexType>>& queue, int k,
+                                       IndexType* indices, Scalar* squared_distances);
+
     // Data --------------------------------------------------------------------
 protected:
     PointContainer m_points;
+    const DataPoint* m_point_view; // user buffer, used instead of m_points when not null
+    IndexType m_point_view_count;
     NodeContainer m_nodes;
+    AabbContainer m_node_bounds;
     IndexContainer m_indices;
 
+    // read-only storage given to load_view(), used instead of the containers when not null
+    const NodeType* m_node_view;
+    const Aabb* m_node_bounds_view;
+    const IndexType* m_index_view;
+    int m_node_view_count;
+    IndexType m_index_view_count;
+
     int m_min_cell_size;
+    int m_max_depth;
+    bool m_parallel_build;
+    KDTREE_SPLIT_STRATEGY m_split_strategy;
+    bool m_tight_bounds;
+    KDTREE_NODE_LAYOUT m_node_layout;
+
+    PositionContainer m_leaf_positions;
+    bool m_use_leaf_positions;
+
+    QuantizedPositionContainer m_quantized_positions;
+    PositionContainer m_quantization_origins; // one row per block of quantized positions
+    PositionContainer m_quantization_steps;   // one row per block of quantized positions
+    bool m_use_quantized_positions;
+
+    std::vector<std::uint64_t> m_morton_codes; // codes of the indices, during SPLIT_MORTON builds
 };
 
 #include "./kdTree.hpp"
@@ -6,157 +6,395 @@
 
 // KdTree ----------------------------------------------------------------------
 
-template<class DataPoint>
-int KdTree<DataPoint>::node_count() const
+template<class DataPoint, class NodeType>
+int KdTree<DataPoint, NodeType>::node_count() const
 {
-	return static_cast<int>(m_nodes.size());
+	return m_node_view != nullptr ? m_node_view_count : static_cast<int>(m_nodes.size());
 }
 
-template<class DataPoint>
-int KdTree<DataPoint>::index_count() const
+template<class DataPoint, class NodeType>
+typename KdTree<DataPoint, NodeType>::IndexType KdTree<DataPoint, NodeType>::index_count() const
 {
-	return static_cast<int>(m_indices.size());
+	return m_index_view != nullptr ? m_index_view_count : static_cast<IndexType>(m_indices.size());
 }
 
-template<class DataPoint>
-int KdTree<DataPoint>::point_count() const
+template<class DataPoint, class NodeType>
+typename KdTree<DataPoint, NodeType>::IndexType KdTree<DataPoint, NodeType>::point_count() const
 {
-	return static_cast<int>(m_points.size());
+	return m_point_view != nullptr ? m_point_view_count : static_cast<IndexType>(m_points.size());
 }
 
-template<class DataPoint>
-void KdTree<DataPoint>::clear()
+template<class DataPoint, class NodeType>
+bool KdTree<DataPoint, NodeType>::is_view() const
+{
+	return m_point_view != nullptr;
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::clear()
 {
 	m_points.clear();
+	m_point_view = nullptr;
+	m_point_view_count = 0;
 	m_nodes.clear();
+	m_node_bounds.clear();
 	m_indices.clear();
+	m_leaf_positions.resize(0, DataPoint::Dim);
+	m_quantized_positions.resize(0, DataPoint::Dim);
+	m_quantization_origins.resize(0, DataPoint::Dim);
+	m_quantization_steps.resize(0, DataPoint::Dim);
+	this->clear_view();
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::shrink_to_fit()
+{
+	m_points.shrink_to_fit();
+	m_nodes.shrink_to_fit();
+	m_node_bounds.shrink_to_fit();
+	m_indices.shrink_to_fit();
+	m_morton_codes.shrink_to_fit();
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::reset()
+{
+	// the buffers keep their capacity, the leaf positions are resized by build_leaf_positions
+	m_point_view = nullptr;
+	m_point_view_count = 0;
+	m_nodes.clear();
+	m_node_bounds.clear();
+	this->clear_view();
+}
+
+template<class DataPoint, class NodeType>
+bool KdTree<DataPoint, NodeType>::is_mapped() const
+{
+	return m_node_view != nullptr;
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::clear_view()
+{
+	m_node_view = nullptr;
+	m_node_bounds_view = nullptr;
+	m_index_view = nullptr;
+	m_node_view_count = 0;
+	m_index_view_count = 0;
 }
 
-template<class DataPoint>
+template<class DataPoint, class NodeType>
 template<typename PointUserContainer>
-inline void KdTree<DataPoint>::build(const PointUserContainer& points)
+inline void KdTree<DataPoint, NodeType>::build(const PointUserContainer& points)
 {
-	std::vector<int> ids(points.size());
-	std::iota(ids.begin(), ids.end(), 0);
-	this->build(points, ids);
+	this->reset();
+
+	m_points.assign(std::begin(points), std::end(points));
+
+	m_indices.resize(point_count());
+	std::iota(m_indices.begin(), m_indices.end(), 0);
+
+	this->build_indices();
 }
 
-template<class DataPoint>
+template<class DataPoint, class NodeType>
 template<typename PointUserContainer, typename IndexUserContainer>
-inline void KdTree<DataPoint>::build(const PointUserContainer& points, const IndexUserContainer& sampling)
+inline void KdTree<DataPoint, NodeType>::build(const PointUserContainer& points, const IndexUserContainer& sampling)
 {
-	this->clear();
+	this->reset();
 
-	m_points = PointContainer(points);
+	m_points.assign(std::begin(points), std::end(points));
 
-	m_nodes = NodeContainer();
-	m_nodes.reserve(4 * point_count() / m_min_cell_size);
-	m_nodes.emplace_back();
-	m_nodes.back().leaf = false;
+	m_indices.assign(std::begin(sampling), std::end(sampling));
+
+	this->build_indices();
+}
+
+template<class DataPoint, class NodeType>
+inline void KdTree<DataPoint, NodeType>::build(PointContainer&& points)
+{
+	this->reset();
 
-	m_indices = IndexContainer(sampling);//move operator ou std copy
+	m_points = std::move(points);
 
-	this->build_rec(0, 0, index_count(), 1);
+	m_indices.resize(point_count());
+	std::iota(m_indices.begin(), m_indices.end(), 0);
 
-	PONCA_DEBUG_ASSERT(this->valid());
+	this->build_indices();
+}
+
+template<class DataPoint, class NodeType>
+template<typename IndexUserContainer>
+inline void KdTree<DataPoint, NodeType>::build(PointContainer&& points, const IndexUserContainer& sampling)
+{
+	this->reset();
+
+	m_points = std::move(points);
+
+	m_indices.assign(std::begin(sampling), std::end(sampling));
+
+	this->build_indices();
+}
+
+template<class DataPoint, class NodeType>
+inline void KdTree<DataPoint, NodeType>::build_view(const DataPoint* points, IndexType count)
+{
+	this->reset();
+	m_points.clear();
+
+	m_point_view = points;
+	m_point_view_count = count;
+
+	m_indices.resize(count);
+	std::iota(m_indices.begin(), m_indices.end(), 0);
+
+	this->build_indices();
+}
+
+template<class DataPoint, class NodeType>
+template<typename IndexUserContainer>
+inline void KdTree<DataPoint, NodeType>::build_view(const DataPoint* points, IndexType count, const IndexUserContainer& sampling)
+{
+	this->reset();
+	m_points.clear();
+
+	m_point_view = points;
+	m_point_view_count = count;
+
+	m_indices.assign(std::begin(sampling), std::end(sampling));
+
+	this->build_indices();
 }
 
-template<class DataPoint>
+template<class DataPoint, class NodeType>
 template<typename IndexUserContainer>
-inline void KdTree<DataPoint>::rebuild(const IndexUserContainer & sampling)
+inline void KdTree<DataPoint, NodeType>::rebuild(const IndexUserContainer & sampling)
 {
-	PONCA_DEBUG_ASSERT(sampling.size() <= m_points->size());
+	PONCA_DEBUG_ASSERT(IndexType(sampling.size()) <= point_count());
 
+	this->clear_view();
 	m_nodes.clear();
-	m_nodes.emplace_back();
-	m_nodes.back().leaf = false;
+	m_node_bounds.clear();
 
-	m_indices = sampling;
+	m_indices.assign(std::begin(sampling), std::end(sampling));
+
+	this->build_indices();
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::build_indices()
+{
+	PONCA_TRACE_ZONE("ponca::KdTree::build");
+	PONCA_TRACE_ZONE_VALUE(index_count());
+	m_nodes.reserve(4 * point_count() / m_min_cell_size);
 
-	this->build_rec(0, 0, index_count(), 1);
+	this->build_root();
+	this->layout_nodes();
+	this->build_leaf_positions();
 
 	PONCA_DEBUG_ASSERT(this->valid());
 }
 
-template<class DataPoint>
-bool KdTree<DataPoint>::valid() const
+template<class DataPoint, class NodeType>
+bool KdTree<DataPoint, NodeType>::valid() const
 {
-	PONCA_DEBUG_ERROR;
-	return false;
-
-	if (m_points.empty())
-		return m_nodes.empty() && m_indices.empty();
+	if (point_count() == 0)
+		return node_count() == 0 && index_count() == 0;
 		
-	if(m_nodes.empty() || m_indices.empty())
+	if(node_count() == 0 || index_count() == 0)
 	{
-		PONCA_DEBUG_ERROR;
+		PONCA_DEBUG_ERROR_MSG("empty nodes or indices");
 		return false;
 	}
 		
 	if(point_count() < index_count())
 	{
-		PONCA_DEBUG_ERROR;
+		PONCA_DEBUG_ERROR_MSG("more indices than points");
 		return false;
 	}
-		
+
+	if((!is_mapped() && m_node_bounds.size() != m_nodes.size()) ||
+	   (m_leaf_positions.rows() != 0 && m_leaf_positions.rows() != index_count()) ||
+	   (m_quantized_positions.rows() != 0 && m_quantized_positions.rows() != index_count()))
+	{
+		PONCA_DEBUG_ERROR_MSG("node bounds or leaf positions do not match the tree");
+		return false;
+	}
+
+	const NodeType* nodes = this->node_buffer();
+	const IndexType* indices = this->index_buffer();
+
 	std::vector<bool> b(point_count(), false);
-	for(int idx : m_indices)
+	for(IndexType i=0; i<index_count(); ++i)
 	{
+		const IndexType idx = indices[i];
 		if(idx < 0 || point_count() <= idx || b[idx])
 		{
-			PONCA_DEBUG_ERROR;
+			PONCA_DEBUG_ERROR_MSG("invalid or duplicated index");
 		    return false;
 		}
 		b[idx] = true;
 	}
-		
+
+	// each index must belong to exactly one leaf
+	std::vector<bool> covered(index_count(), false);
 	for(int n=0;n<node_count();++n)
 	{
-		const KdTreeNode<Scalar>& node = m_nodes.operator[](n);
+		const NodeType& node = nodes[n];
 		if(node.leaf)
 		{
-		    if(index_count() <= node.start || index_count() < node.start+node.size)
+		    if(std::size_t(index_count()) < std::size_t(node.start)+node.size)
+		    {
+				PONCA_DEBUG_ERROR_MSG("leaf out of the indices");
+		        return false;
+		    }
+		    for(IndexType i=node.start; i<IndexType(node.start+node.size); ++i)
+		    {
+		        if(covered[i])
+		        {
+					PONCA_DEBUG_ERROR_MSG("overlapping leaves");
+		            return false;
+		        }
+		        covered[i] = true;
+		    }
+		    if(node.duplicates && !this->same_positions(node.start, node.start + node.size))
 		    {
-				PONCA_DEBUG_ERROR;
+				PONCA_DEBUG_ERROR_MSG("duplicate leaf with distinct positions");
 		        return false;
 		    }
 		}
 		else
 		{
-		    if(node.dim < 0 || 2 < node.dim)
+		    if(int(node.dim) >= int(DataPoint::Dim))
 		    {
-				PONCA_DEBUG_ERROR;
+				PONCA_DEBUG_ERROR_MSG("invalid split dimension");
 		        return false;
 		    }
-		    if(node_count() <= node.firstChildId || node_count() <= node.firstChildId+1u)
+		    if(int(node.firstChildId) <= n || node_count() <= int(node.firstChildId)+1)
 		    {
-				PONCA_DEBUG_ERROR;
+				PONCA_DEBUG_ERROR_MSG("invalid child id");
 		        return false;
 		    }
 		}
 	}
+	if(std::find(covered.begin(), covered.end(), false) != covered.end())
+	{
+		PONCA_DEBUG_ERROR_MSG("index not covered by a leaf");
+		return false;
+	}
 
 	return true;
 }
 
-template<class DataPoint>
-std::string KdTree<DataPoint>::to_string() const
+template<class DataPoint, class NodeType>
+KdTreeMemoryUsage KdTree<DataPoint, NodeType>::memory_usage() const
+{
+	KdTreeMemoryUsage usage;
+	usage.object              = sizeof(*this);
+	usage.points              = m_points.capacity() * sizeof(DataPoint);
+	usage.nodes               = m_nodes.capacity() * sizeof(NodeType);
+	usage.node_bounds         = m_node_bounds.capacity() * sizeof(Aabb);
+	usage.indices             = m_indices.capacity() * sizeof(IndexType);
+	usage.leaf_positions      = std::size_t(m_leaf_positions.size()) * sizeof(Scalar);
+	usage.quantized_positions = std::size_t(m_quantized_positions.size()) * sizeof(std::uint16_t) +
+	                            std::size_t(m_quantization_origins.size() + m_quantization_steps.size()) * sizeof(Scalar);
+	usage.build               = m_morton_codes.capacity() * sizeof(std::uint64_t);
+	if(m_point_view != nullptr)
+		usage.viewed += std::size_t(m_point_view_count) * sizeof(DataPoint);
+	if(m_node_view != nullptr)
+		usage.viewed += std::size_t(m_node_view_count) * (sizeof(NodeType) + sizeof(Aabb));
+	if(m_index_view != nullptr)
+		usage.viewed += std::size_t(m_index_view_count) * sizeof(IndexType);
+	return usage;
+}
+
+template<class DataPoint, class NodeType>
+KdTreeStatistics KdTree<DataPoint, NodeType>::statistics(int query_count, int k) const
+{
+	KdTreeStatistics stats;
+	stats.node_count           = node_count();
+	stats.node_memory          = std::size_t(node_count()) * (sizeof(NodeType) + sizeof(Aabb));
+	stats.index_memory         = std::size_t(index_count()) * sizeof(IndexType);
+	stats.point_memory         = m_points.size() * sizeof(DataPoint);
+	stats.leaf_position_memory = std::size_t(m_leaf_positions.size()) * sizeof(Scalar) +
+	                             std::size_t(m_quantized_positions.size()) * sizeof(std::uint16_t) +
+	                             std::size_t(m_quantization_origins.size() + m_quantization_steps.size()) * sizeof(Scalar);
+	if(node_count() == 0)
+		return stats;
+
+	// depth first traversal, storing the depth of the nodes on the stack
+	const NodeType* nodes = this->node_buffer();
+	std::vector<std::pair<int,int>> stack {{0, 0}};
+	stats.min_leaf_size = std::numeric_limits<int>::max();
+	std::size_t total = 0;
+	while(!stack.empty())
+	{
+		const int n = stack.back().first, depth = stack.back().second;
+		stack.pop_back();
+		const NodeType& node = nodes[n];
+		if(node.leaf)
+		{
+		    const int size = static_cast<int>(node.size);
+		    ++stats.leaf_count;
+		    stats.empty_leaf_count += size == 0;
+		    stats.duplicate_leaf_count += node.duplicates;
+		    stats.min_leaf_size = std::min(stats.min_leaf_size, size);
+		    stats.max_leaf_size = std::max(stats.max_leaf_size, size);
+		    stats.max_depth = std::max(stats.max_depth, depth);
+		    total += size;
+
+		    const int c = KdTreeStatistics::size_class(size);
+		    if(int(stats.depth_histogram.size()) <= depth)
+		        stats.depth_histogram.resize(depth+1, 0);
+		    if(int(stats.leaf_size_histogram.size()) <= c)
+		        stats.leaf_size_histogram.resize(c+1, 0);
+		    ++stats.depth_histogram[depth];
+		    ++stats.leaf_size_histogram[c];
+		}
+		else
+		{
+		    stack.push_back({int(node.firstChildId)+1, depth+1});
+		    stack.push_back({int(node.firstChildId), depth+1});
+		}
+	}
+	stats.mean_leaf_size = stats.leaf_count > 0 ? double(total) / stats.leaf_count : 0.;
+
+	if(query_count > 0 && point_count() > 0)
+	{
+		stats.query_count = query_count;
+		KdTreeKNearestIndexQuery<DataPoint, NodeType> query(this, k, 0);
+		std::size_t visits = 0;
+		for(int q=0; q<query_count; ++q)
+		{
+		    query.set_input(static_cast<IndexType>(std::size_t(q) * point_count() / query_count));
+		    query.begin();
+		    visits += query.leaf_visits();
+		}
+		stats.mean_leaf_visits = double(visits) / query_count;
+	}
+	return stats;
+}
+
+template<class DataPoint, class NodeType>
+std::string KdTree<DataPoint, NodeType>::to_string() const
 {
 	if (m_indices.empty()) return "";
 	
 	std::stringstream str;
 	str << "indices (" << index_count() << ") :\n";
-	for(int i=0; i<index_count(); ++i)
+	for(IndexType i=0; i<index_count(); ++i)
 	{
+	    // the free slots left between the leaves by DynamicKdTree hold -1
+	    if(m_indices.operator[](i) < 0) continue;
 	    str << "  " << i << ": " << m_indices.operator[](i) << "\n";
 	}
 	str << "nodes (" << node_count() << ") :\n";
 	for(int n=0; n< node_count(); ++n)
 	{
-	    const KdTreeNode<Scalar>& node = m_nodes.operator[](n);
+	    const NodeType& node = m_nodes.operator[](n);
 	    if(node.leaf)
 	    {
-	        int end = node.start + node.size;
+	        IndexType end = node.start + node.size;
 	        str << "  leaf: start=" << node.start << " end=" << end << " (size=" << node.size << ")\n";
 	    }
 	    else
@@ -167,87 +405,1394 @@ std::string KdTree<DataPoint>::to_string() const
 	return str.str();
 }
 
-template<class DataPoint>
-int KdTree<DataPoint>::min_cell_size() const
+template<class DataPoint, class NodeType>
+bool KdTree<DataPoint, NodeType>::save(std::ostream& out, bool with_points) const
+{
+	KdTreeFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, KdTreeFileHeader::magic_string(), sizeof(header.magic));
+	header.version       = KdTreeFileHeader::Version;
+	header.endianness    = KdTreeFileHeader::EndianTag;
+	header.scalar_size   = sizeof(Scalar);
+	header.dim           = DataPoint::Dim;
+	header.node_size     = sizeof(NodeType);
+	header.point_size    = with_points ? sizeof(DataPoint) : 0;
+	header.node_count    = node_count();
+	header.index_count   = index_count();
+	header.point_count   = point_count();
+	header.min_cell_size = m_min_cell_size;
+	header.depth         = static_cast<std::uint32_t>(statistics().max_depth);
+
+	header.node_offset   = KdTreeFileHeader::align(sizeof(KdTreeFileHeader));
+	header.bounds_offset = KdTreeFileHeader::align(header.node_offset   + header.node_count  * sizeof(NodeType));
+	header.index_offset  = KdTreeFileHeader::align(header.bounds_offset + header.node_count  * sizeof(Aabb));
+	header.point_offset  = KdTreeFileHeader::align(header.index_offset  + header.index_count * sizeof(IndexType));
+
+	// write each array at its offset, padding with zeros
+	std::uint64_t written = 0;
+	const auto write = [&](std::uint64_t offset, const void* data, std::uint64_t size)
+	{
+	    static const char zeros[KdTreeFileHeader::Alignment] = {};
+	    out.write(zeros, static_cast<std::streamsize>(offset - written));
+	    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+	    written = offset + size;
+	};
+	write(0, &header, sizeof(header));
+	write(header.node_offset,   this->node_buffer(),        header.node_count  * sizeof(NodeType));
+	write(header.bounds_offset, this->node_bounds_buffer(), header.node_count  * sizeof(Aabb));
+	write(header.index_offset,  this->index_buffer(),       header.index_count * sizeof(IndexType));
+	if(with_points)
+	    write(header.point_offset, this->point_buffer(), header.point_count * sizeof(DataPoint));
+
+	return bool(out);
+}
+
+template<class DataPoint, class NodeType>
+bool KdTree<DataPoint, NodeType>::check_header(const KdTreeFileHeader& header, std::size_t size)
+{
+	if(!header.has_valid_magic() || header.version != KdTreeFileHeader::Version ||
+	   header.endianness != KdTreeFileHeader::EndianTag)
+	    return false;
+	if(header.scalar_size != sizeof(Scalar) || header.dim != DataPoint::Dim ||
+	   header.node_size != sizeof(NodeType) ||
+	   (header.point_size != 0 && header.point_size != sizeof(DataPoint)))
+	    return false;
+	// the traversal stacks of the queries are sized by the PCA_KDTREE_MAX_DEPTH of the reader
+	if(header.depth > std::uint32_t(PCA_KDTREE_MAX_DEPTH))
+	    return false;
+	if(header.node_count > std::uint64_t(std::numeric_limits<int>::max()) ||
+	   header.index_count > std::uint64_t(std::numeric_limits<IndexType>::max()) ||
+	   header.point_count > std::uint64_t(std::numeric_limits<IndexType>::max()))
+	    return false;
+
+	const std::uint64_t end = header.point_size != 0 ?
+	    header.point_offset + header.point_count * sizeof(DataPoint) :
+	    header.index_offset + header.index_count * sizeof(IndexType);
+	return header.node_offset % KdTreeFileHeader::Alignment == 0 &&
+	       header.bounds_offset % KdTreeFileHeader::Alignment == 0 &&
+	       header.index_offset % KdTreeFileHeader::Alignment == 0 &&
+	       header.point_offset % KdTreeFileHeader::Alignment == 0 &&
+	       header.bounds_offset >= header.node_offset + header.node_count * sizeof(NodeType) &&
+	       header.index_offset >= header.bounds_offset + header.node_count * sizeof(Aabb) &&
+	       header.point_offset >= header.index_offset + header.index_count * sizeof(IndexType) &&
+	       end <= size;
+}
+
+template<class DataPoint, class NodeType>
+bool KdTree<DataPoint, NodeType>::check_nodes() const
+{
+	const NodeType* nodes = this->node_buffer();
+	const IndexType* indices = this->index_buffer();
+	for(IndexType i=0; i<index_count(); ++i)
+	    if(indices[i] < 0 || point_count() <= indices[i])
+	        return false;
+	if(node_count() == 0)
+	    return index_count() == 0;
+
+	// depth first traversal, storing the depth of the nodes on the stack
+	std::vector<bool> visited(node_count(), false);
+	std::vector<std::pair<int,int>> stack {{0, 0}};
+	while(!stack.empty())
+	{
+		const int n = stack.back().first, depth = stack.back().second;
+		stack.pop_back();
+		if(visited[n])
+		    return false;
+		visited[n] = true;
+		const NodeType& node = nodes[n];
+		if(node.leaf)
+		{
+		    if(std::size_t(index_count()) < std::size_t(node.start)+node.size)
+		        return false;
+		}
+		else
+		{
+		    if(depth >= PCA_KDTREE_MAX_DEPTH || int(node.dim) >= int(DataPoint::Dim) ||
+		       std::size_t(node.firstChildId) <= std::size_t(n) ||
+		       std::size_t(node_count()) <= std::size_t(node.firstChildId)+1)
+		        return false;
+		    stack.push_back({int(node.firstChildId)+1, depth+1});
+		    stack.push_back({int(node.firstChildId), depth+1});
+		}
+	}
+	return true;
+}
+
+template<class DataPoint, class NodeType>
+bool KdTree<DataPoint, NodeType>::load(std::istream& in, const DataPoint* points, IndexType count)
+{
+	this->clear();
+
+	KdTreeFileHeader header;
+	if(!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+	   !check_header(header, std::numeric_limits<std::size_t>::max()) ||
+	   (header.point_size == 0 && std::uint64_t(count) != header.point_count))
+	    return false;
+
+	// read each array at its offset, skipping the padding
+	std::uint64_t position = sizeof(header);
+	const auto read = [&](std::uint64_t offset, void* data, std::uint64_t size)
+	{
+	    in.ignore(static_cast<std::streamsize>(offset - position));
+	    in.read(static_cast<char*>(data), static_cast<std::streamsize>(size));
+	    position = offset + size;
+	    return bool(in);
+	};
+
+	m_nodes.resize(header.node_count);
+	m_node_bounds.resize(header.node_count);
+	m_indices.resize(header.index_count);
+	bool ok = read(header.node_offset,   m_nodes.data(),       header.node_count  * sizeof(NodeType)) &&
+	          read(header.bounds_offset, m_node_bounds.data(), header.node_count  * sizeof(Aabb)) &&
+	          read(header.index_offset,  m_indices.data(),     header.index_count * sizeof(IndexType));
+	if(ok && header.point_size != 0)
+	{
+	    m_points.resize(header.point_count);
+	    ok = read(header.point_offset, static_cast<void*>(m_points.data()), header.point_count * sizeof(DataPoint));
+	}
+	else
+	{
+	    m_point_view = points;
+	    m_point_view_count = count;
+	}
+
+	if(!ok || !check_nodes())
+	{
+	    this->clear();
+	    return false;
+	}
+	m_min_cell_size = header.min_cell_size;
+	this->build_leaf_positions();
+	return true;
+}
+
+template<class DataPoint, class NodeType>
+bool KdTree<DataPoint, NodeType>::load_view(const void* data, std::size_t size, const DataPoint* points, IndexType count)
+{
+	this->clear();
+
+	const char* bytes = static_cast<const char*>(data);
+	if(size < sizeof(KdTreeFileHeader) || reinterpret_cast<std::uintptr_t>(data) % KdTreeFileHeader::Alignment != 0)
+	    return false;
+
+	KdTreeFileHeader header;
+	std::memcpy(&header, bytes, sizeof(header));
+	if(!check_header(header, size) || (header.point_size == 0 && std::uint64_t(count) != header.point_count))
+	    return false;
+
+	m_node_view        = reinterpret_cast<const NodeType*>(bytes + header.node_offset);
+	m_node_bounds_view = reinterpret_cast<const Aabb*>(bytes + header.bounds_offset);
+	m_index_view       = reinterpret_cast<const IndexType*>(bytes + header.index_offset);
+	m_node_view_count  = static_cast<int>(header.node_count);
+	m_index_view_count = static_cast<IndexType>(header.index_count);
+	if(header.point_size != 0)
+	{
+	    m_point_view = reinterpret_cast<const DataPoint*>(bytes + header.point_offset);
+	    m_point_view_count = static_cast<IndexType>(header.point_count);
+	}
+	else
+	{
+	    m_point_view = points;
+	    m_point_view_count = count;
+	}
+	if(!check_nodes())
+	{
+	    this->clear();
+	    return false;
+	}
+
+	m_min_cell_size = header.min_cell_size;
+	this->build_leaf_positions();
+	return true;
+}
+
+template<class DataPoint, class NodeType>
+template<typename VectorUserContainer>
+void KdTree<DataPoint, NodeType>::k_nearest_neighbors_batch(const VectorUserContainer& points, int k, IndexType* indices,
+                                                  Scalar* squared_distances) const
+{
+	PONCA_TRACE_ZONE("ponca::KdTree::k_nearest_neighbors_batch");
+	const IndexType count = static_cast<IndexType>(points.size());
+
+	const IndexContainer order = leaf_order(points);
+
+#pragma omp parallel
+	{
+	    PONCA_TRACE_ZONE("ponca::KdTree::k_nearest_neighbors_batch chunk");
+	    KdTreeKNearestPointQuery<DataPoint, NodeType> query(this, k, VectorType::Zero());
+#pragma omp for
+	    for(IndexType n=0; n<count; ++n)
+	    {
+	        const IndexType i = order[n];
+	        query.set_input(points[i]);
+	        query.begin();
+	        write_k_nearest(query.queue(), k, indices + std::ptrdiff_t(i)*k,
+	                        squared_distances != nullptr ? squared_distances + std::ptrdiff_t(i)*k : nullptr);
+	    }
+	}
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::k_nearest_neighbors_batch(int k, IndexType* indices, Scalar* squared_distances) const
+{
+	PONCA_TRACE_ZONE("ponca::KdTree::k_nearest_neighbors_batch");
+	const IndexType count = point_count();
+
+	// leaf order: the indexed points first, then the others, skipping the free slots of DynamicKdTree
+	IndexContainer order;
+	order.reserve(count);
+	std::copy_if(index_buffer(), index_buffer() + index_count(), std::back_inserter(order),
+	             [](IndexType i) { return i >= 0; });
+	if(IndexType(order.size()) < count)
+	{
+	    std::vector<bool> indexed(count, false);
+	    for(IndexType i : order)
+	        indexed[i] = true;
+	    for(IndexType i=0; i<count; ++i)
+	    {
+	        if(!indexed[i])
+	            order.push_back(i);
+	    }
+	}
+
+#pragma omp parallel
+	{
+	    PONCA_TRACE_ZONE("ponca::KdTree::k_nearest_neighbors_batch chunk");
+	    KdTreeKNearestIndexQuery<DataPoint, NodeType> query(this, k, 0);
+#pragma omp for
+	    for(IndexType n=0; n<count; ++n)
+	    {
+	        const IndexType i = order[n];
+	        query.set_input(i);
+	        query.begin();
+	        write_k_nearest(query.queue(), k, indices + std::ptrdiff_t(i)*k,
+	                        squared_distances != nullptr ? squared_distances + std::ptrdiff_t(i)*k : nullptr);
+	    }
+	}
+}
+
+template<class DataPoint, class NodeType>
+template<class SourceNodeType>
+void KdTree<DataPoint, NodeType>::k_nearest_neighbors_dual(const KdTree<DataPoint, SourceNodeType>& source, int k,
+                                                     IndexType* indices, Scalar* squared_distances) const
+{
+	PONCA_TRACE_ZONE("ponca::KdTree::k_nearest_neighbors_dual");
+	const SourceNodeType* sourceNodes = source.node_buffer();
+	const auto* sourceIndices = source.index_buffer();
+
+	// the source leaves are the units of work, each one searched with a single traversal
+	std::vector<int> leaves;
+	for(int n=0; n<source.node_count(); ++n)
+	{
+	    if(sourceNodes[n].leaf && sourceNodes[n].size > 0)
+	        leaves.push_back(n);
+	}
+	const int leafCount = static_cast<int>(leaves.size());
+
+#pragma omp parallel
+	{
+	    PONCA_TRACE_ZONE("ponca::KdTree::k_nearest_neighbors_dual chunk");
+	    std::vector<VectorType, Eigen::aligned_allocator<VectorType>> positions;
+	    std::vector<limited_priority_queue<IndexSquaredDistance<Scalar, IndexType>>> queues;
+#pragma omp for schedule(dynamic)
+	    for(int l=0; l<leafCount; ++l)
+	    {
+	        const auto& leaf = sourceNodes[leaves[l]];
+	        const int count = static_cast<int>(leaf.size);
+	        if(int(queues.size()) < count)
+	        {
+	            positions.resize(count);
+	            queues.resize(count, limited_priority_queue<IndexSquaredDistance<Scalar, IndexType>>(k));
+	        }
+	        for(int j=0; j<count; ++j)
+	        {
+	            positions[j] = source.point(sourceIndices[leaf.start+j]).pos();
+	            queues[j].clear();
+	            queues[j].push({-1, std::numeric_limits<Scalar>::max()});
+	        }
+
+	        this->k_nearest_neighbors_dual_leaf(positions.data(), count, queues);
+
+	        for(int j=0; j<count; ++j)
+	        {
+	            const std::ptrdiff_t row = std::ptrdiff_t(sourceIndices[leaf.start+j]) * k;
+	            write_k_nearest(queues[j], k, indices + row, squared_distances != nullptr ? squared_distances + row : nullptr);
+	        }
+	    }
+	}
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::k_nearest_neighbors_dual_leaf(const VectorType* positions, int count,
+                                                          std::vector<limited_priority_queue<IndexSquaredDistance<Scalar, IndexType>>>& queues) const
+{
+	if(node_count() == 0 || count == 0)
+	    return;
+
+	const NodeType* nodes = this->node_buffer();
+	const Aabb* bounds = this->node_bounds_buffer();
+	const IndexType* treeIndices = this->index_buffer();
+
+	Aabb box(positions[0], positions[0]);
+	for(int j=1; j<count; ++j)
+	    box.extend(positions[j]);
+
+	// a node is skipped when it is farther from the box than the farthest current neighbor of all the points
+	const auto searchDistance = [&]()
+	{
+	    Scalar d = 0;
+	    for(int j=0; j<count; ++j)
+	        d = std::max(d, queues[j].bottom().squared_distance);
+	    return d;
+	};
+	Scalar bound = std::numeric_limits<Scalar>::max();
+
+	Stack<IndexSquaredDistance<Scalar>, 2 * PCA_KDTREE_MAX_DEPTH> stack;
+	stack.push({0, bounds[0].squaredExteriorDistance(box)});
+	while(!stack.empty())
+	{
+	    const IndexSquaredDistance<Scalar> qnode = stack.top();
+	    stack.pop();
+	    if(qnode.squared_distance >= bound)
+	        continue;
+
+	    const NodeType& node = nodes[qnode.index];
+	    if(node.leaf)
+	    {
+	        for(int j=0; j<count; ++j)
+	        {
+	            auto& queue = queues[j];
+	            if(bounds[qnode.index].squaredExteriorDistance(positions[j]) >= queue.bottom().squared_distance)
+	                continue;
+	            this->leaf_scan(node, positions[j],
+	                [&queue, treeIndices](IndexType i, Scalar d) { queue.push({treeIndices[i], d}); },
+	                [&queue]() { return queue.bottom().squared_distance; });
+	        }
+	        bound = searchDistance();
+	    }
+	    else
+	    {
+	        // push the farthest child first, so that the closest is visited first
+	        const int first = node.firstChildId;
+	        const Scalar d0 = bounds[first].squaredExteriorDistance(box);
+	        const Scalar d1 = bounds[first+1].squaredExteriorDistance(box);
+	        if(d0 <= d1)
+	        {
+	            stack.push({first+1, d1});
+	            stack.push({first, d0});
+	        }
+	        else
+	        {
+	            stack.push({first, d0});
+	            stack.push({first+1, d1});
+	        }
+	    }
+	}
+}
+
+template<class DataPoint, class NodeType>
+template<typename VectorUserContainer>
+void KdTree<DataPoint, NodeType>::range_neighbors_batch(const VectorUserContainer& points, Scalar r, std::vector<std::size_t>& offsets,
+                                              IndexContainer& neighbors, std::vector<Scalar>* squared_distances) const
+{
+	const auto input = [&](IndexType i) -> const VectorType& { return points[i]; };
+	this->template range_neighbors_batch<KdTreeRangePointQuery<DataPoint, NodeType>>(
+	    static_cast<IndexType>(points.size()), r, input, offsets, neighbors, squared_distances);
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::range_neighbors_batch(Scalar r, std::vector<std::size_t>& offsets, IndexContainer& neighbors,
+                                              std::vector<Scalar>* squared_distances) const
+{
+	const auto input = [](IndexType i) { return i; };
+	this->template range_neighbors_batch<KdTreeRangeIndexQuery<DataPoint, NodeType>>(
+	    point_count(), r, input, offsets, neighbors, squared_distances);
+}
+
+template<class DataPoint, class NodeType>
+template<typename QueryT, typename InputFunctor>
+void KdTree<DataPoint, NodeType>::range_neighbors_batch(IndexType count, Scalar r, const InputFunctor& input,
+                                              std::vector<std::size_t>& offsets, IndexContainer& neighbors,
+                                              std::vector<Scalar>* squared_distances) const
+{
+	PONCA_TRACE_ZONE("ponca::KdTree::range_neighbors_batch");
+	offsets.assign(count+1, 0);
+	neighbors.clear();
+	if(squared_distances != nullptr)
+	    squared_distances->clear();
+	if(count == 0)
+	    return;
+
+#pragma omp parallel
+	{
+	    PONCA_TRACE_ZONE("ponca::KdTree::range_neighbors_batch chunk");
+	    QueryT query(this, r, input(0));
+	    IndexContainer localNeighbors;
+	    std::vector<Scalar> localDistances;
+	    IndexType first = count;
+
+	    // with a static schedule, each thread processes a contiguous range of queries
+#pragma omp for schedule(static)
+	    for(IndexType i=0; i<count; ++i)
+	    {
+	        first = std::min(first, i);
+	        query.set_input(input(i));
+	        const std::size_t size = localNeighbors.size();
+	        // the iterators hold the squared distances computed by the traversal
+	        for(auto it = query.begin(), end = query.end(); it != end; ++it)
+	        {
+	            localNeighbors.push_back(*it);
+	            if(squared_distances != nullptr)
+	                localDistances.push_back(it.squared_distance());
+	        }
+	        offsets[i+1] = localNeighbors.size() - size;
+	    }
+
+#pragma omp single
+	    {
+	        for(IndexType i=0; i<count; ++i)
+	            offsets[i+1] += offsets[i];
+	        neighbors.resize(offsets[count]);
+	        if(squared_distances != nullptr)
+	            squared_distances->resize(offsets[count]);
+	    }
+
+	    // each thread copies its neighbors at the offset of its first query
+	    if(first < count)
+	    {
+	        std::copy(localNeighbors.begin(), localNeighbors.end(), neighbors.begin() + offsets[first]);
+	        if(squared_distances != nullptr)
+	            std::copy(localDistances.begin(), localDistances.end(), squared_distances->begin() + offsets[first]);
+	    }
+	}
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::write_k_nearest(const limited_priority_queue<IndexSquaredDistance<Scalar, IndexType>>& queue, int k,
+                                        IndexType* indices, Scalar* squared_distances)
+{
+	// the queue is sorted by increasing distance, and initialized with an invalid neighbor
+	int n = 0;
+	for(auto it = queue.begin(); it != queue.end() && n < k; ++it, ++n)
+	{
+	    indices[n] = it->index;
+	    if(squared_distances != nullptr)
+	        squared_distances[n] = it->squared_distance;
+	}
+	for(; n < k; ++n)
+	{
+	    indices[n] = -1;
+	    if(squared_distances != nullptr)
+	        squared_distances[n] = std::numeric_limits<Scalar>::max();
+	}
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::leaf_squared_distances(IndexType start, int count, const VectorType& point,
+                                                        Scalar* distances) const
+{
+	constexpr int Chunk = PCA_KDTREE_LEAF_CHUNK_SIZE;
+	PONCA_DEBUG_ASSERT(count <= Chunk);
+
+	if(m_leaf_positions.rows() == 0)
+	{
+	    for(int i=0; i<count; ++i)
+	        distances[i] = this->leaf_squared_distance(start+i, point);
+	    return;
+	}
+
+	// accumulate the squared differences coordinate by coordinate, each column being contiguous
+	if(count == Chunk)
+	{
+	    Eigen::Map<Eigen::Array<Scalar, Chunk, 1>> d(distances);
+	    d = (m_leaf_positions.col(0).template segment<Chunk>(start).array() - point(0)).square();
+	    for(int k=1; k<DataPoint::Dim; ++k)
+	        d += (m_leaf_positions.col(k).template segment<Chunk>(start).array() - point(k)).square();
+	}
+	else
+	{
+	    Eigen::Map<Eigen::Array<Scalar, Eigen::Dynamic, 1>> d(distances, count);
+	    d = (m_leaf_positions.col(0).segment(start, count).array() - point(0)).square();
+	    for(int k=1; k<DataPoint::Dim; ++k)
+	        d += (m_leaf_positions.col(k).segment(start, count).array() - point(k)).square();
+	}
+}
+
+template<class DataPoint, class NodeType>
+template<typename Functor>
+void KdTree<DataPoint, NodeType>::leaf_scan(IndexType start, IndexType end, const VectorType& point, Functor f) const
+{
+	constexpr int Chunk = PCA_KDTREE_LEAF_CHUNK_SIZE;
+	Scalar distances[Chunk];
+	for(IndexType i=start; i<end; i+=Chunk)
+	{
+	    const int count = static_cast<int>(std::min<IndexType>(Chunk, end-i));
+	    this->leaf_squared_distances(i, count, point, distances);
+	    for(int j=0; j<count; ++j)
+	        f(i+j, distances[j]);
+	}
+}
+
+template<class DataPoint, class NodeType>
+template<typename Functor, typename BoundFunctor>
+void KdTree<DataPoint, NodeType>::leaf_scan(IndexType start, IndexType end, const VectorType& point, Functor f,
+                                            BoundFunctor bound) const
+{
+	if(m_quantized_positions.rows() == 0)
+	{
+	    this->leaf_scan(start, end, point, f);
+	    return;
+	}
+
+	for(IndexType i=start; i<end; ++i)
+	{
+	    if(this->quantized_squared_distance_bound(i, point) < bound())
+	        f(i, this->leaf_squared_distance(i, point));
+	}
+}
+
+template<class DataPoint, class NodeType>
+template<typename Functor, typename BoundFunctor>
+void KdTree<DataPoint, NodeType>::leaf_scan(const NodeType& leaf, const VectorType& point, Functor f,
+                                            BoundFunctor bound) const
+{
+	if(!leaf.duplicates)
+	{
+	    this->leaf_scan(leaf.start, leaf.start + leaf.size, point, f, bound);
+	    return;
+	}
+
+	// a single distance for all the points, the scan stops as soon as the bound rejects it
+	const Scalar d = this->leaf_squared_distance(leaf.start, point);
+	for(IndexType i=leaf.start; i<IndexType(leaf.start + leaf.size) && d < bound(); ++i)
+	    f(i, d);
+}
+
+template<class DataPoint, class NodeType>
+typename KdTree<DataPoint, NodeType>::Scalar
+KdTree<DataPoint, NodeType>::quantized_squared_distance_bound(IndexType i, const VectorType& point) const
+{
+	const IndexType block = i / PCA_KDTREE_QUANTIZATION_BLOCK_SIZE;
+	Scalar d = Scalar(0);
+	for(int k=0; k<DataPoint::Dim; ++k)
+	{
+	    // the position is closer than one step to its quantized value, see build_leaf_positions()
+	    const Scalar step = m_quantization_steps(block, k);
+	    const Scalar q    = m_quantization_origins(block, k) + Scalar(m_quantized_positions(i, k)) * step;
+	    const Scalar gap  = std::abs(point(k) - q) - step;
+	    if(gap > Scalar(0))
+	        d += gap * gap;
+	}
+	return d;
+}
+
+template<class DataPoint, class NodeType>
+typename KdTree<DataPoint, NodeType>::IndexType KdTree<DataPoint, NodeType>::leaf_find_within(IndexType start, IndexType end, const VectorType& point,
+                                                                                            Scalar squared_radius, Scalar* squared_distance) const
+{
+	if(m_quantized_positions.rows() != 0)
+	{
+	    for(IndexType i=start; i<end; ++i)
+	    {
+	        if(this->quantized_squared_distance_bound(i, point) >= squared_radius)
+	            continue;
+	        const Scalar d = this->leaf_squared_distance(i, point);
+	        if(d < squared_radius)
+	        {
+	            if(squared_distance != nullptr)
+	                *squared_distance = d;
+	            return i;
+	        }
+	    }
+	    return end;
+	}
+
+	constexpr int Chunk = PCA_KDTREE_LEAF_CHUNK_SIZE;
+	Scalar distances[Chunk];
+	for(IndexType i=start; i<end; i+=Chunk)
+	{
+	    const int count = static_cast<int>(std::min<IndexType>(Chunk, end-i));
+	    this->leaf_squared_distances(i, count, point, distances);
+	    for(int j=0; j<count; ++j)
+	    {
+	        if(distances[j] < squared_radius)
+	        {
+	            if(squared_distance != nullptr)
+	                *squared_distance = distances[j];
+	            return i+j;
+	        }
+	    }
+	}
+	return end;
+}
+
+template<class DataPoint, class NodeType>
+int KdTree<DataPoint, NodeType>::find_leaf(const VectorType& point) const
+{
+	const NodeType* nodes = this->node_buffer();
+	int n = 0;
+	while(!nodes[n].leaf)
+	    n = nodes[n].firstChildId + (point[nodes[n].dim] < nodes[n].splitValue ? 0 : 1);
+	return n;
+}
+
+template<class DataPoint, class NodeType>
+template<typename VectorUserContainer>
+typename KdTree<DataPoint, NodeType>::IndexContainer KdTree<DataPoint, NodeType>::leaf_order(const VectorUserContainer& points) const
+{
+	const IndexType count = static_cast<IndexType>(points.size());
+	IndexContainer order(count);
+	if(node_count() == 0)
+	{
+	    std::iota(order.begin(), order.end(), 0);
+	    return order;
+	}
+
+	// counting sort of the positions by the start of their leaf
+	const NodeType* nodes = this->node_buffer();
+	IndexContainer keys(count), offsets(index_count() + 2, 0);
+	for(IndexType i=0; i<count; ++i)
+	{
+	    keys[i] = static_cast<IndexType>(nodes[find_leaf(points[i])].start);
+	    ++offsets[keys[i]+1];
+	}
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+	for(IndexType i=0; i<count; ++i)
+	    order[offsets[keys[i]]++] = i;
+	return order;
+}
+
+template<class DataPoint, class NodeType>
+int KdTree<DataPoint, NodeType>::min_cell_size() const
 {
 	return m_min_cell_size;
 }
 
-template<class DataPoint>
-void KdTree<DataPoint>::set_min_cell_size(int min_cell_size)
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::set_min_cell_size(int min_cell_size)
 {
 	m_min_cell_size = min_cell_size;
 }
 
-template<class DataPoint>
-void KdTree<DataPoint>::build_rec(int node_id, int start, int end, int level)
-{	
-	KdTreeNode<Scalar>& node = m_nodes[node_id];
-	Aabb aabb;
-	for(int i=start; i<end; ++i)
-	    aabb.extend(m_points[m_indices[i]].pos());
+template<class DataPoint, class NodeType>
+int KdTree<DataPoint, NodeType>::max_depth() const
+{
+	return m_max_depth;
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::set_max_depth(int max_depth)
+{
+	m_max_depth = std::max(1, std::min(max_depth, PCA_KDTREE_MAX_DEPTH));
+}
+
+template<class DataPoint, class NodeType>
+KdTreeAutotuneResult KdTree<DataPoint, NodeType>::autotune_min_cell_size(const DataPoint* points, IndexType count,
+                                                                         const KdTreeAutotuneOptions& options)
+{
+	KdTreeAutotuneResult result;
+	result.min_cell_size = m_min_cell_size;
+	if(count <= 0 || options.candidates.empty() || (options.k <= 0 && options.radius <= 0))
+		return result;
+
+	// trial trees over a subset of the indices, sharing the points
+	const IndexType sampleSize = std::min(count, static_cast<IndexType>(std::max(1, options.sample_size)));
+	IndexContainer sampling(sampleSize);
+	for(IndexType i=0; i<sampleSize; ++i)
+		sampling[i] = static_cast<IndexType>(std::size_t(i) * count / sampleSize);
+	const IndexType queryCount = std::min(sampleSize, static_cast<IndexType>(std::max(1, options.query_count)));
+	// the sample being sparser than the input, the radius is scaled to keep the same number of neighbors
+	const Scalar radius = static_cast<Scalar>(options.radius * std::pow(double(count) / sampleSize, 1. / DataPoint::Dim));
+
+	KdTree trial;
+	trial.m_max_depth               = m_max_depth;
+	trial.m_parallel_build          = m_parallel_build;
+	trial.m_split_strategy          = m_split_strategy;
+	trial.m_tight_bounds            = m_tight_bounds;
+	trial.m_node_layout             = m_node_layout;
+	trial.m_use_leaf_positions      = m_use_leaf_positions;
+	trial.m_use_quantized_positions = m_use_quantized_positions;
+
+	double best = std::numeric_limits<double>::infinity();
+	for(int candidate : options.candidates)
+	{
+		double seconds = std::numeric_limits<double>::infinity();
+		try
+		{
+		    trial.set_min_cell_size(candidate);
+		    trial.build_view(points, count, sampling);
+
+		    KdTreeKNearestIndexQuery<DataPoint, NodeType> knn(&trial, std::max(1, options.k), sampling[0]);
+		    KdTreeRangeIndexQuery<DataPoint, NodeType> range(&trial, radius, sampling[0]);
+		    for(int r=0; r<std::max(1, options.repetitions); ++r)
+		    {
+		        const auto start = std::chrono::steady_clock::now();
+		        for(IndexType q=0; q<queryCount; ++q)
+		        {
+		            const IndexType index = sampling[std::size_t(q) * sampleSize / queryCount];
+		            if(options.k > 0)
+		                for(IndexType j : knn(index)) (void)j;
+		            if(options.radius > 0)
+		                for(IndexType j : range(index)) (void)j;
+		        }
+		        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		        seconds = std::min(seconds, elapsed.count());
+		    }
+		}
+		catch(const std::length_error&)
+		{
+		    // too many nodes for the node layout
+		}
+
+		result.candidates.push_back(candidate);
+		result.seconds.push_back(seconds);
+		if(seconds < best)
+		{
+		    best = seconds;
+		    result.min_cell_size = candidate;
+		}
+	}
+
+	m_min_cell_size = result.min_cell_size;
+	return result;
+}
+
+template<class DataPoint, class NodeType>
+bool KdTree<DataPoint, NodeType>::parallel_build() const
+{
+	return m_parallel_build;
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::set_parallel_build(bool parallel_build)
+{
+	m_parallel_build = parallel_build;
+}
+
+template<class DataPoint, class NodeType>
+KDTREE_SPLIT_STRATEGY KdTree<DataPoint, NodeType>::split_strategy() const
+{
+	return m_split_strategy;
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::set_split_strategy(KDTREE_SPLIT_STRATEGY split_strategy)
+{
+	m_split_strategy = split_strategy;
+}
+
+template<class DataPoint, class NodeType>
+bool KdTree<DataPoint, NodeType>::tight_bounds() const
+{
+	return m_tight_bounds;
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::set_tight_bounds(bool tight_bounds)
+{
+	m_tight_bounds = tight_bounds;
+}
+
+template<class DataPoint, class NodeType>
+KDTREE_NODE_LAYOUT KdTree<DataPoint, NodeType>::node_layout() const
+{
+	return m_node_layout;
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::set_node_layout(KDTREE_NODE_LAYOUT node_layout)
+{
+	m_node_layout = node_layout;
+}
+
+template<class DataPoint, class NodeType>
+bool KdTree<DataPoint, NodeType>::use_leaf_positions() const
+{
+	return m_use_leaf_positions;
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::set_use_leaf_positions(bool use_leaf_positions)
+{
+	m_use_leaf_positions = use_leaf_positions;
+}
+
+template<class DataPoint, class NodeType>
+bool KdTree<DataPoint, NodeType>::use_quantized_positions() const
+{
+	return m_use_quantized_positions;
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::set_use_quantized_positions(bool use_quantized_positions)
+{
+	m_use_quantized_positions = use_quantized_positions;
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::build_root()
+{
+	PONCA_TRACE_ZONE("ponca::KdTree::build_root");
+	m_nodes.emplace_back();
+	m_nodes.back().leaf = false;
+	m_nodes.back().duplicates = false;
+	m_node_bounds.clear();
+	m_node_bounds.emplace_back();
+
+	// the only pass over all the points: children bounds are then deduced from the split planes, and only
+	// shrunk to their points by the splits leaving one side empty
+	const Aabb aabb = this->compute_bounds(0, index_count());
+	this->sort_morton(0, index_count(), aabb);
+
+	bool parallel = false;
+#ifdef _OPENMP
+	parallel = m_parallel_build;
+	if(parallel)
+	{
+#pragma omp parallel
+#pragma omp single
+		this->build_rec(m_nodes, m_node_bounds, 0, 0, index_count(), 1, aabb, true);
+	}
+#endif
+	if(!parallel)
+		this->build_rec(m_nodes, m_node_bounds, 0, 0, index_count(), 1, aabb, false);
+
+	this->clear_morton();
+	this->check_node_limits();
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::check_node_limits()
+{
+	if(m_nodes.size() > NodeType::MAX_COUNT)
+	{
+	    this->clear();
+	    throw std::length_error("KdTree: too many nodes for the node layout, use KdTreeWideNode");
+	}
+
+	// leaves partition the indices, a truncated leaf size shows up as missing indices
+	std::size_t total = 0;
+	for(const NodeType& node : m_nodes)
+	{
+	    if(node.leaf)
+	        total += node.size;
+	}
+	if(total != m_indices.size())
+	{
+	    this->clear();
+	    throw std::length_error("KdTree: too many indices in a leaf for the node layout, use KdTreeWideNode");
+	}
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::build_rec(int node_id, IndexType start, IndexType end, int level)
+{
+	const Aabb aabb = this->compute_bounds(start, end);
+	this->sort_morton(start, end, aabb);
+
+	m_node_bounds.resize(m_nodes.size());
+	this->build_rec(m_nodes, m_node_bounds, node_id, start, end, level, aabb, false);
+	this->clear_morton();
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::build_rec(NodeContainer& nodes, AabbContainer& bounds, int node_id, IndexType start, IndexType end, int level,
+                                            const Aabb& aabb, bool parallel)
+{
+	NodeType& node = nodes[node_id];
 	
+	Aabb box = aabb;
 	int dim;
-	(Scalar(0.5) * (aabb.max() - aabb.min())).maxCoeff(&dim);
+	Scalar splitValue;
+	IndexType midId;
+	if(this->same_positions(start, end))
+	{
+	    // duplicates exceeding a leaf: both halves lie on the split plane
+	    dim = 0;
+	    splitValue = this->point_buffer()[this->index_buffer()[start]].pos()(0);
+	    midId = start + (end-start)/2;
+	}
+	else
+	    midId = this->split(start, end, box, dim, splitValue);
 	node.dim = dim;
-	node.splitValue = aabb.center()(dim);
-	
-	int midId = this->partition(start, end, dim, node.splitValue);
-	node.firstChildId = m_nodes.size();
+	node.splitValue = splitValue;
+	node.firstChildId = nodes.size();
 	
 	{
-	    KdTreeNode<Scalar> n;
+	    NodeType n;
 	    n.size = 0;
-		m_nodes.push_back(n);
-		m_nodes.push_back(n);
+		nodes.push_back(n);
+		nodes.push_back(n);
 	}
+	bounds[node_id] = box;
+	bounds.resize(nodes.size());
+
+	// children bounds are given by the parent bounds cut by the split plane
+	Aabb leftAabb = box, rightAabb = box;
+	leftAabb.max()(dim)  = splitValue;
+	rightAabb.min()(dim) = splitValue;
+
+	const int leftId  = nodes[node_id].firstChildId;
+	const int rightId = leftId+1;
+	// points sharing the same position are gathered in a leaf whatever its size, the scan of such leaves
+	// stopping at the first rejected point
+	const bool leftDuplicates  = this->is_duplicate_leaf(start, midId);
+	const bool rightDuplicates = this->is_duplicate_leaf(midId, end);
+	const bool leftIsLeaf  = midId-start <= m_min_cell_size || level >= m_max_depth || leftDuplicates;
+	const bool rightIsLeaf = end-midId   <= m_min_cell_size || level >= m_max_depth || rightDuplicates;
 	{
 	    // left child
-	    int childId = m_nodes[node_id].firstChildId;
-	    KdTreeNode<Scalar>& child = m_nodes[childId];
-	    if(midId-start <= m_min_cell_size || level >= PCA_KDTREE_MAX_DEPTH)
+	    NodeType& child = nodes[leftId];
+	    child.leaf = leftIsLeaf;
+	    child.duplicates = leftDuplicates;
+	    if(leftIsLeaf)
 	    {
-	        child.leaf = 1;
 	        child.start = start;
 	        child.size = midId-start;
-	    }
-	    else
-	    {
-	        child.leaf = 0;
-	        this->build_rec(childId, start, midId, level+1);
+	        bounds[leftId] = m_tight_bounds ? this->compute_bounds(start, midId) : leftAabb;
 	    }
 	}
 	{
 	    // right child
-	    int childId = m_nodes[node_id].firstChildId+1;
-	    KdTreeNode<Scalar>& child = m_nodes[childId];
-	    if(end-midId <= m_min_cell_size || level >= PCA_KDTREE_MAX_DEPTH)
+	    NodeType& child = nodes[rightId];
+	    child.leaf = rightIsLeaf;
+	    child.duplicates = rightDuplicates;
+	    if(rightIsLeaf)
 	    {
-	        child.leaf = 1;
 	        child.start = midId;
 	        child.size = end-midId;
+	        bounds[rightId] = m_tight_bounds ? this->compute_bounds(midId, end) : rightAabb;
 	    }
-	    else
+	}
+
+	if(parallel && !leftIsLeaf && !rightIsLeaf && end-start >= PCA_KDTREE_PARALLEL_MIN_SIZE)
+	{
+	    // the right subtree is built in its own node block, concurrently with the left one
+	    NodeContainer rightNodes(1);
+	    AabbContainer rightBounds(1);
+#pragma omp task default(shared) firstprivate(midId, end, level)
+	    this->build_rec(rightNodes, rightBounds, 0, midId, end, level+1, rightAabb, true);
+
+	    this->build_rec(nodes, bounds, leftId, start, midId, level+1, leftAabb, true);
+#pragma omp taskwait
+	    splice(nodes, bounds, rightId, rightNodes, rightBounds);
+	}
+	else
+	{
+	    if(!leftIsLeaf)
+	        this->build_rec(nodes, bounds, leftId, start, midId, level+1, leftAabb, parallel);
+	    if(!rightIsLeaf)
+	        this->build_rec(nodes, bounds, rightId, midId, end, level+1, rightAabb, parallel);
+	}
+
+	// tight leaf bounds are propagated to the ancestors
+	if(m_tight_bounds)
+	    bounds[node_id] = bounds[leftId].merged(bounds[rightId]);
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::splice(NodeContainer& nodes, AabbContainer& bounds, int node_id,
+                               const NodeContainer& block, const AabbContainer& blockBounds)
+{
+	// block[0] replaces nodes[node_id], block[i>0] is appended at nodes.size()+i-1
+	const int offset = static_cast<int>(nodes.size()) - 1;
+	nodes.reserve(nodes.size() + block.size() - 1);
+
+	nodes[node_id] = block[0];
+	if(!nodes[node_id].leaf)
+	    nodes[node_id].firstChildId += offset;
+
+	for(auto it = block.begin()+1; it != block.end(); ++it)
+	{
+	    nodes.push_back(*it);
+	    if(!nodes.back().leaf)
+	        nodes.back().firstChildId += offset;
+	}
+
+	bounds[node_id] = blockBounds[0];
+	bounds.insert(bounds.end(), blockBounds.begin()+1, blockBounds.end());
+}
+
+template<class DataPoint, class NodeType>
+bool KdTree<DataPoint, NodeType>::same_positions(IndexType start, IndexType end) const
+{
+	const DataPoint* points = this->point_buffer();
+	const IndexType* indices = this->index_buffer();
+	for(IndexType i=start+1; i<end; ++i)
+	{
+	    if(points[indices[i]].pos() != points[indices[start]].pos())
+	        return false;
+	}
+	return end-start >= 2;
+}
+
+template<class DataPoint, class NodeType>
+bool KdTree<DataPoint, NodeType>::is_duplicate_leaf(IndexType start, IndexType end) const
+{
+	return std::size_t(end-start) <= NodeType::MAX_LEAF_SIZE && this->same_positions(start, end);
+}
+
+template<class DataPoint, class NodeType>
+typename KdTree<DataPoint, NodeType>::Aabb KdTree<DataPoint, NodeType>::compute_bounds(IndexType start, IndexType end) const
+{
+	Aabb aabb;
+	for(IndexType i=start; i<end; ++i)
+	    aabb.extend(this->point(m_indices[i]).pos());
+	return aabb;
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::layout_nodes()
+{
+	PONCA_TRACE_ZONE("ponca::KdTree::layout_nodes");
+	if(m_node_layout == NODE_LAYOUT_DEPTH_FIRST || m_nodes.size() < 2)
+	    return;
+
+	// The nodes are ordered by units: the root, then the pairs of siblings, identified by their first node.
+	// The units form a binary tree, the children of a pair being the pairs of children of its two nodes.
+	const auto children = [this](int unit, int size, int* out)
+	{
+	    int count = 0;
+	    for(int n=unit; n<unit+size; ++n)
+	        if(!m_nodes[n].leaf)
+	            out[count++] = int(m_nodes[n].firstChildId);
+	    return count;
+	};
+	std::vector<int> order; // units in their new order
+	order.reserve(m_nodes.size() / 2 + 1);
+
+	if(m_node_layout == NODE_LAYOUT_BREADTH_FIRST)
+	{
+	    order.push_back(0);
+	    for(std::size_t u=0; u<order.size(); ++u)
+	    {
+	        int next[2];
+	        const int count = children(order[u], order[u] == 0 ? 1 : 2, next);
+	        order.insert(order.end(), next, next + count);
+	    }
+	}
+	else
+	{
+	    // height of the tree of units
+	    int height = 0;
+	    std::vector<int> level {0}, nextLevel;
+	    while(!level.empty())
 	    {
-	        child.leaf = 0;
-	        this->build_rec(childId, midId, end, level+1);
+	        ++height;
+	        nextLevel.clear();
+	        for(int unit : level)
+	        {
+	            int next[2];
+	            const int count = children(unit, unit == 0 ? 1 : 2, next);
+	            nextLevel.insert(nextLevel.end(), next, next + count);
+	        }
+	        std::swap(level, nextLevel);
 	    }
+
+	    // store the top half of the subtree rooted at `unit`, then each of its bottom subtrees
+	    const auto veb = [&](const auto& self, int unit, int h) -> void
+	    {
+	        if(h == 1)
+	        {
+	            order.push_back(unit);
+	            return;
+	        }
+	        const int top = h / 2;
+	        self(self, unit, top);
+
+	        // roots of the bottom subtrees, `top` levels below `unit`
+	        std::vector<int> roots {unit}, next;
+	        for(int l=0; l<top && !roots.empty(); ++l)
+	        {
+	            next.clear();
+	            for(int r : roots)
+	            {
+	                int c[2];
+	                const int count = children(r, r == 0 ? 1 : 2, c);
+	                next.insert(next.end(), c, c + count);
+	            }
+	            std::swap(roots, next);
+	        }
+	        for(int r : roots)
+	            self(self, r, h - top);
+	    };
+	    veb(veb, 0, height);
 	}
+
+	// new ids of the nodes, the nodes of a unit staying adjacent
+	std::vector<int> ids(m_nodes.size());
+	int id = 0;
+	for(int unit : order)
+	    for(int n=unit; n<unit+(unit == 0 ? 1 : 2); ++n)
+	        ids[n] = id++;
+	PONCA_DEBUG_ASSERT(id == int(m_nodes.size()));
+
+	NodeContainer nodes(m_nodes.size());
+	AabbContainer bounds(m_node_bounds.size());
+	for(std::size_t n=0; n<m_nodes.size(); ++n)
+	{
+	    nodes[ids[n]] = m_nodes[n];
+	    if(!m_nodes[n].leaf)
+	        nodes[ids[n]].firstChildId = ids[m_nodes[n].firstChildId];
+	    bounds[ids[n]] = m_node_bounds[n];
+	}
+	m_nodes.swap(nodes);
+	m_node_bounds.swap(bounds);
 }
 
-template<class DataPoint>
-int KdTree<DataPoint>::partition(int start, int end, int dim, Scalar value)
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::build_leaf_positions()
 {
-	const auto& points = m_points;
+	PONCA_TRACE_ZONE("ponca::KdTree::build_leaf_positions");
+	if(!m_use_leaf_positions)
+	{
+	    m_leaf_positions.resize(0, DataPoint::Dim);
+	}
+	else
+	{
+	    m_leaf_positions.resize(index_count(), DataPoint::Dim);
+	    for(IndexType i=0; i<index_count(); ++i)
+	        m_leaf_positions.row(i) = this->point(this->index_buffer()[i]).pos().transpose();
+	}
+
+	if(!m_use_quantized_positions)
+	{
+	    m_quantized_positions.resize(0, DataPoint::Dim);
+	    m_quantization_origins.resize(0, DataPoint::Dim);
+	    m_quantization_steps.resize(0, DataPoint::Dim);
+	    return;
+	}
+
+	constexpr int Block = PCA_KDTREE_QUANTIZATION_BLOCK_SIZE;
+	constexpr Scalar Levels = Scalar(std::numeric_limits<std::uint16_t>::max());
+	const IndexType* indices = this->index_buffer();
+	const IndexType blockCount = (index_count() + Block - 1) / Block;
+	m_quantized_positions.resize(index_count(), DataPoint::Dim);
+	m_quantization_origins.resize(blockCount, DataPoint::Dim);
+	m_quantization_steps.resize(blockCount, DataPoint::Dim);
+	for(IndexType b=0; b<blockCount; ++b)
+	{
+	    const IndexType start = b * Block, end = std::min<IndexType>(start + Block, index_count());
+	    Aabb aabb;
+	    for(IndexType i=start; i<end; ++i)
+	        aabb.extend(this->point(indices[i]).pos());
+
+	    // the step stays above the rounding errors of the dequantization, so that a position is always closer
+	    // than one step to its quantized value
+	    const VectorType magnitude = aabb.min().cwiseAbs().cwiseMax(aabb.max().cwiseAbs());
+	    const VectorType step = (aabb.sizes() / Levels).cwiseMax(
+	        Scalar(8) * std::numeric_limits<Scalar>::epsilon() * magnitude);
+	    m_quantization_origins.row(b) = aabb.min().transpose();
+	    m_quantization_steps.row(b)   = step.transpose();
+	    for(IndexType i=start; i<end; ++i)
+	    {
+	        const VectorType& p = this->point(indices[i]).pos();
+	        for(int k=0; k<DataPoint::Dim; ++k)
+	        {
+	            const Scalar q = step(k) > Scalar(0) ? std::round((p(k) - aabb.min()(k)) / step(k)) : Scalar(0);
+	            m_quantized_positions(i, k) = static_cast<std::uint16_t>(std::min(std::max(q, Scalar(0)), Levels));
+	        }
+	    }
+	}
+}
+
+template<class DataPoint, class NodeType>
+typename KdTree<DataPoint, NodeType>::IndexType KdTree<DataPoint, NodeType>::partition(IndexType start, IndexType end, int dim, Scalar value)
+{
+	const DataPoint* points = this->point_buffer();
 	auto& indices  = m_indices;
 	
-	auto it = std::partition(indices.begin()+start, indices.begin()+end, [&](int i)
+	auto it = std::partition(indices.begin()+start, indices.begin()+end, [&](IndexType i)
 	{
 	    return points[i].pos()[dim] < value;
 	});
 	    
 	auto distance = std::distance(m_indices.begin(), it);
 	
-	return static_cast<int>(distance);
+	return static_cast<IndexType>(distance);
+}
+
+
+template<class DataPoint, class NodeType>
+typename KdTree<DataPoint, NodeType>::IndexType KdTree<DataPoint, NodeType>::split(IndexType start, IndexType end, Aabb& aabb, int& dim, Scalar& value)
+{
+	(Scalar(0.5) * (aabb.max() - aabb.min())).maxCoeff(&dim);
+
+	switch(m_split_strategy)
+	{
+	case SPLIT_MEDIAN:
+	    return this->split_median(start, end, dim, value);
+	case SPLIT_SLIDING_MIDPOINT:
+	    return this->split_sliding_midpoint(start, end, aabb, dim, value);
+	case SPLIT_MORTON:
+	    return this->split_morton(start, end, dim, value);
+	default:
+	    break;
+	}
+
+	const auto splitBox = [&]()
+	{
+	    if(m_split_strategy == SPLIT_SAH)
+	        return this->split_sah(start, end, aabb, dim, value);
+	    value = aabb.center()(dim);
+	    return this->partition(start, end, dim, value);
+	};
+	const IndexType midId = splitBox();
+	if(midId != start && midId != end)
+	    return midId;
+
+	// the box cut by the ancestors is loose around a cluster of points, which would stay on the same side for
+	// many levels: the box is shrunk to the points, whose midpoint is then strictly inside their bounds
+	aabb = this->compute_bounds(start, end);
+	(Scalar(0.5) * (aabb.max() - aabb.min())).maxCoeff(&dim);
+	return splitBox();
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::sort_morton(IndexType start, IndexType end, const Aabb& aabb)
+{
+	if(m_split_strategy != SPLIT_MORTON)
+	    return;
+
+	m_morton_codes.resize(index_count());
+	morton_codes(this->point_buffer(), m_indices.data() + start, end - start, aabb, m_morton_codes.data() + start);
+	morton_sort(m_morton_codes.data() + start, m_indices.data() + start, end - start);
+}
+
+template<class DataPoint, class NodeType>
+void KdTree<DataPoint, NodeType>::clear_morton()
+{
+	// the capacity is kept for the next builds, see shrink_to_fit()
+	m_morton_codes.clear();
+}
+
+template<class DataPoint, class NodeType>
+typename KdTree<DataPoint, NodeType>::IndexType KdTree<DataPoint, NodeType>::split_morton(IndexType start, IndexType end, int& dim, Scalar& value)
+{
+	const std::uint64_t* codes = m_morton_codes.data();
+
+	// points in the same Morton cell
+	const std::uint64_t diff = codes[start] ^ codes[end-1];
+	if(diff == 0)
+	    return this->split_median(start, end, dim, value);
+
+	int bit = 63;
+	while(((diff >> bit) & 1u) == 0)
+	    --bit;
+	dim = morton_dimension<DataPoint::Dim>(bit);
+
+	// the codes share their bits above `bit`: the right child starts at the first code with `bit` set
+	const std::uint64_t* mid = std::partition_point(codes + start, codes + end, [bit](std::uint64_t code)
+	{
+	    return ((code >> bit) & 1u) == 0;
+	});
+	const IndexType midId = static_cast<IndexType>(mid - codes);
+
+	// the quantization is monotonic: the left points are strictly below the lowest right point
+	const DataPoint* points = this->point_buffer();
+	value = points[m_indices[midId]].pos()[dim];
+	for(IndexType i=midId+1; i<end; ++i)
+	    value = std::min(value, points[m_indices[i]].pos()[dim]);
+	return midId;
 }
 
+template<class DataPoint, class NodeType>
+typename KdTree<DataPoint, NodeType>::IndexType KdTree<DataPoint, NodeType>::split_median(IndexType start, IndexType end, int dim, Scalar& value)
+{
+	const DataPoint* points = this->point_buffer();
+	const IndexType midId = start + (end-start)/2;
+
+	// elements before midId are lower or equal to the median, elements after are greater or equal
+	std::nth_element(m_indices.begin()+start, m_indices.begin()+midId, m_indices.begin()+end, [&](IndexType a, IndexType b)
+	{
+	    return points[a].pos()[dim] < points[b].pos()[dim];
+	});
+
+	value = points[m_indices[midId]].pos()[dim];
+	return midId;
+}
+
+template<class DataPoint, class NodeType>
+typename KdTree<DataPoint, NodeType>::IndexType KdTree<DataPoint, NodeType>::split_sliding_midpoint(IndexType start, IndexType end, const Aabb& aabb, int dim,
+                                                    Scalar& value)
+{
+	const DataPoint* points = this->point_buffer();
+	const auto compare = [&](IndexType a, IndexType b) { return points[a].pos()[dim] < points[b].pos()[dim]; };
+
+	value = aabb.center()(dim);
+	const IndexType midId = this->partition(start, end, dim, value);
+
+	if(midId == start)
+	{
+	    // all points are on the right: slide the plane to the lowest one, which goes to the left child
+	    auto it = std::min_element(m_indices.begin()+start, m_indices.begin()+end, compare);
+	    std::iter_swap(m_indices.begin()+start, it);
+	    value = points[m_indices[start]].pos()[dim];
+	    return start+1;
+	}
+	if(midId == end)
+	{
+	    // all points are on the left: slide the plane to the highest one, which goes to the right child
+	    auto it = std::max_element(m_indices.begin()+start, m_indices.begin()+end, compare);
+	    std::iter_swap(m_indices.begin()+end-1, it);
+	    value = points[m_indices[end-1]].pos()[dim];
+	    return end-1;
+	}
+	return midId;
+}
+
+template<class DataPoint, class NodeType>
+typename KdTree<DataPoint, NodeType>::IndexType KdTree<DataPoint, NodeType>::split_sah(IndexType start, IndexType end, const Aabb& aabb, int dim, Scalar& value)
+{
+	constexpr int nbBins = 32;
+
+	const DataPoint* points = this->point_buffer();
+	const VectorType diag = aabb.max() - aabb.min();
+	const Scalar low    = aabb.min()(dim);
+	const Scalar extent = diag(dim);
+
+	// half surface area of a box, generalized to any dimension
+	const auto area = [](const VectorType& d)
+	{
+	    Scalar a = Scalar(0);
+	    for(int i=0; i<d.size(); ++i)
+	        for(int j=i+1; j<d.size(); ++j)
+	            a += d(i)*d(j);
+	    return a;
+	};
+
+	int bestBin = -1;
+	if(extent > Scalar(0))
+	{
+	    std::array<IndexType, nbBins> counts;
+	    counts.fill(0);
+	    for(IndexType i=start; i<end; ++i)
+	    {
+	        int b = static_cast<int>((points[m_indices[i]].pos()[dim] - low) / extent * Scalar(nbBins));
+	        ++counts[std::min(std::max(b, 0), nbBins-1)];
+	    }
+
+	    Scalar bestCost = std::numeric_limits<Scalar>::max();
+	    IndexType nl = 0;
+	    for(int b=1; b<nbBins; ++b)
+	    {
+	        nl += counts[b-1];
+	        const IndexType nr = (end-start) - nl;
+	        if(nl == 0 || nr == 0) continue;
+
+	        VectorType dl = diag, dr = diag;
+	        dl(dim) = extent * Scalar(b) / Scalar(nbBins);
+	        dr(dim) = extent - dl(dim);
+	        const Scalar cost = Scalar(nl) * area(dl) + Scalar(nr) * area(dr);
+	        if(cost < bestCost)
+	        {
+	            bestCost = cost;
+	            bestBin  = b;
+	        }
+	    }
+	}
+
+	// fallback to the midpoint when all the points fall in the same bin
+	value = bestBin < 0 ? aabb.center()(dim) : low + extent * Scalar(bestBin) / Scalar(nbBins);
+	return this->partition(start, end, dim, value);
+}
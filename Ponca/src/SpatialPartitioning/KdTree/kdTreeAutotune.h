@@ -0,0 +1,48 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Ponca {
+
+/// \brief Candidates and query mix timed by KdTree::autotune_min_cell_size
+/// \ingroup spatialpartitioning
+struct KdTreeAutotuneOptions
+{
+    std::vector<int> candidates {8, 16, 32, 64, 128, 256}; ///< Leaf sizes tried
+    int sample_size {100000}; ///< Number of points of the trial trees, evenly spread in the input
+    int query_count {2000};   ///< Number of queries of each kind timed on each trial tree
+    int k           {16};     ///< Number of neighbors of the k-nearest neighbors queries, 0 to skip them
+    double radius   {0};      ///< Radius of the range queries over the whole input, 0 to skip them
+    int repetitions {3};      ///< Number of runs of the query mix, the fastest one being kept
+};
+
+/// \brief Leaf size selected by KdTree::autotune_min_cell_size, and the time of the query mix with each candidate
+/// \ingroup spatialpartitioning
+struct KdTreeAutotuneResult
+{
+    int min_cell_size {0};
+    std::vector<int> candidates;
+    std::vector<double> seconds; ///< Time of the query mix with each candidate, infinite when its tree failed
+
+    /// \brief Human readable report
+    inline std::string to_string() const
+    {
+        std::stringstream str;
+        for(std::size_t i = 0; i < candidates.size(); ++i)
+        {
+            str << "min_cell_size " << candidates[i] << ": " << seconds[i] * 1e3 << " ms"
+                << (candidates[i] == min_cell_size ? " (selected)" : "") << "\n";
+        }
+        return str.str();
+    }
+};
+
+} // namespace Ponca
@@ -0,0 +1,139 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./kdTree.h"
+#include "../indexSquaredDistance.h"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace Ponca {
+
+/// \brief Point of a descriptor space of dimension `_Dim`, e.g. the GLS descriptors of computeGlsDescriptors
+/// \ingroup spatialpartitioning
+template<typename _Scalar, int _Dim>
+class DescriptorPoint
+{
+public:
+    enum {Dim = _Dim};
+    typedef _Scalar Scalar;
+    typedef Eigen::Matrix<Scalar, Dim, 1> VectorType;
+
+    inline DescriptorPoint(const VectorType& pos = VectorType::Zero()) : m_pos(pos) {}
+
+    inline const VectorType& pos() const { return m_pos; }
+    inline       VectorType& pos()       { return m_pos; }
+
+private:
+    VectorType m_pos;
+};
+
+/*!
+    \brief Nearest descriptor search among arrays of descriptors of `Dim` values, e.g. multi-scale GLS descriptors
+
+    The descriptors are copied into the points of a KdTree of dimension `Dim`: the queries return the index of the
+    descriptors in the input array, and the squared euclidean distance between descriptors, which is the sum over
+    the scales of GLSParam::compareTo for the descriptors of computeGlsDescriptors. A query visits the nodes close
+    to the descriptor instead of comparing it with all the others.
+
+    \code
+    // descriptors of 3 scales, see glsDescriptorSize
+    KdTreeDescriptorIndex<9> index(descriptors.data(), pointCount);
+    Scalar distance;
+    const int match = index.nearest(queryDescriptor, &distance);
+    \endcode
+
+    \tparam Dim Number of values of a descriptor
+    \ingroup spatialpartitioning
+*/
+template<int Dim, typename Scalar = float>
+class KdTreeDescriptorIndex
+{
+public:
+    using Point      = DescriptorPoint<Scalar, Dim>;
+    using VectorType = typename Point::VectorType;
+    using Tree       = KdTree<Point>;
+    using Neighbor   = IndexSquaredDistance<Scalar>;
+
+    /// \brief Index the `count` descriptors stored one after the other in `descriptors`
+    inline KdTreeDescriptorIndex(const Scalar* descriptors, int count) : m_tree(to_points(descriptors, count)) {}
+
+    /// \brief Index the descriptors of `sampling` among the `count` descriptors of `descriptors`, e.g. the ones whose
+    /// fits are stable at all the scales
+    template<typename IndexUserContainer>
+    inline KdTreeDescriptorIndex(const Scalar* descriptors, int count, const IndexUserContainer& sampling)
+        : m_tree(to_points(descriptors, count), sampling) {}
+
+    /// \brief Number of indexed descriptors
+    inline int descriptor_count() const { return int(m_tree.index_count()); }
+
+    inline const Tree& tree() const { return m_tree; }
+
+    /// \brief Index of the nearest indexed descriptor of `descriptor`, -1 when there is none
+    /// \param squared_distance When not null, receives the squared distance between the descriptors
+    inline int nearest(const Scalar* descriptor, Scalar* squared_distance = nullptr) const
+    {
+        const VectorType d = VectorType::Map(descriptor);
+        int result = -1;
+        for (int j : m_tree.nearest_neighbor(d))
+            result = j;
+        if (squared_distance != nullptr && result >= 0)
+            *squared_distance = (m_tree.point(result).pos() - d).squaredNorm();
+        return result;
+    }
+
+    /// \brief The `k` nearest indexed descriptors of `descriptor`, sorted by increasing squared distance
+    inline void k_nearest(const Scalar* descriptor, int k, std::vector<Neighbor>& neighbors) const
+    {
+        const VectorType d = VectorType::Map(descriptor);
+        neighbors.clear();
+        for (int j : m_tree.k_nearest_neighbors(d, k))
+            neighbors.push_back({j, (m_tree.point(j).pos() - d).squaredNorm()});
+        std::sort(neighbors.begin(), neighbors.end());
+    }
+
+    /// \brief Index of the nearest indexed descriptor of each of the `count` descriptors of `queries`, in parallel
+    ///
+    /// Each thread reuses a nearest query. `squared_distances` is not written when null.
+    inline void nearest_batch(const Scalar* queries, int count, int* nearest,
+                              Scalar* squared_distances = nullptr) const
+    {
+#pragma omp parallel
+        {
+            auto query = m_tree.nearest_neighbor(VectorType::Zero().eval());
+
+#pragma omp for schedule(static)
+            for (int i = 0; i < count; ++i)
+            {
+                const VectorType d = VectorType::Map(queries + std::size_t(i) * Dim);
+                int result = -1;
+                for (int j : query(d))
+                    result = j;
+                nearest[i] = result;
+                if (squared_distances != nullptr)
+                    squared_distances[i] = result >= 0 ? (m_tree.point(result).pos() - d).squaredNorm() : Scalar(0);
+            }
+        }
+    }
+
+private:
+    static inline std::vector<Point> to_points(const Scalar* descriptors, int count)
+    {
+        std::vector<Point> points(count);
+        for (int i = 0; i < count; ++i)
+            points[i].pos() = VectorType::Map(descriptors + std::size_t(i) * Dim);
+        return points;
+    }
+
+    Tree m_tree;
+};
+
+} // namespace Ponca
@@ -0,0 +1,664 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./kdTreeNode.h"
+#include "./kdTreeQuery.h" // PCA_KDTREE_MAX_DEPTH
+#include "../defines.h"
+#include "../morton.h"
+
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <utility>
+#include <vector>
+
+#ifdef __CUDACC__
+#include <cuda_runtime.h>
+#include <thrust/device_ptr.h>
+#include <thrust/device_vector.h>
+#include <thrust/execution_policy.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/scan.h>
+#include <thrust/sort.h>
+#include <thrust/transform_reduce.h>
+#endif
+
+namespace Ponca {
+template<class DataPoint, class NodeType> class KdTree;
+
+/// \brief Non-owning flat view of the buffers of a KdTree, queried by `PONCA_MULTIARCH` functions
+///
+/// The view stores raw pointers to the points, nodes and indices of a tree, and provides allocation-free
+/// depth-first traversals with fixed-size stacks, so that the tree can be queried from CUDA kernels, e.g. to fit
+/// a Basket directly on an unstructured point cloud:
+/// \code
+/// __global__ void fit_kernel(KdTreeDeviceView<Point> tree, Scalar r, Scalar* potentials)
+/// {
+///     const int i = blockIdx.x * blockDim.x + threadIdx.x;
+///     if(i >= tree.point_count) return;
+///     const auto& p = tree.points[i];
+///     Fit fit;
+///     fit.setWeightFunc(WeightFunc(r));
+///     fit.init(p.pos());
+///     tree.range_neighbors(p.pos(), r, [&](int j, Scalar) { fit.addNeighbor(tree.points[j]); });
+///     fit.finalize();
+///     potentials[i] = fit.potential(p.pos());
+/// }
+/// \endcode
+///
+/// The tree is either built on the device by KdTreeDeviceBuffers::build(), or built on the host and copied to the
+/// device by KdTreeDeviceBuffers::upload(). The node bounds are not used: the traversals prune the nodes with the
+/// split planes only.
+/// \ingroup spatialpartitioning
+template<class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+struct KdTreeDeviceView
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using IndexType  = typename NodeType::IndexType;
+
+    /// \brief Size of the traversal stacks, the depth of the trees being bounded by PCA_KDTREE_MAX_DEPTH
+    static constexpr int StackSize = 2 * PCA_KDTREE_MAX_DEPTH;
+
+    const DataPoint* points  {nullptr};
+    const NodeType*  nodes   {nullptr};
+    const IndexType* indices {nullptr};
+    IndexType point_count {0};
+    int node_count  {0};
+
+    /// \brief Call `f(index, squared_distance)` for each point closer than `r` to `point`
+    template<typename Functor>
+    PONCA_MULTIARCH inline void range_neighbors(const VectorType& point, Scalar r, Functor f) const
+    {
+        if(node_count == 0) return;
+        const Scalar squared_radius = r * r;
+
+        int stack[StackSize];
+        Scalar offsets[StackSize];
+        int size = 1;
+        stack[0] = 0;
+        offsets[0] = Scalar(0);
+        while(size > 0)
+        {
+            --size;
+            if(offsets[size] >= squared_radius) continue;
+            const NodeType& node = nodes[stack[size]];
+            if(node.leaf)
+            {
+                for(IndexType i = IndexType(node.start); i < IndexType(node.start + node.size); ++i)
+                {
+                    const IndexType idx = indices[i];
+                    const Scalar d = (points[idx].pos() - point).squaredNorm();
+                    if(d < squared_radius) f(idx, d);
+                }
+            }
+            else
+            {
+                // the closest child is visited first
+                const Scalar offset = point[node.dim] - node.splitValue;
+                const int first = int(node.firstChildId);
+                stack[size]   = offset < Scalar(0) ? first+1 : first;
+                offsets[size] = offset * offset;
+                stack[size+1]   = offset < Scalar(0) ? first : first+1;
+                offsets[size+1] = Scalar(0);
+                size += 2;
+            }
+        }
+    }
+
+    /// \brief Compute the `K` nearest neighbors of `point`, sorted by increasing distance
+    ///
+    /// \param neighbors Receives the indices of the neighbors, -1 when the tree has less than `K` points
+    /// \param squared_distances Receives the squared distances of the neighbors, may be null
+    /// \return the number of neighbors found
+    template<int K>
+    PONCA_MULTIARCH inline int k_nearest_neighbors(const VectorType& point, IndexType* neighbors,
+                                                   Scalar* squared_distances = nullptr) const
+    {
+        Scalar distances[K];
+        for(int k = 0; k < K; ++k)
+        {
+            neighbors[k] = -1;
+            distances[k] = Eigen::NumTraits<Scalar>::highest();
+        }
+        int found = 0;
+        if(node_count > 0)
+        {
+            int stack[StackSize];
+            Scalar offsets[StackSize];
+            int size = 1;
+            stack[0] = 0;
+            offsets[0] = Scalar(0);
+            while(size > 0)
+            {
+                --size;
+                if(offsets[size] >= distances[K-1]) continue;
+                const NodeType& node = nodes[stack[size]];
+                if(node.leaf)
+                {
+                    for(IndexType i = IndexType(node.start); i < IndexType(node.start + node.size); ++i)
+                    {
+                        const IndexType idx = indices[i];
+                        const Scalar d = (points[idx].pos() - point).squaredNorm();
+                        if(d >= distances[K-1]) continue;
+
+                        // insertion in the sorted neighbors
+                        int k = K-1;
+                        for(; k > 0 && distances[k-1] > d; --k)
+                        {
+                            distances[k] = distances[k-1];
+                            neighbors[k] = neighbors[k-1];
+                        }
+                        distances[k] = d;
+                        neighbors[k] = idx;
+                        if(found < K) ++found;
+                    }
+                }
+                else
+                {
+                    const Scalar offset = point[node.dim] - node.splitValue;
+                    const int first = int(node.firstChildId);
+                    stack[size]   = offset < Scalar(0) ? first+1 : first;
+                    offsets[size] = offset * offset;
+                    stack[size+1]   = offset < Scalar(0) ? first : first+1;
+                    offsets[size+1] = Scalar(0);
+                    size += 2;
+                }
+            }
+        }
+        if(squared_distances != nullptr)
+            for(int k = 0; k < K; ++k)
+                squared_distances[k] = distances[k];
+        return found;
+    }
+
+    /// \brief Index of the nearest neighbor of `point`, or -1 when the tree is empty
+    PONCA_MULTIARCH inline IndexType nearest_neighbor(const VectorType& point, Scalar* squared_distance = nullptr) const
+    {
+        IndexType nearest;
+        k_nearest_neighbors<1>(point, &nearest, squared_distance);
+        return nearest;
+    }
+};
+
+namespace internal {
+
+#ifdef __CUDACC__
+/// \brief Lower `*address` to `value`, by compare and swap
+__device__ inline void device_atomic_min(float* address, float value)
+{
+    int* bits = reinterpret_cast<int*>(address);
+    int old = *bits;
+    while(value < __int_as_float(old))
+    {
+        const int assumed = old;
+        old = atomicCAS(bits, assumed, __float_as_int(value));
+        if(old == assumed) break;
+    }
+}
+
+/// \copydoc device_atomic_min(float*,float)
+__device__ inline void device_atomic_min(double* address, double value)
+{
+    unsigned long long* bits = reinterpret_cast<unsigned long long*>(address);
+    unsigned long long old = *bits;
+    while(value < __longlong_as_double(static_cast<long long>(old)))
+    {
+        const unsigned long long assumed = old;
+        old = atomicCAS(bits, assumed, static_cast<unsigned long long>(__double_as_longlong(value)));
+        if(old == assumed) break;
+    }
+}
+#endif
+
+/// \brief Bounding box of the point `i`, reduced by MortonMergeBoxes
+template<class DataPoint>
+struct MortonPointBox
+{
+    const DataPoint* points;
+
+    template<typename Index>
+    PONCA_MULTIARCH inline Eigen::AlignedBox<typename DataPoint::Scalar, DataPoint::Dim> operator()(Index i) const
+    {
+        return Eigen::AlignedBox<typename DataPoint::Scalar, DataPoint::Dim>(points[i].pos());
+    }
+};
+
+struct MortonMergeBoxes
+{
+    template<class Aabb>
+    PONCA_MULTIARCH inline Aabb operator()(const Aabb& a, const Aabb& b) const { return a.merged(b); }
+};
+
+/// \brief Steps of the level by level build of a tree from the Morton codes of its points, over raw buffers
+///
+/// Each step processes one point or one node of the current level, so that the same code runs in CUDA kernels
+/// (KdTreeDeviceBuffers::build) and in host loops (kdtree_morton_build). The nodes of a level are stored
+/// contiguously, and split as by KdTree::split_morton: at the highest bit differing between the codes of their
+/// points, with the lowest coordinate of their right points as split value.
+template<class DataPoint, class NodeType>
+struct MortonBuildSteps
+{
+    using Scalar    = typename DataPoint::Scalar;
+    using IndexType = typename NodeType::IndexType;
+    using Aabb      = Eigen::AlignedBox<Scalar, DataPoint::Dim>;
+    using Code      = std::uint64_t;
+
+    const DataPoint* points {nullptr};
+    IndexType point_count {0};
+    Aabb aabb;
+    int min_cell_size {64};
+    int max_depth {PCA_KDTREE_MAX_DEPTH};
+
+    NodeType*  nodes     {nullptr};           ///< 2 * point_count - 1 nodes
+    IndexType* indices   {nullptr};           ///< point_count indices, sorted by code
+    Code*      codes     {nullptr};           ///< point_count codes
+    IndexType* starts[2] {nullptr, nullptr};  ///< Ranges of the points of the nodes of the even and odd levels
+    IndexType* ends[2]   {nullptr, nullptr};
+    IndexType* mids      {nullptr};           ///< First right point of the inner nodes of the level, -1 for leaves
+    IndexType* ranks     {nullptr};           ///< 1 for the inner nodes, then their rank after an exclusive scan
+    int*       dims      {nullptr};
+    Scalar*    values    {nullptr};           ///< Split values of the inner nodes of the level
+    int*       overflow  {nullptr};           ///< Set when a leaf exceeds NodeType::MAX_LEAF_SIZE
+
+    /// \brief Compute the code of the point `i`
+    PONCA_MULTIARCH inline void encode(IndexType i) const
+    {
+        indices[i] = i;
+        codes[i] = morton_code<Code>(points[i].pos(), aabb);
+    }
+
+    /// \brief Turn the node `s` of the level `depth`, of id `first + s`, into a leaf or find its split
+    PONCA_MULTIARCH inline void split(int depth, IndexType first, IndexType s) const
+    {
+        const IndexType start = starts[depth % 2][s], end = ends[depth % 2][s];
+        const Code diff = codes[start] ^ codes[end-1];
+        if(end - start <= min_cell_size || depth >= max_depth || diff == 0)
+        {
+            // the points sharing a Morton cell cannot be split
+            mids[s]  = -1;
+            ranks[s] = 0;
+            if(std::size_t(end - start) > NodeType::MAX_LEAF_SIZE)
+                *overflow = 1;
+            NodeType& node = nodes[first + s];
+            node.leaf       = true;
+            node.duplicates = false;
+            node.start      = start;
+            node.size       = end - start;
+            return;
+        }
+
+        int bit = 63;
+#ifdef __CUDA_ARCH__
+        bit -= __clzll(static_cast<long long>(diff));
+#else
+        while(((diff >> bit) & 1u) == 0)
+            --bit;
+#endif
+        // the codes share their bits above `bit`: the right points start at the first code with `bit` set
+        IndexType lo = start, hi = end - 1;
+        while(lo < hi)
+        {
+            const IndexType m = lo + (hi - lo) / 2;
+            if((codes[m] >> bit) & 1u) hi = m;
+            else lo = m + 1;
+        }
+        mids[s]   = lo;
+        ranks[s]  = 1;
+        dims[s]   = morton_dimension<DataPoint::Dim>(bit);
+        values[s] = Eigen::NumTraits<Scalar>::highest();
+    }
+
+    /// \brief Lower the split value of the node holding the sorted point `i`, among the `count` nodes of the level,
+    /// when the point is on its right side
+    PONCA_MULTIARCH inline void reduce(int depth, IndexType count, IndexType i) const
+    {
+        // the nodes of a level are sorted by their first point
+        const IndexType* levelStarts = starts[depth % 2];
+        if(levelStarts[0] > i) return;
+        IndexType lo = 0, hi = count;
+        while(hi - lo > 1)
+        {
+            const IndexType m = lo + (hi - lo) / 2;
+            if(levelStarts[m] <= i) lo = m;
+            else hi = m;
+        }
+        if(mids[lo] < 0 || i < mids[lo] || i >= ends[depth % 2][lo]) return;
+
+        const Scalar value = points[indices[i]].pos()[dims[lo]];
+#ifdef __CUDA_ARCH__
+        device_atomic_min(values + lo, value);
+#else
+        if(value < values[lo]) values[lo] = value;
+#endif
+    }
+
+    /// \brief Link the inner node `s` of the level `depth` to its children, the nodes `2 * ranks[s]` and
+    /// `2 * ranks[s] + 1` of the next level, which starts at the node `next`
+    PONCA_MULTIARCH inline void link(int depth, IndexType first, IndexType next, IndexType s) const
+    {
+        if(mids[s] < 0) return;
+        const int level = depth % 2;
+        const IndexType child = 2 * ranks[s];
+        NodeType& node = nodes[first + s];
+        node.leaf         = false;
+        node.duplicates   = false;
+        node.dim          = dims[s];
+        node.splitValue   = values[s];
+        node.firstChildId = next + child;
+
+        starts[1-level][child]   = starts[level][s];
+        ends[1-level][child]     = mids[s];
+        starts[1-level][child+1] = mids[s];
+        ends[1-level][child+1]   = ends[level][s];
+    }
+};
+
+} // namespace internal
+
+/// \brief Build the nodes and indices of the tree of the `count` points `points` with the steps of
+/// KdTreeDeviceBuffers::build(), run on the host
+///
+/// The tree matches a KdTree built with SPLIT_MORTON, except that the points sharing a Morton cell are gathered
+/// in a leaf. Query it with a KdTreeDeviceView over `points`, `nodes` and `indices`.
+/// \return false when a leaf exceeds NodeType::MAX_LEAF_SIZE, or the tree NodeType::MAX_COUNT
+/// \ingroup spatialpartitioning
+template<class DataPoint, class NodeType>
+inline bool kdtree_morton_build(const DataPoint* points, typename NodeType::IndexType count,
+                                std::vector<NodeType>& nodes, std::vector<typename NodeType::IndexType>& indices,
+                                int min_cell_size = 64, int max_depth = PCA_KDTREE_MAX_DEPTH)
+{
+    using Steps     = internal::MortonBuildSteps<DataPoint, NodeType>;
+    using IndexType = typename NodeType::IndexType;
+
+    nodes.clear();
+    indices.resize(count);
+    if(count == 0)
+        return true;
+    if(2 * std::size_t(count) - 1 > NodeType::MAX_COUNT)
+        return false;
+
+    std::vector<typename Steps::Code> codes(count);
+    std::vector<IndexType> starts0(count), starts1(count), ends0(count), ends1(count), mids(count), ranks(count);
+    std::vector<int> dims(count);
+    std::vector<typename Steps::Scalar> values(count);
+    int overflow = 0;
+    nodes.resize(2 * std::size_t(count) - 1);
+
+    Steps steps;
+    steps.points        = points;
+    steps.point_count   = count;
+    steps.min_cell_size = min_cell_size;
+    steps.max_depth     = std::max(1, std::min(max_depth, PCA_KDTREE_MAX_DEPTH));
+    steps.nodes         = nodes.data();
+    steps.indices       = indices.data();
+    steps.codes         = codes.data();
+    steps.starts[0]     = starts0.data();
+    steps.starts[1]     = starts1.data();
+    steps.ends[0]       = ends0.data();
+    steps.ends[1]       = ends1.data();
+    steps.mids          = mids.data();
+    steps.ranks         = ranks.data();
+    steps.dims          = dims.data();
+    steps.values        = values.data();
+    steps.overflow      = &overflow;
+    for(IndexType i = 0; i < count; ++i)
+        steps.aabb.extend(points[i].pos());
+
+    for(IndexType i = 0; i < count; ++i)
+        steps.encode(i);
+    morton_sort(codes.data(), indices.data(), count);
+
+    // the root holds all the points
+    starts0[0] = 0;
+    ends0[0] = count;
+    IndexType first = 0, levelCount = 1;
+    for(int depth = 0; levelCount > 0; ++depth)
+    {
+        for(IndexType s = 0; s < levelCount; ++s)
+            steps.split(depth, first, s);
+
+        IndexType inner = 0;
+        for(IndexType s = 0; s < levelCount; ++s)
+        {
+            const IndexType flag = ranks[s];
+            ranks[s] = inner;
+            inner += flag;
+        }
+        if(inner > 0)
+        {
+            for(IndexType i = 0; i < count; ++i)
+                steps.reduce(depth, levelCount, i);
+            for(IndexType s = 0; s < levelCount; ++s)
+                steps.link(depth, first, first + levelCount, s);
+        }
+        first += levelCount;
+        levelCount = 2 * inner;
+    }
+    nodes.resize(first);
+    return overflow == 0;
+}
+
+#ifdef __CUDACC__
+/// \brief Kernels of KdTreeDeviceBuffers::build(), one thread per point or per node of the level
+template<class Steps>
+__global__ void kdtree_morton_encode_kernel(Steps steps)
+{
+    const typename Steps::IndexType i = typename Steps::IndexType(blockIdx.x) * blockDim.x + threadIdx.x;
+    if(i < steps.point_count) steps.encode(i);
+}
+
+template<class Steps>
+__global__ void kdtree_morton_split_kernel(Steps steps, int depth, typename Steps::IndexType first,
+                                           typename Steps::IndexType count)
+{
+    const typename Steps::IndexType s = typename Steps::IndexType(blockIdx.x) * blockDim.x + threadIdx.x;
+    if(s < count) steps.split(depth, first, s);
+}
+
+template<class Steps>
+__global__ void kdtree_morton_reduce_kernel(Steps steps, int depth, typename Steps::IndexType count)
+{
+    const typename Steps::IndexType i = typename Steps::IndexType(blockIdx.x) * blockDim.x + threadIdx.x;
+    if(i < steps.point_count) steps.reduce(depth, count, i);
+}
+
+template<class Steps>
+__global__ void kdtree_morton_link_kernel(Steps steps, int depth, typename Steps::IndexType first,
+                                          typename Steps::IndexType count)
+{
+    const typename Steps::IndexType s = typename Steps::IndexType(blockIdx.x) * blockDim.x + threadIdx.x;
+    if(s < count) steps.link(depth, first, first + count, s);
+}
+
+/// \brief Device buffers of a KdTree, built on the device or copied from a KdTree built on the host
+///
+/// The buffers are released by the destructor: the type is move-only.
+/// \ingroup spatialpartitioning
+template<class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+struct KdTreeDeviceBuffers
+{
+    using IndexType = typename NodeType::IndexType;
+
+    DataPoint* points  {nullptr};
+    NodeType*  nodes   {nullptr};
+    IndexType* indices {nullptr};
+    KdTreeDeviceView<DataPoint, NodeType> view;
+
+    KdTreeDeviceBuffers() = default;
+    KdTreeDeviceBuffers(const KdTreeDeviceBuffers&) = delete;
+    KdTreeDeviceBuffers& operator=(const KdTreeDeviceBuffers&) = delete;
+
+    inline KdTreeDeviceBuffers(KdTreeDeviceBuffers&& other) noexcept { *this = std::move(other); }
+
+    inline KdTreeDeviceBuffers& operator=(KdTreeDeviceBuffers&& other) noexcept
+    {
+        if(this != &other)
+        {
+            release();
+            points  = other.points;
+            nodes   = other.nodes;
+            indices = other.indices;
+            view    = other.view;
+            other.points  = nullptr;
+            other.nodes   = nullptr;
+            other.indices = nullptr;
+            other.view    = KdTreeDeviceView<DataPoint, NodeType>();
+        }
+        return *this;
+    }
+
+    inline ~KdTreeDeviceBuffers() { release(); }
+
+    /// \brief Build on the device the tree of the `count` points `host_points`, releasing the previous buffers
+    ///
+    /// The points are copied to the device, where the tree is built level by level from their Morton codes, as by
+    /// SPLIT_MORTON: after the sort of the codes, each level takes a kernel over its nodes to split them at the
+    /// highest bit differing between the codes of their points, a kernel over the points to compute the split
+    /// values, and a kernel over the nodes to link them to their children. See kdtree_morton_build() running the
+    /// same steps on the host.
+    /// \return false when a CUDA call failed, or when the tree exceeds the limits of NodeType
+    inline bool build(const DataPoint* host_points, IndexType count, int min_cell_size = 64,
+                      int max_depth = PCA_KDTREE_MAX_DEPTH)
+    {
+        release();
+        if(count == 0)
+            return true;
+        if(2 * std::size_t(count) - 1 > NodeType::MAX_COUNT)
+            return false;
+
+        bool ok = cudaMalloc(&points, count * sizeof(DataPoint)) == cudaSuccess &&
+                  cudaMalloc(&nodes, (2 * std::size_t(count) - 1) * sizeof(NodeType)) == cudaSuccess &&
+                  cudaMalloc(&indices, count * sizeof(IndexType)) == cudaSuccess;
+        ok = ok && cudaMemcpy(points, host_points, count * sizeof(DataPoint), cudaMemcpyHostToDevice) == cudaSuccess;
+        IndexType nodeCount = 0;
+        try
+        {
+            ok = ok && build_nodes(count, min_cell_size, std::max(1, std::min(max_depth, PCA_KDTREE_MAX_DEPTH)), nodeCount);
+        }
+        catch(const std::exception&) // allocation failures of the thrust buffers
+        {
+            ok = false;
+        }
+        if(!ok)
+        {
+            release();
+            return false;
+        }
+        view.points      = points;
+        view.nodes       = nodes;
+        view.indices     = indices;
+        view.point_count = count;
+        view.node_count  = int(nodeCount);
+        return true;
+    }
+
+    /// \brief Copy the points, nodes and indices of `tree` to device memory, releasing the previous copies
+    /// \return false when a CUDA call failed
+    inline bool upload(const KdTree<DataPoint, NodeType>& tree)
+    {
+        release();
+        const std::size_t pointCount = tree.point_count(), nodeCount = tree.node_count(), indexCount = tree.index_count();
+        bool ok = cudaMalloc(&points, pointCount * sizeof(DataPoint)) == cudaSuccess &&
+                  cudaMalloc(&nodes, nodeCount * sizeof(NodeType)) == cudaSuccess &&
+                  cudaMalloc(&indices, indexCount * sizeof(*indices)) == cudaSuccess;
+        ok = ok && cudaMemcpy(points, tree.point_buffer(), pointCount * sizeof(DataPoint), cudaMemcpyHostToDevice) == cudaSuccess &&
+                   cudaMemcpy(nodes, tree.node_buffer(), nodeCount * sizeof(NodeType), cudaMemcpyHostToDevice) == cudaSuccess &&
+                   cudaMemcpy(indices, tree.index_buffer(), indexCount * sizeof(*indices), cudaMemcpyHostToDevice) == cudaSuccess;
+        if(!ok)
+        {
+            release();
+            return false;
+        }
+        view = tree.device_view();
+        view.points  = points;
+        view.nodes   = nodes;
+        view.indices = indices;
+        return true;
+    }
+
+    inline void release()
+    {
+        cudaFree(points);
+        cudaFree(nodes);
+        cudaFree(indices);
+        points  = nullptr;
+        nodes   = nullptr;
+        indices = nullptr;
+        view    = KdTreeDeviceView<DataPoint, NodeType>();
+    }
+
+private:
+    /// \brief Build the nodes of the `count` points copied to the device, see build()
+    inline bool build_nodes(IndexType count, int min_cell_size, int max_depth, IndexType& node_count)
+    {
+        using Steps = internal::MortonBuildSteps<DataPoint, NodeType>;
+        constexpr int BlockSize = 256;
+        const auto blocks = [](IndexType n) { return unsigned((n + BlockSize - 1) / BlockSize); };
+
+        thrust::device_vector<typename Steps::Code> codes(count);
+        thrust::device_vector<IndexType> starts0(count), starts1(count), ends0(count), ends1(count), mids(count), ranks(count);
+        thrust::device_vector<int> dims(count), overflow(1, 0);
+        thrust::device_vector<typename Steps::Scalar> values(count);
+
+        Steps steps;
+        steps.points        = points;
+        steps.point_count   = count;
+        steps.min_cell_size = min_cell_size;
+        steps.max_depth     = max_depth;
+        steps.nodes         = nodes;
+        steps.indices       = indices;
+        steps.codes         = thrust::raw_pointer_cast(codes.data());
+        steps.starts[0]     = thrust::raw_pointer_cast(starts0.data());
+        steps.starts[1]     = thrust::raw_pointer_cast(starts1.data());
+        steps.ends[0]       = thrust::raw_pointer_cast(ends0.data());
+        steps.ends[1]       = thrust::raw_pointer_cast(ends1.data());
+        steps.mids          = thrust::raw_pointer_cast(mids.data());
+        steps.ranks         = thrust::raw_pointer_cast(ranks.data());
+        steps.dims          = thrust::raw_pointer_cast(dims.data());
+        steps.values        = thrust::raw_pointer_cast(values.data());
+        steps.overflow      = thrust::raw_pointer_cast(overflow.data());
+        steps.aabb = thrust::transform_reduce(thrust::device, thrust::counting_iterator<IndexType>(0),
+                                              thrust::counting_iterator<IndexType>(count),
+                                              internal::MortonPointBox<DataPoint>{points},
+                                              typename Steps::Aabb(), internal::MortonMergeBoxes());
+
+        kdtree_morton_encode_kernel<<<blocks(count), BlockSize>>>(steps);
+        thrust::sort_by_key(codes.begin(), codes.end(), thrust::device_pointer_cast(indices));
+
+        // the root holds all the points
+        starts0[0] = 0;
+        ends0[0] = count;
+        IndexType first = 0, levelCount = 1;
+        for(int depth = 0; levelCount > 0; ++depth)
+        {
+            kdtree_morton_split_kernel<<<blocks(levelCount), BlockSize>>>(steps, depth, first, levelCount);
+
+            // the ranks of the inner nodes give the ids of their children
+            const bool lastInner = IndexType(mids[levelCount-1]) >= 0;
+            thrust::exclusive_scan(ranks.begin(), ranks.begin() + levelCount, ranks.begin());
+            const IndexType inner = IndexType(ranks[levelCount-1]) + (lastInner ? 1 : 0);
+            if(inner > 0)
+            {
+                kdtree_morton_reduce_kernel<<<blocks(count), BlockSize>>>(steps, depth, levelCount);
+                kdtree_morton_link_kernel<<<blocks(levelCount), BlockSize>>>(steps, depth, first, levelCount);
+            }
+            first += levelCount;
+            levelCount = 2 * inner;
+        }
+        if(cudaDeviceSynchronize() != cudaSuccess || cudaGetLastError() != cudaSuccess || int(overflow[0]) != 0)
+            return false;
+        node_count = first;
+        return true;
+    }
+};
+#endif
+
+} // namespace Ponca
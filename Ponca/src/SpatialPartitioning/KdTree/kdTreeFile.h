@@ -0,0 +1,63 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace Ponca {
+
+/// \brief Header of the binary files written by KdTree::save()
+///
+/// The header is followed by the nodes, node bounds, indices and (optionally) points, each stored as a raw
+/// array starting at the corresponding offset. Offsets are multiples of #Alignment, so that a file mapped
+/// in memory can be used directly by KdTree::load_view().
+/// The file is only readable by a KdTree with the same scalar, dimension, node and point types, compiled
+/// on an architecture with the same byte order, and with a #PCA_KDTREE_MAX_DEPTH at least equal to the depth
+/// of the tree.
+/// \ingroup spatialpartitioning
+struct KdTreeFileHeader
+{
+    enum : std::uint32_t
+    {
+        Version   = 3,          ///< Incremented each time the layout of the file changes
+        EndianTag = 0x01020304, ///< Written in the byte order of the writer
+        Alignment = 64          ///< Alignment of each array in the file
+    };
+
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t endianness;
+    std::uint32_t scalar_size;
+    std::uint32_t dim;
+    std::uint32_t node_size;
+    std::uint32_t point_size;    // sizeof(DataPoint), or 0 when the points are not stored
+    std::uint64_t node_count;
+    std::uint64_t index_count;
+    std::uint64_t point_count;
+    std::uint64_t node_offset;
+    std::uint64_t bounds_offset;
+    std::uint64_t index_offset;
+    std::uint64_t point_offset;
+    std::int32_t  min_cell_size;
+    std::uint32_t depth;         // depth of the deepest leaf, which must fit in the traversal stacks of the reader
+
+    static inline const char* magic_string() { return "PONCAKDT"; }
+
+    /// \brief Round `offset` up to the next multiple of #Alignment
+    static inline std::uint64_t align(std::uint64_t offset)
+    {
+        return (offset + Alignment - 1) / Alignment * Alignment;
+    }
+
+    inline bool has_valid_magic() const
+    {
+        return std::memcmp(magic, magic_string(), sizeof(magic)) == 0;
+    }
+};
+
+} // namespace Ponca
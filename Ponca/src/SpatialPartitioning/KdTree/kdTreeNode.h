@@ -8,17 +8,41 @@
 
 #include "../defines.h"
 
+#include <cstdint>
+#include <type_traits>
+
 namespace Ponca {
+
+/// \brief Compact node of the KdTree (default)
+///
+/// Inner nodes and leaves share 8 bytes (for float): the child ids are stored on 24 bits, the split
+/// dimension on 2 bits and the size of the leaves on 16 bits, which limits the size of the trees (see
+/// #MAX_COUNT, #MAX_LEAF_SIZE and #MAX_DIM). KdTree throws std::length_error when a tree exceeds these limits.
+///
+/// The `duplicates` flag of the leaves, common to all the node types, tells that all the points of the leaf share
+/// the same position: the leaf is scanned as a single weighted representative, see KdTree::leaf_scan().
+/// \see KdTreeWideNode for large trees
 /// \ingroup spatialpartitioning
 template<typename Scalar>
 struct KdTreeNode
 {
+    /// \brief Type of the indices of the points, see KdTree::IndexType
+    using IndexType = int;
+
+    /// \brief Maximal number of nodes of a tree
+    static constexpr std::size_t MAX_COUNT     = std::size_t(1) << 24;
+    /// \brief Maximal number of indices in a leaf
+    static constexpr std::size_t MAX_LEAF_SIZE = 0xffff;
+    /// \brief Maximal dimension of the points
+    static constexpr int         MAX_DIM       = 4;
+
     union {
         struct {
 			Scalar       splitValue;
             unsigned int   firstChildId:24;
             unsigned int   dim:2;
             unsigned int   leaf:1;
+            unsigned int   duplicates:1;
         };
         struct {
             unsigned int   start;
@@ -27,4 +51,80 @@ struct KdTreeNode
     };
 };
 
-}   
+/// \brief Wide node of the KdTree, for trees exceeding the limits of KdTreeNode
+///
+/// Child ids, leaf starts and sizes are stored on 32 bits, and the node takes 16 bytes (for float).
+/// Use it as the second template parameter of KdTree.
+/// \ingroup spatialpartitioning
+template<typename Scalar>
+struct KdTreeWideNode
+{
+    /// \brief Type of the indices of the points, see KdTree::IndexType
+    using IndexType = int;
+
+    /// \brief Maximal number of nodes of a tree
+    static constexpr std::size_t MAX_COUNT     = std::size_t(0xffffffff);
+    /// \brief Maximal number of indices in a leaf
+    static constexpr std::size_t MAX_LEAF_SIZE = std::size_t(0xffffffff);
+    /// \brief Maximal dimension of the points
+    static constexpr int         MAX_DIM       = 0x3fffffff;
+
+    union {
+        struct {
+            Scalar        splitValue;
+            std::uint32_t firstChildId;
+        };
+        struct {
+            std::uint32_t start;
+            std::uint32_t size;
+        };
+    };
+    std::uint32_t dim:30;
+    std::uint32_t duplicates:1;
+    std::uint32_t leaf:1;
+    std::uint32_t padding; // keep a 16 bytes node for float
+};
+
+/// \brief Node of the KdTree indexing more than 2^31 points
+///
+/// The points are indexed by 64-bit integers: the indices of the tree (KdTree::index_data()) and the ones
+/// returned by the queries are `std::int64_t`, which doubles the memory used by the indices. The node takes
+/// 16 bytes for float, as KdTreeWideNode, the leaf starts being stored on 64 bits and the child ids and leaf
+/// sizes on 32 bits. Use it as the second template parameter of KdTree only for clouds that do not fit in 32-bit
+/// indices: the other node types keep the compact `int` indices.
+/// \ingroup spatialpartitioning
+template<typename Scalar>
+struct KdTreeLargeNode
+{
+    /// \brief Type of the indices of the points, see KdTree::IndexType
+    using IndexType = std::int64_t;
+
+    /// \brief Maximal number of nodes of a tree
+    static constexpr std::size_t MAX_COUNT     = std::size_t(0xffffffff);
+    /// \brief Maximal number of indices in a leaf
+    static constexpr std::size_t MAX_LEAF_SIZE = std::size_t(0xffffffff);
+    /// \brief Maximal dimension of the points
+    static constexpr int         MAX_DIM       = 0x3fffffff;
+
+    union {
+        struct {
+            Scalar        splitValue;
+            std::uint32_t firstChildId;
+        };
+        std::int64_t start;
+    };
+    std::uint32_t size;
+    std::uint32_t dim:30;
+    std::uint32_t duplicates:1;
+    std::uint32_t leaf:1;
+};
+
+/// \brief Default node of the KdTree of `DataPoint`: KdTreeNode, or KdTreeWideNode when the dimension of the
+/// points exceeds KdTreeNode::MAX_DIM, e.g. for the joint position, normal and color feature spaces
+/// \ingroup spatialpartitioning
+template<typename DataPoint>
+using KdTreeDefaultNode = typename std::conditional<(int(DataPoint::Dim) <= KdTreeNode<typename DataPoint::Scalar>::MAX_DIM),
+                                                    KdTreeNode<typename DataPoint::Scalar>,
+                                                    KdTreeWideNode<typename DataPoint::Scalar>>::type;
+
+}
@@ -0,0 +1,283 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./kdTree.h"
+#include "../../Common/Tracing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace Ponca {
+
+namespace internal {
+
+/// \brief Edge of the k-nearest neighbors graph used by orient_normals
+struct NormalOrientationEdge
+{
+    int a, b;
+    float weight; ///< Riemannian weight `1 - |n_a . n_b|`, in [0, 1]
+};
+
+/// \brief Root of the union-find forest `parent`, without path compression so that it can be called concurrently
+inline int union_find_root(const std::vector<int>& parent, int v)
+{
+    while(parent[v] != v)
+        v = parent[v];
+    return v;
+}
+
+/// \brief Parallel std::remove_if followed by the erasure of the removed elements, keeping the order of the others
+template <typename T, typename Predicate>
+inline void parallel_erase_if(std::vector<T>& values, Predicate predicate)
+{
+    constexpr std::int64_t blockSize = 1 << 16;
+    const std::int64_t blockCount = (std::int64_t(values.size()) + blockSize - 1) / blockSize;
+    if(blockCount <= 1)
+    {
+        values.erase(std::remove_if(values.begin(), values.end(), predicate), values.end());
+        return;
+    }
+
+    std::vector<std::size_t> offsets(std::size_t(blockCount) + 1, 0);
+#pragma omp parallel for
+    for(std::int64_t b = 0; b < blockCount; ++b)
+    {
+        const std::size_t end = std::min(values.size(), std::size_t(b + 1) * blockSize);
+        for(std::size_t i = std::size_t(b) * blockSize; i < end; ++i)
+            offsets[b + 1] += predicate(values[i]) ? 0 : 1;
+    }
+    for(std::int64_t b = 0; b < blockCount; ++b)
+        offsets[b + 1] += offsets[b];
+
+    std::vector<T> kept(offsets[blockCount]);
+#pragma omp parallel for
+    for(std::int64_t b = 0; b < blockCount; ++b)
+    {
+        const std::size_t end = std::min(values.size(), std::size_t(b + 1) * blockSize);
+        std::size_t out = offsets[b];
+        for(std::size_t i = std::size_t(b) * blockSize; i < end; ++i)
+        {
+            if(!predicate(values[i]))
+                kept[out++] = values[i];
+        }
+    }
+    values.swap(kept);
+}
+
+} // namespace internal
+
+/*!
+    \brief Orient consistently the normals of the points of `tree`, e.g. estimated by CovariancePlaneFit or
+    UnorientedSphereFit, to feed the fitting procedures requiring oriented normals such as OrientedSphereFit
+
+    The orientation is propagated as described by Hoppe et al. (Surface reconstruction from unorganized points,
+    SIGGRAPH 1992) over the minimum spanning tree of the symmetric `k`-nearest neighbors graph of the points,
+    weighted by the Riemannian weight `1 - |n_i . n_j|`: the propagation follows the neighbors of most parallel
+    normals first, where flipping the normal of a point to agree with its parent is reliable.
+    - The graph is built by the batched query `tree.k_nearest_neighbors_batch(k, indices)`.
+    - The spanning forest is computed by Boruvka's algorithm: in each round, the lightest edge leaving each
+      connected component is selected by scanning the edges in parallel, and the components are merged along
+      the selected edges. The rounds at least halve the number of components, and the edges inside a component
+      are dropped from the following rounds.
+    - The orientation is propagated by a breadth-first traversal of the spanning forest, from the point of each
+      component of highest last coordinate, whose normal is oriented towards the increasing last coordinate.
+
+    \code
+    std::vector<VectorType> normals(points.size());
+    // normals[i] = fit.primitiveGradient() from an unoriented fit of points[i]
+    orient_normals(tree, 16, normals);
+    \endcode
+
+    \param k Number of neighbors of each point in the graph, clamped to the number of other points indexed by
+    the tree
+    \param normals Random access container of the `tree.point_count()` unit normals, flipped in place
+    \return Number of connected components of the graph, each one being oriented independently
+    \throw std::length_error when `tree.point_count() * k` exceeds 2^32 - 1, the edges being indexed on 32 bits
+    \ingroup spatialpartitioning
+*/
+template <class DataPoint, class NodeType, class NormalContainer>
+inline int orient_normals(const KdTree<DataPoint, NodeType>& tree, int k, NormalContainer& normals)
+{
+    using Edge = internal::NormalOrientationEdge;
+    PONCA_TRACE_ZONE("ponca::orient_normals");
+
+    const int count = tree.point_count();
+    if(count == 0)
+        return 0;
+    k = std::min(k, tree.index_count() - 1);
+    k = std::max(k, 0);
+    if(std::uint64_t(count) * std::uint64_t(k) >= std::uint64_t(std::numeric_limits<std::uint32_t>::max()))
+        throw std::length_error("orient_normals: too many edges in the k-nearest neighbors graph");
+
+    std::vector<int> neighbors(std::size_t(count) * k);
+    if(k > 0)
+        tree.k_nearest_neighbors_batch(k, neighbors.data());
+
+    // both directions of the symmetric edges are kept: looking up the reverse edges in the neighbors of the
+    // other point costs more than scanning them twice in the first round, after which they are dropped
+    std::vector<Edge> edges(neighbors.size());
+    {
+        PONCA_TRACE_ZONE("ponca::orient_normals graph");
+#pragma omp parallel for
+        for(int i = 0; i < count; ++i)
+        {
+            for(int s = 0; s < k; ++s)
+            {
+                const std::size_t e = std::size_t(i) * k + s;
+                const int j = neighbors[e];
+                if(j < 0)
+                {
+                    edges[e] = Edge{i, i, 0.f}; // missing neighbor, dropped with the inner edges
+                    continue;
+                }
+                using std::abs;
+                const float w = 1.f - float(abs(normals[i].dot(normals[j])));
+                edges[e] = Edge{i, j, std::max(w, 0.f)};
+            }
+        }
+    }
+    std::vector<int>().swap(neighbors);
+
+    // Boruvka's minimum spanning forest
+    std::vector<int> parent(count), size(count, 1), component(count), roots(count);
+    for(int i = 0; i < count; ++i)
+        parent[i] = component[i] = roots[i] = i;
+    std::vector<std::pair<int, int>> forest;
+    forest.reserve(count);
+    {
+        PONCA_TRACE_ZONE("ponca::orient_normals spanning forest");
+        constexpr std::uint64_t none = std::numeric_limits<std::uint64_t>::max();
+        std::vector<std::atomic<std::uint64_t>> lightest(count);
+#pragma omp parallel for
+        for(int i = 0; i < count; ++i)
+            lightest[i].store(none, std::memory_order_relaxed);
+
+        // the edges are totally ordered by their weight, then by their position in `edges`
+        auto select = [&](int c, std::uint64_t key) {
+            std::uint64_t current = lightest[c].load(std::memory_order_relaxed);
+            while(key < current && !lightest[c].compare_exchange_weak(current, key, std::memory_order_relaxed)) {}
+        };
+
+        while(!edges.empty())
+        {
+            const std::int64_t edgeCount = std::int64_t(edges.size());
+#pragma omp parallel for
+            for(std::int64_t e = 0; e < edgeCount; ++e)
+            {
+                const Edge& edge = edges[e];
+                const int ca = component[edge.a], cb = component[edge.b];
+                if(ca == cb)
+                    continue;
+                std::uint32_t bits;
+                std::memcpy(&bits, &edge.weight, sizeof(bits)); // non-negative floats are ordered as their bits
+                const std::uint64_t key = (std::uint64_t(bits) << 32) | std::uint64_t(e);
+                select(ca, key);
+                select(cb, key);
+            }
+
+            bool merged = false;
+            for(int r : roots)
+            {
+                const std::uint64_t key = lightest[r].load(std::memory_order_relaxed);
+                if(key == none)
+                    continue;
+                lightest[r].store(none, std::memory_order_relaxed);
+                const Edge& edge = edges[std::size_t(key & 0xffffffffu)];
+                int ra = internal::union_find_root(parent, edge.a), rb = internal::union_find_root(parent, edge.b);
+                if(ra == rb)
+                    continue; // already merged through the edge selected by the other component
+                if(size[ra] < size[rb])
+                    std::swap(ra, rb);
+                parent[rb] = ra;
+                size[ra] += size[rb];
+                forest.emplace_back(edge.a, edge.b);
+                merged = true;
+            }
+            if(!merged)
+                break;
+
+#pragma omp parallel for
+            for(int i = 0; i < count; ++i)
+                component[i] = internal::union_find_root(parent, i);
+#pragma omp parallel for
+            for(int i = 0; i < count; ++i)
+                parent[i] = component[i];
+
+            roots.erase(std::remove_if(roots.begin(), roots.end(), [&](int r) { return component[r] != r; }),
+                        roots.end());
+            internal::parallel_erase_if(edges, [&](const Edge& edge) {
+                return component[edge.a] == component[edge.b];
+            });
+        }
+    }
+    std::vector<Edge>().swap(edges);
+
+    // propagation over the spanning forest, stored in compressed sparse row format
+    {
+        PONCA_TRACE_ZONE("ponca::orient_normals propagation");
+        std::vector<int> offsets(std::size_t(count) + 1, 0), adjacency(2 * forest.size());
+        for(const auto& edge : forest)
+        {
+            ++offsets[edge.first + 1];
+            ++offsets[edge.second + 1];
+        }
+        for(int i = 0; i < count; ++i)
+            offsets[i + 1] += offsets[i];
+        std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+        for(const auto& edge : forest)
+        {
+            adjacency[cursor[edge.first]++]  = edge.second;
+            adjacency[cursor[edge.second]++] = edge.first;
+        }
+
+        // start of each component: its point of highest last coordinate
+        constexpr int last = DataPoint::Dim - 1;
+        std::vector<int> starts(roots);
+        for(int i = 0; i < count; ++i)
+        {
+            int& start = starts[std::lower_bound(roots.begin(), roots.end(), component[i]) - roots.begin()];
+            if(tree.point(i).pos()(last) > tree.point(start).pos()(last))
+                start = i;
+        }
+
+        std::vector<bool> visited(count, false);
+        std::vector<int> queue;
+        queue.reserve(count);
+        for(int start : starts)
+        {
+            if(normals[start](last) < 0)
+                normals[start] = -normals[start];
+            visited[start] = true;
+            queue.push_back(start);
+            for(std::size_t front = queue.size() - 1; front < queue.size(); ++front)
+            {
+                const int i = queue[front];
+                for(int n = offsets[i]; n < offsets[i + 1]; ++n)
+                {
+                    const int j = adjacency[n];
+                    if(visited[j])
+                        continue;
+                    visited[j] = true;
+                    if(normals[i].dot(normals[j]) < 0)
+                        normals[j] = -normals[j];
+                    queue.push_back(j);
+                }
+            }
+        }
+    }
+
+    return static_cast<int>(roots.size());
+}
+
+} // namespace Ponca
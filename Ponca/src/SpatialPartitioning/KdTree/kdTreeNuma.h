@@ -0,0 +1,453 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./kdTree.h"
+#include "../../Common/Tracing.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#  include <pthread.h>
+#  include <sched.h>
+#  include <unistd.h>
+#  include <sys/syscall.h>
+#endif
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+/// \brief Move the pages of the interleaved KdTree arrays with the mbind system call (1 by default on Linux),
+/// define to 0 to rely on the first-touch placement only
+#ifndef PCA_KDTREE_NUMA_MBIND
+#  if defined(__linux__) && defined(SYS_mbind)
+#    define PCA_KDTREE_NUMA_MBIND 1
+#  else
+#    define PCA_KDTREE_NUMA_MBIND 0
+#  endif
+#endif
+
+namespace Ponca {
+
+/// \brief Placement of the KdTree arrays over the NUMA nodes, see KdTreeNumaReplicas
+/// \ingroup spatialpartitioning
+enum KDTREE_NUMA_POLICY : unsigned char
+{
+    /*! \brief The tree is used where it was allocated */
+    NUMA_NONE = 0,
+    /*! \brief One copy of the tree per NUMA node, made by a thread of the node so that its pages are local. Each
+      thread queries the copy of its node: the fastest, at the cost of one copy of the tree per node */
+    NUMA_REPLICATE = 1,
+    /*! \brief One copy of the tree, its pages spread round-robin over the nodes: the memory bandwidth of all the
+      nodes is used, without the memory cost of the replicas */
+    NUMA_INTERLEAVE = 2
+};
+
+/// \brief CPUs of the NUMA nodes usable by the process
+///
+/// Read from `/sys/devices/system/node` on Linux and restricted to the CPUs of the process affinity mask. The other
+/// systems, and the machines without NUMA, have a single node holding all the CPUs.
+/// \ingroup spatialpartitioning
+struct NumaTopology
+{
+    std::vector<int> node_ids;               ///< Identifier of each node for the operating system
+    std::vector<std::vector<int>> node_cpus; ///< CPUs of each node, the nodes without usable CPUs being skipped
+
+    inline int node_count() const { return static_cast<int>(node_cpus.size()); }
+
+    /// \brief Topology of the machine
+    static inline NumaTopology detect();
+
+    /// \brief Node and CPU of the worker thread `thread`: the threads are spread round-robin over the nodes, then
+    /// over the CPUs of each node
+    inline void placement(int thread, int& node, int& cpu) const
+    {
+        node = thread % node_count();
+        const std::vector<int>& cpus = node_cpus[node];
+        cpu = cpus[(thread / node_count()) % cpus.size()];
+    }
+};
+
+namespace internal {
+
+/// \brief Parse a Linux CPU list, e.g. "0-3,8,10-11"
+inline std::vector<int> parse_cpu_list(const std::string& list)
+{
+    std::vector<int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+    while(std::getline(stream, range, ','))
+    {
+        if(range.empty() || range[0] < '0' || range[0] > '9')
+            continue;
+        const std::size_t dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for(int cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+/// \brief Pin the calling thread to `cpu` while the object lives, when `enabled` and supported
+class ScopedThreadPinning
+{
+public:
+    inline ScopedThreadPinning(int cpu, bool enabled)
+    {
+#if defined(__linux__)
+        if(!enabled || cpu < 0 || cpu >= CPU_SETSIZE)
+            return;
+        if(pthread_getaffinity_np(pthread_self(), sizeof(m_previous), &m_previous) != 0)
+            return;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        m_pinned = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        (void)cpu; (void)enabled;
+#endif
+    }
+
+    inline ~ScopedThreadPinning()
+    {
+#if defined(__linux__)
+        if(m_pinned)
+            pthread_setaffinity_np(pthread_self(), sizeof(m_previous), &m_previous);
+#endif
+    }
+
+    ScopedThreadPinning(const ScopedThreadPinning&) = delete;
+    ScopedThreadPinning& operator=(const ScopedThreadPinning&) = delete;
+
+    inline bool pinned() const { return m_pinned; }
+
+private:
+    bool m_pinned {false};
+#if defined(__linux__)
+    cpu_set_t m_previous;
+#endif
+};
+
+/// \brief Spread the whole pages of `[data, data + bytes)` round-robin over the NUMA nodes `nodes`, identified
+/// as by the operating system
+///
+/// \return false when the pages could not be moved, e.g. without NUMA support, they then stay where they are
+inline bool numa_interleave(const void* data, std::size_t bytes, const std::vector<int>& nodes)
+{
+#if PCA_KDTREE_NUMA_MBIND
+    const long page = sysconf(_SC_PAGESIZE);
+    if(data == nullptr || page <= 0 || nodes.empty())
+        return false;
+    const std::uintptr_t begin = (reinterpret_cast<std::uintptr_t>(data) + page - 1) / page * page;
+    const std::uintptr_t end = (reinterpret_cast<std::uintptr_t>(data) + bytes) / page * page;
+    if(end <= begin)
+        return true;
+
+    constexpr int WordBits = 8 * sizeof(unsigned long);
+    const int maxNode = *std::max_element(nodes.begin(), nodes.end());
+    std::vector<unsigned long> mask(maxNode / WordBits + 1, 0);
+    for(int node : nodes)
+        mask[node / WordBits] |= 1ul << (node % WordBits);
+
+    constexpr int MpolInterleave = 3;    // MPOL_INTERLEAVE of <linux/mempolicy.h>
+    constexpr unsigned MpolMfMove = 1u << 1; // MPOL_MF_MOVE
+    return syscall(SYS_mbind, reinterpret_cast<void*>(begin), end - begin, MpolInterleave, mask.data(),
+                   (unsigned long)(mask.size() * WordBits), MpolMfMove) == 0;
+#else
+    (void)data; (void)bytes; (void)nodes;
+    return false;
+#endif
+}
+
+} // namespace internal
+
+NumaTopology NumaTopology::detect()
+{
+    NumaTopology topology;
+#if defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool masked = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    // the node directories are numbered, possibly with holes
+    for(int node = 0, missing = 0; missing < 64; ++node)
+    {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if(!file)
+        {
+            ++missing;
+            continue;
+        }
+        missing = 0;
+        std::string list;
+        std::getline(file, list);
+        std::vector<int> cpus;
+        for(int cpu : internal::parse_cpu_list(list))
+        {
+            if(!masked || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+                cpus.push_back(cpu);
+        }
+        if(!cpus.empty())
+        {
+            topology.node_ids.push_back(node);
+            topology.node_cpus.push_back(cpus);
+        }
+    }
+    if(topology.node_cpus.empty())
+    {
+        std::vector<int> cpus;
+        for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if(masked && CPU_ISSET(cpu, &allowed))
+                cpus.push_back(cpu);
+        }
+        if(!cpus.empty())
+        {
+            topology.node_ids.push_back(0);
+            topology.node_cpus.push_back(cpus);
+        }
+    }
+#endif
+    if(topology.node_cpus.empty())
+    {
+        std::vector<int> cpus(std::max(1u, std::thread::hardware_concurrency()));
+        for(int cpu = 0; cpu < int(cpus.size()); ++cpu)
+            cpus[cpu] = cpu;
+        topology.node_ids.push_back(0);
+        topology.node_cpus.push_back(cpus);
+    }
+    return topology;
+}
+
+/*!
+    \brief NUMA placement of a KdTree for the batched queries
+
+    On machines with several memory nodes, the batched queries of a single tree are bound by the accesses of the
+    threads to the memory of the remote nodes. This class places the nodes, bounds, indices and points of a tree
+    following a KDTREE_NUMA_POLICY, and runs the batched queries with the OpenMP worker threads pinned to the
+    CPUs of the nodes, spread round-robin over the nodes (see NumaTopology::placement). With NUMA_REPLICATE, each
+    thread queries the replica of its node.
+
+    The results are the same as the batched queries of KdTree. The threads are unpinned at the end of each batch.
+
+    \code
+    KdTreeNumaReplicas<Point> replicas(tree, NUMA_REPLICATE);
+    replicas.k_nearest_neighbors_batch(positions, 16, indices.data(), distances.data());
+    \endcode
+
+    \warning The points of a tree built by KdTree::build_view or KdTree::load_view are user buffers, which are
+    neither replicated nor interleaved.
+    \ingroup spatialpartitioning
+*/
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+class KdTreeNumaReplicas
+{
+public:
+    using Scalar         = typename DataPoint::Scalar;
+    using TreeType       = KdTree<DataPoint, NodeType>;
+    using IndexContainer = typename TreeType::IndexContainer;
+
+    /// \brief Place `tree` following `policy`
+    ///
+    /// With NUMA_REPLICATE, `tree` is copied once per node, otherwise it is used in place and must outlive this
+    /// object. The copies are made by threads pinned to their node.
+    /// \param pin_threads Pin the worker threads of the batched queries to the CPUs of the topology
+    inline KdTreeNumaReplicas(const TreeType& tree, KDTREE_NUMA_POLICY policy,
+                              NumaTopology topology = NumaTopology::detect(), bool pin_threads = true);
+
+    inline KDTREE_NUMA_POLICY policy() const { return m_policy; }
+    inline const NumaTopology& topology() const { return m_topology; }
+    inline int replica_count() const { return static_cast<int>(m_replicas.size()); }
+
+    /// \brief Tree queried by the threads of the node `node`
+    inline const TreeType& replica(int node) const
+    {
+        return m_replicas.empty() ? *m_tree : *m_replicas[node % m_replicas.size()];
+    }
+
+    /// \brief Same as KdTree::k_nearest_neighbors_batch, each pinned thread querying the tree of its node
+    template<typename VectorUserContainer>
+    inline void k_nearest_neighbors_batch(const VectorUserContainer& points, int k, int* indices,
+                                          Scalar* squared_distances = nullptr) const;
+
+    /// \brief Same as KdTree::range_neighbors_batch, each pinned thread querying the tree of its node
+    template<typename VectorUserContainer>
+    inline void range_neighbors_batch(const VectorUserContainer& points, Scalar r, std::vector<std::size_t>& offsets,
+                                      IndexContainer& neighbors, std::vector<Scalar>* squared_distances = nullptr) const;
+
+protected:
+    /// \brief Run `work(tree)` in each thread of the current OpenMP team, pinned to its CPU
+    template<typename WorkFunctor>
+    inline void run_pinned(WorkFunctor work) const;
+
+    const TreeType* m_tree;
+    KDTREE_NUMA_POLICY m_policy;
+    NumaTopology m_topology;
+    bool m_pin_threads;
+    std::vector<std::unique_ptr<TreeType>> m_replicas;
+};
+
+template <class DataPoint, class NodeType>
+KdTreeNumaReplicas<DataPoint, NodeType>::KdTreeNumaReplicas(const TreeType& tree, KDTREE_NUMA_POLICY policy,
+                                                            NumaTopology topology, bool pin_threads)
+    : m_tree(&tree), m_policy(policy), m_topology(std::move(topology)), m_pin_threads(pin_threads)
+{
+    PONCA_TRACE_ZONE("ponca::KdTreeNumaReplicas");
+    if(m_topology.node_count() == 0)
+        m_topology = NumaTopology::detect();
+
+    if(m_policy == NUMA_REPLICATE)
+    {
+        // the pages of each copy are allocated and first written by a thread of its node
+        m_replicas.resize(m_topology.node_count());
+        std::vector<std::thread> copiers;
+        for(int node = 0; node < m_topology.node_count(); ++node)
+        {
+            copiers.emplace_back([this, node]() {
+                internal::ScopedThreadPinning pinning(m_topology.node_cpus[node].front(), true);
+                m_replicas[node].reset(new TreeType(*m_tree));
+            });
+        }
+        for(std::thread& copier : copiers)
+            copier.join();
+    }
+    else if(m_policy == NUMA_INTERLEAVE && m_topology.node_count() > 1)
+    {
+        const std::vector<int>& nodes = m_topology.node_ids;
+        internal::numa_interleave(tree.node_buffer(), sizeof(NodeType) * tree.node_count(), nodes);
+        internal::numa_interleave(tree.node_bounds_buffer(), sizeof(typename TreeType::Aabb) * tree.node_count(), nodes);
+        internal::numa_interleave(tree.index_buffer(), sizeof(int) * tree.index_count(), nodes);
+        internal::numa_interleave(tree.point_buffer(), sizeof(DataPoint) * tree.point_count(), nodes);
+        if(tree.leaf_positions().size() > 0)
+            internal::numa_interleave(tree.leaf_positions().data(), sizeof(Scalar) * tree.leaf_positions().size(), nodes);
+    }
+}
+
+template <class DataPoint, class NodeType>
+template<typename WorkFunctor>
+void KdTreeNumaReplicas<DataPoint, NodeType>::run_pinned(WorkFunctor work) const
+{
+#ifdef _OPENMP
+    const int thread = omp_get_thread_num();
+#else
+    const int thread = 0;
+#endif
+    int node, cpu;
+    m_topology.placement(thread, node, cpu);
+    internal::ScopedThreadPinning pinning(cpu, m_pin_threads);
+    work(replica(node));
+}
+
+template <class DataPoint, class NodeType>
+template<typename VectorUserContainer>
+void KdTreeNumaReplicas<DataPoint, NodeType>::k_nearest_neighbors_batch(const VectorUserContainer& points, int k,
+                                                                     int* indices, Scalar* squared_distances) const
+{
+    PONCA_TRACE_ZONE("ponca::KdTreeNumaReplicas::k_nearest_neighbors_batch");
+    using VectorType = typename DataPoint::VectorType;
+    const int count = static_cast<int>(points.size());
+    const IndexContainer order = m_tree->leaf_order(points);
+
+#pragma omp parallel
+    run_pinned([&](const TreeType& tree) {
+        KdTreeKNearestPointQuery<DataPoint, NodeType> query(&tree, k, VectorType::Zero());
+#pragma omp for
+        for(int n = 0; n < count; ++n)
+        {
+            const int i = order[n];
+            query.set_input(points[i]);
+            query.begin();
+
+            // the queue is sorted by increasing distance, the missing neighbors are set to -1
+            int* rowIndices = indices + std::ptrdiff_t(i) * k;
+            Scalar* rowDistances = squared_distances != nullptr ? squared_distances + std::ptrdiff_t(i) * k : nullptr;
+            int j = 0;
+            for(auto it = query.queue().begin(); it != query.queue().end() && j < k; ++it, ++j)
+            {
+                rowIndices[j] = it->index;
+                if(rowDistances != nullptr)
+                    rowDistances[j] = it->squared_distance;
+            }
+            for(; j < k; ++j)
+            {
+                rowIndices[j] = -1;
+                if(rowDistances != nullptr)
+                    rowDistances[j] = std::numeric_limits<Scalar>::max();
+            }
+        }
+    });
+}
+
+template <class DataPoint, class NodeType>
+template<typename VectorUserContainer>
+void KdTreeNumaReplicas<DataPoint, NodeType>::range_neighbors_batch(const VectorUserContainer& points, Scalar r,
+                                                                 std::vector<std::size_t>& offsets,
+                                                                 IndexContainer& neighbors,
+                                                                 std::vector<Scalar>* squared_distances) const
+{
+    PONCA_TRACE_ZONE("ponca::KdTreeNumaReplicas::range_neighbors_batch");
+    const int count = static_cast<int>(points.size());
+    offsets.assign(count + 1, 0);
+    neighbors.clear();
+    if(squared_distances != nullptr)
+        squared_distances->clear();
+    if(count == 0)
+        return;
+
+#pragma omp parallel
+    run_pinned([&](const TreeType& tree) {
+        KdTreeRangePointQuery<DataPoint, NodeType> query(&tree, r, points[0]);
+        IndexContainer localNeighbors;
+        std::vector<Scalar> localDistances;
+        int first = count;
+
+        // with a static schedule, each thread processes a contiguous range of queries
+#pragma omp for schedule(static)
+        for(int i = 0; i < count; ++i)
+        {
+            first = std::min(first, i);
+            query.set_input(points[i]);
+            const std::size_t size = localNeighbors.size();
+            for(int j : query)
+            {
+                localNeighbors.push_back(j);
+                if(squared_distances != nullptr)
+                    localDistances.push_back((tree.point(j).pos() - points[i]).squaredNorm());
+            }
+            offsets[i + 1] = localNeighbors.size() - size;
+        }
+
+#pragma omp single
+        {
+            for(int i = 0; i < count; ++i)
+                offsets[i + 1] += offsets[i];
+            neighbors.resize(offsets[count]);
+            if(squared_distances != nullptr)
+                squared_distances->resize(offsets[count]);
+        }
+
+        // each thread copies its neighbors at the offset of its first query
+        if(first < count)
+        {
+            std::copy(localNeighbors.begin(), localNeighbors.end(), neighbors.begin() + offsets[first]);
+            if(squared_distances != nullptr)
+                std::copy(localDistances.begin(), localDistances.end(), squared_distances->begin() + offsets[first]);
+        }
+    });
+}
+
+} // namespace Ponca
@@ -0,0 +1,173 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./kdTree.h"
+#include "../../Common/Tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace Ponca {
+
+namespace internal {
+
+/// \brief Call `block(first, positions)` for the consecutive blocks of at most `block_size` points indexed by
+/// `tree`, `positions` holding the positions of the points `tree.index_buffer()[first, first + positions.size())`
+template <class DataPoint, class NodeType, typename BlockFunctor>
+inline void for_each_index_block(const KdTree<DataPoint, NodeType>& tree, int block_size, BlockFunctor block)
+{
+    const int count = tree.index_count();
+    const int* indices = tree.index_buffer();
+    block_size = std::max(block_size, 1);
+
+    std::vector<typename DataPoint::VectorType> positions;
+    for(int first = 0; first < count; first += block_size)
+    {
+        const int size = std::min(block_size, count - first);
+        positions.resize(size);
+        for(int b = 0; b < size; ++b)
+            positions[b] = tree.point(indices[first + b]).pos();
+        block(first, positions);
+    }
+}
+
+/// \brief Write to `kept` the indices of the tree whose flag is set, `flags` following the tree index order
+template <class DataPoint, class NodeType>
+inline void compact_indices(const KdTree<DataPoint, NodeType>& tree, const std::vector<char>& flags,
+                            std::vector<int>& kept)
+{
+    const int* indices = tree.index_buffer();
+    kept.clear();
+    for(int n = 0; n < tree.index_count(); ++n)
+    {
+        if(flags[n])
+            kept.push_back(indices[n]);
+    }
+    std::sort(kept.begin(), kept.end());
+}
+
+} // namespace internal
+
+/*!
+    \brief Statistical outlier removal: keep the points whose mean distance to their `k` nearest neighbors is at
+    most `std_ratio` standard deviations above the mean of all the points
+
+    Only the points indexed by `tree` are considered, both as candidates and as neighbors. Their `k` nearest
+    neighbors are computed by blocks of `block_size` points with KdTree::k_nearest_neighbors_batch, in parallel.
+    The kept points are written to `kept` by increasing index, to be given as the sampling of
+    `KdTree::build(points, kept)` or `KdTree::build_view(points, count, kept)`, without copying the points.
+
+    \code
+    std::vector<int> kept;
+    statistical_outlier_filter(tree, 16, 1.0, kept);
+    tree.build_view(points.data(), count, kept);
+    \endcode
+
+    \param k Number of neighbors, the point itself excluded, clamped to the number of other indexed points
+    \param std_ratio Number of standard deviations of the mean distances above their mean, beyond which the
+    points are removed
+    \ingroup spatialpartitioning
+*/
+template <class DataPoint, class NodeType>
+inline void statistical_outlier_filter(const KdTree<DataPoint, NodeType>& tree, int k,
+                                       typename DataPoint::Scalar std_ratio, std::vector<int>& kept,
+                                       int block_size = 65536)
+{
+    using Scalar = typename DataPoint::Scalar;
+    PONCA_TRACE_ZONE("ponca::statistical_outlier_filter");
+
+    const int count = tree.index_count();
+    k = std::min(k, count - 1);
+    if(k <= 0)
+    {
+        kept.assign(tree.index_buffer(), tree.index_buffer() + count);
+        std::sort(kept.begin(), kept.end());
+        return;
+    }
+
+    // the first neighbor of a point is at distance 0: the point itself, or one of its duplicates
+    const int queried = k + 1;
+    std::vector<Scalar> mean_distances(count);
+    std::vector<int> neighbors;
+    std::vector<Scalar> squared_distances;
+    internal::for_each_index_block(tree, block_size, [&](int first, const auto& positions)
+    {
+        const int size = int(positions.size());
+        neighbors.resize(std::size_t(size) * queried);
+        squared_distances.resize(std::size_t(size) * queried);
+        tree.k_nearest_neighbors_batch(positions, queried, neighbors.data(), squared_distances.data());
+#pragma omp parallel for
+        for(int b = 0; b < size; ++b)
+        {
+            using std::sqrt;
+            Scalar sum = 0;
+            for(int s = 1; s < queried; ++s)
+                sum += sqrt(squared_distances[std::size_t(b) * queried + s]);
+            mean_distances[first + b] = sum / Scalar(k);
+        }
+    });
+
+    double sum = 0, squared_sum = 0;
+#pragma omp parallel for reduction(+: sum, squared_sum)
+    for(int n = 0; n < count; ++n)
+    {
+        sum += double(mean_distances[n]);
+        squared_sum += double(mean_distances[n]) * double(mean_distances[n]);
+    }
+    const double mean = sum / count;
+    const double variance = std::max(0., squared_sum / count - mean * mean);
+    const Scalar threshold = Scalar(mean + double(std_ratio) * std::sqrt(variance));
+
+    std::vector<char> flags(count);
+#pragma omp parallel for
+    for(int n = 0; n < count; ++n)
+        flags[n] = mean_distances[n] <= threshold;
+    internal::compact_indices(tree, flags, kept);
+}
+
+/*!
+    \brief Radius outlier removal: keep the points having at least `min_neighbors` other points within the
+    radius `r`
+
+    Same as statistical_outlier_filter, the neighbors being computed by KdTree::range_neighbors_batch.
+
+    \code
+    std::vector<int> kept;
+    radius_outlier_filter(tree, r, 4, kept);
+    tree.build(points, kept);
+    \endcode
+
+    \param min_neighbors Minimal number of neighbors within the radius, the point itself excluded
+    \ingroup spatialpartitioning
+*/
+template <class DataPoint, class NodeType>
+inline void radius_outlier_filter(const KdTree<DataPoint, NodeType>& tree, typename DataPoint::Scalar r,
+                                  int min_neighbors, std::vector<int>& kept, int block_size = 65536)
+{
+    PONCA_TRACE_ZONE("ponca::radius_outlier_filter");
+
+    std::vector<char> flags(tree.index_count());
+    std::vector<std::size_t> offsets;
+    typename KdTree<DataPoint, NodeType>::IndexContainer neighbors;
+    internal::for_each_index_block(tree, block_size, [&](int first, const auto& positions)
+    {
+        tree.range_neighbors_batch(positions, r, offsets, neighbors);
+        const int size = int(positions.size());
+#pragma omp parallel for
+        for(int b = 0; b < size; ++b)
+        {
+            // the neighbors include the point itself
+            flags[first + b] = offsets[b + 1] - offsets[b] > std::size_t(std::max(min_neighbors, 0));
+        }
+    });
+    internal::compact_indices(tree, flags, kept);
+}
+
+} // namespace Ponca
@@ -6,34 +6,335 @@
 
 #pragma once
 
+#include "./kdTreeNode.h"
 #include "../indexSquaredDistance.h"
 #include "../../Common/Containers/stack.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
 
+
+/// \brief Maximal depth of the KdTrees, which sizes the traversal stacks of the queries (`2 * PCA_KDTREE_MAX_DEPTH`
+/// entries), define to a larger value for deeper trees
+///
+/// The depth of each tree is set at runtime by KdTree::set_max_depth, up to this bound.
+#ifndef PCA_KDTREE_MAX_DEPTH
 #define PCA_KDTREE_MAX_DEPTH 32
+#endif
+
+/// \brief Compile the software prefetches of the KdTree traversals, enabled at runtime by KdTreeQuery::set_prefetch
+/// (1 by default with GCC and Clang), define to 0 to remove them
+#ifndef PCA_KDTREE_PREFETCH
+#  if defined(__GNUC__) || defined(__clang__)
+#    define PCA_KDTREE_PREFETCH 1
+#  else
+#    define PCA_KDTREE_PREFETCH 0
+#  endif
+#endif
+
+/// \brief Compile the work counters of the KdTree queries, see KdTreeQuery::counters (0 by default), define to 1 to
+/// count the work of the traversals, at the cost of a few increments per node
+#ifndef PCA_KDTREE_QUERY_COUNTERS
+#  define PCA_KDTREE_QUERY_COUNTERS 0
+#endif
 
 namespace Ponca {
-template<class DataPoint> class KdTree;
+template<class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>> class KdTree;
+
+/// \brief Work done by KdTree queries, counted when PCA_KDTREE_QUERY_COUNTERS is 1
+/// \see KdTreeQuery::counters, kdtree_thread_query_counters
+/// \ingroup spatialpartitioning
+struct KdTreeQueryCounters
+{
+    std::uint64_t nodes_popped         {0}; ///< Nodes taken from the stack or heap of the traversal
+    std::uint64_t leaves_scanned       {0}; ///< Leaves whose points are tested
+    std::uint64_t distance_evaluations {0}; ///< Points tested in the scanned leaves
+    std::uint64_t results              {0}; ///< Neighbors returned
+
+    inline KdTreeQueryCounters& operator+=(const KdTreeQueryCounters& other)
+    {
+        nodes_popped         += other.nodes_popped;
+        leaves_scanned       += other.leaves_scanned;
+        distance_evaluations += other.distance_evaluations;
+        results              += other.results;
+        return *this;
+    }
+};
+
+/// \brief Counters of all the KdTree queries run by the calling thread, since the thread started or the counters
+/// were reset by the user, e.g. `kdtree_thread_query_counters() = {}`
+///
+/// Always zero when PCA_KDTREE_QUERY_COUNTERS is 0. Sum them over the OpenMP threads to get the work of a
+/// parallel batch of queries.
+/// \ingroup spatialpartitioning
+inline KdTreeQueryCounters& kdtree_thread_query_counters()
+{
+    static thread_local KdTreeQueryCounters counters;
+    return counters;
+}
 
+/// \brief Order in which the k-nearest neighbors queries visit the nodes of the tree
 /// \ingroup spatialpartitioning
-template <class DataPoint>
+enum class KdTreeTraversal
+{
+    DepthFirst, ///< Closest child first, with a fixed-size stack (default)
+    BestFirst   ///< Closest node first, with a priority queue: scans less leaves, faster for large k (64 and more)
+};
+
+/// \ingroup spatialpartitioning
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
 class KdTreeQuery
 {
 public:
     using Scalar          = typename DataPoint::Scalar;
     using VectorType      = typename DataPoint::VectorType;
 
-    explicit inline KdTreeQuery(const KdTree<DataPoint>* kdtree) : m_kdtree( kdtree ), m_stack() {}
+    explicit inline KdTreeQuery(const KdTree<DataPoint, NodeType>* kdtree) : m_kdtree( kdtree ), m_stack() {}
+
+    /// \brief Number of leaves scanned since the beginning of the last search
+    /// \see KdTree::statistics
+    inline int leaf_visits() const { return m_leaf_visits; }
+
+    /// \brief Work done by the last search, always zero when PCA_KDTREE_QUERY_COUNTERS is 0
+    ///
+    /// The counters of the range and region queries grow while their results are iterated.
+    inline const KdTreeQueryCounters& counters() const { return m_counters; }
+
+    /// \brief Approximation tolerance of the nearest neighbors searches (0 for exact searches, default)
+    ///
+    /// The nodes farther than \f$ d / (1+\epsilon) \f$ are pruned, \f$ d \f$ being the distance to the current
+    /// farthest neighbor: each returned neighbor is at most \f$ 1+\epsilon \f$ times farther than the exact one.
+    inline Scalar epsilon() const { return m_epsilon; }
+    inline void set_epsilon(Scalar epsilon)
+    {
+        m_epsilon = epsilon;
+        m_pruning_factor = Scalar(1) / ((Scalar(1) + epsilon) * (Scalar(1) + epsilon));
+    }
+
+    /// \brief Maximal number of leaves scanned by the nearest neighbors searches (no limit by default)
+    ///
+    /// The search stops after scanning this number of leaves, returning the best neighbors found so far.
+    inline int max_leaf_visits() const { return m_max_leaf_visits; }
+    inline void set_max_leaf_visits(int max_leaf_visits) { m_max_leaf_visits = max_leaf_visits; }
+
+    /// \brief Resume the nearest neighbors searches from the path of the previous search (disabled by default)
+    ///
+    /// The query keeps the path from the root to the leaf of its previous input. The next search resumes the
+    /// descent from the deepest node of this path whose bounding box contains the new input, the siblings of the
+    /// nodes above it being stacked with their distance to the input, instead of descending from the root. This
+    /// saves the top of the descent when consecutive inputs are close, e.g. sorted with KdTree::leaf_order(). The
+    /// results are the same as without warm start.
+    inline bool warm_start() const { return m_warm_start; }
+    inline void set_warm_start(bool warm_start) { m_warm_start = warm_start; }
+
+    /// \brief Traversal of the k-nearest neighbors searches, see KdTreeTraversal
+    inline KdTreeTraversal traversal() const { return m_traversal; }
+    inline void set_traversal(KdTreeTraversal traversal) { m_traversal = traversal; }
+
+    /// \brief Prefetch the nodes and leaves visited next by the depth-first traversals (disabled by default)
+    ///
+    /// While a leaf is tested and scanned, the next node of the stack is fetched, and the indices and leaf
+    /// positions of a leaf are fetched while its bounding box is tested. This hides part of the memory latency on
+    /// trees that do not fit in the cache, and has no effect when PCA_KDTREE_PREFETCH is 0. The gain depends on
+    /// the memory system, see examples/cpp/ponca_benchmark_kdtree_prefetch.cpp.
+    inline bool prefetch() const { return m_prefetch; }
+    inline void set_prefetch(bool prefetch) { m_prefetch = prefetch; }
 
 protected:
     /// \brief Init stack for a new search
     inline void reset() {
         m_stack.clear();
         m_stack.push({0,0});
+        m_leaf_visits = 0;
+#if PCA_KDTREE_QUERY_COUNTERS
+        m_counters = KdTreeQueryCounters();
+#endif
+    }
+
+    /// \brief Replace the root on the stack by the descent of the nearest neighbors searches to the leaf of `point`
+    ///
+    /// As the depth-first traversal, the descent follows the split planes and stacks the farthest child of each
+    /// node, leaving the leaf on top of the stack. With warm start, it resumes from the previous path (see
+    /// set_warm_start()). The path is checked against the tree, which may have been rebuilt since.
+    inline void descend(const VectorType& point)
+    {
+        const auto* nodes  = m_kdtree->node_buffer();
+        const auto* bounds = m_kdtree->node_bounds_buffer();
+        const int nodeCount = m_kdtree->node_count();
+        if(nodeCount == 0) return;
+
+        int resume = 0;
+        if(m_warm_start)
+        {
+            for(int d = 1; d < m_path_size; ++d)
+            {
+                const auto& parent = nodes[m_path[d-1]];
+                const int first = int(parent.firstChildId);
+                if(parent.leaf || m_path[d] >= nodeCount || (m_path[d] != first && m_path[d] != first+1) ||
+                   !bounds[m_path[d]].contains(point))
+                    break;
+                resume = d;
+            }
+        }
+
+        // the siblings of the path above the resumed node cover the rest of the tree
+        m_stack.clear();
+        for(int d = 1; d <= resume; ++d)
+        {
+            const int sibling = 2 * int(nodes[m_path[d-1]].firstChildId) + 1 - m_path[d];
+            m_stack.push({sibling, bounds[sibling].squaredExteriorDistance(point)});
+        }
+
+        m_path[0] = 0;
+        m_path_size = resume + 1;
+        int index = m_path[resume];
+        while(!nodes[index].leaf)
+        {
+            count_node();
+            const auto& node = nodes[index];
+            const Scalar offset = point[node.dim] - node.splitValue;
+            const int first = int(node.firstChildId);
+            m_stack.push({offset < 0 ? first+1 : first, offset * offset});
+            index = offset < 0 ? first : first+1;
+            // a truncated path is still a valid start
+            if(m_path_size < PathSize) m_path[m_path_size++] = index;
+        }
+        m_stack.push({index, Scalar(0)});
+    }
+
+    /// \brief Best-first traversal, scanning the leaves with `collect` by increasing distance to `point`
+    ///
+    /// The traversal starts from the nodes stacked by descend(), and stops as soon as the closest remaining node
+    /// is farther than `search_distance()`.
+    template<typename DistanceFunctor, typename Collector>
+    inline void search_best_first(const VectorType& point, DistanceFunctor search_distance, const Collector& collect)
+    {
+        const auto* nodes  = m_kdtree->node_buffer();
+        const auto* bounds = m_kdtree->node_bounds_buffer();
+        const auto farther = [](const IndexSquaredDistance<Scalar>& a, const IndexSquaredDistance<Scalar>& b)
+        { return a.squared_distance > b.squared_distance; };
+
+        // the heap keeps its capacity from one search to the next
+        m_heap.clear();
+        for(; !m_stack.empty(); m_stack.pop())
+            m_heap.push_back({m_stack.top().index, bounds[m_stack.top().index].squaredExteriorDistance(point)});
+        std::make_heap(m_heap.begin(), m_heap.end(), farther);
+        while(!m_heap.empty())
+        {
+            std::pop_heap(m_heap.begin(), m_heap.end(), farther);
+            const IndexSquaredDistance<Scalar> qnode = m_heap.back();
+            m_heap.pop_back();
+            count_node();
+            if(qnode.squared_distance >= pruning_distance(search_distance())) return;
+
+            const auto& node = nodes[qnode.index];
+            if(node.leaf)
+            {
+                visit_leaf(node);
+                m_kdtree->leaf_scan(node, point, collect, search_distance);
+                if(leaf_budget_reached()) return;
+            }
+            else
+            {
+                for(int child = node.firstChildId; child < int(node.firstChildId) + 2; ++child)
+                {
+                    const Scalar d = bounds[child].squaredExteriorDistance(point);
+                    if(d < pruning_distance(search_distance()))
+                    {
+                        m_heap.push_back({child, d});
+                        std::push_heap(m_heap.begin(), m_heap.end(), farther);
+                    }
+                }
+            }
+        }
     }
 
-    const KdTree<DataPoint>* m_kdtree { nullptr };
+    /// \brief Count a leaf scanned by the search, and the distances to its points
+    inline void visit_leaf(const NodeType& leaf)
+    {
+        ++m_leaf_visits;
+#if PCA_KDTREE_QUERY_COUNTERS
+        count(&KdTreeQueryCounters::leaves_scanned, 1);
+        count(&KdTreeQueryCounters::distance_evaluations, leaf.size);
+#else
+        (void)leaf;
+#endif
+    }
+    /// \brief Count a node taken from the stack or heap of the traversal
+    inline void count_node()
+    {
+#if PCA_KDTREE_QUERY_COUNTERS
+        count(&KdTreeQueryCounters::nodes_popped, 1);
+#endif
+    }
+    /// \brief Count `n` neighbors returned by the search
+    inline void count_results(std::size_t n)
+    {
+#if PCA_KDTREE_QUERY_COUNTERS
+        count(&KdTreeQueryCounters::results, n);
+#else
+        (void)n;
+#endif
+    }
+
+    /// \brief Prefetch the children of the inner node `node`, stored contiguously
+    inline void prefetch_children(const NodeType& node) const
+    {
+#if PCA_KDTREE_PREFETCH
+        if(m_prefetch) __builtin_prefetch(m_kdtree->node_buffer() + node.firstChildId);
+#endif
+    }
+    /// \brief Prefetch the node and bounding box at the top of the stack, visited next
+    inline void prefetch_top() const
+    {
+#if PCA_KDTREE_PREFETCH
+        if(!m_prefetch || m_stack.empty()) return;
+        __builtin_prefetch(m_kdtree->node_buffer() + m_stack.top().index);
+        __builtin_prefetch(m_kdtree->node_bounds_buffer() + m_stack.top().index);
+#endif
+    }
+    /// \brief Prefetch the first indices and leaf positions of the leaf `node`
+    inline void prefetch_leaf(const NodeType& node) const
+    {
+#if PCA_KDTREE_PREFETCH
+        if(m_prefetch) m_kdtree->prefetch_leaf(node.start);
+#endif
+    }
+
+#if PCA_KDTREE_QUERY_COUNTERS
+    /// \brief Add `n` to a counter of the search and of the thread
+    inline void count(std::uint64_t KdTreeQueryCounters::* counter, std::uint64_t n)
+    {
+        m_counters.*counter += n;
+        kdtree_thread_query_counters().*counter += n;
+    }
+#endif
+
+    /// \brief Squared distance under which a node may contain a neighbor closer than `squared_distance`
+    inline Scalar pruning_distance(Scalar squared_distance) const { return squared_distance * m_pruning_factor; }
+    /// \brief Is the leaf budget of the search exhausted
+    inline bool leaf_budget_reached() const { return m_leaf_visits >= m_max_leaf_visits; }
+
+    const KdTree<DataPoint, NodeType>* m_kdtree { nullptr };
     Stack<IndexSquaredDistance<typename DataPoint::Scalar>, 2 * PCA_KDTREE_MAX_DEPTH> m_stack;
+    int m_leaf_visits { 0 };
+    Scalar m_epsilon { 0 };
+    Scalar m_pruning_factor { 1 };
+    int m_max_leaf_visits { std::numeric_limits<int>::max() };
+    bool m_warm_start { false };
+    static constexpr int PathSize = PCA_KDTREE_MAX_DEPTH + 1;
+    int m_path[PathSize] {}; // nodes from the root to the leaf of the previous search, see descend()
+    int m_path_size { 0 };
+    KdTreeTraversal m_traversal { KdTreeTraversal::DepthFirst };
+    bool m_prefetch { false };
+    std::vector<IndexSquaredDistance<Scalar>> m_heap; // nodes to visit by the best-first traversal
+#if PCA_KDTREE_QUERY_COUNTERS
+    KdTreeQueryCounters m_counters;
+#else
+    static constexpr KdTreeQueryCounters m_counters {};
+#endif
 };
 
 } // namespace Ponca
\ No newline at end of file
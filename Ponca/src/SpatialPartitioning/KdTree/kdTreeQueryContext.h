@@ -0,0 +1,174 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./kdTree.h"
+
+#include <vector>
+
+namespace Ponca {
+
+/// \brief Queries of a KdTree owned by a worker thread, reused from one search to the next
+///
+/// Each query of KdTree allocates its k-nearest neighbors queue and best-first heap when it is created. The
+/// context holds one instance of each query type and rebinds it to the new input: the buffers keep their capacity,
+/// so that steady-state queries perform no allocation and reuse the same (cached) memory. The traversal stack of the
+/// queries is a fixed size array stored in the query itself, thus also reused.
+///
+/// The returned queries are references to the members of the context: iterating a query invalidates the previous
+/// iteration of the same query type. A context is not thread-safe, each thread must own its context:
+/// \code
+/// #pragma omp parallel
+/// {
+///     KdTreeQueryContext<DataPoint> context(kdtree);
+///     #pragma omp for
+///     for(int i = 0; i < n; ++i)
+///         for(int j : context.k_nearest_neighbors(i, k)) { ... }
+/// }
+/// \endcode
+///
+/// \ingroup spatialpartitioning
+template<class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+class KdTreeQueryContext
+{
+public:
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using KdTreeType = KdTree<DataPoint, NodeType>;
+
+    /// \param kdtree Tree to query, which must outlive the context
+    /// \param k Number of neighbors for which the k-nearest neighbors buffers are preallocated
+    explicit inline KdTreeQueryContext(const KdTreeType& kdtree, int k = 0) :
+        m_kdtree(&kdtree),
+        m_k_nearest_point(m_kdtree, k, VectorType::Zero()),
+        m_k_nearest_index(m_kdtree, k, 0),
+        m_k_nearest_range_point(m_kdtree, k, Scalar(0), VectorType::Zero()),
+        m_k_nearest_range_index(m_kdtree, k, Scalar(0), 0),
+        m_nearest_point(m_kdtree, VectorType::Zero()),
+        m_nearest_index(m_kdtree, 0),
+        m_range_point(m_kdtree, Scalar(0), VectorType::Zero()),
+        m_range_index(m_kdtree, Scalar(0), 0)
+    {
+    }
+
+    inline const KdTreeType& kdtree() const { return *m_kdtree; }
+
+    // Query -------------------------------------------------------------------
+public:
+    inline KdTreeKNearestPointQuery<DataPoint, NodeType>& k_nearest_neighbors(const VectorType& point, int k)
+    {
+        return m_k_nearest_point(point, k);
+    }
+
+    inline KdTreeKNearestIndexQuery<DataPoint, NodeType>& k_nearest_neighbors(int index, int k)
+    {
+        return m_k_nearest_index(index, k);
+    }
+
+    inline KdTreeKNearestRangePointQuery<DataPoint, NodeType>& k_nearest_range_neighbors(const VectorType& point,
+                                                                                           int k, Scalar r)
+    {
+        return m_k_nearest_range_point(point, k, r);
+    }
+
+    inline KdTreeKNearestRangeIndexQuery<DataPoint, NodeType>& k_nearest_range_neighbors(int index, int k, Scalar r)
+    {
+        return m_k_nearest_range_index(index, k, r);
+    }
+
+    inline KdTreeNearestPointQuery<DataPoint, NodeType>& nearest_neighbor(const VectorType& point)
+    {
+        return m_nearest_point(point);
+    }
+
+    inline KdTreeNearestIndexQuery<DataPoint, NodeType>& nearest_neighbor(int index)
+    {
+        return m_nearest_index(index);
+    }
+
+    inline KdTreeRangePointQuery<DataPoint, NodeType>& range_neighbors(const VectorType& point, Scalar r)
+    {
+        return m_range_point(point, r);
+    }
+
+    inline KdTreeRangeIndexQuery<DataPoint, NodeType>& range_neighbors(int index, Scalar r)
+    {
+        return m_range_index(index, r);
+    }
+
+    /// \brief Iterate `query` and store the indices of its neighbors in the scratch buffer of the context
+    ///
+    /// \return the scratch buffer, valid until the next call to collect()
+    template<typename QueryT>
+    inline const std::vector<int>& collect(QueryT& query)
+    {
+        m_results.clear();
+        for(int j : query)
+            m_results.push_back(j);
+        return m_results;
+    }
+
+    /// \brief Scratch buffer filled by the last call to collect()
+    inline const std::vector<int>& results() const { return m_results; }
+
+    // Parameters --------------------------------------------------------------
+public:
+    /// \brief Set the approximation tolerance of the nearest neighbors queries, see KdTreeQuery::set_epsilon
+    inline void set_epsilon(Scalar epsilon)
+    {
+        for_each_nearest([epsilon](auto& query) { query.set_epsilon(epsilon); });
+    }
+
+    /// \brief Enable the warm start of the nearest neighbors queries, see KdTreeQuery::set_warm_start
+    inline void set_warm_start(bool warm_start)
+    {
+        for_each_nearest([warm_start](auto& query) { query.set_warm_start(warm_start); });
+    }
+
+    /// \brief Enable the software prefetches of all the queries, see KdTreeQuery::set_prefetch
+    inline void set_prefetch(bool prefetch)
+    {
+        for_each_nearest([prefetch](auto& query) { query.set_prefetch(prefetch); });
+        m_k_nearest_range_point.set_prefetch(prefetch);
+        m_k_nearest_range_index.set_prefetch(prefetch);
+        m_range_point.set_prefetch(prefetch);
+        m_range_index.set_prefetch(prefetch);
+    }
+
+    /// \brief Set the traversal of the k-nearest neighbors queries, see KdTreeQuery::set_traversal
+    inline void set_traversal(KdTreeTraversal traversal)
+    {
+        m_k_nearest_point.set_traversal(traversal);
+        m_k_nearest_index.set_traversal(traversal);
+    }
+
+    // Internal ----------------------------------------------------------------
+protected:
+    template<typename Functor>
+    inline void for_each_nearest(Functor f)
+    {
+        f(m_k_nearest_point);
+        f(m_k_nearest_index);
+        f(m_nearest_point);
+        f(m_nearest_index);
+    }
+
+    const KdTreeType* m_kdtree;
+
+    KdTreeKNearestPointQuery<DataPoint, NodeType>      m_k_nearest_point;
+    KdTreeKNearestIndexQuery<DataPoint, NodeType>      m_k_nearest_index;
+    KdTreeKNearestRangePointQuery<DataPoint, NodeType> m_k_nearest_range_point;
+    KdTreeKNearestRangeIndexQuery<DataPoint, NodeType> m_k_nearest_range_index;
+    KdTreeNearestPointQuery<DataPoint, NodeType>       m_nearest_point;
+    KdTreeNearestIndexQuery<DataPoint, NodeType>       m_nearest_index;
+    KdTreeRangePointQuery<DataPoint, NodeType>         m_range_point;
+    KdTreeRangeIndexQuery<DataPoint, NodeType>         m_range_index;
+
+    std::vector<int> m_results; // scratch buffer of collect()
+};
+
+} // namespace Ponca
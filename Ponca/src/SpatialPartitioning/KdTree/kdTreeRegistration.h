@@ -0,0 +1,327 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./kdTree.h"
+#include "../../Common/Tracing.h"
+
+#include <Eigen/Geometry>
+#include <Eigen/SVD>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace Ponca {
+
+/// \brief Error minimized by IcpRegistration
+/// \ingroup spatialpartitioning
+enum ICP_METRIC : unsigned char
+{
+    /*! \brief Squared distance between the corresponding points, minimized in closed form (Kabsch) */
+    ICP_POINT_TO_POINT = 0,
+    /*! \brief Squared distance of the source points to the tangent plane of their corresponding target point,
+     * minimized by linearizing the rotation. Converges in less iterations on surfaces, requires the target
+     * normals */
+    ICP_POINT_TO_PLANE = 1
+};
+
+/// \brief Parameters of IcpRegistration::align
+/// \ingroup spatialpartitioning
+template <typename Scalar>
+struct IcpParameters
+{
+    ICP_METRIC metric {ICP_POINT_TO_PLANE}; ///< Minimized error
+    int max_iterations {30};                 ///< Largest number of iterations
+    /// Correspondences farther than this distance are rejected (none by default)
+    Scalar max_distance {std::numeric_limits<Scalar>::max()};
+    /// The iterations stop when the RMS of the residuals decreases by less than this fraction of its previous value
+    Scalar convergence {Scalar(1e-5)};
+};
+
+/// \brief Output of IcpRegistration::align
+/// \ingroup spatialpartitioning
+template <typename Scalar>
+struct IcpResult
+{
+    Eigen::Transform<Scalar, 3, Eigen::Isometry> transform; ///< Transformation from the source to the target
+    int iterations {0};       ///< Number of iterations done
+    int correspondences {0};  ///< Number of correspondences kept at the last iteration
+    Scalar rms {0};           ///< Root mean square of the residuals at the last iteration
+    bool converged {false};   ///< Did the RMS decrease get below IcpParameters::convergence
+};
+
+/*!
+    \brief Rigid registration of point clouds on a KdTree by Iterative Closest Point
+
+    The target is a KdTree built once, with its normals copied at construction for the point-to-plane metric, so
+    that a stream of source frames is aligned against it. Each iteration:
+     - transforms the source points by the current estimate,
+     - finds the nearest target point of each one, in parallel, each thread reusing one warm-started nearest
+       query over the source points sorted with KdTree::leaf_order(),
+     - rejects the correspondences farther than IcpParameters::max_distance,
+     - accumulates the normal equations by a parallel reduction over fixed blocks of source points, which gives
+       the same result for any number of threads,
+     - solves for the increment and composes it with the estimate.
+
+    The buffers are kept from one call of align() to the next, so that aligning frames of similar size does not
+    allocate.
+
+    \code
+    IcpRegistration<Point> icp(target, normals);
+    IcpParameters<Scalar> parameters;
+    parameters.max_distance = Scalar(0.1);
+    for (const auto& frame : frames)
+        pose = icp.align(frame, pose, parameters).transform;
+    \endcode
+
+    \warning Only defined for 3D points.
+    \ingroup spatialpartitioning
+*/
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+class IcpRegistration
+{
+public:
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using Transform  = Eigen::Transform<Scalar, 3, Eigen::Isometry>;
+    using TreeType   = KdTree<DataPoint, NodeType>;
+
+    static_assert(DataPoint::Dim == 3, "IcpRegistration is only defined for 3D points");
+
+    /// \brief Number of source points accumulated together, the unit of the parallel reduction
+    static constexpr int BlockSize = 4096;
+
+    /// \brief Target `target` without normals, for the point-to-point metric
+    explicit IcpRegistration(const TreeType& target) : m_target(&target) { }
+
+    /// \brief Target `target` with the normals `normals`, indexed as the points of the tree and copied
+    ///
+    /// The normals are e.g. the `normal()` of the points, or the output of computeNormalsCurvatures on the
+    /// tree. They do not need to be consistently oriented.
+    template <typename NormalContainer>
+    IcpRegistration(const TreeType& target, const NormalContainer& normals) : m_target(&target)
+    {
+        set_normals(normals);
+    }
+
+    /// \brief Copy the normals of the target points, to be called when the tree is rebuilt
+    template <typename NormalContainer>
+    inline void set_normals(const NormalContainer& normals)
+    {
+        if (int(normals.size()) != m_target->point_count())
+            throw std::invalid_argument("IcpRegistration: one normal per target point is required");
+        m_normals.assign(normals.begin(), normals.end());
+    }
+
+    /// \brief Change the target tree, keeping the normals when it has the same points
+    inline void set_target(const TreeType& target) { m_target = &target; }
+
+    inline const TreeType& target() const { return *m_target; }
+    inline bool has_normals() const { return !m_normals.empty(); }
+
+    /// \brief Transformation aligning the positions `source` on the target, starting from `initial`
+    ///
+    /// \param source Container of VectorType, with `size()` and `operator[]`
+    /// \throw std::invalid_argument for the point-to-plane metric when no normals were given, or when the target
+    /// tree is empty
+    template <typename VectorUserContainer>
+    inline IcpResult<Scalar> align(const VectorUserContainer& source, const Transform& initial,
+                                   const IcpParameters<Scalar>& parameters = IcpParameters<Scalar>());
+
+protected:
+    using Vector6 = Eigen::Matrix<Scalar, 6, 1>;
+    using Matrix6 = Eigen::Matrix<Scalar, 6, 6>;
+    using Matrix3 = Eigen::Matrix<Scalar, 3, 3>;
+
+    /// \brief Sums over the correspondences of a block, from which the increment is solved
+    struct Accumulator
+    {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        Matrix6 jtj {Matrix6::Zero()};       // point-to-plane normal equations
+        Vector6 jtr {Vector6::Zero()};
+        Matrix3 cross {Matrix3::Zero()};     // point-to-point sums
+        VectorType source_sum {VectorType::Zero()};
+        VectorType target_sum {VectorType::Zero()};
+        Scalar squared_residuals {0};
+        int count {0};
+
+        inline Accumulator& operator+=(const Accumulator& other)
+        {
+            jtj += other.jtj;
+            jtr += other.jtr;
+            cross += other.cross;
+            source_sum += other.source_sum;
+            target_sum += other.target_sum;
+            squared_residuals += other.squared_residuals;
+            count += other.count;
+            return *this;
+        }
+    };
+
+    /// \brief Find the correspondences of the source points by `transform` and accumulate them
+    template <typename VectorUserContainer>
+    inline Accumulator accumulate(const VectorUserContainer& source, const Transform& transform,
+                                  const IcpParameters<Scalar>& parameters);
+
+    /// \brief Increment minimizing the accumulated error, or identity when it is degenerate
+    inline static Transform solve(const Accumulator& sums, ICP_METRIC metric);
+
+    const TreeType* m_target {nullptr};
+    std::vector<VectorType, Eigen::aligned_allocator<VectorType>> m_normals;
+    typename TreeType::IndexContainer m_order;
+    std::vector<Accumulator, Eigen::aligned_allocator<Accumulator>> m_blocks;
+};
+
+template <class DataPoint, class NodeType>
+template <typename VectorUserContainer>
+IcpResult<typename DataPoint::Scalar> IcpRegistration<DataPoint, NodeType>::align(
+    const VectorUserContainer& source, const Transform& initial, const IcpParameters<Scalar>& parameters)
+{
+    PONCA_TRACE_ZONE("ponca::IcpRegistration::align");
+    if (parameters.metric == ICP_POINT_TO_PLANE && !has_normals())
+        throw std::invalid_argument("IcpRegistration: the point-to-plane metric requires the target normals");
+    if (m_target->index_count() == 0)
+        throw std::invalid_argument("Empty KdTree");
+
+    IcpResult<Scalar> result;
+    result.transform = initial;
+
+    // the source moves little from one iteration to the next: its leaf order is computed once
+    {
+        const int count = int(source.size());
+        std::vector<VectorType, Eigen::aligned_allocator<VectorType>> moved(count);
+#pragma omp parallel for
+        for (int i = 0; i < count; ++i)
+            moved[i] = initial * VectorType(source[i]);
+        m_order = m_target->leaf_order(moved);
+    }
+
+    for (result.iterations = 0; result.iterations < parameters.max_iterations;)
+    {
+        const Accumulator sums = accumulate(source, result.transform, parameters);
+        const Scalar rms = sums.count > 0 ? std::sqrt(sums.squared_residuals / Scalar(sums.count)) : Scalar(0);
+        if (result.iterations > 0 && result.rms - rms <= parameters.convergence * result.rms)
+            result.converged = true;
+        ++result.iterations;
+        result.correspondences = sums.count;
+        result.rms = rms;
+        if (result.converged)
+            break;
+
+        result.transform = solve(sums, parameters.metric) * result.transform;
+    }
+    return result;
+}
+
+template <class DataPoint, class NodeType>
+template <typename VectorUserContainer>
+typename IcpRegistration<DataPoint, NodeType>::Accumulator IcpRegistration<DataPoint, NodeType>::accumulate(
+    const VectorUserContainer& source, const Transform& transform, const IcpParameters<Scalar>& parameters)
+{
+    PONCA_TRACE_ZONE("ponca::IcpRegistration::accumulate");
+    const int count = int(m_order.size());
+    const int blockCount = (count + BlockSize - 1) / BlockSize;
+    const Scalar maxSquaredDistance = parameters.max_distance < std::sqrt(std::numeric_limits<Scalar>::max())
+                                          ? parameters.max_distance * parameters.max_distance
+                                          : std::numeric_limits<Scalar>::max();
+    const bool toPlane = parameters.metric == ICP_POINT_TO_PLANE;
+    m_blocks.assign(blockCount, Accumulator());
+
+#pragma omp parallel
+    {
+        KdTreeNearestPointQuery<DataPoint, NodeType> query(m_target, VectorType::Zero());
+        query.set_warm_start(true);
+#pragma omp for schedule(static)
+        for (int b = 0; b < blockCount; ++b)
+        {
+            Accumulator& sums = m_blocks[b];
+            const int end = std::min(count, (b + 1) * BlockSize);
+            for (int n = b * BlockSize; n < end; ++n)
+            {
+                const VectorType p = transform * VectorType(source[m_order[n]]);
+                const int j = *query(p).begin();
+                const VectorType& q = m_target->point(j).pos();
+                const Scalar squaredDistance = (p - q).squaredNorm();
+                if (squaredDistance > maxSquaredDistance)
+                    continue;
+
+                ++sums.count;
+                if (toPlane)
+                {
+                    // residual r = (p - q).n, linearized in the rotation w and translation t as
+                    // r + (p x n).w + n.t
+                    const VectorType& normal = m_normals[j];
+                    const Scalar residual = (p - q).dot(normal);
+                    Vector6 jacobian;
+                    jacobian << p.cross(normal), normal;
+                    sums.jtj.template selfadjointView<Eigen::Lower>().rankUpdate(jacobian);
+                    sums.jtr += jacobian * residual;
+                    sums.squared_residuals += residual * residual;
+                }
+                else
+                {
+                    sums.cross += p * q.transpose();
+                    sums.source_sum += p;
+                    sums.target_sum += q;
+                    sums.squared_residuals += squaredDistance;
+                }
+            }
+        }
+    }
+
+    Accumulator total;
+    for (const Accumulator& sums : m_blocks)
+        total += sums;
+    return total;
+}
+
+template <class DataPoint, class NodeType>
+typename IcpRegistration<DataPoint, NodeType>::Transform IcpRegistration<DataPoint, NodeType>::solve(
+    const Accumulator& sums, ICP_METRIC metric)
+{
+    Transform increment = Transform::Identity();
+    if (metric == ICP_POINT_TO_PLANE)
+    {
+        if (sums.count < 6)
+            return increment;
+        const Eigen::LDLT<Matrix6> ldlt(sums.jtj.template selfadjointView<Eigen::Lower>());
+        if (ldlt.info() != Eigen::Success || !ldlt.isPositive())
+            return increment;
+        const Vector6 x = ldlt.solve(-sums.jtr);
+        if (!x.allFinite())
+            return increment;
+
+        const VectorType w = x.template head<3>();
+        const Scalar angle = w.norm();
+        if (angle > Scalar(0))
+            increment.linear() = Eigen::AngleAxis<Scalar>(angle, w / angle).toRotationMatrix();
+        increment.translation() = x.template tail<3>();
+    }
+    else
+    {
+        if (sums.count < 3)
+            return increment;
+        const Scalar n = Scalar(sums.count);
+        const VectorType sourceMean = sums.source_sum / n;
+        const VectorType targetMean = sums.target_sum / n;
+        const Matrix3 covariance = sums.cross / n - sourceMean * targetMean.transpose();
+
+        // Kabsch: rotation maximizing trace(R covariance), without reflection
+        const Eigen::JacobiSVD<Matrix3> svd(covariance, Eigen::ComputeFullU | Eigen::ComputeFullV);
+        Matrix3 correction = Matrix3::Identity();
+        correction(2, 2) = (svd.matrixV() * svd.matrixU().transpose()).determinant() < 0 ? Scalar(-1) : Scalar(1);
+        increment.linear() = svd.matrixV() * correction * svd.matrixU().transpose();
+        increment.translation() = targetMean - increment.linear() * sourceMean;
+    }
+    return increment;
+}
+
+} // namespace Ponca
@@ -0,0 +1,337 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./kdTree.h"
+#include "../morton.h"
+#include "../../Common/Tracing.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace Ponca {
+
+/// \brief Point of each cell selected by voxel_grid_sampling
+/// \ingroup spatialpartitioning
+enum VOXEL_SAMPLING_POINT : unsigned char
+{
+    /*! \brief Point of the cell closest to the centroid of its points (default) */
+    VOXEL_NEAREST_CENTROID = 0,
+    /*! \brief Point of the cell closest to its center */
+    VOXEL_NEAREST_CENTER = 1
+};
+
+namespace internal {
+
+/// \brief Points indexed by a KdTree, grouped by the cells of a uniform grid sorted along the Morton curve
+template <class DataPoint>
+struct SamplingCells
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using Coord      = std::array<std::uint32_t, DataPoint::Dim>;
+
+    std::vector<int> points; ///< Indices of the points, sorted by cell
+    std::vector<int> start;  ///< The points of the cell `c` are `points[start[c], start[c+1])`
+    std::vector<Coord> coords; ///< Coordinates of the cells in the grid
+    VectorType origin;       ///< Lowest corner of the grid
+    Scalar cell_size {0};
+
+    inline int cell_count() const { return static_cast<int>(coords.size()); }
+
+    /// \brief Group the points indexed by `tree` by cells of size `size`
+    /// \throw std::length_error when the grid holds more cells per axis than the Morton codes
+    template <class NodeType>
+    inline void build(const KdTree<DataPoint, NodeType>& tree, Scalar size)
+    {
+        using Code = std::uint64_t;
+        constexpr int Dim = DataPoint::Dim;
+        constexpr int Bits = MortonTraits<Code, Dim>::BitsPerAxis;
+
+        const int count = tree.index_count();
+        points.assign(tree.index_buffer(), tree.index_buffer() + count);
+        start.assign(1, 0);
+        coords.clear();
+        cell_size = size;
+        if(count == 0)
+            return;
+
+        Eigen::AlignedBox<Scalar, Dim> aabb;
+        for(int i : points)
+            aabb.extend(tree.point(i).pos());
+        origin = aabb.min();
+        const VectorType extent = (aabb.max() - aabb.min()) / cell_size;
+        if(!(extent.maxCoeff() < Scalar(Code(1) << Bits) - 1))
+            throw std::length_error("Sampling: too many cells for the grid, increase the cell size or radius");
+
+        std::vector<Code> codes(count);
+#pragma omp parallel for
+        for(int n = 0; n < count; ++n)
+        {
+            using std::floor;
+            const VectorType cell = (tree.point(points[n]).pos() - origin) / cell_size;
+            std::uint32_t c[Dim];
+            for(int d = 0; d < Dim; ++d)
+                c[d] = std::uint32_t(std::max(floor(cell(d)), Scalar(0)));
+            codes[n] = morton_encode<Code, Dim>(c);
+        }
+        // stable: the points of a cell keep the leaf order of the tree
+        morton_sort(codes.data(), points.data(), count);
+
+        for(int n = 0; n < count; ++n)
+        {
+            if(n > 0 && codes[n] == codes[n - 1])
+                continue;
+            if(n > 0)
+                start.push_back(n);
+            Coord coord;
+            morton_decode<Code, Dim>(codes[n], coord.data());
+            coords.push_back(coord);
+        }
+        start.push_back(count);
+    }
+};
+
+/// \brief Variable radius Poisson disk sampling, the point `i` covering the points within `radius_of(i)`
+///
+/// The grid cells have the size of the largest radius, and are processed by \f$ 3^{Dim} \f$ colors: two cells
+/// of the same color are separated by two other cells at least, farther than any radius, which lets the cells
+/// of a color be processed in parallel. The result does not depend on the number of threads.
+template <class DataPoint, class NodeType, typename RadiusFunctor>
+inline void poisson_disk_sampling(const KdTree<DataPoint, NodeType>& tree, RadiusFunctor radius_of,
+                                  typename DataPoint::Scalar max_radius, std::vector<int>& sampling)
+{
+    using Scalar = typename DataPoint::Scalar;
+    constexpr int Dim = DataPoint::Dim;
+
+    sampling.clear();
+    if(tree.index_count() == 0)
+        return;
+    if(!(max_radius > Scalar(0)))
+    {
+        sampling.assign(tree.index_buffer(), tree.index_buffer() + tree.index_count());
+        std::sort(sampling.begin(), sampling.end());
+        return;
+    }
+
+    SamplingCells<DataPoint> cells;
+    cells.build(tree, max_radius);
+
+    int color_count = 1;
+    for(int d = 0; d < Dim; ++d)
+        color_count *= 3;
+    std::vector<std::vector<int>> colors(color_count);
+    for(int c = 0; c < cells.cell_count(); ++c)
+    {
+        int color = 0;
+        for(int d = Dim - 1; d >= 0; --d)
+            color = 3 * color + int(cells.coords[c][d] % 3);
+        colors[color].push_back(c);
+    }
+
+    std::vector<std::atomic<char>> covered(tree.point_count());
+    std::vector<char> kept(tree.point_count(), 0);
+    for(const std::vector<int>& color : colors)
+    {
+        const int cell_count = static_cast<int>(color.size());
+#pragma omp parallel
+        {
+            auto query = tree.range_neighbors(tree.point(tree.index_buffer()[0]).pos(), max_radius);
+#pragma omp for schedule(dynamic, 16)
+            for(int n = 0; n < cell_count; ++n)
+            {
+                const int c = color[n];
+                for(int s = cells.start[c]; s < cells.start[c + 1]; ++s)
+                {
+                    const int i = cells.points[s];
+                    if(covered[i].load(std::memory_order_relaxed))
+                        continue;
+                    kept[i] = 1;
+                    covered[i].store(1, std::memory_order_relaxed);
+                    for(int j : query(tree.point(i).pos(), Scalar(radius_of(i))))
+                        covered[j].store(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    for(int i = 0; i < tree.point_count(); ++i)
+    {
+        if(kept[i])
+            sampling.push_back(i);
+    }
+}
+
+} // namespace internal
+
+/*!
+    \brief Voxel grid downsampling: select one point in each cell of size `cell_size` containing points indexed by
+    `tree`
+
+    The points are grouped by cells in parallel, with a radix sort of the Morton codes of their cells, and the
+    point of each cell closest to the centroid or the center of the cell is selected, see VOXEL_SAMPLING_POINT.
+    The selected indices are written to `sampling` in the Morton order of the cells, to be given to
+    `KdTree::build(points, sampling)` or `KdTree::rebuild(sampling)`: the fits over the sampled tree scale with
+    the number of cells rather than the number of points. When `centroids` is not null, the centroid of each
+    cell is written to it, in the same order as `sampling`.
+
+    \code
+    std::vector<int> sampling;
+    voxel_grid_sampling(tree, Scalar(0.01), sampling);
+    tree.rebuild(sampling);
+    \endcode
+
+    \throw std::length_error when the grid holds more than \f$ 2^{21} \f$ cells per axis in 3D
+    \ingroup spatialpartitioning
+*/
+template <class DataPoint, class NodeType>
+inline void voxel_grid_sampling(const KdTree<DataPoint, NodeType>& tree, typename DataPoint::Scalar cell_size,
+                                std::vector<int>& sampling, VOXEL_SAMPLING_POINT selection = VOXEL_NEAREST_CENTROID,
+                                std::vector<typename DataPoint::VectorType>* centroids = nullptr)
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    PONCA_TRACE_ZONE("ponca::voxel_grid_sampling");
+
+    internal::SamplingCells<DataPoint> cells;
+    cells.build(tree, cell_size);
+    const int cell_count = cells.cell_count();
+    sampling.resize(cell_count);
+    if(centroids != nullptr)
+        centroids->resize(cell_count);
+
+#pragma omp parallel for schedule(dynamic, 64)
+    for(int c = 0; c < cell_count; ++c)
+    {
+        const int begin = cells.start[c], end = cells.start[c + 1];
+        VectorType centroid = VectorType::Zero();
+        for(int s = begin; s < end; ++s)
+            centroid += tree.point(cells.points[s]).pos();
+        centroid /= Scalar(end - begin);
+        if(centroids != nullptr)
+            (*centroids)[c] = centroid;
+
+        VectorType target = centroid;
+        if(selection == VOXEL_NEAREST_CENTER)
+        {
+            for(int d = 0; d < DataPoint::Dim; ++d)
+                target(d) = cells.origin(d) + (Scalar(cells.coords[c][d]) + Scalar(0.5)) * cell_size;
+        }
+
+        int best = cells.points[begin];
+        Scalar best_distance = std::numeric_limits<Scalar>::max();
+        for(int s = begin; s < end; ++s)
+        {
+            const int i = cells.points[s];
+            const Scalar distance = (tree.point(i).pos() - target).squaredNorm();
+            if(distance < best_distance || (distance == best_distance && i < best))
+            {
+                best = i;
+                best_distance = distance;
+            }
+        }
+        sampling[c] = best;
+    }
+}
+
+/*!
+    \brief Poisson disk downsampling: select points indexed by `tree` such that no two selected points are closer
+    than `radius`, and every point is within `radius` of a selected one
+
+    The points are visited cell by cell, each selected point covering its neighbors returned by the range query
+    of the tree. The cells are processed in parallel, by groups of cells far enough apart not to interact: the
+    result does not depend on the number of threads. The selected indices are written to `sampling` by
+    increasing index.
+
+    \code
+    std::vector<int> sampling;
+    poisson_disk_sampling(tree, Scalar(0.01), sampling);
+    KdTree<Point> sampled(points, sampling);
+    \endcode
+
+    \throw std::length_error when the grid of cells of size `radius` holds more than \f$ 2^{21} \f$ cells per axis
+    in 3D
+    \ingroup spatialpartitioning
+*/
+template <class DataPoint, class NodeType>
+inline void poisson_disk_sampling(const KdTree<DataPoint, NodeType>& tree, typename DataPoint::Scalar radius,
+                                  std::vector<int>& sampling)
+{
+    PONCA_TRACE_ZONE("ponca::poisson_disk_sampling");
+    internal::poisson_disk_sampling(tree, [radius](int) { return radius; }, radius, sampling);
+}
+
+/*!
+    \brief Same as poisson_disk_sampling, the point `i` covering its neighbors within its own radius `radii[i]`
+
+    \param radii Random access container of the `tree.point_count()` radii
+    \see curvature_adaptive_sampling
+    \ingroup spatialpartitioning
+*/
+template <class DataPoint, class NodeType, typename RadiusContainer>
+inline void adaptive_poisson_disk_sampling(const KdTree<DataPoint, NodeType>& tree, const RadiusContainer& radii,
+                                           std::vector<int>& sampling)
+{
+    using Scalar = typename DataPoint::Scalar;
+    PONCA_TRACE_ZONE("ponca::adaptive_poisson_disk_sampling");
+
+    Scalar max_radius = 0;
+    for(int n = 0; n < tree.index_count(); ++n)
+        max_radius = std::max(max_radius, Scalar(radii[tree.index_buffer()[n]]));
+    internal::poisson_disk_sampling(tree, [&radii](int i) { return radii[i]; }, max_radius, sampling);
+}
+
+/*!
+    \brief Curvature-adaptive downsampling: Poisson disk sampling whose radius decreases with the curvature
+
+    The radius of the point `i` is the length of the chord of a circle of curvature `curvatures[i]` deviating by
+    `tolerance` from the circle, \f$ \sqrt{8 \, tolerance / |\kappa_i|} \f$, clamped to
+    `[min_radius, max_radius]`: the flat regions are sampled at `max_radius`, and the curved ones more densely.
+    The non-finite curvatures, e.g. of the unstable fits, use `max_radius`.
+
+    \code
+    // kappa of each point, e.g. from GLSParam::kappa()
+    std::vector<Scalar> kappa(points.size(), Scalar(0));
+    computeAll<Fit>(tree, scale, [&](int i, const Fit& fit, FIT_RESULT res) {
+        if(res == STABLE) kappa[i] = fit.kappa();
+    });
+    std::vector<int> sampling;
+    curvature_adaptive_sampling(tree, kappa, Scalar(1e-3), Scalar(0.002), Scalar(0.05), sampling);
+    \endcode
+
+    \param curvatures Random access container of the `tree.point_count()` curvatures
+    \param tolerance Largest distance between the surface and the chords between the sampled points
+    \ingroup spatialpartitioning
+*/
+template <class DataPoint, class NodeType, typename CurvatureContainer>
+inline void curvature_adaptive_sampling(const KdTree<DataPoint, NodeType>& tree, const CurvatureContainer& curvatures,
+                                        typename DataPoint::Scalar tolerance, typename DataPoint::Scalar min_radius,
+                                        typename DataPoint::Scalar max_radius, std::vector<int>& sampling)
+{
+    using Scalar = typename DataPoint::Scalar;
+    PONCA_TRACE_ZONE("ponca::curvature_adaptive_sampling");
+
+    const int count = tree.point_count();
+    std::vector<Scalar> radii(count, max_radius);
+#pragma omp parallel for
+    for(int i = 0; i < count; ++i)
+    {
+        using std::abs; using std::sqrt;
+        const Scalar kappa = abs(Scalar(curvatures[i]));
+        if(std::isfinite(kappa) && kappa > Scalar(0))
+            radii[i] = std::min(std::max(Scalar(sqrt(Scalar(8) * tolerance / kappa)), min_radius), max_radius);
+    }
+    adaptive_poisson_disk_sampling(tree, radii, sampling);
+}
+
+} // namespace Ponca
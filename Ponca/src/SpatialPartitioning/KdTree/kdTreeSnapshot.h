@@ -0,0 +1,198 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./kdTree.h"
+#include "../../Common/Tracing.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace Ponca {
+
+/*!
+    \brief Immutable KdTree snapshots, rebuilt in the background and published atomically to concurrent readers
+
+    A KdTree is modified in place by build() and rebuild(), so that queries cannot run during a rebuild. This class
+    holds instead the current tree as a `std::shared_ptr<const KdTree>`:
+     - readers call snapshot() once per batch of queries and keep the returned pointer while querying: the tree
+       cannot change under them, and it is released when the last reader holding it is done,
+     - writers build a new tree, synchronously with build() or on a background thread with build_async(), then
+       publish it with a single atomic store. Readers never wait for a build.
+
+    Each build or publish takes a version number when it starts. A snapshot is only published if it is newer than
+    the current one: when two builds overlap, the one started last wins, whichever finishes first.
+
+    A snapshot may also be a tree saved with KdTree::save(out, true) and read in place from a shared memory
+    buffer, e.g. a mapped file written by another process, with publish_view(): the snapshot keeps the buffer
+    alive.
+
+    \code
+    KdTreeSnapshots<Point> trees([](KdTree<Point>& tree) { tree.set_split_strategy(SPLIT_MORTON); });
+    trees.build(points);
+
+    // reader threads
+    auto tree = trees.snapshot();
+    for (int j : tree->k_nearest_neighbors(position, 8)) { ... }
+
+    // writer thread, the readers keep using the previous snapshot until the new one is published
+    auto done = trees.build_async(std::move(updated_points));
+    \endcode
+
+    \warning The object must outlive the builds it started: its destructor waits for them.
+    \ingroup spatialpartitioning
+*/
+template <class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+class KdTreeSnapshots
+{
+public:
+    using TreeType  = KdTree<DataPoint, NodeType>;
+    using Snapshot  = std::shared_ptr<const TreeType>;
+    /// \brief Functor setting the options of the new trees (split strategy, leaf positions...) before they are built
+    using Configure = std::function<void(TreeType&)>;
+
+    inline KdTreeSnapshots() = default;
+    inline explicit KdTreeSnapshots(Configure configure) : m_configure(std::move(configure)) { }
+
+    KdTreeSnapshots(const KdTreeSnapshots&) = delete;
+    KdTreeSnapshots& operator=(const KdTreeSnapshots&) = delete;
+
+    /// \brief Wait for the builds started by build_async()
+    inline ~KdTreeSnapshots()
+    {
+        std::unique_lock<std::mutex> lock(m_pending_mutex);
+        m_pending_done.wait(lock, [this]() { return m_pending == 0; });
+    }
+
+    /// \brief Current tree, or null before the first publication. Lock-free for the readers in practice, the
+    /// returned tree never changes
+    inline Snapshot snapshot() const { return std::atomic_load(&m_current); }
+
+    /// \brief Version of the current tree: 0 before the first publication, then increasing
+    inline std::uint64_t version() const { return m_version.load(); }
+
+    /// \brief Publish `tree`, built by the caller
+    /// \return true when published, false when a newer tree was published meanwhile
+    inline bool publish(Snapshot tree) { return publish(std::move(tree), m_started.fetch_add(1) + 1); }
+
+    /// \brief Build a tree over a copy of `points` and publish it
+    /// \return true when published, false when a newer tree was published during the build
+    template <typename PointUserContainer>
+    inline bool build(const PointUserContainer& points)
+    {
+        const std::uint64_t version = m_started.fetch_add(1) + 1;
+        return publish(make_tree([&](TreeType& tree) { tree.build(points); }), version);
+    }
+
+    /// \brief Build a tree over a copy of the points of `points` selected by `sampling` and publish it
+    template <typename PointUserContainer, typename IndexUserContainer>
+    inline bool build(const PointUserContainer& points, const IndexUserContainer& sampling)
+    {
+        const std::uint64_t version = m_started.fetch_add(1) + 1;
+        return publish(make_tree([&](TreeType& tree) { tree.build(points, sampling); }), version);
+    }
+
+    /// \brief Build a tree over `points` on a new thread and publish it
+    ///
+    /// The points are moved to the thread, and the readers keep using the current snapshot during the build.
+    /// \return A future holding the result of build(). As with any `std::async` future, its destructor waits for
+    /// the build.
+    template <typename PointUserContainer>
+    inline std::future<bool> build_async(PointUserContainer points)
+    {
+        const std::uint64_t version = m_started.fetch_add(1) + 1;
+        {
+            std::lock_guard<std::mutex> lock(m_pending_mutex);
+            ++m_pending;
+        }
+        return std::async(std::launch::async, [this, version, points = std::move(points)]() {
+            bool published = false;
+            try
+            {
+                published = publish(make_tree([&](TreeType& tree) { tree.build(points); }), version);
+            }
+            catch (...)
+            {
+                end_pending();
+                throw;
+            }
+            end_pending();
+            return published;
+        });
+    }
+
+    /// \brief Publish the tree saved with its points by KdTree::save(out, true) in `data`, without copying it
+    ///
+    /// `data` must be aligned on KdTreeFileHeader::Alignment bytes, and not be modified while the snapshot is
+    /// used. The snapshot shares its ownership: the buffer is released with the last reader of the tree.
+    /// \throw std::invalid_argument when `data` is not a valid tree file storing its points
+    inline bool publish_view(std::shared_ptr<const void> data, std::size_t size)
+    {
+        const std::uint64_t version = m_started.fetch_add(1) + 1;
+        auto view = std::make_shared<MappedTree>();
+        view->data = std::move(data);
+        if (!view->tree.load_view(view->data.get(), size) || view->tree.point_count() == 0)
+            throw std::invalid_argument("KdTreeSnapshots: invalid tree file, the points must be stored");
+        // aliasing constructor: the tree shares the ownership of the buffer
+        return publish(Snapshot(view, &view->tree), version);
+    }
+
+protected:
+    /// \brief Tree read from a buffer, kept alive with it
+    struct MappedTree
+    {
+        std::shared_ptr<const void> data;
+        TreeType tree;
+    };
+
+    template <typename BuildFunctor>
+    inline Snapshot make_tree(BuildFunctor build) const
+    {
+        PONCA_TRACE_ZONE("ponca::KdTreeSnapshots::build");
+        auto tree = std::make_shared<TreeType>();
+        if (m_configure)
+            m_configure(*tree);
+        build(*tree);
+        return tree;
+    }
+
+    inline bool publish(Snapshot tree, std::uint64_t version)
+    {
+        // the writers are serialized, the readers load m_current without taking the lock
+        std::lock_guard<std::mutex> lock(m_publish_mutex);
+        if (version <= m_version.load())
+            return false;
+        std::atomic_store(&m_current, std::move(tree));
+        m_version.store(version);
+        return true;
+    }
+
+    inline void end_pending()
+    {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        if (--m_pending == 0)
+            m_pending_done.notify_all();
+    }
+
+    Configure m_configure;
+    Snapshot m_current;
+    std::atomic<std::uint64_t> m_started {0}; // versions given to the builds
+    std::atomic<std::uint64_t> m_version {0}; // version of m_current
+    std::mutex m_publish_mutex;
+    std::mutex m_pending_mutex;
+    std::condition_variable m_pending_done;
+    int m_pending {0};
+};
+
+} // namespace Ponca
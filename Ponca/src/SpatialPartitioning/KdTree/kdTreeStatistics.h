@@ -0,0 +1,135 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Ponca {
+
+/// \brief Statistics on the structure of a KdTree, used to tune its parameters
+/// \see KdTree::statistics
+/// \ingroup spatialpartitioning
+struct KdTreeStatistics
+{
+    int node_count       {0};
+    int leaf_count       {0};
+    int empty_leaf_count {0};
+    int duplicate_leaf_count {0};  ///< Number of leaves whose points share the same position
+    int max_depth        {0};  ///< Depth of the deepest leaf, the root having depth 0
+    int min_leaf_size    {0};
+    int max_leaf_size    {0};
+    double mean_leaf_size {0};
+
+    /// Number of leaves at each depth
+    std::vector<int> depth_histogram;
+    /// Number of leaves of each size class: empty leaves in class 0, sizes in \f$ [2^{c-1}, 2^c) \f$ in class c
+    std::vector<int> leaf_size_histogram;
+
+    std::size_t node_memory          {0};  ///< Bytes used by the nodes and their bounds
+    std::size_t index_memory         {0};  ///< Bytes used by the indices
+    std::size_t point_memory         {0};  ///< Bytes used by the points owned by the tree
+    std::size_t leaf_position_memory {0};  ///< Bytes used by the leaf ordered and quantized positions
+
+    int query_count          {0};  ///< Number of k-nearest neighbors queries used to measure leaf visits
+    double mean_leaf_visits  {0};  ///< Mean number of leaves scanned by these queries
+
+    /// \brief Size class of a leaf of `size` indices in leaf_size_histogram
+    static inline int size_class(int size)
+    {
+        int c = 0;
+        for(; size > 0; size >>= 1)
+            ++c;
+        return c;
+    }
+
+    inline std::size_t memory() const
+    {
+        return node_memory + index_memory + point_memory + leaf_position_memory;
+    }
+
+    /// \brief Human readable report
+    inline std::string to_string() const
+    {
+        std::stringstream str;
+        str << "nodes: " << node_count << " (" << leaf_count << " leaves, " << empty_leaf_count << " empty, "
+            << duplicate_leaf_count << " duplicates)\n";
+        str << "leaf size: min=" << min_leaf_size << " max=" << max_leaf_size << " mean=" << mean_leaf_size << "\n";
+        str << "leaf depth (max=" << max_depth << "):\n";
+        for(int d = 0; d < int(depth_histogram.size()); ++d)
+        {
+            if(depth_histogram[d] != 0)
+                str << "  " << d << ": " << depth_histogram[d] << "\n";
+        }
+        str << "leaf sizes:\n";
+        for(int c = 0; c < int(leaf_size_histogram.size()); ++c)
+        {
+            if(leaf_size_histogram[c] == 0)
+                continue;
+            if(c == 0)
+                str << "  0: ";
+            else
+                str << "  [" << (1 << (c-1)) << "," << (1 << c) << "): ";
+            str << leaf_size_histogram[c] << "\n";
+        }
+        str << "memory: " << memory() << " bytes (nodes=" << node_memory << " indices=" << index_memory
+            << " points=" << point_memory << " leaf positions=" << leaf_position_memory << ")\n";
+        if(query_count > 0)
+            str << "leaf visits per query: " << mean_leaf_visits << " (" << query_count << " queries)\n";
+        return str.str();
+    }
+};
+
+/// \brief Bytes allocated by a KdTree, by component
+///
+/// The containers are counted by their capacity, i.e. the memory actually allocated. The buffers given to
+/// build_view() and load_view() are not owned by the tree: they are counted apart, in `viewed`.
+/// \see KdTree::memory_usage
+/// \ingroup spatialpartitioning
+struct KdTreeMemoryUsage
+{
+    std::size_t object              {0};  ///< Size of the KdTree object itself
+    std::size_t points              {0};  ///< Points owned by the tree
+    std::size_t nodes               {0};  ///< Nodes
+    std::size_t node_bounds         {0};  ///< Bounding boxes of the nodes
+    std::size_t indices             {0};  ///< Indices of the points, in leaf order
+    std::size_t leaf_positions      {0};  ///< Leaf ordered copy of the positions
+    std::size_t quantized_positions {0};  ///< 16-bit leaf positions, with the origins and steps of their blocks
+    std::size_t build               {0};  ///< Build buffers kept for the next builds (Morton codes), see KdTree::shrink_to_fit
+    std::size_t viewed              {0};  ///< Bytes of the user or mapped buffers read by the tree, not owned
+
+    /// \brief Acceleration data: copies of the positions made for the leaf scans
+    inline std::size_t acceleration() const { return leaf_positions + quantized_positions; }
+
+    /// \brief Bytes owned by the tree
+    inline std::size_t total() const
+    {
+        return object + points + nodes + node_bounds + indices + acceleration() + build;
+    }
+
+    /// \brief Human readable report
+    inline std::string to_string() const
+    {
+        std::stringstream str;
+        str << "total: " << total() << " bytes\n";
+        str << "  points: " << points << "\n";
+        str << "  nodes: " << nodes << " (bounds: " << node_bounds << ")\n";
+        str << "  indices: " << indices << "\n";
+        str << "  leaf positions: " << leaf_positions << "\n";
+        str << "  quantized positions: " << quantized_positions << "\n";
+        if(build > 0)
+            str << "  build buffers: " << build << "\n";
+        str << "  object: " << object << "\n";
+        if(viewed > 0)
+            str << "viewed, not owned: " << viewed << " bytes\n";
+        return str.str();
+    }
+};
+
+} // namespace Ponca
@@ -0,0 +1,147 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./kdTree.h"
+
+#include <array>
+#include <cmath>
+#include <map>
+#include <random>
+
+namespace Ponca {
+
+/// \brief Nested subsamples of a point cloud, each one indexed by its own KdTree
+///
+/// The levels are the prefixes of a single permutation of the points: level 0 is the coarsest subsample, and each
+/// level contains the points of the coarser ones. The points are stored once, the tree of each level being a
+/// KdTree::build_view() over them, so that a level costs only its nodes and indices.
+///
+/// The queries take the level as last argument and only visit the points of that level, e.g. to preview a
+/// multi-scale computation on a coarse level before running it on the whole cloud.
+/// \warning The trees point to point_data(): the structure can be moved, but not copied.
+/// \ingroup spatialpartitioning
+template<class DataPoint, class NodeType = KdTreeDefaultNode<DataPoint>>
+class ProgressiveKdTree
+{
+public:
+    typedef typename DataPoint::Scalar     Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    typedef KdTree<DataPoint, NodeType>        TreeType;
+    typedef typename TreeType::PointContainer  PointContainer;
+    typedef typename TreeType::IndexContainer  IndexContainer;
+
+    inline ProgressiveKdTree() = default;
+    ProgressiveKdTree(const ProgressiveKdTree&) = delete;
+    ProgressiveKdTree& operator=(const ProgressiveKdTree&) = delete;
+    inline ProgressiveKdTree(ProgressiveKdTree&&) = default;
+    inline ProgressiveKdTree& operator=(ProgressiveKdTree&&) = default;
+
+    template<typename PointUserContainer>
+    inline ProgressiveKdTree(const PointUserContainer& points, int level_count, Scalar ratio = Scalar(4))
+    {
+        this->build(points, level_count, ratio);
+    }
+
+    inline void clear();
+
+    /// \brief Build `level_count` levels by random prefix sampling: each level is `ratio` times smaller than the
+    /// next one, the finest level containing all the points
+    template<typename PointUserContainer>
+    inline void build(const PointUserContainer& points, int level_count, Scalar ratio = Scalar(4),
+                      unsigned int seed = 0);
+
+    /// \brief Build the levels from a permutation of the points: the level `l` contains the points
+    /// `order[0, level_sizes[l])`
+    ///
+    /// `level_sizes` must be increasing. The points missing from the finest level are ignored by all the queries.
+    /// \see poisson_disk_levels
+    template<typename PointUserContainer, typename IndexUserContainer>
+    inline void build(const PointUserContainer& points, const IndexUserContainer& order,
+                      const std::vector<int>& level_sizes);
+
+    /// \brief Compute nested Poisson-disk subsamples of `points`, for the build() from a permutation
+    ///
+    /// The level `l` is built by adding, in a random order, the points farther than `radii[l]` from all the points
+    /// already selected, as long as the radii decrease. A null last radius adds all the remaining points.
+    /// \param order Receives the permutation of the selected points
+    /// \param level_sizes Receives the number of points of each level
+    template<typename PointUserContainer>
+    inline static void poisson_disk_levels(const PointUserContainer& points, const std::vector<Scalar>& radii,
+                                           IndexContainer& order, std::vector<int>& level_sizes,
+                                           unsigned int seed = 0);
+
+    // Accessors ---------------------------------------------------------------
+public:
+    inline int level_count() const { return static_cast<int>(m_levels.size()); }
+    /// \brief Number of points of the level `level`
+    inline int level_size(int level) const { return m_levels[level].index_count(); }
+    /// \brief Tree of the level `level`
+    inline const TreeType& level(int level) const { return m_levels[level]; }
+    /// \brief Coarsest level containing the point `index`, or -1 when the point is in no level
+    inline int point_level(int index) const { return m_point_levels[index]; }
+
+    inline int point_count() const { return static_cast<int>(m_points.size()); }
+    inline const DataPoint& point(int i) const { return m_points[i]; }
+    inline const PointContainer& point_data() const { return m_points; }
+    /// \brief Permutation of the points whose prefixes are the levels
+    inline const IndexContainer& order() const { return m_order; }
+
+    // Parameters --------------------------------------------------------------
+public:
+    inline int min_cell_size() const { return m_min_cell_size; }
+    /// \brief Minimal number of points of the leaves of the trees, used by the next build
+    inline void set_min_cell_size(int min_cell_size) { m_min_cell_size = min_cell_size; }
+
+    // Query -------------------------------------------------------------------
+public :
+    KdTreeKNearestPointQuery<DataPoint, NodeType> k_nearest_neighbors(const VectorType& point, int k, int level) const
+    {
+        return m_levels[level].k_nearest_neighbors(point, k);
+    }
+
+    KdTreeKNearestIndexQuery<DataPoint, NodeType> k_nearest_neighbors(int index, int k, int level) const
+    {
+        return m_levels[level].k_nearest_neighbors(index, k);
+    }
+
+    KdTreeNearestPointQuery<DataPoint, NodeType> nearest_neighbor(const VectorType& point, int level) const
+    {
+        return m_levels[level].nearest_neighbor(point);
+    }
+
+    KdTreeNearestIndexQuery<DataPoint, NodeType> nearest_neighbor(int index, int level) const
+    {
+        return m_levels[level].nearest_neighbor(index);
+    }
+
+    KdTreeRangePointQuery<DataPoint, NodeType> range_neighbors(const VectorType& point, Scalar r, int level) const
+    {
+        return m_levels[level].range_neighbors(point, r);
+    }
+
+    KdTreeRangeIndexQuery<DataPoint, NodeType> range_neighbors(int index, Scalar r, int level) const
+    {
+        return m_levels[level].range_neighbors(index, r);
+    }
+
+    // Internal ----------------------------------------------------------------
+protected:
+    /// \brief Build the tree of each level over m_points, from m_order
+    inline void build_levels(const std::vector<int>& level_sizes);
+
+    PointContainer m_points;
+    IndexContainer m_order;
+    std::vector<int> m_point_levels;
+    std::vector<TreeType> m_levels;
+    int m_min_cell_size {64};
+};
+
+#include "./progressiveKdTree.hpp"
+
+} // namespace Ponca
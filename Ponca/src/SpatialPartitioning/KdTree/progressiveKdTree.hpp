@@ -0,0 +1,150 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+// ProgressiveKdTree -----------------------------------------------------------
+
+template<class DataPoint, class NodeType>
+void ProgressiveKdTree<DataPoint, NodeType>::clear()
+{
+	m_levels.clear();
+	m_points.clear();
+	m_order.clear();
+	m_point_levels.clear();
+}
+
+template<class DataPoint, class NodeType>
+template<typename PointUserContainer>
+void ProgressiveKdTree<DataPoint, NodeType>::build(const PointUserContainer& points, int level_count, Scalar ratio,
+                                                   unsigned int seed)
+{
+	PONCA_DEBUG_ASSERT(level_count > 0 && ratio >= Scalar(1));
+
+	const int count = static_cast<int>(points.size());
+	IndexContainer order(count);
+	std::iota(order.begin(), order.end(), 0);
+	std::shuffle(order.begin(), order.end(), std::mt19937(seed));
+
+	std::vector<int> level_sizes(level_count);
+	Scalar size = Scalar(count);
+	for(int l = level_count-1; l >= 0; --l, size /= ratio)
+	    level_sizes[l] = std::max(1, static_cast<int>(size));
+	if(count == 0)
+	    std::fill(level_sizes.begin(), level_sizes.end(), 0);
+
+	this->build(points, order, level_sizes);
+}
+
+template<class DataPoint, class NodeType>
+template<typename PointUserContainer, typename IndexUserContainer>
+void ProgressiveKdTree<DataPoint, NodeType>::build(const PointUserContainer& points, const IndexUserContainer& order,
+                                                   const std::vector<int>& level_sizes)
+{
+	this->clear();
+
+	m_points = PointContainer(points);
+	m_order  = IndexContainer(order);
+
+	this->build_levels(level_sizes);
+}
+
+template<class DataPoint, class NodeType>
+void ProgressiveKdTree<DataPoint, NodeType>::build_levels(const std::vector<int>& level_sizes)
+{
+	m_point_levels.assign(point_count(), -1);
+	m_levels.resize(level_sizes.size());
+
+	int first = 0;
+	for(int l = 0; l < level_count(); ++l)
+	{
+	    const int size = level_sizes[l];
+	    PONCA_DEBUG_ASSERT(size >= first && size <= static_cast<int>(m_order.size()));
+	    for(int i = first; i < size; ++i)
+	        m_point_levels[m_order[i]] = l;
+	    first = size;
+
+	    // the level is a prefix of the permutation, indexed over the shared points
+	    m_levels[l].set_min_cell_size(m_min_cell_size);
+	    m_levels[l].build_view(m_points.data(), point_count(),
+	                           IndexContainer(m_order.begin(), m_order.begin() + size));
+	}
+}
+
+template<class DataPoint, class NodeType>
+template<typename PointUserContainer>
+void ProgressiveKdTree<DataPoint, NodeType>::poisson_disk_levels(const PointUserContainer& points,
+                                                                 const std::vector<Scalar>& radii,
+                                                                 IndexContainer& order, std::vector<int>& level_sizes,
+                                                                 unsigned int seed)
+{
+	using Cell = std::array<int, DataPoint::Dim>;
+	const int count = static_cast<int>(points.size());
+
+	IndexContainer candidates(count);
+	std::iota(candidates.begin(), candidates.end(), 0);
+	std::shuffle(candidates.begin(), candidates.end(), std::mt19937(seed));
+
+	order.clear();
+	level_sizes.clear();
+	for(Scalar r : radii)
+	{
+	    IndexContainer rejected;
+	    if(r <= Scalar(0))
+	    {
+	        order.insert(order.end(), candidates.begin(), candidates.end());
+	    }
+	    else
+	    {
+	        // selected points hashed in cells of size r: the conflicts are in the neighboring cells
+	        const auto cell_of = [r](const VectorType& p)
+	        {
+	            Cell c;
+	            for(int d = 0; d < DataPoint::Dim; ++d)
+	                c[d] = static_cast<int>(std::floor(p(d) / r));
+	            return c;
+	        };
+	        std::map<Cell, std::vector<int>> grid;
+	        for(int idx : order)
+	            grid[cell_of(points[idx].pos())].push_back(idx);
+
+	        const Scalar squared_radius = r * r;
+	        int neighbors = 1;
+	        for(int d = 0; d < DataPoint::Dim; ++d)
+	            neighbors *= 3;
+	        for(int idx : candidates)
+	        {
+	            const VectorType& p = points[idx].pos();
+	            const Cell cell = cell_of(p);
+	            bool conflict = false;
+	            for(int n = 0; n < neighbors && !conflict; ++n)
+	            {
+	                // n enumerates the offsets {-1,0,1}^Dim in base 3
+	                Cell neighbor = cell;
+	                for(int d = 0, code = n; d < DataPoint::Dim; ++d, code /= 3)
+	                    neighbor[d] += code % 3 - 1;
+	                const auto it = grid.find(neighbor);
+	                if(it == grid.end()) continue;
+	                for(int other : it->second)
+	                {
+	                    if((points[other].pos() - p).squaredNorm() < squared_radius)
+	                    {
+	                        conflict = true;
+	                        break;
+	                    }
+	                }
+	            }
+	            if(conflict)
+	            {
+	                rejected.push_back(idx);
+	                continue;
+	            }
+	            order.push_back(idx);
+	            grid[cell].push_back(idx);
+	        }
+	    }
+	    level_sizes.push_back(static_cast<int>(order.size()));
+	    candidates.swap(rejected);
+	}
+}
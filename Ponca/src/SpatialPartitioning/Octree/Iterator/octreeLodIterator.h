@@ -0,0 +1,49 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+namespace Ponca {
+
+/// \brief Iterator over the nodes and points returned by OctreeLodQuery
+///
+/// `*it` is a node id when `it.is_node()`, a point index otherwise.
+/// \ingroup spatialpartitioning
+template<class DataPoint, class QueryT_>
+class OctreeLodIterator
+{
+protected:
+    friend QueryT_;
+
+public:
+    using Scalar    = typename DataPoint::Scalar;
+    using QueryType = QueryT_;
+
+    inline OctreeLodIterator() = default;
+    inline OctreeLodIterator(QueryType* query, int index = -1) :
+        m_query(query), m_index(index), m_start(0), m_end(0) {}
+
+    inline bool operator !=(const OctreeLodIterator<DataPoint,QueryType>& other) const
+    {return m_index != other.m_index || m_node != other.m_node;}
+    inline void operator ++(int) {m_query->advance(*this);}
+    inline OctreeLodIterator<DataPoint,QueryType>& operator++() {m_query->advance(*this); return *this;}
+    inline int operator *() const {return m_index;}
+
+    /// \brief Is the current item a node, whose points are all in the query ball
+    inline bool is_node() const {return m_node;}
+
+    /// \brief Squared distance between the query input and the current point, or the center of the current node
+    inline Scalar squared_distance() const {return m_squared_distance;}
+
+protected:
+    QueryType* m_query {nullptr};
+    int m_index {-1};
+    bool m_node {false};
+    int m_start {0};
+    int m_end {0};
+    Scalar m_squared_distance {0};
+};
+} // namespace ponca
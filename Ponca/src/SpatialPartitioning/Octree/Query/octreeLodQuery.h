@@ -0,0 +1,68 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../../query.h"
+#include "../Iterator/octreeLodIterator.h"
+
+#include <vector>
+
+namespace Ponca {
+template<class DataPoint, class Aggregate> class Octree;
+
+/// \brief Level of detail query of an Octree, see Octree::lod_neighbors
+/// \ingroup spatialpartitioning
+template <class DataPoint, class Aggregate>
+class OctreeLodQuery : public RangePointQuery<DataPoint>
+{
+    using Scalar          = typename DataPoint::Scalar;
+    using VectorType      = typename DataPoint::VectorType;
+    using QueryType       = RangePointQuery<DataPoint>;
+    using Iterator        = OctreeLodIterator<DataPoint, OctreeLodQuery>;
+
+protected:
+    friend Iterator;
+
+public:
+
+    OctreeLodQuery(const Octree<DataPoint, Aggregate>* octree, Scalar radius, Scalar tolerance, const VectorType& point) :
+        QueryType(radius, point), m_octree(octree), m_tolerance(tolerance)
+    {
+    }
+
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline OctreeLodQuery& operator()(const VectorType& point)
+    {
+        QueryType::set_input(point);
+        return *this;
+    }
+
+    /// \brief Rebind the query to a new input and radius, and return it to iterate it again
+    inline OctreeLodQuery& operator()(const VectorType& point, Scalar radius)
+    {
+        QueryType::set_radius(radius);
+        return (*this)(point);
+    }
+
+    inline Scalar tolerance() const { return m_tolerance; }
+    inline void set_tolerance(Scalar tolerance) { m_tolerance = tolerance; }
+
+public:
+    inline Iterator begin();
+    inline Iterator end();
+
+protected:
+    inline void advance(Iterator& iterator);
+
+    const Octree<DataPoint, Aggregate>* m_octree { nullptr };
+    Scalar m_tolerance { 0 };
+    std::vector<int> m_stack; // nodes to visit, keeps its capacity from one search to the next
+};
+
+#include "./octreeLodQuery.hpp"
+} // namespace ponca
@@ -0,0 +1,83 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+template<class DataPoint, class Aggregate>
+typename OctreeLodQuery<DataPoint, Aggregate>::Iterator OctreeLodQuery<DataPoint, Aggregate>::begin()
+{
+    QueryType::reset();
+    m_stack.clear();
+    if(m_octree->node_count() > 0)
+        m_stack.push_back(0);
+    Iterator it(this);
+    this->advance(it);
+    return it;
+}
+
+template<class DataPoint, class Aggregate>
+typename OctreeLodQuery<DataPoint, Aggregate>::Iterator OctreeLodQuery<DataPoint, Aggregate>::end()
+{
+    return Iterator(this, m_octree->point_count());
+}
+
+template<class DataPoint, class Aggregate>
+void OctreeLodQuery<DataPoint, Aggregate>::advance(Iterator& it)
+{
+    const auto* indices = m_octree->index_buffer();
+    const auto& point   = QueryType::input();
+    const Scalar squared_radius = QueryType::m_squared_radius;
+    // the nodes whose diagonal is lower than this are returned as a whole
+    const Scalar max_diagonal = m_tolerance * QueryType::radius();
+
+    it.m_node = false;
+    for(;;)
+    {
+        // resume the scan of the current leaf
+        for(int i = it.m_start; i < it.m_end; ++i)
+        {
+            const int idx = indices[i];
+            const Scalar d = (m_octree->point(idx).pos() - point).squaredNorm();
+            if(d >= squared_radius) continue;
+
+            it.m_index = idx;
+            it.m_start = i+1;
+            it.m_squared_distance = d;
+            return;
+        }
+        it.m_start = it.m_end = 0;
+
+        if(m_stack.empty()) break;
+        const int node_id = m_stack.back();
+        const auto& node  = m_octree->node(node_id);
+        m_stack.pop_back();
+
+        // squared distances between the point and the closest and farthest points of the cube
+        const auto offset = (node.center - point).cwiseAbs().array();
+        const Scalar nearest  = (offset - node.half_size).cwiseMax(Scalar(0)).matrix().squaredNorm();
+        const Scalar farthest = (offset + node.half_size).matrix().squaredNorm();
+        if(nearest >= squared_radius) continue;
+
+        const Scalar diagonal = Scalar(2) * node.half_size * std::sqrt(Scalar(DataPoint::Dim));
+        if(m_tolerance > Scalar(0) && farthest < squared_radius && diagonal <= max_diagonal)
+        {
+            it.m_node  = true;
+            it.m_index = node_id;
+            it.m_squared_distance = (node.center - point).squaredNorm();
+            return;
+        }
+
+        if(node.is_leaf())
+        {
+            it.m_start = node.start;
+            it.m_end   = node.start + node.size;
+        }
+        else
+        {
+            for(int child = node.first_child; child < node.first_child + node.child_count; ++child)
+                m_stack.push_back(child);
+        }
+    }
+    it.m_index = m_octree->point_count();
+}
@@ -0,0 +1,151 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../defines.h"
+
+#include <Eigen/Eigen>
+#include <Eigen/StdVector>
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <vector>
+
+#include "../../Common/Assert.h"
+
+#include "./octreeMoments.h"
+#include "Query/octreeLodQuery.h"
+
+namespace Ponca {
+
+/// \brief Node of an Octree: a cube, the range of its points in Octree::index_data(), and the aggregate of its points
+/// \ingroup spatialpartitioning
+template<class DataPoint, class Aggregate>
+struct OctreeNode
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    VectorType center;          ///< Center of the cube
+    Scalar     half_size;       ///< Half of the side of the cube
+    int        first_child {-1};///< Id of the first child, the children are stored contiguously
+    int        child_count {0}; ///< Number of non-empty children, 0 for the leaves
+    int        start {0};       ///< The points of the node are `index_data()[start, start+size)`
+    int        size {0};
+    Aggregate  aggregate;       ///< Aggregate of the points of the node
+
+    inline bool is_leaf() const { return child_count == 0; }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/// \brief Octree (\f$ 2^{Dim} \f$-tree) whose nodes hold an aggregate of their points
+///
+/// The nodes are cubes split at their center, only the non-empty children being stored. The points of each subtree
+/// are stored contiguously in index_data(), and each node stores the aggregate of its points (see
+/// OctreeMoments), computed bottom-up by the build.
+///
+/// The aggregates let multi-scale evaluations reuse precomputed sums at coarse scales: lod_neighbors() returns the
+/// nodes entirely contained in the query ball that are small enough relatively to the query radius, and the points
+/// of the other nodes.
+///
+/// \tparam Aggregate Aggregate stored in the nodes, see OctreeMoments for the requirements
+/// \ingroup spatialpartitioning
+template<class DataPoint, class Aggregate = OctreeMoments<DataPoint>>
+class Octree
+{
+public:
+    typedef typename DataPoint::Scalar     Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    typedef OctreeNode<DataPoint, Aggregate> NodeType;
+    typedef typename std::vector<DataPoint> PointContainer; // Container for VectorType used inside the Octree
+    typedef typename std::vector<int> IndexContainer; // Container for indices used inside the Octree
+    typedef typename std::vector<NodeType, Eigen::aligned_allocator<NodeType>> NodeContainer; // Container for nodes used inside the Octree
+
+    inline Octree() = default;
+
+    template<typename PointUserContainer>
+    inline Octree(const PointUserContainer& points)
+    {
+        this->build(points);
+    }
+
+    template<typename PointUserContainer, typename IndexUserContainer>
+    inline Octree(const PointUserContainer& points, const IndexUserContainer& sampling)
+    {
+        this->build(points, sampling);
+    }
+
+    inline void clear();
+
+    template<typename PointUserContainer>
+    inline void build(const PointUserContainer& points);
+
+    template<typename PointUserContainer, typename IndexUserContainer>
+    inline void build(const PointUserContainer& points, const IndexUserContainer& sampling);
+
+    /// \brief Check the consistency of the tree: node ranges, cubes and aggregate counts
+    /// \note Requires the `count` member of OctreeMoments
+    inline bool valid() const;
+
+    // Accessors ---------------------------------------------------------------
+public:
+    inline int node_count() const { return static_cast<int>(m_nodes.size()); }
+    inline int index_count() const { return static_cast<int>(m_indices.size()); }
+    inline int point_count() const { return static_cast<int>(m_points.size()); }
+
+    inline const DataPoint& point(int i) const { return m_points[i]; }
+    inline const PointContainer& point_data() const { return m_points; }
+
+    inline const NodeType& node(int i) const { return m_nodes[i]; }
+    inline const NodeContainer& node_data() const { return m_nodes; }
+
+    inline const IndexContainer& index_data() const { return m_indices; }
+    inline const int* index_buffer() const { return m_indices.data(); }
+
+    // Parameters --------------------------------------------------------------
+public:
+    inline int leaf_size() const { return m_leaf_size; }
+    /// \brief Maximal number of points of the leaves (16 by default), used by the next build
+    inline void set_leaf_size(int leaf_size) { m_leaf_size = leaf_size; }
+
+    inline int max_depth() const { return m_max_depth; }
+    /// \brief Maximal depth of the leaves (21 by default), bounding the tree over duplicated points
+    inline void set_max_depth(int max_depth) { m_max_depth = max_depth; }
+
+    // Query -------------------------------------------------------------------
+public :
+    /// \brief Nodes and points approximating the ball of radius `r` around `point`
+    ///
+    /// A node is returned instead of its points when it is contained in the ball and its diagonal is lower than
+    /// `tolerance * r`. The points of the other nodes are returned when they are in the ball. With a null
+    /// tolerance, only points are returned, as a range query.
+    OctreeLodQuery<DataPoint, Aggregate> lod_neighbors(const VectorType& point, Scalar r, Scalar tolerance) const
+    {
+        return OctreeLodQuery<DataPoint, Aggregate>(this, r, tolerance, point);
+    }
+
+    // Internal ----------------------------------------------------------------
+protected:
+    inline void build_root();
+    inline void build_rec(int node_id, int depth);
+
+    // Data --------------------------------------------------------------------
+protected:
+    PointContainer m_points;
+    NodeContainer  m_nodes;
+    IndexContainer m_indices;
+
+    int m_leaf_size {16};
+    int m_max_depth {21};
+};
+
+#include "./octree.hpp"
+
+} // namespace Ponca
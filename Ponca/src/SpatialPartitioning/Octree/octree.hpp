@@ -0,0 +1,167 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+// Octree ----------------------------------------------------------------------
+
+template<class DataPoint, class Aggregate>
+void Octree<DataPoint, Aggregate>::clear()
+{
+	m_points.clear();
+	m_nodes.clear();
+	m_indices.clear();
+}
+
+template<class DataPoint, class Aggregate>
+template<typename PointUserContainer>
+void Octree<DataPoint, Aggregate>::build(const PointUserContainer& points)
+{
+	this->clear();
+
+	m_points = PointContainer(points);
+
+	m_indices.resize(point_count());
+	std::iota(m_indices.begin(), m_indices.end(), 0);
+
+	this->build_root();
+}
+
+template<class DataPoint, class Aggregate>
+template<typename PointUserContainer, typename IndexUserContainer>
+void Octree<DataPoint, Aggregate>::build(const PointUserContainer& points, const IndexUserContainer& sampling)
+{
+	this->clear();
+
+	m_points = PointContainer(points);
+
+	m_indices = IndexContainer(sampling);
+
+	this->build_root();
+}
+
+template<class DataPoint, class Aggregate>
+void Octree<DataPoint, Aggregate>::build_root()
+{
+	if(m_indices.empty()) return;
+
+	Eigen::AlignedBox<Scalar, DataPoint::Dim> aabb;
+	for(int i : m_indices)
+	    aabb.extend(m_points[i].pos());
+
+	NodeType root;
+	root.center    = aabb.center();
+	root.half_size = aabb.sizes().maxCoeff() / Scalar(2);
+	root.start     = 0;
+	root.size      = index_count();
+	m_nodes.push_back(root);
+
+	this->build_rec(0, 0);
+}
+
+template<class DataPoint, class Aggregate>
+void Octree<DataPoint, Aggregate>::build_rec(int node_id, int depth)
+{
+	constexpr int ChildCount = 1 << DataPoint::Dim;
+
+	// copied: m_nodes grows with the children
+	const VectorType center = m_nodes[node_id].center;
+	const Scalar half_size  = m_nodes[node_id].half_size;
+	const int start         = m_nodes[node_id].start;
+	const int size          = m_nodes[node_id].size;
+
+	if(size <= m_leaf_size || depth >= m_max_depth || half_size <= Scalar(0))
+	{
+	    Aggregate aggregate;
+	    for(int i=start; i<start+size; ++i)
+	        aggregate.add(m_points[m_indices[i]]);
+	    m_nodes[node_id].aggregate = aggregate;
+	    return;
+	}
+
+	// counting sort of the points by child, bit d of the child being set above the center along d
+	const auto child_of = [this, &center](int idx)
+	{
+	    int child = 0;
+	    for(int d=0; d<DataPoint::Dim; ++d)
+	        if(m_points[idx].pos()(d) >= center(d)) child |= 1 << d;
+	    return child;
+	};
+	std::array<int, ChildCount + 1> offsets {};
+	for(int i=start; i<start+size; ++i)
+	    ++offsets[child_of(m_indices[i]) + 1];
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+	IndexContainer sorted(size);
+	std::array<int, ChildCount> cursors;
+	std::copy(offsets.begin(), offsets.end()-1, cursors.begin());
+	for(int i=start; i<start+size; ++i)
+	    sorted[cursors[child_of(m_indices[i])]++] = m_indices[i];
+	std::copy(sorted.begin(), sorted.end(), m_indices.begin() + start);
+
+	const int first_child = node_count();
+	for(int child=0; child<ChildCount; ++child)
+	{
+	    if(offsets[child+1] == offsets[child]) continue;
+	    NodeType node;
+	    node.half_size = half_size / Scalar(2);
+	    for(int d=0; d<DataPoint::Dim; ++d)
+	        node.center(d) = center(d) + ((child >> d) & 1 ? node.half_size : -node.half_size);
+	    node.start = start + offsets[child];
+	    node.size  = offsets[child+1] - offsets[child];
+	    m_nodes.push_back(node);
+	}
+	const int child_count = node_count() - first_child;
+	m_nodes[node_id].first_child = first_child;
+	m_nodes[node_id].child_count = child_count;
+
+	Aggregate aggregate;
+	for(int child=first_child; child<first_child+child_count; ++child)
+	{
+	    this->build_rec(child, depth+1);
+	    aggregate.merge(m_nodes[child].aggregate);
+	}
+	m_nodes[node_id].aggregate = aggregate;
+}
+
+template<class DataPoint, class Aggregate>
+bool Octree<DataPoint, Aggregate>::valid() const
+{
+	if(m_indices.empty())
+	    return m_nodes.empty();
+	if(m_nodes.empty() || m_nodes[0].start != 0 || m_nodes[0].size != index_count())
+	    return false;
+
+	std::vector<bool> present(point_count(), false);
+	for(int idx : m_indices)
+	{
+	    if(idx < 0 || idx >= point_count() || present[idx])
+	        return false;
+	    present[idx] = true;
+	}
+
+	for(const NodeType& node : m_nodes)
+	{
+	    if(node.aggregate.count != Scalar(node.size))
+	        return false;
+	    for(int i=node.start; i<node.start+node.size; ++i)
+	    {
+	        const VectorType offset = m_points[m_indices[i]].pos() - node.center;
+	        if(offset.cwiseAbs().maxCoeff() > node.half_size * (Scalar(1) + Eigen::NumTraits<Scalar>::dummy_precision()))
+	            return false;
+	    }
+	    if(node.is_leaf()) continue;
+
+	    // the children partition the range of their parent
+	    int start = node.start;
+	    for(int child=node.first_child; child<node.first_child+node.child_count; ++child)
+	    {
+	        if(child >= node_count() || m_nodes[child].start != start || m_nodes[child].size == 0)
+	            return false;
+	        start += m_nodes[child].size;
+	    }
+	    if(start != node.start + node.size)
+	        return false;
+	}
+	return true;
+}
@@ -0,0 +1,125 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <Eigen/Core>
+
+namespace Ponca {
+
+/// \addtogroup spatialpartitioning
+/// @{
+
+/// \brief Aggregate of the positions of the points of an Octree node
+///
+/// An aggregate type provides `add(const DataPoint&)` to accumulate a point, and `merge(const Aggregate&)` to
+/// accumulate the aggregate of a child node. The sums are stored in global coordinates: the `*_around` functions
+/// express them relatively to a center, as accumulated by the fits in their local frame.
+template<typename DataPoint>
+struct OctreeMoments
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    Scalar     count {0};                                 ///< Number of points
+    VectorType sum_positions {VectorType::Zero()};        ///< \f$ \sum p_i \f$
+    Scalar     sum_squared_norms {0};                     ///< \f$ \sum |p_i|^2 \f$
+
+    inline void add(const DataPoint& p)
+    {
+        count             += Scalar(1);
+        sum_positions     += p.pos();
+        sum_squared_norms += p.pos().squaredNorm();
+    }
+
+    inline void merge(const OctreeMoments& other)
+    {
+        count             += other.count;
+        sum_positions     += other.sum_positions;
+        sum_squared_norms += other.sum_squared_norms;
+    }
+
+    inline VectorType centroid() const { return sum_positions / count; }
+
+    /// \brief \f$ \sum (p_i - c) \f$
+    inline VectorType sum_positions_around(const VectorType& c) const { return sum_positions - count * c; }
+
+    /// \brief \f$ \sum |p_i - c|^2 \f$
+    inline Scalar sum_squared_norms_around(const VectorType& c) const
+    {
+        return sum_squared_norms - Scalar(2) * c.dot(sum_positions) + count * c.squaredNorm();
+    }
+};
+
+/// \brief Aggregate of the positions and normals of the points of an Octree node, i.e. the sums accumulated by
+/// OrientedSphereFit
+///
+/// \note Requires `DataPoint::normal()`
+template<typename DataPoint>
+struct OctreeOrientedMoments : public OctreeMoments<DataPoint>
+{
+    using Base       = OctreeMoments<DataPoint>;
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    VectorType sum_normals {VectorType::Zero()};          ///< \f$ \sum n_i \f$
+    Scalar     sum_dots {0};                              ///< \f$ \sum n_i \cdot p_i \f$
+
+    inline void add(const DataPoint& p)
+    {
+        Base::add(p);
+        sum_normals += p.normal();
+        sum_dots    += p.normal().dot(p.pos());
+    }
+
+    inline void merge(const OctreeOrientedMoments& other)
+    {
+        Base::merge(other);
+        sum_normals += other.sum_normals;
+        sum_dots    += other.sum_dots;
+    }
+
+    /// \brief \f$ \sum n_i \cdot (p_i - c) \f$
+    inline Scalar sum_dots_around(const VectorType& c) const { return sum_dots - c.dot(sum_normals); }
+};
+
+/// \brief Aggregate of the positions and their outer products of the points of an Octree node, i.e. the sums
+/// accumulated by CovariancePlaneFit
+///
+/// \note Requires `DataPoint::MatrixType`
+template<typename DataPoint>
+struct OctreeCovarianceMoments : public OctreeMoments<DataPoint>
+{
+    using Base       = OctreeMoments<DataPoint>;
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using MatrixType = typename DataPoint::MatrixType;
+
+    MatrixType sum_outer_products {MatrixType::Zero()};   ///< \f$ \sum p_i p_i^T \f$
+
+    inline void add(const DataPoint& p)
+    {
+        Base::add(p);
+        sum_outer_products += p.pos() * p.pos().transpose();
+    }
+
+    inline void merge(const OctreeCovarianceMoments& other)
+    {
+        Base::merge(other);
+        sum_outer_products += other.sum_outer_products;
+    }
+
+    /// \brief \f$ \sum (p_i - c) (p_i - c)^T \f$
+    inline MatrixType sum_outer_products_around(const VectorType& c) const
+    {
+        return sum_outer_products - c * this->sum_positions.transpose() - this->sum_positions * c.transpose()
+             + this->count * c * c.transpose();
+    }
+};
+
+/// @}
+
+} // namespace Ponca
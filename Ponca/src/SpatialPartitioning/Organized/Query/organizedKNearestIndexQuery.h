@@ -0,0 +1,58 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../organizedQuery.h"
+#include "../../query.h"
+#include "../../KdTree/Iterator/kdTreeKNearestIterator.h"
+
+namespace Ponca {
+
+/// \brief k-nearest neighbors query around a pixel, searched in its window of OrganizedIndex::window_radius() pixels
+/// \tparam QueueType Container of the neighbors, see QueryOutputIsKNearest
+/// \ingroup spatialpartitioning
+template <class DataPoint,
+          class QueueType = limited_priority_queue<IndexSquaredDistance<typename DataPoint::Scalar>>>
+class OrganizedKNearestIndexQuery : public OrganizedQuery<DataPoint>,
+    public KNearestIndexQuery<typename DataPoint::Scalar, QueueType>
+{
+public:
+    using Scalar          = typename DataPoint::Scalar;
+    using VectorType      = typename DataPoint::VectorType;
+    using QueryType       = KNearestIndexQuery<typename DataPoint::Scalar, QueueType>;
+    using QueryAccelType  = OrganizedQuery<DataPoint>;
+
+    OrganizedKNearestIndexQuery(const OrganizedIndex<DataPoint>* index, int k, int input) :
+        OrganizedQuery<DataPoint>(index), QueryType(k, input)
+    {
+    }
+
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline OrganizedKNearestIndexQuery& operator()(int input)
+    {
+        QueryType::set_input(input);
+        return *this;
+    }
+
+    /// \brief Rebind the query to a new input and number of neighbors, and return it to iterate it again
+    inline OrganizedKNearestIndexQuery& operator()(int input, int k)
+    {
+        QueryType::set_k(k);
+        return (*this)(input);
+    }
+
+public:
+    KdTreeKNearestIterator<DataPoint, QueueType> begin();
+    KdTreeKNearestIterator<DataPoint, QueueType> end();
+
+protected:
+    void search();
+};
+
+#include "./organizedKNearestIndexQuery.hpp"
+} // namespace ponca
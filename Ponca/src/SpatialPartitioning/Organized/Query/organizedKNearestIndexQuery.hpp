@@ -0,0 +1,42 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+template<class DataPoint, class QueueType>
+KdTreeKNearestIterator<DataPoint, QueueType> OrganizedKNearestIndexQuery<DataPoint, QueueType>::begin()
+{
+	QueryType::reset();
+	this->search();
+	return KdTreeKNearestIterator<DataPoint, QueueType>(QueryType::m_queue.begin());
+}
+
+template<class DataPoint, class QueueType>
+KdTreeKNearestIterator<DataPoint, QueueType> OrganizedKNearestIndexQuery<DataPoint, QueueType>::end()
+{
+	return KdTreeKNearestIterator<DataPoint, QueueType>(QueryType::m_queue.end());
+}
+
+template<class DataPoint, class QueueType>
+void OrganizedKNearestIndexQuery<DataPoint, QueueType>::search()
+{
+	const auto* index = QueryAccelType::m_index;
+	const int input   = QueryType::input();
+
+	if(index->is_valid(input))
+	{
+		const auto collect = [this, input](int i, Scalar d)
+		{
+			if(i == input) return;
+			QueryType::m_queue.push({i, d});
+		};
+		QueryAccelType::scan_window(index->pixel_x(input), index->pixel_y(input),
+		                            index->window_radius(), index->window_radius(), index->point(input).pos(),
+		                            [this]() { return QueryType::m_queue.bottom().squared_distance; }, collect);
+	}
+
+	// the window may hold less than k neighbors
+	if(!QueryType::m_queue.empty() && QueryType::m_queue.bottom().index == -1)
+		QueryType::m_queue.pop();
+}
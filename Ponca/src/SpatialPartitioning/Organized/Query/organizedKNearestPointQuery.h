@@ -0,0 +1,59 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../organizedQuery.h"
+#include "../../query.h"
+#include "../../KdTree/Iterator/kdTreeKNearestIterator.h"
+
+namespace Ponca {
+
+/// \brief k-nearest neighbors query around a position, searched in the window of OrganizedIndex::window_radius()
+/// pixels around its projection by the intrinsics of the OrganizedIndex
+/// \tparam QueueType Container of the neighbors, see QueryOutputIsKNearest
+/// \ingroup spatialpartitioning
+template <class DataPoint,
+          class QueueType = limited_priority_queue<IndexSquaredDistance<typename DataPoint::Scalar>>>
+class OrganizedKNearestPointQuery : public OrganizedQuery<DataPoint>,
+    public KNearestPointQuery<DataPoint, QueueType>
+{
+public:
+    using Scalar          = typename DataPoint::Scalar;
+    using VectorType      = typename DataPoint::VectorType;
+    using QueryType       = KNearestPointQuery<DataPoint, QueueType>;
+    using QueryAccelType  = OrganizedQuery<DataPoint>;
+
+    OrganizedKNearestPointQuery(const OrganizedIndex<DataPoint>* index, int k, const VectorType& point) :
+        OrganizedQuery<DataPoint>(index), QueryType(k, point)
+    {
+    }
+
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline OrganizedKNearestPointQuery& operator()(const VectorType& point)
+    {
+        QueryType::set_input(point);
+        return *this;
+    }
+
+    /// \brief Rebind the query to a new input and number of neighbors, and return it to iterate it again
+    inline OrganizedKNearestPointQuery& operator()(const VectorType& point, int k)
+    {
+        QueryType::set_k(k);
+        return (*this)(point);
+    }
+
+public:
+    KdTreeKNearestIterator<DataPoint, QueueType> begin();
+    KdTreeKNearestIterator<DataPoint, QueueType> end();
+
+protected:
+    void search();
+};
+
+#include "./organizedKNearestPointQuery.hpp"
+} // namespace ponca
@@ -0,0 +1,38 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+template<class DataPoint, class QueueType>
+KdTreeKNearestIterator<DataPoint, QueueType> OrganizedKNearestPointQuery<DataPoint, QueueType>::begin()
+{
+	QueryType::reset();
+	this->search();
+	return KdTreeKNearestIterator<DataPoint, QueueType>(QueryType::m_queue.begin());
+}
+
+template<class DataPoint, class QueueType>
+KdTreeKNearestIterator<DataPoint, QueueType> OrganizedKNearestPointQuery<DataPoint, QueueType>::end()
+{
+	return KdTreeKNearestIterator<DataPoint, QueueType>(QueryType::m_queue.end());
+}
+
+template<class DataPoint, class QueueType>
+void OrganizedKNearestPointQuery<DataPoint, QueueType>::search()
+{
+	const auto* index = QueryAccelType::m_index;
+	const auto& point = QueryType::input();
+
+	int x, y;
+	if(index->project(point, x, y))
+	{
+		const auto collect = [this](int i, Scalar d) { QueryType::m_queue.push({i, d}); };
+		QueryAccelType::scan_window(x, y, index->window_radius(), index->window_radius(), point,
+		                            [this]() { return QueryType::m_queue.bottom().squared_distance; }, collect);
+	}
+
+	// the window may hold less than k neighbors
+	if(!QueryType::m_queue.empty() && QueryType::m_queue.bottom().index == -1)
+		QueryType::m_queue.pop();
+}
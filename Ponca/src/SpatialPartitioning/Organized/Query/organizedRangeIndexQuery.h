@@ -0,0 +1,59 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../organizedQuery.h"
+#include "../../query.h"
+#include "../../KdTree/Iterator/kdTreeRangeIterator.h"
+
+namespace Ponca {
+
+/// \ingroup spatialpartitioning
+template <class DataPoint>
+class OrganizedRangeIndexQuery : public OrganizedQuery<DataPoint>, public RangeIndexQuery<typename DataPoint::Scalar>
+{
+    using Scalar          = typename DataPoint::Scalar;
+    using VectorType      = typename DataPoint::VectorType;
+    using QueryType       = RangeIndexQuery<typename DataPoint::Scalar>;
+    using QueryAccelType  = OrganizedQuery<DataPoint>;
+    using Iterator        = KdTreeRangeIterator<DataPoint, OrganizedRangeIndexQuery>;
+
+protected:
+    friend Iterator;
+
+public:
+
+    OrganizedRangeIndexQuery(const OrganizedIndex<DataPoint>* index, Scalar radius, int input) :
+        OrganizedQuery<DataPoint>(index), QueryType(radius, input)
+    {
+    }
+
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline OrganizedRangeIndexQuery& operator()(int input)
+    {
+        QueryType::set_input(input);
+        return *this;
+    }
+
+    /// \brief Rebind the query to a new input and radius, and return it to iterate it again
+    inline OrganizedRangeIndexQuery& operator()(int input, Scalar radius)
+    {
+        QueryType::set_radius(radius);
+        return (*this)(input);
+    }
+
+public:
+    inline Iterator begin();
+    inline Iterator end();
+
+protected:
+    inline void advance(Iterator& iterator);
+};
+
+#include "./organizedRangeIndexQuery.hpp"
+} // namespace ponca
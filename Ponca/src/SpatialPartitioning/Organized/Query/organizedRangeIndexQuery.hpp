@@ -0,0 +1,40 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+template<class DataPoint>
+typename OrganizedRangeIndexQuery<DataPoint>::Iterator OrganizedRangeIndexQuery<DataPoint>::begin()
+{
+	const auto* index = QueryAccelType::m_index;
+	const int input   = QueryType::input();
+	QueryType::reset();
+	QueryAccelType::m_neighbors.clear();
+	if(index->is_valid(input))
+		QueryAccelType::search_range(index->pixel_x(input), index->pixel_y(input), index->point(input).pos(),
+		                             QueryType::radius(), input);
+	Iterator it(this);
+	this->advance(it);
+	return it;
+}
+
+template<class DataPoint>
+typename OrganizedRangeIndexQuery<DataPoint>::Iterator OrganizedRangeIndexQuery<DataPoint>::end()
+{
+	return Iterator(this, QueryAccelType::m_index->point_count());
+}
+
+template<class DataPoint>
+void OrganizedRangeIndexQuery<DataPoint>::advance(Iterator& it)
+{
+	const auto& neighbors = QueryAccelType::m_neighbors;
+	if(it.m_start < int(neighbors.size()))
+	{
+		it.m_index = neighbors[it.m_start].index;
+		it.m_squared_distance = neighbors[it.m_start].squared_distance;
+		++it.m_start;
+	}
+	else
+		it.m_index = QueryAccelType::m_index->point_count();
+}
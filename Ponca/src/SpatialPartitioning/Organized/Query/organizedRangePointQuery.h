@@ -0,0 +1,60 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../organizedQuery.h"
+#include "../../query.h"
+#include "../../KdTree/Iterator/kdTreeRangeIterator.h"
+
+namespace Ponca {
+
+/// \brief Range query around a position, projected to its pixel by the intrinsics of the OrganizedIndex
+/// \ingroup spatialpartitioning
+template <class DataPoint>
+class OrganizedRangePointQuery : public OrganizedQuery<DataPoint>, public RangePointQuery<DataPoint>
+{
+    using Scalar          = typename DataPoint::Scalar;
+    using VectorType      = typename DataPoint::VectorType;
+    using QueryType       = RangePointQuery<DataPoint>;
+    using QueryAccelType  = OrganizedQuery<DataPoint>;
+    using Iterator        = KdTreeRangeIterator<DataPoint, OrganizedRangePointQuery>;
+
+protected:
+    friend Iterator;
+
+public:
+
+    OrganizedRangePointQuery(const OrganizedIndex<DataPoint>* index, Scalar radius, const VectorType& point) :
+        OrganizedQuery<DataPoint>(index), QueryType(radius, point)
+    {
+    }
+
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline OrganizedRangePointQuery& operator()(const VectorType& point)
+    {
+        QueryType::set_input(point);
+        return *this;
+    }
+
+    /// \brief Rebind the query to a new input and radius, and return it to iterate it again
+    inline OrganizedRangePointQuery& operator()(const VectorType& point, Scalar radius)
+    {
+        QueryType::set_radius(radius);
+        return (*this)(point);
+    }
+
+public:
+    inline Iterator begin();
+    inline Iterator end();
+
+protected:
+    inline void advance(Iterator& iterator);
+};
+
+#include "./organizedRangePointQuery.hpp"
+} // namespace ponca
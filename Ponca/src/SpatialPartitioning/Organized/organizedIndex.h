@@ -0,0 +1,190 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../defines.h"
+
+#include <Eigen/Eigen>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "../../Common/Assert.h"
+
+#include "Query/organizedKNearestPointQuery.h"
+#include "Query/organizedKNearestIndexQuery.h"
+#include "Query/organizedRangePointQuery.h"
+#include "Query/organizedRangeIndexQuery.h"
+
+namespace Ponca {
+
+/// \brief Neighborhood queries over an organized point cloud, e.g. a depth map, by scanning pixel windows
+///
+/// The points are the pixels of a `width` x `height` image, in row-major order: the index of the pixel (x,y) is
+/// `y * width + x`. The neighbors of a point are searched in the window of pixels around it, without building any
+/// structure, as the screen space fits (see ProjectedWeightFunc) do on the GPU:
+///  - the pixels whose depth, the last coordinate of the positions, differs from the depth of the query by more
+///    than max_depth_diff() are rejected, so that the neighborhoods do not cross the depth discontinuities,
+///  - the invalid pixels, whose position is not finite or whose depth is zero (no measure), are never returned.
+///
+/// The queries follow the interfaces of the KdTree queries, so that both structures can be swapped, e.g. in
+/// computeAll:
+///  - the index queries search the window of window_radius() pixels around the pixel of the query,
+///  - the position queries need the pinhole intrinsics of the camera (see set_intrinsics()) to find the pixel of the
+///    query,
+///  - with the intrinsics, the range queries search the window covering the projection of the ball of the query,
+///    clamped to window_radius(): they return the same neighbors as a KdTree, up to the depth test and the clamp.
+///  - the k-nearest neighbors queries return the k nearest neighbors within the window of window_radius() pixels.
+///
+/// The windows are scanned row by row with row_scan(): the positions are also stored by coordinate, so that the
+/// distances and the depth test of contiguous pixels are computed with vectorized Eigen arrays.
+/// \ingroup spatialpartitioning
+template<class DataPoint>
+class OrganizedIndex
+{
+public:
+    typedef typename DataPoint::Scalar     Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    typedef typename std::vector<DataPoint> PointContainer; // Container for the points copied by build()
+    typedef typename std::vector<int> IndexContainer; // Container for the indices of the valid pixels
+    /// Coordinates of the pixels, one column per coordinate, NaN for the invalid pixels
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, DataPoint::Dim> CoordinateMatrix;
+
+    /// Number of contiguous pixels processed at once by row_scan()
+    static constexpr int SCAN_BLOCK_SIZE = 32;
+
+    inline OrganizedIndex() = default;
+
+    template<typename PointUserContainer>
+    inline OrganizedIndex(const PointUserContainer& points, int width, int height)
+    {
+        this->build(points, width, height);
+    }
+
+    inline void clear();
+
+    /// \brief Index a copy of the `width * height` pixels `points`, in row-major order
+    template<typename PointUserContainer>
+    inline void build(const PointUserContainer& points, int width, int height);
+
+    /// \brief Index the `width * height` pixels of the user buffer `points`, without copying them
+    ///
+    /// `points` must outlive the index, e.g. the frame being processed.
+    inline void build_view(const DataPoint* points, int width, int height);
+
+    // Parameters --------------------------------------------------------------
+public:
+    /// \brief Half size of the windows of the queries, in pixels (4 by default, i.e. 9x9 windows)
+    inline int window_radius() const { return m_window_radius; }
+    inline void set_window_radius(int radius) { PONCA_DEBUG_ASSERT(radius >= 0); m_window_radius = radius; }
+
+    /// \brief Largest depth difference between the query and its neighbors, 0 (the default) to disable the test
+    inline Scalar max_depth_diff() const { return m_max_depth_diff; }
+    inline void set_max_depth_diff(Scalar dz) { PONCA_DEBUG_ASSERT(dz >= Scalar(0)); m_max_depth_diff = dz; }
+
+    /// \brief Set the pinhole intrinsics of the camera: the pixel of a position \f$ (x, y, z) \f$ is
+    /// \f$ (f_x x / z + c_x, f_y y / z + c_y) \f$
+    ///
+    /// Enables the position queries and the radius-dependent windows of the range queries. 3D points only.
+    inline void set_intrinsics(Scalar fx, Scalar fy, Scalar cx, Scalar cy);
+    inline void clear_intrinsics() { m_has_intrinsics = false; }
+    inline bool has_intrinsics() const { return m_has_intrinsics; }
+
+    // Accessors ---------------------------------------------------------------
+public:
+    inline int width() const { return m_width; }
+    inline int height() const { return m_height; }
+
+    /// \brief Number of pixels, valid or not
+    inline int point_count() const { return m_width * m_height; }
+    /// \brief Number of valid pixels
+    inline int index_count() const { return static_cast<int>(m_indices.size()); }
+
+    inline const DataPoint& point(int i) const { return m_points_data[i]; }
+    /// \brief Points of the index: the copy made by build(), or the user buffer given to build_view()
+    inline const DataPoint* points_buffer() const { return m_points_data; }
+
+    /// \brief Indices of the valid pixels, in row-major order
+    inline const IndexContainer& index_data() const { return m_indices; }
+    inline const int* index_buffer() const { return m_indices.data(); }
+
+    inline const CoordinateMatrix& coordinates() const { return m_coords; }
+
+    inline bool is_valid(int i) const { return !std::isnan(m_coords(i, 0)); }
+    inline int pixel_x(int i) const { return i % m_width; }
+    inline int pixel_y(int i) const { return i / m_width; }
+    inline int index_of(int x, int y) const { return y * m_width + x; }
+
+    /// \brief Pixel of the projection of `point` by the intrinsics
+    /// \return false when `point` is not in front of the camera (the pixel may be out of the image otherwise)
+    inline bool project(const VectorType& point, int& x, int& y) const;
+
+    /// \brief Half sizes of the window covering the projection of the ball of radius `r` around `point`, clamped to
+    /// window_radius()
+    ///
+    /// A point \f$ p + \delta \f$ of the ball projects at most \f$ f r \sqrt{x^2 + z^2} / (z (z - r)) \f$ pixels
+    /// away from the projection of \f$ p \f$ along x (and the same along y).
+    /// The window is window_radius() without intrinsics.
+    inline void range_window(const VectorType& point, Scalar r, int& wx, int& wy) const;
+
+    /// \brief Call `f(i, d)` for each pixel `i` of the row `y` in [x0,x1] closer than `bound()` to `point` and
+    /// passing the depth test, `d` being the squared distance between `point` and the pixel
+    ///
+    /// The row is processed by blocks of SCAN_BLOCK_SIZE pixels: the distances and the depth test of a block are
+    /// computed from the contiguous coordinates() with Eigen arrays, then `bound()` is evaluated once for the block.
+    template<typename BoundFunctor, typename Functor>
+    inline void row_scan(int y, int x0, int x1, const VectorType& point, BoundFunctor bound, Functor f) const;
+
+    // Query -------------------------------------------------------------------
+public :
+    OrganizedKNearestPointQuery<DataPoint> k_nearest_neighbors(const VectorType& point, int k) const
+    {
+        return OrganizedKNearestPointQuery<DataPoint>(this, k, point);
+    }
+
+    OrganizedKNearestIndexQuery<DataPoint> k_nearest_neighbors(int index, int k) const
+    {
+        return OrganizedKNearestIndexQuery<DataPoint>(this, k, index);
+    }
+
+    OrganizedRangePointQuery<DataPoint> range_neighbors(const VectorType& point, Scalar r) const
+    {
+        return OrganizedRangePointQuery<DataPoint>(this, r, point);
+    }
+
+    OrganizedRangeIndexQuery<DataPoint> range_neighbors(int index, Scalar r) const
+    {
+        return OrganizedRangeIndexQuery<DataPoint>(this, r, index);
+    }
+
+    // Internal ----------------------------------------------------------------
+protected:
+    /// \brief Fill the coordinates and the indices of the valid pixels of `m_points_data`
+    inline void build_coordinates();
+
+    // Data --------------------------------------------------------------------
+protected:
+    PointContainer m_points;                 // copy made by build(), empty for build_view()
+    const DataPoint* m_points_data {nullptr};
+    IndexContainer m_indices;
+    CoordinateMatrix m_coords;
+    int m_width {0};
+    int m_height {0};
+
+    int m_window_radius {4};
+    Scalar m_max_depth_diff {0};
+
+    bool m_has_intrinsics {false};
+    Scalar m_fx {1}, m_fy {1}, m_cx {0}, m_cy {0};
+};
+
+#include "./organizedIndex.hpp"
+
+} // namespace Ponca
@@ -0,0 +1,132 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+// OrganizedIndex --------------------------------------------------------------
+
+template<class DataPoint>
+void OrganizedIndex<DataPoint>::clear()
+{
+	m_points.clear();
+	m_points_data = nullptr;
+	m_indices.clear();
+	m_coords.resize(0, DataPoint::Dim);
+	m_width = m_height = 0;
+}
+
+template<class DataPoint>
+template<typename PointUserContainer>
+void OrganizedIndex<DataPoint>::build(const PointUserContainer& points, int width, int height)
+{
+	this->clear();
+	PONCA_DEBUG_ASSERT(int(points.size()) == width * height);
+
+	m_points = PointContainer(points);
+	m_points_data = m_points.data();
+	m_width  = width;
+	m_height = height;
+
+	this->build_coordinates();
+}
+
+template<class DataPoint>
+void OrganizedIndex<DataPoint>::build_view(const DataPoint* points, int width, int height)
+{
+	this->clear();
+
+	m_points_data = points;
+	m_width  = width;
+	m_height = height;
+
+	this->build_coordinates();
+}
+
+template<class DataPoint>
+void OrganizedIndex<DataPoint>::build_coordinates()
+{
+	const int n = point_count();
+	m_coords.resize(n, DataPoint::Dim);
+	m_indices.reserve(n);
+	for(int i=0; i<n; ++i)
+	{
+		const VectorType& p = m_points_data[i].pos();
+		if(p.allFinite() && p(DataPoint::Dim - 1) != Scalar(0))
+		{
+			m_coords.row(i) = p.transpose();
+			m_indices.push_back(i);
+		}
+		else
+			m_coords.row(i).setConstant(std::numeric_limits<Scalar>::quiet_NaN());
+	}
+}
+
+template<class DataPoint>
+void OrganizedIndex<DataPoint>::set_intrinsics(Scalar fx, Scalar fy, Scalar cx, Scalar cy)
+{
+	static_assert(DataPoint::Dim == 3, "The intrinsics project 3D points");
+	m_fx = fx;
+	m_fy = fy;
+	m_cx = cx;
+	m_cy = cy;
+	m_has_intrinsics = true;
+}
+
+template<class DataPoint>
+bool OrganizedIndex<DataPoint>::project(const VectorType& point, int& x, int& y) const
+{
+	PONCA_DEBUG_ASSERT(m_has_intrinsics);
+	const Scalar z = point(DataPoint::Dim - 1);
+	if(!(z > Scalar(0)))
+		return false;
+	// clamped far away from the image, the windows being clamped to the image anyway
+	const Scalar limit = Scalar(2) * Scalar(std::max(m_width, m_height) + m_window_radius);
+	x = int(std::floor(std::clamp(m_fx * point(0) / z + m_cx + Scalar(0.5), -limit, limit)));
+	y = int(std::floor(std::clamp(m_fy * point(1) / z + m_cy + Scalar(0.5), -limit, limit)));
+	return true;
+}
+
+template<class DataPoint>
+void OrganizedIndex<DataPoint>::range_window(const VectorType& point, Scalar r, int& wx, int& wy) const
+{
+	wx = wy = m_window_radius;
+	const Scalar z = point(DataPoint::Dim - 1);
+	if(!m_has_intrinsics || !(z > r))
+		return;
+
+	const Scalar scale = r / (z * (z - r));
+	const Scalar ex = std::ceil(std::abs(m_fx) * scale * std::sqrt(point(0) * point(0) + z * z));
+	const Scalar ey = std::ceil(std::abs(m_fy) * scale * std::sqrt(point(1) * point(1) + z * z));
+	wx = ex < Scalar(m_window_radius) ? int(ex) : m_window_radius;
+	wy = ey < Scalar(m_window_radius) ? int(ey) : m_window_radius;
+}
+
+template<class DataPoint>
+template<typename BoundFunctor, typename Functor>
+void OrganizedIndex<DataPoint>::row_scan(int y, int x0, int x1, const VectorType& point,
+                                         BoundFunctor bound, Functor f) const
+{
+	constexpr int Depth = DataPoint::Dim - 1;
+	Eigen::Array<Scalar, SCAN_BLOCK_SIZE, 1> distances;
+
+	const int end = index_of(x1, y) + 1;
+	for(int start = index_of(x0, y); start < end; start += SCAN_BLOCK_SIZE)
+	{
+		const int n = std::min(int(SCAN_BLOCK_SIZE), end - start);
+		auto d = distances.head(n);
+
+		// NaN for the invalid pixels, which fail the comparison with the bound below
+		d = (m_coords.col(0).segment(start, n).array() - point(0)).square();
+		for(int c=1; c<DataPoint::Dim; ++c)
+			d += (m_coords.col(c).segment(start, n).array() - point(c)).square();
+		if(m_max_depth_diff > Scalar(0))
+			d = ((m_coords.col(Depth).segment(start, n).array() - point(Depth)).abs() <= m_max_depth_diff)
+			    .select(d, std::numeric_limits<Scalar>::infinity());
+
+		const Scalar b = bound();
+		for(int i=0; i<n; ++i)
+			if(d[i] < b)
+				f(start + i, d[i]);
+	}
+}
@@ -0,0 +1,66 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../indexSquaredDistance.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace Ponca {
+template<class DataPoint> class OrganizedIndex;
+
+/// \brief Base class of the OrganizedIndex queries, scanning the pixel windows around the query input
+/// \ingroup spatialpartitioning
+template <class DataPoint>
+class OrganizedQuery
+{
+public:
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    explicit inline OrganizedQuery(const OrganizedIndex<DataPoint>* index) : m_index( index ) {}
+
+    /// \brief Number of pixels scanned by the last search
+    inline int pixel_visits() const { return m_pixel_visits; }
+
+protected:
+    /// \brief Scan the window of half sizes (`wx`, `wy`) around the pixel (`x`, `y`), clipped to the image, with
+    /// OrganizedIndex::row_scan
+    template<typename BoundFunctor, typename Collector>
+    inline void scan_window(int x, int y, int wx, int wy, const VectorType& point,
+                            BoundFunctor bound, const Collector& collect)
+    {
+        m_pixel_visits = 0;
+        const int x0 = std::max(x - wx, 0), x1 = std::min(x + wx, m_index->width()  - 1);
+        const int y0 = std::max(y - wy, 0), y1 = std::min(y + wy, m_index->height() - 1);
+        if(x0 > x1) return;
+        for(int row = y0; row <= y1; ++row)
+        {
+            m_pixel_visits += x1 - x0 + 1;
+            m_index->row_scan(row, x0, x1, point, bound, collect);
+        }
+    }
+
+    /// \brief Scan the window of the range query of radius `radius` around `point`, the position of the pixel
+    /// (`x`, `y`), and store the neighbors in m_neighbors, but `exclude`
+    inline void search_range(int x, int y, const VectorType& point, Scalar radius, int exclude)
+    {
+        m_neighbors.clear();
+        int wx, wy;
+        m_index->range_window(point, radius, wx, wy);
+        const Scalar squared_radius = radius * radius;
+        scan_window(x, y, wx, wy, point, [squared_radius]() { return squared_radius; },
+            [this, exclude](int i, Scalar d) { if(i != exclude) m_neighbors.push_back({i, d}); });
+    }
+
+    const OrganizedIndex<DataPoint>* m_index { nullptr };
+    int m_pixel_visits { 0 };
+    std::vector<IndexSquaredDistance<Scalar>> m_neighbors; // neighbors found by the range queries
+};
+
+} // namespace Ponca
@@ -0,0 +1,230 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../defines.h"
+#include "../KdTree/kdTree.h"
+#include "../../Common/Tracing.h"
+
+#include <Eigen/Eigen>
+#include <Eigen/Geometry> // aabb
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Ponca {
+
+/// \brief Tile of an OutOfCoreTiling loaded in memory: its points, including the halo, and a KdTree over them
+///
+/// The points inside the tile bounds are the core points, fitted by the tile. The halo points complete their
+/// neighborhoods: the range queries of the tree return the same neighbors as a tree over the whole cloud, for
+/// the core points and radii up to the halo width.
+/// \ingroup spatialpartitioning
+template<class DataPoint>
+struct OutOfCoreTile
+{
+    typedef typename Eigen::AlignedBox<typename DataPoint::Scalar, DataPoint::Dim> Aabb;
+
+    int id;                             ///< Index of the tile in the grid of the tiling
+    Aabb bounds;                        ///< Box of the core points
+    std::vector<DataPoint> points;      ///< Core and halo points
+    std::vector<std::uint64_t> indices; ///< Index of each point in the input stream
+    std::vector<std::uint8_t> core;     ///< Non-zero for the core points
+    KdTree<DataPoint> tree;             ///< Tree viewing `points`, built by KdTree::build_view
+
+    inline int point_count() const { return static_cast<int>(points.size()); }
+    inline bool is_core(int i) const { return core[i] != 0; }
+};
+
+/// \brief Processing of point clouds larger than the memory, by tiles with halos streamed from disk
+///
+/// The bounding box of the cloud is split into a grid of tiles. partition() streams the points once, and appends
+/// each point to the file of its tile, and to the files of the neighboring tiles whose bounds are closer than the
+/// halo width. process() then loads the tiles in parallel, builds a KdTree over each of them and gives it to a
+/// user functor, e.g. running a batch fit of the core points and writing the results, before evicting the tile
+/// and deleting its file. The tiles in memory are limited by a memory budget.
+///
+/// Queries can also be submitted while the tiles are processed, e.g. by the request threads of a server, with
+/// async_query(), async_range_neighbors(), async_k_nearest_neighbors() and async_batch(): they return a
+/// `std::future` instead of blocking. A query on a resident tile runs at once in the calling thread, a query on a
+/// stored tile runs when the tile is loaded, on the thread processing it, before `processor`. process_pipelined()
+/// loads the tiles on dedicated I/O threads, the tiles with pending queries first, so that the queries and the
+/// processing of the resident tiles run while the other tiles are loading.
+///
+/// \code
+/// // request threads
+/// std::future<std::vector<std::uint64_t>> neighbors = tiling.async_range_neighbors(position, radius);
+/// // processing thread
+/// tiling.process_pipelined(write_fits, budget);
+/// \endcode
+///
+/// The points are stored as raw bytes, which requires DataPoint to be bitwise copyable.
+/// \ingroup spatialpartitioning
+template<class DataPoint>
+class OutOfCoreTiling
+{
+public:
+    typedef typename DataPoint::Scalar     Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    typedef typename Eigen::AlignedBox<Scalar, DataPoint::Dim> Aabb;
+    typedef std::array<int, DataPoint::Dim> TileCoord; // Integer coordinates of a tile
+    typedef OutOfCoreTile<DataPoint> Tile;
+
+    /// \brief Split `bounds` into tiles of size `tile_size` with halos of width `halo`, stored in `directory`
+    ///
+    /// A coordinate of `tile_size` larger than the extent of the bounds leaves the axis unsplit, e.g. the vertical
+    /// axis of aerial surveys. The points outside the bounds are assigned to the closest tiles. The directory must
+    /// exist, the tiles are written to the files `directory/tile_<id>.bin`.
+    inline OutOfCoreTiling(const Aabb& bounds, const VectorType& tile_size, Scalar halo, const std::string& directory);
+
+    /// \brief Delete the files of the tiles that were not processed
+    inline ~OutOfCoreTiling();
+
+    OutOfCoreTiling(const OutOfCoreTiling&) = delete;
+    OutOfCoreTiling& operator=(const OutOfCoreTiling&) = delete;
+
+    /// \brief Compute the bounds of the points streamed by `read`
+    ///
+    /// `read(chunk)` fills `chunk` with the next points and returns false when the stream ends.
+    template<typename Reader>
+    static inline Aabb stream_bounds(Reader&& read);
+
+    /// \brief Stream the points given by `read` to the files of the tiles
+    ///
+    /// `read(chunk)` fills `chunk` with the next points and returns false when the stream ends, the points being
+    /// numbered in the order of the stream. The points are buffered by tile, and a buffer is appended to its file
+    /// when it holds `flush_size` points: the memory used is at most `tile_count() * flush_size` points.
+    /// \return The number of points read
+    template<typename Reader>
+    inline std::uint64_t partition(Reader&& read, int flush_size = 4096);
+
+    /// \brief Load each non-empty tile, build its tree, call `processor(tile)` and evict it
+    ///
+    /// The tiles are distributed over the OpenMP threads, by decreasing size, `processor` being called
+    /// concurrently. A tile is loaded only if the memory of the loaded tiles, estimated by tile_memory(), stays
+    /// below `memory_budget` bytes: the other threads wait for tiles to be evicted. A tile larger than the budget
+    /// is processed alone. The file of each tile is deleted after processing.
+    template<typename Processor>
+    inline void process(Processor&& processor, std::size_t memory_budget, int min_cell_size = 64);
+
+    /// \brief Same as process(), the tiles being read and their trees built by `loader_count` threads while the
+    /// OpenMP threads process the loaded tiles
+    ///
+    /// The worker threads never wait for the disk while a tile is loaded: the loaders read ahead as long as the
+    /// memory budget allows it, and pick the tiles with the most pending queries first, then the largest ones.
+    template<typename Processor>
+    inline void process_pipelined(Processor&& processor, std::size_t memory_budget, int loader_count = 1,
+                                  int min_cell_size = 64);
+
+    // Asynchronous queries ----------------------------------------------------
+public:
+    /// \brief Run `query(tile)` on the tile containing `point`, and return its result in a future
+    ///
+    /// The query runs at once in the calling thread if the tile is resident, or holds no point (the tile given
+    /// then has no point and no tree), otherwise when the tile is loaded by process() or process_pipelined(), in
+    /// the processing thread. The queries can be submitted concurrently, from any thread, after partition().
+    ///
+    /// The future holds a `std::logic_error` when the tile was already processed, the exception thrown by `query`,
+    /// or a `std::future_error` when the tiling is destroyed before the tile is processed.
+    template<typename Query>
+    inline std::future<std::invoke_result_t<Query&, const Tile&>> async_query(const VectorType& point, Query query);
+
+    /// \brief Stream indices of the neighbors of `point` closer than `r`
+    ///
+    /// The neighbors are exact for `r` up to the halo width, the query being answered by a single tile.
+    inline std::future<std::vector<std::uint64_t>> async_range_neighbors(const VectorType& point, Scalar r);
+
+    /// \brief Stream indices of the `k` nearest neighbors of `point` in its tile, sorted by distance
+    ///
+    /// The neighbors are exact when the k-th one is closer than the halo width.
+    inline std::future<std::vector<std::uint64_t>> async_k_nearest_neighbors(const VectorType& point, int k);
+
+    /// \brief Run `query(tile, points[i])` for each point, on the tile containing it, e.g. a fit of its neighbors
+    ///
+    /// The points are grouped by tile, each group running as an async_query(): the resident tiles answer at once
+    /// while the others are loading. The future holds the results in the order of the points once all the tiles
+    /// answered, and the first error otherwise. The result of `query` must be default constructible.
+    template<typename Query>
+    inline std::future<std::vector<std::invoke_result_t<Query&, const Tile&, const VectorType&>>>
+    async_batch(const std::vector<VectorType>& points, Query query);
+
+    /// \brief Number of queries waiting for their tile to be loaded
+    inline int pending_query_count() const;
+
+    // Accessors ---------------------------------------------------------------
+public:
+    inline int tile_count() const { return static_cast<int>(m_tile_point_counts.size()); }
+    inline const Aabb& bounds() const { return m_bounds; }
+    inline Scalar halo() const { return m_halo; }
+    /// \brief Number of grid tiles along each axis
+    inline const TileCoord& grid_size() const { return m_grid_size; }
+    /// \brief Number of points, core and halo, written to the file of the tile `id`
+    inline std::uint64_t tile_point_count(int id) const { return m_tile_point_counts[id]; }
+    /// \brief Estimated memory, in bytes, used by a loaded tile of `count` points and its tree
+    inline static std::size_t tile_memory(std::uint64_t count);
+
+    /// \brief Tile whose bounds contain `point`, clamped to the grid
+    inline TileCoord tile_of(const VectorType& point) const;
+    inline int tile_id(const TileCoord& coord) const;
+    inline TileCoord tile_coord(int id) const;
+    /// \brief Box of the core points of the tile `id`
+    inline Aabb tile_bounds(int id) const;
+    inline std::string tile_filename(int id) const;
+
+protected:
+    /// \brief Call `f(id)` for each tile that stores `point`, as a core or halo point
+    template<typename Functor>
+    inline void for_each_tile(const VectorType& point, Functor f) const;
+
+    /// \brief Read the file of the tile `id` and build its tree
+    inline void load(int id, int min_cell_size, Tile& tile) const;
+
+    /// \brief Answer the pending queries of the loaded `tile`, call `processor(tile)` and mark the tile processed
+    template<typename Processor>
+    inline void process_loaded(const std::shared_ptr<const Tile>& tile, Processor& processor);
+
+    /// \brief Run `task(tile)` now if the tile `id` is resident or empty, or when it is loaded
+    /// \return false when the tile was already processed, `task` being dropped
+    inline bool schedule(int id, std::function<void(const Tile&)> task);
+
+    // Data --------------------------------------------------------------------
+protected:
+    Aabb m_bounds;
+    VectorType m_tile_size;
+    Scalar m_halo;
+    std::string m_directory;
+    TileCoord m_grid_size;
+    std::vector<std::uint64_t> m_tile_point_counts;
+
+    // Asynchronous queries, guarded by m_query_mutex
+    mutable std::mutex m_query_mutex;
+    std::vector<std::vector<std::function<void(const Tile&)>>> m_pending; // Queries waiting for each tile
+    std::vector<std::shared_ptr<const Tile>> m_resident;                  // Tiles being processed
+    std::vector<std::uint8_t> m_processed;                                // Non-zero for the evicted tiles
+};
+
+#include "./outOfCoreTiling.hpp"
+
+} // namespace Ponca
@@ -0,0 +1,585 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+// OutOfCoreTiling -------------------------------------------------------------
+
+template<class DataPoint>
+OutOfCoreTiling<DataPoint>::OutOfCoreTiling(const Aabb& bounds, const VectorType& tile_size, Scalar halo,
+                                            const std::string& directory) :
+	m_bounds(bounds),
+	m_tile_size(tile_size),
+	m_halo(halo),
+	m_directory(directory)
+{
+	PONCA_DEBUG_ASSERT(!bounds.isEmpty());
+	PONCA_DEBUG_ASSERT((tile_size.array() > Scalar(0)).all());
+	PONCA_DEBUG_ASSERT(halo >= Scalar(0));
+
+	int count = 1;
+	for(int d=0; d<DataPoint::Dim; ++d)
+	{
+	    m_grid_size[d] = std::max(1, static_cast<int>(std::ceil(bounds.sizes()[d] / tile_size[d])));
+	    count *= m_grid_size[d];
+	}
+	m_tile_point_counts.assign(count, 0);
+	m_pending.resize(count);
+	m_resident.resize(count);
+	m_processed.assign(count, 0);
+}
+
+template<class DataPoint>
+OutOfCoreTiling<DataPoint>::~OutOfCoreTiling()
+{
+	for(int id=0; id<tile_count(); ++id)
+	{
+	    if(m_tile_point_counts[id] > 0)
+	        std::remove(tile_filename(id).c_str());
+	}
+}
+
+template<class DataPoint>
+template<typename Reader>
+auto OutOfCoreTiling<DataPoint>::stream_bounds(Reader&& read) -> Aabb
+{
+	Aabb bounds;
+	std::vector<DataPoint> chunk;
+	while(read(chunk))
+	{
+	    for(const DataPoint& p : chunk)
+	        bounds.extend(p.pos());
+	}
+	return bounds;
+}
+
+template<class DataPoint>
+template<typename Reader>
+std::uint64_t OutOfCoreTiling<DataPoint>::partition(Reader&& read, int flush_size)
+{
+	PONCA_DEBUG_ASSERT(flush_size > 0);
+
+	struct Record
+	{
+	    std::uint64_t index;
+	    DataPoint point;
+	};
+	std::vector<std::vector<Record>> buffers(tile_count());
+
+	const auto flush = [this](int id, std::vector<Record>& buffer)
+	{
+	    std::ofstream file(tile_filename(id), std::ios::binary | std::ios::app);
+	    file.write(reinterpret_cast<const char*>(buffer.data()), std::streamsize(buffer.size() * sizeof(Record)));
+	    PONCA_DEBUG_ASSERT(file.good());
+	    m_tile_point_counts[id] += buffer.size();
+	    buffer.clear();
+	};
+
+	std::uint64_t index = 0;
+	std::vector<DataPoint> chunk;
+	while(read(chunk))
+	{
+	    for(const DataPoint& p : chunk)
+	    {
+	        for_each_tile(p.pos(), [&](int id)
+	        {
+	            std::vector<Record>& buffer = buffers[id];
+	            buffer.push_back({index, p});
+	            if(static_cast<int>(buffer.size()) >= flush_size)
+	                flush(id, buffer);
+	        });
+	        ++index;
+	    }
+	}
+
+	for(int id=0; id<tile_count(); ++id)
+	{
+	    if(!buffers[id].empty())
+	        flush(id, buffers[id]);
+	}
+	return index;
+}
+
+template<class DataPoint>
+template<typename Processor>
+void OutOfCoreTiling<DataPoint>::process(Processor&& processor, std::size_t memory_budget, int min_cell_size)
+{
+	PONCA_TRACE_ZONE("ponca::OutOfCoreTiling::process");
+	// largest tiles first, so that the last tiles balance the load of the threads
+	std::vector<int> order;
+	for(int id=0; id<tile_count(); ++id)
+	{
+	    if(m_tile_point_counts[id] > 0)
+	        order.push_back(id);
+	}
+	std::stable_sort(order.begin(), order.end(), [this](int a, int b)
+	{
+	    return m_tile_point_counts[a] > m_tile_point_counts[b];
+	});
+
+	std::mutex mutex;
+	std::condition_variable evicted;
+	std::size_t loaded_memory = 0;
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for(int n=0; n<static_cast<int>(order.size()); ++n)
+	{
+	    const int id = order[n];
+	    const std::size_t memory = tile_memory(m_tile_point_counts[id]);
+	    {
+	        // a tile above the budget waits for all the others to be evicted
+	        std::unique_lock<std::mutex> lock(mutex);
+	        evicted.wait(lock, [&]{ return loaded_memory == 0 || loaded_memory + memory <= memory_budget; });
+	        loaded_memory += memory;
+	    }
+
+	    {
+	        auto tile = std::make_shared<Tile>();
+	        {
+	            PONCA_TRACE_ZONE("ponca::OutOfCoreTiling::load");
+	            this->load(id, min_cell_size, *tile);
+	        }
+	        process_loaded(tile, processor);
+	    }
+
+	    {
+	        std::lock_guard<std::mutex> lock(mutex);
+	        loaded_memory -= memory;
+	    }
+	    evicted.notify_all();
+	}
+}
+
+template<class DataPoint>
+template<typename Processor>
+void OutOfCoreTiling<DataPoint>::process_pipelined(Processor&& processor, std::size_t memory_budget,
+                                                   int loader_count, int min_cell_size)
+{
+	PONCA_TRACE_ZONE("ponca::OutOfCoreTiling::process_pipelined");
+	PONCA_DEBUG_ASSERT(loader_count > 0);
+
+	std::vector<std::uint8_t> claimed(tile_count(), 0);
+	std::mutex mutex; // guards the fields below, taken before m_query_mutex
+	std::condition_variable changed;
+	std::deque<std::shared_ptr<const Tile>> ready;
+	std::size_t loaded_memory = 0;
+	int active_loaders = loader_count;
+
+	// next tile to load: the most awaited by the queries, then the largest
+	const auto next_tile = [&]()
+	{
+	    std::lock_guard<std::mutex> lock(m_query_mutex);
+	    int best = -1;
+	    for(int id=0; id<tile_count(); ++id)
+	    {
+	        if(claimed[id] || m_tile_point_counts[id] == 0)
+	            continue;
+	        if(best < 0 || m_pending[id].size() > m_pending[best].size() ||
+	           (m_pending[id].size() == m_pending[best].size() && m_tile_point_counts[id] > m_tile_point_counts[best]))
+	            best = id;
+	    }
+	    return best;
+	};
+
+	const auto loader = [&]()
+	{
+	    while(true)
+	    {
+	        int id;
+	        {
+	            std::unique_lock<std::mutex> lock(mutex);
+	            id = next_tile();
+	            if(id < 0)
+	                break;
+	            claimed[id] = 1;
+	            // a tile above the budget waits for all the others to be evicted
+	            const std::size_t memory = tile_memory(m_tile_point_counts[id]);
+	            changed.wait(lock, [&]{ return loaded_memory == 0 || loaded_memory + memory <= memory_budget; });
+	            loaded_memory += memory;
+	        }
+
+	        auto tile = std::make_shared<Tile>();
+	        {
+	            PONCA_TRACE_ZONE("ponca::OutOfCoreTiling::load");
+	            this->load(id, min_cell_size, *tile);
+	        }
+	        {
+	            std::lock_guard<std::mutex> lock(mutex);
+	            ready.push_back(std::move(tile));
+	        }
+	        changed.notify_all();
+	    }
+	    {
+	        std::lock_guard<std::mutex> lock(mutex);
+	        --active_loaders;
+	    }
+	    changed.notify_all();
+	};
+
+	std::vector<std::thread> loaders;
+	for(int i=0; i<loader_count; ++i)
+	    loaders.emplace_back(loader);
+
+#pragma omp parallel
+	while(true)
+	{
+	    std::shared_ptr<const Tile> tile;
+	    {
+	        std::unique_lock<std::mutex> lock(mutex);
+	        changed.wait(lock, [&]{ return !ready.empty() || active_loaders == 0; });
+	        if(ready.empty())
+	            break;
+	        tile = std::move(ready.front());
+	        ready.pop_front();
+	    }
+	    const std::size_t memory = tile_memory(tile->points.size());
+	    process_loaded(tile, processor);
+	    tile.reset();
+
+	    {
+	        std::lock_guard<std::mutex> lock(mutex);
+	        loaded_memory -= memory;
+	    }
+	    changed.notify_all();
+	}
+
+	for(std::thread& t : loaders)
+	    t.join();
+}
+
+template<class DataPoint>
+template<typename Query>
+auto OutOfCoreTiling<DataPoint>::async_query(const VectorType& point, Query query)
+    -> std::future<std::invoke_result_t<Query&, const Tile&>>
+{
+	typedef std::invoke_result_t<Query&, const Tile&> Result;
+	struct State
+	{
+	    std::promise<Result> promise;
+	    Query query;
+	};
+	auto state = std::make_shared<State>(State{std::promise<Result>(), std::move(query)});
+	std::future<Result> future = state->promise.get_future();
+
+	const bool scheduled = schedule(tile_id(tile_of(point)), [state](const Tile& tile)
+	{
+	    try
+	    {
+	        state->promise.set_value(state->query(tile));
+	    }
+	    catch(...)
+	    {
+	        state->promise.set_exception(std::current_exception());
+	    }
+	});
+	if(!scheduled)
+	{
+	    state->promise.set_exception(std::make_exception_ptr(
+	        std::logic_error("OutOfCoreTiling: the tile of the query was already processed")));
+	}
+	return future;
+}
+
+template<class DataPoint>
+std::future<std::vector<std::uint64_t>> OutOfCoreTiling<DataPoint>::async_range_neighbors(const VectorType& point,
+                                                                                          Scalar r)
+{
+	return async_query(point, [point, r](const Tile& tile)
+	{
+	    std::vector<std::uint64_t> neighbors;
+	    if(tile.point_count() > 0)
+	    {
+	        for(int j : tile.tree.range_neighbors(point, r))
+	            neighbors.push_back(tile.indices[j]);
+	    }
+	    return neighbors;
+	});
+}
+
+template<class DataPoint>
+std::future<std::vector<std::uint64_t>> OutOfCoreTiling<DataPoint>::async_k_nearest_neighbors(const VectorType& point,
+                                                                                              int k)
+{
+	return async_query(point, [point, k](const Tile& tile)
+	{
+	    std::vector<std::uint64_t> neighbors;
+	    if(tile.point_count() > 0)
+	    {
+	        for(int j : tile.tree.k_nearest_neighbors(point, k))
+	            neighbors.push_back(tile.indices[j]);
+	    }
+	    return neighbors;
+	});
+}
+
+template<class DataPoint>
+template<typename Query>
+auto OutOfCoreTiling<DataPoint>::async_batch(const std::vector<VectorType>& points, Query query)
+    -> std::future<std::vector<std::invoke_result_t<Query&, const Tile&, const VectorType&>>>
+{
+	typedef std::invoke_result_t<Query&, const Tile&, const VectorType&> Result;
+	struct State
+	{
+	    std::promise<std::vector<Result>> promise;
+	    Query query;
+	    std::vector<VectorType> points;
+	    std::vector<Result> results;
+	    std::atomic<int> remaining{0};
+	    std::atomic<bool> failed{false};
+
+	    State(Query&& q, const std::vector<VectorType>& p) : query(std::move(q)), points(p), results(p.size()) {}
+
+	    // the first error is kept, the results are given by the last group
+	    void fail(std::exception_ptr error)
+	    {
+	        if(!failed.exchange(true))
+	            promise.set_exception(error);
+	    }
+	    void done()
+	    {
+	        if(remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && !failed.load())
+	            promise.set_value(std::move(results));
+	    }
+	};
+	auto state = std::make_shared<State>(std::move(query), points);
+	std::future<std::vector<Result>> future = state->promise.get_future();
+
+	std::vector<std::vector<int>> groups(tile_count());
+	for(int i=0; i<static_cast<int>(points.size()); ++i)
+	    groups[tile_id(tile_of(points[i]))].push_back(i);
+	int count = 0;
+	for(const std::vector<int>& group : groups)
+	    count += !group.empty();
+	if(count == 0)
+	{
+	    state->promise.set_value({});
+	    return future;
+	}
+	// all the groups are counted before any of them answers
+	state->remaining.store(count);
+
+	for(int id=0; id<tile_count(); ++id)
+	{
+	    if(groups[id].empty())
+	        continue;
+	    const bool scheduled = schedule(id, [state, group = std::move(groups[id])](const Tile& tile)
+	    {
+	        try
+	        {
+	            for(int i : group)
+	                state->results[i] = state->query(tile, state->points[i]);
+	        }
+	        catch(...)
+	        {
+	            state->fail(std::current_exception());
+	        }
+	        state->done();
+	    });
+	    if(!scheduled)
+	    {
+	        state->fail(std::make_exception_ptr(
+	            std::logic_error("OutOfCoreTiling: the tile of the query was already processed")));
+	        state->done();
+	    }
+	}
+	return future;
+}
+
+template<class DataPoint>
+int OutOfCoreTiling<DataPoint>::pending_query_count() const
+{
+	std::lock_guard<std::mutex> lock(m_query_mutex);
+	int count = 0;
+	for(const auto& pending : m_pending)
+	    count += static_cast<int>(pending.size());
+	return count;
+}
+
+template<class DataPoint>
+std::size_t OutOfCoreTiling<DataPoint>::tile_memory(std::uint64_t count)
+{
+	// points, stream indices, core flags and tree indices, the nodes being negligible
+	return static_cast<std::size_t>(count) *
+	       (sizeof(DataPoint) + sizeof(std::uint64_t) + sizeof(std::uint8_t) + sizeof(int));
+}
+
+template<class DataPoint>
+auto OutOfCoreTiling<DataPoint>::tile_of(const VectorType& point) const -> TileCoord
+{
+	TileCoord coord;
+	for(int d=0; d<DataPoint::Dim; ++d)
+	{
+	    const int c = static_cast<int>(std::floor((point[d] - m_bounds.min()[d]) / m_tile_size[d]));
+	    coord[d] = std::min(std::max(c, 0), m_grid_size[d] - 1);
+	}
+	return coord;
+}
+
+template<class DataPoint>
+int OutOfCoreTiling<DataPoint>::tile_id(const TileCoord& coord) const
+{
+	int id = 0;
+	for(int d=DataPoint::Dim-1; d>=0; --d)
+	    id = id * m_grid_size[d] + coord[d];
+	return id;
+}
+
+template<class DataPoint>
+auto OutOfCoreTiling<DataPoint>::tile_coord(int id) const -> TileCoord
+{
+	TileCoord coord;
+	for(int d=0; d<DataPoint::Dim; ++d)
+	{
+	    coord[d] = id % m_grid_size[d];
+	    id /= m_grid_size[d];
+	}
+	return coord;
+}
+
+template<class DataPoint>
+auto OutOfCoreTiling<DataPoint>::tile_bounds(int id) const -> Aabb
+{
+	const TileCoord coord = tile_coord(id);
+	VectorType min, max;
+	for(int d=0; d<DataPoint::Dim; ++d)
+	{
+	    min[d] = m_bounds.min()[d] + Scalar(coord[d]) * m_tile_size[d];
+	    max[d] = std::min(m_bounds.max()[d], min[d] + m_tile_size[d]);
+	}
+	return Aabb(min, max);
+}
+
+template<class DataPoint>
+std::string OutOfCoreTiling<DataPoint>::tile_filename(int id) const
+{
+	return m_directory + "/tile_" + std::to_string(id) + ".bin";
+}
+
+template<class DataPoint>
+template<typename Functor>
+void OutOfCoreTiling<DataPoint>::for_each_tile(const VectorType& point, Functor f) const
+{
+	// tiles whose bounds, extended by the halo along each axis, contain the point
+	TileCoord first, last;
+	for(int d=0; d<DataPoint::Dim; ++d)
+	{
+	    VectorType p = point;
+	    p[d] = point[d] - m_halo;
+	    first[d] = tile_of(p)[d];
+	    p[d] = point[d] + m_halo;
+	    last[d] = tile_of(p)[d];
+	}
+
+	TileCoord coord = first;
+	while(true)
+	{
+	    f(tile_id(coord));
+
+	    int d = 0;
+	    for(; d<DataPoint::Dim; ++d)
+	    {
+	        if(++coord[d] <= last[d])
+	            break;
+	        coord[d] = first[d];
+	    }
+	    if(d == DataPoint::Dim)
+	        break;
+	}
+}
+
+template<class DataPoint>
+void OutOfCoreTiling<DataPoint>::load(int id, int min_cell_size, Tile& tile) const
+{
+	struct Record
+	{
+	    std::uint64_t index;
+	    DataPoint point;
+	};
+	const std::size_t count = static_cast<std::size_t>(m_tile_point_counts[id]);
+
+	tile.id = id;
+	tile.bounds = tile_bounds(id);
+	tile.points.resize(count);
+	tile.indices.resize(count);
+	tile.core.resize(count);
+
+	// read by blocks, the records interleaving the indices and the points
+	std::ifstream file(tile_filename(id), std::ios::binary);
+	std::vector<Record> block(std::min<std::size_t>(count, 4096));
+	for(std::size_t start=0; start<count; start+=block.size())
+	{
+	    const std::size_t n = std::min(block.size(), count - start);
+	    file.read(reinterpret_cast<char*>(block.data()), std::streamsize(n * sizeof(Record)));
+	    PONCA_DEBUG_ASSERT(file.good());
+	    for(std::size_t i=0; i<n; ++i)
+	    {
+	        tile.indices[start + i] = block[i].index;
+	        tile.points[start + i] = block[i].point;
+	        tile.core[start + i] = tile_id(tile_of(block[i].point.pos())) == id;
+	    }
+	}
+
+	tile.tree.set_min_cell_size(min_cell_size);
+	tile.tree.build_view(tile.points.data(), static_cast<int>(count));
+}
+
+template<class DataPoint>
+template<typename Processor>
+void OutOfCoreTiling<DataPoint>::process_loaded(const std::shared_ptr<const Tile>& tile, Processor& processor)
+{
+	PONCA_TRACE_ZONE("ponca::OutOfCoreTiling::process tile");
+	PONCA_TRACE_ZONE_VALUE(tile->id);
+	const int id = tile->id;
+
+	// the queries submitted from now on run on the resident tile, in their thread
+	std::vector<std::function<void(const Tile&)>> pending;
+	{
+	    std::lock_guard<std::mutex> lock(m_query_mutex);
+	    m_resident[id] = tile;
+	    pending.swap(m_pending[id]);
+	}
+	for(auto& task : pending)
+	    task(*tile);
+
+	processor(*tile);
+	std::remove(tile_filename(id).c_str());
+
+	{
+	    std::lock_guard<std::mutex> lock(m_query_mutex);
+	    m_resident[id].reset();
+	    m_processed[id] = 1;
+	    m_tile_point_counts[id] = 0;
+	}
+}
+
+template<class DataPoint>
+bool OutOfCoreTiling<DataPoint>::schedule(int id, std::function<void(const Tile&)> task)
+{
+	std::shared_ptr<const Tile> resident;
+	{
+	    std::lock_guard<std::mutex> lock(m_query_mutex);
+	    if(m_processed[id])
+	        return false;
+	    resident = m_resident[id];
+	    if(!resident && m_tile_point_counts[id] > 0)
+	    {
+	        m_pending[id].push_back(std::move(task));
+	        return true;
+	    }
+	}
+
+	// the shared pointer keeps the tile alive if it is evicted meanwhile
+	if(resident)
+	{
+	    task(*resident);
+	}
+	else
+	{
+	    Tile empty;
+	    empty.id = id;
+	    empty.bounds = tile_bounds(id);
+	    task(empty);
+	}
+	return true;
+}
@@ -0,0 +1,57 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../voxelGridQuery.h"
+#include "../../query.h"
+#include "../../KdTree/Iterator/kdTreeKNearestIterator.h"
+
+namespace Ponca {
+
+/// \tparam QueueType Container of the neighbors, see QueryOutputIsKNearest
+/// \ingroup spatialpartitioning
+template <class DataPoint,
+          class QueueType = limited_priority_queue<IndexSquaredDistance<typename DataPoint::Scalar>>>
+class VoxelGridKNearestIndexQuery : public VoxelGridQuery<DataPoint>,
+    public KNearestIndexQuery<typename DataPoint::Scalar, QueueType>
+{
+public:
+    using Scalar          = typename DataPoint::Scalar;
+    using VectorType      = typename DataPoint::VectorType;
+    using QueryType       = KNearestIndexQuery<typename DataPoint::Scalar, QueueType>;
+    using QueryAccelType  = VoxelGridQuery<DataPoint>;
+
+    VoxelGridKNearestIndexQuery(const VoxelGrid<DataPoint>* grid, int k, int index) :
+        VoxelGridQuery<DataPoint>(grid), QueryType(k, index)
+    {
+    }
+
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline VoxelGridKNearestIndexQuery& operator()(int index)
+    {
+        QueryType::set_input(index);
+        return *this;
+    }
+
+    /// \brief Rebind the query to a new input and number of neighbors, and return it to iterate it again
+    inline VoxelGridKNearestIndexQuery& operator()(int index, int k)
+    {
+        QueryType::set_k(k);
+        return (*this)(index);
+    }
+
+public:
+    KdTreeKNearestIterator<DataPoint, QueueType> begin();
+    KdTreeKNearestIterator<DataPoint, QueueType> end();
+
+protected:
+    void search();
+};
+
+#include "./voxelGridKNearestIndexQuery.hpp"
+} // namespace ponca
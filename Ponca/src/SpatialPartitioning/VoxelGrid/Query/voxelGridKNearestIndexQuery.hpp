@@ -0,0 +1,36 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+template<class DataPoint, class QueueType>
+KdTreeKNearestIterator<DataPoint, QueueType> VoxelGridKNearestIndexQuery<DataPoint, QueueType>::begin()
+{
+    QueryType::reset();
+    this->search();
+    return KdTreeKNearestIterator<DataPoint, QueueType>(QueryType::m_queue.begin());
+}
+
+template<class DataPoint, class QueueType>
+KdTreeKNearestIterator<DataPoint, QueueType> VoxelGridKNearestIndexQuery<DataPoint, QueueType>::end()
+{
+    return KdTreeKNearestIterator<DataPoint, QueueType>(QueryType::m_queue.end());
+}
+
+template<class DataPoint, class QueueType>
+void VoxelGridKNearestIndexQuery<DataPoint, QueueType>::search()
+{
+    const auto* indices = QueryAccelType::m_grid->index_buffer();
+    const auto& point   = QueryAccelType::m_grid->point(QueryType::input()).pos();
+
+    const auto collect = [this, &indices](int i, Scalar d)
+    {
+        int idx = indices[i];
+        if(QueryType::input() == idx) return;
+        QueryType::m_queue.push({idx, d});
+    };
+
+    QueryAccelType::search_rings(point,
+        [this]() { return QueryType::m_queue.bottom().squared_distance; }, collect);
+}
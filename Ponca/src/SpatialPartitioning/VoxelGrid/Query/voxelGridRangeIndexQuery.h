@@ -0,0 +1,59 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../voxelGridQuery.h"
+#include "../../query.h"
+#include "../../KdTree/Iterator/kdTreeRangeIterator.h"
+
+namespace Ponca {
+
+/// \ingroup spatialpartitioning
+template <class DataPoint>
+class VoxelGridRangeIndexQuery : public VoxelGridQuery<DataPoint>, public RangeIndexQuery<typename DataPoint::Scalar>
+{
+    using Scalar          = typename DataPoint::Scalar;
+    using VectorType      = typename DataPoint::VectorType;
+    using QueryType       = RangeIndexQuery<typename DataPoint::Scalar>;
+    using QueryAccelType  = VoxelGridQuery<DataPoint>;
+    using Iterator        = KdTreeRangeIterator<DataPoint, VoxelGridRangeIndexQuery>;
+
+protected:
+    friend Iterator;
+
+public:
+
+    VoxelGridRangeIndexQuery(const VoxelGrid<DataPoint>* grid, Scalar radius, int index) :
+        VoxelGridQuery<DataPoint>(grid), QueryType(radius, index)
+    {
+    }
+
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline VoxelGridRangeIndexQuery& operator()(int index)
+    {
+        QueryType::set_input(index);
+        return *this;
+    }
+
+    /// \brief Rebind the query to a new input and radius, and return it to iterate it again
+    inline VoxelGridRangeIndexQuery& operator()(int index, Scalar radius)
+    {
+        QueryType::set_radius(radius);
+        return (*this)(index);
+    }
+
+public:
+    inline Iterator begin();
+    inline Iterator end();
+
+protected:
+    inline void advance(Iterator& iterator);
+};
+
+#include "./voxelGridRangeIndexQuery.hpp"
+} // namespace ponca
@@ -0,0 +1,52 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+template<class DataPoint>
+typename VoxelGridRangeIndexQuery<DataPoint>::Iterator VoxelGridRangeIndexQuery<DataPoint>::begin()
+{
+    QueryAccelType::reset(QueryAccelType::m_grid->point(QueryType::input()).pos(), QueryType::radius());
+    QueryType::reset();
+    Iterator it(this);
+    this->advance(it);
+    return it;
+}
+
+template<class DataPoint>
+typename VoxelGridRangeIndexQuery<DataPoint>::Iterator VoxelGridRangeIndexQuery<DataPoint>::end()
+{
+    return Iterator(this, QueryAccelType::m_grid->point_count());
+}
+
+template<class DataPoint>
+void VoxelGridRangeIndexQuery<DataPoint>::advance(Iterator& it)
+{
+    const auto* grid    = QueryAccelType::m_grid;
+    const auto* indices = grid->index_buffer();
+    const auto& point   = QueryAccelType::m_grid->point(QueryType::input()).pos();
+
+    // resume the scan of the current cell, then move to the next cells
+    for(;;)
+    {
+        for(int i = it.m_start; i < it.m_end; ++i)
+        {
+            const int idx = indices[i];
+            if(idx == QueryType::input()) continue;
+            const Scalar d = (grid->point(idx).pos() - point).squaredNorm();
+            if(d >= QueryType::m_squared_radius) continue;
+
+            it.m_index = idx;
+            it.m_start = i+1;
+            it.m_squared_distance = d;
+            return;
+        }
+
+        const int cell = QueryAccelType::next_cell();
+        if(cell < 0) break;
+        it.m_start = grid->cell_start(cell);
+        it.m_end   = grid->cell_end(cell);
+    }
+    it.m_index = grid->point_count();
+}
@@ -0,0 +1,59 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../voxelGridQuery.h"
+#include "../../query.h"
+#include "../../KdTree/Iterator/kdTreeRangeIterator.h"
+
+namespace Ponca {
+
+/// \ingroup spatialpartitioning
+template <class DataPoint>
+class VoxelGridRangePointQuery : public VoxelGridQuery<DataPoint>, public RangePointQuery<DataPoint>
+{
+    using Scalar          = typename DataPoint::Scalar;
+    using VectorType      = typename DataPoint::VectorType;
+    using QueryType       = RangePointQuery<DataPoint>;
+    using QueryAccelType  = VoxelGridQuery<DataPoint>;
+    using Iterator        = KdTreeRangeIterator<DataPoint, VoxelGridRangePointQuery>;
+
+protected:
+    friend Iterator;
+
+public:
+
+    VoxelGridRangePointQuery(const VoxelGrid<DataPoint>* grid, Scalar radius, const VectorType& point) :
+        VoxelGridQuery<DataPoint>(grid), QueryType(radius, point)
+    {
+    }
+
+    /// \brief Rebind the query to a new input, and return it to iterate it again
+    /// \see QueryInput::set_input
+    inline VoxelGridRangePointQuery& operator()(const VectorType& point)
+    {
+        QueryType::set_input(point);
+        return *this;
+    }
+
+    /// \brief Rebind the query to a new input and radius, and return it to iterate it again
+    inline VoxelGridRangePointQuery& operator()(const VectorType& point, Scalar radius)
+    {
+        QueryType::set_radius(radius);
+        return (*this)(point);
+    }
+
+public:
+    inline Iterator begin();
+    inline Iterator end();
+
+protected:
+    inline void advance(Iterator& iterator);
+};
+
+#include "./voxelGridRangePointQuery.hpp"
+} // namespace ponca
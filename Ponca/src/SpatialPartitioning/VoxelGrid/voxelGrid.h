@@ -0,0 +1,171 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../defines.h"
+
+#include <Eigen/Eigen>
+#include <Eigen/Geometry> // aabb
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+#include "../../Common/Assert.h"
+
+#include "Query/voxelGridKNearestPointQuery.h"
+#include "Query/voxelGridKNearestIndexQuery.h"
+#include "Query/voxelGridRangePointQuery.h"
+#include "Query/voxelGridRangeIndexQuery.h"
+
+namespace Ponca {
+
+/// \brief Uniform grid over a set of points, with the non-empty cells stored in a hash map
+///
+/// The points are sorted by cell, and each cell stores the range of its indices. A range query with a radius
+/// lower than the cell size visits at most \f$ 3^{Dim} \f$ cells, without any traversal: the grid is faster than
+/// KdTree for fixed-radius workloads, e.g. fitting a whole cloud at a single scale.
+///
+/// The queries follow the interfaces of the KdTree queries, so that both structures can be swapped.
+/// \ingroup spatialpartitioning
+template<class DataPoint>
+class VoxelGrid
+{
+public:
+    typedef typename DataPoint::Scalar     Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    typedef typename Eigen::AlignedBox<Scalar, DataPoint::Dim> Aabb;
+
+    typedef typename std::vector<DataPoint> PointContainer; // Container for VectorType used inside the VoxelGrid
+    typedef typename std::vector<int> IndexContainer; // Container for indices used inside the VoxelGrid
+    typedef std::array<int, DataPoint::Dim> CellCoord; // Integer coordinates of a cell
+
+    inline VoxelGrid() = default;
+
+    template<typename PointUserContainer>
+    inline VoxelGrid(const PointUserContainer& points, Scalar cell_size)
+    {
+        this->build(points, cell_size);
+    }
+
+    template<typename PointUserContainer, typename IndexUserContainer>
+    inline VoxelGrid(const PointUserContainer& points, const IndexUserContainer& sampling, Scalar cell_size)
+    {
+        this->build(points, sampling, cell_size);
+    }
+
+    inline void clear();
+
+    /// \brief Build the grid over `points`, with cubic cells of size `cell_size`
+    ///
+    /// The cell size is typically the radius of the range queries.
+    template<typename PointUserContainer>
+    inline void build(const PointUserContainer& points, Scalar cell_size);
+
+    template<typename PointUserContainer, typename IndexUserContainer>
+    inline void build(const PointUserContainer& points, const IndexUserContainer& sampling, Scalar cell_size);
+
+    // Accessors ---------------------------------------------------------------
+public:
+    inline int point_count() const { return static_cast<int>(m_points.size()); }
+    inline int index_count() const { return static_cast<int>(m_indices.size()); }
+    /// \brief Number of non-empty cells
+    inline int cell_count() const { return static_cast<int>(m_cell_coords.size()); }
+    inline Scalar cell_size() const { return m_cell_size; }
+
+    inline const DataPoint& point(int i) const { return m_points[i]; }
+    inline const PointContainer& point_data() const { return m_points; }
+
+    /// \brief Indices of the points, sorted by cell
+    inline const IndexContainer& index_data() const { return m_indices; }
+    inline const int* index_buffer() const { return m_indices.data(); }
+
+    /// \brief Cell containing `point`, which may be empty
+    inline CellCoord cell_of(const VectorType& point) const;
+    /// \brief Id of the non-empty cell at `coord`, or -1 when the cell is empty
+    inline int find_cell(const CellCoord& coord) const;
+    /// \brief Coordinates of the non-empty cell `cell`
+    inline const CellCoord& cell_coord(int cell) const { return m_cell_coords[cell]; }
+    /// \brief The indices of the cell `cell` are `index_data()[cell_start(cell), cell_end(cell))`
+    inline int cell_start(int cell) const { return m_cell_start[cell]; }
+    inline int cell_end(int cell) const { return m_cell_start[cell+1]; }
+    /// \brief Box of the cell at `coord`
+    inline Aabb cell_bounds(const CellCoord& coord) const;
+    /// \brief Lowest and highest coordinates of the non-empty cells
+    inline const CellCoord& min_cell() const { return m_min_cell; }
+    inline const CellCoord& max_cell() const { return m_max_cell; }
+
+    /// \brief Call `f(i, d)` for each `i` in [start,end), `d` being the squared distance between `point` and the
+    /// point `index_data()[i]`
+    template<typename Functor>
+    inline void cell_scan(int start, int end, const VectorType& point, Functor f) const
+    {
+        for(int i=start; i<end; ++i)
+            f(i, (m_points[m_indices[i]].pos() - point).squaredNorm());
+    }
+
+    // Query -------------------------------------------------------------------
+public :
+    VoxelGridKNearestPointQuery<DataPoint> k_nearest_neighbors(const VectorType& point, int k) const
+    {
+        return VoxelGridKNearestPointQuery<DataPoint>(this, k, point);
+    }
+
+    VoxelGridKNearestIndexQuery<DataPoint> k_nearest_neighbors(int index, int k) const
+    {
+        return VoxelGridKNearestIndexQuery<DataPoint>(this, k, index);
+    }
+
+    VoxelGridRangePointQuery<DataPoint> range_neighbors(const VectorType& point, Scalar r) const
+    {
+        return VoxelGridRangePointQuery<DataPoint>(this, r, point);
+    }
+
+    VoxelGridRangeIndexQuery<DataPoint> range_neighbors(int index, Scalar r) const
+    {
+        return VoxelGridRangeIndexQuery<DataPoint>(this, r, index);
+    }
+
+    // Internal ----------------------------------------------------------------
+protected:
+    /// \brief Sort the indices by cell and fill the cell table
+    inline void build_cells();
+
+    /// \brief Hash of the cell coordinates
+    struct CellHash
+    {
+        inline std::size_t operator()(const CellCoord& coord) const
+        {
+            std::size_t h = 0;
+            for(int c : coord)
+                h ^= std::hash<int>()(c) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
+    // Data --------------------------------------------------------------------
+protected:
+    PointContainer m_points;
+    IndexContainer m_indices;
+    std::vector<int> m_cell_start;        // indices of the cell i are [m_cell_start[i], m_cell_start[i+1])
+    std::vector<CellCoord> m_cell_coords;
+    std::unordered_map<CellCoord, int, CellHash> m_cells; // id of the non-empty cells
+    Scalar m_cell_size {1};
+    VectorType m_origin {VectorType::Zero()};
+    CellCoord m_min_cell {};
+    CellCoord m_max_cell {};
+};
+
+#include "./voxelGrid.hpp"
+
+} // namespace Ponca
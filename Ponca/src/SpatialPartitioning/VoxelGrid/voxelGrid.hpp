@@ -0,0 +1,123 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+// VoxelGrid -------------------------------------------------------------------
+
+template<class DataPoint>
+void VoxelGrid<DataPoint>::clear()
+{
+	m_points.clear();
+	m_indices.clear();
+	m_cell_start.clear();
+	m_cell_coords.clear();
+	m_cells.clear();
+}
+
+template<class DataPoint>
+template<typename PointUserContainer>
+void VoxelGrid<DataPoint>::build(const PointUserContainer& points, Scalar cell_size)
+{
+	this->clear();
+
+	m_points = PointContainer(points);
+	m_cell_size = cell_size;
+
+	m_indices.resize(point_count());
+	std::iota(m_indices.begin(), m_indices.end(), 0);
+
+	this->build_cells();
+}
+
+template<class DataPoint>
+template<typename PointUserContainer, typename IndexUserContainer>
+void VoxelGrid<DataPoint>::build(const PointUserContainer& points, const IndexUserContainer& sampling, Scalar cell_size)
+{
+	this->clear();
+
+	m_points = PointContainer(points);
+	m_cell_size = cell_size;
+
+	m_indices = IndexContainer(sampling);
+
+	this->build_cells();
+}
+
+template<class DataPoint>
+void VoxelGrid<DataPoint>::build_cells()
+{
+	PONCA_DEBUG_ASSERT(m_cell_size > Scalar(0));
+
+	Aabb aabb;
+	for(int i : m_indices)
+	    aabb.extend(m_points[i].pos());
+	m_origin = m_indices.empty() ? VectorType::Zero() : aabb.min();
+
+	// counting sort of the indices by cell
+	std::vector<int> keys(m_indices.size());
+	std::vector<int> counts;
+	for(std::size_t i=0; i<m_indices.size(); ++i)
+	{
+	    const CellCoord coord = cell_of(m_points[m_indices[i]].pos());
+	    auto it = m_cells.find(coord);
+	    if(it == m_cells.end())
+	    {
+	        it = m_cells.emplace(coord, cell_count()).first;
+	        m_cell_coords.push_back(coord);
+	        counts.push_back(0);
+	    }
+	    keys[i] = it->second;
+	    ++counts[it->second];
+	}
+
+	m_cell_start.assign(cell_count()+1, 0);
+	std::partial_sum(counts.begin(), counts.end(), m_cell_start.begin()+1);
+	IndexContainer sorted(m_indices.size());
+	std::vector<int> offsets(m_cell_start.begin(), m_cell_start.end()-1);
+	for(std::size_t i=0; i<m_indices.size(); ++i)
+	    sorted[offsets[keys[i]]++] = m_indices[i];
+	m_indices.swap(sorted);
+
+	m_min_cell.fill(std::numeric_limits<int>::max());
+	m_max_cell.fill(std::numeric_limits<int>::lowest());
+	for(const CellCoord& coord : m_cell_coords)
+	{
+	    for(int d=0; d<DataPoint::Dim; ++d)
+	    {
+	        m_min_cell[d] = std::min(m_min_cell[d], coord[d]);
+	        m_max_cell[d] = std::max(m_max_cell[d], coord[d]);
+	    }
+	}
+}
+
+template<class DataPoint>
+typename VoxelGrid<DataPoint>::CellCoord VoxelGrid<DataPoint>::cell_of(const VectorType& point) const
+{
+	// clamped, so that far away query points do not overflow
+	constexpr Scalar limit = Scalar(1 << 28);
+	CellCoord coord;
+	for(int d=0; d<DataPoint::Dim; ++d)
+	{
+	    const Scalar c = std::floor((point(d) - m_origin(d)) / m_cell_size);
+	    coord[d] = static_cast<int>(std::min(std::max(c, -limit), limit));
+	}
+	return coord;
+}
+
+template<class DataPoint>
+int VoxelGrid<DataPoint>::find_cell(const CellCoord& coord) const
+{
+	const auto it = m_cells.find(coord);
+	return it == m_cells.end() ? -1 : it->second;
+}
+
+template<class DataPoint>
+typename VoxelGrid<DataPoint>::Aabb VoxelGrid<DataPoint>::cell_bounds(const CellCoord& coord) const
+{
+	VectorType low;
+	for(int d=0; d<DataPoint::Dim; ++d)
+	    low(d) = m_origin(d) + Scalar(coord[d]) * m_cell_size;
+	return Aabb(low, low + VectorType::Constant(m_cell_size));
+}
@@ -0,0 +1,179 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace Ponca {
+template<class DataPoint> class VoxelGrid;
+
+/// \brief Base class of the VoxelGrid queries, enumerating the cells around the query input
+/// \ingroup spatialpartitioning
+template <class DataPoint>
+class VoxelGridQuery
+{
+public:
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using CellCoord  = std::array<int, DataPoint::Dim>;
+
+    explicit inline VoxelGridQuery(const VoxelGrid<DataPoint>* grid) : m_grid( grid ) {}
+
+    /// \brief Number of non-empty cells scanned since the beginning of the last search
+    inline int cell_visits() const { return m_cell_visits; }
+
+protected:
+    /// \brief Init the enumeration of the non-empty cells intersecting the ball of radius `radius` around `point`
+    ///
+    /// When the ball covers more cells than the grid stores, all the non-empty cells are enumerated.
+    inline void reset(const VectorType& point, Scalar radius)
+    {
+        m_cell_visits = 0;
+        m_cursor      = -1;
+        m_scan_all    = false;
+
+        const CellCoord& lo = m_grid->min_cell();
+        const CellCoord& hi = m_grid->max_cell();
+        const CellCoord low  = m_grid->cell_of(point - VectorType::Constant(radius));
+        const CellCoord high = m_grid->cell_of(point + VectorType::Constant(radius));
+        Scalar volume = 1;
+        for(int d=0; d<DataPoint::Dim; ++d)
+        {
+            m_low[d]  = std::max(low[d], lo[d]);
+            m_high[d] = std::min(high[d], hi[d]);
+            volume *= Scalar(std::max(m_high[d] - m_low[d] + 1, 0));
+        }
+        if(volume > Scalar(m_grid->cell_count()))
+            m_scan_all = true;
+        else if(volume == Scalar(0))
+            m_cursor = m_grid->cell_count(); // nothing to enumerate
+        m_coord = m_low;
+        --m_coord[0];
+    }
+
+    /// \brief Next non-empty cell of the enumeration, or -1 when all the cells were enumerated
+    inline int next_cell()
+    {
+        if(m_scan_all)
+        {
+            ++m_cursor;
+            if(m_cursor >= m_grid->cell_count()) return -1;
+            ++m_cell_visits;
+            return m_cursor;
+        }
+        if(m_cursor >= 0) return -1;
+
+        while(increment(m_coord, m_low, m_high))
+        {
+            const int cell = m_grid->find_cell(m_coord);
+            if(cell >= 0)
+            {
+                ++m_cell_visits;
+                return cell;
+            }
+        }
+        m_cursor = m_grid->cell_count();
+        return -1;
+    }
+
+    /// \brief Scan the cells by rings of increasing Chebyshev distance around the cell of `point`, with `collect`
+    ///
+    /// The search stops as soon as the unvisited cells are all farther than `search_distance()`.
+    template<typename DistanceFunctor, typename Collector>
+    inline void search_rings(const VectorType& point, DistanceFunctor search_distance, const Collector& collect)
+    {
+        m_cell_visits = 0;
+        const CellCoord center = m_grid->cell_of(point);
+        const CellCoord& lo = m_grid->min_cell();
+        const CellCoord& hi = m_grid->max_cell();
+
+        // distance between the point and the faces of its cell
+        const auto cell  = m_grid->cell_bounds(center);
+        const Scalar inner = std::max(Scalar(0),
+            std::min((point - cell.min()).minCoeff(), (cell.max() - point).minCoeff()));
+
+        for(int ring = 0; ; ++ring)
+        {
+            // the cells of the ring are at least this far from the point
+            if(ring > 0)
+            {
+                const Scalar reach = Scalar(ring - 1) * m_grid->cell_size() + inner;
+                if(reach * reach >= search_distance()) return;
+            }
+
+            // when the ring is larger than the grid, scan the remaining cells directly
+            bool covers = true;
+            Scalar volume = 1;
+            for(int d=0; d<DataPoint::Dim; ++d)
+            {
+                covers = covers && center[d] - ring <= lo[d] && center[d] + ring >= hi[d];
+                volume *= Scalar(2 * ring + 1);
+            }
+            if(volume > Scalar(m_grid->cell_count()))
+            {
+                for(int c=0; c<m_grid->cell_count(); ++c)
+                {
+                    if(chebyshev(m_grid->cell_coord(c), center) < ring) continue;
+                    ++m_cell_visits;
+                    m_grid->cell_scan(m_grid->cell_start(c), m_grid->cell_end(c), point, collect);
+                }
+                return;
+            }
+
+            CellCoord low, high, coord;
+            for(int d=0; d<DataPoint::Dim; ++d)
+            {
+                low[d]  = center[d] - ring;
+                high[d] = center[d] + ring;
+            }
+            coord = low;
+            --coord[0];
+            while(increment(coord, low, high))
+            {
+                if(chebyshev(coord, center) != ring) continue;
+                const int c = m_grid->find_cell(coord);
+                if(c < 0) continue;
+                ++m_cell_visits;
+                m_grid->cell_scan(m_grid->cell_start(c), m_grid->cell_end(c), point, collect);
+            }
+            if(covers) return;
+        }
+    }
+
+    /// \brief Move `coord` to the next cell of the box [low, high], in lexicographic order
+    /// \return false when `coord` was the last cell
+    inline static bool increment(CellCoord& coord, const CellCoord& low, const CellCoord& high)
+    {
+        for(int d=0; d<DataPoint::Dim; ++d)
+        {
+            if(++coord[d] <= high[d]) return true;
+            coord[d] = low[d];
+        }
+        return false;
+    }
+
+    inline static int chebyshev(const CellCoord& a, const CellCoord& b)
+    {
+        int dist = 0;
+        for(int d=0; d<DataPoint::Dim; ++d)
+            dist = std::max(dist, std::abs(a[d] - b[d]));
+        return dist;
+    }
+
+    const VoxelGrid<DataPoint>* m_grid { nullptr };
+    int m_cell_visits { 0 };
+    CellCoord m_low {};   // box of cells enumerated by next_cell()
+    CellCoord m_high {};
+    CellCoord m_coord {}; // current cell of the enumeration
+    int m_cursor { -1 };  // current cell when scanning all the cells, cell_count() when done
+    bool m_scan_all { false };
+};
+
+} // namespace Ponca
@@ -12,12 +12,16 @@
 namespace Ponca {
 
 /// \brief Associates an index with a distance
+///
+/// \tparam Index Type of the index, `std::int64_t` for the trees using KdTreeLargeNode
 /// \ingroup spatialpartitioning
-template<typename Scalar>
+template<typename Scalar, typename Index = int>
 struct IndexSquaredDistance
 {
+    using IndexType = Index;
+
     //// Index of the closest point
-    int index {-1};
+    Index index {-1};
 
     /// Distance to the closest point
 	Scalar squared_distance { std::numeric_limits<Scalar>::max() };
@@ -0,0 +1,241 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+
+#include <Eigen/Geometry>
+
+#include <array>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/// Minimal number of codes sorted by several threads
+/// \see morton_sort
+#ifndef PCA_MORTON_PARALLEL_MIN_SIZE
+#define PCA_MORTON_PARALLEL_MIN_SIZE 65536
+#endif
+
+namespace Ponca {
+
+/// \addtogroup spatialpartitioning
+/// @{
+
+/// \brief Number of bits of the Morton codes of type `Code` in dimension `Dim`
+///
+/// The codes interleave `BitsPerAxis` bits of each coordinate, e.g. 30-bit codes in 32-bit integers and 63-bit
+/// codes in 64-bit integers in 3D.
+template<typename Code, int Dim>
+struct MortonTraits
+{
+    enum
+    {
+        BitsPerAxis = (8 * int(sizeof(Code)) - 1) / Dim,
+        Bits        = BitsPerAxis * Dim
+    };
+};
+
+/// \brief Interleave the bits of the quantized coordinates `coords`, from the most significant bits of the first
+/// dimension
+///
+/// Bit `b` of the code holds a bit of the coordinate `Dim - 1 - b % Dim`, see morton_dimension().
+template<typename Code, int Dim>
+PONCA_MULTIARCH inline Code morton_encode(const std::uint32_t* coords)
+{
+    Code code = 0;
+    for(int b = MortonTraits<Code, Dim>::BitsPerAxis - 1; b >= 0; --b)
+        for(int d = 0; d < Dim; ++d)
+            code = Code(code << 1) | Code((coords[d] >> b) & 1u);
+    return code;
+}
+
+/// \brief Insert two zeros between the 10 lowest bits of `x`
+PONCA_MULTIARCH inline std::uint32_t morton_spread3(std::uint32_t x)
+{
+    x &= 0x3ffu;
+    x = (x | (x << 16)) & 0x030000ffu;
+    x = (x | (x <<  8)) & 0x0300f00fu;
+    x = (x | (x <<  4)) & 0x030c30c3u;
+    x = (x | (x <<  2)) & 0x09249249u;
+    return x;
+}
+
+/// \brief Insert two zeros between the 21 lowest bits of `x`
+PONCA_MULTIARCH inline std::uint64_t morton_spread3(std::uint64_t x)
+{
+    x &= 0x1fffffu;
+    x = (x | (x << 32)) & 0x001f00000000ffffull;
+    x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+    x = (x | (x <<  8)) & 0x100f00f00f00f00full;
+    x = (x | (x <<  4)) & 0x10c30c30c30c30c3ull;
+    x = (x | (x <<  2)) & 0x1249249249249249ull;
+    return x;
+}
+
+/// \brief 3D specializations, interleaving the bits with shifts and masks
+template<>
+PONCA_MULTIARCH inline std::uint32_t morton_encode<std::uint32_t, 3>(const std::uint32_t* coords)
+{
+    return (morton_spread3(coords[0]) << 2) | (morton_spread3(coords[1]) << 1) | morton_spread3(coords[2]);
+}
+
+template<>
+PONCA_MULTIARCH inline std::uint64_t morton_encode<std::uint64_t, 3>(const std::uint32_t* coords)
+{
+    return (morton_spread3(std::uint64_t(coords[0])) << 2) | (morton_spread3(std::uint64_t(coords[1])) << 1) |
+           morton_spread3(std::uint64_t(coords[2]));
+}
+
+/// \brief Inverse of morton_encode()
+template<typename Code, int Dim>
+PONCA_MULTIARCH inline void morton_decode(Code code, std::uint32_t* coords)
+{
+    for(int d = 0; d < Dim; ++d)
+        coords[d] = 0;
+    for(int b = 0; b < MortonTraits<Code, Dim>::BitsPerAxis; ++b)
+        for(int d = Dim - 1; d >= 0; --d, code >>= 1)
+            coords[d] |= std::uint32_t(code & 1u) << b;
+}
+
+/// \brief Dimension of the coordinate stored in the bit `bit` of a Morton code
+template<int Dim>
+PONCA_MULTIARCH inline int morton_dimension(int bit) { return Dim - 1 - bit % Dim; }
+
+/// \brief Morton code of the position `p`, quantized over the box `aabb` with `2^BitsPerAxis` cells per axis
+template<typename Code, typename Aabb>
+PONCA_MULTIARCH inline Code morton_code(const typename Aabb::VectorType& p, const Aabb& aabb)
+{
+    constexpr int Dim = Aabb::AmbientDimAtCompileTime;
+    using Scalar = typename Aabb::Scalar;
+    const Scalar cells = Scalar(std::uint64_t(1) << MortonTraits<Code, Dim>::BitsPerAxis);
+    // the last cell is not representable as a Scalar with the 31 bits per axis of the 2D codes
+    const std::uint32_t lastCell = std::uint32_t((std::uint64_t(1) << MortonTraits<Code, Dim>::BitsPerAxis) - 1);
+
+    std::uint32_t coords[Dim];
+    for(int d = 0; d < Dim; ++d)
+    {
+        const Scalar extent = aabb.max()(d) - aabb.min()(d);
+        const Scalar c = extent > Scalar(0) ? (p(d) - aabb.min()(d)) / extent * cells : Scalar(0);
+        // clamped: the points on the max side of the box fall in the last cell
+        coords[d] = c < Scalar(0) ? 0u : (c >= cells ? lastCell : std::uint32_t(c));
+    }
+    return morton_encode<Code, Dim>(coords);
+}
+
+/// \brief Compute the Morton codes of the positions of `points[indices[i]]` for i in [0,count), in parallel
+template<typename Code, typename DataPoint, typename Index>
+inline void morton_codes(const DataPoint* points, const Index* indices, Index count,
+                         const Eigen::AlignedBox<typename DataPoint::Scalar, DataPoint::Dim>& aabb, Code* codes)
+{
+#pragma omp parallel for schedule(static) if(count >= PCA_MORTON_PARALLEL_MIN_SIZE)
+    for(Index i = 0; i < count; ++i)
+        codes[i] = morton_code<Code>(points[indices[i]].pos(), aabb);
+}
+
+/// \brief Sort `codes` in increasing order with a parallel least significant digit radix sort, applying the same
+/// permutation to `indices`
+///
+/// The sort is stable and processes the codes by 8-bit digits, skipping the digits shared by all the codes.
+/// \tparam Index Type of the indices, `int` or `std::int64_t`
+template<typename Code, typename Index>
+inline void morton_sort(Code* codes, Index* indices, Index count)
+{
+    constexpr int Radix = 256;
+    int threads = 1;
+#ifdef _OPENMP
+    if(count >= PCA_MORTON_PARALLEL_MIN_SIZE)
+        threads = omp_get_max_threads();
+#endif
+
+    std::vector<Code> codeBuffer(count);
+    std::vector<Index> indexBuffer(count);
+    Code* codeIn = codes;
+    Code* codeOut = codeBuffer.data();
+    Index* indexIn = indices;
+    Index* indexOut = indexBuffer.data();
+
+    // each thread sorts a contiguous chunk, with its own offsets to keep the sort stable
+    std::vector<std::array<Index, Radix>> offsets(threads);
+    for(int shift = 0; shift < 8 * int(sizeof(Code)); shift += 8)
+    {
+#pragma omp parallel for schedule(static, 1) num_threads(threads)
+        for(int t = 0; t < threads; ++t)
+        {
+            offsets[t].fill(0);
+            const Index start = Index(std::int64_t(count) * t / threads), end = Index(std::int64_t(count) * (t+1) / threads);
+            for(Index i = start; i < end; ++i)
+                ++offsets[t][(codeIn[i] >> shift) & (Radix - 1)];
+        }
+
+        // exclusive scan by digit, then by thread
+        Index total = 0;
+        bool shared = false;
+        for(int digit = 0; digit < Radix; ++digit)
+        {
+            Index digitCount = 0;
+            for(int t = 0; t < threads; ++t)
+            {
+                const Index c = offsets[t][digit];
+                offsets[t][digit] = total;
+                total += c;
+                digitCount += c;
+            }
+            shared = shared || digitCount == count;
+        }
+        if(shared) continue; // all the codes have the same digit
+
+#pragma omp parallel for schedule(static, 1) num_threads(threads)
+        for(int t = 0; t < threads; ++t)
+        {
+            const Index start = Index(std::int64_t(count) * t / threads), end = Index(std::int64_t(count) * (t+1) / threads);
+            for(Index i = start; i < end; ++i)
+            {
+                const Index j = offsets[t][(codeIn[i] >> shift) & (Radix - 1)]++;
+                codeOut[j] = codeIn[i];
+                indexOut[j] = indexIn[i];
+            }
+        }
+        std::swap(codeIn, codeOut);
+        std::swap(indexIn, indexOut);
+    }
+
+    if(codeIn != codes)
+    {
+        std::copy(codeIn, codeIn + count, codes);
+        std::copy(indexIn, indexIn + count, indices);
+    }
+}
+
+/// \brief Indices of `points` sorted along the Morton (Z-order) curve over their bounding box
+///
+/// Reordering the points in this order improves the memory locality of the neighbors queries.
+template<typename Code = std::uint64_t, typename PointContainer>
+inline std::vector<int> morton_order(const PointContainer& points)
+{
+    using DataPoint = typename PointContainer::value_type;
+    const int count = static_cast<int>(points.size());
+
+    Eigen::AlignedBox<typename DataPoint::Scalar, DataPoint::Dim> aabb;
+    for(const auto& p : points)
+        aabb.extend(p.pos());
+
+    std::vector<int> indices(count);
+    std::iota(indices.begin(), indices.end(), 0);
+    std::vector<Code> codes(count);
+    morton_codes(points.data(), indices.data(), count, aabb, codes.data());
+    morton_sort(codes.data(), indices.data(), count);
+    return indices;
+}
+
+/// @}
+
+} // namespace Ponca
@@ -9,6 +9,7 @@
 #include "./defines.h"
 #include "./indexSquaredDistance.h"
 #include "../Common/Containers/limitedPriorityQueue.h"
+#include "../Common/Containers/staticLimitedPriorityQueue.h"
 
 #include <cmath>
 
@@ -17,27 +18,30 @@ namespace Ponca {
 
 /// \internal
 /// \brief Macro generating code of the the Query base classes inhering QueryInputIsIndex
-/// \note For internal use only
+/// \note For internal use only. Extra template arguments are forwarded to the output type, which gives the type
+/// of the input index.
 #define DECLARE_INDEX_QUERY_CLASS(OUT_TYPE) \
 /*! \brief Base Query class combining QueryInputIsIndex and QueryOutputIs##OUT_TYPE##. */    \
-template <typename Scalar>                                 \
-struct  OUT_TYPE##IndexQuery : Query<QueryInputIsIndex, QueryOutputIs##OUT_TYPE<Scalar>> \
+template <typename Scalar, typename... OutArgs>            \
+struct  OUT_TYPE##IndexQuery : Query<QueryInputIsIndex<typename QueryOutputIs##OUT_TYPE<Scalar, OutArgs...>::IndexType>, \
+                                     QueryOutputIs##OUT_TYPE<Scalar, OutArgs...>> \
 { \
-    using Base = Query<QueryInputIsIndex, QueryOutputIs##OUT_TYPE<Scalar>>; \
+    using Base = Query<QueryInputIsIndex<typename QueryOutputIs##OUT_TYPE<Scalar, OutArgs...>::IndexType>, \
+                       QueryOutputIs##OUT_TYPE<Scalar, OutArgs...>>; \
     using Base::Base; \
 };
 
 
 /// \internal
 /// \brief Macro generating code of the the Query base classes inhering QueryInputIsPosition
-/// \note For internal use only
+/// \note For internal use only. Extra template arguments are forwarded to the output type.
 #define DECLARE_POINT_QUERY_CLASS(OUT_TYPE) \
 /*! \brief Base Query class combining QueryInputIsPosition and QueryOutputIs##OUT_TYPE##. */    \
-template <typename DataPoint>                                \
+template <typename DataPoint, typename... OutArgs>           \
 struct  OUT_TYPE##PointQuery : Query<QueryInputIsPosition<DataPoint>, \
-                                     QueryOutputIs##OUT_TYPE<typename DataPoint::Scalar>> \
+                                     QueryOutputIs##OUT_TYPE<typename DataPoint::Scalar, OutArgs...>> \
 { \
-    using Base = Query<QueryInputIsPosition<DataPoint>, QueryOutputIs##OUT_TYPE<typename DataPoint::Scalar>>; \
+    using Base = Query<QueryInputIsPosition<DataPoint>, QueryOutputIs##OUT_TYPE<typename DataPoint::Scalar, OutArgs...>>; \
     using Base::Base; \
 };
 
@@ -67,15 +71,24 @@ struct  OUT_TYPE##PointQuery : Query<QueryInputIsPosition<DataPoint>, \
 
         inline const InputType &input() const { return m_input; }
 
+        /// \brief Change the queried input, to run the same query object again
+        ///
+        /// The next call to `begin()` restarts the search from the new input. The query keeps its buffers, so
+        /// that a query object kept per thread runs any number of searches without allocating.
+        inline void set_input(const InputType &input) { m_input = input; }
+
     private:
         /// Index of the queried point
-        const InputType m_input;
+        InputType m_input;
     };
 
 
 /// \brief Base class for queries storing points
-    struct QueryInputIsIndex : public QueryInput<int> {
-        using Base = QueryInput<int>;
+///
+/// \tparam Index Type of the index of the queried point
+    template<typename Index = int>
+    struct QueryInputIsIndex : public QueryInput<Index> {
+        using Base = QueryInput<Index>;
         using InputType = typename Base::InputType;
 
         inline QueryInputIsIndex(const InputType &point = -1)
@@ -93,9 +106,12 @@ struct  OUT_TYPE##PointQuery : Query<QueryInputIsPosition<DataPoint>, \
     };
 
 /// \brief Base class for range queries
-    template<typename Scalar>
+///
+/// \tparam Index Type of the indices of the neighbors
+    template<typename Scalar, typename Index = int>
     struct QueryOutputIsRange : public QueryOutputBase {
         using OutputParameter = Scalar;
+        using IndexType = Index;
 
         inline QueryOutputIsRange(OutputParameter radius = OutputParameter(0))
                 : m_squared_radius(std::pow(radius, 2)) {}
@@ -115,13 +131,16 @@ struct  OUT_TYPE##PointQuery : Query<QueryInputIsPosition<DataPoint>, \
     };
 
 /// \brief Base class for nearest queries
-    template<typename Scalar>
+///
+/// \tparam Index Type of the index of the neighbor
+    template<typename Scalar, typename Index = int>
     struct QueryOutputIsNearest : public QueryOutputBase {
         using OutputParameter = typename QueryOutputBase::DummyOutputParameter;
+        using IndexType = Index;
 
         QueryOutputIsNearest() {}
 
-        int get() const { return m_nearest; }
+        Index get() const { return m_nearest; }
 
     protected:
         /// \brief Reset Query for a new search
@@ -130,18 +149,31 @@ struct  OUT_TYPE##PointQuery : Query<QueryInputIsPosition<DataPoint>, \
             m_squared_distance = std::numeric_limits<Scalar>::max();
         }
 
-        int m_nearest {-1};
+        Index m_nearest {-1};
         Scalar m_squared_distance {std::numeric_limits<Scalar>::max()};
     };
 
 /// \brief Base class for knearest queries
-    template<typename Scalar>
+///
+/// \tparam QueueType_ Container of the neighbors, e.g. static_limited_priority_queue to avoid allocations. The
+/// type of the indices is the one of its IndexSquaredDistance elements.
+    template<typename Scalar, typename QueueType_ = limited_priority_queue<IndexSquaredDistance<Scalar>>>
     struct QueryOutputIsKNearest : public QueryOutputBase {
         using OutputParameter = int;
+        using QueueType = QueueType_;
+        using IndexType = typename QueueType_::value_type::IndexType;
 
         inline QueryOutputIsKNearest(OutputParameter k = 0) : m_queue(k) {}
 
-        inline limited_priority_queue<IndexSquaredDistance<Scalar>> &queue() { return m_queue; }
+        inline QueueType &queue() { return m_queue; }
+
+        /// \brief Number of neighbors searched by the query
+        inline int k() const { return static_cast<int>(m_queue.capacity()); }
+
+        /// \brief Change the number of neighbors searched by the query
+        ///
+        /// The queue only allocates when growing beyond the largest `k` used so far.
+        inline void set_k(int k) { m_queue.reserve(k); }
 
     protected:
         /// \brief Reset Query for a new search
@@ -149,7 +181,41 @@ struct  OUT_TYPE##PointQuery : Query<QueryInputIsPosition<DataPoint>, \
             m_queue.clear();
             m_queue.push({-1,std::numeric_limits<Scalar>::max()});
         }
-        limited_priority_queue<IndexSquaredDistance<Scalar>> m_queue;
+        QueueType m_queue;
+    };
+
+/// \brief Base class for knearest queries restricted to a radius
+///
+/// The queue bound is initialized to the squared radius, so that the search only collects (and visits) the
+/// neighbors within the radius. Less than `k` neighbors are returned when the radius contains less points.
+    template<typename Scalar, typename QueueType_ = limited_priority_queue<IndexSquaredDistance<Scalar>>>
+    struct QueryOutputIsKNearestRange : public QueryOutputIsKNearest<Scalar, QueueType_> {
+        using Base = QueryOutputIsKNearest<Scalar, QueueType_>;
+        using OutputParameter = typename Base::OutputParameter;
+        using IndexType = typename Base::IndexType;
+
+        inline QueryOutputIsKNearestRange(OutputParameter k = 0) : Base(k) {}
+
+        inline Scalar radius() const { return std::sqrt(m_squared_radius); }
+
+        inline Scalar squared_radius() const { return m_squared_radius; }
+
+        inline void set_radius(Scalar radius) { m_squared_radius = std::pow(radius, 2); }
+
+        inline void set_squared_radius(Scalar radius) { m_squared_radius = radius; }
+
+    protected:
+        /// \brief Reset Query for a new search
+        void reset() {
+            Base::m_queue.clear();
+            Base::m_queue.push({-1,m_squared_radius});
+        }
+        /// \brief Remove the radius bound from the queue once the search is done
+        void finalize() {
+            if(!Base::m_queue.empty() && Base::m_queue.bottom().index == -1)
+                Base::m_queue.pop();
+        }
+        Scalar m_squared_radius{0};
     };
 
 
@@ -174,9 +240,11 @@ struct  OUT_TYPE##PointQuery : Query<QueryInputIsPosition<DataPoint>, \
 DECLARE_INDEX_QUERY_CLASS(KNearest) //KNearestIndexQuery
 DECLARE_INDEX_QUERY_CLASS(Nearest)  //NearestIndexQuery
 DECLARE_INDEX_QUERY_CLASS(Range)    //RangeIndexQuery
+DECLARE_INDEX_QUERY_CLASS(KNearestRange) //KNearestRangeIndexQuery
 DECLARE_POINT_QUERY_CLASS(KNearest) //KNearestPointQuery
 DECLARE_POINT_QUERY_CLASS(Nearest)  //NearestPointQuery
 DECLARE_POINT_QUERY_CLASS(Range)    //RangePointQuery
+DECLARE_POINT_QUERY_CLASS(KNearestRange) //KNearestRangePointQuery
 
 /// @}
 
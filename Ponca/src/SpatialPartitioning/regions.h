@@ -0,0 +1,306 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+
+#include <Eigen/Cholesky>
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace Ponca {
+
+/// \addtogroup spatialpartitioning
+/// @{
+
+/// \brief Position of a bounding box relatively to a region, see the `classify` functions of the regions
+enum REGION_INTERSECTION : unsigned char
+{
+    /*! \brief The box does not intersect the region */
+    REGION_OUTSIDE = 0,
+    /*! \brief The box may intersect the region, its points must be tested */
+    REGION_INTERSECTS = 1,
+    /*! \brief The box is contained in the region, its points do not need to be tested */
+    REGION_INSIDE = 2
+};
+
+/// \brief Oriented box region, given by its center, axes and half extents
+///
+/// The box is axis-aligned when built from an Eigen::AlignedBox.
+template<typename DataPoint>
+struct BoxRegion
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using MatrixType = Eigen::Matrix<Scalar, DataPoint::Dim, DataPoint::Dim>;
+    using Aabb       = Eigen::AlignedBox<Scalar, DataPoint::Dim>;
+
+    inline BoxRegion() : BoxRegion(VectorType::Zero(), MatrixType::Identity(), VectorType::Zero()) {}
+
+    inline BoxRegion(const Aabb& box) :
+        BoxRegion(box.center(), MatrixType::Identity(), box.sizes() / Scalar(2)) {}
+
+    /// \param axes Orthonormal axes of the box, stored in columns
+    /// \param half_extents Half size of the box along each axis
+    inline BoxRegion(const VectorType& center, const MatrixType& axes, const VectorType& half_extents) :
+        m_center(center), m_axes(axes), m_half_extents(half_extents)
+    {
+        // world bounding box of the oriented box
+        const VectorType extent = m_axes.cwiseAbs() * m_half_extents;
+        m_bounds = Aabb(m_center - extent, m_center + extent);
+    }
+
+    inline const VectorType& center() const { return m_center; }
+    inline const MatrixType& axes() const { return m_axes; }
+    inline const VectorType& half_extents() const { return m_half_extents; }
+
+    inline bool contains(const VectorType& p) const
+    {
+        return ((m_axes.transpose() * (p - m_center)).cwiseAbs().array() <= m_half_extents.array()).all();
+    }
+
+    /// \brief Conservative position of `box`: REGION_INTERSECTS may be returned for boxes close to the region
+    inline REGION_INTERSECTION classify(const Aabb& box) const
+    {
+        if(!m_bounds.intersects(box)) return REGION_OUTSIDE;
+
+        // bounding box of `box` in the frame of the region
+        const VectorType center = m_axes.transpose() * (box.center() - m_center);
+        const VectorType extent = m_axes.transpose().cwiseAbs() * (box.sizes() / Scalar(2));
+        if((center.cwiseAbs().array() > (m_half_extents + extent).array()).any()) return REGION_OUTSIDE;
+        if((center.cwiseAbs().array() + extent.array() <= m_half_extents.array()).all()) return REGION_INSIDE;
+        return REGION_INTERSECTS;
+    }
+
+private:
+    VectorType m_center;
+    MatrixType m_axes;
+    VectorType m_half_extents;
+    Aabb       m_bounds;
+};
+
+/// \brief Convex region given by the intersection of half-spaces, e.g. a view frustum
+///
+/// The normals of the planes point inside the region: a point `p` is contained when
+/// `plane.signedDistance(p) >= 0` for all the planes.
+template<typename DataPoint>
+struct FrustumRegion
+{
+    using Scalar         = typename DataPoint::Scalar;
+    using VectorType     = typename DataPoint::VectorType;
+    using Aabb           = Eigen::AlignedBox<Scalar, DataPoint::Dim>;
+    using Plane          = Eigen::Hyperplane<Scalar, DataPoint::Dim>;
+    using PlaneContainer = std::vector<Plane, Eigen::aligned_allocator<Plane>>;
+
+    inline FrustumRegion() = default;
+    inline FrustumRegion(const PlaneContainer& planes) : m_planes(planes) {}
+
+    /// \brief Frustum of a view-projection matrix mapping the region to the clip cube \f$ [-w,w]^3 \f$ (OpenGL
+    /// convention), with the planes ordered left, right, bottom, top, near, far
+    ///
+    /// \note Requires 3D points
+    template<typename MatrixType>
+    inline static FrustumRegion from_view_projection(const MatrixType& m)
+    {
+        static_assert(DataPoint::Dim == 3, "Frustums are extracted from 4x4 projection matrices");
+        PlaneContainer planes;
+        planes.reserve(6);
+        for(int row = 0; row < 3; ++row)
+        {
+            for(Scalar sign : {Scalar(1), Scalar(-1)})
+            {
+                const Eigen::Matrix<Scalar, 4, 1> c = (m.row(3) + sign * m.row(row)).transpose().template cast<Scalar>();
+                const Scalar norm = c.template head<3>().norm();
+                planes.emplace_back(c.template head<3>() / norm, c(3) / norm);
+            }
+        }
+        return FrustumRegion(planes);
+    }
+
+    inline const PlaneContainer& planes() const { return m_planes; }
+
+    inline bool contains(const VectorType& p) const
+    {
+        for(const auto& plane : m_planes)
+            if(plane.signedDistance(p) < Scalar(0)) return false;
+        return true;
+    }
+
+    /// \brief Conservative position of `box`: REGION_INTERSECTS may be returned for boxes close to the corners
+    /// of the region
+    inline REGION_INTERSECTION classify(const Aabb& box) const
+    {
+        const VectorType center = box.center();
+        const VectorType half   = box.sizes() / Scalar(2);
+        REGION_INTERSECTION result = REGION_INSIDE;
+        for(const auto& plane : m_planes)
+        {
+            const Scalar d = plane.signedDistance(center);
+            const Scalar r = plane.normal().cwiseAbs().dot(half);
+            if(d + r < Scalar(0)) return REGION_OUTSIDE;
+            if(d - r < Scalar(0)) result = REGION_INTERSECTS;
+        }
+        return result;
+    }
+
+private:
+    PlaneContainer m_planes;
+};
+
+/// \brief Cylinder of radius `radius` around the segment starting at `origin`, along `direction`, of length
+/// `length` (infinite by default, i.e. a ray)
+///
+/// Used to collect the points around a ray, e.g. for picking.
+template<typename DataPoint>
+struct RayRegion
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using Aabb       = Eigen::AlignedBox<Scalar, DataPoint::Dim>;
+
+    inline RayRegion() : RayRegion(VectorType::Zero(), VectorType::UnitX(), Scalar(0)) {}
+
+    /// \param direction Direction of the ray, normalized by the constructor
+    inline RayRegion(const VectorType& origin, const VectorType& direction, Scalar radius,
+                     Scalar length = std::numeric_limits<Scalar>::infinity()) :
+        m_origin(origin), m_direction(direction.normalized()), m_radius(radius), m_length(length) {}
+
+    inline const VectorType& origin() const { return m_origin; }
+    inline const VectorType& direction() const { return m_direction; }
+    inline Scalar radius() const { return m_radius; }
+    inline Scalar length() const { return m_length; }
+
+    /// \brief Abscissa of the projection of `p` on the axis of the ray
+    inline Scalar abscissa(const VectorType& p) const { return (p - m_origin).dot(m_direction); }
+
+    inline bool contains(const VectorType& p) const
+    {
+        const Scalar t = abscissa(p);
+        return t >= Scalar(0) && t <= m_length &&
+               (p - m_origin - t * m_direction).squaredNorm() <= m_radius * m_radius;
+    }
+
+    /// \brief Conservative position of `box`: the box is outside when the segment misses the box inflated by
+    /// the radius, inside when all its corners are in the cylinder
+    inline REGION_INTERSECTION classify(const Aabb& box) const
+    {
+        // slab clipping of the segment against the inflated box
+        Scalar tmin = Scalar(0), tmax = m_length;
+        for(int i = 0; i < DataPoint::Dim; ++i)
+        {
+            const Scalar lo = box.min()(i) - m_radius, hi = box.max()(i) + m_radius;
+            if(m_direction(i) == Scalar(0))
+            {
+                if(m_origin(i) < lo || m_origin(i) > hi) return REGION_OUTSIDE;
+                continue;
+            }
+            Scalar t0 = (lo - m_origin(i)) / m_direction(i), t1 = (hi - m_origin(i)) / m_direction(i);
+            if(t0 > t1) std::swap(t0, t1);
+            tmin = std::max(tmin, t0);
+            tmax = std::min(tmax, t1);
+            if(tmin > tmax) return REGION_OUTSIDE;
+        }
+
+        // the cylinder is convex: the box is inside when all its corners are
+        for(int corner = 0; corner < (1 << DataPoint::Dim); ++corner)
+        {
+            VectorType p;
+            for(int i = 0; i < DataPoint::Dim; ++i)
+                p(i) = (corner >> i) & 1 ? box.max()(i) : box.min()(i);
+            if(!contains(p)) return REGION_INTERSECTS;
+        }
+        return REGION_INSIDE;
+    }
+
+private:
+    VectorType m_origin;
+    VectorType m_direction;
+    Scalar     m_radius;
+    Scalar     m_length;
+};
+
+/// \brief Ellipsoid \f$ \{ \mathbf{p}, (\mathbf{p}-\mathbf{c})^T M (\mathbf{p}-\mathbf{c}) \leq r^2 \} \f$ of center
+/// \f$ \mathbf{c} \f$, symmetric positive definite metric \f$ M \f$ and radius \f$ r \f$
+///
+/// The metric is factorized once as \f$ M = U^T U \f$ (Cholesky), so that testing a point costs a triangular
+/// transform and a squared norm. Used to collect the support of an anisotropic weight function, see
+/// MahalanobisWeightFunc.
+template<typename DataPoint>
+struct EllipsoidRegion
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using MatrixType = Eigen::Matrix<Scalar, DataPoint::Dim, DataPoint::Dim>;
+    using Aabb       = Eigen::AlignedBox<Scalar, DataPoint::Dim>;
+
+    inline EllipsoidRegion() : EllipsoidRegion(VectorType::Zero(), MatrixType::Identity(), Scalar(0)) {}
+
+    /// \param metric Symmetric positive definite metric
+    inline EllipsoidRegion(const VectorType& center, const MatrixType& metric, Scalar radius) :
+        m_center(center), m_factor(metric.llt().matrixU()), m_radius(radius)
+    {
+        // the half extent along the axis i is r * sqrt((M^-1)_ii), the norm of the row i of U^-1, slightly
+        // inflated for the rounding errors not to prune the points on the boundary
+        const MatrixType inverse = m_factor.template triangularView<Eigen::Upper>().solve(MatrixType::Identity());
+        const VectorType extent = m_radius * (Scalar(1) + Eigen::NumTraits<Scalar>::dummy_precision()) *
+                                  inverse.rowwise().norm();
+        m_bounds = Aabb(m_center - extent, m_center + extent);
+    }
+
+    inline const VectorType& center() const { return m_center; }
+    /// \brief Upper triangular Cholesky factor \f$ U \f$ of the metric
+    inline const MatrixType& factor() const { return m_factor; }
+    inline MatrixType metric() const { return m_factor.transpose() * m_factor; }
+    inline Scalar radius() const { return m_radius; }
+    /// \brief Axis-aligned bounding box of the ellipsoid
+    inline const Aabb& bounds() const { return m_bounds; }
+
+    /// \brief Squared Mahalanobis distance \f$ (\mathbf{p}-\mathbf{c})^T M (\mathbf{p}-\mathbf{c}) \f$ of `p` to the center
+    inline Scalar squared_distance(const VectorType& p) const
+    {
+        return (m_factor.template triangularView<Eigen::Upper>() * (p - m_center)).squaredNorm();
+    }
+
+    inline bool contains(const VectorType& p) const { return squared_distance(p) <= m_radius * m_radius; }
+
+    /// \brief Conservative position of `box`: the box is outside when its bounding box in the frame where the
+    /// ellipsoid is a ball misses the ball, inside when all its corners are in the ellipsoid
+    inline REGION_INTERSECTION classify(const Aabb& box) const
+    {
+        if(!m_bounds.intersects(box)) return REGION_OUTSIDE;
+
+        // bounding box of U (box - c), distance to the ball of radius r
+        const VectorType center = m_factor * (box.center() - m_center);
+        const VectorType extent = m_factor.cwiseAbs() * (box.sizes() / Scalar(2));
+        const VectorType gap = (center.cwiseAbs() - extent).cwiseMax(Scalar(0));
+        if(gap.squaredNorm() > m_radius * m_radius) return REGION_OUTSIDE;
+
+        // the ellipsoid is convex: the box is inside when all its corners are
+        for(int corner = 0; corner < (1 << DataPoint::Dim); ++corner)
+        {
+            VectorType p;
+            for(int i = 0; i < DataPoint::Dim; ++i)
+                p(i) = (corner >> i) & 1 ? box.max()(i) : box.min()(i);
+            if(!contains(p)) return REGION_INTERSECTS;
+        }
+        return REGION_INSIDE;
+    }
+
+private:
+    VectorType m_center;
+    MatrixType m_factor;
+    Scalar     m_radius;
+    Aabb       m_bounds;
+};
+
+/// @}
+
+} // namespace Ponca
@@ -0,0 +1,90 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./regions.h"
+
+#include <Eigen/Core>
+
+#include <vector>
+
+namespace Ponca {
+
+/// \addtogroup spatialpartitioning
+/// @{
+
+/// \brief Weighted euclidean metric \f$ d(\mathbf{p},\mathbf{q})^2 = \sum_i w_i (p_i - q_i)^2 \f$ of a feature
+/// space, e.g. the joint position, normal and color of the points
+///
+/// The metric is the euclidean one after scaling the coordinate \f$ i \f$ by \f$ \sqrt{w_i} \f$ (transform()):
+/// a KdTree built over transform_points() answers all its queries (nearest, k-nearest, range, batches) in the
+/// weighted metric, for the query positions mapped by transform(), and returns the indices of the input points.
+/// Without rebuilding the tree, the range neighbors in the weighted metric are also given by
+/// KdTree::ellipsoid_neighbors(region()).
+///
+/// The fitting counterpart is `MahalanobisWeightFunc(t, metric.matrix())` on the input features, which weights
+/// the neighbors as `DistWeightFunc(t)` on the transformed ones: the support of the weight at the scale `t` is
+/// the range query of radius `t`.
+///
+/// \note The dimension of the feature spaces usually exceeds KdTreeNode::MAX_DIM: their trees use KdTreeWideNode
+/// (see KdTreeDefaultNode).
+template<typename DataPoint>
+struct WeightedMetric
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using MatrixType = Eigen::Matrix<Scalar, DataPoint::Dim, DataPoint::Dim>;
+
+    /// \brief Euclidean metric
+    inline WeightedMetric() : WeightedMetric(VectorType::Ones()) {}
+
+    /// \param weights Strictly positive weights of the coordinates
+    inline explicit WeightedMetric(const VectorType& weights) : m_weights(weights), m_scales(weights.cwiseSqrt()) {}
+
+    inline const VectorType& weights() const { return m_weights; }
+    /// \brief Scales \f$ \sqrt{w_i} \f$ applied to the coordinates by transform()
+    inline const VectorType& scales() const { return m_scales; }
+    /// \brief Diagonal metric matrix \f$ M = diag(w) \f$, see MahalanobisWeightFunc and EllipsoidRegion
+    inline MatrixType matrix() const { return MatrixType(m_weights.asDiagonal()); }
+
+    inline Scalar squared_distance(const VectorType& p, const VectorType& q) const
+    {
+        return m_weights.dot((p - q).cwiseAbs2());
+    }
+
+    /// \brief Position of `p` in the space where the metric is euclidean
+    inline VectorType transform(const VectorType& p) const { return m_scales.cwiseProduct(p); }
+    /// \brief Inverse of transform()
+    inline VectorType inverse_transform(const VectorType& p) const { return p.cwiseQuotient(m_scales); }
+
+    /// \brief Copies of `points` whose positions are mapped by transform(), to build a KdTree in the metric
+    ///
+    /// DataPoint must provide a mutable `pos()`.
+    template<typename PointUserContainer>
+    inline std::vector<DataPoint> transform_points(const PointUserContainer& points) const
+    {
+        std::vector<DataPoint> transformed(points.begin(), points.end());
+        for(DataPoint& p : transformed)
+            p.pos() = transform(p.pos());
+        return transformed;
+    }
+
+    /// \brief Ball of radius `radius` of the metric centered on `center`, for KdTree::ellipsoid_neighbors
+    inline EllipsoidRegion<DataPoint> region(const VectorType& center, Scalar radius) const
+    {
+        return EllipsoidRegion<DataPoint>(center, matrix(), radius);
+    }
+
+private:
+    VectorType m_weights;
+    VectorType m_scales;
+};
+
+/// @}
+
+} // namespace Ponca
@@ -0,0 +1,140 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+ \file benchmarks/ponca_benchmark_fitting.cpp
+ \brief Benchmark of the fitting procedures and extensions, over neighborhood sizes and scalar types
+
+ Each benchmark fits a Basket to a neighborhood of n points, from 16 to 10k, sampling a cap of a sphere around
+ the evaluation point, all the points being inside the support of the weight function. The counters report the
+ fits per second and the time per neighbor, the multi-pass fits (e.g. MongePatch) counting all their passes.
+ */
+
+#include "../tests/common/testUtils.h"
+
+#include <Ponca/src/Fitting/sphereFit.h>
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+using namespace Ponca;
+
+template<typename Scalar>
+using Point = PointPositionNormal<Scalar, 3>;
+template<typename Scalar>
+using WeightFunc = DistWeightFunc<Point<Scalar>, SmoothWeightKernel<Scalar> >;
+
+// Baskets of the tests
+template<typename Scalar> using CovariancePlane      = Basket<Point<Scalar>, WeightFunc<Scalar>, CovariancePlaneFit>;
+template<typename Scalar> using MeanPlane            = Basket<Point<Scalar>, WeightFunc<Scalar>, MeanPlaneFit>;
+template<typename Scalar> using OrientedSphere       = Basket<Point<Scalar>, WeightFunc<Scalar>, OrientedSphereFit>;
+template<typename Scalar> using UnorientedSphere     = Basket<Point<Scalar>, WeightFunc<Scalar>, UnorientedSphereFit>;
+template<typename Scalar> using Sphere               = Basket<Point<Scalar>, WeightFunc<Scalar>, SphereFit>;
+template<typename Scalar> using CovarianceLine       = Basket<Point<Scalar>, WeightFunc<Scalar>, CovarianceLineFit>;
+template<typename Scalar> using Monge                = Basket<Point<Scalar>, WeightFunc<Scalar>, CovariancePlaneFit, MongePatch>;
+template<typename Scalar> using Gls                  = Basket<Point<Scalar>, WeightFunc<Scalar>, OrientedSphereFit, GLSParam>;
+template<typename Scalar> using GlsDer               = Basket<Point<Scalar>, WeightFunc<Scalar>, OrientedSphereFit, GLSParam,
+                                                              OrientedSphereScaleSpaceDer, GLSDer>;
+template<typename Scalar> using MlsSphereDer         = Basket<Point<Scalar>, WeightFunc<Scalar>, OrientedSphereFit,
+                                                              OrientedSphereSpaceDer, MlsSphereFitDer>;
+template<typename Scalar> using Curvature            = Basket<Point<Scalar>, WeightFunc<Scalar>, OrientedSphereFit, GLSParam,
+                                                              OrientedSphereSpaceDer, CurvatureEstimator>;
+template<typename Scalar> using NormalCovariance     = Basket<Point<Scalar>, WeightFunc<Scalar>, CovariancePlaneFit,
+                                                              NormalCovarianceCurvature>;
+template<typename Scalar> using ProjectedNormalCovariance = Basket<Point<Scalar>, WeightFunc<Scalar>, CovariancePlaneFit,
+                                                                   ProjectedNormalCovarianceCurvature>;
+
+// Degrees of the smooth kernel, to compare with CovariancePlane using the default degree 2
+template<typename Scalar, int Degree>
+using SmoothDegreePlane = Basket<Point<Scalar>, DistWeightFunc<Point<Scalar>, SmoothWeightKernel<Scalar, Degree> >,
+                                 CovariancePlaneFit>;
+template<typename Scalar> using SmoothDegree3Plane = SmoothDegreePlane<Scalar, 3>;
+template<typename Scalar> using SmoothDegree4Plane = SmoothDegreePlane<Scalar, 4>;
+
+/// Neighborhood of `n` points on the cap of the unit sphere of angle pi/3 around the evaluation point (0,0,1),
+/// generated once and shared by the benchmarks
+template<typename Scalar>
+const std::vector<Point<Scalar>>& neighborhood(int n)
+{
+    using VectorType = typename Point<Scalar>::VectorType;
+    static std::map<int, std::unique_ptr<std::vector<Point<Scalar>>>> neighborhoods;
+    auto& points = neighborhoods[n];
+    if (!points)
+    {
+        points.reset(new std::vector<Point<Scalar>>());
+        points->reserve(n);
+        std::mt19937 gen(0);
+        std::normal_distribution<Scalar> normal(Scalar(0), Scalar(1));
+        while (int(points->size()) < n)
+        {
+            const VectorType v = VectorType(normal(gen), normal(gen), normal(gen)).normalized();
+            if (v.z() > Scalar(0.5))
+                points->emplace_back(v, v);
+        }
+    }
+    return *points;
+}
+
+template<typename Fit>
+void BM_Fit(benchmark::State& state)
+{
+    using Scalar = typename Fit::Scalar;
+    using VectorType = typename Fit::VectorType;
+    const std::vector<Point<Scalar>>& points = neighborhood<Scalar>(int(state.range(0)));
+    const VectorType evaluation(Scalar(0), Scalar(0), Scalar(1));
+
+    for (auto _ : state)
+    {
+        Fit fit;
+        fit.setWeightFunc(typename Fit::WeightFunction(Scalar(1.01)));
+        fit.init(evaluation);
+        benchmark::DoNotOptimize(fit.compute(points.cbegin(), points.cend()));
+        benchmark::DoNotOptimize(fit);
+    }
+    state.counters["fits/s"] = benchmark::Counter(1., benchmark::Counter::kIsIterationInvariantRate);
+    // inverted rate of neighbors per second: seconds per neighbor, printed in nanoseconds
+    state.counters["time/neighbor"] = benchmark::Counter(double(points.size()),
+                                                         benchmark::Counter::kIsIterationInvariantRate |
+                                                         benchmark::Counter::kInvert);
+    state.counters["bytes"] = benchmark::Counter(double(FitFootprint<Fit>::size));
+}
+
+void neighborhoodSizes(benchmark::internal::Benchmark* b)
+{
+    for (int n : {16, 64, 256, 1024, 4096, 10000})
+        b->Arg(n);
+}
+
+} // namespace
+
+#define PONCA_BENCHMARK_FIT(Fit) \
+    BENCHMARK_TEMPLATE(BM_Fit, Fit<float>)->Apply(neighborhoodSizes); \
+    BENCHMARK_TEMPLATE(BM_Fit, Fit<double>)->Apply(neighborhoodSizes)
+
+PONCA_BENCHMARK_FIT(CovariancePlane);
+PONCA_BENCHMARK_FIT(MeanPlane);
+PONCA_BENCHMARK_FIT(OrientedSphere);
+PONCA_BENCHMARK_FIT(UnorientedSphere);
+PONCA_BENCHMARK_FIT(Sphere);
+PONCA_BENCHMARK_FIT(CovarianceLine);
+PONCA_BENCHMARK_FIT(Monge);
+PONCA_BENCHMARK_FIT(Gls);
+PONCA_BENCHMARK_FIT(GlsDer);
+PONCA_BENCHMARK_FIT(MlsSphereDer);
+PONCA_BENCHMARK_FIT(Curvature);
+PONCA_BENCHMARK_FIT(NormalCovariance);
+PONCA_BENCHMARK_FIT(ProjectedNormalCovariance);
+PONCA_BENCHMARK_FIT(SmoothDegree3Plane);
+PONCA_BENCHMARK_FIT(SmoothDegree4Plane);
+
+BENCHMARK_MAIN();
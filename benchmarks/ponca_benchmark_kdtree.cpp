@@ -0,0 +1,366 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+ \file benchmarks/ponca_benchmark_kdtree.cpp
+ \brief Benchmark of the KdTree construction and queries, over several point distributions
+
+ Run e.g. `ponca_benchmark_kdtree --benchmark_filter=KNearest` to select the benchmarks. The largest clouds of the
+ build benchmark are bounded by PONCA_BENCHMARK_MAX_POINTS.
+ */
+
+#include <Ponca/src/Common/IO/pointCloudFile.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTreeNormalOrientation.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTreeRegistration.h>
+
+#include "../tests/common/has_duplicate.h"
+#include "../tests/common/kdtree_utils.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef PONCA_BENCHMARK_MAX_POINTS
+#define PONCA_BENCHMARK_MAX_POINTS 100000000
+#endif
+
+namespace
+{
+
+using Point = TestPoint<float, 3>;
+using Scalar = Point::Scalar;
+using VectorType = Point::VectorType;
+using Tree = Ponca::KdTree<Point>;
+
+enum Distribution { UNIFORM, CLUSTERED, SURFACE, NOISY_SURFACE, LIDAR, MULTISCALE, DUPLICATED, BUNNY };
+
+constexpr int QueryPointCount = 100000;
+constexpr int QueryCount = 10000;
+
+/// Cloud of `n` points of the distribution, generated once and shared by the benchmarks
+const std::vector<Point>& cloud(Distribution distribution, int n)
+{
+    static std::map<std::pair<int, int>, std::unique_ptr<std::vector<Point>>> clouds;
+    auto& points = clouds[{int(distribution), n}];
+    if (!points)
+    {
+        switch (distribution)
+        {
+        case UNIFORM:   points.reset(new std::vector<Point>(generate_uniform_cloud<Point>(n))); break;
+        case CLUSTERED: points.reset(new std::vector<Point>(generate_clustered_cloud<Point>(n))); break;
+        case SURFACE:   points.reset(new std::vector<Point>(generate_surface_cloud<Point>(n))); break;
+        case NOISY_SURFACE:
+        {
+            // paraboloid sampled 20 times denser on one side, with 1% of outliers
+            surface_generator<Point> generator;
+            generator.shape = SURFACE_PARABOLOID;
+            generator.options.noise = 0.005;
+            generator.options.outlier_ratio = 0.01;
+            generator.options.density_gradient = 3.;
+            points.reset(new std::vector<Point>(generate_cloud<Point>(generator, n)));
+            break;
+        }
+        case LIDAR:
+            points.reset(new std::vector<Point>(generate_cloud<Point>(lidar_generator<Point>(), n)));
+            break;
+        case MULTISCALE:
+            points.reset(new std::vector<Point>(generate_cloud<Point>(multiscale_cluster_generator<Point>(), n)));
+            break;
+        case DUPLICATED:
+        {
+            // half of the points are copies of 16 positions, as the merged scans of static scenes
+            points.reset(new std::vector<Point>(generate_uniform_cloud<Point>(n)));
+            for (int i = n / 2; i < n; ++i)
+                (*points)[i] = (*points)[i % 16];
+            break;
+        }
+        case BUNNY:
+        {
+            points.reset(new std::vector<Point>());
+            Ponca::PointCloudFile file;
+            if (file.open("bun_zipper.ply"))
+            {
+                points->resize(file.point_count());
+                file.read(points->data());
+            }
+            break;
+        }
+        }
+    }
+    return *points;
+}
+
+/// Cloud of the query benchmarks: QueryPointCount points, or the bunny
+const std::vector<Point>& queryCloud(Distribution distribution, benchmark::State& state)
+{
+    const std::vector<Point>& points = cloud(distribution, distribution == BUNNY ? 0 : QueryPointCount);
+    if (points.empty())
+        state.SkipWithError("cannot read bun_zipper.ply");
+    return points;
+}
+
+/// Radius of the balls holding `k` points on average, for `n` points spread uniformly in the box of `points`
+Scalar radiusForNeighbors(const std::vector<Point>& points, int k)
+{
+    Eigen::AlignedBox<Scalar, 3> box;
+    for (const auto& p : points) box.extend(p.pos());
+    return std::cbrt(Scalar(3) * Scalar(k) * box.volume() / (Scalar(4 * M_PI) * Scalar(points.size())));
+}
+
+void BM_Build(benchmark::State& state, Distribution distribution)
+{
+    const std::vector<Point>& points = cloud(distribution, int(state.range(0)));
+    for (auto _ : state)
+    {
+        Tree tree(points);
+        benchmark::DoNotOptimize(tree.node_count());
+    }
+    state.counters["points/s"] = benchmark::Counter(double(points.size()), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void BM_BuildBunny(benchmark::State& state)
+{
+    const std::vector<Point>& points = queryCloud(BUNNY, state);
+    for (auto _ : state)
+    {
+        Tree tree(points);
+        benchmark::DoNotOptimize(tree.node_count());
+    }
+    state.counters["points/s"] = benchmark::Counter(double(points.size()), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void BM_KNearest(benchmark::State& state, Distribution distribution)
+{
+    const std::vector<Point>& points = queryCloud(distribution, state);
+    if (points.empty()) return;
+    const Tree tree(points);
+    const int k = int(state.range(0));
+    const int step = std::max(1, int(points.size()) / QueryCount);
+
+    for (auto _ : state)
+    {
+        std::size_t checksum = 0;
+        for (int i = 0; i < int(points.size()); i += step)
+            for (int j : tree.k_nearest_neighbors(i, k))
+                checksum += std::size_t(j);
+        benchmark::DoNotOptimize(checksum);
+    }
+    state.counters["queries/s"] = benchmark::Counter(double((points.size() + step - 1) / step),
+                                                     benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void BM_Range(benchmark::State& state, Distribution distribution)
+{
+    const std::vector<Point>& points = queryCloud(distribution, state);
+    if (points.empty()) return;
+    const Tree tree(points);
+    // the radius holds range(0) neighbors on average over the bounding box
+    const Scalar r = radiusForNeighbors(points, int(state.range(0)));
+    const int step = std::max(1, int(points.size()) / QueryCount);
+
+    std::size_t neighbors = 0;
+    for (auto _ : state)
+    {
+        neighbors = 0;
+        for (int i = 0; i < int(points.size()); i += step)
+            for (int j : tree.range_neighbors(i, r))
+            {
+                benchmark::DoNotOptimize(j);
+                ++neighbors;
+            }
+    }
+    const double queries = double((points.size() + step - 1) / step);
+    state.counters["queries/s"] = benchmark::Counter(queries, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["neighbors"] = double(neighbors) / queries;
+}
+
+void BM_OrientNormals(benchmark::State& state)
+{
+    // unit sphere, with randomly flipped normals
+    surface_generator<Point> generator;
+    const std::vector<Point> points = generate_cloud<Point>(generator, int(state.range(0)));
+    std::vector<VectorType> flipped(points.size());
+    for (std::size_t i = 0; i < points.size(); ++i)
+        flipped[i] = Eigen::internal::random<int>(0, 1) == 0 ? VectorType(points[i].pos()) : VectorType(-points[i].pos());
+    const Tree tree(points);
+
+    std::vector<VectorType> normals;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        normals = flipped;
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(Ponca::orient_normals(tree, 16, normals));
+    }
+    state.counters["points/s"] = benchmark::Counter(double(points.size()), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void BM_Icp(benchmark::State& state, Ponca::ICP_METRIC metric)
+{
+    // height field without symmetry, and the same points moved by a small motion
+    const int n = int(state.range(0));
+    std::vector<Point> points(n);
+    std::vector<VectorType> normals(n), frame(n);
+    Eigen::Transform<Scalar, 3, Eigen::Isometry> motion = Eigen::Transform<Scalar, 3, Eigen::Isometry>::Identity();
+    motion.linear() = Eigen::AngleAxis<Scalar>(Scalar(0.05), VectorType(1, 2, 3).normalized()).toRotationMatrix();
+    motion.translation() = VectorType::Constant(Scalar(0.01));
+    for (int i = 0; i < n; ++i)
+    {
+        const Scalar x = Eigen::internal::random<Scalar>(-1, 1), y = Eigen::internal::random<Scalar>(-1, 1);
+        points[i] = Point(VectorType(x, y, Scalar(0.3) * std::sin(3 * x) * std::cos(2 * y) + Scalar(0.2) * x * x));
+        normals[i] = VectorType(-Scalar(0.9) * std::cos(3 * x) * std::cos(2 * y) - Scalar(0.4) * x,
+                                Scalar(0.6) * std::sin(3 * x) * std::sin(2 * y), 1).normalized();
+        frame[i] = motion * points[i].pos();
+    }
+    const Tree tree(points);
+    Ponca::IcpRegistration<Point> icp(tree, normals);
+
+    Ponca::IcpParameters<Scalar> parameters;
+    parameters.metric = metric;
+    parameters.max_distance = Scalar(0.05);
+    int iterations = 0;
+    for (auto _ : state)
+    {
+        const auto result = icp.align(frame, Eigen::Transform<Scalar, 3, Eigen::Isometry>::Identity(), parameters);
+        iterations += result.iterations;
+        benchmark::DoNotOptimize(result.transform);
+    }
+    state.counters["iterations"] = benchmark::Counter(double(iterations), benchmark::Counter::kAvgIterations);
+}
+
+using Point2 = TestPoint<float, 2>;
+using VectorType2 = Point2::VectorType;
+using Tree2 = Ponca::KdTree<Point2>;
+
+/// Jittered pixel centers of a square image of about `n` pixels, as the samples of a depth map
+const std::vector<Point2>& pixelCloud(int n)
+{
+    static std::map<int, std::unique_ptr<std::vector<Point2>>> clouds;
+    auto& points = clouds[n];
+    if (!points)
+    {
+        const int width = std::max(1, int(std::sqrt(double(n))));
+        const Scalar step = Scalar(2) / Scalar(width);
+        points.reset(new std::vector<Point2>());
+        points->reserve(std::size_t(width) * width);
+        for (int y = 0; y < width; ++y)
+            for (int x = 0; x < width; ++x)
+                points->push_back(Point2(VectorType2(-1 + (x + Scalar(0.5)) * step, -1 + (y + Scalar(0.5)) * step) +
+                                         Scalar(0.25) * step * VectorType2::Random()));
+    }
+    return *points;
+}
+
+void BM_Build2d(benchmark::State& state, Ponca::KDTREE_SPLIT_STRATEGY strategy)
+{
+    const std::vector<Point2>& points = pixelCloud(int(state.range(0)));
+    for (auto _ : state)
+    {
+        Tree2 tree;
+        tree.set_split_strategy(strategy);
+        tree.build(points);
+        benchmark::DoNotOptimize(tree.node_count());
+    }
+    state.counters["points/s"] = benchmark::Counter(double(points.size()), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void BM_KNearest2d(benchmark::State& state)
+{
+    const std::vector<Point2>& points = pixelCloud(QueryPointCount);
+    const Tree2 tree(points);
+    const int k = int(state.range(0));
+    const int step = std::max(1, int(points.size()) / QueryCount);
+
+    for (auto _ : state)
+    {
+        std::size_t checksum = 0;
+        for (int i = 0; i < int(points.size()); i += step)
+            for (int j : tree.k_nearest_neighbors(i, k))
+                checksum += std::size_t(j);
+        benchmark::DoNotOptimize(checksum);
+    }
+    state.counters["queries/s"] = benchmark::Counter(double((points.size() + step - 1) / step),
+                                                     benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void BM_Range2d(benchmark::State& state)
+{
+    const std::vector<Point2>& points = pixelCloud(QueryPointCount);
+    const Tree2 tree(points);
+    // the disks hold range(0) neighbors on average over [-1,1]^2
+    const Scalar r = std::sqrt(Scalar(4) * Scalar(state.range(0)) / (Scalar(M_PI) * Scalar(points.size())));
+    const int step = std::max(1, int(points.size()) / QueryCount);
+
+    std::size_t neighbors = 0;
+    for (auto _ : state)
+    {
+        neighbors = 0;
+        for (int i = 0; i < int(points.size()); i += step)
+            for (int j : tree.range_neighbors(i, r))
+            {
+                benchmark::DoNotOptimize(j);
+                ++neighbors;
+            }
+    }
+    const double queries = double((points.size() + step - 1) / step);
+    state.counters["queries/s"] = benchmark::Counter(queries, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["neighbors"] = double(neighbors) / queries;
+}
+
+void buildSizes(benchmark::internal::Benchmark* b)
+{
+    for (long n = 10000; n <= long(PONCA_BENCHMARK_MAX_POINTS); n *= 10)
+        b->Arg(n);
+    b->Unit(benchmark::kMillisecond);
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_Build, uniform,   UNIFORM)->Apply(buildSizes);
+BENCHMARK_CAPTURE(BM_Build, clustered, CLUSTERED)->Apply(buildSizes);
+BENCHMARK_CAPTURE(BM_Build, surface,   SURFACE)->Apply(buildSizes);
+BENCHMARK_CAPTURE(BM_Build, noisy_surface, NOISY_SURFACE)->Apply(buildSizes);
+BENCHMARK_CAPTURE(BM_Build, lidar,     LIDAR)->Apply(buildSizes);
+BENCHMARK_CAPTURE(BM_Build, multiscale, MULTISCALE)->Apply(buildSizes);
+BENCHMARK_CAPTURE(BM_Build, duplicated, DUPLICATED)->Apply(buildSizes);
+BENCHMARK(BM_BuildBunny)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_CAPTURE(BM_KNearest, uniform,   UNIFORM)->Arg(1)->Arg(8)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_KNearest, clustered, CLUSTERED)->Arg(1)->Arg(8)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_KNearest, surface,   SURFACE)->Arg(1)->Arg(8)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_KNearest, noisy_surface, NOISY_SURFACE)->Arg(1)->Arg(8)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_KNearest, lidar,     LIDAR)->Arg(1)->Arg(8)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_KNearest, multiscale, MULTISCALE)->Arg(1)->Arg(8)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_KNearest, duplicated, DUPLICATED)->Arg(1)->Arg(8)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_KNearest, bunny,     BUNNY)->Arg(1)->Arg(8)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_CAPTURE(BM_Range, uniform,   UNIFORM)->Arg(8)->Arg(32)->Arg(128)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Range, clustered, CLUSTERED)->Arg(8)->Arg(32)->Arg(128)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Range, surface,   SURFACE)->Arg(8)->Arg(32)->Arg(128)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Range, noisy_surface, NOISY_SURFACE)->Arg(8)->Arg(32)->Arg(128)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Range, lidar,     LIDAR)->Arg(8)->Arg(32)->Arg(128)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Range, multiscale, MULTISCALE)->Arg(8)->Arg(32)->Arg(128)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Range, bunny,     BUNNY)->Arg(8)->Arg(32)->Arg(128)->Unit(benchmark::kMillisecond);
+
+// 2D image space and depth map samples, to compare with the uniform 3D clouds
+BENCHMARK_CAPTURE(BM_Build2d, midpoint, Ponca::SPLIT_MIDPOINT)->Apply(buildSizes);
+BENCHMARK_CAPTURE(BM_Build2d, morton,   Ponca::SPLIT_MORTON)->Apply(buildSizes);
+BENCHMARK(BM_KNearest2d)->Arg(1)->Arg(8)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Range2d)->Arg(8)->Arg(32)->Arg(128)->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_OrientNormals)->Arg(100000)->Arg(1000000)->Arg(10000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(BM_Icp, point_to_point, Ponca::ICP_POINT_TO_POINT)->Arg(100000)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Icp, point_to_plane, Ponca::ICP_POINT_TO_PLANE)->Arg(100000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,337 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+ \file benchmarks/ponca_benchmark_kdtree_libraries.cpp
+ \brief Comparison of the build and query costs of Ponca KdTree, nanoflann and PCL KdTreeFLANN
+
+ The libraries index the same clouds and answer the same queries, by position, one at a time: k-nearest neighbors
+ for several k, and range queries holding 32 neighbors on average. nanoflann (>= 1.5) and PCL are optional: their
+ benchmarks are compiled when PONCA_BENCHMARK_HAS_NANOFLANN and PONCA_BENCHMARK_HAS_PCL are defined, by the build
+ when it finds them. Each library uses its default leaf size.
+
+ Run e.g. `ponca_benchmark_kdtree_libraries --benchmark_filter=KNearest.+bunny` to compare the libraries on the
+ bunny. The largest clouds of the build benchmark are bounded by PONCA_BENCHMARK_MAX_POINTS.
+ */
+
+#include <Ponca/src/Common/IO/pointCloudFile.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include "../tests/common/has_duplicate.h"
+#include "../tests/common/kdtree_utils.h"
+
+#ifdef PONCA_BENCHMARK_HAS_NANOFLANN
+#include <nanoflann.hpp>
+#endif
+#ifdef PONCA_BENCHMARK_HAS_PCL
+#include <pcl/kdtree/kdtree_flann.h>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef PONCA_BENCHMARK_MAX_POINTS
+#define PONCA_BENCHMARK_MAX_POINTS 100000000
+#endif
+
+namespace
+{
+
+using Point = TestPoint<float, 3>;
+using Scalar = Point::Scalar;
+using VectorType = Point::VectorType;
+
+enum Distribution { UNIFORM, CLUSTERED, SURFACE, LIDAR, BUNNY };
+const char* distributionNames[] = {"uniform", "clustered", "surface", "lidar", "bunny"};
+
+constexpr int QueryPointCount = 100000;
+constexpr int QueryCount = 10000;
+
+/// Cloud of `n` points of the distribution, generated once and shared by the benchmarks
+const std::vector<Point>& cloud(Distribution distribution, int n)
+{
+    static std::map<std::pair<int, int>, std::unique_ptr<std::vector<Point>>> clouds;
+    auto& points = clouds[{int(distribution), n}];
+    if (!points)
+    {
+        switch (distribution)
+        {
+        case UNIFORM:   points.reset(new std::vector<Point>(generate_uniform_cloud<Point>(n))); break;
+        case CLUSTERED: points.reset(new std::vector<Point>(generate_clustered_cloud<Point>(n))); break;
+        case SURFACE:   points.reset(new std::vector<Point>(generate_surface_cloud<Point>(n))); break;
+        case LIDAR:     points.reset(new std::vector<Point>(generate_cloud<Point>(lidar_generator<Point>(), n))); break;
+        case BUNNY:
+        {
+            points.reset(new std::vector<Point>());
+            Ponca::PointCloudFile file;
+            if (file.open("bun_zipper.ply"))
+            {
+                points->resize(file.point_count());
+                file.read(points->data());
+            }
+            break;
+        }
+        }
+    }
+    return *points;
+}
+
+/// Radius of the balls holding `k` points on average, for `n` points spread uniformly in the box of `points`
+Scalar radiusForNeighbors(const std::vector<Point>& points, int k)
+{
+    Eigen::AlignedBox<Scalar, 3> box;
+    for (const auto& p : points) box.extend(p.pos());
+    return std::cbrt(Scalar(3) * Scalar(k) * box.volume() / (Scalar(4 * M_PI) * Scalar(points.size())));
+}
+
+// Libraries ----------------------------------------------------------------------------------------------------------
+// Each library provides a Tree built from the points, and the k-nearest and range queries by position, returning a
+// checksum of the indices so that the queries cannot be optimized out.
+
+struct PoncaKdTree
+{
+    static constexpr const char* name = "ponca";
+    using Tree = ::Ponca::KdTree<Point>;
+
+    struct Index
+    {
+        Tree tree;
+        explicit Index(const std::vector<Point>& points) : tree(points) {}
+    };
+
+    static std::size_t kNearest(const Index& index, const VectorType& query, int k)
+    {
+        std::size_t checksum = 0;
+        for (int j : index.tree.k_nearest_neighbors(query, k))
+            checksum += std::size_t(j);
+        return checksum;
+    }
+
+    static std::size_t range(const Index& index, const VectorType& query, Scalar r)
+    {
+        std::size_t count = 0;
+        for (int j : index.tree.range_neighbors(query, r))
+        {
+            benchmark::DoNotOptimize(j);
+            ++count;
+        }
+        return count;
+    }
+};
+
+#ifdef PONCA_BENCHMARK_HAS_NANOFLANN
+struct Nanoflann
+{
+    static constexpr const char* name = "nanoflann";
+
+    /// Dataset adaptor of nanoflann reading the points in place
+    struct Adaptor
+    {
+        const std::vector<Point>& points;
+        inline std::size_t kdtree_get_point_count() const { return points.size(); }
+        inline Scalar kdtree_get_pt(std::size_t i, std::size_t d) const { return points[i].pos()[d]; }
+        template<class Box> bool kdtree_get_bbox(Box&) const { return false; }
+    };
+    using Tree = nanoflann::KDTreeSingleIndexAdaptor<nanoflann::L2_Simple_Adaptor<Scalar, Adaptor>, Adaptor, 3>;
+
+    struct Index
+    {
+        Adaptor adaptor;
+        Tree tree;
+        explicit Index(const std::vector<Point>& points) : adaptor{points}, tree(3, adaptor) {}
+    };
+
+    static std::size_t kNearest(const Index& index, const VectorType& query, int k)
+    {
+        thread_local std::vector<typename Tree::IndexType> indices;
+        thread_local std::vector<Scalar> distances;
+        indices.resize(k);
+        distances.resize(k);
+        const std::size_t found = index.tree.knnSearch(query.data(), std::size_t(k), indices.data(), distances.data());
+        std::size_t checksum = 0;
+        for (std::size_t j = 0; j < found; ++j)
+            checksum += std::size_t(indices[j]);
+        return checksum;
+    }
+
+    static std::size_t range(const Index& index, const VectorType& query, Scalar r)
+    {
+        thread_local std::vector<nanoflann::ResultItem<typename Tree::IndexType, Scalar>> results;
+        results.clear();
+        // the L2 adaptors compare squared distances
+        return index.tree.radiusSearch(query.data(), r * r, results);
+    }
+};
+#endif
+
+#ifdef PONCA_BENCHMARK_HAS_PCL
+struct Pcl
+{
+    static constexpr const char* name = "pcl";
+
+    struct Index
+    {
+        pcl::PointCloud<pcl::PointXYZ>::Ptr cloud {new pcl::PointCloud<pcl::PointXYZ>};
+        pcl::KdTreeFLANN<pcl::PointXYZ> tree;
+        explicit Index(const std::vector<Point>& points)
+        {
+            cloud->resize(points.size());
+            for (std::size_t i = 0; i < points.size(); ++i)
+                (*cloud)[i] = pcl::PointXYZ(points[i].pos().x(), points[i].pos().y(), points[i].pos().z());
+            tree.setInputCloud(cloud);
+        }
+    };
+
+    static std::size_t kNearest(const Index& index, const VectorType& query, int k)
+    {
+        thread_local std::vector<int> indices;
+        thread_local std::vector<float> distances;
+        const int found = index.tree.nearestKSearch(pcl::PointXYZ(query.x(), query.y(), query.z()), k,
+                                                    indices, distances);
+        std::size_t checksum = 0;
+        for (int j = 0; j < found; ++j)
+            checksum += std::size_t(indices[j]);
+        return checksum;
+    }
+
+    static std::size_t range(const Index& index, const VectorType& query, Scalar r)
+    {
+        thread_local std::vector<int> indices;
+        thread_local std::vector<float> distances;
+        return std::size_t(index.tree.radiusSearch(pcl::PointXYZ(query.x(), query.y(), query.z()), r,
+                                                   indices, distances));
+    }
+};
+#endif
+
+// Benchmarks ---------------------------------------------------------------------------------------------------------
+
+/// Build time, converting the points to the format of the library when it has one (PCL)
+template<typename Library>
+void BM_Build(benchmark::State& state, Distribution distribution)
+{
+    const std::vector<Point>& points = cloud(distribution, int(state.range(0)));
+    if (points.empty())
+    {
+        state.SkipWithError("cannot read bun_zipper.ply");
+        return;
+    }
+    for (auto _ : state)
+    {
+        typename Library::Index index(points);
+        benchmark::DoNotOptimize(index);
+    }
+    state.counters["points/s"] = benchmark::Counter(double(points.size()), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+/// Query points of the cloud: every step-th point, slightly moved so that it is not one of the indexed points
+std::vector<VectorType> queries(const std::vector<Point>& points)
+{
+    const int step = std::max(1, int(points.size()) / QueryCount);
+    std::vector<VectorType> result;
+    for (int i = 0; i < int(points.size()); i += step)
+        result.push_back(points[i].pos() + VectorType::Constant(Scalar(1e-4)));
+    return result;
+}
+
+template<typename Library>
+void BM_KNearest(benchmark::State& state, Distribution distribution)
+{
+    const std::vector<Point>& points = cloud(distribution, distribution == BUNNY ? 0 : QueryPointCount);
+    if (points.empty())
+    {
+        state.SkipWithError("cannot read bun_zipper.ply");
+        return;
+    }
+    const typename Library::Index index(points);
+    const std::vector<VectorType> queryPoints = queries(points);
+    const int k = int(state.range(0));
+
+    for (auto _ : state)
+    {
+        std::size_t checksum = 0;
+        for (const VectorType& q : queryPoints)
+            checksum += Library::kNearest(index, q, k);
+        benchmark::DoNotOptimize(checksum);
+    }
+    state.counters["queries/s"] = benchmark::Counter(double(queryPoints.size()),
+                                                     benchmark::Counter::kIsIterationInvariantRate);
+}
+
+template<typename Library>
+void BM_Range(benchmark::State& state, Distribution distribution)
+{
+    const std::vector<Point>& points = cloud(distribution, distribution == BUNNY ? 0 : QueryPointCount);
+    if (points.empty())
+    {
+        state.SkipWithError("cannot read bun_zipper.ply");
+        return;
+    }
+    const typename Library::Index index(points);
+    const std::vector<VectorType> queryPoints = queries(points);
+    const Scalar r = radiusForNeighbors(points, int(state.range(0)));
+
+    std::size_t neighbors = 0;
+    for (auto _ : state)
+    {
+        neighbors = 0;
+        for (const VectorType& q : queryPoints)
+            neighbors += Library::range(index, q, r);
+    }
+    const double count = double(queryPoints.size());
+    state.counters["queries/s"] = benchmark::Counter(count, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["neighbors"] = double(neighbors) / count;
+}
+
+/// Register the benchmarks of `Library`, named `<benchmark>/<library>/<distribution>`
+template<typename Library>
+void registerLibrary()
+{
+    for (Distribution d : {UNIFORM, CLUSTERED, SURFACE, LIDAR, BUNNY})
+    {
+        const std::string suffix = std::string("/") + Library::name + "/" + distributionNames[d];
+        auto* build = benchmark::RegisterBenchmark(("BM_Build" + suffix).c_str(), BM_Build<Library>, d);
+        if (d == BUNNY)
+            build->Arg(0);
+        else
+            for (long n = 10000; n <= long(PONCA_BENCHMARK_MAX_POINTS); n *= 10)
+                build->Arg(n);
+        build->Unit(benchmark::kMillisecond);
+
+        benchmark::RegisterBenchmark(("BM_KNearest" + suffix).c_str(), BM_KNearest<Library>, d)
+            ->Arg(1)->Arg(8)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("BM_Range" + suffix).c_str(), BM_Range<Library>, d)
+            ->Arg(32)->Unit(benchmark::kMillisecond);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    registerLibrary<PoncaKdTree>();
+#ifdef PONCA_BENCHMARK_HAS_NANOFLANN
+    registerLibrary<Nanoflann>();
+#endif
+#ifdef PONCA_BENCHMARK_HAS_PCL
+    registerLibrary<Pcl>();
+#endif
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+ \file benchmarks/ponca_benchmark_kdtree_numa.cpp
+ \brief Scaling of the batched k-nearest neighbors queries with the number of threads, for each NUMA placement
+
+ A tree of 10M points, larger than the caches, answers 1M queries with 1 to 128 OpenMP threads, used in place
+ (KdTree::k_nearest_neighbors_batch), or through KdTreeNumaReplicas with its pages interleaved over the nodes or
+ replicated on each node, the threads being pinned. The gains of the placements are only visible on machines with
+ several NUMA nodes; the thread counts above the number of CPUs oversubscribe them.
+
+ Run e.g. `ponca_benchmark_kdtree_numa --benchmark_filter=replicate` for a single placement. The cloud size is
+ bounded by PONCA_BENCHMARK_MAX_POINTS.
+ */
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTreeNuma.h>
+
+#include "../tests/common/has_duplicate.h"
+#include "../tests/common/kdtree_utils.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifndef PONCA_BENCHMARK_MAX_POINTS
+#define PONCA_BENCHMARK_MAX_POINTS 100000000
+#endif
+
+namespace
+{
+
+using Point = TestPoint<float, 3>;
+using Scalar = Point::Scalar;
+using VectorType = Point::VectorType;
+using Tree = Ponca::KdTree<Point>;
+
+constexpr int PointCount = std::min(10000000, PONCA_BENCHMARK_MAX_POINTS);
+constexpr int QueryCount = 1000000;
+constexpr int K = 16;
+
+/// Tree and queries, generated once and shared by the benchmarks
+const Tree& tree()
+{
+    static const std::unique_ptr<Tree> tree(new Tree(generate_uniform_cloud<Point>(PointCount)));
+    return *tree;
+}
+
+const std::vector<VectorType>& queries()
+{
+    static const std::vector<VectorType> queries = []() {
+        std::vector<VectorType> positions(QueryCount);
+        std::generate(positions.begin(), positions.end(), []() { return VectorType(VectorType::Random()); });
+        return positions;
+    }();
+    return queries;
+}
+
+void BM_KNearestBatch(benchmark::State& state, Ponca::KDTREE_NUMA_POLICY policy, bool placed)
+{
+    const int threads = int(state.range(0));
+#ifdef _OPENMP
+    const int previous = omp_get_max_threads();
+    omp_set_num_threads(threads);
+#else
+    if (threads > 1)
+    {
+        state.SkipWithError("OpenMP is required");
+        return;
+    }
+#endif
+    const std::unique_ptr<Ponca::KdTreeNumaReplicas<Point>> replicas(
+        placed ? new Ponca::KdTreeNumaReplicas<Point>(tree(), policy) : nullptr);
+
+    std::vector<int> indices(std::size_t(QueryCount) * K);
+    for (auto _ : state)
+    {
+        if (replicas)
+            replicas->k_nearest_neighbors_batch(queries(), K, indices.data());
+        else
+            tree().k_nearest_neighbors_batch(queries(), K, indices.data());
+        benchmark::DoNotOptimize(indices.data());
+    }
+    state.counters["queries/s"] = benchmark::Counter(double(QueryCount), benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["nodes"] = replicas ? replicas->topology().node_count() : 1;
+#ifdef _OPENMP
+    omp_set_num_threads(previous);
+#endif
+}
+
+void threadCounts(benchmark::internal::Benchmark* b)
+{
+    for (int threads = 1; threads <= 128; threads *= 2)
+        b->Arg(threads);
+    b->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_KNearestBatch, in_place,   Ponca::NUMA_NONE,       false)->Apply(threadCounts);
+BENCHMARK_CAPTURE(BM_KNearestBatch, pinned,     Ponca::NUMA_NONE,       true)->Apply(threadCounts);
+BENCHMARK_CAPTURE(BM_KNearestBatch, interleave, Ponca::NUMA_INTERLEAVE, true)->Apply(threadCounts);
+BENCHMARK_CAPTURE(BM_KNearestBatch, replicate,  Ponca::NUMA_REPLICATE,  true)->Apply(threadCounts);
+
+BENCHMARK_MAIN();
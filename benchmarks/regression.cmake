@@ -0,0 +1,165 @@
+################################################################################
+# Performance regression check                                                 #
+################################################################################
+#
+# Runs a short, fixed set of benchmarks, writes their median times in a JSON
+# file, and compares them against a stored baseline. Called by the
+# ponca-benchmark-regression and ponca-benchmark-baseline targets:
+#
+#   cmake -DBENCHMARKS="<exe>|<filter>;..." -DOUTPUT=<results.json>
+#         -DBASELINE=<baseline.json> -DTHRESHOLD=<percent>
+#         [-DREPETITIONS=<n>] [-DUPDATE_BASELINE=ON] -P regression.cmake
+#
+# A benchmark regresses when its median CPU time exceeds the baseline by more
+# than THRESHOLD percent. The check fails when at least one benchmark
+# regresses. With UPDATE_BASELINE, the results replace the baseline.
+#
+# The JSON files list {"name", "cpu_time", "time_unit"} entries, times being
+# in nanoseconds. CMake arithmetic being on integers, the times are compared in
+# picoseconds.
+
+cmake_minimum_required(VERSION 3.19) # string(JSON)
+
+if(NOT DEFINED REPETITIONS)
+    set(REPETITIONS 5)
+endif()
+if(NOT DEFINED THRESHOLD)
+    set(THRESHOLD 10)
+endif()
+
+# picoseconds of a decimal time in a unit of Google Benchmark (ns, us, ms, s)
+function(to_picoseconds time unit out)
+    if(unit STREQUAL "ns")
+        set(factor 1)
+    elseif(unit STREQUAL "us")
+        set(factor 1000)
+    elseif(unit STREQUAL "ms")
+        set(factor 1000000)
+    elseif(unit STREQUAL "s")
+        set(factor 1000000000)
+    else()
+        message(FATAL_ERROR "Unknown time unit: ${unit}")
+    endif()
+    if(NOT time MATCHES "^([0-9]+)(\\.([0-9]*))?$")
+        message(FATAL_ERROR "Unexpected time: ${time}")
+    endif()
+    set(integral ${CMAKE_MATCH_1})
+    # first three decimals
+    string(SUBSTRING "${CMAKE_MATCH_3}000" 0 3 decimals)
+    string(REGEX REPLACE "^0+([0-9])" "\\1" decimals "${decimals}")
+    math(EXPR ps "(${integral} * 1000 + ${decimals}) * ${factor}")
+    set(${out} ${ps} PARENT_SCOPE)
+endfunction()
+
+# decimal nanoseconds of picoseconds
+function(to_nanoseconds ps out)
+    math(EXPR integral "${ps} / 1000")
+    math(EXPR decimals "${ps} % 1000 + 1000")
+    string(SUBSTRING "${decimals}" 1 3 decimals)
+    set(${out} "${integral}.${decimals}" PARENT_SCOPE)
+endfunction()
+
+# run the benchmarks and gather the median times
+set(names)
+set(entries)
+get_filename_component(output_dir ${OUTPUT} DIRECTORY)
+foreach(benchmark ${BENCHMARKS})
+    # the filter, after the first '|', may contain other ones
+    string(FIND "${benchmark}" "|" separator)
+    string(SUBSTRING "${benchmark}" 0 ${separator} executable)
+    math(EXPR separator "${separator} + 1")
+    string(SUBSTRING "${benchmark}" ${separator} -1 filter)
+    get_filename_component(executable_name ${executable} NAME_WE)
+    set(raw "${output_dir}/${executable_name}_raw.json")
+    file(REMOVE ${raw})
+
+    message(STATUS "Running ${executable_name} --benchmark_filter=${filter}")
+    execute_process(
+        COMMAND ${executable}
+            --benchmark_filter=${filter}
+            --benchmark_repetitions=${REPETITIONS}
+            --benchmark_report_aggregates_only=true
+            --benchmark_out=${raw}
+            --benchmark_out_format=json
+        WORKING_DIRECTORY ${output_dir}
+        RESULT_VARIABLE result
+        OUTPUT_QUIET)
+    if(NOT result EQUAL 0 OR NOT EXISTS ${raw})
+        message(FATAL_ERROR "${executable_name} failed (${result})")
+    endif()
+
+    file(READ ${raw} json)
+    string(JSON count LENGTH "${json}" benchmarks)
+    if(count EQUAL 0)
+        message(FATAL_ERROR "No benchmark of ${executable_name} matches ${filter}")
+    endif()
+    math(EXPR last "${count} - 1")
+    foreach(i RANGE ${last})
+        string(JSON aggregate ERROR_VARIABLE missing GET "${json}" benchmarks ${i} aggregate_name)
+        if(NOT aggregate STREQUAL "median")
+            continue()
+        endif()
+        string(JSON name GET "${json}" benchmarks ${i} run_name)
+        string(JSON time GET "${json}" benchmarks ${i} cpu_time)
+        string(JSON unit GET "${json}" benchmarks ${i} time_unit)
+        to_picoseconds(${time} ${unit} ps)
+        to_nanoseconds(${ps} ns)
+        list(APPEND names "${name}")
+        string(MAKE_C_IDENTIFIER "${name}" key)
+        set(time_${key} ${ps})
+        list(APPEND entries "    {\"name\": \"${name}\", \"cpu_time\": ${ns}, \"time_unit\": \"ns\"}")
+    endforeach()
+endforeach()
+
+string(REPLACE ";" ",\n" entries "${entries}")
+file(WRITE ${OUTPUT} "{\n  \"benchmarks\": [\n${entries}\n  ]\n}\n")
+message(STATUS "Results written to ${OUTPUT}")
+
+if(UPDATE_BASELINE)
+    file(COPY_FILE ${OUTPUT} ${BASELINE})
+    message(STATUS "Baseline ${BASELINE} updated")
+    return()
+endif()
+
+# compare against the baseline
+if(NOT EXISTS ${BASELINE})
+    message(FATAL_ERROR "No baseline ${BASELINE}: build ponca-benchmark-baseline to record one")
+endif()
+file(READ ${BASELINE} baseline)
+string(JSON count LENGTH "${baseline}" benchmarks)
+set(regressions 0)
+set(compared)
+if(count GREATER 0)
+    math(EXPR last "${count} - 1")
+    foreach(i RANGE ${last})
+        string(JSON name GET "${baseline}" benchmarks ${i} name)
+        string(JSON reference GET "${baseline}" benchmarks ${i} cpu_time)
+        string(JSON unit GET "${baseline}" benchmarks ${i} time_unit)
+        to_picoseconds(${reference} ${unit} reference)
+        string(MAKE_C_IDENTIFIER "${name}" key)
+        if(NOT DEFINED time_${key})
+            message(WARNING "${name}: in the baseline but not run")
+            continue()
+        endif()
+        list(APPEND compared "${name}")
+        set(time ${time_${key}})
+        math(EXPR change "(${time} - ${reference}) * 100 / ${reference}")
+        to_nanoseconds(${time} time_ns)
+        to_nanoseconds(${reference} reference_ns)
+        message(STATUS "${name}: ${time_ns} ns (baseline ${reference_ns} ns, ${change}%)")
+        if(change GREATER THRESHOLD)
+            message(SEND_ERROR "${name} regressed by ${change}% (threshold ${THRESHOLD}%)")
+            math(EXPR regressions "${regressions} + 1")
+        endif()
+    endforeach()
+endif()
+foreach(name ${names})
+    if(NOT name IN_LIST compared)
+        message(WARNING "${name}: not in the baseline")
+    endif()
+endforeach()
+
+if(regressions GREATER 0)
+    message(FATAL_ERROR "${regressions} benchmark(s) regressed beyond the threshold")
+endif()
+message(STATUS "No regression beyond the threshold")
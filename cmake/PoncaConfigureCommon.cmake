@@ -2,8 +2,12 @@ set(ponca_Common_INCLUDE
     "${PONCA_src_ROOT}/Ponca/Common"
     "${PONCA_src_ROOT}/Ponca/Ponca"
     "${PONCA_src_ROOT}/Ponca/src/Common/defines.h"
+    "${PONCA_src_ROOT}/Ponca/src/Common/Tracing.h"
     "${PONCA_src_ROOT}/Ponca/src/Common/Containers/limitedPriorityQueue.h"
+    "${PONCA_src_ROOT}/Ponca/src/Common/Containers/staticLimitedPriorityQueue.h"
     "${PONCA_src_ROOT}/Ponca/src/Common/Containers/stack.h"
+    "${PONCA_src_ROOT}/Ponca/src/Common/IO/pointCloudFile.h"
+    "${PONCA_src_ROOT}/Ponca/src/Common/IO/pointCloudFile.hpp"
     )
 
 add_library(Common INTERFACE)
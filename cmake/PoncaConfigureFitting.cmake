@@ -1,11 +1,21 @@
 set(ponca_Fitting_INCLUDE
     "${PONCA_src_ROOT}/Ponca/Fitting"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/defines.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/accumulator.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/adaptiveScale.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/normalCurvaturePipeline.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/surfaceVariationFilter.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/algebraicSphere.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/algebraicSphere.hpp"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/basket.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/basketBatch.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/basketTuple.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/computeAll.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/fitEngine.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/covarianceLineFit.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/covarianceLineFit.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/lineFitBatch.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/polylineTracing.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/covariancePlaneFit.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/covariancePlaneFit.hpp"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/curvatureEstimation.h"
@@ -15,15 +25,34 @@ set(ponca_Fitting_INCLUDE
     "${PONCA_src_ROOT}/Ponca/src/Fitting/enums.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/gls.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/gls.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/irls.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/irls.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/footprint.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/profiling.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/profiling.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/mahalanobisWeightFunc.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/mahalanobisWeightFunc.hpp"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/meanPlaneFit.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/meanPlaneFit.hpp"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/mlsSphereFitDer.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/mlsSphereFitDer.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/mlsProjection.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/potentialGrid.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/fitFieldCache.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/temporalFitCache.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/rayCasting.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/rayCastingCuda.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/mongePatch.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/mongePatch.hpp"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/orientedSphereFit.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/orientedSphereFit.hpp"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/plane.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/scaleSweep.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/lodFit.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/glsDescriptors.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/screenSpace.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/screenSpaceCuda.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/screenSpaceScheduler.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/primitive.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/sphereFit.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/sphereFit.hpp"
@@ -31,6 +60,7 @@ set(ponca_Fitting_INCLUDE
     "${PONCA_src_ROOT}/Ponca/src/Fitting/unorientedSphereFit.hpp"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/weightFunc.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/weightFunc.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/weightedPoint.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/weightKernel.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/linePrimitive.h"
     )
@@ -0,0 +1,37 @@
+set(ponca_Precompiled_INCLUDE
+    "${PONCA_src_ROOT}/Ponca/Precompiled"
+    "${PONCA_src_ROOT}/Ponca/src/Precompiled/precompiled.h"
+    )
+
+set(ponca_Precompiled_SRC
+    "${PONCA_src_ROOT}/Ponca/src/Precompiled/precompiledFloat.cpp"
+    "${PONCA_src_ROOT}/Ponca/src/Precompiled/precompiledDouble.cpp"
+    )
+
+# Compiled library of the explicit instantiations declared by Ponca/Precompiled
+add_library(Precompiled STATIC ${ponca_Precompiled_SRC} ${ponca_Precompiled_INCLUDE})
+target_include_directories(Precompiled PUBLIC
+    "$<BUILD_INTERFACE:${PONCA_src_ROOT}>"
+    "$<INSTALL_INTERFACE:include/>"
+    )
+target_link_libraries(Precompiled PUBLIC Fitting SpatialPartitioning)
+set_target_properties(Precompiled PROPERTIES
+  OUTPUT_NAME PoncaPrecompiled
+  POSITION_INDEPENDENT_CODE ON
+  INTERFACE_COMPILE_FEATURES cxx_std_17
+)
+ponca_handle_eigen_dependency(Precompiled)
+
+install(TARGETS Precompiled
+    EXPORT PrecompiledTargets
+    ARCHIVE DESTINATION  lib
+    INCLUDES DESTINATION ${CMAKE_INSTALL_INCDIR}
+)
+
+install(EXPORT PrecompiledTargets
+  FILE PoncaTargets-Precompiled.cmake
+  NAMESPACE Ponca::
+  DESTINATION lib/cmake
+)
+
+add_library(Ponca::Precompiled ALIAS Precompiled)
@@ -3,14 +3,37 @@ set(ponca_SpatialPartitioning_INCLUDE
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/defines.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/query.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/indexSquaredDistance.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/morton.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/regions.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/weightedMetric.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/dynamicKdTree.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/dynamicKdTree.hpp"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTree.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTree.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeDeviceView.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeFile.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeNode.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeStatistics.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeAutotune.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeNormalOrientation.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeOutlierFilters.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeSampling.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeRegistration.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeDescriptorIndex.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeSnapshot.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeNuma.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/progressiveKdTree.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/progressiveKdTree.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeQueryContext.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeKNearestIndexQuery.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeKNearestIndexQuery.hpp"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeKNearestPointQuery.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeKNearestPointQuery.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeKNearestRangeIndexQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeKNearestRangeIndexQuery.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeKNearestRangePointQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeKNearestRangePointQuery.hpp"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeNearestIndexQuery.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeNearestIndexQuery.hpp"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeNearestPointQuery.h"
@@ -19,6 +42,38 @@ set(ponca_SpatialPartitioning_INCLUDE
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeRangeIndexQuery.hpp"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeRangePointQuery.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeRangePointQuery.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeRegionQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeRegionQuery.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/OutOfCore/outOfCoreTiling.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/OutOfCore/outOfCoreTiling.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Octree/octree.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Octree/octree.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Octree/octreeMoments.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Octree/Iterator/octreeLodIterator.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Octree/Query/octreeLodQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Octree/Query/octreeLodQuery.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/VoxelGrid/voxelGrid.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/VoxelGrid/voxelGrid.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/VoxelGrid/voxelGridQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/VoxelGrid/Query/voxelGridKNearestIndexQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/VoxelGrid/Query/voxelGridKNearestIndexQuery.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/VoxelGrid/Query/voxelGridKNearestPointQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/VoxelGrid/Query/voxelGridKNearestPointQuery.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/VoxelGrid/Query/voxelGridRangeIndexQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/VoxelGrid/Query/voxelGridRangeIndexQuery.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/VoxelGrid/Query/voxelGridRangePointQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/VoxelGrid/Query/voxelGridRangePointQuery.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Organized/organizedIndex.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Organized/organizedIndex.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Organized/organizedQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Organized/Query/organizedKNearestIndexQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Organized/Query/organizedKNearestIndexQuery.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Organized/Query/organizedKNearestPointQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Organized/Query/organizedKNearestPointQuery.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Organized/Query/organizedRangeIndexQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Organized/Query/organizedRangeIndexQuery.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Organized/Query/organizedRangePointQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/Organized/Query/organizedRangePointQuery.hpp"
     )
 
 add_library(SpatialPartitioning INTERFACE)
@@ -96,6 +96,16 @@ int main()
       ne2.compute(*output_cloud);
     }
 
+    // same estimation, with the neighborhoods queried in a Ponca KdTree and the fits computed in parallel
+    pcl::GlsCurvatureOMP<pcl::PointNormal, pcl::PointNormal> ne3;
+    ne3.setInputCloud(cloud);
+    ne3.setRadiusSearch( radius );
+    pcl::PointCloud<pcl::PointNormal>::Ptr output_cloud_omp (new pcl::PointCloud<pcl::PointNormal>);
+    {
+      pcl::ScopeTime t1 ("Curvature computation using Ponca (OpenMP)");
+      ne3.compute(*output_cloud_omp);
+    }
+
     // compare timings with PCL curvature estimation
     pcl::PrincipalCurvaturesEstimation<pcl::PointXYZ, pcl::Normal> pce;
     pce.setInputCloud(cloud_without_normals);
@@ -9,6 +9,7 @@
 #include <pcl/features/feature.h>
 
 #include <Ponca/Fitting>
+#include <Ponca/SpatialPartitioning>
 
 #include "Eigen/Eigen"
 
@@ -38,6 +39,25 @@ private:
     Eigen::Map< const VectorType > pos_, normal_;
 };
 
+/**
+   \brief PCL point seen as a Ponca point.
+
+   The class only adds the Ponca interface to the PCL point type, without any member: an array of PCL points is
+   read in place as an array of PclPoint, e.g. by a Ponca::KdTree view of a PCL cloud.
+ */
+template<typename PointT>
+class PclPoint : public PointT
+{
+public:
+    enum {Dim = 3};
+    typedef float Scalar;
+    typedef Eigen::Matrix<Scalar, 3, 1> VectorType;
+    typedef Eigen::Matrix<Scalar, 3, 3> MatrixType;
+
+    inline Eigen::Map< const VectorType > pos()    const { return this->getVector3fMap(); }
+    inline Eigen::Map< const VectorType > normal() const { return this->getNormalVector3fMap(); }
+};
+
 namespace pcl
 {
     /** \brief GlsCurvature estimates local surface curvatures at each 3D point with oriented normal using the Ponca library
@@ -93,4 +113,72 @@ namespace pcl
         void
         computeFeatureEigen (pcl::PointCloud<Eigen::MatrixXf> &) {}
     };
+
+    /** \brief GlsCurvatureOMP estimates the same curvatures as GlsCurvature, in parallel using OpenMP.
+    *
+    * The neighborhoods are not searched with the PCL search method: a Ponca::KdTree view is built over the search
+    * surface, without copying it, and the neighborhoods are queried by blocks of evaluation points with the batched
+    * KdTree queries. The fits of a block are then computed in parallel by Ponca::computeBatch, reading the PCL points
+    * in place.
+    * \note As with GlsCurvature, the scale of the fits is the search radius. With setKSearch (), the scale of each
+    * fit is the distance to its k-th neighbor.
+    * \ingroup features
+    */
+    template<typename PointInT, typename PointOutT>
+    class GlsCurvatureOMP : public GlsCurvature<PointInT, PointOutT>
+    {
+        using Feature<PointInT, PointOutT>::feature_name_;
+        using Feature<PointInT, PointOutT>::getClassName;
+        using Feature<PointInT, PointOutT>::indices_;
+        using Feature<PointInT, PointOutT>::input_;
+        using Feature<PointInT, PointOutT>::surface_;
+        using Feature<PointInT, PointOutT>::fake_surface_;
+        using Feature<PointInT, PointOutT>::k_;
+        using Feature<PointInT, PointOutT>::search_radius_;
+
+        typedef typename Feature<PointInT, PointOutT>::PointCloudOut PointCloudOut;
+
+    public:
+        /** \brief Initialize the scheduler and set the number of threads to use.
+        * \param nr_threads the number of hardware threads to use (0 sets the value back to automatic)
+        */
+        GlsCurvatureOMP(unsigned int nr_threads = 0)
+        {
+            feature_name_ = "GlsCurvatureOMP";
+            setNumberOfThreads(nr_threads);
+        }
+
+        /** \brief Set the number of threads to use.
+        * \param nr_threads the number of hardware threads to use (0 sets the value back to automatic)
+        */
+        void
+        setNumberOfThreads (unsigned int nr_threads = 0) { threads_ = nr_threads; }
+
+        /** \brief Set the number of evaluation points whose neighborhoods are queried and stored at once.
+        * \param block_size the number of evaluation points per block, bounding the memory of the neighborhoods
+        */
+        void
+        setBlockSize (int block_size) { block_size_ = std::max(block_size, 1); }
+
+    protected:
+        /** \brief Check the input and the search parameters. Contrary to Feature::initCompute (), no PCL search
+        * method is set up, the neighborhoods being queried in a Ponca::KdTree.
+        */
+        bool
+        initCompute () override;
+
+        /** \brief Estimate curvatures for all points given in <setInputCloud (), setIndices ()> using the surface in
+        * setSearchSurface ()
+        * \note In situations where not enough neighbors are found, curvature values are set to qNan.
+        * \param output the resultant point cloud model dataset that contains surface curvatures
+        */
+        void
+        computeFeature (PointCloudOut &output) override;
+
+        /** \brief The number of threads the scheduler should use, 0 for automatic. */
+        unsigned int threads_ {0};
+
+        /** \brief The number of evaluation points processed per block. */
+        int block_size_ {65536};
+    };
 }
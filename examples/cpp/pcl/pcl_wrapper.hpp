@@ -9,6 +9,13 @@
 #include "pcl_wrapper.h"
 #include <pcl/common/point_tests.h> // isFinite
 
+#include <algorithm>
+#include <cmath>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointInT, typename PointOutT> void
 pcl::GlsCurvature<PointInT, PointOutT>::computeFeature(PointCloudOut &output)
@@ -95,5 +102,147 @@ pcl::GlsCurvature<PointInT, PointOutT>::computeCurvature(const pcl::PointCloud<P
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointOutT> bool
+pcl::GlsCurvatureOMP<PointInT, PointOutT>::initCompute()
+{
+    if (!PCLBase<PointInT>::initCompute ())
+    {
+        PCL_ERROR ("[pcl::%s::initCompute] Init failed.\n", getClassName ().c_str ());
+        return (false);
+    }
+
+    // If the dataset is empty, just return
+    if (input_->points.empty ())
+    {
+        PCL_ERROR ("[pcl::%s::compute] input_ is empty!\n", getClassName ().c_str ());
+        return (false);
+    }
+
+    // If no search surface has been defined, use the input dataset as the search surface itself
+    if (!surface_)
+    {
+        fake_surface_ = true;
+        surface_ = input_;
+    }
+
+    if ((k_ > 0) == (search_radius_ > 0))
+    {
+        PCL_ERROR ("[pcl::%s::compute] Set either the number of neighbors (setKSearch) or the radius (setRadiusSearch), and only one of them!\n",
+                   getClassName ().c_str ());
+        return (false);
+    }
+    return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointOutT> void
+pcl::GlsCurvatureOMP<PointInT, PointOutT>::computeFeature(PointCloudOut &output)
+{
+    typedef PclPoint<PointInT> Point;
+    typedef typename Point::Scalar Scalar;
+    typedef typename Point::VectorType VectorType;
+    typedef Ponca::DistWeightFunc<Point, Ponca::SmoothWeightKernel<Scalar> > WeightFunc;
+    typedef Ponca::Basket<Point, WeightFunc, Ponca::CovariancePlaneFit, Ponca::CovariancePlaneSpaceDer, Ponca::CurvatureEstimator> Fit;
+    static_assert(sizeof(Point) == sizeof(PointInT), "PclPoint must be readable in place of the PCL points");
+
+    // View of the search surface, without copy. The non finite points are left out of the tree.
+    const Point* points = reinterpret_cast<const Point*>(surface_->points.data ());
+    const int point_count = static_cast<int>(surface_->points.size ());
+    Ponca::KdTree<Point> tree;
+    if (surface_->is_dense)
+    {
+        tree.build_view(points, point_count);
+    }
+    else
+    {
+        std::vector<int> finite;
+        finite.reserve(point_count);
+        for (int i = 0; i < point_count; ++i)
+            if (pcl::isFinite (surface_->points[i]))
+                finite.push_back(i);
+        tree.build_view(points, point_count, finite);
+    }
+
+    // Evaluation points, processed in the leaf order of the tree for the locality of the queries
+    output.is_dense = true;
+    std::vector<int> evaluation;
+    std::vector<VectorType> positions;
+    evaluation.reserve(indices_->size ());
+    positions.reserve(indices_->size ());
+    for (size_t idx = 0; idx < indices_->size (); ++idx)
+    {
+        const PointInT& p = (*input_)[(*indices_)[idx]];
+        if (!input_->is_dense && !pcl::isFinite (p))
+        {
+            output.points[idx].curvature = std::numeric_limits<float>::quiet_NaN ();
+            output.is_dense = false;
+            continue;
+        }
+        evaluation.push_back(static_cast<int>(idx));
+        positions.push_back(p.getVector3fMap ());
+    }
+    const auto order = tree.leaf_order(positions);
+
+#ifdef _OPENMP
+    const int previous_threads = omp_get_max_threads ();
+    if (threads_ > 0)
+        omp_set_num_threads (static_cast<int>(threads_));
+#endif
+
+    const int k = std::min(k_, tree.index_count ());
+    std::vector<VectorType> block;
+    std::vector<std::size_t> offsets;
+    std::vector<int> neighbors;
+    std::vector<Scalar> squared_distances;
+    for (std::size_t first = 0; first < order.size (); first += std::size_t(block_size_))
+    {
+        const int size = static_cast<int>(std::min(order.size () - first, std::size_t(block_size_)));
+        block.resize(size);
+        for (int b = 0; b < size; ++b)
+            block[b] = positions[order[first + b]];
+
+        // Neighborhoods of the block, in compressed sparse row format
+        if (k_ > 0)
+        {
+            neighbors.resize(std::size_t(size) * k);
+            squared_distances.resize(std::size_t(size) * k);
+            if (k > 0)
+                tree.k_nearest_neighbors_batch(block, k, neighbors.data (), squared_distances.data ());
+            offsets.resize(size + 1);
+            for (int b = 0; b <= size; ++b)
+                offsets[b] = std::size_t(b) * k;
+        }
+        else
+        {
+            tree.range_neighbors_batch(block, Scalar(search_radius_), offsets, neighbors);
+        }
+
+        Ponca::computeBatch<Fit>(size, points, offsets, neighbors,
+            [&](int b, Fit& fit)
+            {
+                // Set a weighting function instance using the search radius, or the distance to the k-th neighbor
+                const Scalar scale = k_ > 0 ? std::sqrt(squared_distances[std::size_t(b + 1) * k - 1]) : Scalar(search_radius_);
+                fit.setWeightFunc(WeightFunc(std::max(scale, Eigen::NumTraits<Scalar>::dummy_precision ())));
+                fit.init(block[b]);
+            },
+            [&](int b, const Fit& fit, Ponca::FIT_RESULT)
+            {
+                // Set curvature to qNan if the fitting did not end without errors
+                output.points[evaluation[order[first + b]]].curvature =
+                    fit.isStable() ? float(fit.kMean()) : std::numeric_limits<float>::quiet_NaN ();
+            });
+
+        for (int b = 0; b < size; ++b)
+            if (offsets[b + 1] == offsets[b])
+                output.is_dense = false;
+    }
+
+#ifdef _OPENMP
+    omp_set_num_threads (previous_threads);
+#endif
+}
+
 #define PCL_INSTANTIATE_GlsCurvature(T, OutT) template class PCL_EXPORTS pcl::GlsCurvature<T, OutT>;
 
+#define PCL_INSTANTIATE_GlsCurvatureOMP(T, OutT) template class PCL_EXPORTS pcl::GlsCurvatureOMP<T, OutT>;
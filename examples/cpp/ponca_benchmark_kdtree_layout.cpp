@@ -0,0 +1,110 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+\file examples/cpp/ponca_benchmark_kdtree_layout.cpp
+\brief Compare the node layouts of the KdTree (see KDTREE_NODE_LAYOUT)
+
+Usage: ponca_benchmark_kdtree_layout [point count]
+The default point count (16M) with small leaves gives node arrays larger than the last level cache of most CPUs.
+The queries are run in random order, so that each of them misses the cache.
+*/
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Ponca/SpatialPartitioning>
+
+#include "Eigen/Eigen"
+
+using namespace std;
+using namespace Ponca;
+
+// This class defines the input data format
+class MyPoint
+{
+public:
+    enum {Dim = 3};
+    typedef float Scalar;
+    typedef Eigen::Matrix<Scalar, Dim, 1>   VectorType;
+    typedef Eigen::Matrix<Scalar, Dim, Dim> MatrixType;
+
+    inline MyPoint(const VectorType& _pos = VectorType::Zero()) : m_pos(_pos) {}
+
+    inline const VectorType& pos() const { return m_pos; }
+    inline       VectorType& pos()       { return m_pos; }
+
+private:
+    VectorType m_pos;
+};
+
+typedef MyPoint::Scalar Scalar;
+typedef MyPoint::VectorType VectorType;
+
+const pair<KDTREE_NODE_LAYOUT, const char*> layouts[] = {
+    {NODE_LAYOUT_DEPTH_FIRST, "depth-first"},
+    {NODE_LAYOUT_BREADTH_FIRST, "breadth-first"},
+    {NODE_LAYOUT_VAN_EMDE_BOAS, "van Emde Boas"}
+};
+
+// Run `run(query, point)` on each query point, and print the number of queries per second
+template<typename QueryT, typename Functor>
+void measure(const string& name, const char* layout, QueryT query, const vector<VectorType>& queries, Functor run)
+{
+    size_t checksum = 0;
+    auto t0 = chrono::steady_clock::now();
+    for (const auto& q : queries)
+        checksum += run(query, q);
+    auto t1 = chrono::steady_clock::now();
+
+    const double queryTime = chrono::duration<double>(t1 - t0).count();
+    cout << "  " << name << "\t" << layout << ":\t" << double(queries.size()) / queryTime << " queries/s\t(checksum "
+         << checksum << ")" << endl;
+}
+
+void benchmark(const vector<MyPoint>& points, const vector<VectorType>& queries, int minCellSize)
+{
+    // about 16 neighbors per query
+    const Scalar r = Scalar(2) * std::cbrt(Scalar(16) / (Scalar(4.18879) * Scalar(points.size())));
+
+    vector<KdTree<MyPoint>> trees(3);
+    for (int l = 0; l < 3; ++l)
+    {
+        trees[l].set_min_cell_size(minCellSize);
+        trees[l].set_node_layout(layouts[l].first);
+        trees[l].build(points);
+    }
+    cout << "==== " << points.size() << " points, leaves of at most " << minCellSize << " points ("
+         << trees[0].node_count() << " nodes)" << endl;
+
+    for (int l = 0; l < 3; ++l)
+        measure("nearest", layouts[l].second, trees[l].nearest_neighbor(VectorType::Zero()), queries,
+                [](auto& query, const VectorType& q) { size_t s = 0; for (int j : query(q)) s += size_t(j); return s; });
+    for (int l = 0; l < 3; ++l)
+        measure("k=8", layouts[l].second, trees[l].k_nearest_neighbors(VectorType::Zero(), 8), queries,
+                [](auto& query, const VectorType& q) { size_t s = 0; for (int j : query(q)) s += size_t(j); return s; });
+    for (int l = 0; l < 3; ++l)
+        measure("range", layouts[l].second, trees[l].range_neighbors(VectorType::Zero(), r), queries,
+                [](auto& query, const VectorType& q) { size_t s = 0; for (int j : query(q)) s += size_t(j); return s; });
+}
+
+int main(int argc, char** argv)
+{
+    const int n = argc > 1 ? stoi(argv[1]) : 16 * 1024 * 1024;
+    const int queryCount = 500000;
+
+    vector<MyPoint> points(n);
+    for (auto& p : points) p = MyPoint(VectorType::Random());
+    vector<VectorType> queries(queryCount);
+    for (auto& q : queries) q = VectorType::Random();
+
+    benchmark(points, queries, 64);
+    benchmark(points, queries, 8);
+
+    return 0;
+}
@@ -0,0 +1,104 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+\file examples/cpp/ponca_benchmark_kdtree_prefetch.cpp
+\brief Compare the KdTree queries with and without the software prefetches of the traversal
+
+Usage: ponca_benchmark_kdtree_prefetch [point count]
+The default point count (16M) gives a tree larger than the last level cache of most CPUs, to benefit from the
+prefetches: the queries are run in random order, so that each of them misses the cache. Run it under
+`perf stat -e cache-misses,cycles` with each setting to count the misses.
+*/
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Ponca/SpatialPartitioning>
+
+#include "Eigen/Eigen"
+
+using namespace std;
+using namespace Ponca;
+
+// This class defines the input data format
+class MyPoint
+{
+public:
+    enum {Dim = 3};
+    typedef float Scalar;
+    typedef Eigen::Matrix<Scalar, Dim, 1>   VectorType;
+    typedef Eigen::Matrix<Scalar, Dim, Dim> MatrixType;
+
+    inline MyPoint(const VectorType& _pos = VectorType::Zero()) : m_pos(_pos) {}
+
+    inline const VectorType& pos() const { return m_pos; }
+    inline       VectorType& pos()       { return m_pos; }
+
+private:
+    VectorType m_pos;
+};
+
+typedef MyPoint::Scalar Scalar;
+typedef MyPoint::VectorType VectorType;
+
+// Run `run(query, point)` on each query point, and print the number of queries per second
+template<typename QueryT, typename Functor>
+void measure(const string& name, QueryT query, const vector<VectorType>& queries, Functor run)
+{
+    for (bool prefetch : {false, true})
+    {
+        query.set_prefetch(prefetch);
+        size_t checksum = 0;
+        auto t0 = chrono::steady_clock::now();
+        for (const auto& q : queries)
+            checksum += run(query, q);
+        auto t1 = chrono::steady_clock::now();
+
+        const double queryTime = chrono::duration<double>(t1 - t0).count();
+        cout << "  " << name << (prefetch ? "\tprefetch:\t" : "\tno prefetch:\t")
+             << double(queries.size()) / queryTime << " queries/s\t(checksum " << checksum << ")" << endl;
+    }
+}
+
+void benchmark(KdTree<MyPoint>& tree, const vector<VectorType>& queries)
+{
+    for (int k : {1, 8, 32})
+    {
+        measure("k=" + to_string(k), tree.k_nearest_neighbors(VectorType::Zero(), k), queries,
+                [k](auto& query, const VectorType& q) { size_t s = 0; for (int j : query(q, k)) s += size_t(j); return s; });
+    }
+    measure("nearest", tree.nearest_neighbor(VectorType::Zero()), queries,
+            [](auto& query, const VectorType& q) { size_t s = 0; for (int j : query(q)) s += size_t(j); return s; });
+
+    // about 32 neighbors per query
+    const Scalar r = Scalar(2) * std::cbrt(Scalar(32) / (Scalar(4.18879) * Scalar(tree.point_count())));
+    measure("range", tree.range_neighbors(VectorType::Zero(), r), queries,
+            [](auto& query, const VectorType& q) { size_t s = 0; for (int j : query(q)) s += size_t(j); return s; });
+}
+
+int main(int argc, char** argv)
+{
+    const int n = argc > 1 ? stoi(argv[1]) : 16 * 1024 * 1024;
+    const int queryCount = 200000;
+
+    vector<MyPoint> points(n);
+    for (auto& p : points) p = MyPoint(VectorType::Random());
+    vector<VectorType> queries(queryCount);
+    for (auto& q : queries) q = VectorType::Random();
+
+    KdTree<MyPoint> tree(points);
+    cout << "==== uniform (" << n << " points)" << endl;
+    benchmark(tree, queries);
+
+    tree.set_use_leaf_positions(true);
+    cout << "==== uniform, leaf positions (" << n << " points)" << endl;
+    benchmark(tree, queries);
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+\file examples/cpp/ponca_benchmark_kdtree_split.cpp
+\brief Compare KdTree construction and query throughput for each split strategy
+
+Usage: ponca_benchmark_kdtree_split [file.ply]
+where file.ply is a binary ply file
+(default: bun_zipper.ply).
+*/
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Ponca/src/Common/IO/pointCloudFile.h>
+#include <Ponca/SpatialPartitioning>
+
+#include "Eigen/Eigen"
+
+using namespace std;
+using namespace Ponca;
+
+// This class defines the input data format
+class MyPoint
+{
+public:
+    enum {Dim = 3};
+    typedef float Scalar;
+    typedef Eigen::Matrix<Scalar, Dim, 1>   VectorType;
+    typedef Eigen::Matrix<Scalar, Dim, Dim> MatrixType;
+
+    inline MyPoint(const VectorType& _pos = VectorType::Zero()) : m_pos(_pos) {}
+
+    inline const VectorType& pos() const { return m_pos; }
+    inline       VectorType& pos()       { return m_pos; }
+
+private:
+    VectorType m_pos;
+};
+
+typedef MyPoint::Scalar Scalar;
+typedef MyPoint::VectorType VectorType;
+
+// Read the vertices of a binary ply file, decoded in parallel from the mapped file
+bool loadPly(const string& filename, vector<MyPoint>& points)
+{
+    PointCloudFile file;
+    if (!file.open(filename)) return false;
+    points.resize(file.point_count());
+    file.read(points.data());
+    return true;
+}
+
+// Dense clusters embedded in a sparse background, mimicking uneven LiDAR densities
+vector<MyPoint> generateClusteredCloud(int n, int nbClusters)
+{
+    vector<VectorType> centers(nbClusters);
+    for (auto& c : centers) c = VectorType::Random();
+
+    vector<MyPoint> points(n);
+    for (auto& p : points)
+    {
+        if (nbClusters > 0 && Eigen::internal::random<Scalar>(0, 1) < Scalar(0.9))
+            p = MyPoint(centers[Eigen::internal::random<int>(0, nbClusters - 1)] + VectorType::Random() * Scalar(0.01));
+        else
+            p = MyPoint(VectorType::Random());
+    }
+    return points;
+}
+
+void benchmark(const string& name, const vector<MyPoint>& points, int k)
+{
+    const pair<KDTREE_SPLIT_STRATEGY, const char*> strategies[] = {
+        {SPLIT_MIDPOINT, "midpoint"},
+        {SPLIT_MEDIAN, "median"},
+        {SPLIT_SLIDING_MIDPOINT, "sliding midpoint"},
+        {SPLIT_SAH, "sah"},
+        {SPLIT_MORTON, "morton"}
+    };
+
+    cout << "==== " << name << " (" << points.size() << " points, k=" << k << ")" << endl;
+    for (const auto& strategy : strategies)
+    {
+        KdTree<MyPoint> tree;
+        tree.set_split_strategy(strategy.first);
+
+        auto t0 = chrono::steady_clock::now();
+        tree.build(points);
+        auto t1 = chrono::steady_clock::now();
+
+        size_t checksum = 0;
+        for (int i = 0; i < tree.point_count(); ++i)
+            for (int j : tree.k_nearest_neighbors(i, k))
+                checksum += size_t(j);
+        auto t2 = chrono::steady_clock::now();
+
+        const double buildTime = chrono::duration<double>(t1 - t0).count();
+        const double queryTime = chrono::duration<double>(t2 - t1).count();
+        cout << "  " << strategy.second << ":\tbuild " << buildTime * 1000. << " ms,\t"
+             << double(points.size()) / queryTime << " queries/s,\t"
+             << tree.node_count() << " nodes\t(checksum " << checksum << ")" << endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const string filename = argc > 1 ? argv[1] : "bun_zipper.ply";
+    const int k = 16;
+
+    vector<MyPoint> bunny;
+    if (loadPly(filename, bunny))
+        benchmark(filename, bunny, k);
+    else
+        cerr << "Cannot load " << filename << ", skipping" << endl;
+
+    benchmark("clustered", generateClusteredCloud(200000, 20), k);
+    benchmark("uniform", generateClusteredCloud(200000, 0), k);
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+\file examples/cpp/ponca_benchmark_kdtree_traversal.cpp
+\brief Compare the depth-first and best-first traversals of the KdTree k-nearest neighbors queries
+
+Usage: ponca_benchmark_kdtree_traversal [file.ply]
+where file.ply is a binary ply file
+(default: bun_zipper.ply).
+*/
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Ponca/src/Common/IO/pointCloudFile.h>
+#include <Ponca/SpatialPartitioning>
+
+#include "Eigen/Eigen"
+
+using namespace std;
+using namespace Ponca;
+
+// This class defines the input data format
+class MyPoint
+{
+public:
+    enum {Dim = 3};
+    typedef float Scalar;
+    typedef Eigen::Matrix<Scalar, Dim, 1>   VectorType;
+    typedef Eigen::Matrix<Scalar, Dim, Dim> MatrixType;
+
+    inline MyPoint(const VectorType& _pos = VectorType::Zero()) : m_pos(_pos) {}
+
+    inline const VectorType& pos() const { return m_pos; }
+    inline       VectorType& pos()       { return m_pos; }
+
+private:
+    VectorType m_pos;
+};
+
+typedef MyPoint::Scalar Scalar;
+typedef MyPoint::VectorType VectorType;
+
+// Read the vertices of a binary ply file, decoded in parallel from the mapped file
+bool loadPly(const string& filename, vector<MyPoint>& points)
+{
+    PointCloudFile file;
+    if (!file.open(filename)) return false;
+    points.resize(file.point_count());
+    file.read(points.data());
+    return true;
+}
+
+// Dense clusters embedded in a sparse background, mimicking uneven LiDAR densities
+vector<MyPoint> generateClusteredCloud(int n, int nbClusters)
+{
+    vector<VectorType> centers(nbClusters);
+    for (auto& c : centers) c = VectorType::Random();
+
+    vector<MyPoint> points(n);
+    for (auto& p : points)
+    {
+        if (nbClusters > 0 && Eigen::internal::random<Scalar>(0, 1) < Scalar(0.9))
+            p = MyPoint(centers[Eigen::internal::random<int>(0, nbClusters - 1)] + VectorType::Random() * Scalar(0.01));
+        else
+            p = MyPoint(VectorType::Random());
+    }
+    return points;
+}
+
+void benchmark(const string& name, const vector<MyPoint>& points)
+{
+    const pair<KdTreeTraversal, const char*> traversals[] = {
+        {KdTreeTraversal::DepthFirst, "depth-first"},
+        {KdTreeTraversal::BestFirst, "best-first"}
+    };
+
+    KdTree<MyPoint> tree(points);
+    // one query of each thousand points
+    const int step = 1000 < tree.point_count() ? 1000 : 1;
+
+    cout << "==== " << name << " (" << points.size() << " points)" << endl;
+    for (int k : {1, 4, 16, 64, 256})
+    {
+        for (const auto& traversal : traversals)
+        {
+            auto query = tree.k_nearest_neighbors(0, k);
+            query.set_traversal(traversal.first);
+
+            size_t checksum = 0, leafVisits = 0, queryCount = 0;
+            auto t0 = chrono::steady_clock::now();
+            for (int i = 0; i < tree.point_count(); i += step / k + 1)
+            {
+                for (int j : query(i))
+                    checksum += size_t(j);
+                leafVisits += size_t(query.leaf_visits());
+                ++queryCount;
+            }
+            auto t1 = chrono::steady_clock::now();
+
+            const double queryTime = chrono::duration<double>(t1 - t0).count();
+            cout << "  k=" << k << "\t" << traversal.second << ":\t" << double(queryCount) / queryTime << " queries/s,\t"
+                 << double(leafVisits) / double(queryCount) << " leaves/query\t(checksum " << checksum << ")" << endl;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const string filename = argc > 1 ? argv[1] : "bun_zipper.ply";
+
+    vector<MyPoint> bunny;
+    if (loadPly(filename, bunny))
+        benchmark(filename, bunny);
+    else
+        cerr << "Cannot load " << filename << ", skipping" << endl;
+
+    benchmark("clustered", generateClusteredCloud(200000, 20));
+    benchmark("uniform", generateClusteredCloud(200000, 0));
+
+    return 0;
+}
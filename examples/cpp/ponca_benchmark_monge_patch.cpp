@@ -0,0 +1,118 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+\file examples/cpp/ponca_benchmark_monge_patch.cpp
+\brief Compare the two passes MongePatch with its single pass variant MongePatchSinglePass
+
+Usage: ponca_benchmark_monge_patch [point count] [neighbors per point]
+Fits the neighborhood of each point of a noisy sampled sphere, collected by a KdTree range query at each pass, as
+Basket::compute does over a range query. For each variant, prints the number of fits per second and the deviation
+of the mean curvature from the two passes MongePatch.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <Ponca/Fitting>
+#include <Ponca/SpatialPartitioning>
+
+#include "Eigen/Eigen"
+
+using namespace std;
+using namespace Ponca;
+
+// This class defines the input data format
+class MyPoint
+{
+public:
+    enum {Dim = 3};
+    typedef double Scalar;
+    typedef Eigen::Matrix<Scalar, Dim, 1>   VectorType;
+    typedef Eigen::Matrix<Scalar, Dim, Dim> MatrixType;
+
+    inline MyPoint(const VectorType& _pos = VectorType::Zero()) : m_pos(_pos) {}
+
+    inline const VectorType& pos() const { return m_pos; }
+
+private:
+    VectorType m_pos;
+};
+
+typedef MyPoint::Scalar Scalar;
+typedef MyPoint::VectorType VectorType;
+
+typedef DistWeightFunc<MyPoint, SmoothWeightKernel<Scalar> > WeightFunc;
+typedef Basket<MyPoint, WeightFunc, CovariancePlaneFit, MongePatch> FitTwoPasses;
+typedef Basket<MyPoint, WeightFunc, CovariancePlaneFit, MongePatchSinglePass> FitSinglePass;
+
+template <typename Fit>
+vector<Scalar> benchmark(const KdTree<MyPoint>& tree, Scalar scale, const char* name)
+{
+    const int n = tree.point_count();
+    vector<Scalar> curvatures(n, Scalar(0));
+    int passes = 0;
+
+    auto query = tree.range_neighbors(tree.point(0).pos(), scale);
+    auto t0 = chrono::steady_clock::now();
+    for (int k = 0; k < tree.index_count(); ++k)
+    {
+        const int i = tree.index_buffer()[k];
+        const VectorType& pos = tree.point(i).pos();
+
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(scale));
+        fit.init(pos);
+        FIT_RESULT res;
+        do {
+            fit.addNeighbor(tree.point(i));
+            for (int j : query(pos, scale))
+                fit.addNeighbor(tree.point(j));
+            res = fit.finalize();
+            ++passes;
+        } while (res == NEED_OTHER_PASS);
+
+        if (res == STABLE)
+            curvatures[i] = fit.kMean();
+    }
+    auto t1 = chrono::steady_clock::now();
+
+    cout << "  " << name << "\t" << double(n) / chrono::duration<double>(t1 - t0).count() << " fits/s\t"
+         << double(passes) / n << " passes per fit" << endl;
+    return curvatures;
+}
+
+int main(int argc, char** argv)
+{
+    const int n = argc > 1 ? stoi(argv[1]) : 200000;
+    const int k = argc > 2 ? stoi(argv[2]) : 64;
+
+    vector<MyPoint> points(n);
+    for (auto& p : points)
+        p = MyPoint(VectorType::Random().normalized() * (Scalar(1) + Eigen::internal::random<Scalar>(-0.005, 0.005)));
+
+    KdTree<MyPoint> tree(points);
+    // about k neighbors per point
+    const Scalar scale = std::sqrt(Scalar(k) * Scalar(4) / Scalar(n));
+    cout << "==== " << n << " points, about " << k << " neighbors per point" << endl;
+
+    const vector<Scalar> reference = benchmark<FitTwoPasses>(tree, scale, "two passes ");
+    const vector<Scalar> curvatures = benchmark<FitSinglePass>(tree, scale, "single pass");
+
+    double mean = 0, max = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        const double d = std::abs(curvatures[i] - reference[i]);
+        mean += d / n;
+        max = std::max(max, d);
+    }
+    cout << "  mean curvature deviation: mean " << mean << ", max " << max << endl;
+
+    return 0;
+}
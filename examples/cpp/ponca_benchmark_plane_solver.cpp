@@ -0,0 +1,122 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+\file examples/cpp/ponca_benchmark_plane_solver.cpp
+\brief Compare the decompositions of the covariance matrix of CovariancePlaneFit
+
+Usage: ponca_benchmark_plane_solver [neighborhood count]
+Each neighborhood is a sampled plane patch, as in tests/src/fit_plane.cpp, with increasing noise along the normal:
+the last setting is nearly isotropic. For each solver, prints the number of fits per second and the angle between
+its normal and the one of ITERATIVE_SOLVER.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <Ponca/Fitting>
+
+#include "Eigen/Eigen"
+
+using namespace std;
+using namespace Ponca;
+
+// This class defines the input data format
+template<typename _Scalar>
+class MyPoint
+{
+public:
+    enum {Dim = 3};
+    typedef _Scalar Scalar;
+    typedef Eigen::Matrix<Scalar, Dim, 1>   VectorType;
+    typedef Eigen::Matrix<Scalar, Dim, Dim> MatrixType;
+
+    inline MyPoint(const VectorType& _pos = VectorType::Zero()) : m_pos(_pos) {}
+
+    inline const VectorType& pos() const { return m_pos; }
+    inline       VectorType& pos()       { return m_pos; }
+
+private:
+    VectorType m_pos;
+};
+
+template<typename Scalar>
+void benchmark(int count, Scalar noise)
+{
+    typedef MyPoint<Scalar> Point;
+    typedef typename Point::VectorType VectorType;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightFunc;
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit> Fit;
+
+    const int neighborCount = 32;
+
+    // plane patches of radius 1 around the origin, of random normals
+    vector<Point> points(size_t(count) * neighborCount);
+    for (int i = 0; i < count; ++i)
+    {
+        const VectorType normal = VectorType::Random().normalized();
+        const VectorType u = normal.unitOrthogonal();
+        const VectorType v = normal.cross(u);
+        for (int j = 0; j < neighborCount; ++j)
+        {
+            const Eigen::Matrix<Scalar, 3, 1> r = Eigen::Matrix<Scalar, 3, 1>::Random();
+            points[size_t(i) * neighborCount + j] = Point(u * r(0) + v * r(1) + normal * (r(2) * noise));
+        }
+    }
+
+    vector<VectorType> reference(count);
+    for (COVARIANCE_SOLVER solver : {ITERATIVE_SOLVER, DIRECT_SOLVER, SMALLEST_EIGENVECTOR_SOLVER})
+    {
+        vector<VectorType> normals(count);
+        int unstable = 0;
+        auto t0 = chrono::steady_clock::now();
+        for (int i = 0; i < count; ++i)
+        {
+            Fit fit;
+            fit.setWeightFunc(WeightFunc(Scalar(2)));
+            fit.setSolver(solver);
+            fit.init(VectorType::Zero());
+            auto begin = points.cbegin() + ptrdiff_t(i) * neighborCount;
+            if (fit.compute(begin, begin + neighborCount) != STABLE) ++unstable;
+            normals[i] = fit.primitiveGradient();
+        }
+        auto t1 = chrono::steady_clock::now();
+
+        if (solver == ITERATIVE_SOLVER) reference = normals;
+        double meanAngle = 0, maxAngle = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            // unoriented angle, accurate for small angles
+            const double angle = std::atan2(double(normals[i].cross(reference[i]).norm()),
+                                            double(std::abs(normals[i].dot(reference[i])))) * 180. / M_PI;
+            meanAngle += angle / count;
+            maxAngle = std::max(maxAngle, angle);
+        }
+
+        const char* names[] = {"iterative", "direct   ", "smallest "};
+        cout << "  " << names[solver] << "\t" << double(count) / chrono::duration<double>(t1 - t0).count()
+             << " fits/s\tangle to iterative: mean " << meanAngle << " deg, max " << maxAngle << " deg"
+             << (unstable ? "\t(" + to_string(unstable) + " unstable)" : string()) << endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int count = argc > 1 ? stoi(argv[1]) : 200000;
+
+    for (float noise : {0.f, 0.01f, 0.1f, 0.9f})
+    {
+        cout << "==== float, noise " << noise << " (" << count << " neighborhoods)" << endl;
+        benchmark<float>(count, noise);
+        cout << "==== double, noise " << noise << " (" << count << " neighborhoods)" << endl;
+        benchmark<double>(count, double(noise));
+    }
+
+    return 0;
+}
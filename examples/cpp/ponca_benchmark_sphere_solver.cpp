@@ -0,0 +1,133 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+\file examples/cpp/ponca_benchmark_sphere_solver.cpp
+\brief Compare the eigenproblem solvers of SphereFit
+
+Usage: ponca_benchmark_sphere_solver [point count]
+Fits the neighborhood of each point of the spheres of the fit_radius_curvature_center test, a perfect one and one with
+noise on the positions, with ITERATIVE_SOLVER and DIRECT_SOLVER. For each solver, prints the number of fits per second
+and the deviation of the radius and center of the stable fits from the sampled sphere. See
+examples/cuda/ponca_benchmark_sphere_solver.cu for the same fits on GPU.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <Ponca/Fitting>
+#include <Ponca/SpatialPartitioning>
+
+#include "Eigen/Eigen"
+
+using namespace std;
+using namespace Ponca;
+
+// This class defines the input data format
+class MyPoint
+{
+public:
+    enum {Dim = 3};
+    typedef double Scalar;
+    typedef Eigen::Matrix<Scalar, Dim, 1>   VectorType;
+    typedef Eigen::Matrix<Scalar, Dim, Dim> MatrixType;
+
+    inline MyPoint(const VectorType& _pos = VectorType::Zero()) : m_pos(_pos) {}
+
+    inline const VectorType& pos() const { return m_pos; }
+
+private:
+    VectorType m_pos;
+};
+
+typedef MyPoint::Scalar Scalar;
+typedef MyPoint::VectorType VectorType;
+
+typedef DistWeightFunc<MyPoint, SmoothWeightKernel<Scalar> > WeightFunc;
+typedef Basket<MyPoint, WeightFunc, SphereFit> Fit;
+
+int main(int argc, char** argv)
+{
+    const int n = argc > 1 ? stoi(argv[1]) : 200000;
+    const Scalar radius = Scalar(5);
+    const VectorType center = VectorType::Constant(Scalar(100));
+
+    // about 64 neighbors per point
+    const Scalar scale = radius * std::sqrt(Scalar(64) * Scalar(4) / Scalar(n));
+
+    for (bool noise : {false, true})
+    {
+        // sampling of getPointOnSphere in the tests, the noise being relative to the scale
+        vector<MyPoint> points(n);
+        for (auto& p : points)
+        {
+            VectorType pos = center + VectorType::Random().normalized() * radius;
+            if (noise)
+                pos += VectorType::Random().normalized() * Eigen::internal::random<Scalar>(Scalar(0), Scalar(0.01) * scale);
+            p = MyPoint(pos);
+        }
+
+        KdTree<MyPoint> tree(points);
+        vector<size_t> offsets;
+        vector<int> neighbors;
+        tree.range_neighbors_batch(scale, offsets, neighbors);
+        cout << "==== " << (noise ? "noisy" : "perfect") << " sphere, " << n << " points, "
+             << double(neighbors.size()) / n << " neighbors per point" << endl;
+
+        for (COVARIANCE_SOLVER solver : {ITERATIVE_SOLVER, DIRECT_SOLVER})
+        {
+            vector<bool> stable(n, false);
+            vector<Scalar> radii(n, Scalar(0));
+            vector<VectorType> centers(n, VectorType::Zero());
+
+            Fit fit;
+            fit.setWeightFunc(WeightFunc(scale));
+            fit.setSolver(solver);
+            auto t0 = chrono::steady_clock::now();
+            for (int i = 0; i < n; ++i)
+            {
+                fit.init(points[i].pos());
+                fit.addNeighbor(points[i]);
+                for (size_t j = offsets[i]; j < offsets[i + 1]; ++j)
+                    fit.addNeighbor(points[neighbors[j]]);
+                stable[i] = fit.finalize() == STABLE;
+                if (stable[i])
+                {
+                    radii[i] = fit.radius();
+                    centers[i] = fit.center();
+                }
+            }
+            auto t1 = chrono::steady_clock::now();
+
+            int stableCount = 0;
+            double meanRadius = 0, maxRadius = 0, meanCenter = 0, maxCenter = 0;
+            for (int i = 0; i < n; ++i)
+            {
+                if (!stable[i])
+                    continue;
+                const double dr = std::abs(radii[i] - radius) / radius;
+                const double dc = (centers[i] - center).norm() / radius;
+                ++stableCount;
+                meanRadius += dr;
+                maxRadius = std::max(maxRadius, dr);
+                meanCenter += dc;
+                maxCenter = std::max(maxCenter, dc);
+            }
+            meanRadius /= std::max(stableCount, 1);
+            meanCenter /= std::max(stableCount, 1);
+
+            cout << "  " << (solver == ITERATIVE_SOLVER ? "iterative" : "direct   ") << "\t"
+                 << double(n) / chrono::duration<double>(t1 - t0).count() << " fits/s\t" << stableCount
+                 << " stable\trelative radius deviation: mean " << meanRadius << ", max " << maxRadius
+                 << "\trelative center deviation: mean " << meanCenter << ", max " << maxCenter << endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+\file examples/cpp/ponca_benchmark_unoriented_solver.cpp
+\brief Compare the eigenproblem solvers of UnorientedSphereFit
+
+Usage: ponca_benchmark_unoriented_solver [point count]
+Fits the neighborhood of each point of a noisy sampled sphere with randomly flipped normals, in the order of the
+KdTree indices, reusing one fit object: the power iterations start from the solution of the previous point. For each
+solver, prints the number of fits per second and the deviation of the curvature and normal from GENERAL_EIGEN_SOLVER.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <Ponca/Fitting>
+#include <Ponca/SpatialPartitioning>
+
+#include "Eigen/Eigen"
+
+using namespace std;
+using namespace Ponca;
+
+// This class defines the input data format
+class MyPoint
+{
+public:
+    enum {Dim = 3};
+    typedef double Scalar;
+    typedef Eigen::Matrix<Scalar, Dim, 1>   VectorType;
+    typedef Eigen::Matrix<Scalar, Dim, Dim> MatrixType;
+
+    inline MyPoint(const VectorType& _pos = VectorType::Zero(), const VectorType& _normal = VectorType::Zero())
+        : m_pos(_pos), m_normal(_normal) {}
+
+    inline const VectorType& pos()    const { return m_pos; }
+    inline const VectorType& normal() const { return m_normal; }
+
+private:
+    VectorType m_pos, m_normal;
+};
+
+typedef MyPoint::Scalar Scalar;
+typedef MyPoint::VectorType VectorType;
+
+typedef DistWeightFunc<MyPoint, SmoothWeightKernel<Scalar> > WeightFunc;
+typedef Basket<MyPoint, WeightFunc, UnorientedSphereFit, GLSParam> Fit;
+
+int main(int argc, char** argv)
+{
+    const int n = argc > 1 ? stoi(argv[1]) : 200000;
+
+    vector<MyPoint> points(n);
+    for (auto& p : points)
+    {
+        const VectorType dir = VectorType::Random().normalized();
+        const VectorType normal = (dir + VectorType::Random() * Scalar(0.05)).normalized();
+        p = MyPoint(dir * (Scalar(1) + Eigen::internal::random<Scalar>(-0.005, 0.005)),
+                    Eigen::internal::random<bool>() ? normal : VectorType(-normal));
+    }
+
+    KdTree<MyPoint> tree(points);
+    // about 64 neighbors per point
+    const Scalar scale = std::sqrt(Scalar(64) * Scalar(4) / Scalar(n));
+    vector<size_t> offsets;
+    vector<int> neighbors;
+    tree.range_neighbors_batch(scale, offsets, neighbors);
+    cout << "==== " << n << " points, " << double(neighbors.size()) / n << " neighbors per point" << endl;
+
+    vector<Scalar> refKappa(n);
+    vector<VectorType> refEta(n);
+    for (UNORIENTED_SPHERE_SOLVER solver : {GENERAL_EIGEN_SOLVER, GENERALIZED_SELFADJOINT_SOLVER, POWER_ITERATION_SOLVER})
+    {
+        vector<Scalar> kappa(n, Scalar(0));
+        vector<VectorType> eta(n, VectorType::Zero());
+
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(scale));
+        fit.setSolver(solver);
+        auto t0 = chrono::steady_clock::now();
+        for (int k = 0; k < tree.index_count(); ++k)
+        {
+            const int i = tree.index_buffer()[k];
+            fit.init(points[i].pos());
+            fit.addNeighbor(points[i]);
+            for (size_t j = offsets[i]; j < offsets[i + 1]; ++j)
+                fit.addNeighbor(points[neighbors[j]]);
+            if (fit.finalize() == STABLE)
+            {
+                kappa[i] = std::abs(fit.kappa());
+                eta[i] = fit.eta().normalized();
+            }
+        }
+        auto t1 = chrono::steady_clock::now();
+
+        if (solver == GENERAL_EIGEN_SOLVER) { refKappa = kappa; refEta = eta; }
+        double meanKappa = 0, maxKappa = 0, meanAngle = 0, maxAngle = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            const double dk = std::abs(kappa[i] - refKappa[i]);
+            const double angle = std::atan2(eta[i].cross(refEta[i]).norm(), std::abs(eta[i].dot(refEta[i]))) * 180. / M_PI;
+            meanKappa += dk / n;
+            maxKappa = std::max(maxKappa, dk);
+            meanAngle += angle / n;
+            maxAngle = std::max(maxAngle, angle);
+        }
+
+        const char* names[] = {"general     ", "generalized ", "power       "};
+        cout << "  " << names[solver] << "\t" << double(n) / chrono::duration<double>(t1 - t0).count()
+             << " fits/s\tkappa deviation: mean " << meanKappa << ", max " << maxKappa
+             << "\tnormal deviation: mean " << meanAngle << " deg, max " << maxAngle << " deg" << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,219 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+\file examples/cuda/pngImage.h
+\brief PNG images of the screen-space examples
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <vector>
+
+#include <png.h>
+
+/**************************************************************************************************/
+/* IO (source: http://zarb.org/~gc/html/libpng.html )                                             */
+/**************************************************************************************************/
+
+class PNGImage
+{
+public:
+  inline bool load(const char *file_name);
+  inline bool loaded () const { return ! row_pointers.empty(); }
+  inline bool save(const char *file_name);
+
+  inline png_uint_32 width()  const { return m_width; };
+  inline png_uint_32 height() const { return m_height; };
+
+  inline const std::vector<png_bytep>& buffer() const { return row_pointers; }
+  inline std::vector<png_bytep>& buffer() { return row_pointers; }
+  inline png_byte colorType() const { return png_get_color_type(png_ptr, info_ptr);}
+
+  ~PNGImage() { for (auto e: row_pointers) delete e; row_pointers.clear(); }
+private:
+  png_uint_32 m_width, m_height;
+  png_byte color_type;
+  png_byte bit_depth;
+
+  png_structp png_ptr;
+  png_infop info_ptr;
+  int number_of_passes;
+  std::vector<png_bytep> row_pointers;
+
+  using vecSizeT = typename std::vector<png_bytep>::size_type;
+};
+
+bool
+PNGImage::load(const char* file_name)
+{
+    unsigned char header[8];    // 8 is the maximum size that can be checked
+
+    /* open file and test for it being a png */
+    FILE *fp = fopen(file_name, "rb");
+    if (!fp)
+    {
+        std::cerr << "[read_png_file] File " \
+                  <<  file_name
+                  << " could not be opened for reading"
+                  << std::endl;
+        return false;
+    }
+
+    fread(header, 1, 8, fp);
+    if (png_sig_cmp(header, 0, 8))
+    {
+        std::cerr << "[read_png_file] File " \
+                  <<  file_name
+                  << " is not recognized as a PNG file"
+                  << std::endl;
+        return false;
+    }
+
+
+    /* initialize stuff */
+    png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+
+    if (!png_ptr)
+    {
+        std::cerr << "[read_png_file] png_create_read_struct failed"
+                  << std::endl;
+        return false;
+    }
+
+    info_ptr = png_create_info_struct(png_ptr);
+    if (!info_ptr)
+    {
+        std::cerr << "[read_png_file] png_create_info_struct failed"
+                  << std::endl;
+        return false;
+    }
+
+    if (setjmp(png_jmpbuf(png_ptr)))
+    {
+        std::cerr << "[read_png_file] Error during init_iod"
+                  << std::endl;
+        return false;
+    }
+
+    png_init_io(png_ptr, fp);
+    png_set_sig_bytes(png_ptr, 8);
+
+    png_read_info(png_ptr, info_ptr);
+
+    m_width = png_get_image_width(png_ptr, info_ptr);
+    m_height = png_get_image_height(png_ptr, info_ptr);
+    color_type = png_get_color_type(png_ptr, info_ptr);
+    bit_depth = png_get_bit_depth(png_ptr, info_ptr);
+
+    number_of_passes = png_set_interlace_handling(png_ptr);
+    png_read_update_info(png_ptr, info_ptr);
+
+
+    /* read file */
+    if (setjmp(png_jmpbuf(png_ptr)))
+    {
+        std::cerr << "[read_png_file] Error during read_image"
+                  << std::endl;
+        return false;
+    }
+
+    row_pointers.resize( m_height );
+    for (vecSizeT y=0; y< vecSizeT(m_height); y++)
+      row_pointers[y] = (png_byte*) (malloc(png_get_rowbytes(png_ptr,info_ptr)));
+
+    png_read_image(png_ptr, row_pointers.data());
+
+    fclose(fp);
+
+    return true;
+}
+
+bool
+PNGImage::save(const char* file_name) {
+  /* create file */
+  FILE *fp = fopen(file_name, "wb");
+  if (!fp)
+  {
+      std::cerr << "[write_png_file] File " \
+                <<  file_name
+                << " could not be opened for reading"
+                << std::endl;
+      return false;
+  }
+
+
+  /* initialize stuff */
+  png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+
+  if (!png_ptr)
+  {
+      std::cerr << "[write_png_file] png_create_write_struct failed"
+                << std::endl;
+      return false;
+  }
+
+  info_ptr = png_create_info_struct(png_ptr);
+  if (!info_ptr)
+  {
+      std::cerr << "[write_png_file] png_create_info_struct failed"
+                << std::endl;
+      return false;
+  }
+
+  if (setjmp(png_jmpbuf(png_ptr)))
+  {
+      std::cerr << "[write_png_file] Error during init_io"
+                << std::endl;
+      return false;
+  }
+
+  png_init_io(png_ptr, fp);
+
+
+  /* write header */
+  if (setjmp(png_jmpbuf(png_ptr)))
+  {
+      std::cerr << "[write_png_file] Error during writing header"
+                << std::endl;
+      return false;
+  }
+
+  png_set_IHDR(png_ptr, info_ptr, m_width, m_height,
+               bit_depth, color_type, PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+
+  png_write_info(png_ptr, info_ptr);
+
+
+  /* write bytes */
+  if (setjmp(png_jmpbuf(png_ptr)))
+  {
+      std::cerr << "[write_png_file] Error during writing bytes"
+                << std::endl;
+      return false;
+  }
+
+  png_write_image(png_ptr, row_pointers.data());
+
+
+  /* end write */
+  if (setjmp(png_jmpbuf(png_ptr)))
+  {
+      std::cerr << "[write_png_file] Error during end of write"
+                << std::endl;
+      return false;
+  }
+
+
+  png_write_end(png_ptr, nullptr);
+
+  fclose(fp);
+  return true;
+}
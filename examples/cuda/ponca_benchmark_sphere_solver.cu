@@ -0,0 +1,234 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+\file examples/cuda/ponca_benchmark_sphere_solver.cu
+\brief Compare the fits of SphereFit on CPU and GPU
+
+Usage: ponca_benchmark_sphere_solver_cuda [point count]
+Fits the neighborhood of each point of the spheres of the fit_radius_curvature_center test, a perfect one and one with
+noise on the positions, in single precision with DIRECT_SOLVER: on CPU, and on GPU with one thread per fit, the
+neighborhoods being either gathered on CPU or queried in a KdTreeDeviceView built on GPU. Prints the number of fits per second (kernel only on GPU), the deviation of the
+radius of the stable fits from the sampled sphere, and the largest difference of the GPU and CPU radii. See
+examples/cpp/ponca_benchmark_sphere_solver.cpp for the comparison with ITERATIVE_SOLVER, not compiled by nvcc.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#define EIGEN_DEFAULT_DENSE_INDEX_TYPE int
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/sphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <cuda_runtime.h>
+
+using namespace std;
+
+// This class defines the input data format, on host and device
+class MyPoint
+{
+public:
+    enum {Dim = 3};
+    typedef float Scalar;
+    typedef Eigen::Matrix<Scalar, Dim, 1>   VectorType;
+    typedef Eigen::Matrix<Scalar, Dim, Dim> MatrixType;
+
+    PONCA_MULTIARCH inline MyPoint(const VectorType& _pos = VectorType::Zero()) : m_pos(_pos) {}
+
+    PONCA_MULTIARCH inline const VectorType& pos() const { return m_pos; }
+
+private:
+    VectorType m_pos;
+};
+
+typedef MyPoint::Scalar Scalar;
+typedef MyPoint::VectorType VectorType;
+
+typedef Ponca::DistWeightFunc<MyPoint, Ponca::SmoothWeightKernel<Scalar> > WeightFunc;
+typedef Ponca::Basket<MyPoint, WeightFunc, Ponca::SphereFit> Fit;
+
+// Fit the neighborhood of a point, writes the radius of the stable fits and 0 otherwise
+PONCA_MULTIARCH inline Scalar fitRadius(Fit& fit, const MyPoint* points, const int* offsets, const int* neighbors,
+                                        int i)
+{
+    fit.init(points[i].pos());
+    fit.addNeighbor(points[i]);
+    for (int j = offsets[i]; j < offsets[i + 1]; ++j)
+        fit.addNeighbor(points[neighbors[j]]);
+    return fit.finalize() == Ponca::STABLE ? fit.radius() : Scalar(0);
+}
+
+__global__ void fitKernel(const MyPoint* points, const int* offsets, const int* neighbors, int n, Scalar scale,
+                          Scalar* radii)
+{
+    const int i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i >= n)
+        return;
+
+    Fit fit; // DIRECT_SOLVER, the only one on GPU
+    fit.setWeightFunc(WeightFunc(scale));
+    radii[i] = fitRadius(fit, points, offsets, neighbors, i);
+}
+
+// Fit the neighborhood of each point, queried in a tree built on the device
+__global__ void fitTreeKernel(Ponca::KdTreeDeviceView<MyPoint> tree, Scalar scale, Scalar* radii)
+{
+    const int i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i >= tree.point_count)
+        return;
+
+    Fit fit;
+    fit.setWeightFunc(WeightFunc(scale));
+    const VectorType& p = tree.points[i].pos();
+    fit.init(p);
+    tree.range_neighbors(p, scale, [&](int j, Scalar) { fit.addNeighbor(tree.points[j]); });
+    radii[i] = fit.finalize() == Ponca::STABLE ? fit.radius() : Scalar(0);
+}
+
+// Mean and largest deviation of the non-null radii from `radius`, and number of stable fits
+void printDeviation(const char* name, double fitsPerSecond, const vector<Scalar>& radii, Scalar radius)
+{
+    int stable = 0;
+    double mean = 0, max = 0;
+    for (Scalar r : radii)
+    {
+        if (r == Scalar(0))
+            continue;
+        const double d = std::abs(r - radius) / radius;
+        ++stable;
+        mean += d;
+        max = std::max(max, d);
+    }
+    cout << "  " << name << "\t" << fitsPerSecond << " fits/s\t" << stable
+         << " stable\trelative radius deviation: mean " << mean / std::max(stable, 1) << ", max " << max << endl;
+}
+
+int main(int argc, char** argv)
+{
+    const int n = argc > 1 ? stoi(argv[1]) : 200000;
+    const Scalar radius = Scalar(5);
+    const VectorType center = VectorType::Constant(Scalar(100));
+    // about 64 neighbors per point
+    const Scalar scale = radius * std::sqrt(Scalar(64) * Scalar(4) / Scalar(n));
+
+    for (bool noise : {false, true})
+    {
+        // sampling of getPointOnSphere in the tests, the noise being relative to the scale
+        vector<MyPoint> points(n);
+        for (auto& p : points)
+        {
+            VectorType pos = center + VectorType::Random().normalized() * radius;
+            if (noise)
+                pos += VectorType::Random().normalized() * Eigen::internal::random<Scalar>(Scalar(0), Scalar(0.01) * scale);
+            p = MyPoint(pos);
+        }
+
+        Ponca::KdTree<MyPoint> tree(points);
+        vector<size_t> offsets64;
+        vector<int> neighbors;
+        tree.range_neighbors_batch(scale, offsets64, neighbors);
+        const vector<int> offsets(offsets64.begin(), offsets64.end());
+        cout << "==== " << (noise ? "noisy" : "perfect") << " sphere, " << n << " points, "
+             << double(neighbors.size()) / n << " neighbors per point" << endl;
+
+        // CPU, with DIRECT_SOLVER as on GPU: the iterative solver is not compiled by nvcc
+        vector<Scalar> directRadii(n);
+        {
+            Fit fit;
+            fit.setWeightFunc(WeightFunc(scale));
+            auto t0 = chrono::steady_clock::now();
+            for (int i = 0; i < n; ++i)
+                directRadii[i] = fitRadius(fit, points.data(), offsets.data(), neighbors.data(), i);
+            auto t1 = chrono::steady_clock::now();
+            printDeviation("CPU direct", double(n) / chrono::duration<double>(t1 - t0).count(), directRadii, radius);
+        }
+
+        // GPU
+        MyPoint* devPoints;
+        int *devOffsets, *devNeighbors;
+        Scalar* devRadii;
+        cudaMalloc(&devPoints, n * sizeof(MyPoint));
+        cudaMalloc(&devOffsets, offsets.size() * sizeof(int));
+        cudaMalloc(&devNeighbors, std::max<size_t>(neighbors.size(), 1) * sizeof(int));
+        cudaMalloc(&devRadii, n * sizeof(Scalar));
+        cudaMemcpy(devPoints, points.data(), n * sizeof(MyPoint), cudaMemcpyHostToDevice);
+        cudaMemcpy(devOffsets, offsets.data(), offsets.size() * sizeof(int), cudaMemcpyHostToDevice);
+        cudaMemcpy(devNeighbors, neighbors.data(), neighbors.size() * sizeof(int), cudaMemcpyHostToDevice);
+
+        const int blockSize = 128, blocks = (n + blockSize - 1) / blockSize;
+        cudaEvent_t start, stop;
+        cudaEventCreate(&start);
+        cudaEventCreate(&stop);
+        // dry run: first call is always slower
+        fitKernel<<<blocks, blockSize>>>(devPoints, devOffsets, devNeighbors, n, scale, devRadii);
+        cudaEventRecord(start);
+        fitKernel<<<blocks, blockSize>>>(devPoints, devOffsets, devNeighbors, n, scale, devRadii);
+        cudaEventRecord(stop);
+        cudaEventSynchronize(stop);
+        float milliseconds = 0;
+        cudaEventElapsedTime(&milliseconds, start, stop);
+        const cudaError_t error = cudaGetLastError();
+        if (error != cudaSuccess)
+        {
+            cerr << "Kernel failed: " << cudaGetErrorString(error) << endl;
+            return EXIT_FAILURE;
+        }
+
+        vector<Scalar> radii(n);
+        cudaMemcpy(radii.data(), devRadii, n * sizeof(Scalar), cudaMemcpyDeviceToHost);
+        printDeviation("GPU direct", double(n) / (milliseconds * 1e-3), radii, radius);
+        double difference = 0;
+        for (int i = 0; i < n; ++i)
+            difference = std::max(difference, double(std::abs(radii[i] - directRadii[i])) / radius);
+        cout << "  largest relative difference of the GPU and CPU direct radii: " << difference << endl;
+
+        // GPU, the neighborhoods being queried in a tree built on the device
+        {
+            Ponca::KdTreeDeviceBuffers<MyPoint> tree;
+            auto t0 = chrono::steady_clock::now();
+            const bool built = tree.build(points.data(), n);
+            auto t1 = chrono::steady_clock::now();
+            if (!built)
+            {
+                cerr << "Device tree build failed" << endl;
+                return EXIT_FAILURE;
+            }
+            cout << "  GPU tree build: " << chrono::duration<double, milli>(t1 - t0).count() << " ms, "
+                 << tree.view.node_count << " nodes" << endl;
+
+            cudaEventRecord(start);
+            fitTreeKernel<<<blocks, blockSize>>>(tree.view, scale, devRadii);
+            cudaEventRecord(stop);
+            cudaEventSynchronize(stop);
+            cudaEventElapsedTime(&milliseconds, start, stop);
+            const cudaError_t treeError = cudaGetLastError();
+            if (treeError != cudaSuccess)
+            {
+                cerr << "Kernel failed: " << cudaGetErrorString(treeError) << endl;
+                return EXIT_FAILURE;
+            }
+            cudaMemcpy(radii.data(), devRadii, n * sizeof(Scalar), cudaMemcpyDeviceToHost);
+            printDeviation("GPU tree", double(n) / (milliseconds * 1e-3), radii, radius);
+        }
+
+        cudaEventDestroy(start);
+        cudaEventDestroy(stop);
+        cudaFree(devPoints);
+        cudaFree(devOffsets);
+        cudaFree(devNeighbors);
+        cudaFree(devRadii);
+    }
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+\file examples/cuda/ponca_benchmark_ssgls_tiling.cu
+\brief Compare the screen-space GLS kernels reading the neighborhoods from global memory and from shared memory tiles
+
+Usage: ponca_benchmark_ssgls_tiling [run count]
+Computes the screen-space curvature of the ssgls_sample images for several scales, in pixels. For each scale, prints
+the time of a launch (uploads, kernel and download) with each kernel, and the largest difference of their results.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "pngImage.h"
+
+#define EIGEN_DEFAULT_DENSE_INDEX_TYPE int
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/screenSpaceCuda.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+using namespace std;
+
+typedef Ponca::ScreenSpacePoint<float> Point;
+typedef Point::Scalar Scalar;
+typedef Ponca::ProjectedWeightFunc<Point, Ponca::SmoothWeightKernel<Scalar> > WeightFunc;
+typedef Ponca::Basket<Point, WeightFunc, Ponca::OrientedSphereFit, Ponca::GLSParam> ScreenSpaceFit;
+typedef Ponca::ScreenSpaceFitter<ScreenSpaceFit> Fitter;
+
+struct Curvature
+{
+    PONCA_MULTIARCH inline Scalar operator()(const ScreenSpaceFit& _fit, Ponca::FIT_RESULT _res) const
+    {
+        return _res == Ponca::UNDEFINED ? Scalar(0) : _fit.kappa();
+    }
+};
+
+// Copy the positions and normals of the images in the buffers of the fitter, remapped to [-1, 1]
+bool load(const PNGImage& positions, const PNGImage& normals, Fitter& fitter)
+{
+    if (positions.colorType() != PNG_COLOR_TYPE_RGB || normals.colorType() != PNG_COLOR_TYPE_RGB)
+    {
+        cerr << "The images must be RGB" << endl;
+        return false;
+    }
+    const int width = positions.width(), height = positions.height();
+    if (fitter.resize(width, height) != cudaSuccess)
+    {
+        cerr << "Cannot allocate the buffers" << endl;
+        return false;
+    }
+
+    auto scaleValues = [](const png_byte& in){ return in / 255.f * 2.f - 1.f; };
+    for (int j = 0; j < height; ++j)
+    {
+        transform(positions.buffer()[j], positions.buffer()[j] + width * 3, fitter.positions() + j * width * 3, scaleValues);
+        transform(normals.buffer()[j],   normals.buffer()[j]   + width * 3, fitter.normals()   + j * width * 3, scaleValues);
+    }
+    return true;
+}
+
+// Average time of a launch, in milliseconds, and copy of the results
+double benchmark(Fitter& fitter, int scale, int runs, vector<Scalar>& results)
+{
+    // dry run: first call is always slower
+    fitter.launch(scale, 0.f, Curvature());
+    fitter.synchronize();
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i != runs; ++i)
+    {
+        fitter.launch(scale, 0.f, Curvature());
+        fitter.synchronize();
+    }
+    auto end = chrono::steady_clock::now();
+
+    results.assign(fitter.results(), fitter.results() + fitter.width() * fitter.height());
+    return chrono::duration<double, milli>(end - start).count() / runs;
+}
+
+int main(int argc, char** argv)
+{
+    const int runs = argc > 1 ? atoi(argv[1]) : 20;
+
+    PNGImage positions, normals;
+    if (!positions.load("./data/ssgls_sample_wc.png") || !normals.load("./data/ssgls_sample_normal.png"))
+        return EXIT_FAILURE;
+
+    Fitter fitter;
+    if (!load(positions, normals, fitter))
+        return EXIT_FAILURE;
+
+    cout << "Image size: " << fitter.width() << "*" << fitter.height() << ", " << runs << " runs" << endl;
+    cout << "scale\tglobal (ms)\ttiled (ms)\tspeedup\tmax difference" << endl;
+
+    vector<Scalar> global, tiled;
+    for (int scale : {2, 4, 6, 8, 10, 12, 16, 20, 24})
+    {
+        fitter.setTiling(false);
+        const double globalTime = benchmark(fitter, scale, runs, global);
+
+        fitter.setTiling(true);
+        if (!fitter.isTiled(scale))
+        {
+            cout << scale << "\t" << globalTime << "\t-\t-\t- (tile larger than the shared memory)" << endl;
+            continue;
+        }
+        const double tiledTime = benchmark(fitter, scale, runs, tiled);
+
+        Scalar difference = 0;
+        for (size_t i = 0; i != global.size(); ++i)
+            if (!std::isnan(global[i]) && !std::isnan(tiled[i]))
+                difference = max(difference, std::abs(global[i] - tiled[i]));
+
+        cout << scale << "\t" << globalTime << "\t" << tiledTime << "\t" << globalTime / tiledTime << "\t"
+             << difference << endl;
+    }
+
+    if (cudaGetLastError() != cudaSuccess)
+    {
+        cerr << "The launches failed" << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
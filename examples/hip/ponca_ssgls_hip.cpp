@@ -0,0 +1,161 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+\file examples/hip/ponca_ssgls_hip.cpp
+\brief Screen space GLS using c++/HIP, on AMD GPUs
+*/
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+
+#include "../cuda/pngImage.h"
+
+#define EIGEN_DEFAULT_DENSE_INDEX_TYPE int
+
+#include <hip/hip_runtime.h>
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/screenSpace.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+
+typedef Ponca::ScreenSpacePoint<float> Point;
+typedef Point::Scalar Scalar;
+typedef Ponca::ProjectedWeightFunc<Point, Ponca::SmoothWeightKernel<Scalar> > WeightFunc;
+typedef Ponca::Basket<Point, WeightFunc, Ponca::OrientedSphereFit, Ponca::GLSParam> ScreenSpaceFit;
+
+//! [kernel]
+// One thread per pixel, as the CUDA doGLS_kernel: the Basket is the same, PONCA_MULTIARCH expanding to
+// __host__ __device__ with hipcc
+__global__ void doGLS_kernel(int _width, int _height, int _scale, Scalar _maxDepthDiff,
+                             const Scalar* _positions, const Scalar* _normals, Scalar* _result)
+{
+    const int x = blockIdx.x * blockDim.x + threadIdx.x;
+    const int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if (x >= _width || y >= _height)
+        return;
+
+    ScreenSpaceFit fit;
+    const Ponca::FIT_RESULT res = Ponca::fitScreenSpacePixel(fit, x, y, _width, _height, _scale, _maxDepthDiff,
+                                                             _positions, _normals);
+    _result[x + y * _width] = res == Ponca::UNDEFINED ? Scalar(0) : fit.kappa();
+}
+//! [kernel]
+
+/**
+* \brief Load the positions and normals of the pixels, remapped to [-1, 1]
+*/
+bool initInputDatas(const PNGImage& _image, std::vector<Scalar>& _values)
+{
+    if (_image.colorType() != PNG_COLOR_TYPE_RGB)
+    {
+        std::cerr << "color_type of input file must be PNG_COLOR_TYPE_RGB" << std::endl;
+        return false;
+    }
+
+    const int width = _image.width();
+    const int height = _image.height();
+    _values.resize(size_t(width) * size_t(height) * 3);
+
+    const auto& buf = _image.buffer();
+    for (int j = 0; j < height; ++j)
+        std::transform(buf[j], buf[j] + width * 3, _values.data() + size_t(j) * width * 3,
+                       [](const png_byte& in){ return in / 255.f * 2.f - 1.f; });
+    return true;
+}
+
+/**
+* \brief Save the curvatures as grey levels, clamped to [-10, 10]
+*/
+bool saveResult(const std::vector<Scalar>& _results, const char* _positionsFilename, const char* _resultFilename)
+{
+    PNGImage result;
+    if (!result.load(_positionsFilename))
+        return false;
+
+    const int width = result.width();
+    const int height = result.height();
+    auto pbuf = result.buffer().data();
+    for (int j = 0; j < height; ++j)
+    {
+        for (int i = 0; i < width; ++i)
+        {
+            const float value = _results[i + size_t(j) * width];
+            const float grey = std::isnan(value) ? 0.5f : (std::min(std::max(value, -10.f), 10.f) + 10.f) / 20.f;
+            std::fill(pbuf[j] + i * 3, pbuf[j] + i * 3 + 3, png_byte(grey * 255.f));
+        }
+    }
+    return result.save(_resultFilename);
+}
+
+int main()
+{
+    const char *positionsFilename = "./data/ssgls_sample_wc.png";
+    const char *normalsFilename = "./data/ssgls_sample_normal.png";
+    const char *resultFilename = "./ssgls_hip_results.png";
+
+    PNGImage positions, normals;
+    std::vector<Scalar> hostPositions, hostNormals;
+    if (!positions.load(positionsFilename) || !normals.load(normalsFilename) ||
+        !initInputDatas(positions, hostPositions) || !initInputDatas(normals, hostNormals))
+    {
+        return 0;
+    }
+
+    const int width = positions.width();
+    const int height = positions.height();
+    const size_t bytes = hostPositions.size() * sizeof(Scalar);
+    const int scale = 10;
+    const Scalar maxDepthDiff = 0.f;
+
+    //! [launch]
+    Scalar *devPositions = nullptr, *devNormals = nullptr, *devResults = nullptr;
+    if (hipMalloc(&devPositions, bytes) != hipSuccess || hipMalloc(&devNormals, bytes) != hipSuccess ||
+        hipMalloc(&devResults, bytes / 3) != hipSuccess)
+    {
+        std::cerr << "Cannot allocate the device buffers" << std::endl;
+        return 0;
+    }
+    hipMemcpy(devPositions, hostPositions.data(), bytes, hipMemcpyHostToDevice);
+    hipMemcpy(devNormals, hostNormals.data(), bytes, hipMemcpyHostToDevice);
+
+    const dim3 block(16, 16);
+    const dim3 grid((width + block.x - 1) / block.x, (height + block.y - 1) / block.y);
+
+    const auto start = std::chrono::system_clock::now();
+    hipLaunchKernelGGL(doGLS_kernel, grid, block, 0, 0,
+                       width, height, scale, maxDepthDiff, devPositions, devNormals, devResults);
+    hipDeviceSynchronize();
+    const std::chrono::duration<double> diff = std::chrono::system_clock::now() - start;
+    //! [launch]
+
+    if (hipGetLastError() != hipSuccess)
+    {
+        std::cerr << "ssCurvature failed" << std::endl;
+        return 0;
+    }
+    std::cout << "ssCurvature completed in " << diff.count() << " s" << std::endl;
+
+    std::vector<Scalar> results(size_t(width) * size_t(height));
+    hipMemcpy(results.data(), devResults, bytes / 3, hipMemcpyDeviceToHost);
+    hipFree(devPositions);
+    hipFree(devNormals);
+    hipFree(devResults);
+
+    if (!saveResult(results, positionsFilename, resultFilename))
+    {
+        std::cerr << "Cannot save image" << std::endl;
+    }
+
+    return 0;
+}
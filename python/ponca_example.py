@@ -0,0 +1,33 @@
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+"""Curvature of a noisy sphere with the Python bindings of Ponca.
+
+Build with -DPONCA_CONFIGURE_PYTHON=ON, then run from the build directory:
+    python3 ponca_example.py
+"""
+
+import numpy as np
+import ponca
+
+#! [fit]
+rng = np.random.default_rng(0)
+normals = rng.normal(size=(100000, 3))
+normals /= np.linalg.norm(normals, axis=1)[:, None]
+radius = 2.0
+positions = normals * (radius + rng.normal(scale=1e-3, size=(len(normals), 1)))
+
+# the arrays are read in place: float64, C-contiguous, shape (n, 3)
+tree = ponca.KdTree(positions)
+scale = 0.2
+offsets, indices, _ = tree.range_neighbors(positions, scale)
+fits = ponca.fit_oriented_spheres(positions, normals, offsets, indices, scale)
+#! [fit]
+
+stable = fits["status"] == int(ponca.FitResult.STABLE)
+print("stable fits: %d / %d" % (stable.sum(), len(positions)))
+print("mean curvature: %f (expected %f)" % (fits["kappa"][stable].mean(), 1.0 / radius))
+
+k_indices, k_squared_distances = tree.k_nearest_neighbors(16)
+print("mean distance to the 16th neighbor: %f" % np.sqrt(k_squared_distances[:, -1]).mean())
@@ -0,0 +1,397 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+ \file python/ponca_python.cpp
+ \brief Python bindings of the KdTree and of prebuilt fits, reading NumPy arrays without copy
+ */
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/unorientedSphereFit.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/csrNeighborhoods.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace
+{
+
+typedef double Scalar;
+enum {Dim = 3};
+typedef Eigen::Matrix<Scalar, Dim, 1> VectorType;
+typedef Eigen::Matrix<Scalar, Dim, Dim> MatrixType;
+
+/// NumPy arrays of positions or normals, `(n, 3)` float64. Other dtypes and non-contiguous arrays are converted,
+/// the others are read in place.
+typedef py::array_t<Scalar, py::array::c_style | py::array::forcecast> ScalarArray;
+typedef py::array_t<std::size_t, py::array::c_style | py::array::forcecast> OffsetArray;
+typedef py::array_t<int, py::array::c_style | py::array::forcecast> IndexArray;
+
+/*
+   \brief Point of the KdTree: a row of the NumPy array of the positions
+
+   The array is used as a buffer of PositionPoint by KdTree::build_view, without copy.
+ */
+class PositionPoint
+{
+public:
+    enum {Dim = ::Dim};
+    typedef ::Scalar Scalar;
+    typedef ::VectorType VectorType;
+    typedef ::MatrixType MatrixType;
+
+    inline PositionPoint(const VectorType& _pos = VectorType::Zero()) : m_pos(_pos) {}
+    inline const VectorType& pos() const { return m_pos; }
+
+private:
+    VectorType m_pos;
+};
+static_assert(sizeof(PositionPoint) == Dim * sizeof(Scalar), "PositionPoint must map a row of the position array");
+
+/*
+   \brief Point of the fits, built on the fly from the rows of the position and normal arrays (see
+   fitCsrNeighborhood)
+ */
+class FitPoint
+{
+public:
+    enum {Dim = ::Dim};
+    typedef ::Scalar Scalar;
+    typedef ::VectorType VectorType;
+    typedef ::MatrixType MatrixType;
+
+    inline FitPoint(const VectorType& _pos = VectorType::Zero(), const VectorType& _normal = VectorType::Zero())
+        : m_pos(_pos), m_normal(_normal) {}
+    inline const VectorType& pos()    const { return m_pos; }
+    inline const VectorType& normal() const { return m_normal; }
+
+private:
+    VectorType m_pos, m_normal;
+};
+
+typedef Ponca::DistWeightFunc<FitPoint, Ponca::SmoothWeightKernel<Scalar> > WeightFunc;
+typedef Ponca::Basket<FitPoint, WeightFunc, Ponca::OrientedSphereFit,   Ponca::GLSParam> OrientedSphereFit;
+typedef Ponca::Basket<FitPoint, WeightFunc, Ponca::UnorientedSphereFit, Ponca::GLSParam> UnorientedSphereFit;
+typedef Ponca::Basket<FitPoint, WeightFunc, Ponca::CovariancePlaneFit> PlaneFit;
+
+typedef Ponca::KdTree<PositionPoint> Tree;
+
+/// Rows of an `(n, 3)` array, as the containers of positions read by the batch queries of the KdTree
+struct PositionRows
+{
+    const VectorType* rows;
+    std::size_t count;
+
+    inline std::size_t size() const { return count; }
+    inline const VectorType& operator[](std::size_t _i) const { return rows[_i]; }
+};
+
+/// Check that `_array` stores `(n, 3)` positions, and map its rows
+PositionRows positionRows(const ScalarArray& _array, const char* _name)
+{
+    if (_array.ndim() != 2 || _array.shape(1) != Dim)
+        throw py::value_error(std::string(_name) + " must be an array of shape (n, 3)");
+    return {reinterpret_cast<const VectorType*>(_array.data()), std::size_t(_array.shape(0))};
+}
+
+/// Give the ownership of `_values` to a NumPy array of shape `_shape`, without copy
+template <typename T>
+py::array_t<T> toArray(std::vector<T>&& _values, std::vector<py::ssize_t> _shape)
+{
+    auto* values = new std::vector<T>(std::move(_values));
+    py::capsule owner(values, [](void* _v) { delete static_cast<std::vector<T>*>(_v); });
+    return py::array_t<T>(std::move(_shape), values->data(), owner);
+}
+
+/*
+   \brief KdTree over the rows of a NumPy array
+
+   The array is referenced, not copied: it must not be modified while the tree is used.
+ */
+class PyKdTree
+{
+public:
+    PyKdTree(const ScalarArray& _points, int _minCellSize, bool _parallel)
+        : m_points(_points)
+    {
+        const PositionRows rows = positionRows(m_points, "points");
+        m_tree.set_min_cell_size(_minCellSize);
+        m_tree.set_parallel_build(_parallel);
+
+        py::gil_scoped_release release;
+        m_tree.build_view(reinterpret_cast<const PositionPoint*>(rows.rows), int(rows.count));
+    }
+
+    int pointCount() const { return m_tree.point_count(); }
+    int nodeCount()  const { return m_tree.node_count(); }
+
+    /// `k` nearest neighbors of each query, as `(m, k)` arrays of indices and squared distances
+    py::tuple kNearestNeighbors(const ScalarArray& _queries, int _k) const
+    {
+        const PositionRows rows = positionRows(_queries, "queries");
+        checkK(_k);
+        std::vector<int> indices(rows.count * std::size_t(_k));
+        std::vector<Scalar> squaredDistances(indices.size());
+        {
+            py::gil_scoped_release release;
+            m_tree.k_nearest_neighbors_batch(rows, _k, indices.data(), squaredDistances.data());
+        }
+        const std::vector<py::ssize_t> shape {py::ssize_t(rows.count), _k};
+        return py::make_tuple(toArray(std::move(indices), shape), toArray(std::move(squaredDistances), shape));
+    }
+
+    /// `k` nearest neighbors of each point of the tree, excluding the point itself
+    py::tuple kNearestNeighborsSelf(int _k) const
+    {
+        checkK(_k);
+        const std::size_t count = std::size_t(m_tree.point_count());
+        std::vector<int> indices(count * std::size_t(_k));
+        std::vector<Scalar> squaredDistances(indices.size());
+        {
+            py::gil_scoped_release release;
+            m_tree.k_nearest_neighbors_batch(_k, indices.data(), squaredDistances.data());
+        }
+        const std::vector<py::ssize_t> shape {py::ssize_t(count), _k};
+        return py::make_tuple(toArray(std::move(indices), shape), toArray(std::move(squaredDistances), shape));
+    }
+
+    /// Neighbors of each query within the radius `_r`, in CSR format: offsets, indices and squared distances
+    py::tuple rangeNeighbors(const ScalarArray& _queries, Scalar _r) const
+    {
+        const PositionRows rows = positionRows(_queries, "queries");
+        std::vector<std::size_t> offsets;
+        std::vector<int> indices;
+        std::vector<Scalar> squaredDistances;
+        {
+            py::gil_scoped_release release;
+            m_tree.range_neighbors_batch(rows, _r, offsets, indices, &squaredDistances);
+        }
+        return csr(std::move(offsets), std::move(indices), std::move(squaredDistances));
+    }
+
+    /// Neighbors of each point of the tree within the radius `_r`, excluding the point itself
+    py::tuple rangeNeighborsSelf(Scalar _r) const
+    {
+        std::vector<std::size_t> offsets;
+        std::vector<int> indices;
+        std::vector<Scalar> squaredDistances;
+        {
+            py::gil_scoped_release release;
+            m_tree.range_neighbors_batch(_r, offsets, indices, &squaredDistances);
+        }
+        return csr(std::move(offsets), std::move(indices), std::move(squaredDistances));
+    }
+
+private:
+    static void checkK(int _k)
+    {
+        if (_k <= 0)
+            throw py::value_error("k must be positive");
+    }
+
+    static py::tuple csr(std::vector<std::size_t>&& _offsets, std::vector<int>&& _indices,
+                         std::vector<Scalar>&& _squaredDistances)
+    {
+        const py::ssize_t offsetCount = py::ssize_t(_offsets.size()), count = py::ssize_t(_indices.size());
+        return py::make_tuple(toArray(std::move(_offsets), {offsetCount}), toArray(std::move(_indices), {count}),
+                              toArray(std::move(_squaredDistances), {count}));
+    }
+
+    ScalarArray m_points; ///< Keeps the viewed array alive
+    Tree m_tree;
+};
+
+/// CSR neighborhoods given to the fits, and the arrays they read
+struct CsrInput
+{
+    ScalarArray queries; ///< Converted queries, empty when the neighborhoods are fitted at the points
+    Ponca::CsrNeighborhoods<Scalar> neighborhoods;
+
+    /// Evaluation position of the neighborhood `_i`
+    inline VectorType evalPosition(int _i) const
+    {
+        const Scalar* base = neighborhoods.queries ? neighborhoods.queries : neighborhoods.positions;
+        return Eigen::Map<const VectorType>(base + Dim * _i);
+    }
+};
+
+/// Check the arrays describing CSR neighborhoods, fitted at `_queries` or at the points when it is None
+CsrInput csrInput(const ScalarArray& _positions, const ScalarArray& _normals, const py::object& _queries,
+                  const OffsetArray& _offsets, const IndexArray& _indices)
+{
+    const PositionRows positions = positionRows(_positions, "positions");
+    if (positionRows(_normals, "normals").count != positions.count)
+        throw py::value_error("positions and normals must have the same shape");
+    if (_offsets.ndim() != 1 || _offsets.shape(0) < 1 || _indices.ndim() != 1)
+        throw py::value_error("offsets and indices must be 1D arrays, offsets holding one more element than the "
+                              "evaluation points");
+
+    const int count = int(_offsets.shape(0)) - 1;
+    if (_offsets.data()[count] != std::size_t(_indices.shape(0)))
+        throw py::value_error("the last offset must be the number of indices");
+
+    CsrInput input;
+    if (!_queries.is_none())
+    {
+        input.queries = ScalarArray::ensure(_queries);
+        if (!input.queries || positionRows(input.queries, "queries").count != std::size_t(count))
+            throw py::value_error("queries must hold one position per neighborhood");
+    }
+    else if (std::size_t(count) != positions.count)
+        throw py::value_error("offsets must describe one neighborhood per point when queries is None");
+
+    input.neighborhoods = {_positions.data(), _normals.data(), _queries.is_none() ? nullptr : input.queries.data(),
+                           _offsets.data(), _indices.data(), count};
+    return input;
+}
+
+/// Array of `_shape` filled with NaN, the value of the outputs of the unstable fits
+py::array_t<Scalar> nanArray(std::vector<py::ssize_t> _shape)
+{
+    py::array_t<Scalar> array(std::move(_shape));
+    std::fill(array.mutable_data(), array.mutable_data() + array.size(), std::numeric_limits<Scalar>::quiet_NaN());
+    return array;
+}
+
+/*
+   \brief Fit the neighborhoods of `_input` at the scale `_scale` in parallel, without the GIL, and call
+   `_write(i, fit)` for each evaluation point `i` whose fit is stable
+
+   \return The FIT_RESULT of each evaluation point
+ */
+template <typename Fit, typename Writer>
+py::array_t<std::int8_t> fitCsr(const CsrInput& _input, Scalar _scale, const Writer& _write)
+{
+    const Ponca::CsrNeighborhoods<Scalar>& nei = _input.neighborhoods;
+    py::array_t<std::int8_t> status(nei.count);
+    std::int8_t* statusData = status.mutable_data();
+
+    py::gil_scoped_release release;
+    const WeightFunc w(_scale);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < nei.count; ++i)
+    {
+        Fit fit;
+        const Ponca::FIT_RESULT res = Ponca::fitCsrNeighborhood(fit, i, w, nei);
+        statusData[i] = std::int8_t(res);
+        if (res == Ponca::STABLE)
+            _write(i, fit);
+    }
+    return status;
+}
+
+/// Output arrays of the sphere fits, NaN for the unstable fits
+template <typename Fit>
+py::dict fitSpheres(const ScalarArray& _positions, const ScalarArray& _normals, const OffsetArray& _offsets,
+                    const IndexArray& _indices, Scalar _scale, const py::object& _queries)
+{
+    const CsrInput input = csrInput(_positions, _normals, _queries, _offsets, _indices);
+    const py::ssize_t count = input.neighborhoods.count;
+    py::array_t<Scalar> tau = nanArray({count}), kappa = nanArray({count}), eta = nanArray({count, Dim}),
+                        projection = nanArray({count, Dim});
+    Scalar *tauData = tau.mutable_data(), *kappaData = kappa.mutable_data(), *etaData = eta.mutable_data(),
+           *projectionData = projection.mutable_data();
+
+    py::dict result;
+    result["status"] = fitCsr<Fit>(input, _scale, [&](int _i, const Fit& _fit)
+    {
+        tauData[_i] = _fit.tau();
+        kappaData[_i] = _fit.kappa();
+        Eigen::Map<VectorType>(etaData + Dim * _i) = _fit.eta();
+        Eigen::Map<VectorType>(projectionData + Dim * _i) = _fit.project(input.evalPosition(_i));
+    });
+    result["tau"] = tau;
+    result["eta"] = eta;
+    result["kappa"] = kappa;
+    result["projection"] = projection;
+    return result;
+}
+
+/// Output arrays of the plane fits, NaN for the unstable fits
+py::dict fitPlanes(const ScalarArray& _positions, const OffsetArray& _offsets, const IndexArray& _indices,
+                   Scalar _scale, const py::object& _queries)
+{
+    // the covariance fit ignores the normals: the positions are passed in their place
+    const CsrInput input = csrInput(_positions, _positions, _queries, _offsets, _indices);
+    const py::ssize_t count = input.neighborhoods.count;
+    py::array_t<Scalar> variation = nanArray({count}), normal = nanArray({count, Dim}),
+                        projection = nanArray({count, Dim});
+    Scalar *variationData = variation.mutable_data(), *normalData = normal.mutable_data(),
+           *projectionData = projection.mutable_data();
+
+    py::dict result;
+    result["status"] = fitCsr<PlaneFit>(input, _scale, [&](int _i, const PlaneFit& _fit)
+    {
+        const VectorType q = input.evalPosition(_i);
+        variationData[_i] = _fit.surfaceVariation();
+        Eigen::Map<VectorType>(normalData + Dim * _i) = _fit.primitiveGradient(q);
+        Eigen::Map<VectorType>(projectionData + Dim * _i) = _fit.project(q);
+    });
+    result["normal"] = normal;
+    result["surface_variation"] = variation;
+    result["projection"] = projection;
+    return result;
+}
+
+} // namespace
+
+PYBIND11_MODULE(ponca, m)
+{
+    m.doc() = "Ponca point cloud analysis: KdTree queries and fits of NumPy arrays";
+
+    py::enum_<Ponca::FIT_RESULT>(m, "FitResult")
+        .value("STABLE", Ponca::STABLE)
+        .value("UNSTABLE", Ponca::UNSTABLE)
+        .value("UNDEFINED", Ponca::UNDEFINED)
+        .value("NEED_OTHER_PASS", Ponca::NEED_OTHER_PASS);
+
+    py::class_<PyKdTree>(m, "KdTree",
+                         "KdTree over an (n, 3) float64 array of points, referenced without copy: the array must "
+                         "not be modified while the tree is used")
+        .def(py::init<const ScalarArray&, int, bool>(), py::arg("points"), py::arg("min_cell_size") = 64,
+             py::arg("parallel") = true)
+        .def_property_readonly("point_count", &PyKdTree::pointCount)
+        .def_property_readonly("node_count", &PyKdTree::nodeCount)
+        .def("k_nearest_neighbors", &PyKdTree::kNearestNeighbors, py::arg("queries"), py::arg("k"),
+             "k nearest neighbors of each query, as (m, k) arrays of indices and squared distances")
+        .def("k_nearest_neighbors", &PyKdTree::kNearestNeighborsSelf, py::arg("k"),
+             "k nearest neighbors of each point of the tree, excluding the point itself")
+        .def("range_neighbors", &PyKdTree::rangeNeighbors, py::arg("queries"), py::arg("r"),
+             "Neighbors of each query within the radius r, as CSR arrays (offsets, indices, squared distances): "
+             "the neighbors of the query i are indices[offsets[i]:offsets[i+1]]")
+        .def("range_neighbors", &PyKdTree::rangeNeighborsSelf, py::arg("r"),
+             "Neighbors of each point of the tree within the radius r, excluding the point itself");
+
+    m.def("fit_oriented_spheres", &fitSpheres<OrientedSphereFit>,
+          py::arg("positions"), py::arg("normals"), py::arg("offsets"), py::arg("indices"), py::arg("scale"),
+          py::arg("queries") = py::none(),
+          "GLS fits (OrientedSphereFit) of CSR neighborhoods, e.g. computed by KdTree.range_neighbors, at the "
+          "queries or at the points. Returns a dict of arrays: status, tau, eta, kappa and projection");
+    m.def("fit_unoriented_spheres", &fitSpheres<UnorientedSphereFit>,
+          py::arg("positions"), py::arg("normals"), py::arg("offsets"), py::arg("indices"), py::arg("scale"),
+          py::arg("queries") = py::none(),
+          "GLS fits (UnorientedSphereFit) of CSR neighborhoods, same outputs as fit_oriented_spheres");
+    m.def("fit_planes", &fitPlanes,
+          py::arg("positions"), py::arg("offsets"), py::arg("indices"), py::arg("scale"),
+          py::arg("queries") = py::none(),
+          "Covariance plane fits of CSR neighborhoods. Returns a dict of arrays: status, normal, "
+          "surface_variation and projection");
+}
@@ -0,0 +1,387 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/common/data_generators.h
+    \brief Reproducible synthetic point clouds of any size, shared by the tests and the benchmarks
+
+    Each point is a function of the seed and of its index only (counter-based random numbers): the clouds are the
+    same whatever the number of threads generating them, and any range of points can be generated on its own.
+    Large clouds are generated in parallel with generate_cloud(), or streamed to a binary PLY file, chunk by chunk,
+    with write_cloud_ply().
+
+    Generators:
+     - surface_generator: sphere, plane or paraboloid, with noise along the normal, a density gradient and outliers
+     - lidar_generator: scanlines of a spinning sensor over a ground plane and the walls of a street
+     - multiscale_cluster_generator: clusters of clusters, down to several levels, in any dimension
+     - uniform_generator: points uniformly distributed in [-1, 1]^Dim
+ */
+
+#pragma once
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/// Counter-based random numbers: a splitmix64 sequence seeded by the seed and the index of a point
+class point_random
+{
+public:
+    inline point_random(std::uint64_t seed, std::uint64_t index, std::uint64_t stream = 0)
+        : m_state(mix(mix(seed + 0x9e3779b97f4a7c15ull * (stream + 1)) ^ index)) {}
+
+    inline std::uint64_t next()
+    {
+        m_state += 0x9e3779b97f4a7c15ull;
+        return mix(m_state);
+    }
+
+    /// Uniform in [0, 1)
+    template<typename Scalar>
+    inline Scalar uniform() { return Scalar(double(next() >> 11) * 0x1.0p-53); }
+
+    /// Uniform in [a, b)
+    template<typename Scalar>
+    inline Scalar uniform(Scalar a, Scalar b) { return a + (b - a) * uniform<Scalar>(); }
+
+    /// Uniform in [0, n)
+    inline int integer(int n) { return int(next() % std::uint64_t(n)); }
+
+    /// Standard normal distribution (Box-Muller)
+    template<typename Scalar>
+    inline Scalar normal()
+    {
+        const double u = 1. - uniform<double>(); // in (0, 1]
+        const double v = uniform<double>();
+        return Scalar(std::sqrt(-2. * std::log(u)) * std::cos(2. * M_PI * v));
+    }
+
+private:
+    static inline std::uint64_t mix(std::uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    std::uint64_t m_state;
+};
+
+/// Point of position `pos`, with the normal `normal` when DataPoint stores normals
+template<typename DataPoint, typename VectorType>
+typename std::enable_if<std::is_constructible<DataPoint, VectorType, VectorType>::value, DataPoint>::type
+make_point(const VectorType& pos, const VectorType& normal)
+{
+    return DataPoint(pos, normal);
+}
+
+template<typename DataPoint, typename VectorType>
+typename std::enable_if<!std::is_constructible<DataPoint, VectorType, VectorType>::value, DataPoint>::type
+make_point(const VectorType& pos, const VectorType& /*normal*/)
+{
+    return DataPoint(pos);
+}
+
+/// Perturbations shared by the generators
+struct cloud_options
+{
+    unsigned int seed {0};
+    double noise {0};            ///< Standard deviation of the noise, along the normal for the surfaces
+    double outlier_ratio {0};    ///< Fraction of the points replaced by outliers, uniform in the bounding box
+    double density_gradient {0}; ///< Density ratio \f$ e^g \f$ between the two ends of the first parameter
+};
+
+/// Parameter in [0, 1) of density proportional to \f$ e^{g t} \f$, from a uniform `u`
+template<typename Scalar>
+inline Scalar graded_parameter(Scalar u, double g)
+{
+    if (std::abs(g) < 1e-9)
+        return u;
+    return Scalar(std::log1p(double(u) * std::expm1(g)) / g);
+}
+
+/// Points uniformly distributed in [-1, 1]^Dim
+template<typename DataPoint>
+struct uniform_generator
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    unsigned int seed {0};
+
+    inline DataPoint operator()(std::uint64_t i) const
+    {
+        point_random rng(seed, i);
+        VectorType v;
+        for (int d = 0; d < DataPoint::Dim; ++d) v[d] = rng.uniform<Scalar>(Scalar(-1), Scalar(1));
+        return make_point<DataPoint>(v, VectorType(VectorType::Zero()));
+    }
+};
+
+enum SURFACE_SHAPE
+{
+    SURFACE_SPHERE,     ///< Unit sphere, the density gradient going from the south to the north pole
+    SURFACE_PLANE,      ///< Square [-1, 1]^2 of the plane z = 0, the density gradient along x
+    SURFACE_PARABOLOID  ///< \f$ z = c (x^2 + y^2) \f$ over [-1, 1]^2, the density gradient along x
+};
+
+/// Points on a sphere, a plane or a paraboloid, with their normals
+template<typename DataPoint>
+struct surface_generator
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    static_assert(DataPoint::Dim == 3, "The surfaces are generated in 3D");
+
+    SURFACE_SHAPE shape {SURFACE_SPHERE};
+    cloud_options options;
+    double curvature {1}; ///< Coefficient c of the paraboloid
+
+    inline DataPoint operator()(std::uint64_t i) const
+    {
+        point_random rng(options.seed, i);
+        const Scalar t = graded_parameter(rng.uniform<Scalar>(), options.density_gradient);
+        const Scalar s = rng.uniform<Scalar>();
+        const Scalar noise = Scalar(options.noise) * rng.normal<Scalar>();
+        const bool outlier = rng.uniform<double>() < options.outlier_ratio;
+
+        VectorType pos, normal;
+        switch (shape)
+        {
+        case SURFACE_SPHERE:
+        {
+            const Scalar z = Scalar(2) * t - Scalar(1);
+            const Scalar r = std::sqrt(std::max(Scalar(0), Scalar(1) - z * z));
+            const Scalar phi = Scalar(2 * M_PI) * s;
+            normal = VectorType(r * std::cos(phi), r * std::sin(phi), z);
+            pos = normal;
+            break;
+        }
+        case SURFACE_PLANE:
+            pos = VectorType(Scalar(2) * t - Scalar(1), Scalar(2) * s - Scalar(1), Scalar(0));
+            normal = VectorType(Scalar(0), Scalar(0), Scalar(1));
+            break;
+        case SURFACE_PARABOLOID:
+        {
+            const Scalar x = Scalar(2) * t - Scalar(1), y = Scalar(2) * s - Scalar(1);
+            const Scalar c = Scalar(curvature);
+            pos = VectorType(x, y, c * (x * x + y * y));
+            normal = VectorType(Scalar(-2) * c * x, Scalar(-2) * c * y, Scalar(1)).normalized();
+            break;
+        }
+        }
+        pos += noise * normal;
+
+        if (outlier)
+        {
+            const Scalar top = shape == SURFACE_PARABOLOID ? Scalar(2 * std::abs(curvature)) + Scalar(1) : Scalar(1);
+            for (int d = 0; d < 3; ++d) pos[d] = rng.uniform<Scalar>(Scalar(-1), Scalar(1));
+            if (shape == SURFACE_PARABOLOID) pos[2] = rng.uniform<Scalar>(-top, top);
+        }
+        return make_point<DataPoint>(pos, normal);
+    }
+};
+
+/// Scanlines of a spinning LiDAR at the origin, `height` above a ground plane, between two walls at `y = +-width`
+///
+/// The point `i` is on the ring `i / points_per_ring`, the rings being evenly spread in elevation between
+/// `-fov_down` and `fov_up` (radians). Rays missing the scene within `max_range` hit a far sphere. The density
+/// decreases quadratically with the distance to the sensor, and is much higher along the scanlines than across.
+template<typename DataPoint>
+struct lidar_generator
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    static_assert(DataPoint::Dim == 3, "The scans are generated in 3D");
+
+    cloud_options options;         ///< The noise is along the rays, the density gradient is not used
+    int points_per_ring {2048};
+    double fov_up {0.26};
+    double fov_down {0.43};
+    int rings {64};
+    double height {1.7};
+    double width {8.};
+    double max_range {100.};
+
+    inline DataPoint operator()(std::uint64_t i) const
+    {
+        point_random rng(options.seed, i);
+        const int ring = int((i / std::uint64_t(points_per_ring)) % std::uint64_t(rings));
+        const int step = int(i % std::uint64_t(points_per_ring));
+        const double elevation = rings > 1 ? -fov_down + (fov_up + fov_down) * ring / (rings - 1) : 0.;
+        // small jitter of the azimuth, as the encoder of the sensor
+        const double azimuth = 2. * M_PI * (step + 0.1 * rng.uniform<double>()) / points_per_ring;
+        const Eigen::Vector3d dir(std::cos(elevation) * std::cos(azimuth),
+                                  std::cos(elevation) * std::sin(azimuth),
+                                  std::sin(elevation));
+
+        double range = max_range;
+        Eigen::Vector3d normal = -dir;
+        if (dir.z() < 0 && -height / dir.z() < range)
+        {
+            range = -height / dir.z();
+            normal = Eigen::Vector3d::UnitZ();
+        }
+        if (std::abs(dir.y()) > 1e-12 && width / std::abs(dir.y()) < range)
+        {
+            range = width / std::abs(dir.y());
+            normal = Eigen::Vector3d(0, dir.y() > 0 ? -1 : 1, 0);
+        }
+        range += options.noise * rng.normal<double>();
+
+        Eigen::Vector3d pos = range * dir;
+        if (rng.uniform<double>() < options.outlier_ratio)
+            pos = rng.uniform<double>() * range * dir; // e.g. dust or rain
+        return make_point<DataPoint>(VectorType(pos.cast<Scalar>()), VectorType(normal.cast<Scalar>()));
+    }
+};
+
+/// Clusters of clusters: `levels` levels of `branching` clusters, each level `ratio` times smaller than its parent
+///
+/// The centers of the clusters are random offsets from their parent, and the points are spread around the centers
+/// of the last level. Models the multi-scale densities of scans of scenes made of objects made of parts.
+template<typename DataPoint>
+struct multiscale_cluster_generator
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    cloud_options options; ///< The noise is not used, the density gradient skews the choice of the clusters
+    int levels {3};
+    int branching {10};
+    double ratio {0.1};
+
+    inline DataPoint operator()(std::uint64_t i) const
+    {
+        point_random rng(options.seed, i);
+        VectorType pos = VectorType::Zero();
+        double scale = 1.;
+        std::uint64_t cluster = 0;
+        for (int l = 0; l < levels; ++l)
+        {
+            const int child = std::min(branching - 1,
+                int(graded_parameter(rng.uniform<double>(), options.density_gradient) * branching));
+            cluster = cluster * std::uint64_t(branching) + std::uint64_t(child) + 1;
+            // the offset of a cluster only depends on its identifier
+            point_random center(options.seed, cluster, 1);
+            for (int d = 0; d < DataPoint::Dim; ++d) pos[d] += Scalar(scale * center.uniform<double>(-1., 1.));
+            scale *= ratio;
+        }
+        for (int d = 0; d < DataPoint::Dim; ++d) pos[d] += Scalar(scale * rng.normal<double>());
+
+        if (rng.uniform<double>() < options.outlier_ratio)
+            for (int d = 0; d < DataPoint::Dim; ++d) pos[d] = rng.uniform<Scalar>(Scalar(-1.5), Scalar(1.5));
+        return make_point<DataPoint>(pos, VectorType(VectorType::Zero()));
+    }
+};
+
+/// Points `first` to `first + count` of `generator`, in parallel
+template<typename DataPoint, typename Generator>
+void generate_cloud(const Generator& generator, std::uint64_t first, int count, DataPoint* points)
+{
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < count; ++j)
+        points[j] = generator(first + std::uint64_t(j));
+}
+
+/// First `n` points of `generator`, in parallel
+template<typename DataPoint, typename Generator>
+std::vector<DataPoint> generate_cloud(const Generator& generator, int n)
+{
+    std::vector<DataPoint> points(n);
+    generate_cloud(generator, 0, n, points.data());
+    return points;
+}
+
+/// Normal of `p` written to `r`, zero when DataPoint has no normal
+template<typename DataPoint>
+auto write_normal(const DataPoint& p, float* r) -> decltype(p.normal(), void())
+{
+    for (int d = 0; d < 3; ++d) r[d] = float(p.normal()[d]);
+}
+
+template<typename DataPoint, typename... Ignored>
+void write_normal(const DataPoint&, float* r, Ignored...)
+{
+    r[0] = r[1] = r[2] = 0.f;
+}
+
+/// Write the first `n` points of `generator` to `filename`, in binary little-endian PLY with float positions and
+/// normals (zero when DataPoint has none), generating `chunk` points at a time: any number of points can be written
+/// with bounded memory. Read back by Ponca::PointCloudFile.
+/// \return false when writing fails
+template<typename DataPoint, typename Generator>
+bool write_cloud_ply(const std::string& filename, const Generator& generator, std::uint64_t n, int chunk = 1 << 20)
+{
+    static_assert(DataPoint::Dim == 3, "PLY files store 3D points");
+    std::ofstream out(filename, std::ios::binary);
+    if (!out)
+        return false;
+    out << "ply\nformat binary_little_endian 1.0\n"
+        << "element vertex " << n << "\n"
+        << "property float x\nproperty float y\nproperty float z\n"
+        << "property float nx\nproperty float ny\nproperty float nz\n"
+        << "end_header\n";
+
+    std::vector<float> record;
+    for (std::uint64_t first = 0; first < n; first += std::uint64_t(chunk))
+    {
+        const int count = int(std::min<std::uint64_t>(std::uint64_t(chunk), n - first));
+        record.resize(std::size_t(count) * 6);
+#pragma omp parallel for schedule(static)
+        for (int j = 0; j < count; ++j)
+        {
+            const DataPoint p = generator(first + std::uint64_t(j));
+            float* r = record.data() + std::size_t(j) * 6;
+            for (int d = 0; d < 3; ++d) r[d] = float(p.pos()[d]);
+            write_normal(p, r + 3);
+        }
+        // the records are written in the byte order of the host: little-endian hosts only
+        out.write(reinterpret_cast<const char*>(record.data()), std::streamsize(record.size() * sizeof(float)));
+    }
+    return bool(out);
+}
+
+// Clouds of the KdTree tests and benchmarks -------------------------------------------------------------------------
+
+/// Points uniformly distributed in [-1, 1]^Dim
+template<typename DataPoint>
+std::vector<DataPoint> generate_uniform_cloud(int n, unsigned int seed = 0)
+{
+    uniform_generator<DataPoint> generator;
+    generator.seed = seed;
+    return generate_cloud<DataPoint>(generator, n);
+}
+
+/// Dense clusters embedded in a sparse uniform background, mimicking uneven LiDAR densities
+template<typename DataPoint>
+std::vector<DataPoint> generate_clustered_cloud(int n, int cluster_count = 100, unsigned int seed = 0)
+{
+    multiscale_cluster_generator<DataPoint> generator;
+    generator.options.seed = seed;
+    generator.options.outlier_ratio = 0.1;
+    generator.levels = 1;
+    generator.branching = cluster_count;
+    generator.ratio = 0.01;
+    return generate_cloud<DataPoint>(generator, n);
+}
+
+/// Points on the unit sphere, with a small noise along the normal, as acquired on a surface
+template<typename DataPoint>
+std::vector<DataPoint> generate_surface_cloud(int n, unsigned int seed = 0)
+{
+    surface_generator<DataPoint> generator;
+    generator.options.seed = seed;
+    generator.options.noise = 0.001;
+    return generate_cloud<DataPoint>(generator, n);
+}
@@ -7,6 +7,8 @@
 #include <iterator>
 #include <algorithm>
 
+#include "data_generators.h"
+
 
 #define EXPECT_EQ(a,b) assert(a==b)
 #define EXPECT_TRUE(a) assert(a==true)
@@ -264,12 +266,12 @@ bool check_k_nearest_neighbors(const VectorContainer& points, const std::vector<
 
 	Scalar max_dist = 0;
 	for (int idx : neighbors)
-		max_dist = std::max(max_dist, (points[idx] - point).norm());
+		max_dist = std::max(max_dist, (points[idx].pos() - point).norm());
 
 	for (int i = 0; i<int(sampling.size()); ++i)
 	{
 		int idx = sampling[i];
-		Scalar dist = (points[idx] - point).norm();
+		Scalar dist = (points[idx].pos() - point).norm();
 		auto it = std::find(neighbors.begin(), neighbors.end(), idx);
 		bool is_neighbor = it != neighbors.end();
 
@@ -343,4 +345,6 @@ template<typename Scalar, typename VectorType, typename VectorContainer>
 bool check_nearest_neighbor(const VectorContainer& points, const std::vector<int>& sampling, int index, int nearest)
 {
     return check_k_nearest_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, index, 1, { nearest });
-}
\ No newline at end of file
+}
+
+// Point clouds of various distributions, shared by the tests and the benchmarks: see data_generators.h
@@ -0,0 +1,187 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/adaptive_scale.cpp
+    \brief Test the per-point scales estimated from the k-nearest neighbors, and the fits using them
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/data_generators.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/adaptiveScale.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+// Sphere sampled with a density increasing towards its north pole
+template<typename DataPoint>
+vector<DataPoint> gradedSphere(int n)
+{
+    surface_generator<DataPoint> generator;
+    generator.shape = SURFACE_SPHERE;
+    generator.options.seed = std::uint64_t(Eigen::internal::random<int>(0, 1000));
+    generator.options.density_gradient = 3;
+    return generate_cloud<DataPoint>(generator, n);
+}
+
+template<typename DataPoint>
+void testKnnScales()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    const int n = 5000, k = 8;
+    const Scalar factor = 1.5;
+    const vector<DataPoint> points = gradedSphere<DataPoint>(n);
+    KdTree<DataPoint> tree(points);
+
+    vector<Scalar> scales;
+    computeKnnScales(tree, k, factor, scales);
+    VERIFY(int(scales.size()) == n);
+
+    // the distance to the k-th neighbor, the point itself excluded
+    for (int i = 0; i < n; i += 97)
+    {
+        vector<Scalar> distances;
+        for (int j = 0; j < n; ++j)
+            if (j != i)
+                distances.push_back((points[j].pos() - points[i].pos()).norm());
+        std::nth_element(distances.begin(), distances.begin() + k - 1, distances.end());
+        VERIFY(std::abs(scales[i] - factor * distances[k - 1]) < testEpsilon<Scalar>() * 10);
+    }
+
+    // the scales follow the density
+    const auto range = std::minmax_element(scales.begin(), scales.end());
+    VERIFY(*range.second > Scalar(2) * *range.first);
+}
+
+// computeAllAdaptive gives the same results as fitting each point at its own scale
+template<typename DataPoint, typename Fit>
+void testAdaptive()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename Fit::WFunctor WeightFunc;
+    const int n = 2000;
+    const vector<DataPoint> points = gradedSphere<DataPoint>(n);
+    KdTree<DataPoint> tree(points);
+
+    vector<Scalar> scales;
+    computeKnnScales(tree, 16, Scalar(2), scales);
+
+    vector<Fit> fits(n);
+    vector<FIT_RESULT> results(n, UNDEFINED);
+    vector<int> calls(n, 0);
+    computeAllAdaptive<Fit>(tree, scales, [&](int i, const Fit& fit, FIT_RESULT res) {
+        fits[i] = fit; results[i] = res; ++calls[i];
+    });
+
+#pragma omp parallel for
+    for (int i = 0; i < n; ++i)
+    {
+        VERIFY(calls[i] == 1);
+
+        vector<DataPoint> neighborhood;
+        for (int j : tree.range_neighbors(points[i].pos(), scales[i]))
+            neighborhood.push_back(points[j]);
+
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(scales[i]));
+        fit.init(points[i].pos());
+        const FIT_RESULT res = fit.compute(neighborhood.cbegin(), neighborhood.cend());
+
+        VERIFY(res == results[i]);
+        if (res == STABLE)
+            VERIFY(fit.primitiveGradient(points[i].pos()) == fits[i].primitiveGradient(points[i].pos()));
+    }
+}
+
+// computeScaleSelection keeps the stable fit of best score of the sweep
+template<typename DataPoint, typename Fit, typename Score>
+void testSelection()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    const int n = 2000;
+    const vector<DataPoint> points = gradedSphere<DataPoint>(n);
+    KdTree<DataPoint> tree(points);
+
+    vector<Scalar> scales;
+    computeKnnScales(tree, 8, Scalar(1), scales);
+    const vector<Scalar> multipliers {Scalar(1), Scalar(2), Scalar(4), Scalar(8)};
+
+    vector<Scalar> selected(n, Scalar(0));
+    vector<Scalar> selectedScores(n);
+    vector<FIT_RESULT> results(n, UNDEFINED);
+    computeScaleSelection<Fit>(tree, scales, multipliers, Score(),
+        [&](int i, const Fit& fit, FIT_RESULT res, Scalar t) {
+            selected[i] = t; results[i] = res;
+            if (res == STABLE) selectedScores[i] = Score()(fit);
+        });
+
+#pragma omp parallel for
+    for (int i = 0; i < n; ++i)
+    {
+        // one of the scales of the sweep
+        bool inSweep = false;
+        for (Scalar m : multipliers)
+            inSweep = inSweep || selected[i] == scales[i] * m;
+        VERIFY(inSweep);
+
+        // no other stable fit of the sweep has a better score, checked on a subset of the points
+        if (results[i] != STABLE || i % 10 != 0)
+            continue;
+        vector<Scalar> sweep;
+        for (Scalar m : multipliers)
+            sweep.push_back(scales[i] * m);
+        internal::computeScales<Fit>(points[i].pos(), points.cbegin(), points.cend(), sweep,
+            [&](int, const Fit& fit, FIT_RESULT res) {
+                if (res == STABLE)
+                    VERIFY(Score()(fit) <= selectedScores[i] + testEpsilon<Scalar>());
+            });
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightFunc;
+
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit> Plane;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit> Sphere;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit, GLSParam> Gls;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit, GLSParam, OrientedSphereScaleSpaceDer, GLSDer, GLSGeomVar> GlsGeomVar;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testKnnScales<Point>() ));
+        CALL_SUBTEST(( testAdaptive<Point, Plane>() ));
+        CALL_SUBTEST(( testAdaptive<Point, Sphere>() ));
+        CALL_SUBTEST(( testSelection<Point, Gls, ScaleSelectionFitness>() ));
+        CALL_SUBTEST(( testSelection<Point, GlsGeomVar, ScaleSelectionGeomVar>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the adaptive scales in 3 dimensions..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,164 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/basket_batch.cpp
+    \brief Test that batched fits give the same results as the fits computed one after the other, up to rounding
+    for the fits accumulated by lanes
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/basketBatch.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/mongePatch.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename DataPoint, typename Fit>
+void testFunction()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename Fit::WFunctor WeightFunc;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(100, 200);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt( Scalar(4. * M_PI) * radius * radius / nbPoints);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10000);
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false, false);
+
+    // neighborhoods of varying sizes, including empty ones, in CSR format
+    vector<size_t> offsets {0};
+    vector<int> neighbors;
+    for(int i = 0; i < nbPoints; ++i)
+    {
+        const Scalar r = analysisScale * Eigen::internal::random<Scalar>(0., 1.);
+        for(int j = 0; j < nbPoints; ++j)
+            if((points[j].pos() - points[i].pos()).norm() < r)
+                neighbors.push_back(j);
+        offsets.push_back(neighbors.size());
+    }
+
+    vector<Fit> fits(nbPoints);
+    vector<FIT_RESULT> results(nbPoints, UNDEFINED);
+    computeBatch<Fit>(nbPoints, points, offsets, neighbors,
+        [&](int i, Fit& fit) { fit.setWeightFunc(WeightFunc(analysisScale)); fit.init(points[i].pos()); },
+        [&](int i, const Fit& fit, FIT_RESULT res) { fits[i] = fit; results[i] = res; });
+
+#pragma omp parallel for
+    for(int i = 0; i < nbPoints; ++i)
+    {
+        vector<DataPoint> neighborhood;
+        for(size_t j = offsets[i]; j < offsets[i+1]; ++j)
+            neighborhood.push_back(points[neighbors[j]]);
+
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(analysisScale));
+        fit.init(points[i].pos());
+        const FIT_RESULT res = fit.compute(neighborhood.cbegin(), neighborhood.cend());
+
+        VERIFY(res == results[i]);
+        if(res != STABLE)
+            continue;
+        const VectorType gradient = fit.primitiveGradient(points[i].pos());
+        const VectorType batchGradient = fits[i].primitiveGradient(points[i].pos());
+        if constexpr (internal::IsCovariancePlaneBatch<Fit>::value)
+        {
+            // sums accumulated by lanes: the results differ by rounding, the orientation of the normal included
+            const Scalar epsilon = testEpsilon<Scalar>();
+            const Scalar sign = gradient.dot(batchGradient) < Scalar(0) ? Scalar(-1) : Scalar(1);
+            VERIFY((gradient - sign * batchGradient).norm() < epsilon);
+            VERIFY(std::abs(fit.potential(points[i].pos()) - sign * fits[i].potential(points[i].pos())) < epsilon * analysisScale);
+        }
+        else
+        {
+            // same operations in the same order: the results are identical
+            VERIFY(gradient == batchGradient);
+            VERIFY(fit.potential(points[i].pos()) == fits[i].potential(points[i].pos()));
+        }
+    }
+}
+
+template<typename Scalar, int Dim>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, Dim> Point;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightFunc;
+
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit> Plane;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit> Sphere;
+    static_assert(internal::IsCovariancePlaneBatch<Plane>::value, "CovariancePlaneFit is accumulated by lanes");
+    static_assert(!internal::IsCovariancePlaneBatch<Sphere>::value, "OrientedSphereFit is fitted one by one");
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Point, Plane>() ));
+        CALL_SUBTEST(( testFunction<Point, Sphere>() ));
+    }
+}
+
+template<typename Scalar, int Dim>
+void callSphereSubTests()
+{
+    typedef PointPositionNormal<Scalar, Dim> Point;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightFunc;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit> Sphere;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Point, Sphere>() ));
+    }
+}
+
+template<typename Scalar>
+void callMultiPassSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightFunc;
+
+    // two passes
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit, MongePatch> Monge;
+    static_assert(!internal::IsCovariancePlaneBatch<Monge>::value, "MongePatch accumulates its own sums");
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Point, Monge>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test batched fits in 3 dimensions..." << endl;
+    callSubTests<float, 3>();
+    callSubTests<double, 3>();
+    callMultiPassSubTests<float>();
+    callMultiPassSubTests<double>();
+    cout << "Ok..." << endl;
+
+    cout << "Test batched fits in 4 dimensions..." << endl;
+    callSphereSubTests<float, 4>();
+    callSphereSubTests<double, 4>();
+    cout << "Ok..." << endl;
+}
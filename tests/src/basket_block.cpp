@@ -0,0 +1,135 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/basket_block.cpp
+    \brief Test that Basket::compute adding the neighbors by blocks gives the same fit as adding them one by one
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/curvatureEstimation.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+// Point stored and accumulated in float, with compensated sums
+class PointCompensated : public PointPositionNormal<float, 3>
+{
+public:
+    enum {CompensatedSum = 1};
+    using PointPositionNormal<float, 3>::PointPositionNormal;
+};
+
+template<typename Fit>
+using HasBlock = internal::HasBlockAddNeighbors<Fit, typename vector<typename Fit::DataPoint>::const_iterator,
+                                                     typename vector<typename Fit::DataPoint>::const_iterator>;
+
+template<typename DataPoint, typename Fit>
+void testFunction(bool _bAddPositionNoise = false)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename Fit::WFunctor WeightFunc;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(100, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt( Scalar(4. * M_PI) * radius * radius / nbPoints);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10);
+    const Scalar epsilon = testEpsilon<Scalar>();
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, _bAddPositionNoise, false, false);
+
+    for(int i = 0; i < nbPoints; i += 10)
+    {
+        const VectorType& pos = points[i].pos();
+
+        Fit reference;
+        reference.setWeightFunc(WeightFunc(analysisScale));
+        reference.init(pos);
+        FIT_RESULT referenceRes;
+        do {
+            for(const auto& p : points)
+                reference.addNeighbor(p);
+            referenceRes = reference.finalize();
+        } while(referenceRes == NEED_OTHER_PASS);
+
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(analysisScale));
+        fit.init(pos);
+        const FIT_RESULT res = fit.compute(points.cbegin(), points.cend());
+
+        VERIFY(res == referenceRes);
+        if(res == STABLE)
+        {
+            // same neighbors, summed in a different order, the orientation of the planes being arbitrary
+            const VectorType q = pos + VectorType::Random() * analysisScale * Scalar(0.5);
+            VERIFY(std::abs(std::abs(fit.potential(q)) - std::abs(reference.potential(q))) <= epsilon * radius);
+            VERIFY(std::abs(std::abs(fit.primitiveGradient(q).normalized().dot(reference.primitiveGradient(q).normalized()))
+                            - Scalar(1)) <= epsilon);
+        }
+    }
+}
+
+template<typename Point>
+void callSubTests()
+{
+    typedef typename Point::Scalar Scalar;
+
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightSmoothFunc;
+
+    typedef Basket<Point, WeightSmoothFunc, OrientedSphereFit, GLSParam> Sphere;
+    typedef Basket<Point, WeightSmoothFunc, CovariancePlaneFit> Plane;
+    typedef Basket<Point, WeightSmoothFunc, CovariancePlaneFit, NormalCovarianceCurvature> NormalCovariance;
+    typedef Basket<Point, WeightSmoothFunc, CovariancePlaneFit, ProjectedNormalCovarianceCurvature> ProjectedNormalCovariance;
+    typedef Basket<Point, WeightSmoothFunc, OrientedSphereFit, OrientedSphereScaleSpaceDer> SphereDer;
+    typedef Basket<Point, WeightSmoothFunc, CovariancePlaneFit, CovariancePlaneScaleSpaceDer> PlaneDer;
+
+    // the block addNeighbors is used only when declared by the last extension adding neighbors
+    static_assert(HasBlock<Sphere>::value, "OrientedSphereFit adds the neighbors by blocks");
+    static_assert(HasBlock<Plane>::value, "CovariancePlaneFit adds the neighbors by blocks");
+    static_assert(HasBlock<NormalCovariance>::value, "NormalCovarianceCurvature adds the neighbors by blocks");
+    static_assert(HasBlock<ProjectedNormalCovariance>::value, "ProjectedNormalCovarianceCurvature adds the neighbors by blocks");
+    static_assert(!HasBlock<SphereDer>::value, "OrientedSphereDer adds the neighbors one by one");
+    static_assert(!HasBlock<PlaneDer>::value, "CovariancePlaneDer adds the neighbors one by one");
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Point, Sphere>() ));
+        CALL_SUBTEST(( testFunction<Point, Sphere>(true) ));
+        CALL_SUBTEST(( testFunction<Point, Plane>() ));
+        CALL_SUBTEST(( testFunction<Point, Plane>(true) ));
+        CALL_SUBTEST(( testFunction<Point, SphereDer>() ));
+        CALL_SUBTEST(( testFunction<Point, PlaneDer>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test neighbors added by blocks..." << endl;
+    callSubTests<PointPositionNormal<float, 3> >();
+    callSubTests<PointPositionNormal<double, 3> >();
+    callSubTests<PointCompensated>();
+    cout << "Ok..." << endl;
+}
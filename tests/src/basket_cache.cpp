@@ -0,0 +1,125 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/basket_cache.cpp
+    \brief Test that replaying the cached neighbors gives the same fit as iterating again over the neighborhood
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/mongePatch.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+// Iterator counting the neighbors read from the container
+template<typename DataPoint>
+struct CountingIterator
+{
+    typename vector<DataPoint>::const_iterator it;
+    int* count;
+
+    const DataPoint& operator*() const { ++(*count); return *it; }
+    CountingIterator& operator++() { ++it; return *this; }
+    bool operator!=(const CountingIterator& other) const { return it != other.it; }
+};
+
+template<typename DataPoint, typename Fit>
+void testFunction(int _nbPasses, bool _bAddPositionNoise = false)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename Fit::WFunctor WeightFunc;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(100, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt( Scalar(4. * M_PI) * radius * radius / nbPoints);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10);
+    const Scalar epsilon = testEpsilon<Scalar>();
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, _bAddPositionNoise, false, false);
+
+    for(int i = 0; i < nbPoints; i += 10)
+    {
+        const VectorType& pos = points[i].pos();
+
+        int count = 0;
+        const CountingIterator<DataPoint> begin {points.cbegin(), &count}, end {points.cend(), &count};
+
+        Fit reference;
+        reference.setWeightFunc(WeightFunc(analysisScale));
+        reference.init(pos);
+        const FIT_RESULT referenceRes = reference.compute(begin, end);
+        const int referenceCount = count;
+
+        count = 0;
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(analysisScale));
+        fit.init(pos);
+        const FIT_RESULT res = fit.computeWithCache(begin, end);
+
+        // the neighbors are read once, whatever the number of passes
+        VERIFY(res == referenceRes);
+        VERIFY(count == nbPoints);
+        if(referenceRes == STABLE)
+            VERIFY(referenceCount == _nbPasses * nbPoints);
+
+        if(res == STABLE)
+        {
+            // same neighbors and weights, added in the same order
+            const VectorType q = pos + VectorType::Random() * analysisScale * Scalar(0.5);
+            VERIFY(std::abs(fit.potential(q) - reference.potential(q)) <= epsilon * radius);
+        }
+    }
+}
+
+template<typename Scalar, int Dim>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, Dim> Point;
+
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightSmoothFunc;
+    typedef DistWeightFunc<Point, ConstantWeightKernel<Scalar> > WeightConstantFunc;
+
+    typedef Basket<Point, WeightSmoothFunc, CovariancePlaneFit, MongePatch> MongeSmooth;
+    typedef Basket<Point, WeightConstantFunc, CovariancePlaneFit, MongePatch> MongeConstant;
+    typedef Basket<Point, WeightSmoothFunc, OrientedSphereFit, GLSParam> SphereSmooth;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Point, MongeSmooth>(2) ));
+        CALL_SUBTEST(( testFunction<Point, MongeConstant>(2) ));
+        CALL_SUBTEST(( testFunction<Point, MongeSmooth>(2, true) ));
+        CALL_SUBTEST(( testFunction<Point, SphereSmooth>(1) ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test neighbor cache in 3 dimensions..." << endl;
+    callSubTests<float, 3>();
+    callSubTests<double, 3>();
+    cout << "Ok..." << endl;
+}
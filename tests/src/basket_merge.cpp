@@ -0,0 +1,168 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/basket_merge.cpp
+    \brief Test that merging fits accumulated over parts of a neighborhood gives the fit of the whole neighborhood
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/meanPlaneFit.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/unorientedSphereFit.h>
+#include <Ponca/src/Fitting/covarianceLineFit.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+// accumulate each part of the neighborhood in its own fit, then merge them
+template<typename Fit, typename DataPoint>
+FIT_RESULT computeByParts(Fit& fit, const vector<DataPoint>& points, typename DataPoint::Scalar analysisScale,
+                          const typename DataPoint::VectorType& pos)
+{
+    typedef typename Fit::WFunctor WeightFunc;
+
+    fit.setWeightFunc(WeightFunc(analysisScale));
+    fit.init(pos);
+    const int nbPoints = int(points.size());
+    const int parts = Eigen::internal::random<int>(1, 8);
+#pragma omp parallel for ordered schedule(static, 1)
+    for(int part = 0; part < parts; ++part)
+    {
+        Fit partial;
+        partial.setWeightFunc(WeightFunc(analysisScale));
+        partial.init(pos);
+        for(int i = part; i < nbPoints; i += parts)
+            partial.addNeighbor(points[i]);
+#pragma omp ordered
+        fit.merge(partial);
+    }
+    return fit.finalize();
+}
+
+template<typename DataPoint, typename Fit>
+void testFunction()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename Fit::WFunctor WeightFunc;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(100, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt( Scalar(4. * M_PI) * radius * radius / nbPoints);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10000);
+    const Scalar epsilon = Scalar(1e-6) * radius;
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false, false);
+
+    const VectorType& pos = points[0].pos();
+    const VectorType q = pos + VectorType::Random() * analysisScale * Scalar(0.5);
+
+    Fit reference;
+    reference.setWeightFunc(WeightFunc(analysisScale));
+    reference.init(pos);
+    const FIT_RESULT referenceRes = reference.compute(points.cbegin(), points.cend());
+
+    Fit fit;
+    const FIT_RESULT res = computeByParts(fit, points, analysisScale, pos);
+
+    VERIFY(res == referenceRes);
+    if(res == STABLE)
+    {
+        // the orientation of the eigenvector solutions (CovariancePlaneFit, UnorientedSphereFit) is arbitrary
+        VERIFY(std::abs(std::abs(fit.potential(q)) - std::abs(reference.potential(q))) < epsilon);
+        VERIFY((fit.project(q) - reference.project(q)).norm() < epsilon);
+    }
+}
+
+// the derivatives accumulated by the extensions are merged along with the sums of the fitting procedure
+template<typename DataPoint, typename Fit>
+void testDerivatives()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename Fit::WFunctor WeightFunc;
+
+    //generate noisy sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(100, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt( Scalar(4. * M_PI) * radius * radius / nbPoints);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10000);
+    const Scalar epsilon = Scalar(1e-6);
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, true, true, false);
+
+    const VectorType& pos = points[0].pos();
+
+    Fit reference;
+    reference.setWeightFunc(WeightFunc(analysisScale));
+    reference.init(pos);
+    const FIT_RESULT referenceRes = reference.compute(points.cbegin(), points.cend());
+
+    Fit fit;
+    const FIT_RESULT res = computeByParts(fit, points, analysisScale, pos);
+
+    VERIFY(res == referenceRes);
+    if(res == STABLE)
+    {
+        VERIFY((fit.dtau() - reference.dtau()).norm() <= epsilon * (Scalar(1) + reference.dtau().norm()));
+        VERIFY((fit.deta() - reference.deta()).norm() <= epsilon * (Scalar(1) + reference.deta().norm()));
+        VERIFY((fit.dkappa() - reference.dkappa()).norm() <= epsilon * (Scalar(1) + reference.dkappa().norm()));
+    }
+}
+
+template<typename Scalar, int Dim>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, Dim> Point;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightFunc;
+
+    typedef Basket<Point, WeightFunc, MeanPlaneFit> MeanPlane;
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit> CovariancePlane;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit> OrientedSphere;
+    typedef Basket<Point, WeightFunc, UnorientedSphereFit> UnorientedSphere;
+    typedef Basket<Point, WeightFunc, CovarianceLineFit> Line;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit, GLSParam, OrientedSphereScaleSpaceDer, GLSDer> GlsDer;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Point, MeanPlane>() ));
+        CALL_SUBTEST(( testFunction<Point, CovariancePlane>() ));
+        CALL_SUBTEST(( testFunction<Point, OrientedSphere>() ));
+        CALL_SUBTEST(( testFunction<Point, UnorientedSphere>() ));
+        CALL_SUBTEST(( testFunction<Point, Line>() ));
+        CALL_SUBTEST(( testDerivatives<Point, GlsDer>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test merging fits in 3 dimensions..." << endl;
+    // the sums are accumulated in another order: in float, the rounding differences are amplified by the
+    // ill-conditioned fits
+    callSubTests<double, 3>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,134 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/basket_profiling.cpp
+    \brief Test that FitProfiling records the phases and neighbors of the fits without changing their results
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/mongePatch.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/profiling.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename DataPoint, typename Fit, typename ProfiledFit, int Passes>
+void testFunction()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename Fit::WFunctor WeightFunc;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(100, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt( Scalar(4. * M_PI) * radius * radius / nbPoints);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10000);
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false, false);
+
+    FitProfileHistogram histogram;
+#pragma omp parallel
+    {
+        FitProfileHistogram threadHistogram;
+#pragma omp for
+        for(int i = 0; i < nbPoints; ++i)
+        {
+            const VectorType& pos = points[i].pos();
+
+            Fit fit;
+            fit.setWeightFunc(WeightFunc(analysisScale));
+            fit.init(pos);
+            const FIT_RESULT res = fit.compute(points.cbegin(), points.cend());
+
+            ProfiledFit profiled;
+            profiled.setWeightFunc(WeightFunc(analysisScale));
+            profiled.init(pos);
+            const FIT_RESULT profiledRes = profiled.compute(points.cbegin(), points.cend());
+
+            // same neighbors and operations, the neighbors being added one by one
+            VERIFY(res == profiledRes);
+            if(res == STABLE)
+                VERIFY(fit.primitiveGradient(pos).isApprox(profiled.primitiveGradient(pos)));
+
+            const FitPhaseProfile& profile = profiled.profile();
+            VERIFY(profile.passes == Passes);
+            VERIFY(profile.neighbors == std::uint64_t(Passes) * std::uint64_t(nbPoints));
+            // the evaluation point is a neighbor
+            VERIFY(profile.accepted >= std::uint64_t(Passes) && profile.accepted <= profile.neighbors);
+            VERIFY(profile.cycles[FIT_PHASE_ACCUMULATION] > 0 && profile.total() >= profile.cycles[FIT_PHASE_ACCUMULATION]);
+            threadHistogram.add(profile);
+
+            // init restarts the profile
+            profiled.init(pos);
+            VERIFY(profiled.profile().neighbors == 0 && profiled.profile().passes == 0);
+        }
+#pragma omp critical
+        histogram += threadHistogram;
+    }
+
+    VERIFY(histogram.fits == std::uint64_t(nbPoints));
+    VERIFY(histogram.passes == std::uint64_t(Passes) * std::uint64_t(nbPoints));
+    VERIFY(histogram.neighbors == std::uint64_t(Passes) * std::uint64_t(nbPoints) * std::uint64_t(nbPoints));
+    // all the fits have the same number of neighbors
+    const int bin = FitProfileHistogram::bin(std::uint64_t(Passes) * std::uint64_t(nbPoints));
+    VERIFY(histogram.neighborHistogram[bin] == std::uint64_t(nbPoints));
+    for(int p = 0; p < FIT_PHASE_COUNT; ++p)
+    {
+        std::uint64_t count = 0;
+        for(std::uint64_t c : histogram.cycleHistograms[p])
+            count += c;
+        VERIFY(count == std::uint64_t(nbPoints));
+    }
+    VERIFY(!histogram.to_string().empty());
+    const std::string csv = histogram.to_csv();
+    VERIFY(std::count(csv.begin(), csv.end(), '\n') == FitProfileHistogram::BinCount + 1);
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightFunc;
+
+    typedef Basket<Point, WeightFunc, OrientedSphereFit, GLSParam> Sphere;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit, GLSParam, FitProfiling> ProfiledSphere;
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit, MongePatch> Monge;
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit, MongePatch, FitProfiling> ProfiledMonge;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Point, Sphere, ProfiledSphere, 1>() ));
+        CALL_SUBTEST(( testFunction<Point, Monge, ProfiledMonge, 2>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test FitProfiling in 3 dimensions..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
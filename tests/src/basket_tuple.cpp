@@ -0,0 +1,125 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/basket_tuple.cpp
+    \brief Test that the fits of a BasketTuple give the same results as the fits computed one after the other
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/basketTuple.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/curvatureEstimation.h>
+#include <Ponca/src/Fitting/mongePatch.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename DataPoint, typename Plane, typename Sphere, typename Curvature, typename Monge>
+void testFunction()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename Plane::WFunctor WeightFunc;
+    typedef BasketTuple<Plane, Sphere, Curvature, Monge> Fits;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(100, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt( Scalar(4. * M_PI) * radius * radius / nbPoints);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10000);
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false, false);
+
+#pragma omp parallel for
+    for(int i = 0; i < nbPoints; ++i)
+    {
+        const VectorType& pos = points[i].pos();
+
+        Fits fits;
+        fits.setWeightFunc(WeightFunc(analysisScale));
+        fits.init(pos);
+        const FIT_RESULT res = fits.compute(points.cbegin(), points.cend());
+
+        Plane plane;
+        plane.setWeightFunc(WeightFunc(analysisScale));
+        plane.init(pos);
+        const FIT_RESULT planeRes = plane.compute(points.cbegin(), points.cend());
+
+        Sphere sphere;
+        sphere.setWeightFunc(WeightFunc(analysisScale));
+        sphere.init(pos);
+        const FIT_RESULT sphereRes = sphere.compute(points.cbegin(), points.cend());
+
+        Curvature curvature;
+        curvature.setWeightFunc(WeightFunc(analysisScale));
+        curvature.init(pos);
+        const FIT_RESULT curvatureRes = curvature.compute(points.cbegin(), points.cend());
+
+        // two passes: the second one is not fed to the other fits
+        Monge monge;
+        monge.setWeightFunc(WeightFunc(analysisScale));
+        monge.init(pos);
+        const FIT_RESULT mongeRes = monge.compute(points.cbegin(), points.cend());
+
+        // same neighbors, weights and operations: the results are identical
+        VERIFY(fits.template result<0>() == planeRes);
+        VERIFY(fits.template result<1>() == sphereRes);
+        VERIFY(fits.template result<2>() == curvatureRes);
+        VERIFY(fits.template result<3>() == mongeRes);
+        VERIFY(res == std::max(std::max(planeRes, sphereRes), std::max(curvatureRes, mongeRes)));
+
+        if(planeRes == STABLE)
+            VERIFY(fits.template get<0>().primitiveGradient(pos) == plane.primitiveGradient(pos));
+        if(sphereRes == STABLE)
+            VERIFY(fits.template get<1>().potential(pos) == sphere.potential(pos));
+        if(curvatureRes == STABLE)
+            VERIFY(fits.template get<2>().k1() == curvature.k1() && fits.template get<2>().k2() == curvature.k2());
+        if(mongeRes == STABLE)
+            VERIFY(fits.template get<3>().kMean() == monge.kMean());
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightFunc;
+
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit> Plane;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit> Sphere;
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit, NormalCovarianceCurvature> Curvature;
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit, MongePatch> Monge;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Point, Plane, Sphere, Curvature, Monge>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test BasketTuple in 3 dimensions..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,121 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/compute_all.cpp
+    \brief Test that computeAll gives the same results as fitting the KdTree neighborhoods one after the other
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/computeAll.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/mongePatch.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename DataPoint, typename Fit>
+void testFunction()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename Fit::WFunctor WeightFunc;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(100, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt( Scalar(4. * M_PI) * radius * radius / nbPoints);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10000);
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false, false);
+
+    // fit only the sampled points, over the sampled points
+    vector<int> sampling;
+    for(int i = 0; i < nbPoints; ++i)
+        if(Eigen::internal::random<int>(0, 3) != 0)
+            sampling.push_back(i);
+
+    KdTree<DataPoint> tree(points, sampling);
+
+    vector<Fit> fits(nbPoints);
+    vector<FIT_RESULT> results(nbPoints, UNDEFINED);
+    vector<int> calls(nbPoints, 0);
+    computeAll<Fit>(tree, analysisScale, [&](int i, const Fit& fit, FIT_RESULT res) {
+        fits[i] = fit; results[i] = res; ++calls[i];
+    });
+
+    vector<bool> sampled(nbPoints, false);
+    for(int i : sampling)
+        sampled[i] = true;
+
+#pragma omp parallel for
+    for(int i = 0; i < nbPoints; ++i)
+    {
+        VERIFY(calls[i] == (sampled[i] ? 1 : 0));
+        if(!sampled[i])
+            continue;
+
+        vector<DataPoint> neighborhood;
+        for(int j : tree.range_neighbors(points[i].pos(), analysisScale))
+            neighborhood.push_back(points[j]);
+
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(analysisScale));
+        fit.init(points[i].pos());
+        const FIT_RESULT res = fit.compute(neighborhood.cbegin(), neighborhood.cend());
+
+        // same neighbors in the same order: the results are identical
+        VERIFY(res == results[i]);
+        if(res == STABLE)
+        {
+            VERIFY(fit.primitiveGradient(points[i].pos()) == fits[i].primitiveGradient(points[i].pos()));
+            VERIFY(fit.potential(points[i].pos()) == fits[i].potential(points[i].pos()));
+        }
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightFunc;
+
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit> Plane;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit> Sphere;
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit, MongePatch> Monge; // two passes
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Point, Plane>() ));
+        CALL_SUBTEST(( testFunction<Point, Sphere>() ));
+        CALL_SUBTEST(( testFunction<Point, Monge>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test computeAll in 3 dimensions..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
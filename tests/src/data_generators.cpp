@@ -0,0 +1,185 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/data_generators.cpp
+    \brief Test the reproducibility and the shapes of the synthetic clouds of the tests and benchmarks
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/data_generators.h"
+
+#include <Ponca/src/Common/IO/pointCloudFile.h>
+
+#include <filesystem>
+
+using namespace std;
+using namespace Ponca;
+
+// The points of a generator only depend on their index: chunks generated apart match the whole cloud
+template<typename DataPoint, typename Generator>
+void testReproducible(const Generator& generator, int n)
+{
+    const vector<DataPoint> whole = generate_cloud<DataPoint>(generator, n);
+    vector<DataPoint> chunks(n);
+    for (int first = 0; first < n; first += 1000)
+        generate_cloud(generator, std::uint64_t(first), std::min(1000, n - first), chunks.data() + first);
+    for (int i = 0; i < n; ++i)
+    {
+        VERIFY(whole[i].pos() == chunks[i].pos());
+        VERIFY(whole[i].pos() == generator(std::uint64_t(i)).pos());
+    }
+}
+
+template<typename DataPoint>
+void testSurfaces()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    const Scalar epsilon = testEpsilon<Scalar>();
+    const int n = 10000;
+
+    surface_generator<DataPoint> generator;
+    generator.options.seed = 3;
+    for (SURFACE_SHAPE shape : {SURFACE_SPHERE, SURFACE_PLANE, SURFACE_PARABOLOID})
+    {
+        generator.shape = shape;
+        generator.options.noise = 0;
+        generator.options.outlier_ratio = 0;
+        generator.options.density_gradient = 0;
+        testReproducible<DataPoint>(generator, n);
+
+        // without noise, the points are on the surface, and the normals are unit
+        for (const DataPoint& p : generate_cloud<DataPoint>(generator, n))
+        {
+            const VectorType& x = p.pos();
+            VERIFY(std::abs(p.normal().norm() - Scalar(1)) < epsilon);
+            switch (shape)
+            {
+            case SURFACE_SPHERE:     VERIFY(std::abs(x.norm() - Scalar(1)) < epsilon); break;
+            case SURFACE_PLANE:      VERIFY(x.z() == Scalar(0)); break;
+            case SURFACE_PARABOLOID: VERIFY(std::abs(x.z() - (x.x() * x.x() + x.y() * x.y())) < epsilon); break;
+            }
+        }
+
+        // the density gradient shifts the points to the end of the first parameter
+        generator.options.density_gradient = 3;
+        int upper = 0;
+        for (const DataPoint& p : generate_cloud<DataPoint>(generator, n))
+            upper += (shape == SURFACE_SPHERE ? p.pos().z() : p.pos().x()) > Scalar(0);
+        VERIFY(upper > n * 3 / 4);
+
+        // the outliers are out of the surface, the noisy points close to it
+        generator.options.density_gradient = 0;
+        generator.options.noise = 0.01;
+        generator.options.outlier_ratio = 0.1;
+        int outliers = 0;
+        for (const DataPoint& p : generate_cloud<DataPoint>(generator, n))
+        {
+            const VectorType& x = p.pos();
+            Scalar distance = 0;
+            switch (shape)
+            {
+            case SURFACE_SPHERE:     distance = std::abs(x.norm() - Scalar(1)); break;
+            case SURFACE_PLANE:      distance = std::abs(x.z()); break;
+            case SURFACE_PARABOLOID: distance = std::abs(x.z() - (x.x() * x.x() + x.y() * x.y())); break;
+            }
+            outliers += distance > Scalar(0.1);
+        }
+        VERIFY(outliers > n / 20 && outliers < n / 10);
+    }
+}
+
+template<typename DataPoint>
+void testLidar()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    lidar_generator<DataPoint> generator;
+    generator.points_per_ring = 256;
+    generator.rings = 16;
+    const int n = generator.points_per_ring * generator.rings;
+    testReproducible<DataPoint>(generator, n);
+
+    // the points hit the ground, the walls or the far sphere
+    for (const DataPoint& p : generate_cloud<DataPoint>(generator, n))
+    {
+        const auto x = p.pos().template cast<double>();
+        const bool ground = std::abs(x.z() + generator.height) < 1e-3;
+        const bool wall   = std::abs(std::abs(x.y()) - generator.width) < 1e-3;
+        const bool far    = std::abs(x.norm() - generator.max_range) < 1e-2;
+        VERIFY(ground || wall || far);
+        VERIFY(std::abs(p.normal().norm() - Scalar(1)) < testEpsilon<Scalar>());
+    }
+}
+
+template<typename DataPoint>
+void testMultiscaleClusters()
+{
+    multiscale_cluster_generator<DataPoint> generator;
+    generator.options.seed = 5;
+    testReproducible<DataPoint>(generator, 10000);
+
+    // seeds give different clouds
+    multiscale_cluster_generator<DataPoint> other = generator;
+    other.options.seed = 6;
+    VERIFY(generator(0).pos() != other(0).pos());
+}
+
+template<typename DataPoint>
+void testStreamToPly()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    surface_generator<DataPoint> generator;
+    generator.shape = SURFACE_PARABOLOID;
+    generator.options.noise = 0.01;
+    const int n = 2500;
+
+    // written by chunks smaller than the cloud
+    const string filename = (filesystem::temp_directory_path() / "ponca_data_generators.ply").string();
+    VERIFY(write_cloud_ply<DataPoint>(filename, generator, n, 1000));
+
+    PointCloudFile file;
+    VERIFY(file.open(filename));
+    VERIFY(file.point_count() == std::size_t(n) && file.has_normals());
+    vector<DataPoint> points(n);
+    file.read(points.data());
+    for (int i = 0; i < n; ++i)
+    {
+        const DataPoint expected = generator(std::uint64_t(i));
+        VERIFY((points[i].pos() - expected.pos()).norm() < Scalar(1e-5));
+        VERIFY((points[i].normal() - expected.normal()).norm() < Scalar(1e-5));
+    }
+    file.close();
+    filesystem::remove(filename);
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+    typedef PointPositionNormal<Scalar, 4> Point4;
+
+    CALL_SUBTEST(( testSurfaces<Point>() ));
+    CALL_SUBTEST(( testLidar<Point>() ));
+    CALL_SUBTEST(( testMultiscaleClusters<Point>() ));
+    CALL_SUBTEST(( testMultiscaleClusters<Point4>() ));
+    CALL_SUBTEST(( testReproducible<Point4>(uniform_generator<Point4>(), 10000) ));
+    CALL_SUBTEST(( testStreamToPly<Point>() ));
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the synthetic data generators..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
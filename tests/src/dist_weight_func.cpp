@@ -5,17 +5,35 @@
 */
 
 /*!
-    \file test/Grenaille/dist_weight_func.cpp
+    \file test/src/dist_weight_func.cpp
     \brief Test distance weight function derivatives
  */
 
 #include "../common/testing.h"
 #include "../common/testUtils.h"
 
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
 #include <unsupported/Eigen/AutoDiff>
 
 using namespace std;
-using namespace Grenaille;
+using namespace Ponca;
+
+// Smooth kernel only defined in x, to test the computations of DistWeightFunc from the norm of the queries
+template <typename _Scalar>
+class NormSmoothWeightKernel
+{
+public:
+    typedef _Scalar Scalar;
+
+    inline Scalar f  (const Scalar& _x) const { return m_k.f(_x); }
+    inline Scalar df (const Scalar& _x) const { return m_k.df(_x); }
+    inline Scalar ddf(const Scalar& _x) const { return m_k.ddf(_x); }
+
+private:
+    SmoothWeightKernel<Scalar> m_k;
+};
 
 template<typename DataPoint, typename WeightKernel>
 void testFunctionAutoDiff()
@@ -102,7 +120,8 @@ void testFunction()
 
     Scalar epsilon = testEpsilon<Scalar>();
     Scalar t       = Eigen::internal::random<Scalar>(0.10, 10.0);
-    Scalar h       = Scalar(1e-5);
+    // step relative to the scale: the derivatives grow as powers of 1/t, and so do the truncation errors
+    Scalar h       = Scalar(1e-5) * t;
     Scalar h2      = Scalar(.5)*h;
 
     DistWeightFunc<DataPoint, WeightKernel> wfunc(t);
@@ -189,6 +208,67 @@ void testFunction()
     VERIFY( std::abs(d2t_w-d2t_w_) < epsilon );
 }
 
+template<typename DataPoint>
+void testSquaredKernel()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    static_assert(internal::HasSquaredKernel<SmoothWeightKernel<Scalar> >::value, "squared kernel expected");
+    static_assert(!internal::HasSquaredKernel<NormSmoothWeightKernel<Scalar> >::value, "norm kernel expected");
+
+    Scalar epsilon = testEpsilon<Scalar>();
+    Scalar t       = Eigen::internal::random<Scalar>(0.10, 10.0);
+
+    // the computations from the squared norm match the computations from the norm
+    DistWeightFunc<DataPoint, SmoothWeightKernel<Scalar> > wfunc(t);
+    DistWeightFunc<DataPoint, NormSmoothWeightKernel<Scalar> > wfuncNorm(t);
+
+    DataPoint dummy;
+    for (const VectorType& x : {VectorType(t*VectorType::Random()), VectorType(Scalar(2)*t*VectorType::Random())})
+    {
+        VERIFY( std::abs(wfunc.w(x, dummy) - wfuncNorm.w(x, dummy)) < epsilon );
+        VERIFY( (wfunc.spacedw(x, dummy) - wfuncNorm.spacedw(x, dummy)).array().abs().maxCoeff() < epsilon );
+        VERIFY( (wfunc.spaced2w(x, dummy) - wfuncNorm.spaced2w(x, dummy)).array().abs().maxCoeff() < epsilon );
+        VERIFY( std::abs(wfunc.scaledw(x, dummy) - wfuncNorm.scaledw(x, dummy)) < epsilon );
+        VERIFY( std::abs(wfunc.scaled2w(x, dummy) - wfuncNorm.scaled2w(x, dummy)) < epsilon );
+        VERIFY( (wfunc.scaleSpaced2w(x, dummy) - wfuncNorm.scaleSpaced2w(x, dummy)).array().abs().maxCoeff() < epsilon );
+    }
+}
+
+// The tabulated kernels match the kernels they sample, and so do the weight functions using them
+template<typename DataPoint, typename Kernel>
+void testTabulatedKernel()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef TabulatedWeightKernel<Kernel> Tabulated;
+
+    static_assert(internal::HasSquaredKernel<Tabulated>::value, "squared kernel expected");
+
+    Scalar epsilon = Scalar(1e-3);
+    Kernel k;
+    Tabulated tk;
+    for (Scalar x = 0; x <= Scalar(1); x += Scalar(0.01))
+    {
+        VERIFY( std::abs(k.f(x) - tk.f(x)) < epsilon );
+        VERIFY( std::abs(k.df(x) - tk.df(x)) < epsilon );
+        VERIFY( std::abs(k.ddf(x) - tk.ddf(x)) < epsilon );
+    }
+
+    Scalar t = Eigen::internal::random<Scalar>(0.10, 10.0);
+    DistWeightFunc<DataPoint, Kernel> wfunc(t);
+    DistWeightFunc<DataPoint, Tabulated> wfuncTabulated(t);
+
+    DataPoint dummy;
+    for (const VectorType& x : {VectorType(t*VectorType::Random()), VectorType(Scalar(2)*t*VectorType::Random())})
+    {
+        VERIFY( std::abs(wfunc.w(x, dummy) - wfuncTabulated.w(x, dummy)) < epsilon );
+        VERIFY( std::abs(wfunc.scaledw(x, dummy) - wfuncTabulated.scaledw(x, dummy)) * t < epsilon );
+        VERIFY( (wfunc.spacedw(x, dummy) - wfuncTabulated.spacedw(x, dummy)).array().abs().maxCoeff() * t < epsilon );
+    }
+}
+
 template<typename Scalar, int Dim>
 void callSubTests()
 {
@@ -202,14 +282,31 @@ void callSubTests()
 
     typedef SmoothWeightKernel<ScalarDiff> SmoothKernelDiff;
     typedef ConstantWeightKernel<ScalarDiff> ConstantKernelDiff;
+    typedef EpanechnikovWeightKernel<ScalarDiff> EpanechnikovKernelDiff;
+    typedef WendlandWeightKernel<ScalarDiff> WendlandKernelDiff;
+    typedef GaussianWeightKernel<ScalarDiff> GaussianKernelDiff;
 
     for(int i = 0; i < g_repeat; ++i)
     {
         CALL_SUBTEST(( testFunction<DataPoint, SmoothKernel>() ));
         CALL_SUBTEST(( testFunction<DataPoint, ConstantKernel>() ));
+        CALL_SUBTEST(( testFunction<DataPoint, NormSmoothWeightKernel<Scalar> >() ));
+        CALL_SUBTEST(( testFunction<DataPoint, SmoothWeightKernel<Scalar, 3> >() ));
+        CALL_SUBTEST(( testFunction<DataPoint, SmoothWeightKernel<Scalar, 4> >() ));
+        CALL_SUBTEST(( testFunction<DataPoint, EpanechnikovWeightKernel<Scalar> >() ));
+        CALL_SUBTEST(( testFunction<DataPoint, WendlandWeightKernel<Scalar> >() ));
+        CALL_SUBTEST(( testFunction<DataPoint, GaussianWeightKernel<Scalar> >() ));
+        CALL_SUBTEST(( testSquaredKernel<DataPoint>() ));
+        CALL_SUBTEST(( testTabulatedKernel<DataPoint, SmoothKernel>() ));
+        CALL_SUBTEST(( testTabulatedKernel<DataPoint, GaussianWeightKernel<Scalar> >() ));
 
         CALL_SUBTEST(( testFunctionAutoDiff<DataPointDiff, SmoothKernelDiff>() ));
         CALL_SUBTEST(( testFunctionAutoDiff<DataPointDiff, ConstantKernelDiff>() ));
+        CALL_SUBTEST(( testFunctionAutoDiff<DataPointDiff, SmoothWeightKernel<ScalarDiff, 3> >() ));
+        CALL_SUBTEST(( testFunctionAutoDiff<DataPointDiff, SmoothWeightKernel<ScalarDiff, 4> >() ));
+        CALL_SUBTEST(( testFunctionAutoDiff<DataPointDiff, EpanechnikovKernelDiff>() ));
+        CALL_SUBTEST(( testFunctionAutoDiff<DataPointDiff, WendlandKernelDiff>() ));
+        CALL_SUBTEST(( testFunctionAutoDiff<DataPointDiff, GaussianKernelDiff>() ));
 
     }
     cout << "ok" << endl;
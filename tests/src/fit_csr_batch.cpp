@@ -0,0 +1,169 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/fit_csr_batch.cpp
+    \brief Test the fits of neighborhoods in CSR format, as computed by the CUDA batch kernels
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/csrNeighborhoods.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename DataPoint, typename Fit>
+void testFunction()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename Fit::WFunctor WeightFunc;
+    enum { Dim = DataPoint::Dim, WarpSize = 32 };
+
+    const int nbPoints = Eigen::internal::random<int>(500, 2000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt( Scalar(4. * M_PI) * radius * radius / nbPoints);
+    // small coordinates, stored accurately enough by half precision floats
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10);
+    const Scalar epsilon = Scalar(100) * testEpsilon<Scalar>() * radius;
+    const Scalar halfEpsilon = Scalar(0.05) * radius;
+
+    vector<DataPoint> points(nbPoints);
+    vector<VectorType> pointPositions(nbPoints);
+    vector<Scalar> positions(Dim * nbPoints), normals(Dim * nbPoints);
+    for(int i = 0; i < nbPoints; ++i)
+    {
+        points[i] = getPointOnSphere<DataPoint>(radius, center, false, false, false);
+        pointPositions[i] = points[i].pos();
+        Eigen::Map<VectorType>(positions.data() + Dim * i) = points[i].pos();
+        Eigen::Map<VectorType>(normals.data() + Dim * i)   = points[i].normal();
+    }
+    auto toHalf = [](const vector<Scalar>& v) {
+        vector<Eigen::half> h(v.size());
+        transform(v.begin(), v.end(), h.begin(), [](Scalar x) { return Eigen::half(x); });
+        return h;
+    };
+    const vector<Eigen::half> halfPositions = toHalf(positions), halfNormals = toHalf(normals);
+
+    // neighborhoods of the points, then of positions around them
+    KdTree<DataPoint> tree(points);
+    vector<VectorType> queryPositions(nbPoints / 4);
+    vector<Scalar> queries(Dim * queryPositions.size());
+    for(size_t i = 0; i < queryPositions.size(); ++i)
+    {
+        queryPositions[i] = points[i].pos() + VectorType::Random() * analysisScale * Scalar(0.5);
+        Eigen::Map<VectorType>(queries.data() + Dim * i) = queryPositions[i];
+    }
+    const vector<Eigen::half> halfQueries = toHalf(queries);
+
+    for(bool atPoints : {true, false})
+    {
+        vector<size_t> offsets;
+        vector<int> indices;
+        if(atPoints)
+            tree.range_neighbors_batch(pointPositions, analysisScale, offsets, indices);
+        else
+            tree.range_neighbors_batch(queryPositions, analysisScale, offsets, indices);
+        const CsrNeighborhoods<Scalar> nei {positions.data(), normals.data(), atPoints ? nullptr : queries.data(),
+                                            offsets.data(), indices.data(), int(offsets.size()) - 1};
+        const CsrNeighborhoods<Eigen::half> halfNei {halfPositions.data(), halfNormals.data(),
+                                                     atPoints ? nullptr : halfQueries.data(),
+                                                     offsets.data(), indices.data(), nei.count};
+        const WeightFunc w(analysisScale);
+
+#pragma omp parallel for
+        for(int i = 0; i < nei.count; ++i)
+        {
+            const VectorType q = atPoints ? points[i].pos() : queryPositions[i];
+            vector<DataPoint> neighbors;
+            for(size_t k = offsets[i]; k < offsets[i + 1]; ++k)
+                neighbors.push_back(points[indices[k]]);
+            VERIFY(nei.size(i) == int(neighbors.size()));
+
+            Fit reference;
+            reference.setWeightFunc(w);
+            reference.init(q);
+            // added one by one, as compute may accumulate blocks of neighbors in another order
+            FIT_RESULT referenceRes;
+            do {
+                for(const auto& n : neighbors)
+                    reference.addNeighbor(n);
+                referenceRes = reference.finalize();
+            } while(referenceRes == NEED_OTHER_PASS);
+
+            // one thread per evaluation point: same neighbors in the same order
+            Fit fit;
+            VERIFY(fitCsrNeighborhood(fit, i, w, nei) == referenceRes);
+
+            // one warp per evaluation point: strided parts of the neighborhood, merged in the order of warpMergeFits
+            vector<Fit> partials(WarpSize);
+            for(int lane = 0; lane < WarpSize; ++lane)
+            {
+                initCsrFit(partials[lane], i, w, nei);
+                addCsrNeighbors(partials[lane], i, nei, lane, WarpSize);
+            }
+            for(int s = WarpSize / 2; s > 0; s /= 2)
+                for(int lane = 0; lane < s; ++lane)
+                    partials[lane].merge(partials[lane + s]);
+            VERIFY(partials[0].finalize() == referenceRes);
+
+            // half precision storage, converted when the points are read
+            Fit half;
+            const FIT_RESULT halfRes = fitCsrNeighborhood(half, i, w, halfNei);
+
+            if(referenceRes == STABLE)
+            {
+                VERIFY(halfRes == STABLE);
+                VERIFY((half.project(q) - reference.project(q)).norm() < halfEpsilon);
+                VERIFY(fit.potential(q) == reference.potential(q));
+                VERIFY((fit.project(q) - reference.project(q)).norm() == Scalar(0));
+                VERIFY(std::abs(std::abs(partials[0].potential(q)) - std::abs(reference.potential(q))) < epsilon);
+            }
+        }
+    }
+}
+
+template<typename Scalar, int Dim>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, Dim> Point;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightFunc;
+
+    typedef Basket<Point, WeightFunc, OrientedSphereFit, GLSParam> FitSphereOriented;
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit> FitPlane;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Point, FitSphereOriented>() ));
+        CALL_SUBTEST(( testFunction<Point, FitPlane>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test fits of CSR neighborhoods..." << endl;
+    callSubTests<float, 3>();
+    callSubTests<double, 3>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,123 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/fit_engine.cpp
+    \brief Test that the FitEngine selected by name give the results of the Baskets they run
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/fitEngine.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+/// Compare the output of the engine `name` with computeAll<Fit>
+template<typename Fit, typename DataPoint>
+void compareEngine(const FitEngineRegistry<DataPoint, KdTree<DataPoint>>& registry, const string& name,
+                   const KdTree<DataPoint>& tree, typename DataPoint::Scalar scale)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    const auto engine = registry.create(name);
+    FitEngineOutput<DataPoint> output;
+    engine->computeAll(tree, scale, output);
+    VERIFY(int(output.states.size()) == tree.point_count());
+    VERIFY(engine->providesCurvature() == !output.curvatures.empty());
+
+    int stable = 0;
+    computeAll<Fit>(tree, scale, [&](int i, const Fit& fit, FIT_RESULT res)
+    {
+        VERIFY(output.states[i] == res);
+        if(res != STABLE)
+            return;
+#pragma omp atomic
+        ++stable;
+        const auto& p = tree.point(i).pos();
+        VERIFY(std::abs(output.potentials[i] - fit.potential(p)) <= testEpsilon<Scalar>());
+        VERIFY((output.normals[i] - fit.primitiveGradient(p).normalized()).norm() <= testEpsilon<Scalar>());
+        VERIFY((output.projections[i] - fit.project(p)).norm() <= testEpsilon<Scalar>());
+    });
+    VERIFY(stable > 0);
+
+    // the same scale for each point
+    FitEngineOutput<DataPoint> adaptive;
+    engine->computeAllAdaptive(tree, vector<Scalar>(tree.point_count(), scale), adaptive);
+    VERIFY(adaptive.states == output.states);
+    VERIFY(adaptive.curvatures == output.curvatures);
+}
+
+template<typename Scalar>
+void testEngines()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+    typedef PointPosition<Scalar, 3> PositionPoint;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar>> WeightFunc;
+    typedef typename Point::VectorType VectorType;
+
+    const int n = Eigen::internal::random<int>(500, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(Scalar(1), Scalar(10));
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10);
+    vector<Point> points(n);
+    vector<PositionPoint> positions(n);
+    for (int i = 0; i < n; ++i)
+    {
+        points[i] = getPointOnSphere<Point>(radius, center, false, false);
+        positions[i] = PositionPoint(points[i].pos());
+    }
+    const Scalar scale = radius / Scalar(2);
+
+    const KdTree<Point> tree(points);
+    const auto registry = FitEngineRegistry<Point, KdTree<Point>>::withDefaults();
+    VERIFY((registry.names() == vector<string>{"mean_plane", "oriented_sphere", "plane", "sphere", "unoriented_sphere"}));
+    compareEngine<Basket<Point, WeightFunc, CovariancePlaneFit>>(registry, "plane", tree, scale);
+    compareEngine<Basket<Point, WeightFunc, SphereFit, GLSParam>>(registry, "sphere", tree, scale);
+    compareEngine<Basket<Point, WeightFunc, MeanPlaneFit>>(registry, "mean_plane", tree, scale);
+    compareEngine<Basket<Point, WeightFunc, OrientedSphereFit, GLSParam>>(registry, "oriented_sphere", tree, scale);
+    compareEngine<Basket<Point, WeightFunc, UnorientedSphereFit, GLSParam>>(registry, "unoriented_sphere", tree, scale);
+
+    // the sphere fits recover the curvature of the sphere
+    FitEngineOutput<Point> output;
+    registry.create("oriented_sphere")->computeAll(tree, scale, output);
+    for (int i = 0; i < n; ++i)
+        if (output.states[i] == STABLE)
+            VERIFY(std::abs(std::abs(output.curvatures[i]) - Scalar(1) / radius) <= testEpsilon<Scalar>());
+
+    // without normals, only the fits of the positions are registered
+    const KdTree<PositionPoint> positionTree(positions);
+    auto positionRegistry = FitEngineRegistry<PositionPoint, KdTree<PositionPoint>>::withDefaults();
+    VERIFY((positionRegistry.names() == vector<string>{"plane", "sphere"}));
+    typedef DistWeightFunc<PositionPoint, ConstantWeightKernel<Scalar>> ConstantWeightFunc;
+    positionRegistry.template add<Basket<PositionPoint, ConstantWeightFunc, CovariancePlaneFit>>("constant_plane");
+    VERIFY(positionRegistry.contains("constant_plane"));
+    compareEngine<Basket<PositionPoint, ConstantWeightFunc, CovariancePlaneFit>>(positionRegistry, "constant_plane",
+                                                                                  positionTree, scale);
+
+    bool unknown = false;
+    try { positionRegistry.create("oriented_sphere"); }
+    catch (const std::invalid_argument&) { unknown = true; }
+    VERIFY(unknown);
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the fit engines..." << endl;
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testEngines<float>() ));
+        CALL_SUBTEST(( testEngines<double>() ));
+    }
+    cout << "Ok..." << endl;
+}
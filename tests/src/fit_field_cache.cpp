@@ -0,0 +1,142 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/fit_field_cache.cpp
+    \brief Test the spheres blended by FitFieldCache against fresh fits at the queries
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/fitFieldCache.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/unorientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+/// \param oriented false for the fits whose potential is defined up to its sign
+template<typename Fit>
+void testCache(bool perfectSphere, bool oriented)
+{
+    typedef typename Fit::DataPoint DataPoint;
+    typedef typename Fit::Scalar Scalar;
+    typedef typename Fit::VectorType VectorType;
+    typedef FitFieldCache<Fit, KdTree<DataPoint>> Cache;
+
+    const Scalar radius = Eigen::internal::random<Scalar>(1, 10);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10);
+    vector<DataPoint> points(Eigen::internal::random<int>(500, 2000));
+    for (DataPoint& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, !perfectSphere, !perfectSphere);
+    const KdTree<DataPoint> tree(points);
+
+    const Scalar scale = radius * Eigen::internal::random<Scalar>(0.3, 0.5);
+    Cache cache(tree, scale);
+    int cached = 0;
+    for (int i = 0; i < int(points.size()); ++i)
+        cached += cache.isCached(i);
+    VERIFY(cached > int(points.size()) / 2);
+
+    // the queries close to the surface, e.g. the samples of rays
+    const int n = 200;
+    vector<VectorType> queries(n);
+    for (VectorType& q : queries)
+        q = getPointOnSphere<DataPoint>(radius, center, false, false).pos() +
+            VectorType::Random() * (Scalar(0.1) * scale);
+
+    const Scalar epsilon = testEpsilon<Scalar>();
+    for (Scalar tolerance : {Scalar(0), Scalar(1e-2)})
+    {
+        cache.setTolerance(tolerance);
+        typename Cache::Context context(cache);
+        for (const VectorType& q : queries)
+        {
+            typename Cache::Sphere sphere;
+            const FIT_RESULT res = cache.sphereAt(q, sphere, context);
+
+            Fit fit;
+            fit.setWeightFunc(typename Fit::WFunctor(scale));
+            fit.init(q);
+            vector<DataPoint> neighbors;
+            for (int idx : tree.range_neighbors(q, scale))
+                neighbors.push_back(points[idx]);
+            const FIT_RESULT fitRes = fit.compute(neighbors.cbegin(), neighbors.cend());
+
+            // the fits of a few neighbors are sensitive to their order
+            if (res != STABLE || fitRes != STABLE || neighbors.size() < 10)
+                continue;
+            // without tolerance, the fits again; on a perfect sphere, all the spheres are the surface
+            if (tolerance > Scalar(0) && !perfectSphere)
+                continue;
+            fit.applyPrattNorm();
+            const Scalar potential = fit.potential(q);
+            const Scalar sign = oriented || sphere.potential(q) * potential >= 0 ? Scalar(1) : Scalar(-1);
+            VERIFY(std::abs(sphere.potential(q) - sign * potential) <= epsilon * scale);
+            VERIFY((sphere.project(q) - fit.project(q)).norm() <= epsilon * scale);
+            VERIFY(Scalar(1) - sign * sphere.primitiveGradient(q).normalized().dot(fit.primitiveGradient(q).normalized()) <= epsilon);
+        }
+        VERIFY(context.cachedCount() + context.refitCount() == n);
+        if (tolerance == Scalar(0))
+            VERIFY(context.cachedCount() == 0);
+        else if (perfectSphere)
+            VERIFY(context.cachedCount() > n / 2);
+    }
+
+    // the batch evaluation gives the results of the queries
+    vector<Scalar> potentials(n);
+    vector<VectorType> projections(n);
+    vector<FIT_RESULT> states(n);
+    cache.evaluateBatch(queries.data(), n, potentials.data(), nullptr, projections.data(), states.data());
+    typename Cache::Context context(cache);
+    for (int i = 0; i < n; ++i)
+    {
+        typename Cache::Sphere sphere;
+        VERIFY(cache.sphereAt(queries[i], sphere, context) == states[i]);
+        if (states[i] != UNDEFINED)
+        {
+            VERIFY(std::abs(potentials[i] - sphere.potential(queries[i])) <= epsilon * scale);
+            VERIFY((projections[i] - sphere.project(queries[i])).norm() <= epsilon * scale);
+        }
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar>> WeightFunc;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit> SphereFit;
+    typedef Basket<Point, WeightFunc, UnorientedSphereFit> UnorientedFit;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testCache<SphereFit>(true, true) ));
+        CALL_SUBTEST(( testCache<SphereFit>(false, true) ));
+        CALL_SUBTEST(( testCache<UnorientedFit>(true, false) ));
+        CALL_SUBTEST(( testCache<UnorientedFit>(false, false) ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the cache of fits..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,126 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/fit_incremental.cpp
+    \brief Test that fits updated incrementally along a scanline match the fits computed from scratch
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/meanPlaneFit.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename DataPoint, typename Fit>
+void testFunction()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename Fit::WFunctor WeightFunc;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(500, 2000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt( Scalar(4. * M_PI) * radius * radius / nbPoints);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10000);
+    const Scalar epsilon = Scalar(1e-6);
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false, false);
+
+    // the evaluation position slides along a scanline through the sphere
+    const VectorType start = points[0].pos();
+    const VectorType step = VectorType::Random().normalized() * analysisScale * Scalar(0.1);
+    const int stepCount = 50;
+
+    auto inside = [&](int j, const VectorType& pos) {
+        return (points[j].pos() - pos).squaredNorm() <= analysisScale * analysisScale;
+    };
+
+    Fit fit;
+    fit.setWeightFunc(WeightFunc(analysisScale));
+    fit.init(start);
+    for(const auto& p : points)
+        fit.addNeighbor(p);
+
+    for(int k = 1; k <= stepCount; ++k)
+    {
+        const VectorType previous = start + Scalar(k - 1) * step;
+        const VectorType pos = start + Scalar(k) * step;
+
+        // remove the neighbors leaving the neighborhood before moving, then add the new ones
+        for(int j = 0; j < nbPoints; ++j)
+            if(inside(j, previous) && !inside(j, pos))
+                VERIFY(fit.removeNeighbor(points[j]));
+        fit.moveEvalPos(pos);
+        for(int j = 0; j < nbPoints; ++j)
+            if(!inside(j, previous) && inside(j, pos))
+                VERIFY(fit.addNeighbor(points[j]));
+
+        Fit incremental = fit;
+        const FIT_RESULT res = incremental.finalize();
+
+        Fit reference;
+        reference.setWeightFunc(WeightFunc(analysisScale));
+        reference.init(pos);
+        const FIT_RESULT referenceRes = reference.compute(points.cbegin(), points.cend());
+
+        VERIFY(res == referenceRes);
+        if(res == STABLE)
+        {
+            VERIFY((incremental.primitiveGradient(pos) - reference.primitiveGradient(pos)).norm() < epsilon);
+            VERIFY(std::abs(incremental.potential(pos) - reference.potential(pos)) < epsilon * analysisScale);
+        }
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+
+    // the weights of the neighbors do not depend on the evaluation position
+    typedef DistWeightFunc<Point, ConstantWeightKernel<Scalar> > WeightFunc;
+
+    typedef Basket<Point, WeightFunc, MeanPlaneFit> MeanPlane;
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit> CovariancePlane;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit> Sphere;
+    // extensions reading the results of the fitting procedure only
+    typedef Basket<Point, WeightFunc, OrientedSphereFit, GLSParam> Gls;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Point, MeanPlane>() ));
+        CALL_SUBTEST(( testFunction<Point, CovariancePlane>() ));
+        CALL_SUBTEST(( testFunction<Point, Sphere>() ));
+        CALL_SUBTEST(( testFunction<Point, Gls>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test incremental fits in 3 dimensions..." << endl;
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,155 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/fit_irls.cpp
+    \brief Test that the IRLS reweighting recovers planes and spheres from samples with outliers, replaying the
+    cached neighbors
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/irls.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+// Fit `_points` at `_pos` with a copy of `_fit`, keeping its parameters
+template<typename Fit, typename DataPoint>
+Fit fitNeighborhood(Fit _fit, const vector<DataPoint>& _points, const typename DataPoint::VectorType& _pos,
+                    typename DataPoint::Scalar _scale, bool _cached, FIT_RESULT& _res)
+{
+    Fit& fit = _fit;
+    fit.setWeightFunc(typename Fit::WFunctor(_scale));
+    fit.init(_pos);
+    _res = _cached ? fit.computeWithCache(_points.cbegin(), _points.cend())
+                   : fit.compute(_points.cbegin(), _points.cend());
+    return fit;
+}
+
+template<typename DataPoint, typename Fit, typename Robust>
+void testPlane(ROBUST_WEIGHT _weight)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    const int nbPoints = Eigen::internal::random<int>(500, 1000);
+    const Scalar width = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = width;
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10);
+    const VectorType direction = VectorType::Random().normalized();
+    const Scalar epsilon = Scalar(10) * testEpsilon<Scalar>();
+
+    // a fifth of the samples are outliers, on the same side of the plane
+    vector<DataPoint> points(nbPoints);
+    for(int i = 0; i < nbPoints; ++i)
+    {
+        points[i] = getPointOnPlane<DataPoint>(center, direction, width * Eigen::internal::random<Scalar>(0., 1.),
+                                               false, false, false);
+        if(i % 5 == 0)
+            points[i].pos() += direction * Scalar(0.3) * analysisScale;
+    }
+
+    Robust parameters;
+    parameters.setRobustWeight(_weight, Scalar(0.1));
+
+    FIT_RESULT res, cachedRes, referenceRes;
+    const Robust robust = fitNeighborhood(parameters, points, center, analysisScale, false, res);
+    const Robust cached = fitNeighborhood(parameters, points, center, analysisScale, true, cachedRes);
+    const Fit reference = fitNeighborhood(Fit(), points, center, analysisScale, false, referenceRes);
+
+    VERIFY(res == cachedRes);
+    VERIFY(robust.isStable() && reference.isStable());
+    VERIFY(robust.passCount() > 1);
+
+    // the outliers shift the least squares plane, not the robust one
+    const Scalar error = std::abs(robust.potential(center));
+    VERIFY(error < std::abs(reference.potential(center)));
+    if(_weight == TUKEY_WEIGHT)
+        VERIFY(error <= epsilon * analysisScale);
+    VERIFY(std::abs(std::abs(robust.primitiveGradient(center).dot(direction)) - Scalar(1)) <= Scalar(0.01));
+
+    // same neighbors and weights at each pass
+    VERIFY(std::abs(cached.potential(center) - robust.potential(center)) <= epsilon * analysisScale);
+}
+
+template<typename DataPoint, typename Fit, typename Robust>
+void testSphere()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    const int nbPoints = Eigen::internal::random<int>(500, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = radius;
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10);
+    const Scalar epsilon = Scalar(10) * testEpsilon<Scalar>();
+
+    // a fifth of the samples are outliers, outside of the sphere
+    vector<DataPoint> points(nbPoints);
+    for(int i = 0; i < nbPoints; ++i)
+    {
+        points[i] = getPointOnSphere<DataPoint>(radius, center, false, false, false);
+        if(i % 5 == 0)
+            points[i].pos() += points[i].normal() * Scalar(0.3) * analysisScale;
+    }
+    const VectorType pos = points[1].pos();
+
+    FIT_RESULT res, cachedRes, referenceRes;
+    const Robust robust = fitNeighborhood(Robust(), points, pos, analysisScale, false, res);
+    const Robust cached = fitNeighborhood(Robust(), points, pos, analysisScale, true, cachedRes);
+    const Fit reference = fitNeighborhood(Fit(), points, pos, analysisScale, false, referenceRes);
+
+    VERIFY(res == cachedRes);
+    VERIFY(robust.isStable() && reference.isStable());
+
+    const Scalar error = std::abs(robust.radius() - radius);
+    VERIFY(error < std::abs(reference.radius() - radius));
+    VERIFY(error <= epsilon * radius);
+    VERIFY(std::abs(cached.radius() - robust.radius()) <= epsilon * radius);
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightSmoothFunc;
+
+    typedef Basket<Point, WeightSmoothFunc, CovariancePlaneFit> Plane;
+    typedef Basket<Point, WeightSmoothFunc, CovariancePlaneFit, IrlsReweighting> RobustPlane;
+    typedef Basket<Point, WeightSmoothFunc, OrientedSphereFit> Sphere;
+    typedef Basket<Point, WeightSmoothFunc, OrientedSphereFit, IrlsReweighting> RobustSphere;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testPlane<Point, Plane, RobustPlane>(TUKEY_WEIGHT) ));
+        CALL_SUBTEST(( testPlane<Point, Plane, RobustPlane>(HUBER_WEIGHT) ));
+        CALL_SUBTEST(( testSphere<Point, Sphere, RobustSphere>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test IRLS reweighting..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,103 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/fit_lod.cpp
+    \brief Test the fits adding the nodes of an Octree from their aggregate against the fits of the range neighbors
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/lodFit.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/Octree/octree.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename Fit, typename Aggregate>
+void testFunction()
+{
+    typedef typename Fit::DataPoint DataPoint;
+    typedef typename Fit::Scalar Scalar;
+    typedef typename Fit::VectorType VectorType;
+    typedef typename Fit::WFunctor WeightFunc;
+    typedef Octree<DataPoint, Aggregate> Tree;
+
+    const Scalar radius = Eigen::internal::random<Scalar>(1, 10);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10);
+    vector<DataPoint> points(Eigen::internal::random<int>(20000, 40000));
+    for (DataPoint& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false);
+    const Tree tree(points);
+
+    // large scales, covering a large part of the sphere
+    const Scalar scale = radius * Eigen::internal::random<Scalar>(Scalar(0.5), Scalar(1));
+    const Scalar tolerance = Scalar(0.25);
+    const Scalar epsilon = testEpsilon<Scalar>() * scale;
+
+    for (int i = 0; i < int(points.size()); i += int(points.size()) / 20)
+    {
+        const VectorType p = points[i].pos();
+
+        vector<DataPoint> neighbors;
+        for (int j : tree.lod_neighbors(p, scale, Scalar(0)))
+            neighbors.push_back(tree.point(j));
+        Fit exact;
+        exact.setWeightFunc(WeightFunc(scale));
+        exact.init(p);
+        VERIFY(exact.compute(neighbors.cbegin(), neighbors.cend()) == STABLE);
+        const VectorType q = exact.project(p);
+
+        // without tolerance: only points, same fit
+        Fit fit;
+        VERIFY(computeWithLod(fit, tree, WeightFunc(scale), p, Scalar(0)) == STABLE);
+        VERIFY((fit.project(p) - q).norm() <= epsilon);
+
+        // with tolerance: fewer items, close surfaces
+        int items = 0;
+        for (int j : tree.lod_neighbors(p, scale, tolerance))
+            ++items, (void)j;
+        VERIFY(items < int(neighbors.size()));
+        VERIFY(computeWithLod(fit, tree, WeightFunc(scale), p, tolerance) == STABLE);
+        VERIFY((fit.project(q) - q).norm() <= tolerance * scale * Scalar(0.1) + epsilon);
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar>> WeightFunc;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit> SphereFit;
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit> PlaneFit;
+
+    for (int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<SphereFit, OctreeOrientedMoments<Point>>() ));
+        CALL_SUBTEST(( testFunction<PlaneFit, OctreeCovarianceMoments<Point>>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the fits of the Octree nodes in float..." << endl;
+    callSubTests<float>();
+    cout << "Test the fits of the Octree nodes in double..." << endl;
+    callSubTests<double>();
+}
@@ -0,0 +1,143 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/fit_mixed_precision.cpp
+    \brief Test that fits of float points accumulated in double, or with compensated sums, match the fits of the same
+    points in double
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/mlsSphereFitDer.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+// Point stored in float, accumulated in double by the fits
+class PointAccumulateDouble : public PointPositionNormal<float, 3>
+{
+public:
+    typedef double AccumulatorScalar;
+    using PointPositionNormal<float, 3>::PointPositionNormal;
+};
+
+// Point stored and accumulated in float, with compensated sums
+class PointCompensated : public PointPositionNormal<float, 3>
+{
+public:
+    enum {CompensatedSum = 1};
+    using PointPositionNormal<float, 3>::PointPositionNormal;
+};
+
+typedef PointPositionNormal<double, 3> PointDouble;
+
+template<typename Point, template <class, class, typename> class... Ext>
+struct Fits
+{
+    typedef Basket<Point, DistWeightFunc<Point, SmoothWeightKernel<float> >, Ext...> Mixed;
+    typedef Basket<PointDouble, DistWeightFunc<PointDouble, SmoothWeightKernel<double> >, Ext...> Reference;
+};
+
+template<typename Fit, typename DataPoint>
+Fit fitNeighborhood(const vector<DataPoint>& _points, const typename DataPoint::VectorType& _pos,
+                    typename DataPoint::Scalar _scale)
+{
+    Fit fit;
+    fit.setWeightFunc(typename Fit::WFunctor(_scale));
+    fit.init(_pos);
+    fit.compute(_points.cbegin(), _points.cend());
+    return fit;
+}
+
+template<typename Point>
+void testFunction()
+{
+    // many neighbors of a large sphere, for the sums to lose precision in float
+    const int nbPoints = Eigen::internal::random<int>(20000, 50000);
+    const double radius = Eigen::internal::random<double>(1., 10.);
+    const double analysisScale = radius;
+    const Eigen::Vector3d center = Eigen::Vector3d::Random() * Eigen::internal::random<double>(1., 100.);
+
+    vector<Point> points(nbPoints);
+    vector<PointDouble> pointsDouble(nbPoints);
+    for(int i = 0; i < nbPoints; ++i)
+    {
+        const PointDouble p = getPointOnSphere<PointDouble>(radius, center, false, false, false);
+        points[i] = Point(p.pos().cast<float>(), p.normal().cast<float>());
+        // same float samples, in double
+        pointsDouble[i] = PointDouble(points[i].pos().template cast<double>(), points[i].normal().template cast<double>());
+    }
+
+    const int evalId = Eigen::internal::random<int>(0, nbPoints - 1);
+    const Eigen::Vector3f pos = points[evalId].pos();
+    const Eigen::Vector3d posDouble = pointsDouble[evalId].pos();
+
+    // the fits differ by the float rounding of the results
+    const double epsilon = 1e-4;
+
+    {
+        typedef Fits<Point, OrientedSphereFit, GLSParam> F;
+        const auto fit = fitNeighborhood<typename F::Mixed>(points, pos, float(analysisScale));
+        const auto reference = fitNeighborhood<typename F::Reference>(pointsDouble, posDouble, analysisScale);
+        VERIFY(fit.isStable() && reference.isStable());
+        VERIFY(std::abs(fit.kappa() - reference.kappa()) <= epsilon / radius);
+        VERIFY(std::abs(fit.tau() - reference.tau()) <= epsilon * radius);
+        VERIFY((fit.eta().template cast<double>() - reference.eta()).norm() <= epsilon);
+    }
+    {
+        typedef Fits<Point, CovariancePlaneFit> F;
+        const auto fit = fitNeighborhood<typename F::Mixed>(points, pos, float(analysisScale));
+        const auto reference = fitNeighborhood<typename F::Reference>(pointsDouble, posDouble, analysisScale);
+        VERIFY(fit.isStable() && reference.isStable());
+        VERIFY(std::abs(std::abs(fit.primitiveGradient().template cast<double>().dot(reference.primitiveGradient())) - 1.) <= epsilon);
+        VERIFY(std::abs(fit.surfaceVariation() - reference.surfaceVariation()) <= epsilon);
+    }
+    {
+        // the derivatives are computed in float from the sums accumulated in double
+        typedef Fits<Point, OrientedSphereFit, OrientedSphereScaleSpaceDer, MlsSphereFitDer> F;
+        const auto fit = fitNeighborhood<typename F::Mixed>(points, pos, float(analysisScale));
+        const auto reference = fitNeighborhood<typename F::Reference>(pointsDouble, posDouble, analysisScale);
+        VERIFY(fit.isStable() && reference.isStable());
+        VERIFY(std::abs(fit.potential() - reference.potential()) <= epsilon * radius);
+        VERIFY((fit.dPotential().template cast<double>() - reference.dPotential()).norm()
+               <= std::sqrt(epsilon) * (reference.dPotential().norm() + 1.));
+    }
+    {
+        typedef Fits<Point, CovariancePlaneFit, CovariancePlaneScaleSpaceDer> F;
+        const auto fit = fitNeighborhood<typename F::Mixed>(points, pos, float(analysisScale));
+        const auto reference = fitNeighborhood<typename F::Reference>(pointsDouble, posDouble, analysisScale);
+        VERIFY(fit.isStable() && reference.isStable());
+        // the orientation of the planes is arbitrary
+        VERIFY(std::abs(std::abs(fit.potential(pos)) - std::abs(reference.potential(posDouble))) <= epsilon * radius);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test fits of float points accumulated in double, or with compensated sums..." << endl;
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<PointAccumulateDouble>() ));
+        CALL_SUBTEST(( testFunction<PointCompensated>() ));
+    }
+    cout << "Ok..." << endl;
+}
@@ -96,6 +96,61 @@ void testFunction(bool _bUnoriented = false, bool _bAddPositionNoise = false, bo
     }
 }
 
+// Check that the single pass variant gives the same quadric as the two passes MongePatch on a sampled sphere
+template<typename DataPoint, typename Fit, typename FitSinglePass, typename WeightFunc>
+void testSinglePass(bool _bAddPositionNoise = false)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    int nbPoints = Eigen::internal::random<int>(100, 1000);
+    Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    Scalar analysisScale = Scalar(10.) * std::sqrt( Scalar(4. * M_PI) * radius * radius / nbPoints);
+    VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10);
+
+    vector<DataPoint> vectorPoints(nbPoints);
+    for(auto& p : vectorPoints)
+        p = getPointOnSphere<DataPoint>(radius, center, _bAddPositionNoise, false, false);
+
+    // the moments of the single pass are 4th order: relax the threshold by the conditioning of the normal equations
+    Scalar epsilon = std::sqrt(testEpsilon<Scalar>());
+
+    for(int i = 0; i < int(vectorPoints.size()); ++i)
+    {
+        const auto& queryPos = vectorPoints[i].pos();
+
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(analysisScale));
+        fit.init(queryPos);
+        FIT_RESULT res = fit.compute(vectorPoints.cbegin(), vectorPoints.cend());
+
+        FitSinglePass fitSinglePass;
+        fitSinglePass.setWeightFunc(WeightFunc(analysisScale));
+        fitSinglePass.init(queryPos);
+        int passes = 0;
+        FIT_RESULT resSinglePass;
+        do {
+            for(const auto& p : vectorPoints)
+                fitSinglePass.addNeighbor(p);
+            resSinglePass = fitSinglePass.finalize();
+            ++passes;
+        } while(resSinglePass == NEED_OTHER_PASS);
+
+        VERIFY(passes == 1);
+        VERIFY(res == resSinglePass);
+        if(res == STABLE)
+        {
+            const Scalar scale = analysisScale;
+            VERIFY(std::abs(fit.h_uu() - fitSinglePass.h_uu()) * scale <= epsilon);
+            VERIFY(std::abs(fit.h_vv() - fitSinglePass.h_vv()) * scale <= epsilon);
+            VERIFY(std::abs(fit.h_uv() - fitSinglePass.h_uv()) * scale <= epsilon);
+            VERIFY(std::abs(fit.h_u()  - fitSinglePass.h_u())          <= epsilon);
+            VERIFY(std::abs(fit.h_v()  - fitSinglePass.h_v())          <= epsilon);
+            VERIFY(std::abs(fit.h_c()  - fitSinglePass.h_c())  / scale <= epsilon);
+        }
+    }
+}
+
 template<typename Scalar, int Dim>
 void callSubTests()
 {
@@ -106,6 +161,8 @@ void callSubTests()
 
     typedef Basket<Point, WeightSmoothFunc, CovariancePlaneFit, MongePatch> CovFitSmooth;
     typedef Basket<Point, WeightConstantFunc, CovariancePlaneFit, MongePatch> CovFitConstant;
+    typedef Basket<Point, WeightSmoothFunc, CovariancePlaneFit, MongePatchSinglePass> CovFitSmoothSinglePass;
+    typedef Basket<Point, WeightConstantFunc, CovariancePlaneFit, MongePatchSinglePass> CovFitConstantSinglePass;
 
 //    typedef Basket<Point, WeightSmoothFunc, Plane, MeanPlaneFit> MeanFitSmooth;
 //    typedef Basket<Point, WeightConstantFunc, Plane, MeanPlaneFit> MeanFitConstant;
@@ -116,6 +173,8 @@ void callSubTests()
         //Test with perfect plane
         CALL_SUBTEST(( testFunction<Point, CovFitSmooth, WeightSmoothFunc>() ));
         CALL_SUBTEST(( testFunction<Point, CovFitConstant, WeightConstantFunc>() ));
+        CALL_SUBTEST(( testFunction<Point, CovFitSmoothSinglePass, WeightSmoothFunc>() ));
+        CALL_SUBTEST(( testFunction<Point, CovFitConstantSinglePass, WeightConstantFunc>() ));
     }
     cout << "Ok!" << endl;
 
@@ -124,6 +183,17 @@ void callSubTests()
     {
         CALL_SUBTEST(( testFunction<Point, CovFitSmooth, WeightSmoothFunc>(false, true, true) ));
         CALL_SUBTEST(( testFunction<Point, CovFitConstant, WeightConstantFunc>(false, true, true) ));
+        CALL_SUBTEST(( testFunction<Point, CovFitSmoothSinglePass, WeightSmoothFunc>(false, true, true) ));
+        CALL_SUBTEST(( testFunction<Point, CovFitConstantSinglePass, WeightConstantFunc>(false, true, true) ));
+    }
+    cout << "Ok!" << endl;
+
+    cout << "Testing single pass against two passes on a sphere" << endl;
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testSinglePass<Point, CovFitSmooth, CovFitSmoothSinglePass, WeightSmoothFunc>() ));
+        CALL_SUBTEST(( testSinglePass<Point, CovFitConstant, CovFitConstantSinglePass, WeightConstantFunc>() ));
+        CALL_SUBTEST(( testSinglePass<Point, CovFitSmooth, CovFitSmoothSinglePass, WeightSmoothFunc>(true) ));
     }
     cout << "Ok!" << endl;
 }
@@ -0,0 +1,106 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/fit_normal_covariance_curvature.cpp
+    \brief Test that the normal covariance curvatures accumulated by blocks match the ones accumulated per neighbor
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/curvatureEstimation.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename DataPoint, typename Fit>
+void testFunction()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename Fit::WFunctor WeightFunc;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(100, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt( Scalar(4. * M_PI) * radius * radius / nbPoints);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10);
+    const Scalar epsilon = testEpsilon<Scalar>();
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, true, false);
+
+    for(int i = 0; i < nbPoints; i += 10)
+    {
+        const VectorType& pos = points[i].pos();
+
+        Fit reference, fit;
+        reference.setWeightFunc(WeightFunc(analysisScale));
+        reference.init(pos);
+        fit.setWeightFunc(WeightFunc(analysisScale));
+        fit.init(pos);
+
+        // same passes, adding the neighbors one by one or by blocks
+        FIT_RESULT referenceRes, res;
+        do {
+            int referenceCount = 0;
+            for(const auto& p : points)
+                if(reference.addNeighbor(p))
+                    ++referenceCount;
+            VERIFY(fit.addNeighbors(points.cbegin(), points.cend()) == referenceCount);
+
+            referenceRes = reference.finalize();
+            res = fit.finalize();
+            VERIFY(res == referenceRes);
+        } while(res == NEED_OTHER_PASS);
+
+        // the principal directions are not defined on a sphere
+        if(res == STABLE)
+        {
+            VERIFY(std::abs(fit.k1() - reference.k1()) <= epsilon);
+            VERIFY(std::abs(fit.k2() - reference.k2()) <= epsilon);
+        }
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightSmoothFunc;
+
+    typedef Basket<Point, WeightSmoothFunc, CovariancePlaneFit, NormalCovarianceCurvature> NormalCovariance;
+    typedef Basket<Point, WeightSmoothFunc, CovariancePlaneFit, ProjectedNormalCovarianceCurvature> ProjectedNormalCovariance;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Point, NormalCovariance>() ));
+        CALL_SUBTEST(( testFunction<Point, ProjectedNormalCovariance>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test normal covariance curvatures accumulated by blocks..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
@@ -123,6 +123,116 @@ void testFunction(bool _bUnoriented = false, bool _bAddPositionNoise = false, bo
     }
 }
 
+template<typename DataPoint, typename Fit, typename WeightFunc>
+void testSquaredDistances()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    int nbPoints = Eigen::internal::random<int>(100, 1000);
+    Scalar width = Eigen::internal::random<Scalar>(1., 10.);
+    Scalar analysisScale = Scalar(15.) * std::sqrt( width * width / nbPoints);
+    VectorType center    = VectorType::Random() * Eigen::internal::random<Scalar>(1,100);
+    VectorType direction = VectorType::Random().normalized();
+
+    vector<DataPoint> vectorPoints(nbPoints);
+    for(unsigned int i = 0; i < vectorPoints.size(); ++i)
+        vectorPoints[i] = getPointOnPlane<DataPoint>(center, direction, width, true, true, false);
+
+    Scalar epsilon = testEpsilon<Scalar>();
+    for(int i = 0; i < int(vectorPoints.size()); i += 10)
+    {
+        const VectorType& query = vectorPoints[i].pos();
+
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(analysisScale));
+        fit.init(query);
+        FIT_RESULT res = fit.compute(vectorPoints.cbegin(), vectorPoints.cend());
+
+        // the squared distances are the ones a range query centered on the evaluation position computes
+        Fit fitDistances;
+        fitDistances.setWeightFunc(WeightFunc(analysisScale));
+        fitDistances.init(query);
+        for(const auto& p : vectorPoints)
+            fitDistances.addNeighborWithSquaredDistance(p, (p.pos() - query).squaredNorm());
+        FIT_RESULT resDistances = fitDistances.finalize();
+
+        VERIFY(res == resDistances);
+        if(fit.isStable())
+        {
+            // compute may accumulate by blocks: the rounding may flip the orientation of the unoriented plane
+            const Scalar sign = fit.primitiveGradient(query).dot(fitDistances.primitiveGradient(query)) < Scalar(0)
+                              ? Scalar(-1) : Scalar(1);
+            VERIFY(std::abs(sign * fit.potential(query) - fitDistances.potential(query)) <= epsilon);
+            VERIFY((sign * fit.primitiveGradient(query) - fitDistances.primitiveGradient(query)).norm() <= epsilon);
+        }
+    }
+}
+
+template<typename DataPoint, typename Fit, typename WeightFunc>
+void testSolvers(bool _bAddPositionNoise = false)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    int nbPoints = Eigen::internal::random<int>(100, 1000);
+    Scalar width = Eigen::internal::random<Scalar>(1., 10.);
+    Scalar analysisScale = Scalar(15.) * std::sqrt( width * width / nbPoints);
+    VectorType center    = VectorType::Random() * Eigen::internal::random<Scalar>(1,100);
+    VectorType direction = VectorType::Random().normalized();
+
+    vector<DataPoint> vectorPoints(nbPoints);
+    for(unsigned int i = 0; i < vectorPoints.size(); ++i)
+        vectorPoints[i] = getPointOnPlane<DataPoint>(center, direction, width, _bAddPositionNoise, false, false);
+
+    Scalar epsilon = testEpsilon<Scalar>();
+    for(int i = 0; i < int(vectorPoints.size()); i += 10)
+    {
+        const VectorType& query = vectorPoints[i].pos();
+
+        Fit fits[3];
+        const COVARIANCE_SOLVER solvers[3] = {ITERATIVE_SOLVER, DIRECT_SOLVER, SMALLEST_EIGENVECTOR_SOLVER};
+        for(int s = 0; s < 3; ++s)
+        {
+            fits[s].setWeightFunc(WeightFunc(analysisScale));
+            fits[s].setSolver(solvers[s]);
+            fits[s].init(query);
+            VERIFY(fits[s].compute(vectorPoints.cbegin(), vectorPoints.cend()) == STABLE);
+            VERIFY(fits[s].solverType() == solvers[s]);
+        }
+
+        // all the solvers find the same normal and surface variation, the generation direction without noise
+        for(int s = 0; s < 3; ++s)
+        {
+            const VectorType normal = fits[s].primitiveGradient(query);
+            VERIFY(Scalar(1.) - std::abs(normal.dot(fits[0].primitiveGradient(query))) <= epsilon);
+            if(!_bAddPositionNoise)
+                VERIFY(Scalar(1.) - std::abs(normal.dot(direction)) <= epsilon);
+            VERIFY(std::abs(fits[s].surfaceVariation() - fits[0].surfaceVariation()) <= epsilon);
+        }
+    }
+}
+
+template<typename DataPoint, typename Fit, typename WeightFunc>
+void testDegenerateFit()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    // coincident neighbors: the covariance is zero and the inverse iterations fail
+    const int nbPoints = Eigen::internal::random<int>(3, 100);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,100);
+    vector<DataPoint> vectorPoints(nbPoints, DataPoint(center, VectorType::UnitX()));
+
+    Fit fit;
+    fit.setWeightFunc(WeightFunc(Scalar(1.)));
+    fit.setSolver(SMALLEST_EIGENVECTOR_SOLVER);
+    fit.init(center);
+    VERIFY(fit.compute(vectorPoints.cbegin(), vectorPoints.cend()) == UNDEFINED);
+    VERIFY(!fit.isStable());
+    VERIFY(fit.coeffs().isZero());
+}
+
 template<typename Scalar, int Dim>
 void callSubTests()
 {
@@ -155,6 +265,23 @@ void callSubTests()
         CALL_SUBTEST(( testFunction<Point, CovFitConstant, WeightConstantFunc, true>(false, true, true) ));
     }
     cout << "Ok!" << endl;
+
+    cout << "Testing with precomputed squared distances" << endl;
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testSquaredDistances<Point, CovFitSmooth, WeightSmoothFunc>() ));
+        CALL_SUBTEST(( testSquaredDistances<Point, MeanFitSmooth, WeightSmoothFunc>() ));
+    }
+    cout << "Ok!" << endl;
+
+    cout << "Testing the covariance solvers" << endl;
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testSolvers<Point, CovFitSmooth, WeightSmoothFunc>() ));
+        CALL_SUBTEST(( testSolvers<Point, CovFitSmooth, WeightSmoothFunc>(true) ));
+        CALL_SUBTEST(( testDegenerateFit<Point, CovFitSmooth, WeightSmoothFunc>() ));
+    }
+    cout << "Ok!" << endl;
 }
 
 int main(int argc, char** argv)
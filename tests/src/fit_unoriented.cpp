@@ -106,6 +106,56 @@ void testFunction(bool _bAddPositionNoise = false, bool _bAddNormalNoise = false
     }
 }
 
+template<typename DataPoint, typename Fit, typename WeightFunc>
+void testSolvers(bool _bAddPositionNoise = false, bool _bAddNormalNoise = false)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    //generate sampled sphere
+    int nbPoints = Eigen::internal::random<int>(100, 1000);
+    Scalar radius = Eigen::internal::random<Scalar>(Scalar(0.1), Scalar(10.));
+    Scalar analysisScale = Scalar(10.) * std::sqrt(Scalar(4. * M_PI) * radius * radius / nbPoints);
+    VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10);
+    Scalar epsilon = testEpsilon<Scalar>();
+
+    vector<DataPoint> vectorPoints(nbPoints);
+    for(unsigned int i = 0; i < vectorPoints.size(); ++i)
+        vectorPoints[i] = getPointOnSphere<DataPoint>(radius, center, _bAddPositionNoise, _bAddNormalNoise);
+
+    // a single fit per solver, reused from one point to the next: the power iterations start from the previous fit
+    const UNORIENTED_SPHERE_SOLVER solvers[3] = {GENERAL_EIGEN_SOLVER, GENERALIZED_SELFADJOINT_SOLVER,
+                                                 POWER_ITERATION_SOLVER};
+    Fit fits[3];
+    for(int s = 0; s < 3; ++s)
+    {
+        fits[s].setWeightFunc(WeightFunc(analysisScale));
+        fits[s].setSolver(solvers[s]);
+    }
+
+    for(int i = 0; i < int(vectorPoints.size()); ++i)
+    {
+        for(int s = 0; s < 3; ++s)
+        {
+            fits[s].init(vectorPoints[i].pos());
+            fits[s].compute(vectorPoints.cbegin(), vectorPoints.cend());
+            VERIFY(fits[s].solverType() == solvers[s]);
+        }
+
+        if(fits[0].isStable())
+        {
+            for(int s = 1; s < 3; ++s)
+            {
+                VERIFY(fits[s].isStable());
+                VERIFY( Eigen::internal::isMuchSmallerThan(std::abs(std::abs(fits[s].kappa()) - std::abs(fits[0].kappa())), Scalar(1.), epsilon) );
+                VERIFY( Eigen::internal::isMuchSmallerThan(std::abs(std::abs(fits[s].tau()) - std::abs(fits[0].tau())), Scalar(1.), epsilon) );
+                VERIFY( Eigen::internal::isMuchSmallerThan((VectorType(fits[s].eta().normalized().array().abs()) -
+                                                            VectorType(fits[0].eta().normalized().array().abs())).norm(), Scalar(1.), epsilon) );
+            }
+        }
+    }
+}
+
 template<typename Scalar, int Dim>
 void callSubTests()
 {
@@ -133,6 +183,14 @@ void callSubTests()
         CALL_SUBTEST(( testFunction<Point, FitConstantUnoriented, WeightConstantFunc>(true, true) ));
     }
     cout << "Ok!" << endl;
+
+    cout << "Testing the eigenproblem solvers (unoriented)..." << endl;
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testSolvers<Point, FitSmoothUnoriented, WeightSmoothFunc>() ));
+        CALL_SUBTEST(( testSolvers<Point, FitSmoothUnoriented, WeightSmoothFunc>(true, true) ));
+    }
+    cout << "Ok!" << endl;
 }
 
 int main(int argc, char** argv)
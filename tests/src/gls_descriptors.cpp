@@ -0,0 +1,175 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/gls_descriptors.cpp
+    \brief Test the batched GLS descriptors against the fits of each scale, and their nearest descriptor index
+    against brute force
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/glsDescriptors.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTreeDescriptorIndex.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename DataPoint>
+void testDescriptors()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef DistWeightFunc<DataPoint, SmoothWeightKernel<Scalar>> WeightFunc;
+    typedef Basket<DataPoint, WeightFunc, OrientedSphereFit, GLSParam> Fit;
+    constexpr int ScaleCount = 3;
+    constexpr int Size = 3 * ScaleCount;
+
+    // two spheres of different radii, for different descriptors
+    const Scalar radius = Eigen::internal::random<Scalar>(1, 5);
+    vector<DataPoint> points(Eigen::internal::random<int>(500, 1500));
+    for (int i = 0; i < int(points.size()); ++i)
+        points[i] = i % 2 ? getPointOnSphere<DataPoint>(radius, VectorType::Zero(), false, false)
+                          : getPointOnSphere<DataPoint>(Scalar(2) * radius, VectorType::Constant(Scalar(8) * radius), false, false);
+    const KdTree<DataPoint> tree(points);
+    const vector<Scalar> scales {radius * Scalar(0.3), radius * Scalar(0.5), radius * Scalar(0.8)};
+    VERIFY(glsDescriptorSize(ScaleCount) == Size);
+    VERIFY(glsDescriptorSize(ScaleCount, false) == 2 * ScaleCount);
+
+    const int n = int(points.size());
+    vector<float> descriptors(std::size_t(n) * Size, -1.f);
+    vector<FIT_RESULT> states(std::size_t(n) * ScaleCount);
+    computeGlsDescriptors<Fit>(tree, scales, descriptors.data(), true, states.data());
+
+    // the fits of each scale
+    const Scalar epsilon = testEpsilon<Scalar>();
+    vector<vector<Fit>> fits(n, vector<Fit>(ScaleCount));
+    vector<bool> stable(n, true);
+    for (int i = 0; i < n; ++i)
+        for (int s = 0; s < ScaleCount; ++s)
+        {
+            Fit& fit = fits[i][s];
+            fit.setWeightFunc(WeightFunc(scales[s]));
+            fit.init(points[i].pos());
+            vector<DataPoint> neighbors;
+            for (int j : tree.range_neighbors(points[i].pos(), scales[s]))
+                neighbors.push_back(points[j]);
+            const FIT_RESULT res = fit.compute(neighbors.cbegin(), neighbors.cend());
+            VERIFY(states[i * ScaleCount + s] == res);
+            // the fits of a few neighbors are sensitive to their order
+            stable[i] = stable[i] && res == STABLE && neighbors.size() >= 10;
+            const float* values = &descriptors[std::size_t(i) * Size + 3 * s];
+            if (res == UNDEFINED)
+                VERIFY(values[0] == 0.f && values[1] == 0.f && values[2] == 0.f);
+            else if (stable[i])
+            {
+                VERIFY(std::abs(values[0] - fit.tau_normalized()) <= epsilon);
+                VERIFY(std::abs(values[1] - fit.kappa_normalized()) <= epsilon);
+                VERIFY(std::abs(values[2] - fit.fitness()) <= epsilon);
+            }
+        }
+
+    // the distances between descriptors are the sums of compareTo
+    for (int q = 0; q < 50; ++q)
+    {
+        const int a = Eigen::internal::random<int>(0, n - 1), b = Eigen::internal::random<int>(0, n - 1);
+        if (!stable[a] || !stable[b])
+            continue;
+        Scalar expected = 0;
+        for (int s = 0; s < ScaleCount; ++s)
+            expected += fits[a][s].compareTo(fits[b][s]);
+        Scalar distance = 0;
+        for (int k = 0; k < Size; ++k)
+        {
+            const Scalar diff = Scalar(descriptors[std::size_t(a) * Size + k]) - Scalar(descriptors[std::size_t(b) * Size + k]);
+            distance += diff * diff;
+        }
+        VERIFY(std::abs(distance - expected) <= epsilon * (Scalar(1) + expected));
+    }
+
+    // nearest descriptors, against brute force, among the descriptors of the stable points
+    vector<int> sampling;
+    for (int i = 0; i < n; ++i)
+        if (stable[i])
+            sampling.push_back(i);
+    const KdTreeDescriptorIndex<Size> index(descriptors.data(), n, sampling);
+    VERIFY(index.descriptor_count() == int(sampling.size()));
+
+    const int queryCount = 50;
+    vector<float> queries(std::size_t(queryCount) * Size);
+    for (int q = 0; q < queryCount; ++q)
+    {
+        const int i = Eigen::internal::random<int>(0, n - 1);
+        for (int k = 0; k < Size; ++k)
+            queries[std::size_t(q) * Size + k] = descriptors[std::size_t(i) * Size + k] + Eigen::internal::random<float>(-0.01f, 0.01f);
+    }
+    vector<int> nearest(queryCount);
+    vector<float> distances(queryCount);
+    index.nearest_batch(queries.data(), queryCount, nearest.data(), distances.data());
+
+    const int k = 5;
+    vector<IndexSquaredDistance<float>> neighbors;
+    for (int q = 0; q < queryCount; ++q)
+    {
+        const float* query = &queries[std::size_t(q) * Size];
+        vector<float> bruteForce;
+        for (int i : sampling)
+        {
+            float d = 0.f;
+            for (int c = 0; c < Size; ++c)
+                d += (descriptors[std::size_t(i) * Size + c] - query[c]) * (descriptors[std::size_t(i) * Size + c] - query[c]);
+            bruteForce.push_back(d);
+        }
+        std::sort(bruteForce.begin(), bruteForce.end());
+        if (bruteForce.empty())
+            continue;
+
+        float distance;
+        const int match = index.nearest(query, &distance);
+        VERIFY(match >= 0 && stable[match]);
+        VERIFY(match == nearest[q] && distance == distances[q]);
+        VERIFY(std::abs(distance - bruteForce[0]) <= 1e-5f * (1.f + bruteForce[0]));
+
+        index.k_nearest(query, k, neighbors);
+        VERIFY(int(neighbors.size()) == std::min(k, int(bruteForce.size())));
+        for (int j = 0; j < int(neighbors.size()); ++j)
+            VERIFY(std::abs(neighbors[j].squared_distance - bruteForce[j]) <= 1e-5f * (1.f + bruteForce[j]));
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testDescriptors<Point>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the batched GLS descriptors and their index..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
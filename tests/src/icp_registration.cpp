@@ -0,0 +1,173 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/icp_registration.cpp
+    \brief Test the point-to-point and point-to-plane ICP registration on a KdTree
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTreeRegistration.h>
+
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+using namespace Ponca;
+
+// Height field without symmetry, with its normals
+template<typename DataPoint>
+vector<DataPoint> wavySurface(int n)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    vector<DataPoint> points;
+    for (int i = 0; i < n; ++i)
+    {
+        const Scalar x = Eigen::internal::random<Scalar>(-1, 1), y = Eigen::internal::random<Scalar>(-1, 1);
+        const Scalar z = Scalar(0.3) * std::sin(3 * x) * std::cos(2 * y) + Scalar(0.2) * x * x;
+        const VectorType gradient(Scalar(0.9) * std::cos(3 * x) * std::cos(2 * y) + Scalar(0.4) * x,
+                                  Scalar(-0.6) * std::sin(3 * x) * std::sin(2 * y), Scalar(0));
+        points.push_back(DataPoint(VectorType(x, y, z), (VectorType::UnitZ() - gradient).normalized()));
+    }
+    return points;
+}
+
+template<typename Scalar>
+Eigen::Transform<Scalar, 3, Eigen::Isometry> randomMotion(Scalar maxAngle, Scalar maxTranslation)
+{
+    typedef Eigen::Matrix<Scalar, 3, 1> Vector;
+    Eigen::Transform<Scalar, 3, Eigen::Isometry> motion = Eigen::Transform<Scalar, 3, Eigen::Isometry>::Identity();
+    motion.linear() = Eigen::AngleAxis<Scalar>(Eigen::internal::random<Scalar>(-maxAngle, maxAngle),
+                                               Vector::Random().normalized()).toRotationMatrix();
+    motion.translation() = Vector::Random() * maxTranslation;
+    return motion;
+}
+
+template<typename DataPoint>
+void testRegistration(ICP_METRIC metric)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef IcpRegistration<DataPoint> Icp;
+    typedef typename Icp::Transform Transform;
+
+    const vector<DataPoint> points = wavySurface<DataPoint>(20000);
+    KdTree<DataPoint> target(points);
+    vector<VectorType> normals;
+    for (const DataPoint& p : points)
+        normals.push_back(p.normal());
+    Icp icp(target, normals);
+
+    // the source is a subset of the target points, moved away from it
+    const Transform motion = randomMotion(Scalar(0.1), Scalar(0.05));
+    vector<VectorType> source;
+    for (int i = 0; i < int(points.size()); i += 4)
+        source.push_back(motion * VectorType(points[i].pos()));
+
+    IcpParameters<Scalar> parameters;
+    parameters.metric = metric;
+    parameters.max_iterations = 100;
+    parameters.convergence = Scalar(1e-5);
+    const IcpResult<Scalar> result = icp.align(source, Transform::Identity(), parameters);
+
+    const Transform error = result.transform * motion;
+    const Scalar tolerance = std::is_same<Scalar, float>::value ? Scalar(1e-3) : Scalar(1e-5);
+    VERIFY(result.converged);
+    VERIFY(result.correspondences == int(source.size()));
+    VERIFY(Eigen::AngleAxis<Scalar>(error.linear()).angle() < tolerance);
+    VERIFY(error.translation().norm() < tolerance);
+    VERIFY(result.rms < tolerance);
+
+    // the same frame again, starting from the solution, stays there
+    const IcpResult<Scalar> again = icp.align(source, result.transform, parameters);
+    const Transform drift = again.transform * result.transform.inverse();
+    VERIFY(again.converged);
+    VERIFY(Eigen::AngleAxis<Scalar>(drift.linear()).angle() < tolerance);
+    VERIFY(drift.translation().norm() < tolerance);
+
+#ifdef _OPENMP
+    // the reduction does not depend on the number of threads
+    const int threads = omp_get_max_threads();
+    omp_set_num_threads(3);
+    const IcpResult<Scalar> other = icp.align(source, Transform::Identity(), parameters);
+    omp_set_num_threads(threads);
+    VERIFY(other.iterations == result.iterations);
+    VERIFY(other.transform.matrix() == result.transform.matrix());
+#endif
+}
+
+template<typename DataPoint>
+void testRejection()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef IcpRegistration<DataPoint> Icp;
+    typedef typename Icp::Transform Transform;
+
+    const vector<DataPoint> points = wavySurface<DataPoint>(20000);
+    KdTree<DataPoint> target(points);
+    Icp icp(target);
+
+    // far away outliers pull the unbounded point-to-point estimate
+    const Transform motion = randomMotion(Scalar(0.05), Scalar(0.02));
+    vector<VectorType> source;
+    for (int i = 0; i < int(points.size()); i += 4)
+        source.push_back(motion * VectorType(points[i].pos()));
+    const int inliers = int(source.size());
+    for (int i = 0; i < 200; ++i)
+        source.push_back(VectorType::Random() + VectorType::Constant(3));
+
+    IcpParameters<Scalar> parameters;
+    parameters.metric = ICP_POINT_TO_POINT;
+    parameters.max_iterations = 100;
+    parameters.max_distance = Scalar(0.2);
+    const IcpResult<Scalar> result = icp.align(source, Transform::Identity(), parameters);
+    const Transform error = result.transform * motion;
+    VERIFY(result.correspondences == inliers);
+    VERIFY(Eigen::AngleAxis<Scalar>(error.linear()).angle() < Scalar(1e-3));
+    VERIFY(error.translation().norm() < Scalar(1e-3));
+
+    // the point-to-plane metric requires the target normals
+    parameters.metric = ICP_POINT_TO_PLANE;
+    bool thrown = false;
+    try { icp.align(source, Transform::Identity(), parameters); }
+    catch (const std::invalid_argument&) { thrown = true; }
+    VERIFY(thrown);
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testRegistration<Point>(ICP_POINT_TO_POINT) ));
+        CALL_SUBTEST(( testRegistration<Point>(ICP_POINT_TO_PLANE) ));
+        CALL_SUBTEST(( testRejection<Point>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the ICP registration..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
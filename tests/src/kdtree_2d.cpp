@@ -0,0 +1,190 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/kdtree_2d.cpp
+    \brief Test the KdTree queries and the fits on 2D points (image space and depth map samples)
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <vector>
+
+using namespace Ponca;
+
+// the 2D trees use the compact nodes: the split dimension fits in their 2 bits
+static_assert(KdTreeNode<float>::MAX_DIM >= 2, "");
+static_assert(sizeof(KdTreeNode<float>) == 8, "");
+
+/// Pixel centers of a `width` x `width` image in [-1,1]^2, jittered as the samples of a depth map
+template<typename DataPoint>
+std::vector<DataPoint> pixels(int width, typename DataPoint::Scalar jitter)
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    std::vector<DataPoint> points;
+    points.reserve(width * width);
+    const Scalar step = Scalar(2) / Scalar(width);
+    for (int y = 0; y < width; ++y)
+        for (int x = 0; x < width; ++x)
+            points.push_back(DataPoint(VectorType(-1 + (x + Scalar(0.5)) * step, -1 + (y + Scalar(0.5)) * step) +
+                                       jitter * step * VectorType::Random()));
+    return points;
+}
+
+template<typename DataPoint>
+void testQueries(const std::vector<DataPoint>& points, KDTREE_SPLIT_STRATEGY strategy, bool leafPositions, bool quantized)
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    KdTree<DataPoint> tree;
+    tree.set_split_strategy(strategy);
+    tree.set_use_leaf_positions(leafPositions);
+    tree.set_use_quantized_positions(quantized);
+    tree.build(points);
+    VERIFY(tree.valid() && tree.point_count() == int(points.size()));
+
+    const int n = int(points.size());
+    const int k = Eigen::internal::random<int>(1, 20);
+    const Scalar r = Eigen::internal::random<Scalar>(0.02, 0.2);
+    for (int q = 0; q < 50; ++q)
+    {
+        const VectorType p = VectorType::Random();
+        const int i = Eigen::internal::random<int>(0, n - 1);
+
+        VERIFY((check_nearest_neighbor<Scalar, VectorType>(points, p, *tree.nearest_neighbor(p).begin())));
+        VERIFY((check_nearest_neighbor<Scalar>(points, i, *tree.nearest_neighbor(i).begin())));
+
+        std::vector<int> neighbors;
+        for (int j : tree.k_nearest_neighbors(p, k))
+            neighbors.push_back(j);
+        VERIFY((check_k_nearest_neighbors<Scalar, VectorType>(points, p, k, neighbors)));
+        neighbors.clear();
+        for (int j : tree.k_nearest_neighbors(i, k))
+            neighbors.push_back(j);
+        VERIFY((check_k_nearest_neighbors<Scalar>(points, i, k, neighbors)));
+
+        // range queries against brute force
+        std::vector<int> expected;
+        for (int j = 0; j < n; ++j)
+            if ((points[j].pos() - p).squaredNorm() <= r * r)
+                expected.push_back(j);
+        neighbors.clear();
+        for (int j : tree.range_neighbors(p, r))
+            neighbors.push_back(j);
+        std::sort(neighbors.begin(), neighbors.end());
+        VERIFY(neighbors == expected);
+
+        const typename KdTree<DataPoint>::Aabb box(p, p + VectorType::Constant(r));
+        expected.clear();
+        for (int j = 0; j < n; ++j)
+            if (box.contains(points[j].pos()))
+                expected.push_back(j);
+        neighbors.clear();
+        for (int j : tree.box_neighbors(box))
+            neighbors.push_back(j);
+        std::sort(neighbors.begin(), neighbors.end());
+        VERIFY(neighbors == expected);
+    }
+}
+
+/// 2D fits on the neighborhoods collected by the tree: lines and circles
+template<typename DataPoint>
+void testFits()
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using WeightFunc = DistWeightFunc<DataPoint, SmoothWeightKernel<Scalar>>;
+    using LineFit = Basket<DataPoint, WeightFunc, CovariancePlaneFit>;
+    using CircleFit = Basket<DataPoint, WeightFunc, OrientedSphereFit>;
+
+    const Scalar epsilon = testEpsilon<Scalar>();
+    const int n = 2000;
+    const Scalar radius = Eigen::internal::random<Scalar>(1, 10);
+    const VectorType center = VectorType::Random();
+    const VectorType direction = VectorType::Random().normalized();
+    std::vector<DataPoint> circle(n), line(n);
+    for (int i = 0; i < n; ++i)
+    {
+        const Scalar angle = Scalar(2 * M_PI) * Scalar(i) / Scalar(n);
+        const VectorType normal(std::cos(angle), std::sin(angle));
+        circle[i] = DataPoint(center + radius * normal, normal);
+        line[i] = DataPoint(center + Eigen::internal::random<Scalar>(-1, 1) * direction,
+                            VectorType(-direction.y(), direction.x()));
+    }
+    const KdTree<DataPoint> circleTree(circle), lineTree(line);
+
+    const Scalar scale = radius * Scalar(0.2);
+    for (int q = 0; q < 20; ++q)
+    {
+        const int i = Eigen::internal::random<int>(0, n - 1);
+
+        CircleFit circleFit;
+        circleFit.setWeightFunc(WeightFunc(scale));
+        circleFit.init(circle[i].pos());
+        for (int j : circleTree.range_neighbors(circle[i].pos(), scale))
+            circleFit.addNeighbor(circle[j]);
+        VERIFY(circleFit.finalize() == STABLE);
+        VERIFY(std::abs(std::abs(circleFit.radius()) - radius) <= radius * Scalar(0.01));
+        VERIFY(std::abs(circleFit.potential(circle[i].pos())) <= radius * Scalar(0.01));
+
+        LineFit lineFit;
+        lineFit.setWeightFunc(WeightFunc(Scalar(0.5)));
+        lineFit.init(line[i].pos());
+        for (int j : lineTree.k_nearest_neighbors(i, 32))
+            lineFit.addNeighbor(line[j]);
+        VERIFY(lineFit.finalize() == STABLE);
+        VERIFY(Scalar(1) - std::abs(lineFit.primitiveGradient(line[i].pos()).normalized().dot(line[i].normal())) <= epsilon);
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    using Point = PointPosition<Scalar, 2>;
+    using OrientedPoint = PointPositionNormal<Scalar, 2>;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        std::vector<Point> uniform(Eigen::internal::random<int>(500, 5000));
+        std::generate(uniform.begin(), uniform.end(), []() { return Point(Point::VectorType::Random()); });
+        const std::vector<Point> grid = pixels<Point>(Eigen::internal::random<int>(20, 70), Scalar(0.25));
+
+        const std::vector<const std::vector<Point>*> clouds {&uniform, &grid};
+        for (const std::vector<Point>* points : clouds)
+        {
+            CALL_SUBTEST(( testQueries<Point>(*points, SPLIT_MIDPOINT, false, false) ));
+            CALL_SUBTEST(( testQueries<Point>(*points, SPLIT_MIDPOINT, true, false) ));
+            CALL_SUBTEST(( testQueries<Point>(*points, SPLIT_MORTON, true, false) ));
+            CALL_SUBTEST(( testQueries<Point>(*points, SPLIT_SAH, false, true) ));
+        }
+        CALL_SUBTEST(( testFits<OrientedPoint>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Test the KdTree and the fits in 2D..." << std::endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    std::cout << "Ok..." << std::endl;
+}
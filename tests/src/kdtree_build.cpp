@@ -0,0 +1,902 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <cstring>
+#include <sstream>
+
+using namespace Ponca;
+
+template<typename NodeA, typename NodeB>
+bool check_same_node(const NodeA& a, const NodeB& b)
+{
+    if (a.leaf != b.leaf)
+        return false;
+    if (a.leaf)
+        return a.start == b.start && a.size == b.size;
+    return a.dim == b.dim && a.splitValue == b.splitValue && a.firstChildId == b.firstChildId;
+}
+
+template<typename DataPoint, typename NodeA, typename NodeB>
+bool check_same_tree(const KdTree<DataPoint, NodeA>& a, const KdTree<DataPoint, NodeB>& b)
+{
+    if (a.node_count() != b.node_count() || a.index_data() != b.index_data())
+        return false;
+    for (int n = 0; n < a.node_count(); ++n)
+    {
+        if (!check_same_node(a.node_data()[n], b.node_data()[n]))
+            return false;
+    }
+    return true;
+}
+
+template<typename DataPoint>
+void testKdTreeParallelBuild(bool quick = true)
+{
+    using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int N = quick ? 10000 : 100000;
+    auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+    std::vector<int> indices(N);
+    std::vector<int> sampling(N / 2);
+    std::iota(indices.begin(), indices.end(), 0);
+    std::sample(indices.begin(), indices.end(), sampling.begin(), N / 2, std::mt19937(0));
+
+    KdTree<DataPoint> serial;
+    serial.build(points);
+
+    KdTree<DataPoint> parallel;
+    parallel.set_parallel_build(true);
+    parallel.build(points);
+    VERIFY(check_same_tree(serial, parallel));
+
+    serial.rebuild(sampling);
+    parallel.rebuild(sampling);
+    VERIFY(check_same_tree(serial, parallel));
+}
+
+template<typename DataPoint>
+void testKdTreeSplitStrategy(KDTREE_SPLIT_STRATEGY strategy, bool quick = true)
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int N = quick ? 300 : 2000;
+    const int k = 10;
+
+    // clustered point cloud with uneven density
+    auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []()
+    {
+        Scalar spread = Eigen::internal::random<Scalar>(0, 1) < Scalar(0.8) ? Scalar(0.01) : Scalar(1);
+        return DataPoint(VectorType::Random() * spread);
+    });
+
+    KdTree<DataPoint> structure;
+    structure.set_split_strategy(strategy);
+    structure.set_min_cell_size(8);
+    structure.build(points);
+    VERIFY(structure.split_strategy() == strategy);
+    VERIFY(structure.valid());
+
+    std::vector<int> sampling(N);
+    std::iota(sampling.begin(), sampling.end(), 0);
+
+#pragma omp parallel for
+    for (int i = 0; i < N; ++i)
+    {
+        std::vector<int> results;
+        for (int j : structure.k_nearest_neighbors(i, k))
+            results.push_back(j);
+        VERIFY((check_k_nearest_neighbors<Scalar, VectorContainer>(points, i, k, results)));
+
+        Scalar r = Eigen::internal::random<Scalar>(0., 0.01);
+        results.clear();
+        for (int j : structure.range_neighbors(i, r))
+            results.push_back(j);
+        VERIFY((check_range_neighbors<Scalar, VectorContainer>(points, sampling, i, r, results)));
+    }
+}
+
+template<typename DataPoint>
+void testKdTreeSplitStrategies(bool quick = true)
+{
+    testKdTreeSplitStrategy<DataPoint>(SPLIT_MIDPOINT, quick);
+    testKdTreeSplitStrategy<DataPoint>(SPLIT_MEDIAN, quick);
+    testKdTreeSplitStrategy<DataPoint>(SPLIT_SLIDING_MIDPOINT, quick);
+    testKdTreeSplitStrategy<DataPoint>(SPLIT_SAH, quick);
+    testKdTreeSplitStrategy<DataPoint>(SPLIT_MORTON, quick);
+}
+
+template<typename DataPoint>
+void testKdTreeClusteredBuild(KDTREE_SPLIT_STRATEGY strategy, bool quick = true)
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int N = quick ? 10000 : 100000;
+    const int k = 10;
+
+    // a tiny cluster and a single far point: the splits must follow the cluster, not the root box
+    auto points = VectorContainer(N + 1);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random() * Scalar(1e-6)); });
+    points[N] = DataPoint(VectorType::Ones());
+
+    KdTree<DataPoint> structure;
+    structure.set_split_strategy(strategy);
+    structure.build(points);
+    VERIFY(structure.valid());
+
+    const KdTreeStatistics stats = structure.statistics();
+    VERIFY(stats.max_depth < PCA_KDTREE_MAX_DEPTH);
+    VERIFY(stats.max_leaf_size <= structure.min_cell_size());
+
+    std::vector<int> sampling(N + 1);
+    std::iota(sampling.begin(), sampling.end(), 0);
+
+#pragma omp parallel for
+    for (int i = 0; i < N + 1; i += 997)
+    {
+        std::vector<int> results;
+        for (int j : structure.k_nearest_neighbors(i, k))
+            results.push_back(j);
+        VERIFY((check_k_nearest_neighbors<Scalar, VectorContainer>(points, i, k, results)));
+
+        Scalar r = Eigen::internal::random<Scalar>(0., 1e-7);
+        results.clear();
+        for (int j : structure.range_neighbors(i, r))
+            results.push_back(j);
+        VERIFY((check_range_neighbors<Scalar, VectorContainer>(points, sampling, i, r, results)));
+    }
+}
+
+template<typename DataPoint>
+void testKdTreeClusteredBuilds(bool quick = true)
+{
+    testKdTreeClusteredBuild<DataPoint>(SPLIT_MIDPOINT, quick);
+    testKdTreeClusteredBuild<DataPoint>(SPLIT_MEDIAN, quick);
+    testKdTreeClusteredBuild<DataPoint>(SPLIT_SLIDING_MIDPOINT, quick);
+    testKdTreeClusteredBuild<DataPoint>(SPLIT_SAH, quick);
+    testKdTreeClusteredBuild<DataPoint>(SPLIT_MORTON, quick);
+}
+
+template<typename DataPoint>
+void testKdTreeBounds(bool tight, bool quick = true)
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+    using VectorType = typename DataPoint::VectorType;
+    using Aabb = typename KdTree<DataPoint>::Aabb;
+
+    const int N = quick ? 500 : 5000;
+    const int k = 10;
+    auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+    KdTree<DataPoint> tree;
+    tree.set_tight_bounds(tight);
+    tree.build(points);
+    const KdTree<DataPoint>& structure = tree;
+    VERIFY(int(structure.node_bounds().size()) == structure.node_count());
+
+    // each node bounds its points, and leaves are exactly fitted in tight mode
+    std::vector<std::pair<int,int>> ranges(structure.node_count());
+    ranges[0] = {0, structure.index_count()};
+    for (int n = 0; n < structure.node_count(); ++n)
+    {
+        const auto& node = structure.node_data()[n];
+        const Aabb& bounds = structure.node_bounds()[n];
+        if (node.leaf)
+        {
+            Aabb aabb;
+            for (int i = node.start; i < int(node.start + node.size); ++i)
+            {
+                VERIFY(bounds.contains(points[structure.index_data()[i]].pos()));
+                aabb.extend(points[structure.index_data()[i]].pos());
+            }
+            VERIFY(!tight || node.size == 0 || aabb.isApprox(bounds));
+            VERIFY(!tight || node.size != 0 || bounds.isEmpty());
+        }
+        else
+        {
+            VERIFY(bounds.contains(structure.node_bounds()[node.firstChildId]));
+            VERIFY(bounds.contains(structure.node_bounds()[node.firstChildId+1]));
+        }
+    }
+
+#pragma omp parallel for
+    for (int i = 0; i < N; ++i)
+    {
+        VectorType point = VectorType::Random();
+        std::vector<int> results;
+        for (int j : structure.k_nearest_neighbors(point, k))
+            results.push_back(j);
+        VERIFY((check_k_nearest_neighbors<Scalar, VectorType, VectorContainer>(points, point, k, results)));
+    }
+}
+
+template<typename DataPoint>
+void testKdTreeLeafPositions(bool quick = true)
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int N = quick ? 500 : 5000;
+    const int k = 10;
+    auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+    // build on a subsample, so that the leaf order copy differs from the user ids
+    std::vector<int> sampling;
+    for (int i = 0; i < N; i += 2)
+        sampling.push_back(i);
+
+    KdTree<DataPoint> structure;
+    structure.set_use_leaf_positions(true);
+    structure.build(points, sampling);
+    VERIFY(structure.leaf_positions().rows() == structure.index_count());
+    for (int i = 0; i < structure.index_count(); ++i)
+        VERIFY(structure.leaf_positions().row(i).transpose() == points[structure.index_data()[i]].pos());
+
+    // chunked distances, including partial chunks
+    const VectorType query = VectorType::Random();
+    for (int count = 1; count <= PCA_KDTREE_LEAF_CHUNK_SIZE; ++count)
+    {
+        Scalar distances[PCA_KDTREE_LEAF_CHUNK_SIZE];
+        structure.leaf_squared_distances(count, count, query, distances);
+        for (int j = 0; j < count; ++j)
+            VERIFY(Eigen::internal::isApprox(distances[j], structure.leaf_squared_distance(count+j, query)));
+    }
+
+#pragma omp parallel for
+    for (int i = 0; i < N; ++i)
+    {
+        VectorType point = VectorType::Random();
+        std::vector<int> results;
+        for (int j : structure.k_nearest_neighbors(point, k))
+            results.push_back(j);
+        VERIFY((check_k_nearest_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, point, k, results)));
+
+        Scalar r = Eigen::internal::random<Scalar>(0., 0.2);
+        results.clear();
+        for (int j : structure.range_neighbors(point, r))
+            results.push_back(j);
+        VERIFY((check_range_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, point, r, results)));
+    }
+
+    structure.set_use_leaf_positions(false);
+    structure.rebuild(sampling);
+    VERIFY(structure.leaf_positions().rows() == 0);
+}
+
+template<typename DataPoint>
+void testKdTreeQuantizedPositions(const typename DataPoint::VectorType& offset, typename DataPoint::Scalar scale,
+                                  bool quick = true)
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int N = quick ? 500 : 5000;
+    const int k = 10;
+    auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), [&]() {return DataPoint(offset + scale * VectorType::Random()); });
+
+    std::vector<int> sampling;
+    for (int i = 0; i < N; i += 2)
+        sampling.push_back(i);
+
+    KdTree<DataPoint> structure;
+    structure.set_use_quantized_positions(true);
+    structure.build(points, sampling);
+    VERIFY(structure.valid());
+    VERIFY(structure.quantized_positions().rows() == structure.index_count());
+    VERIFY(structure.leaf_positions().rows() == 0);
+
+    // the quantized bounds never exceed the exact distances
+    for (int q = 0; q < 10; ++q)
+    {
+        const VectorType query = offset + scale * VectorType::Random();
+        for (int i = 0; i < structure.index_count(); ++i)
+            VERIFY(structure.quantized_squared_distance_bound(i, query) <= structure.leaf_squared_distance(i, query));
+        // the points themselves
+        const VectorType& p = points[structure.index_data()[q]].pos();
+        VERIFY(structure.quantized_squared_distance_bound(q, p) == Scalar(0));
+    }
+
+#pragma omp parallel for
+    for (int i = 0; i < N; ++i)
+    {
+        const VectorType point = offset + scale * VectorType::Random();
+        std::vector<int> results;
+        for (int j : structure.k_nearest_neighbors(point, k))
+            results.push_back(j);
+        VERIFY((check_k_nearest_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, point, k, results)));
+
+        const Scalar r = scale * Eigen::internal::random<Scalar>(0., 0.2);
+        results.clear();
+        for (int j : structure.range_neighbors(point, r))
+            results.push_back(j);
+        VERIFY((check_range_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, point, r, results)));
+
+        Scalar nearest = std::numeric_limits<Scalar>::max();
+        for (int j : sampling)
+            nearest = std::min(nearest, (points[j].pos() - point).squaredNorm());
+        for (int j : structure.nearest_neighbor(point))
+            VERIFY((points[j].pos() - point).squaredNorm() == nearest);
+    }
+
+    structure.set_use_quantized_positions(false);
+    structure.rebuild(sampling);
+    VERIFY(structure.quantized_positions().rows() == 0);
+}
+
+template<typename DataPoint>
+void testKdTreeView(bool quick = true)
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int N = quick ? 500 : 5000;
+    const int k = 10;
+    auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+    std::vector<int> sampling;
+    for (int i = 0; i < N; i += 3)
+        sampling.push_back(i);
+
+    // the view must generate the same tree than the owning build, without copying the points
+    KdTree<DataPoint> owning(points, sampling);
+    KdTree<DataPoint> view;
+    view.build_view(points.data(), N, sampling);
+    VERIFY(view.is_view() && !owning.is_view());
+    VERIFY(static_cast<const KdTree<DataPoint>&>(view).point_data().empty());
+    VERIFY(view.point_buffer() == points.data());
+    VERIFY(view.point_count() == N);
+    VERIFY(check_same_tree(owning, view));
+    VERIFY(view.memory_usage().points == 0 && view.memory_usage().viewed == N * sizeof(DataPoint));
+
+#pragma omp parallel for
+    for (int i = 0; i < N; ++i)
+    {
+        VectorType point = VectorType::Random();
+        std::vector<int> results;
+        for (int j : view.k_nearest_neighbors(point, k))
+            results.push_back(j);
+        VERIFY((check_k_nearest_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, point, k, results)));
+
+        Scalar r = Eigen::internal::random<Scalar>(0., 0.2);
+        results.clear();
+        for (int j : view.range_neighbors(sampling[i % sampling.size()], r))
+            results.push_back(j);
+        VERIFY((check_range_neighbors<Scalar, VectorContainer>(points, sampling, sampling[i % sampling.size()], r, results)));
+    }
+
+    view.build_view(points.data(), N);
+    owning.build(points);
+    VERIFY(check_same_tree(owning, view));
+
+    view.clear();
+    VERIFY(!view.is_view() && view.point_count() == 0);
+}
+
+template<typename DataPoint>
+void testKdTreeSerialization(bool withPoints, bool quick = true)
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int N = quick ? 500 : 5000;
+    const int k = 10;
+    auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+    KdTree<DataPoint> structure;
+    structure.set_min_cell_size(16);
+    structure.build(points);
+
+    std::stringstream stream;
+    VERIFY(structure.save(stream, withPoints));
+    const std::string file = stream.str();
+
+    // owning copy
+    KdTree<DataPoint> loaded;
+    VERIFY(loaded.load(stream, withPoints ? nullptr : points.data(), withPoints ? 0 : N));
+    VERIFY(!loaded.is_mapped() && loaded.is_view() == !withPoints);
+    VERIFY(loaded.min_cell_size() == 16);
+    VERIFY(check_same_tree(structure, loaded));
+
+    // read-only tree using the file memory, aligned as a memory mapped file
+    std::vector<char, Eigen::aligned_allocator<char>> buffer(file.size() + KdTreeFileHeader::Alignment);
+    char* data = buffer.data() + (KdTreeFileHeader::Alignment - reinterpret_cast<std::uintptr_t>(buffer.data()) % KdTreeFileHeader::Alignment) % KdTreeFileHeader::Alignment;
+    std::copy(file.begin(), file.end(), data);
+
+    KdTree<DataPoint> mapped;
+    VERIFY(mapped.load_view(data, file.size(), withPoints ? nullptr : points.data(), withPoints ? 0 : N));
+    VERIFY(loaded.valid() && mapped.valid());
+    VERIFY(mapped.is_mapped() && mapped.node_count() == structure.node_count() && mapped.index_count() == structure.index_count());
+    VERIFY(std::equal(structure.index_data().begin(), structure.index_data().end(), mapped.index_buffer()));
+    VERIFY(withPoints == (mapped.point_buffer() != points.data()));
+
+#pragma omp parallel for
+    for (int i = 0; i < N; ++i)
+    {
+        VectorType point = VectorType::Random();
+        std::vector<int> results;
+        for (int j : mapped.k_nearest_neighbors(point, k))
+            results.push_back(j);
+        VERIFY((check_k_nearest_neighbors<Scalar, VectorType, VectorContainer>(points, point, k, results)));
+
+        results.clear();
+        for (int j : loaded.k_nearest_neighbors(i, k))
+            results.push_back(j);
+        VERIFY((check_k_nearest_neighbors<Scalar, VectorContainer>(points, i, k, results)));
+    }
+
+    // invalid files are rejected
+    VERIFY(!mapped.load_view(data, file.size() - 1, withPoints ? nullptr : points.data(), withPoints ? 0 : N));
+    VERIFY(withPoints == mapped.load_view(data, file.size()));
+    data[0] = 'X';
+    VERIFY(!mapped.load_view(data, file.size(), points.data(), N));
+    VERIFY(mapped.node_count() == 0 && !mapped.is_mapped());
+    std::stringstream truncated(file.substr(0, file.size() / 2));
+    VERIFY(!loaded.load(truncated, points.data(), N));
+    VERIFY(loaded.node_count() == 0);
+
+    // trees deeper than the traversal stacks of the reader are rejected
+    KdTreeFileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    VERIFY(int(header.depth) == structure.statistics().max_depth);
+    header.depth = PCA_KDTREE_MAX_DEPTH + 1;
+    std::copy(file.begin(), file.end(), data);
+    std::memcpy(data, &header, sizeof(header));
+    VERIFY(!mapped.load_view(data, file.size(), withPoints ? nullptr : points.data(), withPoints ? 0 : N));
+    std::stringstream deep(std::string(data, file.size()));
+    VERIFY(!loaded.load(deep, withPoints ? nullptr : points.data(), withPoints ? 0 : N));
+    header.depth = PCA_KDTREE_MAX_DEPTH;
+    std::memcpy(data, &header, sizeof(header));
+    VERIFY(mapped.load_view(data, file.size(), withPoints ? nullptr : points.data(), withPoints ? 0 : N));
+
+    // corrupted nodes and indices are rejected
+    using NodeType = typename KdTree<DataPoint>::NodeContainer::value_type;
+    using IndexType = typename KdTree<DataPoint>::IndexType;
+    const auto corrupted = [&](auto corrupt)
+    {
+        std::copy(file.begin(), file.end(), data);
+        corrupt(reinterpret_cast<NodeType*>(data + header.node_offset), reinterpret_cast<IndexType*>(data + header.index_offset));
+        const bool viewed = mapped.load_view(data, file.size(), withPoints ? nullptr : points.data(), withPoints ? 0 : N);
+        std::stringstream in(std::string(data, file.size()));
+        const bool read = loaded.load(in, withPoints ? nullptr : points.data(), withPoints ? 0 : N);
+        return !viewed && !read && mapped.node_count() == 0 && loaded.node_count() == 0;
+    };
+    const auto firstLeaf = [&](NodeType* nodes) -> NodeType& {
+        int n = 0;
+        while(!nodes[n].leaf) n = nodes[n].firstChildId;
+        return nodes[n];
+    };
+    VERIFY(!structure.node_data()[0].leaf);
+    VERIFY(corrupted([&](NodeType* nodes, IndexType*) { nodes[0].firstChildId = structure.node_count(); }));
+    VERIFY(corrupted([&](NodeType* nodes, IndexType*) { nodes[0].firstChildId = 0; }));
+    VERIFY(corrupted([&](NodeType* nodes, IndexType*) { firstLeaf(nodes).start = structure.index_count(); }));
+    VERIFY(corrupted([&](NodeType* nodes, IndexType*) { firstLeaf(nodes).size = structure.index_count() + 1; }));
+    VERIFY(corrupted([&](NodeType*, IndexType* indices) { indices[N / 2] = N; }));
+    VERIFY(corrupted([&](NodeType*, IndexType* indices) { indices[0] = -1; }));
+    VERIFY(!corrupted([&](NodeType*, IndexType*) {}));
+}
+
+template<typename DataPoint>
+void testKdTreeWideNodes(bool quick = true)
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int N = quick ? 500 : 5000;
+    const int k = 10;
+    auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+    KdTree<DataPoint> compact(points);
+    KdTree<DataPoint, KdTreeWideNode<Scalar>> wide(points);
+    VERIFY(check_same_tree(compact, wide));
+    VERIFY(compact.valid() && wide.valid());
+
+#pragma omp parallel for
+    for (int i = 0; i < N; ++i)
+    {
+        std::vector<int> results;
+        for (int j : wide.k_nearest_neighbors(i, k))
+            results.push_back(j);
+        VERIFY((check_k_nearest_neighbors<Scalar, VectorContainer>(points, i, k, results)));
+    }
+
+    // leaves larger than the compact layout are rejected instead of being truncated
+    const int M = int(KdTreeNode<Scalar>::MAX_LEAF_SIZE) * 3;
+    auto large = VectorContainer(M);
+    std::generate(large.begin(), large.end(), []() {return DataPoint(VectorType::Random()); });
+    compact.set_min_cell_size(M);
+    bool thrown = false;
+    try
+    {
+        compact.build(large);
+    }
+    catch (const std::length_error&)
+    {
+        thrown = true;
+    }
+    VERIFY(thrown && compact.node_count() == 0);
+
+    wide.set_min_cell_size(M);
+    wide.build(large);
+    VERIFY(wide.node_count() == 3);
+    VERIFY(int(wide.node_data()[1].size + wide.node_data()[2].size) == M);
+}
+
+template<typename DataPoint>
+void testKdTreeNodeLayout(KDTREE_NODE_LAYOUT layout, bool quick = true)
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int N = quick ? 500 : 5000;
+    const int k = 10;
+    auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+    KdTree<DataPoint> reference;
+    reference.set_min_cell_size(8);
+    reference.build(points);
+
+    KdTree<DataPoint> structure;
+    structure.set_min_cell_size(8);
+    structure.set_node_layout(layout);
+    structure.build(points);
+    VERIFY(structure.valid());
+    VERIFY(structure.node_count() == reference.node_count());
+    VERIFY(structure.index_data() == reference.index_data());
+
+    // the leaves are the same, only their ids change
+    std::vector<int> depths(structure.node_count(), 0);
+    for (int n = 0; n < structure.node_count(); ++n)
+    {
+        const auto& node = structure.node_data()[n];
+        if (node.leaf) continue;
+        VERIFY(int(node.firstChildId) > n);
+        depths[node.firstChildId] = depths[node.firstChildId + 1] = depths[n] + 1;
+        // breadth-first: the nodes are sorted by depth
+        VERIFY(layout != NODE_LAYOUT_BREADTH_FIRST || n == 0 || depths[n] >= depths[n-1]);
+    }
+
+    // the queries return the same neighbors in the same order
+#pragma omp parallel for
+    for (int i = 0; i < N; ++i)
+    {
+        const VectorType point = VectorType::Random();
+        std::vector<int> results, expected;
+        for (int j : structure.k_nearest_neighbors(point, k))
+            results.push_back(j);
+        for (int j : reference.k_nearest_neighbors(point, k))
+            expected.push_back(j);
+        VERIFY(results == expected);
+
+        const Scalar r = Eigen::internal::random<Scalar>(0., 0.2);
+        results.clear();
+        expected.clear();
+        for (int j : structure.range_neighbors(point, r))
+            results.push_back(j);
+        for (int j : reference.range_neighbors(point, r))
+            expected.push_back(j);
+        std::sort(results.begin(), results.end());
+        std::sort(expected.begin(), expected.end());
+        VERIFY(results == expected);
+
+        VERIFY(*structure.nearest_neighbor(i).begin() == *reference.nearest_neighbor(i).begin());
+    }
+}
+
+template<typename DataPoint>
+void testKdTreeNodeLayouts(bool quick = true)
+{
+    testKdTreeNodeLayout<DataPoint>(NODE_LAYOUT_BREADTH_FIRST, quick);
+    testKdTreeNodeLayout<DataPoint>(NODE_LAYOUT_VAN_EMDE_BOAS, quick);
+}
+
+template<typename DataPoint>
+void testKdTreeValidAndStatistics(bool quick = true)
+{
+    using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int N = quick ? 500 : 5000;
+    auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+    KdTree<DataPoint> structure;
+    VERIFY(structure.valid());
+    structure.set_min_cell_size(16);
+    structure.build(points);
+    VERIFY(structure.valid());
+
+    std::vector<int> sampling;
+    for (int i = 0; i < N; i += 4)
+        sampling.push_back(i);
+    structure.rebuild(sampling);
+    VERIFY(structure.valid());
+
+    const KdTreeStatistics stats = structure.statistics(100, 10);
+    VERIFY(stats.node_count == structure.node_count());
+    VERIFY(stats.leaf_count * 2 - 1 == stats.node_count);
+    VERIFY(std::accumulate(stats.depth_histogram.begin(), stats.depth_histogram.end(), 0) == stats.leaf_count);
+    VERIFY(std::accumulate(stats.leaf_size_histogram.begin(), stats.leaf_size_histogram.end(), 0) == stats.leaf_count);
+    VERIFY(stats.empty_leaf_count == (stats.leaf_size_histogram.empty() ? 0 : stats.leaf_size_histogram[0]));
+    VERIFY(int(stats.depth_histogram.size()) == stats.max_depth + 1);
+    VERIFY(stats.max_leaf_size <= structure.min_cell_size() || stats.max_depth >= PCA_KDTREE_MAX_DEPTH);
+    VERIFY(std::abs(stats.mean_leaf_size * stats.leaf_count - structure.index_count()) < 1e-6 * N);
+    VERIFY(stats.index_memory == sampling.size() * sizeof(int));
+    VERIFY(stats.query_count == 100 && stats.mean_leaf_visits >= 1);
+    VERIFY(!stats.to_string().empty());
+
+    // the allocations hold at least the used elements
+    const KdTreeMemoryUsage usage = structure.memory_usage();
+    VERIFY(usage.points >= N * sizeof(DataPoint));
+    VERIFY(usage.indices >= stats.index_memory);
+    VERIFY(usage.nodes + usage.node_bounds >= stats.node_memory);
+    VERIFY(usage.acceleration() == stats.leaf_position_memory);
+    VERIFY(usage.viewed == 0);
+    VERIFY(usage.total() >= stats.memory() + sizeof(KdTree<DataPoint>));
+    VERIFY(!usage.to_string().empty());
+
+    // corrupted trees are detected
+    structure.index_data()[1] = structure.index_data()[0];
+    VERIFY(!structure.valid());
+    structure.rebuild(sampling);
+    structure.node_data()[0].firstChildId = 0;
+    VERIFY(!structure.valid());
+}
+
+template<typename DataPoint>
+void testKdTreeAutotune(bool quick = true)
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int N = quick ? 2000 : 20000;
+    const int k = 10;
+    auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+    KdTreeAutotuneOptions options;
+    options.candidates = {4, 16, 64};
+    options.sample_size = N / 4;
+    options.query_count = 200;
+    options.k = k;
+    options.radius = 0.1;
+
+    KdTree<DataPoint> structure;
+    structure.set_use_leaf_positions(true);
+    const KdTreeAutotuneResult result = structure.autotune_min_cell_size(points, options);
+    VERIFY(result.candidates == options.candidates && result.seconds.size() == options.candidates.size());
+    VERIFY(std::find(options.candidates.begin(), options.candidates.end(), result.min_cell_size) != options.candidates.end());
+    VERIFY(structure.min_cell_size() == result.min_cell_size);
+    for (double seconds : result.seconds)
+        VERIFY(seconds >= 0. && seconds < std::numeric_limits<double>::infinity());
+    VERIFY(!result.to_string().empty());
+    // tuning does not build the tree
+    VERIFY(structure.node_count() == 0);
+
+    structure.build(points);
+    VERIFY(structure.valid());
+    for (int i = 0; i < N; i += N / 50)
+    {
+        std::vector<int> neighbors;
+        for (int j : structure.k_nearest_neighbors(i, k))
+            neighbors.push_back(j);
+        VERIFY((check_k_nearest_neighbors<Scalar, VectorContainer>(points, i, k, neighbors)));
+    }
+
+    // the decision is stored with the tree
+    std::stringstream stream;
+    VERIFY(structure.save(stream));
+    KdTree<DataPoint> loaded;
+    VERIFY(loaded.load(stream, points.data(), N));
+    VERIFY(loaded.min_cell_size() == result.min_cell_size);
+
+    // nothing to time: the leaf size is kept
+    options.k = 0;
+    options.radius = 0;
+    structure.set_min_cell_size(32);
+    VERIFY(structure.autotune_min_cell_size(points, options).min_cell_size == 32 && structure.min_cell_size() == 32);
+}
+
+template<typename DataPoint>
+void testKdTreeBufferReuse(bool quick = true)
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int N = quick ? 2000 : 20000;
+    const int k = 10;
+    const auto random_points = [](int n) {
+        auto points = VectorContainer(n);
+        std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+        return points;
+    };
+    const auto check_queries = [&](const KdTree<DataPoint>& structure, const VectorContainer& points) {
+        VERIFY(structure.valid());
+        for (int i = 0; i < int(points.size()); i += int(points.size()) / 20)
+        {
+            std::vector<int> neighbors;
+            for (int j : structure.k_nearest_neighbors(i, k))
+                neighbors.push_back(j);
+            VERIFY((check_k_nearest_neighbors<Scalar, VectorContainer>(points, i, k, neighbors)));
+        }
+    };
+
+    // the moved vector is adopted by the tree
+    auto points = random_points(N);
+    const VectorContainer reference = points;
+    const DataPoint* buffer = points.data();
+    KdTree<DataPoint> structure(std::move(points));
+    VERIFY(structure.point_data().data() == buffer);
+    check_queries(structure, reference);
+
+    // the nodes and indices are not reallocated by the builds of smaller or equal sizes
+    structure.set_split_strategy(SPLIT_MORTON);
+    structure.build(reference);
+    const auto nodes = structure.node_data().data();
+    const auto indices = structure.index_data().data();
+    const std::size_t morton = structure.memory_usage().build;
+    VERIFY(morton > 0);
+    for (int frame = 0; frame < 4; ++frame)
+    {
+        auto frame_points = random_points(N - frame * N / 8);
+        const VectorContainer frame_reference = frame_points;
+        structure.build(std::move(frame_points));
+        VERIFY(structure.node_data().data() == nodes && structure.index_data().data() == indices);
+        VERIFY(structure.memory_usage().build == morton);
+        check_queries(structure, frame_reference);
+    }
+
+    std::vector<int> sampling(N / 2);
+    std::iota(sampling.begin(), sampling.end(), 0);
+    structure.rebuild(sampling);
+    VERIFY(structure.valid() && structure.index_count() == N / 2);
+    VERIFY(structure.node_data().data() == nodes && structure.index_data().data() == indices);
+
+    // the buffers are released on demand
+    structure.clear();
+    VERIFY(structure.memory_usage().indices > 0);
+    structure.shrink_to_fit();
+    const KdTreeMemoryUsage usage = structure.memory_usage();
+    VERIFY(usage.points == 0 && usage.nodes == 0 && usage.indices == 0 && usage.build == 0);
+}
+
+int main(int argc, char** argv)
+{
+    if (!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test KdTree parallel build in 3D..." << endl;
+    testKdTreeParallelBuild<TestPoint<float, 3>>(false);
+    testKdTreeParallelBuild<TestPoint<double, 3>>(false);
+
+    cout << "Test KdTree parallel build in 4D..." << endl;
+    testKdTreeParallelBuild<TestPoint<float, 4>>(false);
+    testKdTreeParallelBuild<TestPoint<double, 4>>(false);
+
+    cout << "Test KdTree node bounds in 3D..." << endl;
+    testKdTreeBounds<TestPoint<float, 3>>(true, false);
+    testKdTreeBounds<TestPoint<double, 3>>(false, false);
+
+    cout << "Test KdTree node bounds in 4D..." << endl;
+    testKdTreeBounds<TestPoint<float, 4>>(false, false);
+    testKdTreeBounds<TestPoint<double, 4>>(true, false);
+
+    cout << "Test KdTree leaf ordered positions in 3D..." << endl;
+    testKdTreeLeafPositions<TestPoint<float, 3>>(false);
+    testKdTreeLeafPositions<TestPoint<double, 3>>(false);
+
+    cout << "Test KdTree leaf ordered positions in 4D..." << endl;
+    testKdTreeLeafPositions<TestPoint<float, 4>>(false);
+    testKdTreeLeafPositions<TestPoint<double, 4>>(false);
+
+    cout << "Test KdTree quantized positions in 3D..." << endl;
+    testKdTreeQuantizedPositions<TestPoint<float, 3>>(TestPoint<float, 3>::VectorType::Zero(), 1.f, false);
+    testKdTreeQuantizedPositions<TestPoint<double, 3>>(TestPoint<double, 3>::VectorType::Zero(), 1., false);
+    // far from the origin, the steps are bounded by the precision of the coordinates
+    testKdTreeQuantizedPositions<TestPoint<float, 3>>(TestPoint<float, 3>::VectorType::Constant(1000.f), 1e-2f, false);
+    testKdTreeQuantizedPositions<TestPoint<double, 3>>(TestPoint<double, 3>::VectorType::Constant(1e6), 1e-6, false);
+
+    cout << "Test KdTree quantized positions in 4D..." << endl;
+    testKdTreeQuantizedPositions<TestPoint<float, 4>>(TestPoint<float, 4>::VectorType::Zero(), 1.f, false);
+    testKdTreeQuantizedPositions<TestPoint<double, 4>>(TestPoint<double, 4>::VectorType::Zero(), 1., false);
+
+    cout << "Test non-owning KdTree in 3D..." << endl;
+    testKdTreeView<TestPoint<float, 3>>(false);
+    testKdTreeView<TestPoint<double, 3>>(false);
+
+    cout << "Test non-owning KdTree in 4D..." << endl;
+    testKdTreeView<TestPoint<float, 4>>(false);
+    testKdTreeView<TestPoint<double, 4>>(false);
+
+    cout << "Test KdTree serialization in 3D..." << endl;
+    testKdTreeSerialization<TestPoint<float, 3>>(true, false);
+    testKdTreeSerialization<TestPoint<double, 3>>(false, false);
+
+    cout << "Test KdTree serialization in 4D..." << endl;
+    testKdTreeSerialization<TestPoint<float, 4>>(false, false);
+    testKdTreeSerialization<TestPoint<double, 4>>(true, false);
+
+    cout << "Test KdTree wide nodes in 3D..." << endl;
+    testKdTreeWideNodes<TestPoint<float, 3>>(false);
+    testKdTreeWideNodes<TestPoint<double, 3>>(false);
+
+    cout << "Test KdTree wide nodes in 4D..." << endl;
+    testKdTreeWideNodes<TestPoint<float, 4>>(false);
+    testKdTreeWideNodes<TestPoint<double, 4>>(false);
+
+    cout << "Test KdTree validation and statistics in 3D..." << endl;
+    testKdTreeValidAndStatistics<TestPoint<float, 3>>(false);
+    testKdTreeValidAndStatistics<TestPoint<double, 3>>(false);
+
+    cout << "Test KdTree validation and statistics in 4D..." << endl;
+    testKdTreeValidAndStatistics<TestPoint<float, 4>>(false);
+    testKdTreeValidAndStatistics<TestPoint<double, 4>>(false);
+
+    cout << "Test KdTree split strategies in 3D..." << endl;
+    testKdTreeSplitStrategies<TestPoint<float, 3>>(false);
+    testKdTreeSplitStrategies<TestPoint<double, 3>>(false);
+
+    cout << "Test KdTree split strategies in 4D..." << endl;
+    testKdTreeSplitStrategies<TestPoint<float, 4>>(false);
+    testKdTreeSplitStrategies<TestPoint<double, 4>>(false);
+
+    cout << "Test KdTree build of clustered points in 3D..." << endl;
+    testKdTreeClusteredBuilds<TestPoint<float, 3>>(false);
+    testKdTreeClusteredBuilds<TestPoint<double, 3>>(false);
+
+    cout << "Test KdTree build of clustered points in 4D..." << endl;
+    testKdTreeClusteredBuilds<TestPoint<double, 4>>(false);
+
+    cout << "Test KdTree node layouts in 3D..." << endl;
+    testKdTreeNodeLayouts<TestPoint<float, 3>>(false);
+    testKdTreeNodeLayouts<TestPoint<double, 3>>(false);
+
+    cout << "Test KdTree node layouts in 4D..." << endl;
+    testKdTreeNodeLayouts<TestPoint<float, 4>>(false);
+    testKdTreeNodeLayouts<TestPoint<double, 4>>(false);
+
+    cout << "Test KdTree leaf size autotuning in 3D..." << endl;
+    testKdTreeAutotune<TestPoint<float, 3>>(false);
+    testKdTreeAutotune<TestPoint<double, 3>>(false);
+
+    cout << "Test KdTree leaf size autotuning in 4D..." << endl;
+    testKdTreeAutotune<TestPoint<double, 4>>(false);
+
+    cout << "Test KdTree buffer reuse across builds in 3D..." << endl;
+    testKdTreeBufferReuse<TestPoint<float, 3>>(false);
+    testKdTreeBufferReuse<TestPoint<double, 3>>(false);
+}
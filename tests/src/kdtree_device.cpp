@@ -0,0 +1,165 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+using namespace Ponca;
+
+/// The device view is queried on the host, where PONCA_MULTIARCH functions are regular functions
+template<typename DataPoint, typename NodeType>
+void testKdTreeDeviceView(KDTREE_SPLIT_STRATEGY strategy, bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint, NodeType>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+	constexpr int K = 8;
+
+	const int N = quick ? 100 : 5000;
+	auto points = VectorContainer(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	std::vector<int> sampling(N);
+	std::iota(sampling.begin(), sampling.end(), 0);
+
+	KdTree<DataPoint, NodeType> structure;
+	structure.set_split_strategy(strategy);
+	structure.set_min_cell_size(16);
+	structure.build(points);
+	const auto view = structure.device_view();
+	VERIFY(view.point_count == N && view.node_count == structure.node_count());
+
+#pragma omp parallel for
+	for (int i = 0; i < N; ++i)
+	{
+		const VectorType point = VectorType::Random();
+		const Scalar r = Eigen::internal::random<Scalar>(0., 0.5);
+
+		std::vector<int> results;
+		view.range_neighbors(point, r, [&](int j, Scalar d)
+		{
+			VERIFY(d == (points[j].pos() - point).squaredNorm());
+			results.push_back(j);
+		});
+		VERIFY((check_range_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, point, r, results)));
+
+		int neighbors[K];
+		Scalar distances[K];
+		VERIFY(view.template k_nearest_neighbors<K>(point, neighbors, distances) == K);
+		results.assign(neighbors, neighbors + K);
+		VERIFY((check_k_nearest_neighbors<Scalar, VectorType, VectorContainer>(points, point, K, results)));
+		for (int k = 1; k < K; ++k)
+			VERIFY(distances[k-1] <= distances[k]);
+
+		Scalar d;
+		const int nearest = view.nearest_neighbor(point, &d);
+		VERIFY(nearest >= 0 && d == distances[0]);
+	}
+
+	// less points than neighbors
+	KdTree<DataPoint, NodeType> small(VectorContainer(points.begin(), points.begin() + K/2));
+	int neighbors[K];
+	VERIFY(small.device_view().template k_nearest_neighbors<K>(VectorType::Zero(), neighbors) == K/2);
+	VERIFY(neighbors[K/2 - 1] >= 0 && neighbors[K/2] == -1);
+
+	VERIFY((KdTree<DataPoint, NodeType>().device_view().nearest_neighbor(VectorType::Zero()) == -1));
+}
+
+/// The steps of the device build are run on the host by kdtree_morton_build
+template<typename DataPoint, typename NodeType>
+void testKdTreeMortonBuild(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using IndexType = typename NodeType::IndexType;
+	using VectorContainer = typename KdTree<DataPoint, NodeType>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+	constexpr int K = 8;
+
+	const int N = quick ? 100 : 5000;
+	auto points = VectorContainer(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+	// a cluster sharing a Morton cell, gathered in a leaf whatever its size
+	for (int i = 0; i < N / 10; ++i)
+		points[i] = DataPoint(VectorType::Constant(Scalar(0.25)) + VectorType::Random() * Scalar(1e-9));
+
+	std::vector<int> sampling(N);
+	std::iota(sampling.begin(), sampling.end(), 0);
+
+	std::vector<NodeType> nodes;
+	std::vector<IndexType> indices;
+	VERIFY((kdtree_morton_build(points.data(), IndexType(N), nodes, indices, 16)));
+	VERIFY(!has_duplicate(indices) && int(indices.size()) == N);
+
+	int leafSize = 0;
+	for (const NodeType& node : nodes)
+		if (node.leaf)
+			leafSize += node.size;
+		else
+			VERIFY(int(node.firstChildId) + 1 < int(nodes.size()));
+	VERIFY(leafSize == N);
+
+	KdTreeDeviceView<DataPoint, NodeType> view;
+	view.points      = points.data();
+	view.nodes       = nodes.data();
+	view.indices     = indices.data();
+	view.point_count = N;
+	view.node_count  = int(nodes.size());
+
+#pragma omp parallel for
+	for (int i = 0; i < N; ++i)
+	{
+		const VectorType point = i % 2 == 0 ? points[i].pos() : VectorType(VectorType::Random());
+		const Scalar r = Eigen::internal::random<Scalar>(0., 0.5);
+
+		std::vector<int> results;
+		view.range_neighbors(point, r, [&](int j, Scalar) { results.push_back(j); });
+		VERIFY((check_range_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, point, r, results)));
+
+		IndexType neighbors[K];
+		VERIFY(view.template k_nearest_neighbors<K>(point, neighbors) == K);
+		results.assign(neighbors, neighbors + K);
+		VERIFY((check_k_nearest_neighbors<Scalar, VectorType, VectorContainer>(points, point, K, results)));
+	}
+
+	// a single leaf at the maximal depth of 1
+	VERIFY((kdtree_morton_build(points.data(), IndexType(N), nodes, indices, 1, 1)));
+	VERIFY(nodes.size() == 3 && nodes[1].leaf && nodes[2].leaf);
+
+	// points sharing a Morton cell beyond the maximal leaf size
+	if (NodeType::MAX_LEAF_SIZE < std::size_t(0xffffffff))
+	{
+		const VectorContainer same(NodeType::MAX_LEAF_SIZE + 1, DataPoint(VectorType::Zero()));
+		VERIFY(!(kdtree_morton_build(same.data(), IndexType(same.size()), nodes, indices)));
+	}
+
+	VERIFY((kdtree_morton_build(points.data(), IndexType(0), nodes, indices) && nodes.empty()));
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Test KdTree device view in 3D..." << endl;
+	testKdTreeDeviceView<TestPoint<float, 3>, KdTreeNode<float>>(SPLIT_MIDPOINT, false);
+	testKdTreeDeviceView<TestPoint<double, 3>, KdTreeNode<double>>(SPLIT_MORTON, false);
+	testKdTreeDeviceView<TestPoint<float, 3>, KdTreeWideNode<float>>(SPLIT_MEDIAN, false);
+
+	cout << "Test KdTree device view in 4D..." << endl;
+	testKdTreeDeviceView<TestPoint<float, 4>, KdTreeNode<float>>(SPLIT_MIDPOINT, false);
+	testKdTreeDeviceView<TestPoint<double, 4>, KdTreeWideNode<double>>(SPLIT_MORTON, false);
+
+	cout << "Test KdTree Morton build..." << endl;
+	testKdTreeMortonBuild<TestPoint<float, 3>, KdTreeNode<float>>(false);
+	testKdTreeMortonBuild<TestPoint<double, 3>, KdTreeWideNode<double>>(false);
+	testKdTreeMortonBuild<TestPoint<float, 4>, KdTreeLargeNode<float>>(false);
+}
@@ -0,0 +1,193 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/kdtree_duplicates.cpp
+    \brief Test the KdTree on point clouds with many duplicated points, and the maximal depth of the trees
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/dynamicKdTree.h>
+
+#include <vector>
+
+using namespace Ponca;
+
+/// Uniform points, and a few positions repeated up to `copies` times
+template<typename DataPoint>
+std::vector<DataPoint> duplicatedCloud(int copies)
+{
+    using VectorType = typename DataPoint::VectorType;
+    std::vector<DataPoint> points(Eigen::internal::random<int>(500, 2000));
+    std::generate(points.begin(), points.end(), []() { return DataPoint(VectorType::Random()); });
+    for (int c = 0; c < 4; ++c)
+    {
+        // on existing points or apart
+        const VectorType p = c % 2 == 0 ? points[c].pos() : VectorType(VectorType::Random());
+        points.insert(points.end(), Eigen::internal::random<int>(copies / 2, copies), DataPoint(p));
+    }
+    return points;
+}
+
+template<typename Tree, typename DataPoint>
+void checkQueries(const Tree& tree, const std::vector<DataPoint>& points)
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int n = int(points.size());
+    const int k = Eigen::internal::random<int>(1, 40);
+    const Scalar r = Eigen::internal::random<Scalar>(0.05, 0.3);
+    for (int q = 0; q < 20; ++q)
+    {
+        // around the duplicated positions, or anywhere
+        const int i = Eigen::internal::random<int>(0, n - 1);
+        const VectorType p = q % 2 == 0 ? VectorType(points[n - 1 - q].pos() + Scalar(0.01) * VectorType::Random())
+                                        : VectorType(VectorType::Random());
+
+        VERIFY((check_nearest_neighbor<Scalar, VectorType>(points, p, *tree.nearest_neighbor(p).begin())));
+        VERIFY((check_nearest_neighbor<Scalar>(points, i, *tree.nearest_neighbor(i).begin())));
+
+        std::vector<int> neighbors;
+        for (int j : tree.k_nearest_neighbors(p, k))
+            neighbors.push_back(j);
+        VERIFY((check_k_nearest_neighbors<Scalar, VectorType>(points, p, k, neighbors)));
+        neighbors.clear();
+        for (int j : tree.k_nearest_neighbors(i, k))
+            neighbors.push_back(j);
+        VERIFY((check_k_nearest_neighbors<Scalar>(points, i, k, neighbors)));
+
+        std::vector<int> expected;
+        for (int j = 0; j < n; ++j)
+            if ((points[j].pos() - p).squaredNorm() < r * r)
+                expected.push_back(j);
+        neighbors.clear();
+        for (int j : tree.range_neighbors(p, r))
+            neighbors.push_back(j);
+        std::sort(neighbors.begin(), neighbors.end());
+        VERIFY(neighbors == expected);
+    }
+
+    // batches scan the duplicate leaves as the queries
+    std::vector<VectorType> positions(50);
+    for (int j = 0; j < int(positions.size()); ++j)
+        positions[j] = points[n - 1 - j].pos();
+    std::vector<int> indices(positions.size() * k);
+    tree.k_nearest_neighbors_batch(positions, k, indices.data());
+    for (int j = 0; j < int(positions.size()); ++j)
+    {
+        const std::vector<int> batch(indices.begin() + j * k, indices.begin() + (j + 1) * k);
+        VERIFY((check_k_nearest_neighbors<Scalar, VectorType>(points, positions[j], k, batch)));
+    }
+}
+
+template<typename DataPoint>
+void testDuplicates(KDTREE_SPLIT_STRATEGY strategy, bool leafPositions, bool tightBounds)
+{
+    const std::vector<DataPoint> points = duplicatedCloud<DataPoint>(5000);
+
+    KdTree<DataPoint> tree;
+    tree.set_split_strategy(strategy);
+    tree.set_use_leaf_positions(leafPositions);
+    tree.set_tight_bounds(tightBounds);
+    tree.build(points);
+    VERIFY(tree.valid());
+
+    // the duplicates are gathered in a few leaves instead of filling the deepest ones
+    const KdTreeStatistics stats = tree.statistics();
+    VERIFY(stats.duplicate_leaf_count > 0);
+    VERIFY(stats.max_depth < tree.max_depth());
+
+    checkQueries(tree, points);
+
+    // the dynamic trees keep the duplicate leaves valid through insertions and removals
+    DynamicKdTree<DataPoint> dynamic(points);
+    for (int j = 0; j < 100; ++j)
+    {
+        dynamic.insert(points[points.size() - 1 - j]);
+        dynamic.remove(Eigen::internal::random<int>(0, int(points.size()) - 1));
+    }
+    VERIFY(dynamic.valid());
+}
+
+/// More copies of a single position than the leaves of KdTreeNode can hold
+template<typename DataPoint>
+void testSinglePosition()
+{
+    using VectorType = typename DataPoint::VectorType;
+
+    const int n = int(KdTreeNode<typename DataPoint::Scalar>::MAX_LEAF_SIZE) + Eigen::internal::random<int>(1, 5000);
+    const VectorType p = VectorType::Random();
+    const std::vector<DataPoint> points(n, DataPoint(p));
+    const KdTree<DataPoint> tree(points);
+    VERIFY(tree.valid() && tree.statistics().duplicate_leaf_count >= 2);
+
+    int count = 0;
+    for (int j : tree.range_neighbors(p, 1))
+        count += j >= 0;
+    VERIFY(count == n);
+    count = 0;
+    for (int j : tree.k_nearest_neighbors(VectorType(p + VectorType::Ones()), 10))
+        count += j >= 0;
+    VERIFY(count == 10);
+}
+
+/// The depth of the trees is bounded by their max_depth()
+template<typename DataPoint>
+void testMaxDepth()
+{
+    using VectorType = typename DataPoint::VectorType;
+
+    std::vector<DataPoint> points(Eigen::internal::random<int>(2000, 5000));
+    std::generate(points.begin(), points.end(), []() { return DataPoint(VectorType::Random()); });
+
+    KdTree<DataPoint> tree;
+    VERIFY(tree.max_depth() == PCA_KDTREE_MAX_DEPTH);
+    tree.set_max_depth(PCA_KDTREE_MAX_DEPTH + 10);
+    VERIFY(tree.max_depth() == PCA_KDTREE_MAX_DEPTH);
+
+    const int depth = Eigen::internal::random<int>(1, 4);
+    tree.set_max_depth(depth);
+    tree.set_min_cell_size(1);
+    tree.build(points);
+    VERIFY(tree.valid() && tree.statistics().max_depth == depth);
+    checkQueries(tree, points);
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    using Point = PointPosition<Scalar, 3>;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testDuplicates<Point>(SPLIT_MIDPOINT, false, true) ));
+        CALL_SUBTEST(( testDuplicates<Point>(SPLIT_MIDPOINT, true, false) ));
+        CALL_SUBTEST(( testDuplicates<Point>(SPLIT_MEDIAN, false, true) ));
+        CALL_SUBTEST(( testDuplicates<Point>(SPLIT_MORTON, true, true) ));
+        CALL_SUBTEST(( testDuplicates<Point>(SPLIT_SAH, false, false) ));
+        CALL_SUBTEST(( testMaxDepth<Point>() ));
+    }
+    CALL_SUBTEST(( testSinglePosition<Point>() ));
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Test the KdTree with duplicated points..." << std::endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    std::cout << "Ok..." << std::endl;
+}
@@ -0,0 +1,260 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/dynamicKdTree.h>
+
+#include <deque>
+
+using namespace Ponca;
+
+/// Check the range, k-nearest neighbors and box queries of `structure` against a brute force search over its live
+/// points
+template<typename DataPoint, typename Tree>
+void checkDynamicQueries(const Tree& structure, int queryCount)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorType = typename DataPoint::VectorType;
+	using Aabb = typename Tree::Aabb;
+
+	std::vector<int> live;
+	for (int i = 0; i < structure.point_count(); ++i)
+		if (!structure.is_removed(i))
+			live.push_back(i);
+	VERIFY(int(live.size()) == structure.live_count());
+
+	const int k = 8;
+	for (int q = 0; q < queryCount; ++q)
+	{
+		const VectorType point = VectorType::Random();
+		const Scalar r = Eigen::internal::random<Scalar>(0., 0.5);
+
+		std::vector<int> results;
+		for (int j : structure.range_neighbors(point, r))
+			results.push_back(j);
+		VERIFY(!has_duplicate(results));
+		std::vector<int> expected;
+		for (int j : live)
+			if ((structure.point(j).pos() - point).squaredNorm() < r * r)
+				expected.push_back(j);
+		std::sort(results.begin(), results.end());
+		VERIFY(results == expected);
+
+		// compare the distances, equidistant neighbors may be returned in any order
+		std::vector<Scalar> distances, expectedDistances;
+		auto query = structure.k_nearest_neighbors(point, k);
+		for (auto it = query.begin(); it != query.end(); ++it)
+			distances.push_back(it.squared_distance());
+		for (int j : live)
+			expectedDistances.push_back((structure.point(j).pos() - point).squaredNorm());
+		std::sort(expectedDistances.begin(), expectedDistances.end());
+		expectedDistances.resize(std::min<std::size_t>(k, expectedDistances.size()));
+		VERIFY(distances.size() == expectedDistances.size());
+		for (std::size_t j = 0; j < distances.size(); ++j)
+			VERIFY(std::abs(distances[j] - expectedDistances[j]) <= testEpsilon<Scalar>());
+
+		// the large boxes enclose whole subtrees, whose ranges hold the free slots of the leaves
+		const VectorType a = VectorType::Random() * Scalar(2), b = VectorType::Random() * Scalar(2);
+		const Aabb box(a.cwiseMin(b), a.cwiseMax(b));
+		results.clear();
+		for (int j : structure.box_neighbors(box))
+			results.push_back(j);
+		expected.clear();
+		for (int j : live)
+			if (box.contains(structure.point(j).pos()))
+				expected.push_back(j);
+		std::sort(results.begin(), results.end());
+		VERIFY(results == expected);
+	}
+
+	// a box enclosing all the points
+	std::vector<int> results;
+	for (int j : structure.box_neighbors(Aabb(VectorType::Constant(Scalar(-10)), VectorType::Constant(Scalar(10)))))
+		results.push_back(j);
+	std::sort(results.begin(), results.end());
+	VERIFY(results == live);
+}
+
+/// Check the batched queries over the points of `structure` and to_string(), which skip the free slots
+template<typename DataPoint, typename Tree>
+void checkDynamicBatches(const Tree& structure)
+{
+	using Scalar = typename DataPoint::Scalar;
+
+	const int k = 8;
+	const int count = structure.point_count();
+	std::vector<int> indices(std::size_t(count) * k);
+	std::vector<Scalar> distances(std::size_t(count) * k);
+	structure.k_nearest_neighbors_batch(k, indices.data(), distances.data());
+	for (int i = 0; i < count; i += 7)
+	{
+		int n = 0;
+		auto query = structure.k_nearest_neighbors(i, k);
+		for (auto it = query.begin(); it != query.end(); ++it, ++n)
+			VERIFY(std::abs(distances[std::size_t(i) * k + n] - it.squared_distance()) <= testEpsilon<Scalar>());
+		for (int j = 0; j < n; ++j)
+			VERIFY(!structure.is_removed(indices[std::size_t(i) * k + j]));
+	}
+
+	std::vector<std::size_t> offsets;
+	typename Tree::IndexContainer neighbors;
+	structure.range_neighbors_batch(Scalar(0.1), offsets, neighbors);
+	VERIFY(int(offsets.size()) == count + 1);
+	for (int j : neighbors)
+		VERIFY(!structure.is_removed(j));
+
+	VERIFY(structure.to_string().find(": -1") == std::string::npos);
+}
+
+template<typename DataPoint>
+void testDynamicKdTree(bool quick = true)
+{
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 100 : 5000;
+	auto points = VectorContainer(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	DynamicKdTree<DataPoint> structure;
+	structure.set_min_cell_size(16);
+	structure.build(points);
+	VERIFY(structure.valid());
+	checkDynamicQueries<DataPoint>(structure, 20);
+
+	// streaming: each frame inserts new points and removes the oldest ones, whose ids are reused
+	std::deque<int> ages;
+	for (int i = 0; i < N; ++i)
+		ages.push_back(i);
+	int peak = N;
+	for (int frame = 0; frame < 20; ++frame)
+	{
+		const int inserted = Eigen::internal::random<int>(0, N / 5);
+		const int removed = Eigen::internal::random<int>(0, N / 5);
+		for (int i = 0; i < inserted; ++i)
+		{
+			// new points drift away from the initial cloud
+			const VectorType p = VectorType::Random() + VectorType::Constant(typename DataPoint::Scalar(frame) / 20);
+			const int id = structure.insert(DataPoint(p));
+			VERIFY(structure.point(id).pos() == p && !structure.is_removed(id));
+			ages.push_back(id);
+		}
+		peak = std::max(peak, structure.live_count());
+		VERIFY(structure.point_count() == peak);
+		for (int i = 0; i < removed && !ages.empty(); ++i)
+		{
+			VERIFY(structure.remove(ages.front()));
+			VERIFY(!structure.remove(ages.front()));
+			ages.pop_front();
+		}
+		VERIFY(structure.valid());
+		checkDynamicQueries<DataPoint>(structure, 10);
+	}
+
+	// removing everything and inserting again
+	while (!ages.empty())
+	{
+		VERIFY(structure.remove(ages.back()));
+		ages.pop_back();
+	}
+	VERIFY(structure.valid());
+	VERIFY(structure.live_count() == 0);
+	for (int i = 0; i < N / 2; ++i)
+		structure.insert(DataPoint(VectorType::Random()));
+	VERIFY(structure.valid());
+	VERIFY(structure.point_count() == peak);
+	checkDynamicQueries<DataPoint>(structure, 20);
+	checkDynamicBatches<DataPoint>(structure);
+}
+
+template<typename DataPoint>
+void testDynamicKdTreePartialRebuilds(bool quick = true)
+{
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 1000 : 20000;
+	auto points = VectorContainer(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	DynamicKdTree<DataPoint> structure(points);
+	structure.set_use_leaf_positions(true);
+	structure.build(points);
+
+	// local insertions only rebuild the subtrees around them
+	for (int i = 0; i < N / 10; ++i)
+		structure.insert(DataPoint(VectorType::Random() * 0.1));
+	VERIFY(structure.valid());
+	VERIFY(structure.rebuild_count() > 1);
+	VERIFY(structure.leaf_positions().rows() == structure.index_count());
+	checkDynamicQueries<DataPoint>(structure, 20);
+}
+
+template<typename DataPoint>
+void testDynamicKdTreeMove(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 1000 : 10000;
+	auto points = VectorContainer(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	DynamicKdTree<DataPoint> structure;
+	structure.set_min_cell_size(16);
+	structure.set_use_leaf_positions(true);
+	structure.build(points);
+	VERIFY(structure.remove(0));
+	VERIFY(!structure.move(0, points[0]));
+	VERIFY(!structure.move(N, points[0]));
+
+	// small motions of all the points, then large motions of a few ones: the ids are kept
+	for (int frame = 0; frame < 10; ++frame)
+	{
+		const Scalar amplitude = frame % 2 ? Scalar(0.01) : Scalar(1);
+		const int count = frame % 2 ? N : N / 20;
+		for (int i = 0; i < count; ++i)
+		{
+			const int id = Eigen::internal::random<int>(1, N - 1);
+			const VectorType p = (structure.point(id).pos() + VectorType::Random() * amplitude).cwiseMax(Scalar(-1)).cwiseMin(Scalar(1));
+			VERIFY(structure.move(id, DataPoint(p)));
+			VERIFY(structure.point(id).pos() == p);
+		}
+		VERIFY(structure.valid());
+		VERIFY(structure.live_count() == N - 1 && structure.point_count() == N);
+		VERIFY(structure.leaf_positions().rows() == structure.index_count());
+		checkDynamicQueries<DataPoint>(structure, 10);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+    cout << "Test DynamicKdTree in 3D..." << endl;
+	testDynamicKdTree<TestPoint<float, 3>>(false);
+	testDynamicKdTree<TestPoint<double, 3>>(false);
+
+    cout << "Test DynamicKdTree in 4D..." << endl;
+	testDynamicKdTree<TestPoint<float, 4>>(false);
+	testDynamicKdTree<TestPoint<double, 4>>(false);
+
+    cout << "Test DynamicKdTree partial rebuilds in 3D..." << endl;
+	testDynamicKdTreePartialRebuilds<TestPoint<float, 3>>(false);
+	testDynamicKdTreePartialRebuilds<TestPoint<double, 3>>(false);
+
+    cout << "Test DynamicKdTree moves in 3D..." << endl;
+	testDynamicKdTreeMove<TestPoint<float, 3>>(false);
+	testDynamicKdTreeMove<TestPoint<double, 3>>(false);
+}
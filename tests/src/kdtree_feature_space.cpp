@@ -0,0 +1,162 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/kdtree_feature_space.cpp
+    \brief Test the KdTree queries in 6D and 9D feature spaces with a weighted metric, and the consistency of the
+    metric with MahalanobisWeightFunc
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/mahalanobisWeightFunc.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+#include <Ponca/src/SpatialPartitioning/weightedMetric.h>
+
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+// the feature spaces exceed the dimensions of the compact nodes
+static_assert(std::is_same<KdTree<PointPosition<float, 3>>, KdTree<PointPosition<float, 3>, KdTreeNode<float>>>::value, "");
+static_assert(std::is_same<KdTree<PointPosition<float, 6>>, KdTree<PointPosition<float, 6>, KdTreeWideNode<float>>>::value, "");
+static_assert(std::is_same<KdTree<PointPosition<float, 9>>, KdTree<PointPosition<float, 9>, KdTreeWideNode<float>>>::value, "");
+
+template<typename Range>
+vector<int> sorted(Range&& range)
+{
+    vector<int> result;
+    for (int j : range)
+        result.push_back(j);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+template<typename DataPoint>
+void testQueries(KDTREE_SPLIT_STRATEGY strategy, bool leafPositions, bool quantized)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef WeightedMetric<DataPoint> Metric;
+
+    // position, normal and color (9D) blocks of weights
+    VectorType weights;
+    for (int i = 0; i < DataPoint::Dim; ++i)
+        weights(i) = i < 3 ? Scalar(1) : (i < 6 ? Scalar(0.25) : Scalar(4));
+    const Metric metric(weights);
+
+    const int n = Eigen::internal::random<int>(500, 3000), k = Eigen::internal::random<int>(1, 20);
+    const Scalar r = Eigen::internal::random<Scalar>(0.5, 1.5);
+    vector<DataPoint> points(n);
+    std::generate(points.begin(), points.end(), []() { return DataPoint(VectorType::Random()); });
+
+    KdTree<DataPoint> tree;
+    tree.set_split_strategy(strategy);
+    tree.set_use_leaf_positions(leafPositions);
+    tree.set_use_quantized_positions(quantized);
+    tree.build(metric.transform_points(points));
+    VERIFY(tree.valid() && tree.point_count() == n);
+    const KdTree<DataPoint> featureTree(points);
+
+    for (int q = 0; q < 20; ++q)
+    {
+        const VectorType p = VectorType::Random();
+        const VectorType tp = metric.transform(p);
+        VERIFY((metric.inverse_transform(tp) - p).norm() <= testEpsilon<Scalar>());
+
+        // brute force in the weighted metric
+        vector<int> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](int a, int b) {
+            return metric.squared_distance(points[a].pos(), p) < metric.squared_distance(points[b].pos(), p);
+        });
+        vector<int> expected;
+        for (int j = 0; j < n; ++j)
+            if (metric.squared_distance(points[j].pos(), p) <= r * r)
+                expected.push_back(j);
+
+        VERIFY(*tree.nearest_neighbor(tp).begin() == order[0]);
+        VERIFY(sorted(tree.k_nearest_neighbors(tp, k)) == sorted(vector<int>(order.begin(), order.begin() + k)));
+
+        // the points on the boundary may be classified differently by the two metrics, up to the rounding
+        const vector<int> range = sorted(tree.range_neighbors(tp, r));
+        const vector<int> ellipsoid = sorted(featureTree.ellipsoid_neighbors(metric.region(p, r)));
+        for (const vector<int>* neighbors : {&range, &ellipsoid})
+        {
+            vector<int> difference;
+            std::set_symmetric_difference(neighbors->begin(), neighbors->end(), expected.begin(), expected.end(),
+                                          std::back_inserter(difference));
+            for (int j : difference)
+                VERIFY(std::abs(metric.squared_distance(points[j].pos(), p) - r * r) <= r * r * testEpsilon<Scalar>());
+        }
+    }
+}
+
+/// The fit weight of the metric vanishes outside the range neighbors of the same radius
+template<typename DataPoint>
+void testWeightFunc()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef SmoothWeightKernel<Scalar> Kernel;
+
+    const WeightedMetric<DataPoint> metric(VectorType::Random().cwiseAbs() + VectorType::Constant(Scalar(0.1)));
+    const Scalar t = Eigen::internal::random<Scalar>(0.5, 1.5);
+    const MahalanobisWeightFunc<DataPoint, Kernel> featureWeight(t, metric.matrix());
+    const DistWeightFunc<DataPoint, Kernel> weight(t);
+
+    const int n = 2000;
+    vector<DataPoint> points(n);
+    std::generate(points.begin(), points.end(), []() { return DataPoint(VectorType::Random()); });
+    const KdTree<DataPoint> tree(metric.transform_points(points));
+
+    const VectorType center = VectorType::Random();
+    const vector<int> support = sorted(tree.range_neighbors(metric.transform(center), t));
+    for (int j = 0; j < n; ++j)
+    {
+        const Scalar w = featureWeight.w(points[j].pos() - center, points[j]);
+        VERIFY(std::abs(w - weight.w(metric.transform(points[j].pos()) - metric.transform(center), points[j])) <=
+               testEpsilon<Scalar>());
+        VERIFY(w <= Scalar(0) || std::binary_search(support.begin(), support.end(), j));
+    }
+}
+
+template<typename Scalar, int Dim>
+void callSubTests()
+{
+    typedef PointPosition<Scalar, Dim> Point;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testQueries<Point>(SPLIT_MIDPOINT, false, false) ));
+        CALL_SUBTEST(( testQueries<Point>(SPLIT_MIDPOINT, true, true) ));
+        CALL_SUBTEST(( testQueries<Point>(SPLIT_MORTON, true, false) ));
+        CALL_SUBTEST(( testQueries<Point>(SPLIT_SAH, false, false) ));
+        CALL_SUBTEST(( testWeightFunc<Point>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the KdTree in 6D and 9D feature spaces..." << endl;
+    callSubTests<float, 6>();
+    callSubTests<double, 6>();
+    callSubTests<float, 9>();
+    callSubTests<double, 9>();
+    cout << "Ok..." << endl;
+}
@@ -72,6 +72,348 @@ void testKdTreeKNearestPoint(bool quick = true)
 	}
 }
 
+template<typename DataPoint>
+void testKdTreeKNearestBatch(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 100 : 10000;
+	const int k = quick ? 5 : 15;
+	auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+	std::vector<VectorType> queries(N);
+	std::generate(queries.begin(), queries.end(), []() {return VectorType::Random(); });
+
+	KdTree<DataPoint> structure(points);
+
+	std::vector<int> indices(N * k), pointIndices(N * k);
+	std::vector<Scalar> distances(N * k);
+	structure.k_nearest_neighbors_batch(k, indices.data(), distances.data());
+	structure.k_nearest_neighbors_batch(queries, k, pointIndices.data());
+
+#pragma omp parallel for
+	for (int i = 0; i < N; ++i)
+	{
+		// same neighbors as the single queries, sorted by increasing distance
+		std::vector<int> results(indices.begin() + i*k, indices.begin() + (i+1)*k);
+		VERIFY((check_k_nearest_neighbors<Scalar, VectorContainer>(points, i, k, results)));
+		for (int j = 0; j < k; ++j)
+		{
+			VERIFY(distances[i*k + j] == (points[results[j]].pos() - points[i].pos()).squaredNorm());
+			VERIFY(j == 0 || distances[i*k + j - 1] <= distances[i*k + j]);
+		}
+
+		results.assign(pointIndices.begin() + i*k, pointIndices.begin() + (i+1)*k);
+		std::vector<int> expected;
+		for (int j : structure.k_nearest_neighbors(queries[i], k))
+			expected.push_back(j);
+		VERIFY(results == expected);
+	}
+
+	// missing neighbors are invalid
+	KdTree<DataPoint> small(VectorContainer(points.begin(), points.begin() + k/2));
+	small.k_nearest_neighbors_batch(queries, k, indices.data(), distances.data());
+	for (int i = 0; i < N; ++i)
+	{
+		for (int j = 0; j < k; ++j)
+		{
+			VERIFY((j < k/2) == (indices[i*k + j] != -1));
+			VERIFY((j < k/2) == (distances[i*k + j] != std::numeric_limits<Scalar>::max()));
+		}
+	}
+}
+
+template<typename DataPoint>
+void testKdTreeKNearestStatic(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	constexpr int k = 15;
+	const int N = quick ? 100 : 10000;
+	auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	KdTree<DataPoint> structure(points);
+
+#pragma omp parallel for
+	for (int i = 0; i < N; ++i)
+	{
+		// same neighbors as the queries with a dynamic queue
+		auto query = structure.template k_nearest_neighbors<k>(i);
+		std::vector<int> results, expected;
+		for (int j : query)
+			results.push_back(j);
+		for (int j : structure.k_nearest_neighbors(i, k))
+			expected.push_back(j);
+		VERIFY(results == expected);
+		VERIFY((check_k_nearest_neighbors<Scalar, VectorContainer>(points, i, k, results)));
+
+		VectorType point = VectorType::Random();
+		results.clear();
+		for (int j : structure.template k_nearest_neighbors<k>(point))
+			results.push_back(j);
+		VERIFY((check_k_nearest_neighbors<Scalar, VectorType, VectorContainer>(points, point, k, results)));
+
+		// rebound to a new input and a smaller k
+		results.clear();
+		for (int j : query(N-1-i, k/2))
+			results.push_back(j);
+		VERIFY((check_k_nearest_neighbors<Scalar, VectorContainer>(points, N-1-i, k/2, results)));
+	}
+
+	// queue semantics: sorted, bounded, and stable for equal priorities
+	static_limited_priority_queue<IndexSquaredDistance<Scalar>, 4> queue(3);
+	VERIFY(queue.capacity() == 3 && queue.empty());
+	const IndexSquaredDistance<Scalar> values[] = {{0, 3}, {1, 1}, {2, 2}, {3, 1}, {4, 5}, {5, 0}};
+	std::vector<bool> pushed;
+	for (const auto& v : values)
+		pushed.push_back(queue.push(v));
+	VERIFY(queue.full() && queue.size() == 3);
+	VERIFY((pushed == std::vector<bool>{true, true, true, true, false, true}));
+	VERIFY(queue.top().index == 5 && (queue.begin()+1)->index == 1 && queue.bottom().index == 3);
+}
+
+template<typename DataPoint>
+void testKdTreeKNearestApproximate(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 100 : 10000;
+	const int k = quick ? 5 : 15;
+	const Scalar eps = 0.5;
+	auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	KdTree<DataPoint> structure(points);
+
+#pragma omp parallel for
+	for (int i = 0; i < N; ++i)
+	{
+		VectorType point = VectorType::Random();
+		std::vector<Scalar> exact, approximate;
+		for (int j : structure.k_nearest_neighbors(point, k))
+			exact.push_back((points[j].pos() - point).norm());
+		auto query = structure.k_nearest_neighbors(point, k, eps);
+		for (int j : query)
+			approximate.push_back((points[j].pos() - point).norm());
+
+		// each neighbor is at most (1+eps) farther than the exact one
+		VERIFY(approximate.size() == exact.size());
+		for (size_t j = 0; j < exact.size(); ++j)
+			VERIFY(approximate[j] <= (1 + eps) * exact[j] * (1 + Eigen::NumTraits<Scalar>::dummy_precision()));
+
+		auto exactNearest = structure.nearest_neighbor(i);
+		const int e = *exactNearest.begin();
+		for (int j : structure.nearest_neighbor(i, eps))
+		{
+			VERIFY((points[j].pos() - points[i].pos()).norm() <=
+			       (1 + eps) * (points[e].pos() - points[i].pos()).norm() * (1 + Eigen::NumTraits<Scalar>::dummy_precision()));
+		}
+
+		// the search stops after the leaf budget
+		auto budget = structure.k_nearest_neighbors(i, k, Scalar(0), 1);
+		int count = 0;
+		for (int j : budget)
+		{
+			VERIFY(j != i);
+			++count;
+		}
+		VERIFY(budget.leaf_visits() == 1 && count > 0);
+	}
+}
+
+template<typename DataPoint>
+void testKdTreeKNearestRange(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 100 : 10000;
+	const int k = quick ? 5 : 15;
+	auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	KdTree<DataPoint> structure(points);
+
+#pragma omp parallel for
+	for (int i = 0; i < N; ++i)
+	{
+		// same neighbors as the k nearest neighbors filtered by the radius
+		const Scalar r = Eigen::internal::random<Scalar>(0., 0.2);
+		const VectorType point = VectorType::Random();
+		std::vector<int> results, expected;
+		for (int j : structure.k_nearest_range_neighbors(point, k, r))
+			results.push_back(j);
+		for (int j : structure.k_nearest_neighbors(point, k))
+			if ((points[j].pos() - point).squaredNorm() < r * r)
+				expected.push_back(j);
+		VERIFY(results == expected);
+
+		results.clear();
+		expected.clear();
+		for (int j : structure.k_nearest_range_neighbors(i, k, r))
+			results.push_back(j);
+		for (int j : structure.k_nearest_neighbors(i, k))
+			if ((points[j].pos() - points[i].pos()).squaredNorm() < r * r)
+				expected.push_back(j);
+		VERIFY(results == expected);
+	}
+}
+
+template<typename DataPoint>
+void testKdTreeKNearestDual(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 100 : 10000;
+	const int k = quick ? 5 : 15;
+	auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+	auto sourcePoints = VectorContainer(N);
+    std::generate(sourcePoints.begin(), sourcePoints.end(), []() {return DataPoint(VectorType::Random()); });
+	std::vector<VectorType> queries(N);
+	std::transform(sourcePoints.begin(), sourcePoints.end(), queries.begin(), [](const DataPoint& p) { return p.pos(); });
+
+	KdTree<DataPoint> target(points);
+	std::vector<int> expected(N * k);
+	std::vector<Scalar> expectedDistances(N * k);
+	target.k_nearest_neighbors_batch(queries, k, expected.data(), expectedDistances.data());
+
+	// same output as the batched single-tree queries
+	KdTree<DataPoint> source(sourcePoints);
+	std::vector<int> indices(N * k);
+	std::vector<Scalar> distances(N * k);
+	target.k_nearest_neighbors_dual(source, k, indices.data(), distances.data());
+	VERIFY(indices == expected);
+	VERIFY(distances == expectedDistances);
+
+	// source with another node type, indexing half of its points
+	std::vector<int> sampling;
+	for (int i = 0; i < N; i += 2)
+		sampling.push_back(i);
+	KdTree<DataPoint, KdTreeWideNode<Scalar>> sampledSource(sourcePoints, sampling);
+	std::fill(indices.begin(), indices.end(), -2);
+	target.k_nearest_neighbors_dual(sampledSource, k, indices.data());
+	for (int i = 0; i < N; ++i)
+	{
+		for (int j = 0; j < k; ++j)
+			VERIFY(indices[i*k + j] == (i % 2 == 0 ? expected[i*k + j] : -2));
+	}
+}
+
+template<typename DataPoint>
+void testKdTreeKNearestWarmStart(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 100 : 10000;
+	const int k = quick ? 5 : 15;
+	auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+	std::vector<VectorType> queries(N);
+	std::generate(queries.begin(), queries.end(), []() {return VectorType::Random(); });
+
+	KdTree<DataPoint> structure(points);
+
+	// permutation of the queries, sorted by leaf
+	const auto order = structure.leaf_order(queries);
+	auto sorted = order;
+	std::sort(sorted.begin(), sorted.end());
+	for (int i = 0; i < N; ++i)
+		VERIFY(sorted[i] == i);
+	for (int n = 1; n < N; ++n)
+		VERIFY(structure.node_data()[structure.find_leaf(queries[order[n-1]])].start <=
+		       structure.node_data()[structure.find_leaf(queries[order[n]])].start);
+
+	// same neighbors with warm start
+	auto query = structure.k_nearest_neighbors(VectorType::Zero().eval(), k);
+	auto nearest = structure.nearest_neighbor(0);
+	query.set_warm_start(true);
+	nearest.set_warm_start(true);
+	for (int n = 0; n < N; ++n)
+	{
+		const int i = order[n];
+		std::vector<int> results, expected;
+		for (int j : query(queries[i]))
+			results.push_back(j);
+		for (int j : structure.k_nearest_neighbors(queries[i], k))
+			expected.push_back(j);
+		VERIFY(results == expected);
+
+		for (int j : nearest(n))
+			VERIFY((check_nearest_neighbor<Scalar, VectorContainer>(points, n, j)));
+	}
+
+	// the path of the previous search is checked against the rebuilt tree, also resumed by the best-first traversal
+	structure.set_min_cell_size(8);
+	structure.build(VectorContainer(points.begin(), points.begin() + N/2));
+	query.set_traversal(KdTreeTraversal::BestFirst);
+	for (int n = 0; n < N; ++n)
+	{
+		const VectorType& point = queries[order[n]];
+		std::vector<Scalar> results, expected;
+		for (int j : query(point))
+			results.push_back((points[j].pos() - point).squaredNorm());
+		for (int j : structure.k_nearest_neighbors(point, k))
+			expected.push_back((points[j].pos() - point).squaredNorm());
+		VERIFY(results == expected);
+	}
+}
+
+template<typename DataPoint>
+void testKdTreeKNearestBestFirst(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 100 : 10000;
+	auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	KdTree<DataPoint> structure(points);
+
+	// equidistant neighbors may be returned in any order: compare the distances to the query point
+	const auto distances = [&points](auto& query, const VectorType& point) {
+		std::vector<Scalar> result;
+		for (int j : query)
+			result.push_back((points[j].pos() - point).squaredNorm());
+		return result;
+	};
+
+	for (int k : {1, 16, 64})
+	{
+#pragma omp parallel for
+		for (int i = 0; i < N; ++i)
+		{
+			// same neighbors as the depth-first traversal, scanning at most the same leaves
+			auto depthFirst = structure.k_nearest_neighbors(i, k);
+			auto bestFirst = structure.k_nearest_neighbors(i, k);
+			bestFirst.set_traversal(KdTreeTraversal::BestFirst);
+			const std::vector<Scalar> expected = distances(depthFirst, points[i].pos());
+			VERIFY(distances(bestFirst, points[i].pos()) == expected);
+			VERIFY(bestFirst.leaf_visits() <= depthFirst.leaf_visits());
+
+			VectorType point = VectorType::Random();
+			auto pointQuery = structure.k_nearest_neighbors(point, k);
+			const std::vector<Scalar> pointExpected = distances(pointQuery, point);
+			pointQuery.set_traversal(KdTreeTraversal::BestFirst);
+			VERIFY(distances(pointQuery, point) == pointExpected);
+		}
+	}
+}
+
 int main(int argc, char** argv)
 {
 	if (!init_testing(argc, argv))
@@ -98,4 +440,36 @@ int main(int argc, char** argv)
 	testKdTreeKNearestIndex<TestPoint<float, 4>>(false);
 	testKdTreeKNearestIndex<TestPoint<double, 4>>(false);
 	testKdTreeKNearestIndex<TestPoint<long double, 4>>(false);
+
+    cout << "Test KNearest batch in 3D..." << endl;
+	testKdTreeKNearestBatch<TestPoint<float, 3>>(false);
+	testKdTreeKNearestBatch<TestPoint<double, 3>>(false);
+
+    cout << "Test KNearest batch in 4D..." << endl;
+	testKdTreeKNearestBatch<TestPoint<float, 4>>(false);
+	testKdTreeKNearestBatch<TestPoint<double, 4>>(false);
+
+    cout << "Test KNearest with fixed-size queues in 3D..." << endl;
+	testKdTreeKNearestStatic<TestPoint<float, 3>>(false);
+	testKdTreeKNearestStatic<TestPoint<double, 3>>(false);
+
+    cout << "Test approximate KNearest in 3D..." << endl;
+	testKdTreeKNearestApproximate<TestPoint<float, 3>>(false);
+	testKdTreeKNearestApproximate<TestPoint<double, 3>>(false);
+
+    cout << "Test KNearest within a radius in 3D..." << endl;
+	testKdTreeKNearestRange<TestPoint<float, 3>>(false);
+	testKdTreeKNearestRange<TestPoint<double, 3>>(false);
+
+    cout << "Test dual-tree KNearest in 3D..." << endl;
+	testKdTreeKNearestDual<TestPoint<float, 3>>(false);
+	testKdTreeKNearestDual<TestPoint<double, 3>>(false);
+
+    cout << "Test KNearest with warm start in 3D..." << endl;
+	testKdTreeKNearestWarmStart<TestPoint<float, 3>>(false);
+	testKdTreeKNearestWarmStart<TestPoint<double, 3>>(false);
+
+    cout << "Test best-first KNearest in 3D..." << endl;
+	testKdTreeKNearestBestFirst<TestPoint<float, 3>>(false);
+	testKdTreeKNearestBestFirst<TestPoint<double, 3>>(false);
 }
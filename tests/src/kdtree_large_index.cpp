@@ -0,0 +1,138 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/kdtree_large_index.cpp
+    \brief Test the KdTree with 64-bit indices (KdTreeLargeNode) against the default KdTree
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <cstdint>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+// the default trees keep the compact 32-bit indices
+static_assert(std::is_same<KdTree<PointPosition<float, 3>>::IndexType, int>::value, "");
+static_assert(std::is_same<KdTree<PointPosition<float, 3>, KdTreeWideNode<float>>::IndexType, int>::value, "");
+static_assert(std::is_same<KdTree<PointPosition<float, 3>, KdTreeLargeNode<float>>::IndexType, std::int64_t>::value, "");
+static_assert(sizeof(KdTreeLargeNode<float>) == sizeof(KdTreeWideNode<float>), "");
+static_assert(std::is_same<decltype(*KdTree<PointPosition<float, 3>, KdTreeLargeNode<float>>().nearest_neighbor(0).begin()),
+                           std::int64_t>::value, "");
+
+template<typename Range>
+vector<std::int64_t> collect(Range&& range)
+{
+    vector<std::int64_t> result;
+    for (auto j : range)
+        result.push_back(j);
+    return result;
+}
+
+template<typename DataPoint>
+void testQueries(KDTREE_SPLIT_STRATEGY strategy, bool leafPositions, bool quantized)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef KdTree<DataPoint> Tree;
+    typedef KdTree<DataPoint, KdTreeLargeNode<Scalar>> LargeTree;
+    typedef typename LargeTree::IndexType Index;
+
+    const int n = Eigen::internal::random<int>(500, 5000), k = Eigen::internal::random<int>(1, 20);
+    const Scalar r = Eigen::internal::random<Scalar>(0.05, 0.3);
+    vector<DataPoint> points(n);
+    std::generate(points.begin(), points.end(), []() { return DataPoint(VectorType::Random()); });
+
+    const auto configure = [&](auto& tree) {
+        tree.set_split_strategy(strategy);
+        tree.set_use_leaf_positions(leafPositions);
+        tree.set_use_quantized_positions(quantized);
+        tree.build(points);
+    };
+    Tree tree;
+    LargeTree large;
+    configure(tree);
+    configure(large);
+    VERIFY(large.valid() && large.point_count() == Index(n) && large.index_count() == Index(n));
+
+    // same splits: the nodes and indices match
+    VERIFY(large.node_count() == tree.node_count());
+    VERIFY(std::equal(tree.index_data().begin(), tree.index_data().end(), large.index_data().begin()));
+
+    for (int q = 0; q < 50; ++q)
+    {
+        const VectorType p = VectorType::Random();
+        const int i = Eigen::internal::random<int>(0, n - 1);
+        VERIFY(*large.nearest_neighbor(p).begin() == *tree.nearest_neighbor(p).begin());
+        VERIFY(*large.nearest_neighbor(Index(i)).begin() == *tree.nearest_neighbor(i).begin());
+        VERIFY(collect(large.k_nearest_neighbors(p, k)) == collect(tree.k_nearest_neighbors(p, k)));
+        VERIFY(collect(large.k_nearest_neighbors(Index(i), k)) == collect(tree.k_nearest_neighbors(i, k)));
+        VERIFY(collect(large.template k_nearest_neighbors<8>(p)) == collect(tree.template k_nearest_neighbors<8>(p)));
+        VERIFY(collect(large.k_nearest_range_neighbors(p, k, r)) == collect(tree.k_nearest_range_neighbors(p, k, r)));
+        VERIFY(collect(large.range_neighbors(p, r)) == collect(tree.range_neighbors(p, r)));
+        VERIFY(collect(large.range_neighbors(Index(i), r)) == collect(tree.range_neighbors(i, r)));
+        const typename Tree::Aabb box(p, p + VectorType::Constant(r));
+        VERIFY(collect(large.box_neighbors(box)) == collect(tree.box_neighbors(box)));
+    }
+
+    // batches
+    vector<VectorType> positions(200);
+    std::generate(positions.begin(), positions.end(), []() { return VectorType(VectorType::Random()); });
+    vector<int> indices(positions.size() * k);
+    vector<Index> largeIndices(positions.size() * k);
+    tree.k_nearest_neighbors_batch(positions, k, indices.data());
+    large.k_nearest_neighbors_batch(positions, k, largeIndices.data());
+    VERIFY(std::equal(indices.begin(), indices.end(), largeIndices.begin()));
+
+    vector<std::size_t> offsets, largeOffsets;
+    typename Tree::IndexContainer neighbors;
+    typename LargeTree::IndexContainer largeNeighbors;
+    tree.range_neighbors_batch(positions, r, offsets, neighbors);
+    large.range_neighbors_batch(positions, r, largeOffsets, largeNeighbors);
+    VERIFY(offsets == largeOffsets && std::equal(neighbors.begin(), neighbors.end(), largeNeighbors.begin()));
+
+    // the files store 64-bit indices, and are not readable by the default trees
+    ostringstream out;
+    VERIFY(large.save(out, true));
+    istringstream in(out.str());
+    LargeTree loaded;
+    VERIFY(loaded.load(in) && loaded.valid() && loaded.index_data() == large.index_data());
+    istringstream again(out.str());
+    VERIFY(!tree.load(again));
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPosition<Scalar, 3> Point;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testQueries<Point>(SPLIT_MIDPOINT, false, false) ));
+        CALL_SUBTEST(( testQueries<Point>(SPLIT_MORTON, true, false) ));
+        CALL_SUBTEST(( testQueries<Point>(SPLIT_SAH, false, true) ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the KdTree with 64-bit indices..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,128 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/kdtree_normal_orientation.cpp
+    \brief Test the propagation of the normal orientation over the k-nearest neighbors graph
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTreeNormalOrientation.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+// Points of spheres of unit radius, centered at `centers`, with randomly flipped normals
+template<typename DataPoint>
+void randomSpheres(const vector<typename DataPoint::VectorType>& centers, int n,
+                   vector<DataPoint>& points, vector<typename DataPoint::VectorType>& normals)
+{
+    for (const auto& center : centers)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            points.push_back(getPointOnSphere<DataPoint>(1, center, false, false, false));
+            normals.push_back(Eigen::internal::random<int>(0, 1) == 0 ? points.back().normal()
+                                                                      : -points.back().normal());
+        }
+    }
+}
+
+template<typename DataPoint>
+void testSpheres(int sphereCount)
+{
+    typedef typename DataPoint::VectorType VectorType;
+    const int n = 5000;
+
+    vector<VectorType> centers;
+    for (int s = 0; s < sphereCount; ++s)
+        centers.push_back(VectorType::Random() + VectorType::UnitX() * (10 * s));
+
+    vector<DataPoint> points;
+    vector<VectorType> normals;
+    randomSpheres(centers, n, points, normals);
+    KdTree<DataPoint> tree(points);
+
+    const int components = orient_normals(tree, 16, normals);
+    VERIFY(components == sphereCount);
+
+    // outward normals, the normal of the highest point of each sphere being oriented upwards
+    for (int i = 0; i < int(points.size()); ++i)
+        VERIFY(normals[i].dot(points[i].pos() - centers[i / n]) > 0);
+}
+
+template<typename DataPoint>
+void testPlane()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    const int n = 10000;
+
+    vector<DataPoint> points;
+    vector<VectorType> normals;
+    for (int i = 0; i < n; ++i)
+    {
+        VectorType p = VectorType::Random();
+        p.z() = Scalar(0);
+        points.push_back(DataPoint(p));
+        normals.push_back(VectorType::UnitZ() * Scalar(Eigen::internal::random<int>(0, 1) * 2 - 1));
+    }
+    KdTree<DataPoint> tree(points);
+
+    VERIFY(orient_normals(tree, 8, normals) == 1);
+    for (const auto& normal : normals)
+        VERIFY(normal == VectorType::UnitZ());
+}
+
+template<typename DataPoint>
+void testDegenerate()
+{
+    typedef typename DataPoint::VectorType VectorType;
+
+    // empty tree
+    vector<DataPoint> points;
+    vector<VectorType> normals;
+    KdTree<DataPoint> empty(points);
+    VERIFY(orient_normals(empty, 8, normals) == 0);
+
+    // single point, oriented upwards
+    points.push_back(DataPoint(VectorType::Zero(), -VectorType::UnitZ()));
+    normals.push_back(-VectorType::UnitZ());
+    KdTree<DataPoint> single(points);
+    VERIFY(orient_normals(single, 8, normals) == 1);
+    VERIFY(normals[0] == VectorType::UnitZ());
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testSpheres<Point>(1) ));
+        CALL_SUBTEST(( testSpheres<Point>(3) ));
+        CALL_SUBTEST(( testPlane<Point>() ));
+        CALL_SUBTEST(( testDegenerate<Point>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the normal orientation over the KdTree graph..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
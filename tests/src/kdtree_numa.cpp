@@ -0,0 +1,117 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/kdtree_numa.cpp
+    \brief Test the NUMA replicated and interleaved KdTree batched queries against the KdTree ones
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTreeNuma.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+void testTopology()
+{
+    VERIFY(( internal::parse_cpu_list("0-3,8,10-11\n") == vector<int>{0, 1, 2, 3, 8, 10, 11} ));
+    VERIFY(internal::parse_cpu_list("").empty());
+
+    const NumaTopology topology = NumaTopology::detect();
+    VERIFY(topology.node_count() >= 1);
+    VERIFY(int(topology.node_ids.size()) == topology.node_count());
+    for (const vector<int>& cpus : topology.node_cpus)
+        VERIFY(!cpus.empty());
+
+    // the threads alternate between the nodes
+    NumaTopology two;
+    two.node_ids = {0, 1};
+    two.node_cpus = {{0, 1}, {2, 3}};
+    int node, cpu;
+    two.placement(0, node, cpu); VERIFY(node == 0 && cpu == 0);
+    two.placement(1, node, cpu); VERIFY(node == 1 && cpu == 2);
+    two.placement(2, node, cpu); VERIFY(node == 0 && cpu == 1);
+    two.placement(5, node, cpu); VERIFY(node == 1 && cpu == 2);
+}
+
+template<typename DataPoint>
+void testBatches(KDTREE_NUMA_POLICY policy)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef KdTreeNumaReplicas<DataPoint> Replicas;
+
+    const int n = Eigen::internal::random<int>(1000, 10000), queries = 2000, k = Eigen::internal::random<int>(1, 20);
+    const Scalar r = Eigen::internal::random<Scalar>(0.05, 0.2);
+    vector<DataPoint> points(n);
+    std::generate(points.begin(), points.end(), []() { return DataPoint(VectorType::Random()); });
+    vector<VectorType> positions(queries);
+    std::generate(positions.begin(), positions.end(), []() { return VectorType(VectorType::Random()); });
+    KdTree<DataPoint> tree(points);
+
+    // two nodes sharing the CPUs of the process, so that the replicas are tested on any machine
+    const NumaTopology machine = NumaTopology::detect();
+    NumaTopology topology;
+    topology.node_ids = {machine.node_ids[0], machine.node_ids[0]};
+    topology.node_cpus = {machine.node_cpus[0], machine.node_cpus[0]};
+#if defined(__linux__)
+    cpu_set_t before, after;
+    sched_getaffinity(0, sizeof(before), &before);
+#endif
+    const Replicas replicas(tree, policy, topology);
+    VERIFY(replicas.replica_count() == (policy == NUMA_REPLICATE ? 2 : 0));
+    VERIFY(replicas.replica(1).point_count() == n && replicas.replica(1).valid());
+
+    vector<int> indices(queries * k), expectedIndices(queries * k);
+    vector<Scalar> distances(queries * k), expectedDistances(queries * k);
+    replicas.k_nearest_neighbors_batch(positions, k, indices.data(), distances.data());
+    tree.k_nearest_neighbors_batch(positions, k, expectedIndices.data(), expectedDistances.data());
+    VERIFY(indices == expectedIndices && distances == expectedDistances);
+
+    vector<std::size_t> offsets, expectedOffsets;
+    vector<int> neighbors, expectedNeighbors;
+    vector<Scalar> rangeDistances, expectedRangeDistances;
+    replicas.range_neighbors_batch(positions, r, offsets, neighbors, &rangeDistances);
+    tree.range_neighbors_batch(positions, r, expectedOffsets, expectedNeighbors, &expectedRangeDistances);
+    VERIFY(offsets == expectedOffsets && neighbors == expectedNeighbors && rangeDistances == expectedRangeDistances);
+
+#if defined(__linux__)
+    // the threads are unpinned after the batches
+    sched_getaffinity(0, sizeof(after), &after);
+    VERIFY(CPU_EQUAL(&before, &after));
+#endif
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPosition<Scalar, 3> Point;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testBatches<Point>(NUMA_NONE) ));
+        CALL_SUBTEST(( testBatches<Point>(NUMA_REPLICATE) ));
+        CALL_SUBTEST(( testBatches<Point>(NUMA_INTERLEAVE) ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the NUMA placement of the KdTree..." << endl;
+    CALL_SUBTEST(( testTopology() ));
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,254 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+#include <Ponca/src/SpatialPartitioning/OutOfCore/outOfCoreTiling.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <thread>
+
+using namespace Ponca;
+
+template<typename DataPoint>
+void testOutOfCoreRange(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorType = typename DataPoint::VectorType;
+	using Tiling = OutOfCoreTiling<DataPoint>;
+
+	const int N = quick ? 1000 : 20000;
+	const Scalar halo = Scalar(0.1);
+	std::vector<DataPoint> points(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+	KdTree<DataPoint> reference(points);
+
+	// the points are streamed by chunks, as read from a file
+	const auto makeReader = [&points]()
+	{
+		return [&points, start = std::size_t(0)](std::vector<DataPoint>& chunk) mutable
+		{
+			const std::size_t end = std::min(points.size(), start + 333);
+			chunk.assign(points.begin() + start, points.begin() + end);
+			start = end;
+			return !chunk.empty();
+		};
+	};
+
+	const std::string directory = (std::filesystem::temp_directory_path() /
+	                               ("ponca_out_of_core_" + std::to_string(DataPoint::Dim) + "_" +
+	                                std::to_string(sizeof(Scalar)))).string();
+	std::filesystem::create_directories(directory);
+	{
+		const typename Tiling::Aabb bounds = Tiling::stream_bounds(makeReader());
+		VERIFY(bounds.contains(points[0].pos()));
+
+		// the last axis is not split
+		VectorType tileSize = VectorType::Constant(Scalar(0.5));
+		tileSize[DataPoint::Dim - 1] = Scalar(10);
+		Tiling tiling(bounds, tileSize, halo, directory);
+		VERIFY(tiling.grid_size()[0] == 4 && tiling.grid_size()[DataPoint::Dim - 1] == 1);
+
+		VERIFY(tiling.partition(makeReader(), 64) == std::uint64_t(N));
+		std::uint64_t stored = 0;
+		for(int id = 0; id < tiling.tile_count(); ++id)
+			stored += tiling.tile_point_count(id);
+		VERIFY(stored > std::uint64_t(N));
+
+		// the budget holds about two tiles
+		const std::size_t budget = Tiling::tile_memory(stored) * 2 / tiling.tile_count();
+		std::vector<int> coreCount(N, 0);
+		std::mutex mutex;
+		tiling.process([&](const typename Tiling::Tile& tile)
+		{
+			VERIFY(tile.tree.valid() && tile.tree.is_view());
+			for(int i = 0; i < tile.point_count(); ++i)
+			{
+				const int global = int(tile.indices[i]);
+				VERIFY(tile.points[i].pos() == points[global].pos());
+				if(!tile.is_core(i))
+					continue;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					++coreCount[global];
+				}
+
+				// the halo completes the neighborhoods of the core points
+				const Scalar r = Eigen::internal::random<Scalar>(0., halo);
+				std::vector<int> local, globalNeighbors;
+				for(int j : tile.tree.range_neighbors(i, r))
+					local.push_back(int(tile.indices[j]));
+				for(int j : reference.range_neighbors(global, r))
+					globalNeighbors.push_back(j);
+				std::sort(local.begin(), local.end());
+				std::sort(globalNeighbors.begin(), globalNeighbors.end());
+				VERIFY(local == globalNeighbors);
+			}
+		}, budget, 16);
+
+		// each point is a core point of exactly one tile, and the files are deleted
+		VERIFY(std::all_of(coreCount.begin(), coreCount.end(), [](int c) { return c == 1; }));
+		for(int id = 0; id < tiling.tile_count(); ++id)
+			VERIFY(!std::filesystem::exists(tiling.tile_filename(id)));
+	}
+	std::filesystem::remove_all(directory);
+}
+
+template<typename Range>
+std::vector<std::uint64_t> sortedIndices(Range&& range)
+{
+	std::vector<std::uint64_t> result;
+	for(int j : range)
+		result.push_back(std::uint64_t(j));
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+/// Queries and batch fits submitted before and during the processing, answered as the tiles are loaded
+template<typename Scalar>
+void testOutOfCoreAsync(int loaderCount)
+{
+	using DataPoint = PointPosition<Scalar, 3>;
+	using VectorType = typename DataPoint::VectorType;
+	using Tiling = OutOfCoreTiling<DataPoint>;
+	using Fit = Basket<DataPoint, DistWeightFunc<DataPoint, SmoothWeightKernel<Scalar>>, CovariancePlaneFit>;
+
+	const int N = 20000, k = 8;
+	const Scalar halo = Scalar(0.1), r = Scalar(0.08);
+	std::vector<DataPoint> points(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+	const KdTree<DataPoint> reference(points);
+
+	const std::string directory = (std::filesystem::temp_directory_path() /
+	                               ("ponca_out_of_core_async_" + std::to_string(sizeof(Scalar)))).string();
+	std::filesystem::create_directories(directory);
+	{
+		typename Tiling::Aabb bounds;
+		for(const DataPoint& p : points)
+			bounds.extend(p.pos());
+		Tiling tiling(bounds, VectorType::Constant(Scalar(0.5)), halo, directory);
+		tiling.partition([&points, done = false](std::vector<DataPoint>& chunk) mutable
+		{
+			chunk.assign(points.begin(), done ? points.begin() : points.end());
+			done = true;
+			return !chunk.empty();
+		});
+
+		// the fits of a batch of points, each one on its tile
+		const auto fit = [r](const typename Tiling::Tile& tile, const VectorType& p)
+		{
+			Fit f;
+			f.setWeightFunc({r});
+			f.init(p);
+			for(int j : tile.tree.range_neighbors(p, r))
+				f.addNeighbor(tile.points[j]);
+			f.finalize();
+			return f.isStable() ? VectorType(f.primitiveGradient(p).normalized()) : VectorType(VectorType::Zero());
+		};
+
+		std::vector<VectorType> queries(200);
+		for(VectorType& q : queries)
+			q = VectorType::Random();
+		std::vector<std::future<std::vector<std::uint64_t>>> ranges, knns;
+		for(const VectorType& q : queries)
+		{
+			ranges.push_back(tiling.async_range_neighbors(q, r));
+			knns.push_back(tiling.async_k_nearest_neighbors(q, k));
+		}
+		auto fits = tiling.async_batch(queries, fit);
+		VERIFY(tiling.pending_query_count() > 0);
+		VERIFY(ranges[0].wait_for(std::chrono::seconds(0)) == std::future_status::timeout);
+
+		// the resident tiles answer at once
+		std::atomic<int> immediate{0};
+		std::mutex mutex;
+		const std::size_t budget = Tiling::tile_memory(N) / 4;
+		tiling.process_pipelined([&](const typename Tiling::Tile& tile)
+		{
+			VERIFY(tile.tree.valid());
+			for(int i = 0; i < tile.point_count(); i += 97)
+			{
+				if(!tile.is_core(i))
+					continue;
+				auto range = tiling.async_range_neighbors(tile.points[i].pos(), r);
+				immediate += range.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+				const std::vector<std::uint64_t> neighbors = range.get();
+				std::lock_guard<std::mutex> lock(mutex);
+				VERIFY(neighbors.size() == sortedIndices(reference.range_neighbors(tile.points[i].pos(), r)).size());
+			}
+		}, budget, loaderCount, 16);
+		VERIFY(immediate > 0);
+		VERIFY(tiling.pending_query_count() == 0);
+
+		const std::vector<VectorType> normals = fits.get();
+		for(int i = 0; i < int(queries.size()); ++i)
+		{
+			std::vector<std::uint64_t> neighbors = ranges[i].get();
+			std::sort(neighbors.begin(), neighbors.end());
+			VERIFY(neighbors == sortedIndices(reference.range_neighbors(queries[i], r)));
+
+			// exact when the k-th neighbor is closer than the halo
+			std::vector<std::uint64_t> nearest = knns[i].get();
+			const std::vector<std::uint64_t> expected = sortedIndices(reference.k_nearest_neighbors(queries[i], k));
+			std::sort(nearest.begin(), nearest.end());
+			bool inHalo = true;
+			for(std::uint64_t j : expected)
+				inHalo = inHalo && (points[j].pos() - queries[i]).norm() < halo;
+			VERIFY(!inHalo || nearest == expected);
+
+			Fit f;
+			f.setWeightFunc({r});
+			f.init(queries[i]);
+			for(int j : reference.range_neighbors(queries[i], r))
+				f.addNeighbor(points[j]);
+			f.finalize();
+			if(f.isStable())
+				VERIFY(Scalar(1) - std::abs(normals[i].dot(f.primitiveGradient(queries[i]).normalized())) <= testEpsilon<Scalar>());
+			else
+				VERIFY(normals[i].isZero());
+		}
+
+		// the processed tiles are evicted
+		auto late = tiling.async_range_neighbors(queries[0], r);
+		bool failed = false;
+		try { late.get(); }
+		catch(const std::logic_error&) { failed = true; }
+		VERIFY(failed);
+	}
+	std::filesystem::remove_all(directory);
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Test out-of-core tiling in 3D..." << endl;
+	testOutOfCoreRange<TestPoint<float, 3>>(false);
+	testOutOfCoreRange<TestPoint<double, 3>>(false);
+
+	cout << "Test out-of-core tiling in 4D..." << endl;
+	testOutOfCoreRange<TestPoint<float, 4>>(false);
+	testOutOfCoreRange<TestPoint<double, 4>>(false);
+
+	cout << "Test asynchronous out-of-core queries..." << endl;
+	testOutOfCoreAsync<float>(1);
+	testOutOfCoreAsync<double>(2);
+}
@@ -0,0 +1,130 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/progressiveKdTree.h>
+
+using namespace Ponca;
+
+/// Check the queries of each level of `structure` against a brute force search over the points of the level
+template<typename DataPoint, typename Tree>
+void checkLevelQueries(const Tree& structure, int queryCount)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorType = typename DataPoint::VectorType;
+	using VectorContainer = typename Tree::PointContainer;
+	const auto& points = structure.point_data();
+
+	for (int l = 0; l < structure.level_count(); ++l)
+	{
+		const int size = structure.level_size(l);
+		VERIFY(l == 0 || structure.level_size(l-1) <= size);
+		std::vector<int> sampling(structure.order().begin(), structure.order().begin() + size);
+		for (int idx : sampling)
+			VERIFY(structure.point_level(idx) >= 0 && structure.point_level(idx) <= l);
+
+		VectorContainer levelPoints;
+		for (int idx : sampling)
+			levelPoints.push_back(points[idx]);
+
+#pragma omp parallel for
+		for (int q = 0; q < queryCount; ++q)
+		{
+			const VectorType point = VectorType::Random();
+			const Scalar r = Eigen::internal::random<Scalar>(0., 0.5);
+
+			std::vector<int> results;
+			for (int j : structure.range_neighbors(point, r, l))
+			{
+				VERIFY(structure.point_level(j) <= l);
+				results.push_back(j);
+			}
+			VERIFY((check_range_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, point, r, results)));
+
+			// k-nearest neighbors, compared in the numbering of the level points
+			const int k = std::min(8, size);
+			results.clear();
+			for (int j : structure.k_nearest_neighbors(point, k, l))
+				results.push_back(int(std::find(sampling.begin(), sampling.end(), j) - sampling.begin()));
+			VERIFY((check_k_nearest_neighbors<Scalar, VectorType, VectorContainer>(levelPoints, point, k, results)));
+		}
+	}
+}
+
+template<typename DataPoint>
+void testProgressiveKdTreeRandom(bool quick = true)
+{
+	using VectorType = typename DataPoint::VectorType;
+	using Tree = ProgressiveKdTree<DataPoint>;
+
+	const int N = quick ? 500 : 5000;
+	typename Tree::PointContainer points(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	Tree structure;
+	structure.set_min_cell_size(16);
+	structure.build(points, 4);
+	VERIFY(structure.level_count() == 4);
+	VERIFY(structure.level_size(3) == N && structure.level_size(2) == N / 4 && structure.level_size(0) == N / 64);
+	for (int i = 0; i < N; ++i)
+		VERIFY(structure.point_level(i) >= 0);
+
+	// the trees point to the moved points
+	Tree moved(std::move(structure));
+	checkLevelQueries<DataPoint>(moved, quick ? 10 : 100);
+}
+
+template<typename DataPoint>
+void testProgressiveKdTreePoissonDisk(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorType = typename DataPoint::VectorType;
+	using Tree = ProgressiveKdTree<DataPoint>;
+
+	const int N = quick ? 500 : 5000;
+	typename Tree::PointContainer points(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	const std::vector<Scalar> radii {Scalar(0.4), Scalar(0.2), Scalar(0.1), Scalar(0)};
+	typename Tree::IndexContainer order;
+	std::vector<int> sizes;
+	Tree::poisson_disk_levels(points, radii, order, sizes);
+	VERIFY(sizes.size() == radii.size() && sizes.back() == N && int(order.size()) == N && !has_duplicate(order));
+
+	// the points of each level are farther than its radius from each other
+	for (std::size_t l = 0; l + 1 < radii.size(); ++l)
+		for (int i = 0; i < sizes[l]; ++i)
+			for (int j = i + 1; j < sizes[l]; ++j)
+				VERIFY((points[order[i]].pos() - points[order[j]].pos()).norm() >= radii[l]);
+
+	Tree structure;
+	structure.set_min_cell_size(16);
+	structure.build(points, order, sizes);
+	checkLevelQueries<DataPoint>(structure, quick ? 10 : 100);
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Test ProgressiveKdTree random levels in 3D..." << endl;
+	testProgressiveKdTreeRandom<TestPoint<float, 3>>(false);
+	testProgressiveKdTreeRandom<TestPoint<double, 3>>(false);
+
+	cout << "Test ProgressiveKdTree Poisson-disk levels in 3D..." << endl;
+	testProgressiveKdTreePoissonDisk<TestPoint<float, 3>>(false);
+	testProgressiveKdTreePoissonDisk<TestPoint<double, 3>>(false);
+
+	cout << "Test ProgressiveKdTree random levels in 4D..." << endl;
+	testProgressiveKdTreeRandom<TestPoint<double, 4>>(false);
+}
@@ -0,0 +1,92 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTreeQueryContext.h>
+
+using namespace Ponca;
+
+template<typename DataPoint>
+void testKdTreeQueryContext(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorType = typename DataPoint::VectorType;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+
+	const int N = quick ? 1000 : 10000;
+	const int queryCount = quick ? 100 : 500;
+	const int kMax = 16;
+	VectorContainer points(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	std::vector<int> sampling(N);
+	std::iota(sampling.begin(), sampling.end(), 0);
+
+	KdTree<DataPoint> structure(points);
+
+#pragma omp parallel
+	{
+		KdTreeQueryContext<DataPoint> context(structure, kMax);
+		context.set_prefetch(true);
+		const auto* queue = &*context.k_nearest_neighbors(0, kMax).queue().begin();
+
+#pragma omp for
+		for (int q = 0; q < queryCount; ++q)
+		{
+			const int index = Eigen::internal::random<int>(0, N - 1);
+			const VectorType point = VectorType::Random();
+			const Scalar r = Eigen::internal::random<Scalar>(0., 0.5);
+			const int k = Eigen::internal::random<int>(1, kMax);
+
+			auto& knn = context.k_nearest_neighbors(point, k);
+			VERIFY((check_k_nearest_neighbors<Scalar, VectorType, VectorContainer>(points, point, k, context.collect(knn))));
+			VERIFY((check_k_nearest_neighbors<Scalar, VectorContainer>(points, index, k,
+			                                                           context.collect(context.k_nearest_neighbors(index, k)))));
+
+			// the buffers are reused from one query to the next
+			VERIFY(&*context.k_nearest_neighbors(index, k).queue().begin() == queue);
+
+			VERIFY((check_range_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, point, r,
+			                                                                   context.collect(context.range_neighbors(point, r)))));
+			VERIFY((check_range_neighbors<Scalar, VectorContainer>(points, sampling, index, r,
+			                                                       context.collect(context.range_neighbors(index, r)))));
+
+			for (int j : context.nearest_neighbor(point))
+				VERIFY((check_nearest_neighbor<Scalar, VectorType, VectorContainer>(points, point, j)));
+			for (int j : context.nearest_neighbor(index))
+				VERIFY((check_nearest_neighbor<Scalar, VectorContainer>(points, index, j)));
+
+			// k-nearest neighbors within a radius: the first neighbors of the range query
+			const std::vector<int>& ranged = context.collect(context.k_nearest_range_neighbors(point, k, r));
+			VERIFY(int(ranged.size()) <= k && !has_duplicate(ranged));
+			for (int j : ranged)
+				VERIFY((points[j].pos() - point).norm() <= r);
+			const std::vector<int> reference = context.collect(context.k_nearest_neighbors(point, k));
+			for (std::size_t i = 0; i < ranged.size(); ++i)
+				VERIFY(std::find(reference.begin(), reference.end(), ranged[i]) != reference.end());
+			VERIFY(int(context.collect(context.k_nearest_range_neighbors(index, k, r)).size()) <= k);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Test KdTreeQueryContext in 3D..." << endl;
+	testKdTreeQueryContext<TestPoint<float, 3>>(false);
+	testKdTreeQueryContext<TestPoint<double, 3>>(false);
+
+	cout << "Test KdTreeQueryContext in 4D..." << endl;
+	testKdTreeQueryContext<TestPoint<double, 4>>(false);
+}
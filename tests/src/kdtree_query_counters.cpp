@@ -0,0 +1,130 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/kdtree_query_counters.cpp
+    \brief Test the work counters of the KdTree queries, per query and per thread
+ */
+
+#define PCA_KDTREE_QUERY_COUNTERS 1
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+using namespace Ponca;
+
+/// Number of neighbors returned by a query, iterated once
+template<typename Query>
+std::size_t countNeighbors(Query& query)
+{
+	std::size_t count = 0;
+	for (int j : query)
+	{
+		(void)j;
+		++count;
+	}
+	return count;
+}
+
+/// Check the counters of a search returning `results` neighbors
+template<typename Query>
+void checkCounters(const Query& query, std::size_t results, int N)
+{
+	const KdTreeQueryCounters& counters = query.counters();
+	VERIFY(counters.results == results);
+	VERIFY(counters.leaves_scanned == std::uint64_t(query.leaf_visits()));
+	VERIFY(counters.leaves_scanned <= counters.nodes_popped);
+	VERIFY(counters.distance_evaluations <= std::uint64_t(N) * counters.leaves_scanned);
+}
+
+template<typename DataPoint>
+void testKdTreeQueryCounters(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorType = typename DataPoint::VectorType;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+
+	const int N = quick ? 1000 : 10000;
+	const int queryCount = quick ? 100 : 500;
+	VectorContainer points(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	KdTree<DataPoint> structure(points);
+
+	KdTreeQueryCounters total;
+#pragma omp parallel
+	{
+		kdtree_thread_query_counters() = KdTreeQueryCounters();
+		KdTreeQueryCounters expected;
+
+#pragma omp for
+		for (int q = 0; q < queryCount; ++q)
+		{
+			const int index = Eigen::internal::random<int>(0, N - 1);
+			const VectorType point = VectorType::Random();
+			const Scalar r = Eigen::internal::random<Scalar>(0., 0.5);
+			const int k = Eigen::internal::random<int>(1, 16);
+
+			auto knn = structure.k_nearest_neighbors(point, k);
+			std::size_t count = countNeighbors(knn);
+			VERIFY(int(count) == std::min(k, N));
+			checkCounters(knn, count, N);
+			// the leaves scanned hold the k-nearest neighbors
+			VERIFY(knn.counters().distance_evaluations >= count);
+			expected += knn.counters();
+
+			auto nearest = structure.nearest_neighbor(index);
+			count = countNeighbors(nearest);
+			checkCounters(nearest, count, N);
+			expected += nearest.counters();
+
+			// the counters of the range queries grow while their results are iterated
+			auto range = structure.range_neighbors(index, r);
+			count = 0;
+			for (auto it = range.begin(); it != range.end(); ++it)
+			{
+				++count;
+				VERIFY(range.counters().results == count);
+			}
+			checkCounters(range, count, N);
+			expected += range.counters();
+
+			auto box = structure.box_neighbors(Eigen::AlignedBox<Scalar, DataPoint::Dim>(point, point + VectorType::Constant(r)));
+			count = countNeighbors(box);
+			checkCounters(box, count, N);
+			expected += box.counters();
+		}
+
+		// the counters of the thread sum the counters of its queries
+		const KdTreeQueryCounters& thread = kdtree_thread_query_counters();
+		VERIFY(thread.nodes_popped == expected.nodes_popped);
+		VERIFY(thread.leaves_scanned == expected.leaves_scanned);
+		VERIFY(thread.distance_evaluations == expected.distance_evaluations);
+		VERIFY(thread.results == expected.results);
+#pragma omp critical
+		total += thread;
+	}
+	VERIFY(total.results >= std::uint64_t(queryCount) * 2);
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Test KdTree query counters in 3D..." << endl;
+	testKdTreeQueryCounters<TestPoint<float, 3>>(false);
+	testKdTreeQueryCounters<TestPoint<double, 3>>(false);
+
+	cout << "Test KdTree query counters in 4D..." << endl;
+	testKdTreeQueryCounters<TestPoint<double, 4>>(false);
+}
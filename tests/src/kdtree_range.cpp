@@ -83,6 +83,119 @@ void testKdTreeRangePoint(bool quick = true)
 	}
 }
 
+template<typename DataPoint>
+void testKdTreeRangeReuse(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 100 : 10000;
+	auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	std::vector<int> sampling(N);
+	std::iota(sampling.begin(), sampling.end(), 0);
+	KdTree<DataPoint> structure(points, sampling);
+
+#pragma omp parallel
+	{
+		// one query object per thread, rebound to each input
+		auto indexQuery = structure.range_neighbors(0, Scalar(0));
+		auto pointQuery = structure.range_neighbors(VectorType::Zero(), Scalar(0));
+#pragma omp for
+		for (int i = 0; i < N; ++i)
+		{
+			Scalar r = Eigen::internal::random<Scalar>(0., 0.5);
+			std::vector<int> results;
+			for (int j : indexQuery(i, r))
+				results.push_back(j);
+			VERIFY((check_range_neighbors<Scalar, VectorContainer>(points, sampling, i, r, results)));
+
+			// same radius, new input
+			VectorType point = VectorType::Random();
+			pointQuery.set_radius(r);
+			results.clear();
+			for (int j : pointQuery(point))
+				results.push_back(j);
+			VERIFY((check_range_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, point, r, results)));
+		}
+	}
+}
+
+template<typename DataPoint>
+void testKdTreeRangeDistances(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 100 : 10000;
+	auto points = VectorContainer(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	KdTree<DataPoint> structure(points);
+
+	const Scalar epsilon = testEpsilon<Scalar>();
+#pragma omp parallel for
+	for (int i = 0; i < N; ++i)
+	{
+		Scalar r = Eigen::internal::random<Scalar>(0., 0.5);
+		auto indexQuery = structure.range_neighbors(i, r);
+		for (auto it = indexQuery.begin(); it != indexQuery.end(); ++it)
+			VERIFY(std::abs(it.squared_distance() - (points[*it].pos() - points[i].pos()).squaredNorm()) <= epsilon);
+
+		VectorType point = VectorType::Random();
+		auto pointQuery = structure.range_neighbors(point, r);
+		for (auto it = pointQuery.begin(); it != pointQuery.end(); ++it)
+			VERIFY(std::abs(it.squared_distance() - (points[*it].pos() - point).squaredNorm()) <= epsilon);
+	}
+}
+
+template<typename DataPoint>
+void testKdTreeRangeBatch(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 100 : 10000;
+	const Scalar r = Scalar(0.1);
+	auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+	std::vector<VectorType> queries(N / 2);
+	std::generate(queries.begin(), queries.end(), []() {return VectorType::Random(); });
+
+	std::vector<int> sampling(N);
+	std::iota(sampling.begin(), sampling.end(), 0);
+
+	KdTree<DataPoint> structure(points);
+
+	std::vector<std::size_t> offsets, pointOffsets;
+	std::vector<int> neighbors, pointNeighbors;
+	std::vector<Scalar> distances;
+	structure.range_neighbors_batch(r, offsets, neighbors, &distances);
+	structure.range_neighbors_batch(queries, r, pointOffsets, pointNeighbors);
+	VERIFY(int(offsets.size()) == N + 1 && offsets.back() == neighbors.size() && neighbors.size() == distances.size());
+	VERIFY(pointOffsets.size() == queries.size() + 1 && pointOffsets.back() == pointNeighbors.size());
+
+#pragma omp parallel for
+	for (int i = 0; i < N; ++i)
+	{
+		std::vector<int> results(neighbors.begin() + offsets[i], neighbors.begin() + offsets[i+1]);
+		VERIFY((check_range_neighbors<Scalar, VectorContainer>(points, sampling, i, r, results)));
+		for (std::size_t j = offsets[i]; j < offsets[i+1]; ++j)
+			VERIFY(distances[j] == (points[neighbors[j]].pos() - points[i].pos()).squaredNorm());
+	}
+
+#pragma omp parallel for
+	for (int i = 0; i < int(queries.size()); ++i)
+	{
+		std::vector<int> results(pointNeighbors.begin() + pointOffsets[i], pointNeighbors.begin() + pointOffsets[i+1]);
+		VERIFY((check_range_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, queries[i], r, results)));
+	}
+}
+
 int main(int argc, char** argv)
 {
 	if (!init_testing(argc, argv))
@@ -109,4 +222,20 @@ int main(int argc, char** argv)
 	testKdTreeRangeIndex<TestPoint<float, 4>>(false);
 	testKdTreeRangeIndex<TestPoint<double, 4>>(false);
 	testKdTreeRangeIndex<TestPoint<long double, 4>>(false);
+
+    cout << "Test KdTreeRange batch in 3D..." << endl;
+	testKdTreeRangeBatch<TestPoint<float, 3>>(false);
+	testKdTreeRangeBatch<TestPoint<double, 3>>(false);
+
+    cout << "Test KdTreeRange batch in 4D..." << endl;
+	testKdTreeRangeBatch<TestPoint<float, 4>>(false);
+	testKdTreeRangeBatch<TestPoint<double, 4>>(false);
+
+    cout << "Test KdTreeRange query reuse in 3D..." << endl;
+	testKdTreeRangeReuse<TestPoint<float, 3>>(false);
+	testKdTreeRangeReuse<TestPoint<double, 3>>(false);
+
+    cout << "Test KdTreeRange squared distances in 3D..." << endl;
+	testKdTreeRangeDistances<TestPoint<float, 3>>(false);
+	testKdTreeRangeDistances<TestPoint<double, 3>>(false);
 }
@@ -0,0 +1,235 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+using namespace Ponca;
+
+/// Check that `query` returns exactly the points of `sampling` contained in its region
+template<typename DataPoint, typename Query>
+bool check_region_neighbors(const std::vector<DataPoint>& points, const std::vector<int>& sampling, Query& query)
+{
+	std::vector<int> results;
+	for (int j : query)
+		results.push_back(j);
+	if (has_duplicate(results))
+		return false;
+
+	std::vector<int> expected;
+	for (int j : sampling)
+		if (query.region().contains(points[j].pos()))
+			expected.push_back(j);
+
+	std::sort(results.begin(), results.end());
+	std::sort(expected.begin(), expected.end());
+	return results == expected;
+}
+
+template<typename DataPoint>
+void testKdTreeBox(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+	using MatrixType = typename BoxRegion<DataPoint>::MatrixType;
+	using Aabb = typename KdTree<DataPoint>::Aabb;
+
+	const int N = quick ? 100 : 10000;
+	auto points = VectorContainer(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	std::vector<int> indices(N);
+	std::vector<int> sampling(N / 2);
+	std::iota(indices.begin(), indices.end(), 0);
+	std::sample(indices.begin(), indices.end(), sampling.begin(), N / 2, std::mt19937(0));
+
+	KdTree<DataPoint> structure;
+	structure.set_min_cell_size(8);
+	structure.build(points, sampling);
+
+#pragma omp parallel for
+	for (int i = 0; i < 100; ++i)
+	{
+		const VectorType a = VectorType::Random(), b = VectorType::Random();
+		auto aligned = structure.box_neighbors(Aabb(a.cwiseMin(b), a.cwiseMax(b)));
+		VERIFY((check_region_neighbors(points, sampling, aligned)));
+
+		// random rotation from the QR decomposition of a random matrix
+		const MatrixType axes = Eigen::HouseholderQR<MatrixType>(MatrixType::Random()).householderQ();
+		const VectorType halfExtents = (VectorType::Random().array() + Scalar(1)) / Scalar(2);
+		auto oriented = structure.box_neighbors(BoxRegion<DataPoint>(VectorType::Random(), axes, halfExtents));
+		VERIFY((check_region_neighbors(points, sampling, oriented)));
+	}
+}
+
+template<typename DataPoint>
+void testKdTreeFrustum(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+	using Matrix4 = Eigen::Matrix<Scalar, 4, 4>;
+
+	const int N = quick ? 100 : 10000;
+	auto points = VectorContainer(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	std::vector<int> sampling(N);
+	std::iota(sampling.begin(), sampling.end(), 0);
+	KdTree<DataPoint> structure;
+	structure.set_min_cell_size(8);
+	structure.set_use_leaf_positions(true);
+	structure.build(points, sampling);
+
+	// OpenGL perspective projection
+	const Scalar n = Scalar(0.5), f = Scalar(4), t = n * std::tan(Scalar(0.5));
+	Matrix4 projection = Matrix4::Zero();
+	projection(0,0) = n / t;
+	projection(1,1) = n / t;
+	projection(2,2) = -(f + n) / (f - n);
+	projection(2,3) = Scalar(-2) * f * n / (f - n);
+	projection(3,2) = Scalar(-1);
+
+#pragma omp parallel for
+	for (int i = 0; i < 100; ++i)
+	{
+		// camera looking at a random point of the cloud
+		const VectorType eye = VectorType::Random() * Scalar(2);
+		const VectorType target = VectorType::Random() * Scalar(0.5);
+		const VectorType zAxis = (eye - target).normalized();
+		const VectorType xAxis = VectorType::UnitY().cross(zAxis).normalized();
+		const VectorType yAxis = zAxis.cross(xAxis);
+		Matrix4 view = Matrix4::Identity();
+		view.template block<1,3>(0,0) = xAxis.transpose();
+		view.template block<1,3>(1,0) = yAxis.transpose();
+		view.template block<1,3>(2,0) = zAxis.transpose();
+		view.template block<3,1>(0,3) = -view.template block<3,3>(0,0) * eye;
+
+		auto query = structure.frustum_neighbors(FrustumRegion<DataPoint>::from_view_projection(projection * view));
+		VERIFY((check_region_neighbors(points, sampling, query)));
+
+		// the planes match the clip cube
+		for (const auto& p : points)
+		{
+			const Eigen::Matrix<Scalar, 4, 1> clip = projection * view * p.pos().homogeneous();
+			const Scalar margin = Scalar(100) * std::numeric_limits<Scalar>::epsilon() * std::abs(clip(3));
+			const bool strict = (clip.template head<3>().cwiseAbs().array() <= clip(3) - margin).all();
+			const bool loose = (clip.template head<3>().cwiseAbs().array() <= clip(3) + margin).all();
+			const bool contained = query.region().contains(p.pos());
+			VERIFY(!strict || contained);
+			VERIFY(!contained || loose);
+		}
+	}
+}
+
+template<typename DataPoint>
+void testKdTreeRay(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 100 : 10000;
+	auto points = VectorContainer(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	std::vector<int> sampling(N);
+	std::iota(sampling.begin(), sampling.end(), 0);
+	KdTree<DataPoint> structure(points, sampling);
+
+#pragma omp parallel
+	{
+		// one query object per thread, rebound to each ray
+		auto query = structure.ray_neighbors(VectorType::Zero(), VectorType::UnitX(), Scalar(0));
+#pragma omp for
+		for (int i = 0; i < 100; ++i)
+		{
+			const Scalar r = Eigen::internal::random<Scalar>(0., 0.5);
+			const VectorType origin = VectorType::Random() * Scalar(2);
+			const VectorType direction = VectorType::Random();
+			VERIFY((check_region_neighbors(points, sampling, query(RayRegion<DataPoint>(origin, direction, r)))));
+
+			auto segment = structure.ray_neighbors(origin, direction, r, Eigen::internal::random<Scalar>(0., 2.));
+			VERIFY((check_region_neighbors(points, sampling, segment)));
+		}
+	}
+}
+
+template<typename DataPoint>
+void testKdTreeEllipsoid(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename KdTree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+	using MatrixType = typename EllipsoidRegion<DataPoint>::MatrixType;
+
+	const int N = quick ? 100 : 10000;
+	auto points = VectorContainer(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	std::vector<int> sampling(N);
+	std::iota(sampling.begin(), sampling.end(), 0);
+	KdTree<DataPoint> structure(points, sampling);
+
+#pragma omp parallel for
+	for (int i = 0; i < 100; ++i)
+	{
+		// symmetric positive definite metric
+		const MatrixType a = MatrixType::Random();
+		MatrixType metric = a * a.transpose();
+		metric.diagonal().array() += Scalar(0.1);
+		const VectorType center = VectorType::Random();
+		const Scalar r = Eigen::internal::random<Scalar>(0., 1.);
+
+		auto query = structure.ellipsoid_neighbors(center, metric, r);
+		VERIFY((check_region_neighbors(points, sampling, query)));
+
+		// the bounds of the ellipsoid contain it
+		for (int j : query)
+			VERIFY(query.region().bounds().contains(points[j].pos()));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+    cout << "Test KdTreeBoxQuery in 3D..." << endl;
+	testKdTreeBox<TestPoint<float, 3>>(false);
+	testKdTreeBox<TestPoint<double, 3>>(false);
+
+    cout << "Test KdTreeBoxQuery in 4D..." << endl;
+	testKdTreeBox<TestPoint<float, 4>>(false);
+	testKdTreeBox<TestPoint<double, 4>>(false);
+
+    cout << "Test KdTreeFrustumQuery in 3D..." << endl;
+	testKdTreeFrustum<TestPoint<float, 3>>(false);
+	testKdTreeFrustum<TestPoint<double, 3>>(false);
+
+    cout << "Test KdTreeRayQuery in 3D..." << endl;
+	testKdTreeRay<TestPoint<float, 3>>(false);
+	testKdTreeRay<TestPoint<double, 3>>(false);
+
+    cout << "Test KdTreeRayQuery in 4D..." << endl;
+	testKdTreeRay<TestPoint<float, 4>>(false);
+	testKdTreeRay<TestPoint<double, 4>>(false);
+
+    cout << "Test KdTreeEllipsoidQuery in 3D..." << endl;
+	testKdTreeEllipsoid<TestPoint<float, 3>>(false);
+	testKdTreeEllipsoid<TestPoint<double, 3>>(false);
+
+    cout << "Test KdTreeEllipsoidQuery in 4D..." << endl;
+	testKdTreeEllipsoid<TestPoint<float, 4>>(false);
+	testKdTreeEllipsoid<TestPoint<double, 4>>(false);
+}
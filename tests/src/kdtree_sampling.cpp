@@ -0,0 +1,219 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/kdtree_sampling.cpp
+    \brief Test the voxel grid, Poisson disk and curvature-adaptive downsamplings of the KdTree points
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTreeSampling.h>
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <set>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+using namespace Ponca;
+
+vector<int> randomSampling(int n)
+{
+    vector<int> sampling;
+    for (int i = 0; i < n; ++i)
+        if (Eigen::internal::random<int>(0, 4) != 0)
+            sampling.push_back(i);
+    return sampling;
+}
+
+template<typename DataPoint>
+void testVoxelGrid(VOXEL_SAMPLING_POINT selection)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef std::array<int, DataPoint::Dim> Cell;
+
+    const int n = Eigen::internal::random<int>(1000, 5000);
+    const Scalar cellSize = Eigen::internal::random<Scalar>(0.05, 0.5);
+    vector<DataPoint> points(n);
+    std::generate(points.begin(), points.end(), []() { return DataPoint(VectorType::Random()); });
+    const vector<int> indexed = randomSampling(n);
+    KdTree<DataPoint> tree(points, indexed);
+
+    vector<int> sampling;
+    vector<VectorType> centroids;
+    voxel_grid_sampling(tree, cellSize, sampling, selection, &centroids);
+
+    // brute force grouping of the indexed points, the grid starting at their lowest corner
+    VectorType origin = VectorType::Constant(std::numeric_limits<Scalar>::max());
+    for (int i : indexed)
+        origin = origin.cwiseMin(points[i].pos());
+    auto cellOf = [&](const VectorType& p) {
+        Cell cell;
+        for (int d = 0; d < DataPoint::Dim; ++d)
+            cell[d] = int(std::floor((p(d) - origin(d)) / cellSize));
+        return cell;
+    };
+    map<Cell, vector<int>> cells;
+    for (int i : indexed)
+        cells[cellOf(points[i].pos())].push_back(i);
+
+    VERIFY(sampling.size() == cells.size() && centroids.size() == cells.size());
+    const Scalar epsilon = testEpsilon<Scalar>() * 10;
+    set<Cell> sampledCells;
+    for (std::size_t s = 0; s < sampling.size(); ++s)
+    {
+        const Cell cell = cellOf(points[sampling[s]].pos());
+        VERIFY(sampledCells.insert(cell).second);
+        const vector<int>& members = cells[cell];
+
+        VectorType centroid = VectorType::Zero();
+        for (int i : members)
+            centroid += points[i].pos();
+        centroid /= Scalar(members.size());
+        VERIFY((centroid - centroids[s]).norm() < epsilon);
+
+        VectorType target = centroid;
+        if (selection == VOXEL_NEAREST_CENTER)
+            for (int d = 0; d < DataPoint::Dim; ++d)
+                target(d) = origin(d) + (Scalar(cell[d]) + Scalar(0.5)) * cellSize;
+        const Scalar selected = (points[sampling[s]].pos() - target).norm();
+        for (int i : members)
+            VERIFY(selected <= (points[i].pos() - target).norm() + epsilon);
+    }
+
+    // the output feeds a new tree, without copy
+    KdTree<DataPoint> sampled;
+    sampled.build(points, sampling);
+    VERIFY(sampled.index_count() == int(sampling.size()));
+}
+
+// Check that no sampled point covers another, and that every indexed point is covered by a sampled one
+template<typename DataPoint, typename RadiusFunctor>
+void checkPoissonDisk(const vector<DataPoint>& points, const vector<int>& indexed, const vector<int>& sampling,
+                      RadiusFunctor radiusOf)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    const Scalar epsilon = testEpsilon<Scalar>() * 10;
+
+    VERIFY(std::is_sorted(sampling.begin(), sampling.end()));
+    for (int s : sampling)
+        VERIFY(std::binary_search(indexed.begin(), indexed.end(), s));
+
+#pragma omp parallel for
+    for (int a = 0; a < int(sampling.size()); ++a)
+        for (int b = a + 1; b < int(sampling.size()); ++b)
+        {
+            const Scalar distance = (points[sampling[a]].pos() - points[sampling[b]].pos()).norm();
+            VERIFY(distance >= std::min(radiusOf(sampling[a]), radiusOf(sampling[b])) * (1 - epsilon));
+        }
+
+#pragma omp parallel for
+    for (int n = 0; n < int(indexed.size()); ++n)
+    {
+        bool covered = false;
+        for (int s : sampling)
+            covered = covered || (points[indexed[n]].pos() - points[s].pos()).norm() <= radiusOf(s) * (1 + epsilon);
+        VERIFY(covered);
+    }
+}
+
+template<typename DataPoint>
+void testPoissonDisk()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    const int n = Eigen::internal::random<int>(1000, 3000);
+    const Scalar radius = Eigen::internal::random<Scalar>(0.05, 0.3);
+    vector<DataPoint> points(n);
+    std::generate(points.begin(), points.end(), []() { return DataPoint(VectorType::Random()); });
+    const vector<int> indexed = randomSampling(n);
+    KdTree<DataPoint> tree(points, indexed);
+
+    vector<int> sampling;
+    poisson_disk_sampling(tree, radius, sampling);
+    checkPoissonDisk(points, indexed, sampling, [&](int) { return radius; });
+
+#ifdef _OPENMP
+    // the sampling does not depend on the number of threads
+    const int threads = omp_get_max_threads();
+    omp_set_num_threads(3);
+    vector<int> other;
+    poisson_disk_sampling(tree, radius, other);
+    omp_set_num_threads(threads);
+    VERIFY(other == sampling);
+#endif
+}
+
+template<typename DataPoint>
+void testCurvatureAdaptive()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+
+    // flat for x < 0, curved for x > 0
+    const int n = 4000;
+    vector<DataPoint> points(n);
+    std::generate(points.begin(), points.end(), []() { return DataPoint(VectorType::Random()); });
+    vector<Scalar> kappa(n);
+    for (int i = 0; i < n; ++i)
+        kappa[i] = points[i].pos().x() < 0 ? Scalar(0) : Scalar(Eigen::internal::random<int>(0, 1) ? 50 : -50);
+    kappa[0] = std::numeric_limits<Scalar>::quiet_NaN();
+    KdTree<DataPoint> tree(points);
+
+    const Scalar tolerance = Scalar(1e-3), minRadius = Scalar(0.05), maxRadius = Scalar(0.4);
+    vector<int> sampling;
+    curvature_adaptive_sampling(tree, kappa, tolerance, minRadius, maxRadius, sampling);
+
+    auto radiusOf = [&](int i) {
+        if (!std::isfinite(kappa[i]) || kappa[i] == Scalar(0))
+            return maxRadius;
+        return std::min(std::max(Scalar(std::sqrt(8 * tolerance / std::abs(kappa[i]))), minRadius), maxRadius);
+    };
+    vector<int> all(n);
+    std::iota(all.begin(), all.end(), 0);
+    checkPoissonDisk(points, all, sampling, radiusOf);
+
+    // denser in the curved half
+    const auto curved = std::count_if(sampling.begin(), sampling.end(), [&](int i) { return points[i].pos().x() > 0; });
+    VERIFY(curved > 2 * (int(sampling.size()) - curved));
+}
+
+template<typename Scalar, int Dim>
+void callSubTests()
+{
+    typedef PointPosition<Scalar, Dim> Point;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testVoxelGrid<Point>(VOXEL_NEAREST_CENTROID) ));
+        CALL_SUBTEST(( testVoxelGrid<Point>(VOXEL_NEAREST_CENTER) ));
+        CALL_SUBTEST(( testPoissonDisk<Point>() ));
+        CALL_SUBTEST(( testCurvatureAdaptive<Point>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the KdTree downsamplings in 2 and 3 dimensions..." << endl;
+    callSubTests<float, 3>();
+    callSubTests<double, 3>();
+    callSubTests<double, 2>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,197 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/kdtree_snapshot.cpp
+    \brief Test the KdTree snapshots queried while they are rebuilt in the background
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTreeSnapshot.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <future>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+// Cloud of the version `version`: all its points are translated by `version` along x
+template<typename DataPoint>
+vector<DataPoint> versionCloud(int n, int version)
+{
+    typedef typename DataPoint::VectorType VectorType;
+    vector<DataPoint> points(n);
+    for (DataPoint& p : points)
+        p = DataPoint(VectorType::Random() + VectorType::UnitX() * version);
+    return points;
+}
+
+// Copy of `file` aligned for KdTree::load_view, owned by the returned pointer
+shared_ptr<const void> alignedCopy(const string& file)
+{
+    auto storage = make_shared<vector<char>>(file.size() + KdTreeFileHeader::Alignment);
+    const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(storage->data());
+    char* aligned = storage->data() + (KdTreeFileHeader::Alignment - address % KdTreeFileHeader::Alignment) % KdTreeFileHeader::Alignment;
+    std::copy(file.begin(), file.end(), aligned);
+    return shared_ptr<const void>(storage, aligned);
+}
+
+template<typename DataPoint>
+void testConcurrentReaders()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef KdTreeSnapshots<DataPoint> Snapshots;
+
+    const int n = 5000, versions = 6;
+    Snapshots trees([](typename Snapshots::TreeType& tree) { tree.set_split_strategy(SPLIT_MORTON); });
+    VERIFY(trees.snapshot() == nullptr && trees.version() == 0);
+    VERIFY(trees.build(versionCloud<DataPoint>(n, 0)));
+    VERIFY(trees.version() == 1);
+
+    // the readers check that each snapshot is a complete tree over a single version of the cloud
+    atomic<bool> stop {false};
+    atomic<int> errors {0}, batches {0};
+    vector<thread> readers;
+    for (int r = 0; r < 3; ++r)
+        readers.emplace_back([&, r]() {
+            std::minstd_rand random(r + 1);
+            while (!stop.load())
+            {
+                const typename Snapshots::Snapshot tree = trees.snapshot();
+                const Scalar version = 3 * std::round(tree->point(0).pos().x() / 3);
+                for (int q = 0; q < 50; ++q)
+                {
+                    const int i = int(random() % std::uint32_t(tree->point_count()));
+                    int count = 0;
+                    for (int j : tree->k_nearest_neighbors(tree->point(i).pos(), 4))
+                    {
+                        count += std::abs(tree->point(j).pos().x() - version) <= Scalar(1.5);
+                        errors += j < 0 || j >= tree->point_count();
+                    }
+                    errors += count != 4;
+                    errors += *tree->nearest_neighbor(tree->point(i).pos()).begin() < 0;
+                }
+                errors += !tree->valid();
+                ++batches;
+            }
+        });
+
+    // a snapshot held by a reader outlives the next publications
+    const typename Snapshots::Snapshot first = trees.snapshot();
+    for (int v = 1; v < versions; ++v)
+    {
+        future<bool> done = trees.build_async(versionCloud<DataPoint>(n, 3 * v));
+        VERIFY(done.get());
+        VERIFY(trees.version() == std::uint64_t(v + 1));
+    }
+    while (batches.load() < 10)
+        std::this_thread::yield();
+    stop = true;
+    for (thread& reader : readers)
+        reader.join();
+
+    VERIFY(errors.load() == 0);
+    VERIFY(first.use_count() == 1 && first->valid() && first->point_count() == n);
+    VERIFY(std::abs(first->point(0).pos().x()) <= Scalar(1));
+    VERIFY(std::abs(trees.snapshot()->point(0).pos().x() - Scalar(3 * (versions - 1))) <= Scalar(1));
+}
+
+template<typename DataPoint>
+void testOrdering()
+{
+    typedef KdTreeSnapshots<DataPoint> Snapshots;
+    typedef typename Snapshots::TreeType Tree;
+
+    // the versions follow the order of the calls
+    Snapshots trees;
+    auto older = std::make_shared<Tree>(versionCloud<DataPoint>(1000, 0));
+    future<bool> newer = trees.build_async(versionCloud<DataPoint>(1000, 1));
+    VERIFY(newer.get() && trees.version() == 1);
+    VERIFY(trees.publish(older) && trees.version() == 2);
+    VERIFY(trees.publish(std::make_shared<Tree>(versionCloud<DataPoint>(1000, 2))));
+    VERIFY(trees.version() == 3);
+
+    // several builds in flight: the last started one wins
+    {
+        vector<future<bool>> builds;
+        for (int v = 0; v < 4; ++v)
+            builds.push_back(trees.build_async(versionCloud<DataPoint>(2000, 10 + v)));
+        for (future<bool>& build : builds)
+            build.get();
+    }
+    VERIFY(trees.version() == 7);
+    VERIFY(std::abs(trees.snapshot()->point(0).pos().x() - 13) <= 1);
+}
+
+template<typename DataPoint>
+void testPublishView()
+{
+    typedef typename DataPoint::VectorType VectorType;
+    typedef KdTreeSnapshots<DataPoint> Snapshots;
+    typedef typename Snapshots::TreeType Tree;
+
+    const vector<DataPoint> points = versionCloud<DataPoint>(3000, 0);
+    const Tree source(points);
+    ostringstream out;
+    VERIFY(source.save(out, true));
+    const string file = out.str();
+
+    // the snapshot owns the only copy of the file
+    Snapshots trees;
+    VERIFY(trees.publish_view(alignedCopy(file), file.size()));
+    const auto tree = trees.snapshot();
+    VERIFY(tree->is_mapped() && tree->valid() && tree->point_count() == int(points.size()));
+    for (int i = 0; i < 100; ++i)
+    {
+        const VectorType p = VectorType::Random();
+        VERIFY(*tree->nearest_neighbor(p).begin() == *source.nearest_neighbor(p).begin());
+    }
+
+    // the file must store the points
+    ostringstream withoutPoints;
+    source.save(withoutPoints, false);
+    const string other = withoutPoints.str();
+    bool thrown = false;
+    try { trees.publish_view(alignedCopy(other), other.size()); }
+    catch (const std::invalid_argument&) { thrown = true; }
+    VERIFY(thrown && trees.snapshot() == tree);
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPosition<Scalar, 3> Point;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testConcurrentReaders<Point>() ));
+        CALL_SUBTEST(( testOrdering<Point>() ));
+        CALL_SUBTEST(( testPublishView<Point>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the KdTree snapshots..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,108 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/lazy_derivatives.cpp
+    \brief Test that the derivatives and curvatures computed on first access match the ones computed by finalize()
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/curvature.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename Fit, typename DataPoint>
+FIT_RESULT fitPoints(Fit& fit, const vector<DataPoint>& points, const typename DataPoint::VectorType& center,
+                     typename DataPoint::Scalar scale)
+{
+    fit.setWeightFunc(typename Fit::WFunctor(scale));
+    fit.init(center);
+    FIT_RESULT res;
+    do {
+        for (const DataPoint& p : points)
+            fit.addNeighbor(p);
+        res = fit.finalize();
+    } while (res == NEED_OTHER_PASS);
+    return res;
+}
+
+template<typename Fit, bool HasLazyDerivatives, typename DataPoint>
+void testFit(const vector<DataPoint>& points, typename DataPoint::Scalar scale)
+{
+    for (int q = 0; q < 10; ++q)
+    {
+        const auto& center = points[Eigen::internal::random<int>(0, int(points.size()) - 1)].pos();
+
+        Fit eager, lazy;
+        lazy.setLazyCurvature(true);
+        if constexpr (HasLazyDerivatives)
+            lazy.setLazyDerivatives(true);
+        VERIFY(!eager.isLazyCurvature() && lazy.isLazyCurvature());
+
+        const FIT_RESULT res = fitPoints(eager, points, center, scale);
+        VERIFY(fitPoints(lazy, points, center, scale) == res);
+        if (res == UNDEFINED)
+            continue;
+
+        // the same computations, on first access
+        VERIFY(lazy.k1() == eager.k1() && lazy.k2() == eager.k2());
+        VERIFY(lazy.k1Direction() == eager.k1Direction() && lazy.k2Direction() == eager.k2Direction());
+        VERIFY(lazy.kMean() == eager.kMean() && lazy.GaussianCurvature() == eager.GaussianCurvature());
+        VERIFY(lazy.dNormal() == eager.dNormal() && lazy.dPotential() == eager.dPotential());
+
+        // the values of the previous fit are not reused
+        if (fitPoints(eager, points, points[0].pos(), scale) != UNDEFINED)
+        {
+            fitPoints(lazy, points, points[0].pos(), scale);
+            VERIFY(lazy.dPotential() == eager.dPotential() && lazy.k1() == eager.k1());
+        }
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar>> WeightFunc;
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit, CovariancePlaneSpaceDer, CurvatureEstimator> PlaneFit;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit, GLSParam, OrientedSphereSpaceDer, CurvatureEstimator> SphereFit;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        const Scalar radius = Eigen::internal::random<Scalar>(1, 10);
+        const typename Point::VectorType center = Point::VectorType::Random() * Eigen::internal::random<Scalar>(1, 10);
+        vector<Point> points(Eigen::internal::random<int>(200, 500));
+        for (Point& p : points)
+            p = getPointOnSphere<Point>(radius, center, true, true);
+
+        CALL_SUBTEST(( testFit<PlaneFit, true>(points, radius / 2) ));
+        CALL_SUBTEST(( testFit<SphereFit, false>(points, radius / 2) ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the lazy derivatives and curvatures..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
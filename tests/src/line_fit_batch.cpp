@@ -0,0 +1,207 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/line_fit_batch.cpp
+    \brief Test the largest eigenvector solver of CovarianceLineFit, the batched line fits against CovarianceLineFit,
+    and the polyline tracing along curves
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covarianceLineFit.h>
+#include <Ponca/src/Fitting/lineFitBatch.h>
+#include <Ponca/src/Fitting/polylineTracing.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename DataPoint>
+void testLargestEigenvector()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename DataPoint::MatrixType MatrixType;
+
+    // random positive semi-definite matrices whose largest eigenvalue is at least twice the second one
+    const Eigen::Matrix<Scalar, 3, 3> q = Eigen::Matrix<Scalar, 3, 3>::Random().householderQr().householderQ();
+    const VectorType lambda(Eigen::internal::random<Scalar>(2, 10), Eigen::internal::random<Scalar>(0, 1),
+                            Eigen::internal::random<Scalar>(0, 1));
+    const MatrixType m = q * lambda.asDiagonal() * q.transpose();
+    VectorType v;
+    VERIFY(internal::largestEigenvector(m, v));
+    VERIFY(Scalar(1) - std::abs(v.dot(q.col(0))) <= testEpsilon<Scalar>());
+    VERIFY(!internal::largestEigenvector(MatrixType::Zero().eval(), v));
+}
+
+template<typename DataPoint>
+void testLineFitBatch(bool _bAddPositionNoise)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef DistWeightFunc<DataPoint, ConstantWeightKernel<Scalar>> WeightFunc;
+    typedef Basket<DataPoint, WeightFunc, CovarianceLineFit> Fit;
+
+    // points along a few segments
+    const Scalar noise = _bAddPositionNoise ? Scalar(0.001) : Scalar(0);
+    vector<DataPoint> points(Eigen::internal::random<int>(500, 2000));
+    vector<VectorType> directions(4);
+    for (VectorType& d : directions)
+        d = VectorType::Random().normalized();
+    for (int i = 0; i < int(points.size()); ++i)
+        points[i] = DataPoint(VectorType::Constant(Scalar(4 * (i % 4))) + directions[i % 4] * Eigen::internal::random<Scalar>(-1, 1)
+                              + VectorType::Random() * noise);
+    const KdTree<DataPoint> tree(points);
+    const Scalar scale = Scalar(0.2);
+
+    vector<VectorType> centers(points.size());
+    for (int i = 0; i < int(points.size()); ++i)
+        centers[i] = points[i].pos();
+    centers[0] = VectorType::Constant(Scalar(100)); // no neighbors
+    vector<size_t> offsets;
+    vector<int> neighbors;
+    tree.range_neighbors_batch(centers, scale, offsets, neighbors);
+
+    const int n = int(points.size());
+    vector<Scalar> origins(3 * n), lineDirections(3 * n), residuals(n);
+    vector<FIT_RESULT> status(n);
+    LineFitBuffers<Scalar> buffers;
+    buffers.origins = origins.data();
+    buffers.directions = lineDirections.data();
+    buffers.residuals = residuals.data();
+    buffers.status = status.data();
+    computeLineFitBatch<DataPoint>(centers, tree.point_buffer(), offsets, neighbors, buffers);
+    VERIFY(status[0] == UNDEFINED && std::isnan(origins[0]) && std::isnan(residuals[0]));
+
+    const Scalar epsilon = testEpsilon<Scalar>();
+    for (int i = 1; i < n; ++i)
+    {
+        vector<DataPoint> neighborhood;
+        for (size_t j = offsets[i]; j < offsets[i + 1]; ++j)
+            neighborhood.push_back(points[neighbors[j]]);
+        if (neighborhood.size() < 10)
+            continue;
+
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(scale));
+        fit.init(centers[i]);
+        VERIFY(fit.compute(neighborhood.cbegin(), neighborhood.cend()) == STABLE);
+        VERIFY(status[i] == STABLE);
+
+        const VectorType origin = Eigen::Map<const VectorType>(origins.data() + 3 * i);
+        const VectorType direction = Eigen::Map<const VectorType>(lineDirections.data() + 3 * i);
+        VERIFY(std::abs(direction.norm() - Scalar(1)) <= epsilon);
+        VERIFY(Scalar(1) - std::abs(direction.dot(fit.direction())) <= epsilon);
+        VERIFY((origin - (centers[i] + fit.origin())).norm() <= epsilon * scale);
+        VERIFY(Scalar(1) - std::abs(direction.dot(directions[i % 4])) <= (_bAddPositionNoise ? Scalar(1e-3) : epsilon));
+
+        Scalar residual = Scalar(0);
+        for (const DataPoint& p : neighborhood)
+            residual += fit.potential(p.pos());
+        VERIFY(std::abs(residual / Scalar(neighborhood.size()) - residuals[i]) <= epsilon * scale * scale);
+
+        // same line with the largest eigenvector solver of CovarianceLineFit
+        Fit largest;
+        largest.setWeightFunc(WeightFunc(scale));
+        largest.setSolver(LARGEST_EIGENVECTOR_SOLVER);
+        largest.init(centers[i]);
+        VERIFY(largest.compute(neighborhood.cbegin(), neighborhood.cend()) == STABLE);
+        VERIFY(Scalar(1) - std::abs(largest.direction().dot(fit.direction())) <= epsilon);
+    }
+}
+
+template<typename DataPoint>
+void testPolylineTracing()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef DistWeightFunc<DataPoint, ConstantWeightKernel<Scalar>> WeightFunc;
+    typedef Basket<DataPoint, WeightFunc, CovarianceLineFit> Fit;
+
+    // a circle, and an open arc of another one
+    const Scalar radius = Eigen::internal::random<Scalar>(1, 2), noise = Scalar(0.001) * radius;
+    const VectorType arcCenter = VectorType::Constant(Scalar(10) * radius);
+    const Scalar pi = Scalar(EIGEN_PI);
+    vector<DataPoint> points(4000);
+    for (int i = 0; i < int(points.size()); ++i)
+    {
+        const Scalar angle = Eigen::internal::random<Scalar>(0, 2 * pi);
+        points[i] = i % 2 ? DataPoint(VectorType(radius * std::cos(angle), radius * std::sin(angle), Scalar(0)) + VectorType::Random() * noise)
+                          : DataPoint(arcCenter + VectorType(radius * std::cos(angle / 2), Scalar(0), radius * std::sin(angle / 2)));
+    }
+    const KdTree<DataPoint> tree(points);
+    const Scalar scale = Scalar(0.1) * radius;
+    PolylineTraceParams<Scalar> params;
+    const Scalar step = params.step * scale;
+
+    const auto check_samples = [&](const vector<VectorType>& polyline, const VectorType& center, int axis) {
+        for (size_t s = 0; s < polyline.size(); ++s)
+        {
+            VERIFY(std::abs((polyline[s] - center).norm() - radius) <= Scalar(0.01) * radius);
+            VERIFY(std::abs(polyline[s](axis) - center(axis)) <= Scalar(0.01) * radius);
+            if (s > 0)
+                VERIFY((polyline[s] - polyline[s - 1]).norm() <= Scalar(1.1) * step);
+        }
+    };
+
+    vector<VectorType> polyline;
+    VERIFY(tracePolyline<Fit>(tree, VectorType(radius, Scalar(0), Scalar(0)), scale, params, polyline));
+    VERIFY(polyline.front() == polyline.back());
+    VERIFY(abs(Scalar(polyline.size() - 1) * step - 2 * pi * radius) <= Scalar(0.1) * 2 * pi * radius);
+    check_samples(polyline, VectorType::Zero(), 2);
+
+    // the arc is traced on both sides of the seed, up to its ends
+    const VectorType seed = arcCenter + VectorType(Scalar(0), Scalar(0), radius);
+    VERIFY(!tracePolyline<Fit>(tree, seed, scale, params, polyline));
+    check_samples(polyline, arcCenter, 1);
+    VERIFY(abs(Scalar(polyline.size() - 1) * step - pi * radius) <= Scalar(0.1) * pi * radius);
+    VERIFY(std::max(polyline.front()(0), polyline.back()(0)) > arcCenter(0) + Scalar(0.9) * radius);
+    VERIFY(std::min(polyline.front()(0), polyline.back()(0)) < arcCenter(0) - Scalar(0.9) * radius);
+
+    // at most maxSamples samples on each side
+    params.maxSamples = 3;
+    VERIFY(!tracePolyline<Fit>(tree, seed, scale, params, polyline));
+    VERIFY(polyline.size() == 7);
+
+    // no line far from the points
+    VERIFY(!tracePolyline<Fit>(tree, VectorType::Constant(Scalar(-100)), scale, params, polyline));
+    VERIFY(polyline.empty());
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPosition<Scalar, 3> Point;
+
+    for (int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testLargestEigenvector<Point>() ));
+        CALL_SUBTEST(( testLineFitBatch<Point>(false) ));
+        CALL_SUBTEST(( testLineFitBatch<Point>(true) ));
+    }
+    CALL_SUBTEST(( testPolylineTracing<Point>() ));
+}
+
+int main(int argc, char** argv)
+{
+    if (!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test batched line fits and polyline tracing in float..." << endl;
+    callSubTests<float>();
+    cout << "Test batched line fits and polyline tracing in double..." << endl;
+    callSubTests<double>();
+}
@@ -0,0 +1,182 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/mahalanobis_weight_func.cpp
+    \brief Test anisotropic weight function derivatives, and its support collected by the KdTree ellipsoid queries
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/mahalanobisWeightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+using namespace std;
+using namespace Ponca;
+
+// Random symmetric positive definite metric, stretching the space up to a factor 10
+template<typename MatrixType>
+MatrixType randomMetric()
+{
+    typedef typename MatrixType::Scalar Scalar;
+    MatrixType a = MatrixType::Random();
+    MatrixType m = a * a.transpose();
+    m.diagonal().array() += Scalar(0.1);
+    return m;
+}
+
+template<typename DataPoint, typename WeightKernel>
+void testFunction()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename DataPoint::MatrixType MatrixType;
+    typedef MahalanobisWeightFunc<DataPoint, WeightKernel> WeightFunc;
+
+    DataPoint dummy;
+
+    Scalar epsilon = testEpsilon<Scalar>();
+    Scalar t       = Eigen::internal::random<Scalar>(0.10, 10.0);
+    Scalar h       = Scalar(1e-5);
+    Scalar h2      = Scalar(.5)*h;
+    MatrixType m   = randomMetric<MatrixType>();
+
+    WeightFunc wfunc(t, m);
+    WeightFunc wfuncR(t+h, m), wfuncL(t-h, m);
+    WeightFunc wfuncR2(t+h2, m), wfuncL2(t-h2, m);
+    VERIFY( (wfunc.metric() - m).array().abs().maxCoeff() < epsilon );
+
+    // rejection sampling inside the ellipsoid of radius t
+    VectorType x = t*VectorType::Random();
+    while ( wfunc.squaredNorm(x) < 0.001*t*t || 0.98*t*t < wfunc.squaredNorm(x))
+        x = t*VectorType::Random();
+
+    // centered finite differences, as in dist_weight_func
+    VectorType dx_w_, d2tx_w_;
+    MatrixType d2x_w_;
+    for(int i=0; i<DataPoint::Dim; ++i)
+    {
+        VectorType ei = VectorType::Zero();
+        ei[i] = Scalar(1.);
+        dx_w_[i] = (wfunc.w(x+h*ei, dummy) - wfunc.w(x-h*ei, dummy))/(Scalar(2.)*h);
+        d2tx_w_[i] = (wfuncR2.w(x + h2*ei, dummy) - wfuncR2.w(x - h2*ei, dummy)
+                      - wfuncL2.w(x + h2*ei, dummy) + wfuncL2.w(x - h2*ei, dummy))/(h*h);
+        for(int j=0; j<DataPoint::Dim; ++j)
+        {
+            VectorType ej = VectorType::Zero();
+            ej[j] = Scalar(1.);
+            d2x_w_(i,j) = (wfunc.w(x + h2*ei + h2*ej, dummy) - wfunc.w(x + h2*ei - h2*ej, dummy)
+                           - wfunc.w(x - h2*ei + h2*ej, dummy) + wfunc.w(x - h2*ei - h2*ej, dummy))/(h*h);
+        }
+    }
+    Scalar dt_w_  = (wfuncR.w(x, dummy) - wfuncL.w(x, dummy))/(Scalar(2.)*h);
+    Scalar d2t_w_ = (wfuncR.w(x, dummy) - Scalar(2.)*wfunc.w(x, dummy) + wfuncL.w(x, dummy))/(h*h);
+
+    // the tolerance follows the stretching of the metric
+    Scalar tolerance = epsilon * m.norm();
+    VERIFY( (wfunc.spacedw(x, dummy) - dx_w_).array().abs().maxCoeff() < tolerance );
+    VERIFY( (wfunc.spaced2w(x, dummy) - d2x_w_).array().abs().maxCoeff() < tolerance * m.norm() );
+    VERIFY( (wfunc.scaleSpaced2w(x, dummy) - d2tx_w_).array().abs().maxCoeff() < tolerance );
+    VERIFY( std::abs(wfunc.scaledw(x, dummy) - dt_w_) < tolerance );
+    VERIFY( std::abs(wfunc.scaled2w(x, dummy) - d2t_w_) < tolerance );
+}
+
+// The identity metric gives the isotropic weight function
+template<typename DataPoint, typename WeightKernel>
+void testIdentity()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename DataPoint::MatrixType MatrixType;
+
+    Scalar epsilon = testEpsilon<Scalar>();
+    Scalar t       = Eigen::internal::random<Scalar>(0.10, 10.0);
+    MahalanobisWeightFunc<DataPoint, WeightKernel> wfunc(t, MatrixType::Identity());
+    DistWeightFunc<DataPoint, WeightKernel> wfuncIsotropic(t);
+
+    DataPoint dummy;
+    for (const VectorType& x : {VectorType(t*VectorType::Random()), VectorType(Scalar(2)*t*VectorType::Random())})
+    {
+        VERIFY( std::abs(wfunc.w(x, dummy) - wfuncIsotropic.w(x, dummy)) < epsilon );
+        VERIFY( (wfunc.spacedw(x, dummy) - wfuncIsotropic.spacedw(x, dummy)).array().abs().maxCoeff() < epsilon );
+        VERIFY( (wfunc.spaced2w(x, dummy) - wfuncIsotropic.spaced2w(x, dummy)).array().abs().maxCoeff() < epsilon );
+        VERIFY( std::abs(wfunc.scaledw(x, dummy) - wfuncIsotropic.scaledw(x, dummy)) < epsilon );
+        VERIFY( std::abs(wfunc.scaled2w(x, dummy) - wfuncIsotropic.scaled2w(x, dummy)) < epsilon );
+        VERIFY( (wfunc.scaleSpaced2w(x, dummy) - wfuncIsotropic.scaleSpaced2w(x, dummy)).array().abs().maxCoeff() < epsilon );
+    }
+}
+
+// The ellipsoid query of the KdTree returns exactly the points of non-zero weight
+template<typename DataPoint>
+void testSupport()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename DataPoint::MatrixType MatrixType;
+    typedef MahalanobisWeightFunc<DataPoint, SmoothWeightKernel<Scalar> > WeightFunc;
+
+    const int n = 10000;
+    vector<DataPoint> points(n);
+    for (auto& p : points)
+        p = DataPoint(VectorType::Random(), VectorType::Random().normalized());
+    KdTree<DataPoint> tree(points);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        const VectorType center = VectorType::Random();
+        const MatrixType metric = randomMetric<MatrixType>();
+        const Scalar t = Eigen::internal::random<Scalar>(0.1, 0.5);
+        const WeightFunc wfunc(t, metric);
+
+        vector<int> results;
+        for (int j : tree.ellipsoid_neighbors(center, metric, t))
+            results.push_back(j);
+        vector<int> expected;
+        for (int j = 0; j < n; ++j)
+            if (wfunc.w(points[j].pos() - center, points[j]) > Scalar(0))
+                expected.push_back(j);
+
+        // the points on the boundary of the support, of weight 0, may be returned
+        std::sort(results.begin(), results.end());
+        VERIFY( std::includes(results.begin(), results.end(), expected.begin(), expected.end()) );
+        for (int j : results)
+            VERIFY( wfunc.squaredNorm(points[j].pos() - center) <= t*t*(Scalar(1) + testEpsilon<Scalar>()) );
+    }
+}
+
+template<typename Scalar, int Dim>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, Dim> DataPoint;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<DataPoint, SmoothWeightKernel<Scalar> >() ));
+        CALL_SUBTEST(( testFunction<DataPoint, WendlandWeightKernel<Scalar> >() ));
+        CALL_SUBTEST(( testIdentity<DataPoint, SmoothWeightKernel<Scalar> >() ));
+        CALL_SUBTEST(( testIdentity<DataPoint, WendlandWeightKernel<Scalar> >() ));
+    }
+    cout << "ok" << endl;
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Verify anisotropic weight function derivatives" << endl;
+    callSubTests<long double, 2>();
+    callSubTests<long double, 3>();
+    callSubTests<long double, 4>();
+
+    cout << "Verify the ellipsoid neighborhoods" << endl;
+    CALL_SUBTEST(( testSupport<PointPositionNormal<float, 3> >() ));
+    CALL_SUBTEST(( testSupport<PointPositionNormal<double, 3> >() ));
+}
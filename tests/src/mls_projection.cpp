@@ -0,0 +1,120 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/mls_projection.cpp
+    \brief Test that the MLS projection reusing the neighbors converges to the sampled sphere, as the projection
+    querying the tree at each iteration
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/mlsProjection.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename DataPoint, typename Fit>
+void testFunction()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef MlsProjection<Fit, KdTree<DataPoint> > Projection;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(500, 2000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt( Scalar(4. * M_PI) * radius * radius / nbPoints);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10);
+    const Scalar epsilon = Scalar(10.) * testEpsilon<Scalar>();
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false, false);
+
+    KdTree<DataPoint> tree(points);
+
+    // queries around the sphere, within the neighborhood of the samples
+    const int nbQueries = Eigen::internal::random<int>(100, 500);
+    vector<VectorType> queries(nbQueries);
+    for(auto& q : queries)
+        q = center + VectorType::Random().normalized() * (radius + Eigen::internal::random<Scalar>(-0.3, 0.3) * analysisScale);
+
+    Projection mls(tree, analysisScale);
+    Projection reference(tree, analysisScale);
+    reference.setReuse(Scalar(0));
+
+    typename Projection::Context context(mls), referenceContext(reference);
+    vector<VectorType> projections(nbQueries);
+    vector<FIT_RESULT> results(nbQueries);
+    int nbIterations = 0;
+    for(int i = 0; i < nbQueries; ++i)
+    {
+        VectorType referenceProj;
+        const int referenceQueries = referenceContext.queryCount();
+        const FIT_RESULT referenceRes = reference.project(queries[i], referenceProj, referenceContext);
+        nbIterations += referenceContext.queryCount() - referenceQueries;
+
+        results[i] = mls.project(queries[i], projections[i], context);
+        VERIFY(results[i] == referenceRes);
+        if(results[i] == STABLE)
+        {
+            // APSS reproduces the spheres
+            VERIFY(std::abs((projections[i] - center).norm() - radius) <= epsilon * radius);
+            VERIFY((projections[i] - referenceProj).norm() <= epsilon * radius);
+        }
+    }
+
+    // the reference queries the tree at each iteration
+    VERIFY(context.queryCount() < nbIterations);
+
+    // same projections in parallel, in place
+    vector<VectorType> batch = queries;
+    vector<FIT_RESULT> batchResults(nbQueries);
+    mls.projectBatch(batch.data(), batch.data(), nbQueries, batchResults.data());
+    for(int i = 0; i < nbQueries; ++i)
+    {
+        VERIFY(batchResults[i] == results[i]);
+        if(results[i] == STABLE)
+            VERIFY((batch[i] - projections[i]).norm() <= epsilon * radius);
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightSmoothFunc;
+    typedef Basket<Point, WeightSmoothFunc, OrientedSphereFit> Fit;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Point, Fit>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test MLS projection..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,108 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/SpatialPartitioning/morton.h>
+
+using namespace Ponca;
+
+template<typename Code, int Dim>
+void testMortonEncoding()
+{
+	constexpr int BitsPerAxis = MortonTraits<Code, Dim>::BitsPerAxis;
+	VERIFY(int(MortonTraits<Code, Dim>::Bits) < 8 * int(sizeof(Code)));
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		std::uint32_t coords[Dim], decoded[Dim];
+		for (int d = 0; d < Dim; ++d)
+			coords[d] = std::uint32_t(Eigen::internal::random<std::uint64_t>(0, (std::uint64_t(1) << BitsPerAxis) - 1));
+		const Code code = morton_encode<Code, Dim>(coords);
+		morton_decode<Code, Dim>(code, decoded);
+		for (int d = 0; d < Dim; ++d)
+			VERIFY(coords[d] == decoded[d]);
+
+		// the bit b of the code stores a bit of the coordinate morton_dimension(b)
+		const int bit = Eigen::internal::random<int>(0, MortonTraits<Code, Dim>::Bits - 1);
+		const int d = morton_dimension<Dim>(bit);
+		const int level = bit / Dim;
+		VERIFY(((code >> bit) & 1u) == ((coords[d] >> level) & 1u));
+	}
+}
+
+template<typename Code, typename DataPoint>
+void testMortonSort(int n)
+{
+	using VectorType = typename DataPoint::VectorType;
+
+	std::vector<DataPoint> points(n);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	const std::vector<int> order = morton_order<Code>(points);
+	VERIFY(int(order.size()) == n);
+
+	// permutation of the points, by increasing codes
+	std::vector<int> sorted = order;
+	std::sort(sorted.begin(), sorted.end());
+	for (int i = 0; i < n; ++i)
+		VERIFY(sorted[i] == i);
+
+	Eigen::AlignedBox<typename DataPoint::Scalar, DataPoint::Dim> aabb;
+	for (const auto& p : points)
+		aabb.extend(p.pos());
+	for (int i = 1; i < n; ++i)
+		VERIFY(morton_code<Code>(points[order[i-1]].pos(), aabb) <= morton_code<Code>(points[order[i]].pos(), aabb));
+
+	// the points on the max side of the box fall in the last cell
+	std::uint32_t corner[DataPoint::Dim];
+	morton_decode<Code, DataPoint::Dim>(morton_code<Code>(aabb.max(), aabb), corner);
+	for (int d = 0; d < DataPoint::Dim; ++d)
+		VERIFY(corner[d] == std::uint32_t((std::uint64_t(1) << MortonTraits<Code, DataPoint::Dim>::BitsPerAxis) - 1));
+
+	// stable with respect to the input order
+	std::vector<Code> codes(n);
+	std::vector<int> indices(n);
+	std::iota(indices.begin(), indices.end(), 0);
+	for (int i = 0; i < n; ++i)
+		codes[i] = Code(Eigen::internal::random<int>(0, 15));
+	std::vector<Code> expected = codes;
+	std::stable_sort(expected.begin(), expected.end());
+	morton_sort(codes.data(), indices.data(), n);
+	for (int i = 0; i < n; ++i)
+	{
+		VERIFY(codes[i] == expected[i]);
+		VERIFY(i == 0 || codes[i-1] < codes[i] || indices[i-1] < indices[i]);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Test Morton encoding..." << endl;
+	testMortonEncoding<std::uint32_t, 3>();
+	testMortonEncoding<std::uint64_t, 3>();
+	testMortonEncoding<std::uint32_t, 2>();
+	testMortonEncoding<std::uint64_t, 4>();
+
+	cout << "Test Morton sort in 3D..." << endl;
+	testMortonSort<std::uint32_t, TestPoint<float, 3>>(1000);
+	testMortonSort<std::uint64_t, TestPoint<double, 3>>(1000);
+
+	cout << "Test Morton sort in 2D..." << endl;
+	testMortonSort<std::uint64_t, TestPoint<float, 2>>(1000);
+	testMortonSort<std::uint64_t, TestPoint<double, 2>>(1000);
+
+	cout << "Test parallel Morton sort in 3D..." << endl;
+	testMortonSort<std::uint64_t, TestPoint<float, 3>>(2 * PCA_MORTON_PARALLEL_MIN_SIZE);
+}
@@ -0,0 +1,190 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/normal_curvature_pipeline.cpp
+    \brief Test that computeNormalsCurvatures writes the same results as fitting the neighborhoods one by one
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/normalCurvaturePipeline.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+// Output buffers of all the points, filled with `sentinel`
+template<typename Scalar>
+struct Buffers
+{
+    vector<Scalar> normals, k1, k2, k1Directions, k2Directions;
+    vector<FIT_RESULT> status;
+
+    Buffers(int n, Scalar sentinel)
+        : normals(3 * n, sentinel), k1(n, sentinel), k2(n, sentinel),
+          k1Directions(3 * n, sentinel), k2Directions(3 * n, sentinel), status(n, UNDEFINED) {}
+
+    NormalCurvatureBuffers<Scalar> view(bool withDirections)
+    {
+        NormalCurvatureBuffers<Scalar> buffers;
+        buffers.normals = normals.data();
+        buffers.k1 = k1.data();
+        buffers.k2 = k2.data();
+        if (withDirections)
+        {
+            buffers.k1Directions = k1Directions.data();
+            buffers.k2Directions = k2Directions.data();
+        }
+        buffers.status = status.data();
+        return buffers;
+    }
+};
+
+// Compare the entry `i` of the buffers to the fit of `neighborhood` at the scale `scale`
+template<typename DataPoint, typename Fit>
+void checkEntry(Buffers<typename DataPoint::Scalar>& buffers, int i, bool withDirections,
+                const DataPoint& point, const vector<DataPoint>& neighborhood, typename DataPoint::Scalar scale)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename Fit::WFunctor WeightFunc;
+    const Scalar epsilon = testEpsilon<Scalar>() * 10;
+
+    Fit fit;
+    fit.setWeightFunc(WeightFunc(scale));
+    fit.init(point.pos());
+    const FIT_RESULT res = fit.compute(neighborhood.cbegin(), neighborhood.cend());
+
+    VERIFY(buffers.status[i] == res);
+    const Eigen::Map<const VectorType> normal(buffers.normals.data() + 3 * i);
+    if (res != STABLE)
+    {
+        VERIFY(std::isnan(buffers.k1[i]) && std::isnan(buffers.k2[i]) && std::isnan(normal(0)));
+        return;
+    }
+
+    VERIFY(std::abs(normal.norm() - Scalar(1)) < epsilon);
+    VERIFY(std::abs(std::abs(normal.dot(fit.primitiveGradient().normalized())) - Scalar(1)) < epsilon);
+    VERIFY(std::abs(buffers.k1[i] - fit.k1()) < epsilon * std::max(Scalar(1), std::abs(fit.k1())));
+    VERIFY(std::abs(buffers.k2[i] - fit.k2()) < epsilon * std::max(Scalar(1), std::abs(fit.k2())));
+    if (withDirections)
+    {
+        const Eigen::Map<const VectorType> d1(buffers.k1Directions.data() + 3 * i);
+        const Eigen::Map<const VectorType> d2(buffers.k2Directions.data() + 3 * i);
+        // the directions of the fit itself, which are not orthonormal for degenerate neighborhoods
+        VERIFY((d1 - fit.k1Direction()).norm() < epsilon && (d2 - fit.k2Direction()).norm() < epsilon);
+    }
+}
+
+template<typename DataPoint>
+vector<DataPoint> sphere(int n, typename DataPoint::Scalar radius)
+{
+    vector<DataPoint> points(n);
+    for (auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, DataPoint::VectorType::Random(), false, false, false);
+    return points;
+}
+
+template<typename DataPoint, typename Fit>
+void testRange(bool withDirections)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    const int n = Eigen::internal::random<int>(500, 2000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1, 10);
+    const Scalar scale = Scalar(6) * std::sqrt(Scalar(4 * M_PI) * radius * radius / n);
+    const Scalar sentinel = Scalar(42);
+    const vector<DataPoint> points = sphere<DataPoint>(n, radius);
+
+    // zero-copy tree over a subset of the points
+    vector<int> sampling;
+    for (int i = 0; i < n; ++i)
+        if (Eigen::internal::random<int>(0, 3) != 0)
+            sampling.push_back(i);
+    KdTree<DataPoint> tree;
+    tree.build_view(points.data(), n, sampling);
+
+    Buffers<Scalar> buffers(n, sentinel);
+    computeNormalsCurvatures<Fit>(tree, scale, buffers.view(withDirections), Eigen::internal::random<int>(1, 300));
+
+    vector<bool> sampled(n, false);
+    for (int i : sampling)
+        sampled[i] = true;
+
+#pragma omp parallel for
+    for (int i = 0; i < n; ++i)
+    {
+        VERIFY(withDirections || buffers.k1Directions[3 * i] == sentinel);
+        if (!sampled[i])
+        {
+            VERIFY(buffers.status[i] == UNDEFINED && buffers.k1[i] == sentinel && buffers.normals[3 * i] == sentinel);
+            continue;
+        }
+
+        vector<DataPoint> neighborhood;
+        for (int j : tree.range_neighbors(points[i].pos(), scale))
+            neighborhood.push_back(points[j]);
+        checkEntry<DataPoint, Fit>(buffers, i, withDirections, points[i], neighborhood, scale);
+    }
+}
+
+template<typename DataPoint, typename Fit>
+void testKnn()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    const int n = Eigen::internal::random<int>(500, 2000);
+    const int k = Eigen::internal::random<int>(10, 30);
+    const vector<DataPoint> points = sphere<DataPoint>(n, Eigen::internal::random<Scalar>(1, 10));
+    KdTree<DataPoint> tree(points);
+
+    Buffers<Scalar> buffers(n, Scalar(42));
+    computeNormalsCurvaturesKnn<Fit>(tree, k, buffers.view(true), Eigen::internal::random<int>(1, 300));
+
+#pragma omp parallel for
+    for (int i = 0; i < n; ++i)
+    {
+        vector<DataPoint> neighborhood;
+        Scalar scale = 0;
+        for (int j : tree.k_nearest_neighbors(points[i].pos(), k))
+        {
+            neighborhood.push_back(points[j]);
+            scale = std::max(scale, (points[j].pos() - points[i].pos()).norm());
+        }
+        checkEntry<DataPoint, Fit>(buffers, i, true, points[i], neighborhood, scale);
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+    typedef NormalCurvatureFit<Point> Fit;
+    typedef NormalCurvatureFit<Point, WendlandWeightKernel<Scalar>> WendlandFit;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testRange<Point, Fit>(true) ));
+        CALL_SUBTEST(( testRange<Point, Fit>(false) ));
+        CALL_SUBTEST(( testRange<Point, WendlandFit>(true) ));
+        CALL_SUBTEST(( testKnn<Point, Fit>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the normal and curvature pipeline..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,170 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/SpatialPartitioning/Octree/octree.h>
+
+using namespace Ponca;
+
+template<typename DataPoint>
+void testOctreeLod(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename Octree<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 100 : 10000;
+	auto points = VectorContainer(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	int seed = 0;
+	std::vector<int> indices(N);
+	std::vector<int> sampling(N / 2);
+	std::iota(indices.begin(), indices.end(), 0);
+	std::sample(indices.begin(), indices.end(), sampling.begin(), N / 2, std::mt19937(seed));
+
+	Octree<DataPoint> structure(points, sampling);
+	VERIFY(structure.valid());
+
+	const Scalar epsilon = testEpsilon<Scalar>();
+#pragma omp parallel for
+	for (int i = 0; i < N; ++i)
+	{
+		const Scalar r = Eigen::internal::random<Scalar>(0., 1.);
+		const VectorType point = VectorType::Random();
+
+		// without tolerance: range query
+		std::vector<int> results;
+		for (int j : structure.lod_neighbors(point, r, Scalar(0)))
+			results.push_back(j);
+		VERIFY((check_range_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, point, r, results)));
+
+		// the points of the returned nodes and the returned points are the range neighbors
+		results.clear();
+		auto query = structure.lod_neighbors(point, r, Scalar(0.5));
+		for (auto it = query.begin(); it != query.end(); ++it)
+		{
+			if (!it.is_node())
+			{
+				results.push_back(*it);
+				continue;
+			}
+			const auto& node = structure.node(*it);
+			VERIFY(std::abs(it.squared_distance() - (node.center - point).squaredNorm()) <= epsilon);
+			VERIFY(Scalar(2) * node.half_size * std::sqrt(Scalar(DataPoint::Dim)) <= Scalar(0.5) * r);
+			for (int k = node.start; k < node.start + node.size; ++k)
+				results.push_back(structure.index_data()[k]);
+		}
+		VERIFY((check_range_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, point, r, results)));
+	}
+
+	// large balls are mostly covered by nodes
+	int items = 0, count = 0;
+	for (int j : structure.lod_neighbors(VectorType::Zero(), Scalar(1), Scalar(0.5)))
+		++items, (void)j;
+	for (int j : structure.lod_neighbors(VectorType::Zero(), Scalar(1), Scalar(0)))
+		++count, (void)j;
+	VERIFY(items < count);
+}
+
+template<typename DataPoint>
+void testOctreeMoments(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorType = typename DataPoint::VectorType;
+	using Tree = Octree<DataPoint, OctreeOrientedMoments<DataPoint>>;
+
+	const int N = quick ? 100 : 10000;
+	typename Tree::PointContainer points(N);
+	std::generate(points.begin(), points.end(), []() {
+		return DataPoint(VectorType::Random(), VectorType::Random().normalized()); });
+
+	Tree structure;
+	structure.set_leaf_size(8);
+	structure.build(points);
+	VERIFY(structure.valid());
+
+	// the aggregate of each node matches the sums over its points, relatively to the node center
+	const Scalar epsilon = testEpsilon<Scalar>();
+	for (const auto& node : structure.node_data())
+	{
+		VectorType sumP = VectorType::Zero(), sumN = VectorType::Zero();
+		Scalar sumPP = 0, sumPN = 0;
+		for (int k = node.start; k < node.start + node.size; ++k)
+		{
+			const DataPoint& p = points[structure.index_data()[k]];
+			const VectorType q = p.pos() - node.center;
+			sumP  += q;
+			sumN  += p.normal();
+			sumPP += q.squaredNorm();
+			sumPN += p.normal().dot(q);
+		}
+		const Scalar scale = Scalar(node.size);
+		VERIFY(node.aggregate.count == Scalar(node.size));
+		VERIFY((node.aggregate.sum_positions_around(node.center) - sumP).norm() <= epsilon * scale);
+		VERIFY((node.aggregate.sum_normals - sumN).norm() <= epsilon * scale);
+		VERIFY(std::abs(node.aggregate.sum_squared_norms_around(node.center) - sumPP) <= epsilon * scale);
+		VERIFY(std::abs(node.aggregate.sum_dots_around(node.center) - sumPN) <= epsilon * scale);
+	}
+}
+
+template<typename DataPoint>
+void testOctreeCovarianceMoments(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorType = typename DataPoint::VectorType;
+	using MatrixType = typename DataPoint::MatrixType;
+	using Tree = Octree<DataPoint, OctreeCovarianceMoments<DataPoint>>;
+
+	const int N = quick ? 100 : 10000;
+	typename Tree::PointContainer points(N);
+	std::generate(points.begin(), points.end(), []() {
+		return DataPoint(VectorType::Random(), VectorType::Random().normalized()); });
+
+	Tree structure;
+	structure.set_leaf_size(8);
+	structure.build(points);
+	VERIFY(structure.valid());
+
+	// the outer products of each node match the ones of its points, relatively to the node center
+	const Scalar epsilon = testEpsilon<Scalar>();
+	for (const auto& node : structure.node_data())
+	{
+		MatrixType sumPP = MatrixType::Zero();
+		for (int k = node.start; k < node.start + node.size; ++k)
+		{
+			const VectorType q = points[structure.index_data()[k]].pos() - node.center;
+			sumPP += q * q.transpose();
+		}
+		VERIFY((node.aggregate.sum_outer_products_around(node.center) - sumPP).norm() <= epsilon * Scalar(node.size));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Test Octree level of detail queries in 3D..." << endl;
+	testOctreeLod<TestPoint<float, 3>>(false);
+	testOctreeLod<TestPoint<double, 3>>(false);
+
+	cout << "Test Octree level of detail queries in 4D..." << endl;
+	testOctreeLod<TestPoint<float, 4>>(false);
+	testOctreeLod<TestPoint<double, 4>>(false);
+
+	cout << "Test Octree aggregates in 3D..." << endl;
+	testOctreeMoments<PointPositionNormal<float, 3>>(false);
+	testOctreeMoments<PointPositionNormal<double, 3>>(false);
+	testOctreeCovarianceMoments<PointPositionNormal<float, 3>>(false);
+	testOctreeCovarianceMoments<PointPositionNormal<double, 3>>(false);
+}
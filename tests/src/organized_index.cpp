@@ -0,0 +1,247 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/organized_index.cpp
+    \brief Test the queries of the OrganizedIndex over a synthetic depth map against brute force, and computeAll
+    over the OrganizedIndex against the KdTree
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/computeAll.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+#include <Ponca/src/SpatialPartitioning/Organized/organizedIndex.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace Ponca;
+
+/// Depth map of a tilted background plane and of a box in front of it, seen by a pinhole camera
+/// The pixels of a few holes are invalid, at the origin.
+template<typename DataPoint>
+struct DepthMap
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    int width, height;
+    Scalar f, cx, cy;
+    std::vector<DataPoint> points;
+
+    DepthMap()
+    {
+        width  = Eigen::internal::random<int>(40, 80);
+        height = Eigen::internal::random<int>(30, 60);
+        f  = Scalar(width);
+        cx = Scalar(width) / 2;
+        cy = Scalar(height) / 2;
+        const Scalar slope = Eigen::internal::random<Scalar>(-0.5, 0.5);
+        const int bx = Eigen::internal::random<int>(0, width / 2), by = Eigen::internal::random<int>(0, height / 2);
+
+        points.resize(width * height);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const bool box = x >= bx && x < bx + width / 3 && y >= by && y < by + height / 3;
+                const Scalar z = box ? Scalar(2) : Scalar(4) + slope * (Scalar(x) - cx) / f;
+                const bool hole = Eigen::internal::random<int>(0, 20) == 0;
+                points[y * width + x] = DataPoint(hole ? VectorType::Zero()
+                                                       : VectorType((Scalar(x) - cx) * z / f, (Scalar(y) - cy) * z / f, z));
+            }
+        }
+    }
+
+    bool valid(int i) const { return points[i].pos()(2) != Scalar(0); }
+};
+
+/// Sorted indices of the valid pixels in the window of half sizes (wx, wy) around (x, y) closer than r to p, passing
+/// the depth test
+template<typename DataPoint>
+std::vector<int> bruteForce(const DepthMap<DataPoint>& map, int x, int y, int wx, int wy,
+                            const typename DataPoint::VectorType& p, typename DataPoint::Scalar r,
+                            typename DataPoint::Scalar dz, int exclude)
+{
+    std::vector<int> result;
+    for (int v = std::max(y - wy, 0); v <= std::min(y + wy, map.height - 1); ++v)
+        for (int u = std::max(x - wx, 0); u <= std::min(x + wx, map.width - 1); ++u)
+        {
+            const int i = v * map.width + u;
+            const auto& q = map.points[i].pos();
+            if (i != exclude && map.valid(i) && (q - p).squaredNorm() < r * r && (dz == 0 || std::abs(q(2) - p(2)) <= dz))
+                result.push_back(i);
+        }
+    return result;
+}
+
+template<typename Query>
+std::vector<int> sorted(Query&& query)
+{
+    std::vector<int> result;
+    for (int j : query)
+        result.push_back(j);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+template<typename DataPoint>
+void testQueries()
+{
+    using Scalar = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    const DepthMap<DataPoint> map;
+    const int n = map.width * map.height;
+    const int all = std::max(map.width, map.height);
+
+    OrganizedIndex<DataPoint> index(map.points, map.width, map.height);
+    int valid = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        valid += map.valid(i);
+        VERIFY(index.is_valid(i) == map.valid(i));
+    }
+    VERIFY(index.point_count() == n && index.index_count() == valid);
+
+    // views index the same pixels
+    OrganizedIndex<DataPoint> view;
+    view.build_view(map.points.data(), map.width, map.height);
+    VERIFY(view.index_data() == index.index_data() && view.points_buffer() == map.points.data());
+
+    for (Scalar dz : {Scalar(0), Scalar(0.5)})
+    {
+        index.set_max_depth_diff(dz);
+        for (int q = 0; q < 50; ++q)
+        {
+            const int i = index.index_data()[Eigen::internal::random<int>(0, valid - 1)];
+            const int x = i % map.width, y = i / map.width;
+            const VectorType& p = map.points[i].pos();
+            const Scalar r = Eigen::internal::random<Scalar>(0.05, 0.5);
+            const int w = Eigen::internal::random<int>(1, 6);
+            const int k = Eigen::internal::random<int>(1, 30);
+
+            // fixed windows without intrinsics
+            index.clear_intrinsics();
+            index.set_window_radius(w);
+            VERIFY(sorted(index.range_neighbors(i, r)) == bruteForce(map, x, y, w, w, p, r, dz, i));
+
+            const std::vector<int> window = bruteForce(map, x, y, w, w, p, std::numeric_limits<Scalar>::max(), dz, i);
+            std::vector<Scalar> expected, distances;
+            for (int j : window)
+                expected.push_back((map.points[j].pos() - p).squaredNorm());
+            std::sort(expected.begin(), expected.end());
+            expected.resize(std::min(k, int(expected.size())));
+            auto knn = index.k_nearest_neighbors(i, k);
+            for (auto it = knn.begin(); it != knn.end(); ++it)
+            {
+                VERIFY(*it != i && index.is_valid(*it));
+                distances.push_back((map.points[*it].pos() - p).squaredNorm());
+            }
+            std::sort(distances.begin(), distances.end());
+            VERIFY(distances == expected);
+
+            // with the intrinsics and unclamped windows, the range queries find all the neighbors
+            index.set_intrinsics(map.f, map.f, map.cx, map.cy);
+            index.set_window_radius(all);
+            const std::vector<int> ball = bruteForce(map, x, y, all, all, p, r, dz, i);
+            VERIFY(sorted(index.range_neighbors(i, r)) == ball);
+
+            const VectorType moved = p + VectorType::Random() * r / 2;
+            const int mx = int(std::floor(map.f * moved(0) / moved(2) + map.cx + Scalar(0.5)));
+            const int my = int(std::floor(map.f * moved(1) / moved(2) + map.cy + Scalar(0.5)));
+            VERIFY(sorted(index.range_neighbors(moved, r)) == bruteForce(map, mx, my, all, all, moved, r, dz, -1));
+
+            // the range window covers the projection of the ball
+            int wx, wy;
+            index.range_window(p, r, wx, wy);
+            VERIFY(wx < all && wy < all);
+            VERIFY(sorted(index.range_neighbors(i, r)) == bruteForce(map, x, y, wx, wy, p, r, dz, i));
+
+            // the position of a pixel is found at its pixel
+            index.set_window_radius(w);
+            std::vector<int> around = sorted(index.range_neighbors(p, r));
+            VERIFY(std::find(around.begin(), around.end(), i) != around.end());
+            distances.clear();
+            for (int j : index.k_nearest_neighbors(p, k))
+                distances.push_back((map.points[j].pos() - p).squaredNorm());
+            VERIFY(distances.size() == std::min(size_t(k), window.size() + 1) && *std::min_element(distances.begin(), distances.end()) == Scalar(0));
+        }
+    }
+
+    // the invalid pixels have no neighbors
+    for (int i = 0; i < n; ++i)
+    {
+        if (map.valid(i)) continue;
+        VERIFY(sorted(index.range_neighbors(i, Scalar(1))).empty());
+        VERIFY(sorted(index.k_nearest_neighbors(i, 5)).empty());
+        break;
+    }
+}
+
+/// computeAll over the OrganizedIndex gives the fits over the KdTree
+template<typename DataPoint>
+void testComputeAll()
+{
+    using Scalar = typename DataPoint::Scalar;
+    using Fit = Basket<DataPoint, DistWeightFunc<DataPoint, SmoothWeightKernel<Scalar>>, CovariancePlaneFit>;
+
+    const DepthMap<DataPoint> map;
+    const int n = map.width * map.height;
+    OrganizedIndex<DataPoint> index(map.points, map.width, map.height);
+    index.set_intrinsics(map.f, map.f, map.cx, map.cy);
+    index.set_window_radius(std::max(map.width, map.height));
+    const KdTree<DataPoint> tree(map.points);
+
+    const Scalar scale = Eigen::internal::random<Scalar>(0.1, 0.4);
+    std::vector<Scalar> organized(n, Scalar(-1)), reference(n, Scalar(-1));
+    computeAll<Fit>(index, scale, [&](int i, const Fit& fit, FIT_RESULT res) {
+        if (res == STABLE) organized[i] = fit.primitiveGradient(map.points[i].pos()).normalized()(2);
+    });
+    computeAll<Fit>(tree, scale, [&](int i, const Fit& fit, FIT_RESULT res) {
+        if (res == STABLE) reference[i] = fit.primitiveGradient(map.points[i].pos()).normalized()(2);
+    });
+
+    const Scalar epsilon = testEpsilon<Scalar>();
+    for (int i : index.index_data())
+    {
+        VERIFY((organized[i] == Scalar(-1)) == (reference[i] == Scalar(-1)));
+        // the nearly collinear neighborhoods of a few points are sensitive to the order of the neighbors
+        if (sorted(tree.range_neighbors(map.points[i].pos(), scale)).size() >= 10)
+            VERIFY(std::abs(std::abs(organized[i]) - std::abs(reference[i])) <= epsilon);
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    using Point = PointPosition<Scalar, 3>;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testQueries<Point>() ));
+        CALL_SUBTEST(( testComputeAll<Point>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Test the OrganizedIndex..." << std::endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    std::cout << "Ok..." << std::endl;
+}
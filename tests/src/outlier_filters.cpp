@@ -0,0 +1,191 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/outlier_filters.cpp
+    \brief Test the statistical, radius and surface variation outlier filters against brute force
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/surfaceVariationFilter.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTreeOutlierFilters.h>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+// Square of the plane z = 0 with `outliers` points spread in the unit cube
+template<typename DataPoint>
+vector<DataPoint> noisyPlane(int n, int outliers)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    vector<DataPoint> points;
+    for (int i = 0; i < n; ++i)
+    {
+        VectorType p = VectorType::Random();
+        p.z() = Scalar(0);
+        points.push_back(DataPoint(p, VectorType::UnitZ()));
+    }
+    for (int i = 0; i < outliers; ++i)
+        points.push_back(DataPoint(VectorType::Random(), VectorType::UnitZ()));
+    return points;
+}
+
+// Indexed points of the tree, with a random subset of the points
+vector<int> randomSampling(int n)
+{
+    vector<int> sampling;
+    for (int i = 0; i < n; ++i)
+        if (Eigen::internal::random<int>(0, 4) != 0)
+            sampling.push_back(i);
+    return sampling;
+}
+
+template<typename DataPoint>
+void testStatistical()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    const int n = 3000, outliers = 50, k = Eigen::internal::random<int>(4, 16);
+    const Scalar ratio = Eigen::internal::random<Scalar>(0.5, 2);
+    const vector<DataPoint> points = noisyPlane<DataPoint>(n, outliers);
+    const vector<int> sampling = randomSampling(n + outliers);
+    KdTree<DataPoint> tree(points, sampling);
+
+    vector<int> kept;
+    statistical_outlier_filter(tree, k, ratio, kept, Eigen::internal::random<int>(1, 500));
+
+    // brute force over the sampled points
+    vector<Scalar> means(sampling.size());
+    for (std::size_t s = 0; s < sampling.size(); ++s)
+    {
+        vector<Scalar> distances;
+        for (int j : sampling)
+            distances.push_back((points[j].pos() - points[sampling[s]].pos()).norm());
+        std::sort(distances.begin(), distances.end());
+        means[s] = std::accumulate(distances.begin() + 1, distances.begin() + 1 + k, Scalar(0)) / Scalar(k);
+    }
+    const double mean = std::accumulate(means.begin(), means.end(), 0.) / means.size();
+    double variance = 0;
+    for (Scalar m : means)
+        variance += (m - mean) * (m - mean);
+    const double threshold = mean + ratio * std::sqrt(variance / means.size());
+
+    VERIFY(std::is_sorted(kept.begin(), kept.end()));
+    int removedOutliers = 0;
+    for (std::size_t s = 0; s < sampling.size(); ++s)
+    {
+        const bool isKept = std::binary_search(kept.begin(), kept.end(), sampling[s]);
+        // the points close to the threshold may be classified either way by rounding
+        if (std::abs(means[s] - threshold) > 1e-3 * threshold)
+            VERIFY(isKept == (means[s] <= threshold));
+        removedOutliers += !isKept && sampling[s] >= n;
+    }
+    for (int i : kept)
+        VERIFY(std::binary_search(sampling.begin(), sampling.end(), i));
+    VERIFY(removedOutliers > 0);
+
+    // the output feeds a new tree, without copy
+    KdTree<DataPoint> filtered;
+    filtered.build_view(points.data(), int(points.size()), kept);
+    VERIFY(filtered.index_count() == int(kept.size()));
+}
+
+template<typename DataPoint>
+void testRadius()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    const int n = 3000, outliers = 50, minNeighbors = Eigen::internal::random<int>(0, 8);
+    const Scalar r = Eigen::internal::random<Scalar>(0.02, 0.1);
+    const vector<DataPoint> points = noisyPlane<DataPoint>(n, outliers);
+    const vector<int> sampling = randomSampling(n + outliers);
+    KdTree<DataPoint> tree(points, sampling);
+
+    vector<int> kept;
+    radius_outlier_filter(tree, r, minNeighbors, kept, Eigen::internal::random<int>(1, 500));
+
+    vector<int> expected;
+    for (int i : sampling)
+    {
+        int neighbors = 0;
+        for (int j : sampling)
+            neighbors += j != i && (points[j].pos() - points[i].pos()).squaredNorm() < r * r;
+        if (neighbors >= minNeighbors)
+            expected.push_back(i);
+    }
+    VERIFY(kept == expected);
+}
+
+template<typename DataPoint, typename Fit>
+void testSurfaceVariation()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename Fit::WFunctor WeightFunc;
+    const int n = 3000, outliers = 50;
+    const Scalar scale = Scalar(0.1), maxVariation = Scalar(0.05);
+    const vector<DataPoint> points = noisyPlane<DataPoint>(n, outliers);
+    KdTree<DataPoint> tree(points);
+
+    vector<int> kept;
+    computeSurfaceVariationFilter<Fit>(tree, scale, maxVariation, kept);
+
+    vector<int> expected;
+    for (int i = 0; i < int(points.size()); ++i)
+    {
+        vector<DataPoint> neighborhood;
+        for (int j : tree.range_neighbors(points[i].pos(), scale))
+            neighborhood.push_back(points[j]);
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(scale));
+        fit.init(points[i].pos());
+        if (fit.compute(neighborhood.cbegin(), neighborhood.cend()) == STABLE &&
+            fit.surfaceVariation() <= maxVariation)
+            expected.push_back(i);
+    }
+    VERIFY(kept == expected);
+
+    // the plane points are kept, and the outliers away from the plane are removed, but for the rare ones
+    // forming a planar cluster together
+    VERIFY(std::count_if(kept.begin(), kept.end(), [&](int i) { return i < n; }) > n * 9 / 10);
+    VERIFY(std::count_if(kept.begin(), kept.end(),
+                         [&](int i) { return i >= n && std::abs(points[i].pos().z()) > scale; }) <= outliers / 10);
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+    typedef Basket<Point, DistWeightFunc<Point, SmoothWeightKernel<Scalar>>, CovariancePlaneFit> Fit;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testStatistical<Point>() ));
+        CALL_SUBTEST(( testRadius<Point>() ));
+        CALL_SUBTEST(( testSurfaceVariation<Point, Fit>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the outlier filters..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,266 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/point_cloud_file.cpp
+    \brief Test the readers of binary PLY, LAS and raw point cloud files
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Common/IO/pointCloudFile.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+using namespace Ponca;
+
+// Append the bytes of `value` to `out`, reversed when `bigEndian` is true
+template<typename T>
+void writeValue(ofstream& out, T value, bool bigEndian = false)
+{
+    char bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+    if(bigEndian)
+        reverse(bytes, bytes + sizeof(T));
+    out.write(bytes, sizeof(T));
+}
+
+string tempFile(const string& name)
+{
+    return (filesystem::temp_directory_path() / ("ponca_point_cloud_file_" + name)).string();
+}
+
+template<typename DataPoint>
+vector<DataPoint> randomPoints(int n)
+{
+    typedef typename DataPoint::VectorType VectorType;
+    vector<DataPoint> points(n);
+    for(auto& p : points)
+        p = DataPoint(VectorType::Random() * 100, VectorType::Random().normalized());
+    return points;
+}
+
+template<typename DataPoint>
+void testPly(bool bigEndian)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    const int n = Eigen::internal::random<int>(100, 1000);
+    const vector<DataPoint> points = randomPoints<DataPoint>(n);
+
+    // a fixed-size element precedes the vertices, which interleave other properties; a list element follows
+    const string filename = tempFile(bigEndian ? "big.ply" : "little.ply");
+    {
+        ofstream out(filename, ios::binary);
+        out << "ply\r\nformat " << (bigEndian ? "binary_big_endian" : "binary_little_endian") << " 1.0\r\n"
+            << "comment generated by point_cloud_file\r\n"
+            << "element camera 2\r\nproperty float focal\r\nproperty uchar id\r\n"
+            << "element vertex " << n << "\r\n"
+            << "property uchar label\r\nproperty double x\r\nproperty double y\r\nproperty double z\r\n"
+            << "property float nx\r\nproperty float ny\r\nproperty float nz\r\nproperty short intensity\r\n"
+            << "element face 0\r\nproperty list uchar int vertex_indices\r\n"
+            << "end_header\r\n";
+        for(int c = 0; c < 2; ++c)
+        {
+            writeValue(out, 1.f, bigEndian);
+            writeValue(out, uint8_t(c), bigEndian);
+        }
+        for(const auto& p : points)
+        {
+            writeValue(out, uint8_t(7), bigEndian);
+            for(int d = 0; d < 3; ++d)
+                writeValue(out, double(p.pos()[d]), bigEndian);
+            for(int d = 0; d < 3; ++d)
+                writeValue(out, float(p.normal()[d]), bigEndian);
+            writeValue(out, int16_t(-3), bigEndian);
+        }
+    }
+
+    PointCloudFile file;
+    VERIFY(file.open(filename));
+    VERIFY(file.format() == POINT_CLOUD_PLY);
+    VERIFY(file.point_count() == size_t(n));
+    VERIFY(file.has_normals());
+    VERIFY(file.stride() == 1 + 3 * 8 + 3 * 4 + 2);
+
+    vector<DataPoint> read(n);
+    file.read(read.data());
+    vector<Scalar> positions(3 * n), normals(3 * n);
+    file.read_positions(positions.data());
+    file.read_normals(normals.data());
+    for(int i = 0; i < n; ++i)
+    {
+        VERIFY(read[i].pos() == points[i].pos().template cast<double>().template cast<Scalar>());
+        VERIFY((read[i].normal() - points[i].normal()).norm() < Scalar(1e-6));
+        for(int d = 0; d < 3; ++d)
+        {
+            VERIFY(positions[3 * i + d] == read[i].pos()[d]);
+            VERIFY(normals[3 * i + d] == read[i].normal()[d]);
+        }
+    }
+
+    // the points are handed to the tree without copy
+    KdTree<DataPoint> tree;
+    tree.build_view(read.data(), n);
+    VERIFY(tree.valid() && tree.point_count() == n);
+
+    file.close();
+    VERIFY(file.format() == POINT_CLOUD_NONE && file.point_count() == 0);
+    filesystem::remove(filename);
+}
+
+template<typename DataPoint>
+void testLas(int versionMinor, bool compressed = false)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    const int n = Eigen::internal::random<int>(100, 1000);
+    const double scale[3] = {0.001, 0.001, 0.01}, offset[3] = {500000., 4000000., 10.};
+
+    vector<array<int32_t, 3>> coords(n);
+    for(auto& c : coords)
+        for(int d = 0; d < 3; ++d)
+            c[d] = Eigen::internal::random<int32_t>(-100000, 100000);
+
+    // public header block, point data format 1 (28 bytes records), after a variable length record
+    const uint16_t headerSize = versionMinor >= 4 ? 375 : 227;
+    const uint32_t dataOffset = headerSize + 60;
+    const string filename = tempFile("cloud.las");
+    {
+        ofstream out(filename, ios::binary);
+        vector<char> header(dataOffset, 0);
+        memcpy(header.data(), "LASF", 4);
+        header[24] = 1;
+        header[25] = char(versionMinor);
+        memcpy(header.data() + 94, &headerSize, 2);
+        memcpy(header.data() + 96, &dataOffset, 4);
+        header[104] = char(compressed ? 0x81 : 1);
+        const uint16_t recordLength = 28;
+        memcpy(header.data() + 105, &recordLength, 2);
+        const uint32_t legacyCount = versionMinor >= 4 ? 0 : uint32_t(n);
+        memcpy(header.data() + 107, &legacyCount, 4);
+        memcpy(header.data() + 131, scale, 24);
+        memcpy(header.data() + 155, offset, 24);
+        if(versionMinor >= 4)
+        {
+            const uint64_t count = uint64_t(n);
+            memcpy(header.data() + 247, &count, 8);
+        }
+        out.write(header.data(), header.size());
+        for(const auto& c : coords)
+        {
+            for(int d = 0; d < 3; ++d)
+                writeValue(out, c[d]);
+            const char others[16] = {};
+            out.write(others, sizeof(others));
+        }
+    }
+
+    PointCloudFile file;
+    if(compressed)
+    {
+        VERIFY(!file.open(filename));
+        filesystem::remove(filename);
+        return;
+    }
+    VERIFY(file.open(filename));
+    VERIFY(file.format() == POINT_CLOUD_LAS);
+    VERIFY(file.point_count() == size_t(n));
+    VERIFY(!file.has_normals());
+
+    vector<DataPoint> read(n);
+    file.read(read.data());
+    for(int i = 0; i < n; ++i)
+    {
+        VectorType expected;
+        for(int d = 0; d < 3; ++d)
+            expected[d] = Scalar(coords[i][d] * scale[d] + offset[d]);
+        VERIFY(read[i].pos() == expected);
+        VERIFY(read[i].normal() == VectorType::Zero());
+    }
+    filesystem::remove(filename);
+}
+
+template<typename DataPoint>
+void testRaw()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    const int n = Eigen::internal::random<int>(100, 1000);
+    const vector<DataPoint> points = randomPoints<DataPoint>(n);
+
+    const string filename = tempFile("cloud.raw");
+    {
+        ofstream out(filename, ios::binary);
+        out.write(reinterpret_cast<const char*>(points.data()), streamsize(points.size() * sizeof(DataPoint)));
+    }
+
+    PointCloudProperty position, normal;
+    position.offset = int(reinterpret_cast<const char*>(points[0].pos().data()) -
+                          reinterpret_cast<const char*>(&points[0]));
+    normal.offset = int(reinterpret_cast<const char*>(points[0].normal().data()) -
+                        reinterpret_cast<const char*>(&points[0]));
+    position.type = normal.type = sizeof(Scalar) == 4 ? PROPERTY_FLOAT32 : PROPERTY_FLOAT64;
+
+    PointCloudFile file;
+    VERIFY(file.open_raw(filename, sizeof(DataPoint), position, normal));
+    VERIFY(file.format() == POINT_CLOUD_RAW && file.point_count() == size_t(n) && file.has_normals());
+
+    // the records are DataPoint, used in place by the tree
+    const DataPoint* view = file.template view<DataPoint>();
+    VERIFY(view != nullptr);
+    KdTree<DataPoint> tree;
+    tree.build_view(view, n);
+    VERIFY(tree.valid());
+
+    vector<DataPoint> read(n);
+    file.read(read.data());
+    for(int i = 0; i < n; ++i)
+    {
+        VERIFY(read[i].pos() == points[i].pos() && read[i].normal() == points[i].normal());
+        VERIFY(view[i].pos() == points[i].pos());
+    }
+
+    // records not matching DataPoint are not viewed, and records beyond the file are rejected
+    VERIFY(file.open_raw(filename, sizeof(DataPoint) / 2, position));
+    VERIFY(file.template view<DataPoint>() == nullptr);
+    VERIFY(!file.open_raw(filename, sizeof(DataPoint), position, normal, 0, n + 1));
+    VERIFY(!file.open(filename));
+    filesystem::remove(filename);
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testPly<Point>(false) ));
+        CALL_SUBTEST(( testPly<Point>(true) ));
+        CALL_SUBTEST(( testLas<Point>(2) ));
+        CALL_SUBTEST(( testLas<Point>(4) ));
+        CALL_SUBTEST(( testLas<Point>(2, true) ));
+        CALL_SUBTEST(( testRaw<Point>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test point cloud files..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
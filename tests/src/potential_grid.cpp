@@ -0,0 +1,128 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/potential_grid.cpp
+    \brief Test the grid evaluation of PotentialGrid against fresh fits at each vertex
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/potentialGrid.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+/// \param oriented false for the fits whose potential is defined up to its sign
+template<typename Fit>
+void testGrid(bool perfectSphere, bool oriented)
+{
+    typedef typename Fit::DataPoint DataPoint;
+    typedef typename Fit::Scalar Scalar;
+    typedef typename Fit::VectorType VectorType;
+
+    const Scalar radius = Eigen::internal::random<Scalar>(1, 10);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10);
+    vector<DataPoint> points(Eigen::internal::random<int>(500, 2000));
+    for (DataPoint& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, !perfectSphere, !perfectSphere);
+    const KdTree<DataPoint> tree(points);
+
+    // a grid larger than the sphere: its corners have no neighbors
+    const Scalar scale = radius * Eigen::internal::random<Scalar>(0.2, 0.5);
+    const int nx = Eigen::internal::random<int>(12, 20), ny = Eigen::internal::random<int>(12, 20), nz = Eigen::internal::random<int>(12, 20);
+    const Scalar spacing = Scalar(4) * radius / Scalar(std::min({nx, ny, nz}));
+    const VectorType origin = center - VectorType(nx, ny, nz) * spacing / Scalar(2);
+    const int n = nx * ny * nz;
+
+    PotentialGrid<Fit, KdTree<DataPoint>> grid(tree, scale);
+    grid.setBlockSize(Eigen::internal::random<int>(0, 4)); // 0: deduced from the spacing
+    vector<Scalar> potentials(n);
+    vector<VectorType> gradients(n);
+    vector<FIT_RESULT> states(n);
+    const auto stats = grid.evaluate(origin, spacing, nx, ny, nz, potentials.data(), gradients.data(), states.data());
+    VERIFY(stats.skippedBlockCount > 0 && stats.skippedBlockCount < stats.blockCount);
+    VERIFY(stats.fitCount < n);
+
+    // the values of fresh fits at each vertex
+    const Scalar epsilon = testEpsilon<Scalar>();
+    for (int k = 0; k < nz; ++k)
+        for (int j = 0; j < ny; ++j)
+            for (int i = 0; i < nx; ++i)
+            {
+                const int g = i + nx * (j + ny * k);
+                const VectorType q = origin + spacing * VectorType(i, j, k);
+                Fit fit;
+                fit.setWeightFunc(typename Fit::WFunctor(scale));
+                fit.init(q);
+                vector<DataPoint> neighbors;
+                for (int idx : tree.range_neighbors(q, scale))
+                    neighbors.push_back(points[idx]);
+                const FIT_RESULT res = fit.compute(neighbors.cbegin(), neighbors.cend());
+                VERIFY(states[g] == res);
+                if (res == UNDEFINED)
+                    VERIFY(std::isnan(potentials[g]) && std::isnan(gradients[g](0)));
+                // the fits of a few neighbors are sensitive to their order
+                if (res != STABLE || neighbors.size() < 10)
+                    continue;
+                // the order of the neighbors differs, which may flip the unoriented fits
+                const Scalar sign = oriented || potentials[g] * fit.potential(q) >= 0 ? Scalar(1) : Scalar(-1);
+                const Scalar potential = sign * fit.potential(q);
+                VERIFY(std::abs(potentials[g] - potential) <= epsilon * (Scalar(1) + std::abs(potential)));
+                VERIFY((gradients[g] - sign * fit.primitiveGradient(q)).norm() <= epsilon * (Scalar(1) + gradients[g].norm()));
+            }
+
+    // a fit per block: on a perfect sphere, the fits of all the neighborhoods are the sphere
+    if (perfectSphere)
+    {
+        grid.setFitMode(GRID_FIT_PER_BLOCK);
+        vector<Scalar> blockPotentials(n);
+        vector<FIT_RESULT> blockStates(n);
+        const auto blockStats = grid.evaluate(origin, spacing, nx, ny, nz, blockPotentials.data(), nullptr, blockStates.data());
+        VERIFY(blockStats.skippedBlockCount == stats.skippedBlockCount);
+        for (int g = 0; g < n; ++g)
+            if (states[g] == STABLE && blockStates[g] == STABLE)
+                VERIFY(std::abs(blockPotentials[g] - potentials[g]) <= epsilon * (Scalar(1) + std::abs(potentials[g])));
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar>> WeightFunc;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit> SphereFit;
+    typedef Basket<Point, WeightFunc, CovariancePlaneFit> PlaneFit;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testGrid<SphereFit>(true, true) ));
+        CALL_SUBTEST(( testGrid<SphereFit>(false, true) ));
+        CALL_SUBTEST(( testGrid<PlaneFit>(false, false) ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the grid evaluation of the fits..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
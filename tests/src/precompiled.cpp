@@ -0,0 +1,120 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/precompiled.cpp
+    \brief Test that the types instantiated by the Ponca::Precompiled library give the same results as the types
+    instantiated in the test
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/Precompiled>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename Range>
+vector<int> sorted(Range&& range)
+{
+    vector<int> result;
+    for (int j : range)
+        result.push_back(j);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+/// Compare `Fit`, precompiled, and `LocalFit`, the same Basket over the local point type, around `center`
+template<typename Fit, typename LocalFit, typename Tree>
+void compareFits(const Tree& tree, const vector<typename Fit::DataPoint>& points,
+                 const vector<typename LocalFit::DataPoint>& localPoints, int center,
+                 typename Fit::Scalar scale)
+{
+    typedef typename Fit::Scalar Scalar;
+    const typename Fit::VectorType p = points[center].pos();
+
+    Fit fit;
+    fit.setWeightFunc({scale});
+    fit.init(p);
+    LocalFit local;
+    local.setWeightFunc({scale});
+    local.init(p);
+    for (int j : tree.range_neighbors(center, scale))
+    {
+        fit.addNeighbor(points[j]);
+        local.addNeighbor(localPoints[j]);
+    }
+    VERIFY(fit.finalize() == local.finalize());
+    if (!fit.isStable())
+        return;
+
+    const typename Fit::VectorType q = p + scale * Fit::VectorType::Random() / Scalar(2);
+    VERIFY(std::abs(fit.potential(q) - local.potential(q)) <= testEpsilon<Scalar>());
+    VERIFY((fit.project(q) - local.project(q)).norm() <= testEpsilon<Scalar>());
+    VERIFY((fit.primitiveGradient(q) - local.primitiveGradient(q)).norm() <= testEpsilon<Scalar>());
+}
+
+template<typename Scalar>
+void testPrecompiled()
+{
+    typedef Precompiled::Point<Scalar> Point;
+    typedef PointPositionNormal<Scalar, 3> LocalPoint;
+    typedef DistWeightFunc<LocalPoint, SmoothWeightKernel<Scalar>> LocalWeightFunc;
+    typedef typename Point::VectorType VectorType;
+
+    const int n = Eigen::internal::random<int>(500, 2000);
+    const Scalar radius = Eigen::internal::random<Scalar>(Scalar(1), Scalar(10));
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10);
+    vector<LocalPoint> localPoints(n);
+    vector<Point> points(n);
+    for (int i = 0; i < n; ++i)
+    {
+        localPoints[i] = getPointOnSphere<LocalPoint>(radius, center, true, true);
+        points[i] = Point(localPoints[i].pos(), localPoints[i].normal());
+    }
+
+    const Precompiled::Tree<Scalar> tree(points);
+    const KdTree<LocalPoint> localTree(localPoints);
+    VERIFY(tree.valid());
+
+    const Scalar scale = radius / Scalar(2);
+    const int k = Eigen::internal::random<int>(1, 20);
+    for (int q = 0; q < 20; ++q)
+    {
+        const int i = Eigen::internal::random<int>(0, n - 1);
+        const VectorType p = center + radius * VectorType::Random();
+        VERIFY(*tree.nearest_neighbor(p).begin() == *localTree.nearest_neighbor(p).begin());
+        VERIFY(sorted(tree.k_nearest_neighbors(i, k)) == sorted(localTree.k_nearest_neighbors(i, k)));
+        VERIFY(sorted(tree.range_neighbors(p, scale)) == sorted(localTree.range_neighbors(p, scale)));
+
+        compareFits<Precompiled::OrientedSphereFit<Scalar>,
+                    Basket<LocalPoint, LocalWeightFunc, OrientedSphereFit, GLSParam>>(tree, points, localPoints, i, scale);
+        compareFits<Precompiled::UnorientedSphereFit<Scalar>,
+                    Basket<LocalPoint, LocalWeightFunc, UnorientedSphereFit, GLSParam>>(tree, points, localPoints, i, scale);
+        compareFits<Precompiled::PlaneFit<Scalar>,
+                    Basket<LocalPoint, LocalWeightFunc, CovariancePlaneFit>>(tree, points, localPoints, i, scale);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the precompiled types..." << endl;
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testPrecompiled<float>() ));
+        CALL_SUBTEST(( testPrecompiled<double>() ));
+    }
+    cout << "Ok..." << endl;
+}
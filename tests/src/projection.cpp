@@ -93,6 +93,24 @@ void testFunction()
             VERIFY( res1.isApprox( res2 ) );
         }
 
+        // check that the batch evaluations match the ones of each point, including the remainder of the blocks
+        std::vector<VectorType> projections (nbPoints), gradients (nbPoints);
+        std::vector<Scalar> potentials (nbPoints);
+        fit.projectBatch( samples.data(), projections.data(), nbPoints );
+        fit.potentialBatch( samples.data(), potentials.data(), nbPoints );
+        fit.primitiveGradientBatch( samples.data(), gradients.data(), nbPoints );
+        for (int i = 0; i < nbPoints; ++i)
+        {
+            VERIFY( projections[i].isApprox( fit.project( samples[i] ) ) );
+            VERIFY( std::abs( potentials[i] - fit.potential( samples[i] ) ) <= epsilon * (Scalar(1) + std::abs( potentials[i] )) );
+            VERIFY( gradients[i].isApprox( fit.primitiveGradient( samples[i] ) ) );
+        }
+
+        // in place projection
+        fit.projectBatch( samples.data(), samples.data(), nbPoints );
+        for (int i = 0; i < nbPoints; ++i)
+            VERIFY( samples[i] == projections[i] );
+
         // Disable this test: not true with apple-clang 12.
 #ifdef COMPARE_PROJECTION_TIMINGS
         auto start1 = std::chrono::system_clock::now();
@@ -0,0 +1,101 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/ray_casting.cpp
+    \brief Test the intersections of rays with the MLS surface of a sphere, computed by sphereTrace on the host
+    with the tree view used by the CUDA kernels
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/rayCasting.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename DataPoint>
+void testRaycast()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef DistWeightFunc<DataPoint, SmoothWeightKernel<Scalar>> WeightFunc;
+    typedef Basket<DataPoint, WeightFunc, OrientedSphereFit> Fit;
+
+    const Scalar radius = Eigen::internal::random<Scalar>(1, 10);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10);
+    vector<DataPoint> points(Eigen::internal::random<int>(2000, 5000));
+    for (DataPoint& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false);
+    const KdTree<DataPoint> tree(points);
+
+    const Scalar scale = radius * Eigen::internal::random<Scalar>(0.2, 0.4);
+    const MlsSurfaceDistance<Fit, KdTreeDeviceView<DataPoint>> surface {tree.device_view(), scale};
+    SphereTraceParams<Scalar> params;
+
+    const Scalar epsilon = testEpsilon<Scalar>();
+    for (int r = 0; r < 50; ++r)
+    {
+        // rays from outside, towards a point close to the center: they hit the sphere
+        const VectorType origin = center + VectorType::Random().normalized() * radius * Eigen::internal::random<Scalar>(2, 4);
+        const VectorType target = center + VectorType::Random() * (radius / Scalar(4));
+        const VectorType direction = (target - origin).normalized();
+        const Scalar tMax = Scalar(10) * radius;
+
+        // analytic intersection with the sphere
+        const VectorType oc = origin - center;
+        const Scalar b = oc.dot(direction), c = oc.squaredNorm() - radius * radius;
+        const Scalar expected = -b - std::sqrt(b * b - c);
+
+        RayHit<Scalar, VectorType> hit;
+        VERIFY(sphereTrace(surface, origin, direction, Scalar(0), tMax, params, hit));
+        VERIFY(hit.steps <= params.maxSteps);
+        // the hits are within epsilon of the surface, along its normal
+        VERIFY(std::abs(hit.t - expected) * std::abs(direction.dot((origin + expected * direction - center).normalized()))
+               <= params.epsilon * scale + epsilon * radius);
+        const VectorType position = origin + hit.t * direction;
+        VERIFY(Scalar(1) - hit.normal.dot((position - center).normalized()) <= epsilon);
+
+        // the same ray, away from the sphere: no hit
+        RayHit<Scalar, VectorType> miss;
+        VERIFY(!sphereTrace(surface, origin, VectorType(-direction), Scalar(0), tMax, params, miss));
+
+        // the same ray stopped before the sphere: no hit
+        VERIFY(!sphereTrace(surface, origin, direction, Scalar(0), expected - scale, params, miss));
+    }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testRaycast<Point>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the ray casting of the MLS surfaces..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,131 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/scale_sweep.cpp
+    \brief Test that the scale sweep gives the same fits as fitting each scale from scratch
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/scaleSweep.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename DataPoint, typename Fit>
+void testFunction(bool _bAddPositionNoise = false, bool _bAddNormalNoise = false)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename Fit::WFunctor WeightFunc;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(100, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt( Scalar(4. * M_PI) * radius * radius / nbPoints);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1,10);
+    const Scalar epsilon = testEpsilon<Scalar>();
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, _bAddPositionNoise, _bAddNormalNoise, false);
+
+    // increasing scales, from a few neighbors to twice the analysis scale
+    const int scaleCount = Eigen::internal::random<int>(1, 8);
+    vector<Scalar> scales(scaleCount);
+    for(int k = 0; k < scaleCount; ++k)
+        scales[k] = analysisScale * Scalar(2) * Scalar(k + 1) / Scalar(scaleCount);
+
+    for(int i = 0; i < nbPoints; i += 10)
+    {
+        const VectorType& pos = points[i].pos();
+
+        vector<Fit> fits(scaleCount);
+        vector<FIT_RESULT> results(scaleCount, UNDEFINED);
+        int calls = 0;
+        // computeScaleSweep for the constant and polynomial kernels, the fits of the prefixes of the sorted
+        // neighbors otherwise
+        internal::computeScales<Fit>(pos, points.cbegin(), points.cend(), scales,
+            [&](int k, const Fit& fit, FIT_RESULT res) { fits[k] = fit; results[k] = res; ++calls; });
+        VERIFY(calls == scaleCount);
+
+        for(int k = 0; k < scaleCount; ++k)
+        {
+            Fit fit;
+            fit.setWeightFunc(WeightFunc(scales[k]));
+            fit.init(pos);
+            const FIT_RESULT res = fit.compute(points.cbegin(), points.cend());
+
+            VERIFY(res == results[k]);
+            if(res == STABLE)
+            {
+                // same neighbors, added in another order
+                VERIFY( Eigen::internal::isMuchSmallerThan(std::abs(fit.tau_normalized() - fits[k].tau_normalized()), Scalar(1.), epsilon) );
+                VERIFY( Eigen::internal::isMuchSmallerThan(std::abs(fit.kappa_normalized() - fits[k].kappa_normalized()), Scalar(1.), epsilon) );
+                VERIFY( Eigen::internal::isMuchSmallerThan((fit.eta_normalized() - fits[k].eta_normalized()).norm(), Scalar(1.), epsilon) );
+            }
+        }
+    }
+}
+
+template<typename Scalar, int Dim>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, Dim> Point;
+
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightSmoothFunc;
+    typedef DistWeightFunc<Point, ConstantWeightKernel<Scalar> > WeightConstantFunc;
+
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar, 3> > WeightSmooth3Func;
+    typedef DistWeightFunc<Point, EpanechnikovWeightKernel<Scalar> > WeightEpanechnikovFunc;
+    typedef DistWeightFunc<Point, WendlandWeightKernel<Scalar> > WeightWendlandFunc;
+
+    typedef Basket<Point, WeightSmoothFunc, OrientedSphereFit, GLSParam> FitSmooth;
+    typedef Basket<Point, WeightConstantFunc, OrientedSphereFit, GLSParam> FitConstant;
+    typedef Basket<Point, WeightSmooth3Func, OrientedSphereFit, GLSParam> FitSmooth3;
+    typedef Basket<Point, WeightEpanechnikovFunc, OrientedSphereFit, GLSParam> FitEpanechnikov;
+    typedef Basket<Point, WeightWendlandFunc, OrientedSphereFit, GLSParam> FitWendland;
+    typedef Basket<Point, WeightSmoothFunc, OrientedSphereFit, GLSParam, OrientedSphereScaleSpaceDer, GLSDer> FitSmoothDer;
+
+    static_assert(internal::ScaleSweepSupported<FitSmooth>::value, "polynomial kernel with addScaledSums");
+    static_assert(internal::ScaleSweepSupported<FitEpanechnikov>::value, "polynomial kernel with addScaledSums");
+    static_assert(!internal::ScaleSweepSupported<FitWendland>::value, "the Wendland kernel is not polynomial in x^2");
+    static_assert(!internal::ScaleSweepSupported<FitSmoothDer>::value, "the derivatives accumulate their own sums");
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Point, FitSmooth>() ));
+        CALL_SUBTEST(( testFunction<Point, FitConstant>() ));
+        CALL_SUBTEST(( testFunction<Point, FitSmooth>(true, true) ));
+        CALL_SUBTEST(( testFunction<Point, FitConstant>(true, true) ));
+        CALL_SUBTEST(( testFunction<Point, FitSmooth3>(true, true) ));
+        CALL_SUBTEST(( testFunction<Point, FitEpanechnikov>(true, true) ));
+        CALL_SUBTEST(( testFunction<Point, FitWendland>(true, true) ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test scale sweep in 3 dimensions..." << endl;
+    callSubTests<float, 3>();
+    callSubTests<double, 3>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,143 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/src/screen_space.cpp
+    \brief Test the screen-space fits on the image of a sphere in front of a plane, as computed by the CUDA kernels
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/screenSpace.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename Fit>
+void testFunction()
+{
+    typedef typename Fit::Scalar Scalar;
+    typedef typename Fit::VectorType VectorType;
+
+    // orthographic image of a sphere, in front of a plane at distance 10 radius
+    const int width  = Eigen::internal::random<int>(48, 96);
+    const int height = Eigen::internal::random<int>(48, 96);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar pixelSize = radius / Scalar(16);
+    const int scale = 5;
+    const Scalar epsilon = Scalar(100) * testEpsilon<Scalar>();
+
+    vector<Scalar> positions(3 * width * height), normals(3 * width * height, Scalar(0));
+    vector<bool> onSphere(width * height);
+    for(int y = 0; y < height; ++y)
+        for(int x = 0; x < width; ++x)
+        {
+            const int id = x + y * width;
+            const Scalar px = Scalar(x - width / 2) * pixelSize, py = Scalar(y - height / 2) * pixelSize;
+            const Scalar d2 = px * px + py * py;
+            onSphere[id] = d2 < radius * radius;
+            const VectorType p(px, py, onSphere[id] ? std::sqrt(radius * radius - d2) : Scalar(-10) * radius);
+            const VectorType n = onSphere[id] ? VectorType(p / radius) : VectorType::UnitZ();
+            Eigen::Map<VectorType>(positions.data() + 3 * id) = p;
+            // the normals need not be normalized
+            Eigen::Map<VectorType>(normals.data() + 3 * id) = Scalar(2) * n;
+        }
+    // undefined pixel
+    Eigen::Map<VectorType>(normals.data()).setZero();
+
+    Fit fit;
+    VERIFY(fitScreenSpacePixel(fit, 0, 0, width, height, scale, Scalar(0), positions.data(), normals.data()) == UNDEFINED);
+
+    Scalar maxError = 0;
+    for(int y = 1; y < height; ++y)
+        for(int x = 1; x < width; ++x)
+        {
+            if(!onSphere[x + y * width])
+                continue;
+
+            // the depth threshold rejects the plane behind the silhouette
+            Fit sphere;
+            VERIFY(fitScreenSpacePixel(sphere, x, y, width, height, scale, radius, positions.data(), normals.data()) == STABLE);
+            VERIFY(std::abs(std::abs(sphere.kappa()) - Scalar(1) / radius) <= epsilon / radius);
+
+            Fit mixed;
+            fitScreenSpacePixel(mixed, x, y, width, height, scale, Scalar(0), positions.data(), normals.data());
+            maxError = std::max(maxError, std::abs(std::abs(mixed.kappa()) - Scalar(1) / radius));
+        }
+    VERIFY(maxError > Scalar(0.1) / radius);
+
+    // same fits from half precision buffers, converted when the pixels are read
+    vector<Eigen::half> halfPositions(positions.size()), halfNormals(normals.size());
+    transform(positions.begin(), positions.end(), halfPositions.begin(), [](Scalar v) { return Eigen::half(v); });
+    transform(normals.begin(), normals.end(), halfNormals.begin(), [](Scalar v) { return Eigen::half(v); });
+    for(int y = 1; y < height; ++y)
+        for(int x = 1; x < width; ++x)
+        {
+            Fit reference, half;
+            const FIT_RESULT res = fitScreenSpacePixel(reference, x, y, width, height, scale, radius, positions.data(), normals.data());
+            VERIFY(fitScreenSpacePixel(half, x, y, width, height, scale, radius, halfPositions.data(), halfNormals.data()) == res);
+            if(onSphere[x + y * width])
+                VERIFY(std::abs(std::abs(half.kappa()) - Scalar(1) / radius) <= Scalar(0.05) / radius);
+        }
+
+    // same fits from a copy of the part of the image around a block of pixels, as the tiled CUDA kernel
+    const int blockSize = 8;
+    const int bx = Eigen::internal::random<int>(0, width - blockSize), by = Eigen::internal::random<int>(0, height - blockSize);
+    const int side = blockSize + 2 * scale;
+    vector<Scalar> tilePositions(3 * side * side, Scalar(0)), tileNormals(3 * side * side, Scalar(0));
+    const ScreenSpaceTile<Scalar> tile {tilePositions.data(), tileNormals.data(), bx - scale, by - scale, side};
+    for(int y = std::max(tile.y, 0); y < std::min(tile.y + side, height); ++y)
+        for(int x = std::max(tile.x, 0); x < std::min(tile.x + side, width); ++x)
+            for(int c = 0; c < 3; ++c)
+            {
+                tilePositions[tile.index(x, y) + c] = positions[3 * (x + y * width) + c];
+                tileNormals[tile.index(x, y) + c]   = normals[3 * (x + y * width) + c];
+            }
+    for(int y = by; y < by + blockSize; ++y)
+        for(int x = bx; x < bx + blockSize; ++x)
+        {
+            Fit reference, tiled;
+            const FIT_RESULT res = fitScreenSpacePixel(reference, x, y, width, height, scale, radius, positions.data(), normals.data());
+            VERIFY(fitScreenSpacePixel(tiled, x, y, width, height, scale, radius, tile) == res);
+            if(res != UNDEFINED)
+                VERIFY(tiled.kappa() == reference.kappa());
+        }
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef ScreenSpacePoint<Scalar> Point;
+    typedef ProjectedWeightFunc<Point, SmoothWeightKernel<Scalar> > WeightFunc;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit, GLSParam> Fit;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Fit>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test screen-space fits..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}
@@ -0,0 +1,169 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/temporal_fit_cache.cpp
+    \brief Test the fits kept by TemporalFitCache against fresh fits, while the points of a DynamicKdTree move,
+    are inserted and removed
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/temporalFitCache.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/dynamicKdTree.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+/// Compare the surfaces of the fits of the cache to the ones of fresh fits at the points, up to `bound`
+template<typename Fit, typename TreeT>
+void checkFits(const TemporalFitCache<Fit, TreeT>& cache, const TreeT& tree, typename Fit::Scalar bound)
+{
+    typedef typename Fit::DataPoint DataPoint;
+    typedef typename Fit::Scalar Scalar;
+    typedef typename Fit::WFunctor WeightFunc;
+
+    const Scalar scale = cache.scale();
+    for (int i = 0; i < tree.point_count(); ++i)
+    {
+        if (tree.is_removed(i))
+        {
+            VERIFY(cache.state(i) == UNDEFINED);
+            continue;
+        }
+        const typename Fit::VectorType p = tree.point(i).pos();
+        vector<DataPoint> neighbors;
+        for (int j : tree.range_neighbors(p, scale))
+            neighbors.push_back(tree.point(j));
+
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(scale));
+        fit.init(p);
+        // the fits of a few neighbors are sensitive to their order
+        if (fit.compute(neighbors.cbegin(), neighbors.cend()) != STABLE || neighbors.size() < 10)
+            continue;
+        VERIFY(cache.state(i) == STABLE);
+        // the kept spheres may slide along the surface, the surfaces agree
+        const typename Fit::VectorType q = fit.project(p);
+        VERIFY((cache.fit(i).project(q) - q).norm() <= bound);
+    }
+}
+
+template<typename Fit>
+void testTemporalFitCache()
+{
+    typedef typename Fit::DataPoint DataPoint;
+    typedef typename Fit::Scalar Scalar;
+    typedef typename Fit::VectorType VectorType;
+    typedef DynamicKdTree<DataPoint> Tree;
+
+    const Scalar radius = Eigen::internal::random<Scalar>(1, 10);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10);
+    vector<DataPoint> points(Eigen::internal::random<int>(1000, 2000));
+    for (DataPoint& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false);
+    Tree tree(points);
+    const int count = int(points.size());
+
+    const Scalar scale = radius * Eigen::internal::random<Scalar>(Scalar(0.3), Scalar(0.5));
+    const Scalar epsilon = testEpsilon<Scalar>() * scale;
+    TemporalFitCache<Fit, Tree> cache(tree, scale);
+    const Scalar tolerance = cache.tolerance() * scale;
+
+    // the first update fits all the points
+    cache.update();
+    VERIFY(cache.refitCount() == count && cache.queriedCount() == count);
+    checkFits(cache, tree, epsilon);
+
+    // nothing moved
+    cache.update();
+    VERIFY(cache.refitCount() == 0 && cache.queriedCount() == 0 && cache.checkedCount() == 0);
+
+    // slow translation: the fits are kept until the points move away from their spheres by the tolerance
+    const VectorType translation = VectorType::Random().normalized() * (Scalar(0.4) * tolerance);
+    int refit = 0;
+    for (int frame = 0; frame < 10; ++frame)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            DataPoint p = tree.point(i);
+            p.pos() += translation;
+            VERIFY(tree.move(i, p));
+        }
+        cache.update();
+        if (frame == 0)
+            VERIFY(cache.refitCount() == 0 && cache.queriedCount() == 0 && cache.checkedCount() == 0);
+        refit += cache.refitCount();
+        checkFits(cache, tree, tolerance + epsilon);
+    }
+    VERIFY(refit > 0 && refit < 10 * count);
+
+    // a bump: only the fits around the moved points are computed again
+    const VectorType top = tree.point(0).pos();
+    for (int i = 0; i < count; ++i)
+    {
+        DataPoint p = tree.point(i);
+        if ((p.pos() - top).norm() < scale)
+        {
+            p.pos() += p.normal() * (Scalar(0.3) * scale);
+            VERIFY(tree.move(i, p));
+        }
+    }
+    cache.update();
+    VERIFY(cache.refitCount() > 0 && cache.refitCount() < count / 2);
+    checkFits(cache, tree, tolerance + epsilon);
+
+    // insertions and removals
+    for (int i = 0; i < count / 10; ++i)
+    {
+        tree.remove(Eigen::internal::random<int>(0, count - 1));
+        DataPoint p = getPointOnSphere<DataPoint>(radius, center, false, false);
+        p.pos() += Scalar(10) * translation;
+        tree.insert(p);
+    }
+    cache.update();
+    VERIFY(cache.refitCount() > 0);
+    checkFits(cache, tree, tolerance + epsilon);
+    for (int i = count; i < tree.point_count(); ++i)
+        VERIFY(cache.state(i) != UNDEFINED || tree.is_removed(i));
+
+    // settled again
+    cache.update();
+    VERIFY(cache.refitCount() == 0 && cache.queriedCount() == 0 && cache.checkedCount() == 0);
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+    typedef DistWeightFunc<Point, SmoothWeightKernel<Scalar>> WeightFunc;
+    typedef Basket<Point, WeightFunc, OrientedSphereFit> Fit;
+
+    for (int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testTemporalFitCache<Fit>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the temporal cache of fits in float..." << endl;
+    callSubTests<float>();
+    cout << "Test the temporal cache of fits in double..." << endl;
+    callSubTests<double>();
+}
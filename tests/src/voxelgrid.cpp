@@ -0,0 +1,125 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/SpatialPartitioning/VoxelGrid/voxelGrid.h>
+
+using namespace Ponca;
+
+template<typename DataPoint>
+void testVoxelGridRange(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename VoxelGrid<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 100 : 10000;
+	auto points = VectorContainer(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	int seed = 0;
+	std::vector<int> indices(N);
+	std::vector<int> sampling(N / 2);
+	std::iota(indices.begin(), indices.end(), 0);
+	std::sample(indices.begin(), indices.end(), sampling.begin(), N / 2, std::mt19937(seed));
+
+	// cells smaller and larger than the query radii
+	for (Scalar cellSize : {Scalar(0.05), Scalar(0.2), Scalar(4)})
+	{
+		VoxelGrid<DataPoint> structure(points, sampling, cellSize);
+		VERIFY(structure.index_count() == N / 2);
+
+		const Scalar epsilon = testEpsilon<Scalar>();
+#pragma omp parallel for
+		for (int i = 0; i < N; ++i)
+		{
+			Scalar r = Eigen::internal::random<Scalar>(0., 0.5);
+			std::vector<int> results;
+			auto indexQuery = structure.range_neighbors(i, r);
+			for (auto it = indexQuery.begin(); it != indexQuery.end(); ++it)
+			{
+				results.push_back(*it);
+				VERIFY(std::abs(it.squared_distance() - (points[*it].pos() - points[i].pos()).squaredNorm()) <= epsilon);
+			}
+			VERIFY((check_range_neighbors<Scalar, VectorContainer>(points, sampling, i, r, results)));
+
+			// far away inputs are clamped to the grid
+			VectorType point = VectorType::Random() * Scalar(2);
+			results.clear();
+			for (int j : structure.range_neighbors(point, r))
+				results.push_back(j);
+			VERIFY((check_range_neighbors<Scalar, VectorType, VectorContainer>(points, sampling, point, r, results)));
+		}
+	}
+}
+
+template<typename DataPoint>
+void testVoxelGridKNearest(bool quick = true)
+{
+	using Scalar = typename DataPoint::Scalar;
+	using VectorContainer = typename VoxelGrid<DataPoint>::PointContainer;
+	using VectorType = typename DataPoint::VectorType;
+
+	const int N = quick ? 100 : 5000;
+	auto points = VectorContainer(N);
+	std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+	for (Scalar cellSize : {Scalar(0.05), Scalar(0.2), Scalar(4)})
+	{
+		VoxelGrid<DataPoint> structure(points, cellSize);
+		VERIFY(structure.cell_count() > 0 && structure.index_count() == N);
+
+#pragma omp parallel
+		{
+			// one query object per thread, rebound to each input
+			auto indexQuery = structure.k_nearest_neighbors(0, 1);
+			auto pointQuery = structure.k_nearest_neighbors(VectorType::Zero(), 1);
+#pragma omp for
+			for (int i = 0; i < N; ++i)
+			{
+				int k = Eigen::internal::random<int>(1, 20);
+				std::vector<int> results;
+				for (int j : indexQuery(i, k))
+					results.push_back(j);
+				VERIFY((check_k_nearest_neighbors<Scalar, VectorContainer>(points, i, k, results)));
+
+				VectorType point = VectorType::Random() * Scalar(2);
+				results.clear();
+				for (int j : pointQuery(point, k))
+					results.push_back(j);
+				VERIFY((check_k_nearest_neighbors<Scalar, VectorType, VectorContainer>(points, point, k, results)));
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Test VoxelGrid range queries in 3D..." << endl;
+	testVoxelGridRange<TestPoint<float, 3>>(false);
+	testVoxelGridRange<TestPoint<double, 3>>(false);
+
+	cout << "Test VoxelGrid range queries in 4D..." << endl;
+	testVoxelGridRange<TestPoint<float, 4>>(false);
+	testVoxelGridRange<TestPoint<double, 4>>(false);
+
+	cout << "Test VoxelGrid k-nearest queries in 3D..." << endl;
+	testVoxelGridKNearest<TestPoint<float, 3>>(false);
+	testVoxelGridKNearest<TestPoint<double, 3>>(false);
+
+	cout << "Test VoxelGrid k-nearest queries in 4D..." << endl;
+	testVoxelGridKNearest<TestPoint<float, 4>>(false);
+	testVoxelGridKNearest<TestPoint<double, 4>>(false);
+}
@@ -0,0 +1,162 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/src/weighted_points.cpp
+    \brief Test that the fits over the duplicated points merged by collapseDuplicates match the fits over the
+    duplicated points
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/mahalanobisWeightFunc.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/unorientedSphereFit.h>
+#include <Ponca/src/Fitting/weightedPoint.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+static_assert(!internal::HasPointWeight<PointPositionNormal<float, 3>>::value, "");
+static_assert(internal::HasPointWeight<WeightedPoint<PointPositionNormal<float, 3>>>::value, "");
+
+/// Add the points to `fit`, returns the number of points used by the fit
+template<typename Fit, typename Container>
+int fitPoints(Fit& fit, const Container& points)
+{
+    int added = 0;
+    for (const auto& p : points)
+        added += fit.addNeighbor(p);
+    fit.finalize();
+    return added;
+}
+
+/// Compare the fits of the duplicated points and of their merged weighted points, around each input point
+template<typename DataPoint, template<class, class> class WeightFunc, template<class, class, typename> class ... Ext>
+void testFit(const vector<DataPoint>& duplicated, const vector<WeightedPoint<DataPoint>>& merged,
+             const WeightFunc<DataPoint, SmoothWeightKernel<typename DataPoint::Scalar>>& weight,
+             const WeightFunc<WeightedPoint<DataPoint>, SmoothWeightKernel<typename DataPoint::Scalar>>& mergedWeight)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef Basket<DataPoint, WeightFunc<DataPoint, SmoothWeightKernel<Scalar>>, Ext...> Fit;
+    typedef Basket<WeightedPoint<DataPoint>, WeightFunc<WeightedPoint<DataPoint>, SmoothWeightKernel<Scalar>>, Ext...> MergedFit;
+
+    const Scalar epsilon = testEpsilon<Scalar>();
+    for (int q = 0; q < 20; ++q)
+    {
+        const DataPoint& p = duplicated[Eigen::internal::random<int>(0, int(duplicated.size()) - 1)];
+
+        Fit fit;
+        fit.setWeightFunc(weight);
+        fit.init(p.pos());
+        const int added = fitPoints(fit, duplicated);
+
+        MergedFit mergedFit;
+        mergedFit.setWeightFunc(mergedWeight);
+        mergedFit.init(p.pos());
+        const int mergedAdded = fitPoints(mergedFit, merged);
+
+        // fewer neighbors, the same fit: the stability counts the distinct neighbors
+        VERIFY(mergedAdded <= added);
+        VERIFY(mergedFit.getCurrentState() >= fit.getCurrentState());
+        if (mergedFit.getCurrentState() == UNDEFINED || fit.getCurrentState() == UNDEFINED)
+            continue;
+        const Scalar potential = fit.potential(p.pos()), mergedPotential = mergedFit.potential(p.pos());
+        // the unoriented fits are defined up to their sign
+        VERIFY(std::abs(std::abs(potential) - std::abs(mergedPotential)) <= epsilon * std::max(Scalar(1), std::abs(potential)));
+        VERIFY(Scalar(1) - std::abs(fit.primitiveGradient(p.pos()).normalized().dot(mergedFit.primitiveGradient(p.pos()).normalized())) <= epsilon);
+    }
+}
+
+template<typename DataPoint>
+void testCollapse()
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef typename DataPoint::MatrixType MatrixType;
+    typedef SmoothWeightKernel<Scalar> Kernel;
+    typedef WeightedPoint<DataPoint> Weighted;
+
+    const int n = Eigen::internal::random<int>(100, 500);
+    const Scalar radius = Eigen::internal::random<Scalar>(Scalar(1), Scalar(10));
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10);
+
+    // each point of the sphere is duplicated up to 4 times, as the overlapping parts of several scans
+    vector<DataPoint> points(n), duplicated;
+    vector<int> copies(n);
+    for (int i = 0; i < n; ++i)
+    {
+        points[i] = getPointOnSphere<DataPoint>(radius, center, false, false);
+        copies[i] = Eigen::internal::random<int>(1, 4);
+        duplicated.insert(duplicated.end(), copies[i], points[i]);
+    }
+    std::shuffle(duplicated.begin(), duplicated.end(), std::mt19937(Eigen::internal::random<unsigned int>()));
+
+    const Scalar epsilon = radius * Scalar(1e-4);
+    vector<int> representatives;
+    const vector<Weighted> merged = collapseDuplicates(duplicated, epsilon, &representatives);
+
+    VERIFY(int(merged.size()) == n);
+    VERIFY(representatives.size() == duplicated.size());
+    Scalar total = 0;
+    for (const Weighted& p : merged)
+        total += p.weight();
+    VERIFY(total == Scalar(duplicated.size()));
+    for (int i = 0; i < int(duplicated.size()); ++i)
+        VERIFY((merged[representatives[i]].pos() - duplicated[i].pos()).norm() <= epsilon);
+
+    // the weights of weighted points add up
+    const vector<WeightedPoint<Weighted>> again = collapseDuplicates(merged, epsilon);
+    VERIFY(again.size() == merged.size());
+    for (int i = 0; i < int(merged.size()); ++i)
+        VERIFY(again[i].weight() == merged[i].weight());
+
+    const Scalar scale = radius;
+    testFit<DataPoint, DistWeightFunc, OrientedSphereFit>(duplicated, merged, DistWeightFunc<DataPoint, Kernel>(scale),
+                                                          DistWeightFunc<Weighted, Kernel>(scale));
+    testFit<DataPoint, DistWeightFunc, UnorientedSphereFit>(duplicated, merged, DistWeightFunc<DataPoint, Kernel>(scale),
+                                                            DistWeightFunc<Weighted, Kernel>(scale));
+    testFit<DataPoint, DistWeightFunc, CovariancePlaneFit>(duplicated, merged, DistWeightFunc<DataPoint, Kernel>(scale),
+                                                           DistWeightFunc<Weighted, Kernel>(scale));
+
+    const MatrixType metric = MatrixType(VectorType::Random().cwiseAbs().asDiagonal()) + MatrixType::Identity();
+    testFit<DataPoint, MahalanobisWeightFunc, OrientedSphereFit>(
+        duplicated, merged, MahalanobisWeightFunc<DataPoint, Kernel>(scale, metric),
+        MahalanobisWeightFunc<Weighted, Kernel>(scale, metric));
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    typedef PointPositionNormal<Scalar, 3> Point;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testCollapse<Point>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test the fits over weighted points..." << endl;
+    callSubTests<float>();
+    callSubTests<double>();
+    cout << "Ok..." << endl;
+}